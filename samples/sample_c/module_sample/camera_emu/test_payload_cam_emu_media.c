@@ -27,12 +27,17 @@
 #include <stdlib.h>
 #include "ziyan_logger.h"
 #include "utils/util_misc.h"
+#include "utils/util_log.h"
+#include "utils/util_metrics.h"
+#include "utils/util_trace.h"
 #include "utils/util_time.h"
 #include "utils/util_file.h"
 #include "utils/util_buffer.h"
 #include "test_payload_cam_emu_media.h"
 #include "test_payload_cam_emu_base.h"
 #include "camera_emu/ziyan_media_file_manage/ziyan_media_file_core.h"
+#include "camera_emu/ziyan_media_file_manage/ziyan_media_download_session.h"
+#include "camera_emu/ziyan_media_file_manage/ziyan_media_catalog.h"
 #include "ziyan_high_speed_data_channel.h"
 #include "ziyan_aircraft_info.h"
 
@@ -42,6 +47,8 @@
 #define VIDEO_FRAME_MAX_COUNT                18000 // max video duration 10 minutes
 #define VIDEO_FRAME_AUD_LEN                  6
 #define DATA_SEND_FROM_VIDEO_STREAM_MAX_LEN  60000
+#define VIDEO_SEND_LOG_PERIOD_MS             1000
+#define DOWNLOAD_SESSION_REAP_PERIOD_MS      1000
 
 /* Private types -------------------------------------------------------------*/
 typedef enum {
@@ -138,6 +145,22 @@ static T_ZiyanMediaFileHandle s_mediaFileScreenNailHandle;
 static const uint8_t s_frameAudInfo[VIDEO_FRAME_AUD_LEN] = {0x00, 0x00, 0x00, 0x01, 0x09, 0x10};
 static char s_mediaFileDirPath[ZIYAN_FILE_PATH_SIZE_MAX] = {0};
 static bool s_isMediaFileDirPathConfigured = false;
+static T_UtilMetric s_videoFrameCount = UTIL_METRICS_COUNTER("ziyan_camera_video_frames_total",
+                                                             "Video frames sent to the video stream.");
+static T_UtilMetric s_videoSendBytes = UTIL_METRICS_COUNTER("ziyan_camera_video_send_bytes_total",
+                                                            "Bytes sent to the video stream.");
+static T_UtilMetric s_videoSendErrorCount = UTIL_METRICS_COUNTER("ziyan_camera_video_send_errors_total",
+                                                                 "Failed video stream sends.");
+static T_UtilMetric s_videoFrameSendTime = UTIL_METRICS_HISTOGRAM("ziyan_camera_video_frame_send_microseconds",
+                                                                  "Time to send one video frame.");
+static T_UtilMetric s_videoBandwidthLimit = UTIL_METRICS_GAUGE("ziyan_camera_video_bandwidth_limit",
+                                                               "Realtime bandwidth limit of the video stream.");
+static T_UtilMetric s_videoBandwidthBeforeFlowController = UTIL_METRICS_GAUGE(
+    "ziyan_camera_video_bandwidth_before_flow_controller", "Realtime bandwidth before the flow controller.");
+static T_UtilMetric s_videoBandwidthAfterFlowController = UTIL_METRICS_GAUGE(
+    "ziyan_camera_video_bandwidth_after_flow_controller", "Realtime bandwidth after the flow controller.");
+static T_UtilMetric s_videoBusyState = UTIL_METRICS_GAUGE("ziyan_camera_video_busy_state",
+                                                          "Busy state of the video stream channel.");
 
 /* Exported functions definition ---------------------------------------------*/
 T_ZiyanReturnCode ZiyanTest_CameraEmuMediaStartService(void)
@@ -147,6 +170,8 @@ T_ZiyanReturnCode ZiyanTest_CameraEmuMediaStartService(void)
     const T_ZiyanDataChannelBandwidthProportionOfHighspeedChannel bandwidthProportionOfHighspeedChannel =
         {10, 60, 30};
     T_ZiyanAircraftInfoBaseInfo aircraftInfoBaseInfo = {0};
+    char mediaFileDirPath[ZIYAN_FILE_PATH_SIZE_MAX + 32];
+    char catalogFilePath[ZIYAN_FILE_PATH_SIZE_MAX + 48];
 
     if (ZiyanAircraftInfo_GetBaseInfo(&aircraftInfoBaseInfo) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("get aircraft information error.");
@@ -192,6 +217,21 @@ T_ZiyanReturnCode ZiyanTest_CameraEmuMediaStartService(void)
 
     UtilBuffer_Init(&s_mediaPlayCommandBufferHandler, s_mediaPlayCommandBuffer, sizeof(s_mediaPlayCommandBuffer));
 
+    returnCode = ZiyanMediaDownload_Init();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("media download session init error.");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    // The media listing and media info fall back to the card when the catalog is not available.
+    if (GetMediaFileDir(mediaFileDirPath) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        snprintf(catalogFilePath, sizeof(catalogFilePath), "%s.catalog", mediaFileDirPath);
+        returnCode = ZiyanMediaCatalog_Init(mediaFileDirPath, catalogFilePath);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_WARN("media catalog init error stat:0x%08llX", returnCode);
+        }
+    }
+
     if (aircraftInfoBaseInfo.aircraftType == ZIYAN_AIRCRAFT_TYPE_SHADOW_PLUS ||
         aircraftInfoBaseInfo.aircraftType == ZIYAN_AIRCRAFT_TYPE_SHADOW_MAX) {
         returnCode = ZiyanPayloadCamera_RegMediaDownloadPlaybackHandler(&s_psdkCameraMedia);
@@ -233,6 +273,10 @@ T_ZiyanReturnCode ZiyanTest_CameraMediaGetFileInfo(const char *filePath, T_Ziyan
     T_ZiyanReturnCode returnCode;
     T_ZiyanMediaFileHandle mediaFileHandle;
 
+    if (ZiyanMediaCatalog_GetFileInfo(filePath, fileInfo) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
     returnCode = ZiyanMediaFile_CreateHandle(filePath, &mediaFileHandle);
     if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Media file create handle error stat:0x%08llX", returnCode);
@@ -778,26 +822,13 @@ static T_ZiyanReturnCode GetMediaFileOriginData(const char *filePath, uint32_t o
 {
     T_ZiyanReturnCode returnCode;
     uint32_t realLen = 0;
-    T_ZiyanMediaFileHandle mediaFileHandle;
-
-    returnCode = ZiyanMediaFile_CreateHandle(filePath, &mediaFileHandle);
-    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("Media file create handle error stat:0x%08llX", returnCode);
-        return returnCode;
-    }
 
-    returnCode = ZiyanMediaFile_GetDataOrg(mediaFileHandle, offset, length, data, &realLen);
+    returnCode = ZiyanMediaDownload_ReadData(filePath, offset, length, data, &realLen);
     if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Media file get data error stat:0x%08llX", returnCode);
         return returnCode;
     }
 
-    returnCode = ZiyanMediaFile_DestroyHandle(mediaFileHandle);
-    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("Media file destroy handle error stat:0x%08llX", returnCode);
-        return returnCode;
-    }
-
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -817,6 +848,8 @@ static T_ZiyanReturnCode CreateMediaFileThumbNail(const char *filePath)
         return returnCode;
     }
 
+    ZiyanMediaCatalog_SetPreviewState(filePath, ZIYAN_MEDIA_CATALOG_PREVIEW_THUMBNAIL);
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -915,6 +948,8 @@ static T_ZiyanReturnCode CreateMediaFileScreenNail(const char *filePath)
         return returnCode;
     }
 
+    ZiyanMediaCatalog_SetPreviewState(filePath, ZIYAN_MEDIA_CATALOG_PREVIEW_SCREENNAIL);
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -1117,6 +1152,12 @@ static T_ZiyanReturnCode StartDownloadNotification(void)
 
     USER_LOG_DEBUG("media download start notification.");
 
+    returnCode = ZiyanMediaDownload_StartNotify();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Start media download sessions error, stat:0x%08llX.", returnCode);
+        return returnCode;
+    }
+
     bandwidthProportion.dataStream = 0;
     bandwidthProportion.videoStream = 0;
     bandwidthProportion.downloadStream = 100;
@@ -1137,6 +1178,11 @@ static T_ZiyanReturnCode StopDownloadNotification(void)
 
     USER_LOG_DEBUG("media download stop notification.");
 
+    returnCode = ZiyanMediaDownload_StopNotify();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Stop media download sessions error, stat:0x%08llX.", returnCode);
+    }
+
     bandwidthProportion.dataStream = 10;
     bandwidthProportion.videoStream = 60;
     bandwidthProportion.downloadStream = 30;
@@ -1174,6 +1220,7 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
     uint32_t waitDuration = 1000 / SEND_VIDEO_TASK_FREQ;
     uint32_t rightNow = 0;
     uint32_t sendExpect = 0;
+    uint32_t sessionReapTimeMs = 0;
     T_TestPayloadCameraVideoFrameInfo *frameInfo = NULL;
     uint32_t frameNumber = 0;
     uint32_t frameCount = 0;
@@ -1187,6 +1234,8 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
     E_ZiyanCameraVideoStreamType videoStreamType;
     char curFileDirPath[ZIYAN_FILE_PATH_SIZE_MAX];
     char tempPath[ZIYAN_FILE_PATH_SIZE_MAX];
+    uint64_t frameSendStartUs = 0;
+    uint64_t frameSendEndUs = 0;
 
     USER_UTIL_UNUSED(arg);
 
@@ -1237,6 +1286,12 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
         }
         (void)osalHandler->SemaphoreTimedWait(s_mediaPlayWorkSem, waitDuration);
 
+        // Reads only reap the sessions of other files, an abandoned download is closed here.
+        if (rightNow - sessionReapTimeMs >= DOWNLOAD_SESSION_REAP_PERIOD_MS) {
+            (void)ZiyanMediaDownload_CloseIdleSessions(ZIYAN_MEDIA_DOWNLOAD_SESSION_IDLE_TIMEOUT_MS);
+            sessionReapTimeMs = rightNow;
+        }
+
         // response playback command
         if (osalHandler->MutexLock(s_mediaPlayCommandBufferMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("mutex lock error");
@@ -1357,7 +1412,8 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
             if (dataLength != frameInfo[frameNumber].size) {
                 USER_LOG_ERROR("read data from video file error.");
             } else {
-                USER_LOG_DEBUG("read data from video file success, len = %d B\r\n", dataLength);
+                USER_LOG_EVERY_MS(DEBUG, VIDEO_SEND_LOG_PERIOD_MS, "read data from video file success, len = %d B",
+                                  dataLength);
             }
 
             if (videoStreamType == ZIYAN_CAMERA_VIDEO_STREAM_TYPE_H264_ZIYAN_FORMAT) {
@@ -1365,18 +1421,30 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
                 dataLength = dataLength + VIDEO_FRAME_AUD_LEN;
             }
 
+            (void)osalHandler->GetTimeUs(&frameSendStartUs);
             lengthOfDataHaveBeenSent = 0;
             while (dataLength - lengthOfDataHaveBeenSent) {
                 lengthOfDataToBeSent = USER_UTIL_MIN(DATA_SEND_FROM_VIDEO_STREAM_MAX_LEN,
                                                     dataLength - lengthOfDataHaveBeenSent);
-                printf("send video stream, len = %d B\r\n", lengthOfDataToBeSent);
+                USER_LOG_EVERY_MS(DEBUG, VIDEO_SEND_LOG_PERIOD_MS, "send video stream, len = %d B",
+                                  lengthOfDataToBeSent);
                 returnCode = ZiyanPayloadCamera_SendVideoStream((const uint8_t *) dataBuffer + lengthOfDataHaveBeenSent,
                                                             lengthOfDataToBeSent);
                 if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-                    USER_LOG_ERROR("send video stream error: 0x%08llX.", returnCode);
+                    USER_LOG_EVERY_MS(ERROR, VIDEO_SEND_LOG_PERIOD_MS, "send video stream error: 0x%08llX.", returnCode);
+                    UtilMetrics_CounterAdd(&s_videoSendErrorCount, 1);
+                } else {
+                    UtilMetrics_CounterAdd(&s_videoSendBytes, lengthOfDataToBeSent);
                 }
                 lengthOfDataHaveBeenSent += lengthOfDataToBeSent;
             }
+            (void)osalHandler->GetTimeUs(&frameSendEndUs);
+            UtilMetrics_HistogramRecord(&s_videoFrameSendTime, frameSendEndUs - frameSendStartUs);
+            if (UTIL_TRACE_IS_ENABLED()) {
+                UtilTrace_Complete(UTIL_TRACE_CATEGORY_USER, "send video frame", frameSendStartUs, "bytes",
+                                   dataLength);
+            }
+            UtilMetrics_CounterAdd(&s_videoFrameCount, 1);
 
             (void)osalHandler->GetTimeMs(&sendExpect);
             sendExpect += (1000 / frameRate);
@@ -1391,13 +1459,20 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
 
             returnCode = ZiyanPayloadCamera_GetVideoStreamState(&videoStreamState);
             if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-                USER_LOG_DEBUG(
+                UtilMetrics_GaugeSet(&s_videoBandwidthLimit, videoStreamState.realtimeBandwidthLimit);
+                UtilMetrics_GaugeSet(&s_videoBandwidthBeforeFlowController,
+                                     videoStreamState.realtimeBandwidthBeforeFlowController);
+                UtilMetrics_GaugeSet(&s_videoBandwidthAfterFlowController,
+                                     videoStreamState.realtimeBandwidthAfterFlowController);
+                UtilMetrics_GaugeSet(&s_videoBusyState, videoStreamState.busyState);
+                USER_LOG_EVERY_MS(
+                    DEBUG, VIDEO_SEND_LOG_PERIOD_MS,
                     "video stream state: realtimeBandwidthLimit: %d, realtimeBandwidthBeforeFlowController: %d, realtimeBandwidthAfterFlowController:%d busyState: %d.",
                     videoStreamState.realtimeBandwidthLimit, videoStreamState.realtimeBandwidthBeforeFlowController,
                     videoStreamState.realtimeBandwidthAfterFlowController,
                     videoStreamState.busyState);
             } else {
-                USER_LOG_ERROR("get video stream state error.");
+                USER_LOG_EVERY_MS(ERROR, VIDEO_SEND_LOG_PERIOD_MS, "get video stream state error.");
             }
 
         free:
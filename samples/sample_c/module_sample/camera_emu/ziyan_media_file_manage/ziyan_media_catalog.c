@@ -0,0 +1,852 @@
+/**
+ ********************************************************************
+ * @file    ziyan_media_catalog.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <ziyan_logger.h>
+#include <utils/util_misc.h>
+#include <osal/osal_fs.h>
+
+#include "ziyan_media_catalog.h"
+#include "ziyan_media_file_core.h"
+#include "ziyan_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define MEDIA_CATALOG_TASK_STACK_SIZE           2048
+#define MEDIA_CATALOG_POLL_PERIOD_MS            1000
+#define MEDIA_CATALOG_PERSIST_PERIOD_MS         5000
+#define MEDIA_CATALOG_HASH_BUCKET_INIT_NUM      256
+#define MEDIA_CATALOG_INOTIFY_BUFFER_SIZE       4096
+#define MEDIA_CATALOG_PERSIST_MAGIC             0x5A4D4331 // "ZMC1"
+#define MEDIA_CATALOG_PERSIST_VERSION           1
+#define MEDIA_CATALOG_INOTIFY_MASK              (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | \
+                                                 IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct _ZiyanMediaCatalogEntry {
+    char fileName[ZIYAN_FILE_NAME_SIZE_MAX];
+    uint64_t fileSize;
+    int64_t captureTimeSec;
+    E_ZiyanCameraMediaFileType type;
+    bool isAttrValid;
+    T_ZiyanCameraMediaFileAttr attr;
+    uint8_t previewState;
+    bool isSeen;
+    uint32_t listIndex; /*!< Position in s_catalogEntries, which keeps no particular order. */
+    struct _ZiyanMediaCatalogEntry *hashNext;
+} T_ZiyanMediaCatalogEntry;
+
+#pragma pack(1)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t recordCount;
+} T_ZiyanMediaCatalogPersistHeader;
+
+typedef struct {
+    char fileName[ZIYAN_FILE_NAME_SIZE_MAX];
+    uint64_t fileSize;
+    int64_t captureTimeSec;
+    uint8_t type;
+    uint8_t isAttrValid;
+    uint16_t attrVideoDuration;
+    uint16_t attrVideoFrameRate;
+    uint16_t attrVideoResolution;
+    uint8_t previewState;
+} T_ZiyanMediaCatalogPersistRecord;
+#pragma pack()
+
+/* Private functions declaration ---------------------------------------------*/
+static void *ZiyanMediaCatalog_Task(void *arg);
+static uint32_t ZiyanMediaCatalog_Hash(const char *fileName);
+static T_ZiyanMediaCatalogEntry *ZiyanMediaCatalog_Find(const char *fileName);
+static T_ZiyanReturnCode ZiyanMediaCatalog_Insert(T_ZiyanMediaCatalogEntry *entry);
+static void ZiyanMediaCatalog_Remove(T_ZiyanMediaCatalogEntry *entry);
+static void ZiyanMediaCatalog_Update(const char *fileName);
+static void ZiyanMediaCatalog_Scan(void);
+static void ZiyanMediaCatalog_Clear(void);
+static const char *ZiyanMediaCatalog_GetFileName(const char *filePath);
+static size_t ZiyanMediaCatalog_GetDirPathLen(const char *dirPath);
+static T_ZiyanReturnCode ZiyanMediaCatalog_ListDir(const char *dirPath, T_OsalDirList **dirList);
+static int ZiyanMediaCatalog_CompareCaptureTime(const void *a, const void *b);
+static void ZiyanMediaCatalog_Load(void);
+static T_ZiyanReturnCode ZiyanMediaCatalog_Persist(void);
+
+/* Private values ------------------------------------------------------------*/
+static T_ZiyanMutexHandle s_catalogMutex = NULL;
+static T_ZiyanTaskHandle s_catalogThread;
+static T_ZiyanSemaHandle s_catalogExitSem = NULL;
+static bool s_isCatalogTaskExit = false;
+static char s_catalogDirPath[ZIYAN_FILE_PATH_SIZE_MAX];
+static char s_catalogPersistPath[ZIYAN_FILE_PATH_SIZE_MAX];
+static int s_catalogDirFd = -1;
+static int s_catalogInotifyFd = -1;
+static bool s_isCatalogRescanNeeded = false;
+static bool s_isCatalogDirty = false;
+static uint32_t s_catalogLastPersistTimeMs = 0;
+static T_ZiyanMediaCatalogEntry **s_catalogEntries = NULL;
+static uint32_t s_catalogEntryCount = 0;
+static uint32_t s_catalogEntryCapacity = 0;
+static T_ZiyanMediaCatalogEntry **s_catalogHashBuckets = NULL;
+static uint32_t s_catalogHashBucketCount = 0;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode ZiyanMediaCatalog_Init(const char *dirPath, const char *persistFilePath)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanReturnCode returnCode;
+    uint32_t startTimeMs = 0;
+    uint32_t endTimeMs = 0;
+
+    if (dirPath == NULL || strlen(dirPath) >= sizeof(s_catalogDirPath) ||
+        (persistFilePath != NULL && strlen(persistFilePath) >= sizeof(s_catalogPersistPath))) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_catalogMutex != NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    strcpy(s_catalogDirPath, dirPath);
+    memset(s_catalogPersistPath, 0, sizeof(s_catalogPersistPath));
+    if (persistFilePath != NULL) {
+        strcpy(s_catalogPersistPath, persistFilePath);
+    }
+
+    s_catalogDirFd = open(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (s_catalogDirFd < 0) {
+        USER_LOG_ERROR("Open media catalog dir %s error, errno:%d.", dirPath, errno);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    // Watch before the initial scan, so that nothing written in between is missed.
+    s_catalogInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (s_catalogInotifyFd < 0 || inotify_add_watch(s_catalogInotifyFd, dirPath, MEDIA_CATALOG_INOTIFY_MASK) < 0) {
+        USER_LOG_ERROR("Watch media catalog dir %s error, errno:%d.", dirPath, errno);
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+
+    if (osalHandler->MutexCreate(&s_catalogMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex create error");
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto out;
+    }
+
+    if (osalHandler->SemaphoreCreate(0, &s_catalogExitSem) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("semaphore create error");
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto out;
+    }
+
+    osalHandler->GetTimeMs(&startTimeMs);
+    osalHandler->MutexLock(s_catalogMutex);
+    ZiyanMediaCatalog_Load();
+    ZiyanMediaCatalog_Scan();
+    osalHandler->MutexUnlock(s_catalogMutex);
+    osalHandler->GetTimeMs(&endTimeMs);
+    s_catalogLastPersistTimeMs = endTimeMs;
+
+    USER_LOG_INFO("Media catalog of %s ready, %d files in %d ms.", dirPath, s_catalogEntryCount,
+                  endTimeMs - startTimeMs);
+
+    s_isCatalogTaskExit = false;
+    returnCode = osalHandler->TaskCreate("media_catalog", ZiyanMediaCatalog_Task, MEDIA_CATALOG_TASK_STACK_SIZE,
+                                         NULL, &s_catalogThread);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("media catalog task create error.");
+        goto out;
+    }
+
+    // From now on listings of the media directory are served from memory instead of a scan of the card.
+    Osal_DirSetListProvider(ZiyanMediaCatalog_ListDir);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    if (s_catalogMutex != NULL) {
+        ZiyanMediaCatalog_Clear();
+        osalHandler->MutexDestroy(s_catalogMutex);
+        s_catalogMutex = NULL;
+    }
+    if (s_catalogExitSem != NULL) {
+        osalHandler->SemaphoreDestroy(s_catalogExitSem);
+        s_catalogExitSem = NULL;
+    }
+    if (s_catalogInotifyFd >= 0) {
+        close(s_catalogInotifyFd);
+        s_catalogInotifyFd = -1;
+    }
+    close(s_catalogDirFd);
+    s_catalogDirFd = -1;
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode ZiyanMediaCatalog_DeInit(void)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+
+    if (s_catalogMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    Osal_DirSetListProvider(NULL);
+
+    s_isCatalogTaskExit = true;
+    if (osalHandler->SemaphoreTimedWait(s_catalogExitSem, 2 * MEDIA_CATALOG_POLL_PERIOD_MS) !=
+        ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_WARN("Wait media catalog task exit timeout.");
+        osalHandler->TaskDestroy(s_catalogThread);
+    }
+
+    osalHandler->MutexLock(s_catalogMutex);
+    if (s_isCatalogDirty) {
+        ZiyanMediaCatalog_Persist();
+    }
+    ZiyanMediaCatalog_Clear();
+    osalHandler->MutexUnlock(s_catalogMutex);
+
+    osalHandler->MutexDestroy(s_catalogMutex);
+    s_catalogMutex = NULL;
+    osalHandler->SemaphoreDestroy(s_catalogExitSem);
+    s_catalogExitSem = NULL;
+    close(s_catalogInotifyFd);
+    s_catalogInotifyFd = -1;
+    close(s_catalogDirFd);
+    s_catalogDirFd = -1;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaCatalog_GetFileInfo(const char *filePath, T_ZiyanCameraMediaFileInfo *fileInfo)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanMediaCatalogEntry *entry;
+    T_ZiyanMediaFileHandle mediaFileHandle;
+    T_ZiyanCameraMediaFileAttr attr = {0};
+    T_ZiyanReturnCode returnCode;
+    const char *fileName;
+    uint64_t fileSize;
+    int64_t captureTimeSec;
+
+    if (filePath == NULL || fileInfo == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_catalogMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    fileName = ZiyanMediaCatalog_GetFileName(filePath);
+    if (fileName == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    osalHandler->MutexLock(s_catalogMutex);
+    entry = ZiyanMediaCatalog_Find(fileName);
+    if (entry == NULL) {
+        osalHandler->MutexUnlock(s_catalogMutex);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    fileInfo->type = entry->type;
+    fileInfo->fileSize = (uint32_t) entry->fileSize;
+    if (entry->isAttrValid) {
+        fileInfo->mediaFileAttr = entry->attr;
+        osalHandler->MutexUnlock(s_catalogMutex);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+    fileSize = entry->fileSize;
+    captureTimeSec = entry->captureTimeSec;
+    osalHandler->MutexUnlock(s_catalogMutex);
+
+    // Attributes may need ffprobe, so they are computed outside of the lock and cached if the file did not change.
+    returnCode = ZiyanMediaFile_CreateHandle(filePath, &mediaFileHandle);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Media file create handle error stat:0x%08llX", returnCode);
+        return returnCode;
+    }
+
+    returnCode = ZiyanMediaFile_GetMediaFileAttr(mediaFileHandle, &attr);
+    ZiyanMediaFile_DestroyHandle(mediaFileHandle);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Media file get attr error stat:0x%08llX", returnCode);
+        return returnCode;
+    }
+
+    fileInfo->mediaFileAttr = attr;
+
+    osalHandler->MutexLock(s_catalogMutex);
+    entry = ZiyanMediaCatalog_Find(fileName);
+    if (entry != NULL && entry->fileSize == fileSize && entry->captureTimeSec == captureTimeSec) {
+        entry->attr = attr;
+        entry->isAttrValid = true;
+        s_isCatalogDirty = true;
+    }
+    osalHandler->MutexUnlock(s_catalogMutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaCatalog_SetPreviewState(const char *filePath, uint8_t previewState)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanMediaCatalogEntry *entry;
+    const char *fileName;
+
+    if (filePath == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_catalogMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    fileName = ZiyanMediaCatalog_GetFileName(filePath);
+    if (fileName == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    osalHandler->MutexLock(s_catalogMutex);
+    entry = ZiyanMediaCatalog_Find(fileName);
+    if (entry != NULL && (entry->previewState & previewState) != previewState) {
+        entry->previewState |= previewState;
+        s_isCatalogDirty = true;
+    }
+    osalHandler->MutexUnlock(s_catalogMutex);
+
+    return entry != NULL ? ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS : ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+}
+
+/* Private functions definition-----------------------------------------------*/
+#ifndef __CC_ARM
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#endif
+
+static void *ZiyanMediaCatalog_Task(void *arg)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    char buffer[MEDIA_CATALOG_INOTIFY_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd = {.fd = s_catalogInotifyFd, .events = POLLIN};
+    const struct inotify_event *event;
+    uint32_t nowMs = 0;
+    ssize_t len;
+    ssize_t pos;
+
+    USER_UTIL_UNUSED(arg);
+
+    while (!s_isCatalogTaskExit) {
+        if (poll(&pfd, 1, MEDIA_CATALOG_POLL_PERIOD_MS) > 0) {
+            osalHandler->MutexLock(s_catalogMutex);
+            while ((len = read(s_catalogInotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (pos = 0; pos < len; pos += sizeof(struct inotify_event) + event->len) {
+                    event = (const struct inotify_event *) (buffer + pos);
+
+                    if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                        s_isCatalogRescanNeeded = true;
+                    } else if (event->len != 0 && !(event->mask & IN_ISDIR)) {
+                        ZiyanMediaCatalog_Update(event->name);
+                    }
+                }
+            }
+
+            if (s_isCatalogRescanNeeded) {
+                USER_LOG_WARN("Media catalog lost track of %s, rescan.", s_catalogDirPath);
+                ZiyanMediaCatalog_Scan();
+                s_isCatalogRescanNeeded = false;
+            }
+            osalHandler->MutexUnlock(s_catalogMutex);
+        }
+
+        osalHandler->GetTimeMs(&nowMs);
+        if (s_isCatalogDirty && nowMs - s_catalogLastPersistTimeMs >= MEDIA_CATALOG_PERSIST_PERIOD_MS) {
+            osalHandler->MutexLock(s_catalogMutex);
+            ZiyanMediaCatalog_Persist();
+            osalHandler->MutexUnlock(s_catalogMutex);
+            s_catalogLastPersistTimeMs = nowMs;
+        }
+    }
+
+    osalHandler->SemaphorePost(s_catalogExitSem);
+
+    return NULL;
+}
+
+#ifndef __CC_ARM
+#pragma GCC diagnostic pop
+#endif
+
+static uint32_t ZiyanMediaCatalog_Hash(const char *fileName)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*fileName != '\0') {
+        hash ^= (uint8_t) *fileName++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static T_ZiyanMediaCatalogEntry *ZiyanMediaCatalog_Find(const char *fileName)
+{
+    T_ZiyanMediaCatalogEntry *entry;
+
+    if (s_catalogHashBucketCount == 0) {
+        return NULL;
+    }
+
+    entry = s_catalogHashBuckets[ZiyanMediaCatalog_Hash(fileName) & (s_catalogHashBucketCount - 1)];
+    while (entry != NULL && strcmp(entry->fileName, fileName) != 0) {
+        entry = entry->hashNext;
+    }
+
+    return entry;
+}
+
+static T_ZiyanReturnCode ZiyanMediaCatalog_Insert(T_ZiyanMediaCatalogEntry *entry)
+{
+    T_ZiyanMediaCatalogEntry **newBuckets;
+    T_ZiyanMediaCatalogEntry **newEntries;
+    T_ZiyanMediaCatalogEntry *node;
+    uint32_t newBucketCount;
+    uint32_t bucket;
+    uint32_t i;
+
+    if (s_catalogEntryCount == s_catalogEntryCapacity) {
+        newEntries = realloc(s_catalogEntries, (s_catalogEntryCapacity == 0 ? 64 : s_catalogEntryCapacity * 2) *
+                                               sizeof(T_ZiyanMediaCatalogEntry *));
+        if (newEntries == NULL) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+        s_catalogEntries = newEntries;
+        s_catalogEntryCapacity = s_catalogEntryCapacity == 0 ? 64 : s_catalogEntryCapacity * 2;
+    }
+
+    if (s_catalogEntryCount + 1 > s_catalogHashBucketCount) {
+        newBucketCount = s_catalogHashBucketCount == 0 ? MEDIA_CATALOG_HASH_BUCKET_INIT_NUM
+                                                       : s_catalogHashBucketCount * 2;
+        newBuckets = calloc(newBucketCount, sizeof(T_ZiyanMediaCatalogEntry *));
+        if (newBuckets == NULL) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+
+        for (i = 0; i < s_catalogEntryCount; i++) {
+            node = s_catalogEntries[i];
+            bucket = ZiyanMediaCatalog_Hash(node->fileName) & (newBucketCount - 1);
+            node->hashNext = newBuckets[bucket];
+            newBuckets[bucket] = node;
+        }
+
+        free(s_catalogHashBuckets);
+        s_catalogHashBuckets = newBuckets;
+        s_catalogHashBucketCount = newBucketCount;
+    }
+
+    bucket = ZiyanMediaCatalog_Hash(entry->fileName) & (s_catalogHashBucketCount - 1);
+    entry->hashNext = s_catalogHashBuckets[bucket];
+    s_catalogHashBuckets[bucket] = entry;
+
+    entry->listIndex = s_catalogEntryCount;
+    s_catalogEntries[s_catalogEntryCount++] = entry;
+    s_isCatalogDirty = true;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void ZiyanMediaCatalog_Remove(T_ZiyanMediaCatalogEntry *entry)
+{
+    T_ZiyanMediaCatalogEntry **node;
+    T_ZiyanMediaCatalogEntry *lastEntry;
+
+    node = &s_catalogHashBuckets[ZiyanMediaCatalog_Hash(entry->fileName) & (s_catalogHashBucketCount - 1)];
+    while (*node != NULL && *node != entry) {
+        node = &(*node)->hashNext;
+    }
+    if (*node != NULL) {
+        *node = entry->hashNext;
+    }
+
+    // The list is only iterated, so the last entry simply takes the place of the removed one.
+    if (entry->listIndex < s_catalogEntryCount && s_catalogEntries[entry->listIndex] == entry) {
+        lastEntry = s_catalogEntries[--s_catalogEntryCount];
+        s_catalogEntries[entry->listIndex] = lastEntry;
+        lastEntry->listIndex = entry->listIndex;
+    }
+    s_isCatalogDirty = true;
+}
+
+static void ZiyanMediaCatalog_Update(const char *fileName)
+{
+    T_ZiyanMediaCatalogEntry *entry = ZiyanMediaCatalog_Find(fileName);
+    T_ZiyanMediaFileHandle mediaFileHandle;
+    char filePath[ZIYAN_FILE_PATH_SIZE_MAX + ZIYAN_FILE_NAME_SIZE_MAX];
+    struct stat st;
+
+    if (strlen(fileName) >= ZIYAN_FILE_NAME_SIZE_MAX) {
+        return;
+    }
+
+    snprintf(filePath, sizeof(filePath), "%s/%s", s_catalogDirPath, fileName);
+    if (fstatat(s_catalogDirFd, fileName, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISREG(st.st_mode) ||
+        !ZiyanMediaFile_IsSupported(filePath)) {
+        if (entry != NULL) {
+            ZiyanMediaCatalog_Remove(entry);
+            free(entry);
+        }
+        return;
+    }
+
+    if (entry != NULL) {
+        entry->isSeen = true;
+        if (entry->fileSize == (uint64_t) st.st_size && entry->captureTimeSec == st.st_mtim.tv_sec) {
+            return;
+        }
+
+        ZiyanMediaCatalog_Remove(entry);
+        entry->isAttrValid = false;
+        entry->previewState = 0;
+    } else {
+        if (ZiyanMediaFile_CreateHandle(filePath, &mediaFileHandle) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            return;
+        }
+
+        entry = calloc(1, sizeof(T_ZiyanMediaCatalogEntry));
+        if (entry == NULL) {
+            ZiyanMediaFile_DestroyHandle(mediaFileHandle);
+            return;
+        }
+
+        strcpy(entry->fileName, fileName);
+        ZiyanMediaFile_GetMediaFileType(mediaFileHandle, &entry->type);
+        ZiyanMediaFile_DestroyHandle(mediaFileHandle);
+        entry->isSeen = true;
+    }
+
+    entry->fileSize = (uint64_t) st.st_size;
+    entry->captureTimeSec = st.st_mtim.tv_sec;
+    if (ZiyanMediaCatalog_Insert(entry) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        free(entry);
+    }
+}
+
+static void ZiyanMediaCatalog_Scan(void)
+{
+    T_ZiyanMediaCatalogEntry *entry;
+    struct dirent *dirent;
+    DIR *dir;
+    uint32_t i;
+    int fd;
+
+    for (i = 0; i < s_catalogEntryCount; i++) {
+        s_catalogEntries[i]->isSeen = false;
+    }
+
+    fd = openat(s_catalogDirFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (dir == NULL) {
+        USER_LOG_ERROR("Scan media catalog dir %s error, errno:%d.", s_catalogDirPath, errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    while ((dirent = readdir(dir)) != NULL) {
+        if (dirent->d_type == DT_DIR) {
+            continue;
+        }
+        ZiyanMediaCatalog_Update(dirent->d_name);
+    }
+    closedir(dir);
+
+    for (i = s_catalogEntryCount; i > 0; i--) {
+        entry = s_catalogEntries[i - 1];
+        if (!entry->isSeen) {
+            ZiyanMediaCatalog_Remove(entry);
+            free(entry);
+        }
+    }
+}
+
+static void ZiyanMediaCatalog_Clear(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < s_catalogEntryCount; i++) {
+        free(s_catalogEntries[i]);
+    }
+
+    free(s_catalogEntries);
+    free(s_catalogHashBuckets);
+    s_catalogEntries = NULL;
+    s_catalogHashBuckets = NULL;
+    s_catalogEntryCount = 0;
+    s_catalogEntryCapacity = 0;
+    s_catalogHashBucketCount = 0;
+    s_isCatalogDirty = false;
+}
+
+static const char *ZiyanMediaCatalog_GetFileName(const char *filePath)
+{
+    const char *separator = strrchr(filePath, '/');
+    size_t dirLen;
+    size_t catalogDirLen = ZiyanMediaCatalog_GetDirPathLen(s_catalogDirPath);
+
+    if (separator == NULL) {
+        return NULL;
+    }
+
+    dirLen = (size_t) (separator - filePath);
+    if (dirLen != catalogDirLen || strncmp(filePath, s_catalogDirPath, dirLen) != 0) {
+        return NULL;
+    }
+
+    return separator + 1;
+}
+
+static size_t ZiyanMediaCatalog_GetDirPathLen(const char *dirPath)
+{
+    size_t dirLen = strlen(dirPath);
+
+    while (dirLen > 1 && dirPath[dirLen - 1] == '/') {
+        dirLen--;
+    }
+
+    return dirLen;
+}
+
+/**
+ * @note Directory list provider of Osal_DirOpen(). Files are listed by capture time, and only once written completely,
+ * as the catalog follows close events.
+ */
+static T_ZiyanReturnCode ZiyanMediaCatalog_ListDir(const char *dirPath, T_OsalDirList **dirList)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanMediaCatalogEntry **sortedEntries = NULL;
+    const T_ZiyanMediaCatalogEntry *entry;
+    T_OsalDirEntry *dirEntry;
+    T_OsalDirList *list = NULL;
+    T_ZiyanReturnCode returnCode;
+    size_t dirLen = ZiyanMediaCatalog_GetDirPathLen(dirPath);
+    uint32_t nameSize = 0;
+    uint32_t nameOffset = 0;
+    uint32_t i;
+
+    if (s_catalogMutex == NULL || dirLen != ZiyanMediaCatalog_GetDirPathLen(s_catalogDirPath) ||
+        strncmp(dirPath, s_catalogDirPath, dirLen) != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    osalHandler->MutexLock(s_catalogMutex);
+
+    // A catalog that lost track of the directory lists it from the disk until the rescan is done.
+    if (s_isCatalogRescanNeeded) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+        goto out;
+    }
+
+    if (s_catalogEntryCount != 0) {
+        sortedEntries = malloc(s_catalogEntryCount * sizeof(T_ZiyanMediaCatalogEntry *));
+        if (sortedEntries == NULL) {
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+            goto out;
+        }
+        memcpy(sortedEntries, s_catalogEntries, s_catalogEntryCount * sizeof(T_ZiyanMediaCatalogEntry *));
+        qsort(sortedEntries, s_catalogEntryCount, sizeof(T_ZiyanMediaCatalogEntry *),
+              ZiyanMediaCatalog_CompareCaptureTime);
+    }
+
+    for (i = 0; i < s_catalogEntryCount; i++) {
+        nameSize += strlen(s_catalogEntries[i]->fileName) + 1;
+    }
+
+    returnCode = Osal_DirListAlloc(s_catalogEntryCount, nameSize, &list);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+        goto out;
+    }
+
+    for (i = 0; i < s_catalogEntryCount; i++) {
+        entry = sortedEntries[i];
+        dirEntry = &list->entries[i];
+        memset(dirEntry, 0, sizeof(T_OsalDirEntry));
+        dirEntry->size = entry->fileSize;
+        dirEntry->modifyTimeSec = entry->captureTimeSec;
+        dirEntry->nameOffset = nameOffset;
+        dirEntry->nameLen = (uint16_t) strlen(entry->fileName);
+        dirEntry->isStatValid = true;
+        memcpy(&list->names[nameOffset], entry->fileName, dirEntry->nameLen + 1);
+        nameOffset += dirEntry->nameLen + 1;
+    }
+
+    *dirList = list;
+
+out:
+    osalHandler->MutexUnlock(s_catalogMutex);
+    free(sortedEntries);
+
+    return returnCode;
+}
+
+static int ZiyanMediaCatalog_CompareCaptureTime(const void *a, const void *b)
+{
+    const T_ZiyanMediaCatalogEntry *entryA = *(const T_ZiyanMediaCatalogEntry *const *) a;
+    const T_ZiyanMediaCatalogEntry *entryB = *(const T_ZiyanMediaCatalogEntry *const *) b;
+
+    if (entryA->captureTimeSec != entryB->captureTimeSec) {
+        return entryA->captureTimeSec < entryB->captureTimeSec ? -1 : 1;
+    }
+
+    return strcmp(entryA->fileName, entryB->fileName);
+}
+
+static void ZiyanMediaCatalog_Load(void)
+{
+    T_ZiyanMediaCatalogPersistHeader header;
+    T_ZiyanMediaCatalogPersistRecord record;
+    T_ZiyanMediaCatalogEntry *entry;
+    uint32_t i;
+    FILE *file;
+
+    if (s_catalogPersistPath[0] == '\0') {
+        return;
+    }
+
+    file = fopen(s_catalogPersistPath, "rb");
+    if (file == NULL) {
+        return;
+    }
+
+    if (fread(&header, 1, sizeof(header), file) != sizeof(header) || header.magic != MEDIA_CATALOG_PERSIST_MAGIC ||
+        header.version != MEDIA_CATALOG_PERSIST_VERSION || header.recordSize != sizeof(record)) {
+        USER_LOG_WARN("Ignore incompatible media catalog %s.", s_catalogPersistPath);
+        goto out;
+    }
+
+    for (i = 0; i < header.recordCount; i++) {
+        if (fread(&record, 1, sizeof(record), file) != sizeof(record)) {
+            break;
+        }
+
+        record.fileName[sizeof(record.fileName) - 1] = '\0';
+        if (ZiyanMediaCatalog_Find(record.fileName) != NULL) {
+            continue;
+        }
+
+        entry = calloc(1, sizeof(T_ZiyanMediaCatalogEntry));
+        if (entry == NULL) {
+            break;
+        }
+
+        strcpy(entry->fileName, record.fileName);
+        entry->fileSize = record.fileSize;
+        entry->captureTimeSec = record.captureTimeSec;
+        entry->type = (E_ZiyanCameraMediaFileType) record.type;
+        entry->isAttrValid = record.isAttrValid != 0;
+        entry->attr.attrVideoDuration = record.attrVideoDuration;
+        entry->attr.attrVideoFrameRate = record.attrVideoFrameRate;
+        entry->attr.attrVideoResolution = record.attrVideoResolution;
+        entry->previewState = record.previewState;
+        if (ZiyanMediaCatalog_Insert(entry) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            free(entry);
+            break;
+        }
+    }
+
+out:
+    fclose(file);
+}
+
+static T_ZiyanReturnCode ZiyanMediaCatalog_Persist(void)
+{
+    T_ZiyanMediaCatalogPersistHeader header = {0};
+    T_ZiyanMediaCatalogPersistRecord record;
+    const T_ZiyanMediaCatalogEntry *entry;
+    char tempPath[ZIYAN_FILE_PATH_SIZE_MAX + 8];
+    bool isWriteFailed = false;
+    uint32_t i;
+    FILE *file;
+
+    if (s_catalogPersistPath[0] == '\0') {
+        s_isCatalogDirty = false;
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", s_catalogPersistPath);
+    file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        USER_LOG_ERROR("Open media catalog %s error, errno:%d.", tempPath, errno);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    header.magic = MEDIA_CATALOG_PERSIST_MAGIC;
+    header.version = MEDIA_CATALOG_PERSIST_VERSION;
+    header.recordSize = sizeof(record);
+    header.recordCount = s_catalogEntryCount;
+    isWriteFailed |= fwrite(&header, 1, sizeof(header), file) != sizeof(header);
+
+    for (i = 0; i < s_catalogEntryCount && !isWriteFailed; i++) {
+        entry = s_catalogEntries[i];
+        memset(&record, 0, sizeof(record));
+        strcpy(record.fileName, entry->fileName);
+        record.fileSize = entry->fileSize;
+        record.captureTimeSec = entry->captureTimeSec;
+        record.type = (uint8_t) entry->type;
+        record.isAttrValid = entry->isAttrValid;
+        record.attrVideoDuration = entry->attr.attrVideoDuration;
+        record.attrVideoFrameRate = entry->attr.attrVideoFrameRate;
+        record.attrVideoResolution = entry->attr.attrVideoResolution;
+        record.previewState = entry->previewState;
+        isWriteFailed |= fwrite(&record, 1, sizeof(record), file) != sizeof(record);
+    }
+
+    // Replace the old catalog atomically, a power cut leaves either the old or the new one.
+    isWriteFailed |= fflush(file) != 0 || fsync(fileno(file)) != 0;
+    isWriteFailed |= fclose(file) != 0;
+    if (isWriteFailed || rename(tempPath, s_catalogPersistPath) != 0) {
+        USER_LOG_ERROR("Persist media catalog %s error.", s_catalogPersistPath);
+        unlink(tempPath);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    s_isCatalogDirty = false;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,75 @@
+/**
+ ********************************************************************
+ * @file    ziyan_media_catalog.h
+ * @brief   This is the header file for "ziyan_media_catalog.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ZIYAN_MEDIA_CATALOG_H
+#define ZIYAN_MEDIA_CATALOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <ziyan_typedef.h>
+#include <ziyan_payload_camera.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define ZIYAN_MEDIA_CATALOG_PREVIEW_THUMBNAIL      (1 << 0)
+#define ZIYAN_MEDIA_CATALOG_PREVIEW_SCREENNAIL     (1 << 1)
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Build the media catalog of a directory and keep it up to date from inotify events.
+ * @note The catalog is loaded from persistFilePath first, so that attributes of unchanged files are reused on a warm
+ * start, then reconciled with the directory content. While it runs, Osal_DirOpen() lists the directory from the
+ * catalog, sorted by capture time, so listing the media files does not scan the card.
+ * @param dirPath: media file directory.
+ * @param persistFilePath: file used to persist the catalog, NULL to disable persistence.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode ZiyanMediaCatalog_Init(const char *dirPath, const char *persistFilePath);
+T_ZiyanReturnCode ZiyanMediaCatalog_DeInit(void);
+
+/**
+ * @brief Get media file info from the catalog. Attributes are computed on first use and cached until the file
+ * changes.
+ * @return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND when the file is not part of the catalog.
+ */
+T_ZiyanReturnCode ZiyanMediaCatalog_GetFileInfo(const char *filePath, T_ZiyanCameraMediaFileInfo *fileInfo);
+
+/**
+ * @brief Mark previews of a media file as generated. Preview state is reset when the file changes.
+ * @param previewState: bit mask of ZIYAN_MEDIA_CATALOG_PREVIEW_XXX.
+ */
+T_ZiyanReturnCode ZiyanMediaCatalog_SetPreviewState(const char *filePath, uint8_t previewState);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZIYAN_MEDIA_CATALOG_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
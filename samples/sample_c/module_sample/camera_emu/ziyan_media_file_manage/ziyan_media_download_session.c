@@ -0,0 +1,839 @@
+/**
+ ********************************************************************
+ * @file    ziyan_media_download_session.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <ziyan_logger.h>
+#include <utils/util_misc.h>
+#include <osal/osal_aio.h>
+
+#include "ziyan_media_download_session.h"
+#include "ziyan_media_file_core.h"
+#include "ziyan_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define MEDIA_DOWNLOAD_SEQUENTIAL_THRESHOLD     2
+#define MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE      (512 * 1024)
+#define MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM       2
+#define MEDIA_DOWNLOAD_DIRECT_BUFFER_INDEX      MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM // follows the prefetch blocks
+#define MEDIA_DOWNLOAD_BUFFER_NUM               (MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM + 1)
+#define MEDIA_DOWNLOAD_AIO_QUEUE_DEPTH          MEDIA_DOWNLOAD_BUFFER_NUM
+#define MEDIA_DOWNLOAD_AIO_WAIT_STEP_MS         1000
+#define MEDIA_DOWNLOAD_READ_TIMEOUT_MS          5000
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    MEDIA_DOWNLOAD_PREFETCH_BLOCK_EMPTY = 0,
+    MEDIA_DOWNLOAD_PREFETCH_BLOCK_IN_FLIGHT,
+    MEDIA_DOWNLOAD_PREFETCH_BLOCK_READY,
+} E_ZiyanMediaDownloadPrefetchBlockState;
+
+typedef struct {
+    bool isDone;
+    int32_t result;
+} T_ZiyanMediaDownloadRequest;
+
+typedef struct {
+    E_ZiyanMediaDownloadPrefetchBlockState state;
+    uint64_t blockNum; /*!< Offset of the block in the file divided by MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE. */
+    uint32_t validLen; /*!< Less than the block size only for the last block of the file. */
+    T_ZiyanMediaDownloadRequest request;
+} T_ZiyanMediaDownloadPrefetchBlock;
+
+typedef struct {
+    bool isUsed;
+    bool isClosePending;
+    bool isDetached; /*!< Closed, the slot is released once the reads in flight have landed. */
+    bool isDraining; /*!< A thread waits for the reads in flight of the detached session without the table lock. */
+    int fd;
+    uint32_t refCount;
+    char filePath[ZIYAN_FILE_PATH_SIZE_MAX];
+    uint64_t fileSize;
+    T_ZiyanMutexHandle readMutex; /*!< Serializes the reads of the session, an aio engine has a single owner. */
+    T_OsalAioHandle aio;
+    uint8_t *buffer; /*!< The prefetch blocks, then the direct read buffer. */
+    T_ZiyanMediaDownloadPrefetchBlock prefetchBlock[MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM];
+    T_ZiyanMediaDownloadRequest directRequest;
+    bool isDirectReadInFlight; /*!< A timed out direct read still owns the direct read buffer. */
+    uint64_t nextOffset;
+    uint32_t sequentialRun;
+    uint32_t openTimeMs;
+    uint32_t lastAccessTimeMs;
+    uint64_t bytesServed;
+    uint32_t readCount;
+    uint32_t sequentialReadCount;
+} T_ZiyanMediaDownloadSession;
+
+/* Private functions declaration ---------------------------------------------*/
+static T_ZiyanMediaDownloadSession *ZiyanMediaDownload_FindSession(const char *filePath);
+static T_ZiyanReturnCode ZiyanMediaDownload_OpenSession(const char *filePath, T_ZiyanMediaDownloadSession **session);
+static void ZiyanMediaDownload_DetachSession(T_ZiyanMediaDownloadSession *session);
+static bool ZiyanMediaDownload_DrainSession(T_ZiyanMediaDownloadSession *session, uint32_t timeoutMs);
+static void ZiyanMediaDownload_FreeSession(T_ZiyanMediaDownloadSession *session);
+static void ZiyanMediaDownload_ReleaseDetachedSessions(uint32_t timeoutMs);
+static bool ZiyanMediaDownload_CloseIdleSessionsLocked(uint32_t nowMs, uint32_t idleTimeoutMs);
+static T_ZiyanReturnCode ZiyanMediaDownload_ReadSession(T_ZiyanMediaDownloadSession *session, uint64_t offset,
+                                                        uint32_t len, uint8_t *data, uint32_t *realLen);
+static T_ZiyanReturnCode ZiyanMediaDownload_WaitRequest(T_ZiyanMediaDownloadSession *session,
+                                                        const T_ZiyanMediaDownloadRequest *request,
+                                                        uint32_t timeoutMs);
+static void ZiyanMediaDownload_Prefetch(T_ZiyanMediaDownloadSession *session, uint64_t blockNum);
+static void ZiyanMediaDownload_UpdatePrefetchBlocks(T_ZiyanMediaDownloadSession *session);
+static void ZiyanMediaDownload_FillStatistics(const T_ZiyanMediaDownloadSession *session,
+                                              T_ZiyanMediaDownloadSessionStatistics *statistics);
+
+/* Private values ------------------------------------------------------------*/
+static T_ZiyanMediaDownloadSession s_downloadSession[ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM];
+static T_ZiyanMutexHandle s_downloadSessionMutex = NULL;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode ZiyanMediaDownload_Init(void)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    uint8_t i;
+
+    if (s_downloadSessionMutex != NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    if (osalHandler->MutexCreate(&s_downloadSessionMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex create error");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    memset(s_downloadSession, 0, sizeof(s_downloadSession));
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        s_downloadSession[i].fd = -1;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaDownload_DeInit(void)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    uint8_t i;
+
+    if (s_downloadSessionMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        if (s_downloadSession[i].isUsed && !s_downloadSession[i].isDetached) {
+            ZiyanMediaDownload_DetachSession(&s_downloadSession[i]);
+        }
+    }
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+
+    ZiyanMediaDownload_ReleaseDetachedSessions(MEDIA_DOWNLOAD_READ_TIMEOUT_MS);
+
+    // A session whose reads never landed keeps its buffers, they may still be written.
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        if (s_downloadSession[i].isUsed) {
+            USER_LOG_ERROR("Media download session %s still has reads in flight, its buffers are leaked.",
+                           s_downloadSession[i].filePath);
+        }
+    }
+
+    osalHandler->MutexDestroy(s_downloadSessionMutex);
+    s_downloadSessionMutex = NULL;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaDownload_StartNotify(void)
+{
+    if (s_downloadSessionMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaDownload_StopNotify(void)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    uint8_t i;
+
+    if (s_downloadSessionMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        if (!s_downloadSession[i].isUsed || s_downloadSession[i].isDetached) {
+            continue;
+        }
+
+        if (s_downloadSession[i].refCount == 0) {
+            ZiyanMediaDownload_DetachSession(&s_downloadSession[i]);
+        } else {
+            s_downloadSession[i].isClosePending = true;
+        }
+    }
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+
+    ZiyanMediaDownload_ReleaseDetachedSessions(MEDIA_DOWNLOAD_READ_TIMEOUT_MS);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaDownload_ReadData(const char *filePath, uint64_t offset, uint32_t len, uint8_t *data,
+                                              uint32_t *realLen)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanMediaDownloadSession *session = NULL;
+    T_ZiyanReturnCode returnCode;
+    uint32_t nowMs = 0;
+    uint32_t readLen = 0;
+    uint64_t blockNum;
+    bool isSequential;
+    bool isReleaseNeeded;
+
+    if (filePath == NULL || data == NULL || realLen == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_downloadSessionMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    osalHandler->GetTimeMs(&nowMs);
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    isReleaseNeeded = ZiyanMediaDownload_CloseIdleSessionsLocked(nowMs, ZIYAN_MEDIA_DOWNLOAD_SESSION_IDLE_TIMEOUT_MS);
+
+    session = ZiyanMediaDownload_FindSession(filePath);
+    if (session == NULL) {
+        returnCode = ZiyanMediaDownload_OpenSession(filePath, &session);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            osalHandler->MutexUnlock(s_downloadSessionMutex);
+            if (isReleaseNeeded) {
+                ZiyanMediaDownload_ReleaseDetachedSessions(0);
+            }
+            return returnCode;
+        }
+    }
+    session->refCount++;
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+
+    // The session stays open while the reference is held, so the read itself only needs the session read lock.
+    osalHandler->MutexLock(session->readMutex);
+    returnCode = ZiyanMediaDownload_ReadSession(session, offset, len, data, &readLen);
+
+    isSequential = offset == session->nextOffset;
+    if (isSequential) {
+        session->sequentialRun++;
+    } else {
+        session->sequentialRun = 0;
+    }
+    session->nextOffset = offset + readLen;
+
+    // Keep the block being read and the next one in flight, the next read is then served from memory.
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS &&
+        session->sequentialRun >= MEDIA_DOWNLOAD_SEQUENTIAL_THRESHOLD) {
+        blockNum = session->nextOffset / MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE;
+        ZiyanMediaDownload_Prefetch(session, blockNum);
+        ZiyanMediaDownload_Prefetch(session, blockNum + 1);
+    }
+    osalHandler->MutexUnlock(session->readMutex);
+
+    osalHandler->GetTimeMs(&nowMs);
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    session->lastAccessTimeMs = nowMs;
+    session->readCount++;
+    session->bytesServed += readLen;
+    if (isSequential) {
+        session->sequentialReadCount++;
+    }
+
+    // A storage that does not answer in time leaves reads in flight, the next read of the file opens a new session.
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT) {
+        session->isClosePending = true;
+    }
+
+    session->refCount--;
+    if (session->isClosePending && session->refCount == 0) {
+        ZiyanMediaDownload_DetachSession(session);
+        isReleaseNeeded = true;
+    }
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+
+    // Reads in flight of closed sessions are only polled here, the camera media task retries the stuck ones.
+    if (isReleaseNeeded) {
+        ZiyanMediaDownload_ReleaseDetachedSessions(0);
+    }
+
+    *realLen = readLen;
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS || (readLen == 0 && len != 0)) {
+        USER_LOG_ERROR("Read media file %s at offset %llu error.", filePath, offset);
+        return returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT ? returnCode :
+               ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaDownload_CloseIdleSessions(uint32_t idleTimeoutMs)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    uint32_t nowMs = 0;
+
+    if (s_downloadSessionMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    osalHandler->GetTimeMs(&nowMs);
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    ZiyanMediaDownload_CloseIdleSessionsLocked(nowMs, idleTimeoutMs);
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+
+    ZiyanMediaDownload_ReleaseDetachedSessions(0);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanMediaDownload_GetSessionStatistics(T_ZiyanMediaDownloadSessionStatistics *statistics,
+                                                          uint8_t statisticsCount, uint8_t *sessionCount)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    uint8_t count = 0;
+    uint8_t i;
+
+    if (statistics == NULL || sessionCount == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_downloadSessionMutex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM && count < statisticsCount; i++) {
+        if (s_downloadSession[i].isUsed && !s_downloadSession[i].isDetached) {
+            ZiyanMediaDownload_FillStatistics(&s_downloadSession[i], &statistics[count++]);
+        }
+    }
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+
+    *sessionCount = count;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_ZiyanMediaDownloadSession *ZiyanMediaDownload_FindSession(const char *filePath)
+{
+    uint8_t i;
+
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        if (s_downloadSession[i].isUsed && !s_downloadSession[i].isClosePending &&
+            !s_downloadSession[i].isDetached && strcmp(s_downloadSession[i].filePath, filePath) == 0) {
+            return &s_downloadSession[i];
+        }
+    }
+
+    return NULL;
+}
+
+static T_ZiyanReturnCode ZiyanMediaDownload_OpenSession(const char *filePath, T_ZiyanMediaDownloadSession **session)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanMediaDownloadSession *freeSession = NULL;
+    T_ZiyanMediaDownloadSession *oldestIdleSession = NULL;
+    T_OsalAioBuffer aioBuffer[MEDIA_DOWNLOAD_BUFFER_NUM];
+    T_ZiyanReturnCode returnCode;
+    struct stat fileStat;
+    uint8_t i;
+    int fd;
+
+    if (strlen(filePath) >= ZIYAN_FILE_PATH_SIZE_MAX) {
+        USER_LOG_ERROR("Media file path out of length range error.");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (!ZiyanMediaFile_IsSupported(filePath)) {
+        USER_LOG_ERROR("Media file %s is not supported.", filePath);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT;
+    }
+
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        if (!s_downloadSession[i].isUsed) {
+            freeSession = &s_downloadSession[i];
+            break;
+        }
+
+        if (!s_downloadSession[i].isDetached && s_downloadSession[i].refCount == 0 &&
+            (oldestIdleSession == NULL ||
+             s_downloadSession[i].lastAccessTimeMs < oldestIdleSession->lastAccessTimeMs)) {
+            oldestIdleSession = &s_downloadSession[i];
+        }
+    }
+
+    // The table lock is held here, so the evicted session is only polled, one still reading is released later.
+    if (freeSession == NULL && oldestIdleSession != NULL) {
+        ZiyanMediaDownload_DetachSession(oldestIdleSession);
+        if (ZiyanMediaDownload_DrainSession(oldestIdleSession, 0)) {
+            ZiyanMediaDownload_FreeSession(oldestIdleSession);
+            freeSession = oldestIdleSession;
+        }
+    }
+
+    if (freeSession == NULL) {
+        USER_LOG_ERROR("Too many concurrent media download sessions.");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        USER_LOG_ERROR("Open media file %s error, errno:%d.", filePath, errno);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (fstat(fd, &fileStat) != 0) {
+        USER_LOG_ERROR("Stat media file %s error, errno:%d.", filePath, errno);
+        close(fd);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    memset(freeSession, 0, sizeof(T_ZiyanMediaDownloadSession));
+    freeSession->fd = fd;
+
+    returnCode = osalHandler->MutexCreate(&freeSession->readMutex);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Create media download session mutex error: 0x%08llX.", returnCode);
+        goto out;
+    }
+
+    returnCode = Osal_AioCreate(MEDIA_DOWNLOAD_AIO_QUEUE_DEPTH, &freeSession->aio);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Create media download aio engine error: 0x%08llX.", returnCode);
+        goto out;
+    }
+
+    // Reads only land in session buffers, so a read abandoned on a timeout never writes into a caller buffer. The
+    // buffers are registered once, io_uring then reads into them without pinning the pages per request.
+    freeSession->buffer = malloc((size_t) MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE * MEDIA_DOWNLOAD_BUFFER_NUM);
+    if (freeSession->buffer == NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    for (i = 0; i < MEDIA_DOWNLOAD_BUFFER_NUM; i++) {
+        aioBuffer[i].buf = freeSession->buffer + (size_t) i * MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE;
+        aioBuffer[i].len = MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE;
+    }
+
+    returnCode = Osal_AioRegisterBuffers(freeSession->aio, aioBuffer, MEDIA_DOWNLOAD_BUFFER_NUM);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Register media download buffers error: 0x%08llX.", returnCode);
+        goto out;
+    }
+
+    freeSession->isUsed = true;
+    freeSession->fileSize = (uint64_t) fileStat.st_size;
+    strcpy(freeSession->filePath, filePath);
+    osalHandler->GetTimeMs(&freeSession->openTimeMs);
+    freeSession->lastAccessTimeMs = freeSession->openTimeMs;
+
+    USER_LOG_DEBUG("Open media download session %s, size %llu.", filePath, freeSession->fileSize);
+
+    *session = freeSession;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    ZiyanMediaDownload_FreeSession(freeSession);
+
+    return returnCode;
+}
+
+/**
+ * @note Called with s_downloadSessionMutex held and no reference on the session. The session can no longer be found
+ * or read, its resources are freed by ZiyanMediaDownload_ReleaseDetachedSessions().
+ */
+static void ZiyanMediaDownload_DetachSession(T_ZiyanMediaDownloadSession *session)
+{
+    T_ZiyanMediaDownloadSessionStatistics statistics = {0};
+
+    ZiyanMediaDownload_FillStatistics(session, &statistics);
+
+    USER_LOG_INFO("Close media download session %s, %llu bytes in %d reads (%d sequential), %d ms, %.1f KB/s.",
+                  statistics.filePath, statistics.bytesServed, statistics.readCount,
+                  statistics.sequentialReadCount, statistics.durationMs, statistics.throughputKBps);
+
+    session->isDetached = true;
+}
+
+/**
+ * @brief Wait for the reads in flight of a detached session, which own its buffers until they land.
+ * @param timeoutMs: max time to wait for each read, 0 to only poll.
+ * @return Whether no read is left in flight.
+ */
+static bool ZiyanMediaDownload_DrainSession(T_ZiyanMediaDownloadSession *session, uint32_t timeoutMs)
+{
+    uint8_t i;
+
+    if (session->aio == NULL) {
+        return true;
+    }
+
+    for (i = 0; i < MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM; i++) {
+        if (session->prefetchBlock[i].state == MEDIA_DOWNLOAD_PREFETCH_BLOCK_IN_FLIGHT &&
+            ZiyanMediaDownload_WaitRequest(session, &session->prefetchBlock[i].request, timeoutMs) !=
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            return false;
+        }
+    }
+
+    if (session->isDirectReadInFlight) {
+        if (ZiyanMediaDownload_WaitRequest(session, &session->directRequest, timeoutMs) !=
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            return false;
+        }
+        session->isDirectReadInFlight = false;
+    }
+
+    return true;
+}
+
+/**
+ * @note Called with s_downloadSessionMutex held, or on a slot not in use yet, once no read is in flight.
+ */
+static void ZiyanMediaDownload_FreeSession(T_ZiyanMediaDownloadSession *session)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+
+    if (session->aio != NULL) {
+        Osal_AioDestroy(session->aio);
+    }
+    free(session->buffer);
+
+    if (session->readMutex != NULL) {
+        osalHandler->MutexDestroy(session->readMutex);
+    }
+
+    if (session->fd >= 0) {
+        posix_fadvise(session->fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(session->fd);
+    }
+
+    memset(session, 0, sizeof(T_ZiyanMediaDownloadSession));
+    session->fd = -1;
+}
+
+/**
+ * @brief Free the detached sessions whose reads have landed. The reads are waited for without the table lock, so the
+ * other sessions are not held up by a slow storage.
+ * @param timeoutMs: max time to wait for each read, 0 to only poll. Sessions still reading stay detached.
+ */
+static void ZiyanMediaDownload_ReleaseDetachedSessions(uint32_t timeoutMs)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanMediaDownloadSession *drainSession[ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM];
+    bool isDrained[ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM];
+    uint8_t drainCount = 0;
+    uint8_t i;
+
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        if (s_downloadSession[i].isDetached && !s_downloadSession[i].isDraining) {
+            s_downloadSession[i].isDraining = true;
+            drainSession[drainCount++] = &s_downloadSession[i];
+        }
+    }
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+
+    if (drainCount == 0) {
+        return;
+    }
+
+    for (i = 0; i < drainCount; i++) {
+        isDrained[i] = ZiyanMediaDownload_DrainSession(drainSession[i], timeoutMs);
+    }
+
+    osalHandler->MutexLock(s_downloadSessionMutex);
+    for (i = 0; i < drainCount; i++) {
+        if (isDrained[i]) {
+            ZiyanMediaDownload_FreeSession(drainSession[i]);
+        } else {
+            drainSession[i]->isDraining = false;
+        }
+    }
+    osalHandler->MutexUnlock(s_downloadSessionMutex);
+}
+
+/**
+ * @return Whether a session was detached.
+ */
+static bool ZiyanMediaDownload_CloseIdleSessionsLocked(uint32_t nowMs, uint32_t idleTimeoutMs)
+{
+    bool isDetached = false;
+    uint8_t i;
+
+    for (i = 0; i < ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM; i++) {
+        if (s_downloadSession[i].isUsed && !s_downloadSession[i].isDetached && s_downloadSession[i].refCount == 0 &&
+            nowMs - s_downloadSession[i].lastAccessTimeMs >= idleTimeoutMs) {
+            ZiyanMediaDownload_DetachSession(&s_downloadSession[i]);
+            isDetached = true;
+        }
+    }
+
+    return isDetached;
+}
+
+static T_ZiyanReturnCode ZiyanMediaDownload_ReadSession(T_ZiyanMediaDownloadSession *session, uint64_t offset,
+                                                        uint32_t len, uint8_t *data, uint32_t *realLen)
+{
+    T_ZiyanMediaDownloadPrefetchBlock *block;
+    T_OsalAioRequest aioRequest = {0};
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    uint8_t *directBuffer = session->buffer + (size_t) MEDIA_DOWNLOAD_DIRECT_BUFFER_INDEX *
+                                              MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE;
+    uint64_t position;
+    uint64_t blockNum;
+    uint32_t blockOffset;
+    uint32_t copyLen;
+    uint32_t readLen = 0;
+    uint32_t submitCount = 0;
+
+    // The direct read buffer is still owned by a read that timed out, the session is about to be closed.
+    if (session->isDirectReadInFlight) {
+        *realLen = 0;
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+    }
+
+    while (readLen < len) {
+        position = offset + readLen;
+        if (position >= session->fileSize) {
+            break;
+        }
+
+        blockNum = position / MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE;
+        block = &session->prefetchBlock[blockNum % MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM];
+        if (block->state == MEDIA_DOWNLOAD_PREFETCH_BLOCK_IN_FLIGHT && block->blockNum == blockNum) {
+            returnCode = ZiyanMediaDownload_WaitRequest(session, &block->request, MEDIA_DOWNLOAD_READ_TIMEOUT_MS);
+            if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+                break;
+            }
+        }
+
+        blockOffset = (uint32_t) (position - blockNum * MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE);
+        if (block->state == MEDIA_DOWNLOAD_PREFETCH_BLOCK_READY && block->blockNum == blockNum &&
+            blockOffset < block->validLen) {
+            copyLen = USER_UTIL_MIN(block->validLen - blockOffset, len - readLen);
+            memcpy(data + readLen, session->buffer +
+                                   (size_t) (block - session->prefetchBlock) * MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE +
+                                   blockOffset, copyLen);
+            readLen += copyLen;
+            continue;
+        }
+
+        // Not prefetched, read through the direct read buffer.
+        memset(&session->directRequest, 0, sizeof(session->directRequest));
+        aioRequest.type = OSAL_AIO_OP_READ;
+        aioRequest.fd = session->fd;
+        aioRequest.offset = position;
+        aioRequest.buf = directBuffer;
+        aioRequest.len = USER_UTIL_MIN(len - readLen, MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE);
+        aioRequest.bufIndex = MEDIA_DOWNLOAD_DIRECT_BUFFER_INDEX;
+        aioRequest.userData = &session->directRequest;
+
+        returnCode = Osal_AioPrepare(session->aio, &aioRequest);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            break;
+        }
+
+        // Once prepared the request is waited for even if this submit fails, the next wait submits it again.
+        session->isDirectReadInFlight = true;
+        (void) Osal_AioSubmit(session->aio, &submitCount);
+        returnCode = ZiyanMediaDownload_WaitRequest(session, &session->directRequest, MEDIA_DOWNLOAD_READ_TIMEOUT_MS);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            break;
+        }
+        session->isDirectReadInFlight = false;
+
+        if (session->directRequest.result < 0) {
+            USER_LOG_ERROR("Read media file %s error, errno:%d.", session->filePath, -session->directRequest.result);
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            break;
+        }
+        if (session->directRequest.result == 0) {
+            break;
+        }
+        memcpy(data + readLen, directBuffer, (uint32_t) session->directRequest.result);
+        readLen += (uint32_t) session->directRequest.result;
+    }
+
+    *realLen = readLen;
+
+    return returnCode;
+}
+
+/**
+ * @brief Wait for a submitted read, which owns its buffer until it completes.
+ * @param timeoutMs: max time to wait, 0 to only poll.
+ * @return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT when the read is still in flight.
+ */
+static T_ZiyanReturnCode ZiyanMediaDownload_WaitRequest(T_ZiyanMediaDownloadSession *session,
+                                                        const T_ZiyanMediaDownloadRequest *request,
+                                                        uint32_t timeoutMs)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_OsalAioCompletion completion[MEDIA_DOWNLOAD_AIO_QUEUE_DEPTH];
+    T_ZiyanMediaDownloadRequest *doneRequest;
+    T_ZiyanReturnCode returnCode;
+    uint32_t startTimeMs = 0;
+    uint32_t nowMs = 0;
+    uint32_t waitedMs = 0;
+    uint32_t waitMs;
+    uint32_t count = 0;
+    uint32_t i;
+
+    osalHandler->GetTimeMs(&startTimeMs);
+    while (!request->isDone) {
+        waitMs = USER_UTIL_MIN(timeoutMs - waitedMs, MEDIA_DOWNLOAD_AIO_WAIT_STEP_MS);
+        returnCode = Osal_AioReap(session->aio, completion, MEDIA_DOWNLOAD_AIO_QUEUE_DEPTH, waitMs == 0 ? 0 : 1,
+                                  waitMs, &count);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS &&
+            returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT) {
+            USER_LOG_ERROR("Reap media file %s read error: 0x%08llX.", session->filePath, returnCode);
+            return returnCode;
+        }
+
+        for (i = 0; i < count; i++) {
+            doneRequest = completion[i].userData;
+            doneRequest->result = completion[i].result;
+            doneRequest->isDone = true;
+        }
+        ZiyanMediaDownload_UpdatePrefetchBlocks(session);
+        if (request->isDone) {
+            break;
+        }
+
+        osalHandler->GetTimeMs(&nowMs);
+        waitedMs = nowMs - startTimeMs;
+        if (waitedMs >= timeoutMs) {
+            if (timeoutMs != 0) {
+                USER_LOG_ERROR("Media file %s read still in flight after %d ms.", session->filePath, waitedMs);
+            }
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+        }
+
+        // Another read of the session landed first, keep waiting for this one.
+        if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            continue;
+        }
+
+        USER_LOG_WARN("Media file %s read still in flight after %d ms.", session->filePath, waitedMs);
+        // A refused submit is handed over again.
+        (void) Osal_AioSubmit(session->aio, &count);
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void ZiyanMediaDownload_Prefetch(T_ZiyanMediaDownloadSession *session, uint64_t blockNum)
+{
+    uint8_t blockIndex = (uint8_t) (blockNum % MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM);
+    T_ZiyanMediaDownloadPrefetchBlock *block = &session->prefetchBlock[blockIndex];
+    T_OsalAioRequest aioRequest = {0};
+    uint64_t blockOffset = blockNum * MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE;
+    uint32_t submitCount = 0;
+
+    if (blockOffset >= session->fileSize) {
+        return;
+    }
+
+    if (block->state != MEDIA_DOWNLOAD_PREFETCH_BLOCK_EMPTY && block->blockNum == blockNum) {
+        return;
+    }
+
+    // The slot still holds an older block in flight, it is reused once that read lands.
+    if (block->state == MEDIA_DOWNLOAD_PREFETCH_BLOCK_IN_FLIGHT) {
+        return;
+    }
+
+    aioRequest.type = OSAL_AIO_OP_READ;
+    aioRequest.fd = session->fd;
+    aioRequest.offset = blockOffset;
+    aioRequest.buf = session->buffer + (size_t) blockIndex * MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE;
+    aioRequest.len = (uint32_t) USER_UTIL_MIN(session->fileSize - blockOffset, MEDIA_DOWNLOAD_PREFETCH_BLOCK_SIZE);
+    aioRequest.bufIndex = blockIndex;
+    aioRequest.userData = &block->request;
+
+    memset(&block->request, 0, sizeof(block->request));
+    if (Osal_AioPrepare(session->aio, &aioRequest) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        block->state = MEDIA_DOWNLOAD_PREFETCH_BLOCK_EMPTY;
+        return;
+    }
+
+    block->state = MEDIA_DOWNLOAD_PREFETCH_BLOCK_IN_FLIGHT;
+    block->blockNum = blockNum;
+    block->validLen = 0;
+
+    // A refused submit is retried by the next submit or wait of the session.
+    (void) Osal_AioSubmit(session->aio, &submitCount);
+}
+
+static void ZiyanMediaDownload_UpdatePrefetchBlocks(T_ZiyanMediaDownloadSession *session)
+{
+    T_ZiyanMediaDownloadPrefetchBlock *block;
+    uint8_t i;
+
+    for (i = 0; i < MEDIA_DOWNLOAD_PREFETCH_BLOCK_NUM; i++) {
+        block = &session->prefetchBlock[i];
+        if (block->state != MEDIA_DOWNLOAD_PREFETCH_BLOCK_IN_FLIGHT || !block->request.isDone) {
+            continue;
+        }
+
+        if (block->request.result < 0) {
+            block->state = MEDIA_DOWNLOAD_PREFETCH_BLOCK_EMPTY;
+        } else {
+            block->state = MEDIA_DOWNLOAD_PREFETCH_BLOCK_READY;
+            block->validLen = (uint32_t) block->request.result;
+        }
+    }
+}
+
+static void ZiyanMediaDownload_FillStatistics(const T_ZiyanMediaDownloadSession *session,
+                                              T_ZiyanMediaDownloadSessionStatistics *statistics)
+{
+    uint32_t activeMs = session->lastAccessTimeMs - session->openTimeMs;
+
+    strcpy(statistics->filePath, session->filePath);
+    statistics->fileSize = session->fileSize;
+    statistics->bytesServed = session->bytesServed;
+    statistics->readCount = session->readCount;
+    statistics->sequentialReadCount = session->sequentialReadCount;
+    statistics->durationMs = activeMs;
+    statistics->throughputKBps = activeMs == 0 ? 0 : (float) session->bytesServed / (float) activeMs * 1000 / 1024;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,92 @@
+/**
+ ********************************************************************
+ * @file    ziyan_media_download_session.h
+ * @brief   This is the header file for "ziyan_media_download_session.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef ZIYAN_MEDIA_DOWNLOAD_SESSION_H
+#define ZIYAN_MEDIA_DOWNLOAD_SESSION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <ziyan_typedef.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM            4
+#define ZIYAN_MEDIA_DOWNLOAD_SESSION_IDLE_TIMEOUT_MS    10000
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    char filePath[ZIYAN_FILE_PATH_SIZE_MAX];
+    uint64_t fileSize;
+    uint64_t bytesServed;
+    uint32_t readCount;
+    uint32_t sequentialReadCount;
+    uint32_t durationMs;
+    float throughputKBps;
+} T_ZiyanMediaDownloadSessionStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+T_ZiyanReturnCode ZiyanMediaDownload_Init(void);
+T_ZiyanReturnCode ZiyanMediaDownload_DeInit(void);
+
+/**
+ * @brief Start and stop notifications of the SDK download. The start notification does not name the files to
+ * download, so a session is opened on the first read of each file instead, and stays open until
+ * ZiyanMediaDownload_StopNotify() or until it has been idle for ZIYAN_MEDIA_DOWNLOAD_SESSION_IDLE_TIMEOUT_MS.
+ */
+T_ZiyanReturnCode ZiyanMediaDownload_StartNotify(void);
+T_ZiyanReturnCode ZiyanMediaDownload_StopNotify(void);
+
+/**
+ * @brief Read origin data of a media file through its download session.
+ * @note Several files can be downloaded concurrently, up to ZIYAN_MEDIA_DOWNLOAD_SESSION_MAX_NUM sessions.
+ * @param filePath: path of media file.
+ * @param offset: offset of the data in the file.
+ * @param len: length of data to read.
+ * @param data: pointer to buffer used to store data.
+ * @param realLen: length of data actually read, may be less than len at the end of file.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT when the storage did not answer in time.
+ */
+T_ZiyanReturnCode ZiyanMediaDownload_ReadData(const char *filePath, uint64_t offset, uint32_t len, uint8_t *data,
+                                              uint32_t *realLen);
+
+/**
+ * @brief Close the sessions not read for a while, called periodically by the camera media task so an abandoned
+ * download does not keep its file open.
+ * @param idleTimeoutMs: time since the last read after which a session is closed.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode ZiyanMediaDownload_CloseIdleSessions(uint32_t idleTimeoutMs);
+T_ZiyanReturnCode ZiyanMediaDownload_GetSessionStatistics(T_ZiyanMediaDownloadSessionStatistics *statistics,
+                                                          uint8_t statisticsCount, uint8_t *sessionCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZIYAN_MEDIA_DOWNLOAD_SESSION_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -25,6 +25,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include <string.h>
 #include <ziyan_logger.h>
+#include "utils/util_log.h"
 
 #include "ziyan_media_file_core.h"
 #include "ziyan_media_file_jpg.h"
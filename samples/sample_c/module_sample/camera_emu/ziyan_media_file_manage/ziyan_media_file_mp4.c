@@ -32,6 +32,7 @@
 #include <ziyan_logger.h>
 #include <stdlib.h>
 #include "ziyan_platform.h"
+#include "utils/util_log.h"
 #include "utils/util_time.h"
 #include "utils/util_file.h"
 
@@ -0,0 +1,304 @@
+/**
+ ********************************************************************
+ * @file    fc_subscription_cache.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <utils/util_log.h>
+#include <utils/util_metrics.h>
+#include <utils/util_misc.h>
+#include <utils/util_seqlock.h>
+#include "fc_subscription_cache.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define FC_SUBSCRIPTION_CACHE_LOG_PERIOD_MS         1000
+
+/* Topics stored in the cache with the structure of their values. */
+#define FC_SUBSCRIPTION_CACHE_TOPICS(TOPIC) \
+    TOPIC(QUATERNION, T_ZiyanFcSubscriptionQuaternion) \
+    TOPIC(ACCELERATION_GROUND, T_ZiyanFcSubscriptionAccelerationGround) \
+    TOPIC(ACCELERATION_BODY, T_ZiyanFcSubscriptionAccelerationBody) \
+    TOPIC(ACCELERATION_RAW, T_ZiyanFcSubscriptionAccelerationRaw) \
+    TOPIC(VELOCITY, T_ZiyanFcSubscriptionVelocity) \
+    TOPIC(ANGULAR_RATE_FUSIONED, T_ZiyanFcSubscriptionAngularRateFusioned) \
+    TOPIC(ANGULAR_RATE_RAW, T_ZiyanFcSubscriptionAngularRateRaw) \
+    TOPIC(ALTITUDE_FUSED, T_ZiyanFcSubscriptionAltitudeFused) \
+    TOPIC(ALTITUDE_BAROMETER, T_ZiyanFcSubscriptionAltitudeBarometer) \
+    TOPIC(ALTITUDE_OF_HOMEPOINT, T_ZiyanFcSubscriptionAltitudeOfHomePoint) \
+    TOPIC(HEIGHT_FUSION, T_ZiyanFcSubscriptionHeightFusion) \
+    TOPIC(HEIGHT_RELATIVE, T_ZiyanFcSubscriptionHeightRelative) \
+    TOPIC(POSITION_FUSED, T_ZiyanFcSubscriptionPositionFused) \
+    TOPIC(GPS_DATE, T_ZiyanFcSubscriptionGpsDate) \
+    TOPIC(GPS_TIME, T_ZiyanFcSubscriptionGpsTime) \
+    TOPIC(GPS_POSITION, T_ZiyanFcSubscriptionGpsPosition) \
+    TOPIC(GPS_VELOCITY, T_ZiyanFcSubscriptionGpsVelocity) \
+    TOPIC(GPS_DETAILS, T_ZiyanFcSubscriptionGpsDetails) \
+    TOPIC(GPS_SIGNAL_LEVEL, T_ZiyanFcSubscriptionGpsSignalLevel) \
+    TOPIC(RTK_POSITION, T_ZiyanFcSubscriptionRtkPosition) \
+    TOPIC(RTK_VELOCITY, T_ZiyanFcSubscriptionRtkVelocity) \
+    TOPIC(RTK_YAW, T_ZiyanFcSubscriptionRtkYaw) \
+    TOPIC(RTK_POSITION_INFO, T_ZiyanFcSubscriptionRtkPositionInfo) \
+    TOPIC(RTK_YAW_INFO, T_ZiyanFcSubscriptionRtkYawInfo) \
+    TOPIC(COMPASS, T_ZiyanFcSubscriptionCompass) \
+    TOPIC(RC, T_ZiyanFcSubscriptionRC) \
+    TOPIC(GIMBAL_ANGLES, T_ZiyanFcSubscriptionGimbalAngles) \
+    TOPIC(GIMBAL_STATUS, T_ZiyanFcSubscriptionGimbalStatus) \
+    TOPIC(STATUS_FLIGHT, T_ZiyanFcSubscriptionFlightStatus) \
+    TOPIC(STATUS_DISPLAYMODE, T_ZiyanFcSubscriptionDisplaymode) \
+    TOPIC(STATUS_LANDINGGEAR, T_ZiyanFcSubscriptionLandinggear) \
+    TOPIC(STATUS_MOTOR_START_ERROR, T_ZiyanFcSubscriptionMotorStartError) \
+    TOPIC(BATTERY_INFO, T_ZiyanFcSubscriptionWholeBatteryInfo) \
+    TOPIC(CONTROL_DEVICE, T_ZiyanFcSubscriptionControlDevice) \
+    TOPIC(HARD_SYNC, T_ZiyanFcSubscriptionHardSync) \
+    TOPIC(GPS_CONTROL_LEVEL, T_ZiyanFcSubscriptionGpsControlLevel) \
+    TOPIC(RC_WITH_FLAG_DATA, T_ZiyanFcSubscriptionRCWithFlagData) \
+    TOPIC(ESC_DATA, T_ZiyanFcSubscriptionEscData) \
+    TOPIC(RTK_CONNECT_STATUS, T_ZiyanFcSubscriptionRTKConnectStatus) \
+    TOPIC(GIMBAL_CONTROL_MODE, T_ZiyanFcSubscriptionGimbalControlMode) \
+    TOPIC(FLIGHT_ANOMALY, T_ZiyanFcSubscriptionFlightAnomaly) \
+    TOPIC(POSITION_VO, T_ZiyanFcSubscriptionPositionVO) \
+    TOPIC(AVOID_DATA, T_ZiyanFcSubscriptionAvoidData) \
+    TOPIC(HOME_POINT_SET_STATUS, T_ZiyanFcSubscriptionHomePointSetStatus) \
+    TOPIC(HOME_POINT_INFO, T_ZiyanFcSubscriptionHomePointInfo) \
+    TOPIC(THREE_GIMBAL_DATA, T_ZiyanFcSubscriptionThreeGimbalData) \
+    TOPIC(BATTERY_SINGLE_INFO_INDEX1, T_ZiyanFcSubscriptionSingleBatteryInfo) \
+    TOPIC(BATTERY_SINGLE_INFO_INDEX2, T_ZiyanFcSubscriptionSingleBatteryInfo) \
+    TOPIC(IMU_ATTI_NAVI_DATA_WITH_TIMESTAMP, T_ZiyanFcSubscriptionImuAttiNaviDataWithTimestamp)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    void *copies; /*!< UTIL_SEQLOCK_COPY_COUNT records, a timestamp followed by the value. */
+    uint16_t dataSize; /*!< Size of the structure of the topic. */
+    ZiyanReceiveDataOfTopicCallback callback;
+} T_FcSubscriptionCacheTopic;
+
+#define FC_SUBSCRIPTION_CACHE_VALUE_MEMBER(name, type) type name;
+typedef union {
+    FC_SUBSCRIPTION_CACHE_TOPICS(FC_SUBSCRIPTION_CACHE_VALUE_MEMBER)
+} U_FcSubscriptionCacheValue;
+
+/* Private functions declaration ---------------------------------------------*/
+#define FC_SUBSCRIPTION_CACHE_CALLBACK_DECLARATION(name, type) \
+    static T_ZiyanReturnCode FcSubscriptionCache_Receive_##name(const uint8_t *data, uint16_t dataSize, \
+                                                                const T_ZiyanDataTimestamp *timestamp);
+FC_SUBSCRIPTION_CACHE_TOPICS(FC_SUBSCRIPTION_CACHE_CALLBACK_DECLARATION)
+
+/* Private values ------------------------------------------------------------*/
+// Records are packed like the topic structures, so values follow timestamps without padding.
+#define FC_SUBSCRIPTION_CACHE_COPIES(name, type) \
+    static struct { \
+        T_ZiyanDataTimestamp timestamp; \
+        type data; \
+    } __attribute__((packed)) s_cacheCopies_##name[UTIL_SEQLOCK_COPY_COUNT];
+FC_SUBSCRIPTION_CACHE_TOPICS(FC_SUBSCRIPTION_CACHE_COPIES)
+
+#define FC_SUBSCRIPTION_CACHE_TOPIC(name, type) \
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_##name] = {s_cacheCopies_##name, sizeof(type), FcSubscriptionCache_Receive_##name},
+static const T_FcSubscriptionCacheTopic s_cacheTopics[ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER] = {
+    FC_SUBSCRIPTION_CACHE_TOPICS(FC_SUBSCRIPTION_CACHE_TOPIC)
+};
+
+static T_UtilSeqlock s_cacheSeqlocks[ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER];
+static const T_FcSubscriptionCacheSource s_sdkSource = {
+    ZiyanFcSubscription_SubscribeTopic,
+    ZiyanFcSubscription_UnSubscribeTopic,
+};
+static const T_FcSubscriptionCacheSource *s_cacheSource = &s_sdkSource;
+static FcSubscriptionCacheObserver s_cacheObservers[FC_SUBSCRIPTION_CACHE_OBSERVER_MAX] = {0};
+
+static T_UtilMetric s_cacheUpdateCount = UTIL_METRICS_COUNTER("ziyan_subscription_cache_updates_total",
+                                                              "Topic values stored in the subscription cache.");
+static T_UtilMetric s_cacheSizeMismatchCount = UTIL_METRICS_COUNTER("ziyan_subscription_cache_size_mismatches_total",
+                                                                    "Topic values not matching their structure size.");
+
+/* Exported functions definition ---------------------------------------------*/
+void FcSubscriptionCache_SetSource(const T_FcSubscriptionCacheSource *source)
+{
+    s_cacheSource = source != NULL ? source : &s_sdkSource;
+}
+
+T_ZiyanReturnCode FcSubscriptionCache_SubscribeTopic(E_ZiyanFcSubscriptionTopic topic,
+                                                     E_ZiyanDataSubscriptionTopicFreq frequency)
+{
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER || s_cacheTopics[topic].copies == NULL) {
+        USER_LOG_ERROR("Topic 0x%08X is not cached.", topic);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    return s_cacheSource->SubscribeTopic(topic, frequency, s_cacheTopics[topic].callback);
+}
+
+T_ZiyanReturnCode FcSubscriptionCache_UnSubscribeTopic(E_ZiyanFcSubscriptionTopic topic)
+{
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER || s_cacheTopics[topic].copies == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    return s_cacheSource->UnSubscribeTopic(topic);
+}
+
+T_ZiyanReturnCode FcSubscriptionCache_AddObserver(FcSubscriptionCacheObserver observer)
+{
+    FcSubscriptionCacheObserver expected;
+
+    if (observer == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    for (int i = 0; i < FC_SUBSCRIPTION_CACHE_OBSERVER_MAX; i++) {
+        expected = NULL;
+        if (__atomic_compare_exchange_n(&s_cacheObservers[i], &expected, observer, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
+    }
+
+    USER_LOG_ERROR("Subscription cache observers are all in use.");
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+}
+
+void FcSubscriptionCache_RemoveObserver(FcSubscriptionCacheObserver observer)
+{
+    FcSubscriptionCacheObserver expected;
+
+    for (int i = 0; i < FC_SUBSCRIPTION_CACHE_OBSERVER_MAX; i++) {
+        expected = observer;
+        __atomic_compare_exchange_n(&s_cacheObservers[i], &expected, NULL, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+}
+
+uint16_t FcSubscriptionCache_GetTopicSize(E_ZiyanFcSubscriptionTopic topic)
+{
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER) {
+        return 0;
+    }
+
+    return s_cacheTopics[topic].dataSize;
+}
+
+T_ZiyanReturnCode FcSubscriptionCache_Update(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                             const T_ZiyanDataTimestamp *timestamp)
+{
+    uint8_t record[sizeof(T_ZiyanDataTimestamp) + sizeof(U_FcSubscriptionCacheValue)];
+    const T_FcSubscriptionCacheTopic *cacheTopic;
+    FcSubscriptionCacheObserver observer;
+
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER || s_cacheTopics[topic].copies == NULL ||
+        data == NULL || timestamp == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+    cacheTopic = &s_cacheTopics[topic];
+
+    if (dataSize != cacheTopic->dataSize) {
+        USER_LOG_EVERY_MS(WARN, FC_SUBSCRIPTION_CACHE_LOG_PERIOD_MS,
+                          "Topic 0x%08X value size %d differs from its structure size %d.",
+                          topic, dataSize, cacheTopic->dataSize);
+        UtilMetrics_CounterAdd(&s_cacheSizeMismatchCount, 1);
+        memset(record + sizeof(T_ZiyanDataTimestamp), 0, cacheTopic->dataSize);
+    }
+
+    memcpy(record, timestamp, sizeof(T_ZiyanDataTimestamp));
+    memcpy(record + sizeof(T_ZiyanDataTimestamp), data, USER_UTIL_MIN(dataSize, cacheTopic->dataSize));
+    UtilSeqlock_Write(&s_cacheSeqlocks[topic], cacheTopic->copies, record,
+                      sizeof(T_ZiyanDataTimestamp) + cacheTopic->dataSize);
+    UtilMetrics_CounterAdd(&s_cacheUpdateCount, 1);
+
+    for (int i = 0; i < FC_SUBSCRIPTION_CACHE_OBSERVER_MAX; i++) {
+        observer = __atomic_load_n(&s_cacheObservers[i], __ATOMIC_ACQUIRE);
+        if (observer != NULL) {
+            observer(topic, record + sizeof(T_ZiyanDataTimestamp), cacheTopic->dataSize, timestamp);
+        }
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode FcSubscriptionCache_ReadBegin(E_ZiyanFcSubscriptionTopic topic, T_FcSubscriptionCacheView *view)
+{
+    const uint8_t *record;
+
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER || s_cacheTopics[topic].copies == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    record = UtilSeqlock_ReadBegin(&s_cacheSeqlocks[topic], s_cacheTopics[topic].copies,
+                                   sizeof(T_ZiyanDataTimestamp) + s_cacheTopics[topic].dataSize,
+                                   &view->lockSequence);
+    view->topic = topic;
+    view->timestamp = (const T_ZiyanDataTimestamp *) record;
+    view->data = record + sizeof(T_ZiyanDataTimestamp);
+    view->sequence = view->lockSequence / 2;
+    if (view->sequence == 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+bool FcSubscriptionCache_ReadRetry(const T_FcSubscriptionCacheView *view)
+{
+    return UtilSeqlock_ReadRetry(&s_cacheSeqlocks[view->topic], view->lockSequence);
+}
+
+T_ZiyanReturnCode FcSubscriptionCache_Read(E_ZiyanFcSubscriptionTopic topic, void *data, uint16_t dataSize,
+                                           T_ZiyanDataTimestamp *timestamp, uint32_t *sequence)
+{
+    T_ZiyanReturnCode returnCode;
+    T_FcSubscriptionCacheView view;
+
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER || s_cacheTopics[topic].copies == NULL ||
+        data == NULL || dataSize != s_cacheTopics[topic].dataSize) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    do {
+        returnCode = FcSubscriptionCache_ReadBegin(topic, &view);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            return returnCode;
+        }
+
+        memcpy(data, view.data, dataSize);
+        if (timestamp != NULL) {
+            memcpy(timestamp, view.timestamp, sizeof(T_ZiyanDataTimestamp));
+        }
+    } while (FcSubscriptionCache_ReadRetry(&view));
+
+    if (sequence != NULL) {
+        *sequence = view.sequence;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+#define FC_SUBSCRIPTION_CACHE_CALLBACK_DEFINITION(name, type) \
+    static T_ZiyanReturnCode FcSubscriptionCache_Receive_##name(const uint8_t *data, uint16_t dataSize, \
+                                                                const T_ZiyanDataTimestamp *timestamp) \
+    { \
+        return FcSubscriptionCache_Update(ZIYAN_FC_SUBSCRIPTION_TOPIC_##name, data, dataSize, timestamp); \
+    }
+FC_SUBSCRIPTION_CACHE_TOPICS(FC_SUBSCRIPTION_CACHE_CALLBACK_DEFINITION)
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,168 @@
+/**
+ ********************************************************************
+ * @file    fc_subscription_cache.h
+ * @brief   This is the header file for "fc_subscription_cache.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FC_SUBSCRIPTION_CACHE_H
+#define FC_SUBSCRIPTION_CACHE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "ziyan_fc_subscription.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define FC_SUBSCRIPTION_CACHE_OBSERVER_MAX      4
+
+/* Exported types ------------------------------------------------------------*/
+/**
+ * Latest value of a topic read in place, e.g.
+ * do {
+ *     if (FcSubscriptionCache_ReadBegin(ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY, &view) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+ *         break;
+ *     }
+ *     velocityZ = ((const T_ZiyanFcSubscriptionVelocity *) view.data)->data.z;
+ * } while (FcSubscriptionCache_ReadRetry(&view));
+ */
+typedef struct {
+    const void *data; /*!< Topic value, structure of the topic, e.g. T_ZiyanFcSubscriptionQuaternion. */
+    const T_ZiyanDataTimestamp *timestamp; /*!< Timestamp of the value given by the subscription. */
+    uint32_t sequence; /*!< Number of values of the topic received up to this one, starting at 1. */
+    uint32_t lockSequence; /*!< Checked by FcSubscriptionCache_ReadRetry(). */
+    E_ZiyanFcSubscriptionTopic topic;
+} T_FcSubscriptionCacheView;
+
+/**
+ * Called after a value is stored, with the value normalized to the structure of the topic.
+ */
+typedef void (*FcSubscriptionCacheObserver)(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data,
+                                            uint16_t dataSize, const T_ZiyanDataTimestamp *timestamp);
+
+/**
+ * Origin of the topic values, the SDK subscription by default. A replay of recorded topics can stand in for it, its
+ * functions are called like ZiyanFcSubscription_SubscribeTopic() and ZiyanFcSubscription_UnSubscribeTopic().
+ */
+typedef struct {
+    T_ZiyanReturnCode (*SubscribeTopic)(E_ZiyanFcSubscriptionTopic topic, E_ZiyanDataSubscriptionTopicFreq frequency,
+                                        ZiyanReceiveDataOfTopicCallback callback);
+    T_ZiyanReturnCode (*UnSubscribeTopic)(E_ZiyanFcSubscriptionTopic topic);
+} T_FcSubscriptionCacheSource;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Set the origin of the topic values, before any topic is subscribed.
+ * @param source: origin, NULL for the SDK subscription. The structure must outlive the cache.
+ */
+void FcSubscriptionCache_SetSource(const T_FcSubscriptionCacheSource *source);
+
+/**
+ * @brief Subscribe a topic with a callback storing its values in the cache. ZiyanFcSubscription_Init() has to be
+ * called before.
+ * @param topic: topic to subscribe.
+ * @param frequency: subscription frequency.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionCache_SubscribeTopic(E_ZiyanFcSubscriptionTopic topic,
+                                                     E_ZiyanDataSubscriptionTopicFreq frequency);
+
+/**
+ * @brief Unsubscribe a topic subscribed by FcSubscriptionCache_SubscribeTopic().
+ * @param topic: topic to unsubscribe.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionCache_UnSubscribeTopic(E_ZiyanFcSubscriptionTopic topic);
+
+/**
+ * @brief Add a function called in the subscription callbacks after each value is stored. Observers run on the
+ * subscription thread, so they must return quickly.
+ * @param observer: observer.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE when FC_SUBSCRIPTION_CACHE_OBSERVER_MAX
+ * observers are added.
+ */
+T_ZiyanReturnCode FcSubscriptionCache_AddObserver(FcSubscriptionCacheObserver observer);
+
+/**
+ * @brief Remove an observer added by FcSubscriptionCache_AddObserver(). A callback running at the time of the call
+ * may still call it once.
+ * @param observer: observer.
+ */
+void FcSubscriptionCache_RemoveObserver(FcSubscriptionCacheObserver observer);
+
+/**
+ * @brief Get the size of the structure of a topic.
+ * @return Size, 0 for topics not stored in the cache.
+ */
+uint16_t FcSubscriptionCache_GetTopicSize(E_ZiyanFcSubscriptionTopic topic);
+
+/**
+ * @brief Store a value in the cache, called from the subscription callback of modules subscribing a topic themselves.
+ * Values of one topic must be stored by one thread at a time, as subscription callbacks are called.
+ * @param topic: topic of the value.
+ * @param data: value received by the callback.
+ * @param dataSize: size of the value, missing bytes of shorter values are zeroed.
+ * @param timestamp: timestamp received by the callback.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionCache_Update(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                             const T_ZiyanDataTimestamp *timestamp);
+
+/**
+ * @brief Start reading the latest value of a topic in place, without calling the SDK. Lock-free, callable from any
+ * thread. The value may be overwritten while it is read, so only results of reads ended by
+ * FcSubscriptionCache_ReadRetry() returning false may be used, and no pointer into the value may be kept.
+ * @param topic: topic to read.
+ * @param view: latest value.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND until a value of the topic is received.
+ */
+T_ZiyanReturnCode FcSubscriptionCache_ReadBegin(E_ZiyanFcSubscriptionTopic topic, T_FcSubscriptionCacheView *view);
+
+/**
+ * @brief Finish reading a value in place.
+ * @param view: view given by FcSubscriptionCache_ReadBegin().
+ * @return Whether the value was overwritten during the read, which then has to be started again.
+ */
+bool FcSubscriptionCache_ReadRetry(const T_FcSubscriptionCacheView *view);
+
+/**
+ * @brief Copy the latest value of a topic, a replacement of ZiyanFcSubscription_GetLatestValueOfTopic() for topics
+ * stored in the cache. Lock-free, callable from any thread.
+ * @param topic: topic to read.
+ * @param data: value, must be the structure of the topic.
+ * @param dataSize: size of the structure of the topic.
+ * @param timestamp: timestamp of the value, can be NULL.
+ * @param sequence: number of values of the topic received up to this one, can be NULL.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND until a value of the topic is received.
+ */
+T_ZiyanReturnCode FcSubscriptionCache_Read(E_ZiyanFcSubscriptionTopic topic, void *data, uint16_t dataSize,
+                                           T_ZiyanDataTimestamp *timestamp, uint32_t *sequence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FC_SUBSCRIPTION_CACHE_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
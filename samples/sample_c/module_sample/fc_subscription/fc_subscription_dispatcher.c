@@ -0,0 +1,513 @@
+/**
+ ********************************************************************
+ * @file    fc_subscription_dispatcher.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include <utils/util_log.h>
+#include <utils/util_metrics.h>
+#include <utils/util_misc.h>
+#include <utils/util_trace.h>
+#include "fc_subscription_dispatcher.h"
+#include "fc_subscription_cache.h"
+#include "ziyan_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define FC_SUBSCRIPTION_DISPATCHER_TASK_STACK_SIZE      2048
+#define FC_SUBSCRIPTION_DISPATCHER_BATCH_MAX            8 /* Values delivered to a consumer before others get a turn. */
+#define FC_SUBSCRIPTION_DISPATCHER_REMOVE_POLL_MS       1
+#define FC_SUBSCRIPTION_DISPATCHER_LOG_PERIOD_MS        1000
+
+/* Private types -------------------------------------------------------------*/
+typedef struct tagT_FcSubscriptionDispatcherConsumer {
+    T_FcSubscriptionDispatcherConsumerConfig config;
+    uint16_t entrySize; /*!< Size of a queue entry, a timestamp followed by the value. */
+    uint32_t decimation; /*!< Subscription values per delivered value. */
+    uint32_t decimationCount; /*!< Subscription values to skip before the next delivery. */
+    uint8_t *queue;
+    uint16_t queueHead;
+    uint16_t queueDepth;
+    uint8_t *delivery; /*!< Entry passed to the callback, out of reach of the receive path. */
+    bool readyFlag; /*!< Waiting in the ready list. */
+    bool runningFlag; /*!< Delivered by a worker. */
+    bool removedFlag;
+    T_FcSubscriptionDispatcherConsumerStatistics statistics;
+    struct tagT_FcSubscriptionDispatcherConsumer *next; /*!< Next consumer of the topic. */
+    struct tagT_FcSubscriptionDispatcherConsumer *readyNext;
+} T_FcSubscriptionDispatcherConsumer;
+
+typedef struct {
+    E_ZiyanDataSubscriptionTopicFreq frequency; /*!< Frequency of the subscription, 0 when not subscribed. */
+    T_FcSubscriptionDispatcherConsumer *consumers;
+} T_FcSubscriptionDispatcherTopic;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *FcSubscriptionDispatcher_Task(void *arg);
+static void FcSubscriptionDispatcher_Receive(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data,
+                                             uint16_t dataSize, const T_ZiyanDataTimestamp *timestamp);
+static T_ZiyanReturnCode FcSubscriptionDispatcher_Subscribe(E_ZiyanFcSubscriptionTopic topic,
+                                                            E_ZiyanDataSubscriptionTopicFreq frequency,
+                                                            E_ZiyanDataSubscriptionTopicFreq *subscribedFrequency);
+static void FcSubscriptionDispatcher_PushReady(T_FcSubscriptionDispatcherConsumer *consumer);
+static void FcSubscriptionDispatcher_FreeConsumer(T_FcSubscriptionDispatcherConsumer *consumer);
+
+/* Private values ------------------------------------------------------------*/
+static bool s_dispatcherInitFlag = false;
+static T_ZiyanMutexHandle s_dispatcherMutex; /* Consumers, their queues and the ready list. */
+static T_ZiyanMutexHandle s_dispatcherSubscribeMutex; /* Subscription changes, held during the SDK calls. */
+static T_ZiyanSemaHandle s_dispatcherReadySema;
+static T_ZiyanTaskHandle s_dispatcherThreads[FC_SUBSCRIPTION_DISPATCHER_WORKER_COUNT];
+static T_FcSubscriptionDispatcherTopic s_dispatcherTopics[ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER];
+static T_FcSubscriptionDispatcherConsumer *s_readyHead = NULL;
+static T_FcSubscriptionDispatcherConsumer *s_readyTail = NULL;
+
+static T_UtilMetric s_dispatchDeliveryCount = UTIL_METRICS_COUNTER("ziyan_subscription_dispatch_deliveries_total",
+                                                                   "Topic values passed to consumers.");
+static T_UtilMetric s_dispatchDropCount = UTIL_METRICS_COUNTER("ziyan_subscription_dispatch_drops_total",
+                                                               "Topic values dropped by full consumer queues.");
+static T_UtilMetric s_dispatchCallbackDuration = UTIL_METRICS_HISTOGRAM(
+    "ziyan_subscription_dispatch_callback_duration_us", "Time spent in consumer callbacks.");
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode FcSubscriptionDispatcher_Init(void)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanReturnCode returnCode;
+
+    if (s_dispatcherInitFlag == true) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    returnCode = osalHandler->MutexCreate(&s_dispatcherMutex);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Create dispatcher mutex error: 0x%08llX.", returnCode);
+        return returnCode;
+    }
+
+    returnCode = osalHandler->MutexCreate(&s_dispatcherSubscribeMutex);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Create dispatcher subscribe mutex error: 0x%08llX.", returnCode);
+        goto out1;
+    }
+
+    returnCode = osalHandler->SemaphoreCreate(0, &s_dispatcherReadySema);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Create dispatcher semaphore error: 0x%08llX.", returnCode);
+        goto out2;
+    }
+
+    returnCode = FcSubscriptionCache_AddObserver(FcSubscriptionDispatcher_Receive);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Add dispatcher cache observer error: 0x%08llX.", returnCode);
+        goto out3;
+    }
+
+    for (int i = 0; i < FC_SUBSCRIPTION_DISPATCHER_WORKER_COUNT; i++) {
+        returnCode = osalHandler->TaskCreate("fc_subscription_dispatcher", FcSubscriptionDispatcher_Task,
+                                             FC_SUBSCRIPTION_DISPATCHER_TASK_STACK_SIZE, NULL,
+                                             &s_dispatcherThreads[i]);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("Create dispatcher task error: 0x%08llX.", returnCode);
+            // Created workers keep waiting for consumers that never come.
+            FcSubscriptionCache_RemoveObserver(FcSubscriptionDispatcher_Receive);
+            return returnCode;
+        }
+    }
+
+    s_dispatcherInitFlag = true;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out3:
+    osalHandler->SemaphoreDestroy(s_dispatcherReadySema);
+out2:
+    osalHandler->MutexDestroy(s_dispatcherSubscribeMutex);
+out1:
+    osalHandler->MutexDestroy(s_dispatcherMutex);
+    return returnCode;
+}
+
+T_ZiyanReturnCode FcSubscriptionDispatcher_AddConsumer(const T_FcSubscriptionDispatcherConsumerConfig *config,
+                                                       T_FcSubscriptionDispatcherConsumerHandle *consumer)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanReturnCode returnCode;
+    T_FcSubscriptionDispatcherConsumer *newConsumer;
+    T_FcSubscriptionDispatcherConsumer **tail;
+    T_FcSubscriptionDispatcherTopic *dispatcherTopic;
+    E_ZiyanDataSubscriptionTopicFreq frequency;
+    uint16_t dataSize;
+
+    if (s_dispatcherInitFlag != true) {
+        USER_LOG_ERROR("Dispatcher is not initialized.");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE;
+    }
+
+    if (config == NULL || consumer == NULL || config->callback == NULL || config->frequency == 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    dataSize = FcSubscriptionCache_GetTopicSize(config->topic);
+    if (dataSize == 0) {
+        USER_LOG_ERROR("Topic 0x%08X can not be dispatched.", config->topic);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    newConsumer = osalHandler->Malloc(sizeof(T_FcSubscriptionDispatcherConsumer));
+    if (newConsumer == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+    memset(newConsumer, 0, sizeof(T_FcSubscriptionDispatcherConsumer));
+    newConsumer->config = *config;
+    if (newConsumer->config.queueLength == 0) {
+        newConsumer->config.queueLength = FC_SUBSCRIPTION_DISPATCHER_QUEUE_LENGTH_DEFAULT;
+    }
+    newConsumer->entrySize = sizeof(T_ZiyanDataTimestamp) + dataSize;
+    newConsumer->queue = osalHandler->Malloc(newConsumer->config.queueLength * newConsumer->entrySize);
+    newConsumer->delivery = osalHandler->Malloc(newConsumer->entrySize);
+    if (newConsumer->queue == NULL || newConsumer->delivery == NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out1;
+    }
+
+    returnCode = osalHandler->MutexLock(s_dispatcherSubscribeMutex);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex lock error");
+        goto out1;
+    }
+
+    dispatcherTopic = &s_dispatcherTopics[config->topic];
+    frequency = dispatcherTopic->frequency;
+    if (config->frequency > frequency) {
+        returnCode = FcSubscriptionDispatcher_Subscribe(config->topic, config->frequency, &frequency);
+        dispatcherTopic->frequency = frequency;
+        if (frequency == 0) {
+            goto out2;
+        }
+    }
+
+    returnCode = osalHandler->MutexLock(s_dispatcherMutex);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex lock error");
+        goto out2;
+    }
+
+    tail = &dispatcherTopic->consumers;
+    while (*tail != NULL) {
+        (*tail)->decimation = USER_UTIL_MAX(frequency / (*tail)->config.frequency, 1);
+        tail = &(*tail)->next;
+    }
+    newConsumer->decimation = USER_UTIL_MAX(frequency / config->frequency, 1);
+    *tail = newConsumer;
+
+    osalHandler->MutexUnlock(s_dispatcherMutex);
+    osalHandler->MutexUnlock(s_dispatcherSubscribeMutex);
+
+    USER_LOG_INFO("Consumer %s of topic 0x%08X added at %d Hz, subscription at %d Hz.",
+                  config->name != NULL ? config->name : "", config->topic, config->frequency, frequency);
+    *consumer = newConsumer;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out2:
+    osalHandler->MutexUnlock(s_dispatcherSubscribeMutex);
+out1:
+    FcSubscriptionDispatcher_FreeConsumer(newConsumer);
+    return returnCode;
+}
+
+T_ZiyanReturnCode FcSubscriptionDispatcher_RemoveConsumer(T_FcSubscriptionDispatcherConsumerHandle consumer)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_FcSubscriptionDispatcherConsumer *oldConsumer = consumer;
+    T_FcSubscriptionDispatcherConsumer **link;
+    T_FcSubscriptionDispatcherConsumer *previous = NULL;
+    bool runningFlag;
+
+    if (oldConsumer == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (osalHandler->MutexLock(s_dispatcherMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex lock error");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    link = &s_dispatcherTopics[oldConsumer->config.topic].consumers;
+    while (*link != NULL && *link != oldConsumer) {
+        link = &(*link)->next;
+    }
+    if (*link == NULL) {
+        osalHandler->MutexUnlock(s_dispatcherMutex);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+    *link = oldConsumer->next;
+
+    if (oldConsumer->readyFlag == true) {
+        for (link = &s_readyHead; *link != oldConsumer; link = &(*link)->readyNext) {
+            previous = *link;
+        }
+        *link = oldConsumer->readyNext;
+        if (s_readyTail == oldConsumer) {
+            s_readyTail = previous;
+        }
+    }
+    oldConsumer->removedFlag = true;
+    runningFlag = oldConsumer->runningFlag;
+    osalHandler->MutexUnlock(s_dispatcherMutex);
+
+    // The worker delivering the consumer stops after the running callback.
+    while (runningFlag == true) {
+        osalHandler->TaskSleepMs(FC_SUBSCRIPTION_DISPATCHER_REMOVE_POLL_MS);
+        osalHandler->MutexLock(s_dispatcherMutex);
+        runningFlag = oldConsumer->runningFlag;
+        osalHandler->MutexUnlock(s_dispatcherMutex);
+    }
+
+    FcSubscriptionDispatcher_FreeConsumer(oldConsumer);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode FcSubscriptionDispatcher_GetConsumerStatistics(T_FcSubscriptionDispatcherConsumerHandle consumer,
+                                                                 T_FcSubscriptionDispatcherConsumerStatistics *statistics)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_FcSubscriptionDispatcherConsumer *dispatcherConsumer = consumer;
+
+    if (dispatcherConsumer == NULL || statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (osalHandler->MutexLock(s_dispatcherMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex lock error");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    *statistics = dispatcherConsumer->statistics;
+    osalHandler->MutexUnlock(s_dispatcherMutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+#ifndef __CC_ARM
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#endif
+
+static void *FcSubscriptionDispatcher_Task(void *arg)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_FcSubscriptionDispatcherConsumer *consumer;
+    uint64_t callbackStartUs = 0;
+    uint64_t callbackEndUs = 0;
+    uint32_t deliveryCount;
+
+    USER_UTIL_UNUSED(arg);
+
+    while (1) {
+        osalHandler->SemaphoreWait(s_dispatcherReadySema);
+
+        if (osalHandler->MutexLock(s_dispatcherMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_EVERY_MS(ERROR, FC_SUBSCRIPTION_DISPATCHER_LOG_PERIOD_MS, "mutex lock error");
+            continue;
+        }
+
+        // Posts of removed consumers leave the list empty.
+        consumer = s_readyHead;
+        if (consumer == NULL) {
+            osalHandler->MutexUnlock(s_dispatcherMutex);
+            continue;
+        }
+        s_readyHead = consumer->readyNext;
+        if (s_readyHead == NULL) {
+            s_readyTail = NULL;
+        }
+        consumer->readyFlag = false;
+        consumer->runningFlag = true;
+
+        // Values of a consumer are delivered by one worker at a time, in the order of reception.
+        for (deliveryCount = 0; deliveryCount < FC_SUBSCRIPTION_DISPATCHER_BATCH_MAX && consumer->queueDepth > 0 &&
+                                consumer->removedFlag == false; deliveryCount++) {
+            memcpy(consumer->delivery, consumer->queue + consumer->queueHead * consumer->entrySize,
+                   consumer->entrySize);
+            consumer->queueHead = (consumer->queueHead + 1) % consumer->config.queueLength;
+            consumer->queueDepth--;
+            osalHandler->MutexUnlock(s_dispatcherMutex);
+
+            osalHandler->GetTimeUs(&callbackStartUs);
+            {
+                UTIL_TRACE_SPAN("subscription dispatch");
+                consumer->config.callback(consumer->delivery + sizeof(T_ZiyanDataTimestamp),
+                                          consumer->entrySize - sizeof(T_ZiyanDataTimestamp),
+                                          (const T_ZiyanDataTimestamp *) consumer->delivery);
+            }
+            osalHandler->GetTimeUs(&callbackEndUs);
+            UtilMetrics_HistogramRecord(&s_dispatchCallbackDuration, callbackEndUs - callbackStartUs);
+            UtilMetrics_CounterAdd(&s_dispatchDeliveryCount, 1);
+
+            osalHandler->MutexLock(s_dispatcherMutex);
+            consumer->statistics.deliveredCount++;
+        }
+
+        consumer->runningFlag = false;
+        if (consumer->queueDepth > 0 && consumer->removedFlag == false) {
+            FcSubscriptionDispatcher_PushReady(consumer);
+            osalHandler->MutexUnlock(s_dispatcherMutex);
+            osalHandler->SemaphorePost(s_dispatcherReadySema);
+        } else {
+            osalHandler->MutexUnlock(s_dispatcherMutex);
+        }
+    }
+}
+
+#ifndef __CC_ARM
+#pragma GCC diagnostic pop
+#endif
+
+static void FcSubscriptionDispatcher_Receive(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data,
+                                             uint16_t dataSize, const T_ZiyanDataTimestamp *timestamp)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_FcSubscriptionDispatcherConsumer *consumer;
+    const char *droppingName = NULL;
+    uint32_t readyCount = 0;
+    uint8_t *entry;
+
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER) {
+        return;
+    }
+
+    // Only queues are updated here, slow consumers lose values instead of delaying the subscription callbacks.
+    if (osalHandler->MutexLock(s_dispatcherMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_EVERY_MS(ERROR, FC_SUBSCRIPTION_DISPATCHER_LOG_PERIOD_MS, "mutex lock error");
+        return;
+    }
+
+    for (consumer = s_dispatcherTopics[topic].consumers; consumer != NULL; consumer = consumer->next) {
+        if (consumer->decimationCount > 0) {
+            consumer->decimationCount--;
+            continue;
+        }
+        consumer->decimationCount = consumer->decimation - 1;
+
+        if (consumer->queueDepth == consumer->config.queueLength) {
+            consumer->statistics.droppedCount++;
+            UtilMetrics_CounterAdd(&s_dispatchDropCount, 1);
+            droppingName = consumer->config.name != NULL ? consumer->config.name : "";
+            if (consumer->config.dropPolicy == FC_SUBSCRIPTION_DISPATCHER_DROP_NEWEST) {
+                continue;
+            }
+            consumer->queueHead = (consumer->queueHead + 1) % consumer->config.queueLength;
+            consumer->queueDepth--;
+        }
+
+        entry = consumer->queue +
+                ((consumer->queueHead + consumer->queueDepth) % consumer->config.queueLength) * consumer->entrySize;
+        memcpy(entry, timestamp, sizeof(T_ZiyanDataTimestamp));
+        memcpy(entry + sizeof(T_ZiyanDataTimestamp), data,
+               USER_UTIL_MIN(dataSize, consumer->entrySize - sizeof(T_ZiyanDataTimestamp)));
+        consumer->queueDepth++;
+        consumer->statistics.queueDepthMax = USER_UTIL_MAX(consumer->statistics.queueDepthMax,
+                                                           consumer->queueDepth);
+
+        if (consumer->readyFlag == false && consumer->runningFlag == false) {
+            FcSubscriptionDispatcher_PushReady(consumer);
+            readyCount++;
+        }
+    }
+
+    osalHandler->MutexUnlock(s_dispatcherMutex);
+
+    while (readyCount-- > 0) {
+        osalHandler->SemaphorePost(s_dispatcherReadySema);
+    }
+
+    if (droppingName != NULL) {
+        USER_LOG_EVERY_MS(WARN, FC_SUBSCRIPTION_DISPATCHER_LOG_PERIOD_MS,
+                          "Queue of consumer %s of topic 0x%08X is full, values are dropped.", droppingName, topic);
+    }
+}
+
+static T_ZiyanReturnCode FcSubscriptionDispatcher_Subscribe(E_ZiyanFcSubscriptionTopic topic,
+                                                            E_ZiyanDataSubscriptionTopicFreq frequency,
+                                                            E_ZiyanDataSubscriptionTopicFreq *subscribedFrequency)
+{
+    T_ZiyanReturnCode returnCode;
+    E_ZiyanDataSubscriptionTopicFreq oldFrequency = *subscribedFrequency;
+
+    // The SDK has no frequency change, the subscription is renewed, which it only allows for the oldest subscription.
+    if (oldFrequency != 0) {
+        returnCode = FcSubscriptionCache_UnSubscribeTopic(topic);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_WARN("Unsubscribe topic 0x%08X error: 0x%08llX, frequency stays %d Hz instead of %d Hz.",
+                          topic, returnCode, oldFrequency, frequency);
+            return returnCode;
+        }
+    }
+
+    returnCode = FcSubscriptionCache_SubscribeTopic(topic, frequency);
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        *subscribedFrequency = frequency;
+        return returnCode;
+    }
+    USER_LOG_ERROR("Subscribe topic 0x%08X at %d Hz error: 0x%08llX.", topic, frequency, returnCode);
+
+    if (oldFrequency != 0 &&
+        FcSubscriptionCache_SubscribeTopic(topic, oldFrequency) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Subscribe topic 0x%08X again at %d Hz error, its consumers get no values.", topic,
+                       oldFrequency);
+        *subscribedFrequency = 0;
+    }
+
+    return returnCode;
+}
+
+static void FcSubscriptionDispatcher_PushReady(T_FcSubscriptionDispatcherConsumer *consumer)
+{
+    consumer->readyFlag = true;
+    consumer->readyNext = NULL;
+    if (s_readyTail == NULL) {
+        s_readyHead = consumer;
+    } else {
+        s_readyTail->readyNext = consumer;
+    }
+    s_readyTail = consumer;
+}
+
+static void FcSubscriptionDispatcher_FreeConsumer(T_FcSubscriptionDispatcherConsumer *consumer)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+
+    if (consumer->queue != NULL) {
+        osalHandler->Free(consumer->queue);
+    }
+    if (consumer->delivery != NULL) {
+        osalHandler->Free(consumer->delivery);
+    }
+    osalHandler->Free(consumer);
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,108 @@
+/**
+ ********************************************************************
+ * @file    fc_subscription_dispatcher.h
+ * @brief   This is the header file for "fc_subscription_dispatcher.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FC_SUBSCRIPTION_DISPATCHER_H
+#define FC_SUBSCRIPTION_DISPATCHER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "ziyan_fc_subscription.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+/* Each running callback holds a worker, slow consumers beyond this count delay the deliveries to the others. */
+#define FC_SUBSCRIPTION_DISPATCHER_WORKER_COUNT         4
+#define FC_SUBSCRIPTION_DISPATCHER_QUEUE_LENGTH_DEFAULT 8
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    FC_SUBSCRIPTION_DISPATCHER_DROP_OLDEST = 0, /*!< A full queue drops its oldest value, the consumer gets the latest ones. */
+    FC_SUBSCRIPTION_DISPATCHER_DROP_NEWEST = 1, /*!< A full queue drops received values until the consumer catches up. */
+} E_FcSubscriptionDispatcherDropPolicy;
+
+typedef struct {
+    const char *name; /*!< Name of the consumer in logs. */
+    E_ZiyanFcSubscriptionTopic topic;
+    E_ZiyanDataSubscriptionTopicFreq frequency; /*!< Frequency of the values delivered to the consumer. */
+    ZiyanReceiveDataOfTopicCallback callback; /*!< Called from a worker task, never concurrently for one consumer. */
+    uint16_t queueLength; /*!< Values waiting for the callback, 0 for FC_SUBSCRIPTION_DISPATCHER_QUEUE_LENGTH_DEFAULT. */
+    E_FcSubscriptionDispatcherDropPolicy dropPolicy;
+} T_FcSubscriptionDispatcherConsumerConfig;
+
+typedef struct {
+    uint64_t deliveredCount; /*!< Values passed to the callback. */
+    uint64_t droppedCount; /*!< Values dropped by a full queue. */
+    uint16_t queueDepthMax; /*!< Most values waiting at once. */
+} T_FcSubscriptionDispatcherConsumerStatistics;
+
+typedef void *T_FcSubscriptionDispatcherConsumerHandle;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start the worker tasks. ZiyanFcSubscription_Init() has to be called before consumers are added.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionDispatcher_Init(void);
+
+/**
+ * @brief Add a consumer of a topic. The dispatcher owns the only subscription of the topic, stored in the
+ * subscription cache, at the highest frequency requested by its consumers, and passes every value to the consumers
+ * wanting it through their queues. A higher frequency than the current one renews the subscription, which blocks
+ * for a few seconds and may be refused by the SDK, the consumer then gets values at the current frequency.
+ * @note Blocking, callable from any task but not from a consumer callback.
+ * @param config: consumer configuration.
+ * @param consumer: handle of the consumer.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionDispatcher_AddConsumer(const T_FcSubscriptionDispatcherConsumerConfig *config,
+                                                       T_FcSubscriptionDispatcherConsumerHandle *consumer);
+
+/**
+ * @brief Remove a consumer, waiting for its running callback to return. The subscription of the topic is kept.
+ * @note Not callable from the callback of the consumer.
+ * @param consumer: handle of the consumer.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionDispatcher_RemoveConsumer(T_FcSubscriptionDispatcherConsumerHandle consumer);
+
+/**
+ * @brief Get the delivery statistics of a consumer.
+ * @param consumer: handle of the consumer.
+ * @param statistics: statistics since the consumer was added.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionDispatcher_GetConsumerStatistics(T_FcSubscriptionDispatcherConsumerHandle consumer,
+                                                                 T_FcSubscriptionDispatcherConsumerStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FC_SUBSCRIPTION_DISPATCHER_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
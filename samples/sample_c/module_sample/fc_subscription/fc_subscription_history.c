@@ -0,0 +1,508 @@
+/**
+ ********************************************************************
+ * @file    fc_subscription_history.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <utils/util_attitude.h>
+#include <utils/util_log.h>
+#include <utils/util_metrics.h>
+#include <utils/util_misc.h>
+#include "fc_subscription_history.h"
+#include "fc_subscription_cache.h"
+#include "ziyan_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define FC_SUBSCRIPTION_HISTORY_CLOCK_COUNT         2
+#define FC_SUBSCRIPTION_HISTORY_LOG_PERIOD_MS       1000
+
+#define FC_SUBSCRIPTION_HISTORY_FIELDS(fields)      {fields, sizeof(fields) / sizeof(fields[0])}
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    FC_SUBSCRIPTION_HISTORY_FIELD_F32 = 0,
+    FC_SUBSCRIPTION_HISTORY_FIELD_F64 = 1,
+    FC_SUBSCRIPTION_HISTORY_FIELD_ANGLE = 2, /*!< ziyan_f32_t in degrees, interpolated the short way round. */
+    FC_SUBSCRIPTION_HISTORY_FIELD_QUATERNION = 3, /*!< T_ZiyanQuaternion4f, spherical linear interpolation. */
+} E_FcSubscriptionHistoryFieldType;
+
+typedef struct {
+    uint16_t offset;
+    E_FcSubscriptionHistoryFieldType type;
+} T_FcSubscriptionHistoryField;
+
+typedef struct {
+    const T_FcSubscriptionHistoryField *fields; /*!< Fields interpolated, the others keep the previous value. */
+    uint8_t fieldCount;
+} T_FcSubscriptionHistoryInterpolation;
+
+/**
+ * Ring of values with one writer, the subscription thread of the topic, read without locks. The ring holds twice
+ * the depth, so that queries see the last depth values and are only retried after depth values were written during
+ * the query.
+ */
+typedef struct {
+    uint64_t *times[FC_SUBSCRIPTION_HISTORY_CLOCK_COUNT]; /*!< Times of the values, apart so searches only read them. */
+    uint8_t *values;
+    uint16_t dataSize;
+    uint32_t depth;
+    uint32_t mask; /*!< Ring size minus 1. */
+    uint32_t startPosition; /*!< First value after the timestamps went back, older ones are out of order. */
+    uint32_t writePosition; /*!< Incremented before a slot is overwritten. */
+    uint32_t headPosition; /*!< Incremented once a value is written, values before it can be read. */
+} T_FcSubscriptionHistoryTopic;
+
+typedef struct {
+    const T_FcSubscriptionHistoryTopic *topic;
+    const uint64_t *times;
+    uint32_t firstPosition;
+    uint32_t count;
+    uint32_t lowestOffset; /*!< Oldest value read, which must not have been overwritten for the read to hold. */
+} T_FcSubscriptionHistoryWindow;
+
+/* Private functions declaration ---------------------------------------------*/
+static void FcSubscriptionHistory_Receive(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                          const T_ZiyanDataTimestamp *timestamp);
+static void FcSubscriptionHistory_OpenWindow(const T_FcSubscriptionHistoryTopic *historyTopic,
+                                             E_FcSubscriptionHistoryClock clock,
+                                             T_FcSubscriptionHistoryWindow *window);
+static bool FcSubscriptionHistory_IsWindowValid(const T_FcSubscriptionHistoryWindow *window);
+static uint64_t FcSubscriptionHistory_GetTime(T_FcSubscriptionHistoryWindow *window, uint32_t offset);
+static uint32_t FcSubscriptionHistory_Search(T_FcSubscriptionHistoryWindow *window, uint64_t timeUs, uint32_t hint);
+static bool FcSubscriptionHistory_Lookup(T_FcSubscriptionHistoryWindow *window, E_ZiyanFcSubscriptionTopic topic,
+                                         uint64_t timeUs, uint32_t *hint, uint8_t *data);
+static void FcSubscriptionHistory_Interpolate(E_ZiyanFcSubscriptionTopic topic, const uint8_t *before,
+                                              const uint8_t *after, ziyan_f64_t ratio, uint8_t *data,
+                                              uint16_t dataSize);
+
+/* Private values ------------------------------------------------------------*/
+static const T_FcSubscriptionHistoryField s_quaternionFields[] = {
+    {0, FC_SUBSCRIPTION_HISTORY_FIELD_QUATERNION},
+};
+static const T_FcSubscriptionHistoryField s_vector3fFields[] = {
+    {offsetof(T_ZiyanVector3f, x), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+    {offsetof(T_ZiyanVector3f, y), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+    {offsetof(T_ZiyanVector3f, z), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+};
+static const T_FcSubscriptionHistoryField s_velocityFields[] = {
+    {offsetof(T_ZiyanFcSubscriptionVelocity, data.x), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+    {offsetof(T_ZiyanFcSubscriptionVelocity, data.y), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+    {offsetof(T_ZiyanFcSubscriptionVelocity, data.z), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+};
+static const T_FcSubscriptionHistoryField s_f32Fields[] = {
+    {0, FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+};
+static const T_FcSubscriptionHistoryField s_positionFusedFields[] = {
+    {offsetof(T_ZiyanFcSubscriptionPositionFused, longitude), FC_SUBSCRIPTION_HISTORY_FIELD_F64},
+    {offsetof(T_ZiyanFcSubscriptionPositionFused, latitude), FC_SUBSCRIPTION_HISTORY_FIELD_F64},
+    {offsetof(T_ZiyanFcSubscriptionPositionFused, altitude), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+};
+static const T_FcSubscriptionHistoryField s_rtkPositionFields[] = {
+    {offsetof(T_ZiyanFcSubscriptionRtkPosition, longitude), FC_SUBSCRIPTION_HISTORY_FIELD_F64},
+    {offsetof(T_ZiyanFcSubscriptionRtkPosition, latitude), FC_SUBSCRIPTION_HISTORY_FIELD_F64},
+    {offsetof(T_ZiyanFcSubscriptionRtkPosition, hfsl), FC_SUBSCRIPTION_HISTORY_FIELD_F32},
+};
+static const T_FcSubscriptionHistoryField s_gimbalAnglesFields[] = {
+    {offsetof(T_ZiyanFcSubscriptionGimbalAngles, x), FC_SUBSCRIPTION_HISTORY_FIELD_ANGLE},
+    {offsetof(T_ZiyanFcSubscriptionGimbalAngles, y), FC_SUBSCRIPTION_HISTORY_FIELD_ANGLE},
+    {offsetof(T_ZiyanFcSubscriptionGimbalAngles, z), FC_SUBSCRIPTION_HISTORY_FIELD_ANGLE},
+};
+
+static const T_FcSubscriptionHistoryInterpolation s_historyInterpolations[ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER] = {
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_quaternionFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ACCELERATION_GROUND] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_vector3fFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ACCELERATION_BODY] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_vector3fFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ACCELERATION_RAW] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_vector3fFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_velocityFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ANGULAR_RATE_FUSIONED] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_vector3fFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ANGULAR_RATE_RAW] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_vector3fFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ALTITUDE_FUSED] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_f32Fields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ALTITUDE_BAROMETER] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_f32Fields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_ALTITUDE_OF_HOMEPOINT] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_f32Fields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_HEIGHT_FUSION] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_f32Fields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_HEIGHT_RELATIVE] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_f32Fields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_positionFusedFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_VELOCITY] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_vector3fFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_RTK_POSITION] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_rtkPositionFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_RTK_VELOCITY] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_vector3fFields),
+    [ZIYAN_FC_SUBSCRIPTION_TOPIC_GIMBAL_ANGLES] = FC_SUBSCRIPTION_HISTORY_FIELDS(s_gimbalAnglesFields),
+};
+
+static bool s_historyInitFlag = false;
+static T_FcSubscriptionHistoryTopic *s_historyTopics[ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER] = {0};
+
+static T_UtilMetric s_historyQueryCount = UTIL_METRICS_COUNTER("ziyan_subscription_history_queries_total",
+                                                               "Times looked up in the topic histories.");
+static T_UtilMetric s_historyMissCount = UTIL_METRICS_COUNTER("ziyan_subscription_history_misses_total",
+                                                              "Times out of the values kept by the topic histories.");
+static T_UtilMetric s_historyRetryCount = UTIL_METRICS_COUNTER("ziyan_subscription_history_retries_total",
+                                                               "Queries repeated as their values were overwritten.");
+static T_UtilMetric s_historyResetCount = UTIL_METRICS_COUNTER("ziyan_subscription_history_resets_total",
+                                                               "Histories restarted as the timestamps went back.");
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode FcSubscriptionHistory_Init(void)
+{
+    T_ZiyanReturnCode returnCode;
+
+    if (s_historyInitFlag == true) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    returnCode = FcSubscriptionCache_AddObserver(FcSubscriptionHistory_Receive);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Add history cache observer error: 0x%08llX.", returnCode);
+        return returnCode;
+    }
+
+    s_historyInitFlag = true;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode FcSubscriptionHistory_Enable(E_ZiyanFcSubscriptionTopic topic, uint16_t depth)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_FcSubscriptionHistoryTopic *historyTopic;
+    T_FcSubscriptionHistoryTopic *expected = NULL;
+    uint16_t dataSize = FcSubscriptionCache_GetTopicSize(topic);
+    uint32_t ringSize = (uint32_t) depth * 2;
+
+    if (dataSize == 0 || depth < 2 || depth > FC_SUBSCRIPTION_HISTORY_DEPTH_MAX || (depth & (depth - 1)) != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (__atomic_load_n(&s_historyTopics[topic], __ATOMIC_ACQUIRE) != NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    // One allocation holding the ring after the topic, 8 bytes aligned for the times.
+    historyTopic = osalHandler->Malloc(sizeof(T_FcSubscriptionHistoryTopic) +
+                                       ringSize * (FC_SUBSCRIPTION_HISTORY_CLOCK_COUNT * sizeof(uint64_t) + dataSize));
+    if (historyTopic == NULL) {
+        USER_LOG_ERROR("Allocate history of topic 0x%08X error.", topic);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    memset(historyTopic, 0, sizeof(T_FcSubscriptionHistoryTopic));
+    historyTopic->times[FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP] = (uint64_t *) (historyTopic + 1);
+    historyTopic->times[FC_SUBSCRIPTION_HISTORY_CLOCK_LOCAL] =
+        historyTopic->times[FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP] + ringSize;
+    historyTopic->values = (uint8_t *) (historyTopic->times[FC_SUBSCRIPTION_HISTORY_CLOCK_LOCAL] + ringSize);
+    historyTopic->dataSize = dataSize;
+    historyTopic->depth = depth;
+    historyTopic->mask = ringSize - 1;
+
+    if (!__atomic_compare_exchange_n(&s_historyTopics[topic], &expected, historyTopic, false,
+                                     __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        osalHandler->Free(historyTopic);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+uint64_t FcSubscriptionHistory_GetTimestampUs(const T_ZiyanDataTimestamp *timestamp)
+{
+    return (uint64_t) timestamp->millisecond * 1000 + timestamp->microsecond % 1000;
+}
+
+T_ZiyanReturnCode FcSubscriptionHistory_Query(E_ZiyanFcSubscriptionTopic topic, E_FcSubscriptionHistoryClock clock,
+                                              uint64_t timeUs, void *data, uint16_t dataSize)
+{
+    return FcSubscriptionHistory_QueryBatch(topic, clock, &timeUs, 1, data, dataSize, NULL);
+}
+
+T_ZiyanReturnCode FcSubscriptionHistory_QueryBatch(E_ZiyanFcSubscriptionTopic topic,
+                                                   E_FcSubscriptionHistoryClock clock, const uint64_t *timesUs,
+                                                   uint32_t count, void *data, uint16_t dataSize, bool *isFound)
+{
+    const T_FcSubscriptionHistoryTopic *historyTopic;
+    T_FcSubscriptionHistoryWindow window;
+    uint8_t *value;
+    uint32_t foundCount;
+    uint32_t retryCount = 0;
+    uint32_t hint;
+    bool found;
+
+    if (topic >= ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER || clock >= FC_SUBSCRIPTION_HISTORY_CLOCK_COUNT ||
+        timesUs == NULL || data == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    historyTopic = __atomic_load_n(&s_historyTopics[topic], __ATOMIC_ACQUIRE);
+    if (historyTopic == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE;
+    }
+
+    if (dataSize != historyTopic->dataSize) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    // The values are read while the writer may overwrite the oldest ones, the whole batch is read again if it did.
+    for (;;) {
+        FcSubscriptionHistory_OpenWindow(historyTopic, clock, &window);
+        foundCount = 0;
+        hint = 0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            value = (uint8_t *) data + (size_t) i * dataSize;
+            found = FcSubscriptionHistory_Lookup(&window, topic, timesUs[i], &hint, value);
+            if (!found) {
+                memset(value, 0, dataSize);
+            }
+            if (isFound != NULL) {
+                isFound[i] = found;
+            }
+            foundCount += found ? 1 : 0;
+        }
+
+        if (FcSubscriptionHistory_IsWindowValid(&window)) {
+            break;
+        }
+        retryCount++;
+    }
+
+    UtilMetrics_CounterAdd(&s_historyQueryCount, count);
+    if (foundCount != count) {
+        UtilMetrics_CounterAdd(&s_historyMissCount, count - foundCount);
+    }
+    if (retryCount != 0) {
+        UtilMetrics_CounterAdd(&s_historyRetryCount, retryCount);
+    }
+
+    return foundCount == count ? ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS : ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void FcSubscriptionHistory_Receive(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                          const T_ZiyanDataTimestamp *timestamp)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_FcSubscriptionHistoryTopic *historyTopic = __atomic_load_n(&s_historyTopics[topic], __ATOMIC_ACQUIRE);
+    uint64_t times[FC_SUBSCRIPTION_HISTORY_CLOCK_COUNT];
+    uint32_t position;
+    uint32_t lastSlot;
+    uint32_t slot;
+    bool isReset = false;
+
+    if (historyTopic == NULL || dataSize != historyTopic->dataSize) {
+        return;
+    }
+
+    times[FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP] = FcSubscriptionHistory_GetTimestampUs(timestamp);
+    osalHandler->GetTimeUs(&times[FC_SUBSCRIPTION_HISTORY_CLOCK_LOCAL]);
+
+    // Searches need ascending times, a flight controller restart starts the history again.
+    position = historyTopic->headPosition;
+    if (position != historyTopic->startPosition) {
+        lastSlot = (position - 1) & historyTopic->mask;
+        for (int clock = 0; clock < FC_SUBSCRIPTION_HISTORY_CLOCK_COUNT; clock++) {
+            if (times[clock] < historyTopic->times[clock][lastSlot]) {
+                isReset = true;
+            }
+        }
+    }
+    if (isReset) {
+        USER_LOG_EVERY_MS(WARN, FC_SUBSCRIPTION_HISTORY_LOG_PERIOD_MS,
+                          "Timestamps of topic 0x%08X went back, its history starts again.", topic);
+        UtilMetrics_CounterAdd(&s_historyResetCount, 1);
+    }
+
+    __atomic_store_n(&historyTopic->writePosition, position + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot = position & historyTopic->mask;
+    for (int clock = 0; clock < FC_SUBSCRIPTION_HISTORY_CLOCK_COUNT; clock++) {
+        __atomic_store_n(&historyTopic->times[clock][slot], times[clock], __ATOMIC_RELAXED);
+    }
+    memcpy(historyTopic->values + (size_t) slot * historyTopic->dataSize, data, dataSize);
+
+    if (isReset) {
+        __atomic_store_n(&historyTopic->startPosition, position, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&historyTopic->headPosition, position + 1, __ATOMIC_RELEASE);
+}
+
+static void FcSubscriptionHistory_OpenWindow(const T_FcSubscriptionHistoryTopic *historyTopic,
+                                             E_FcSubscriptionHistoryClock clock,
+                                             T_FcSubscriptionHistoryWindow *window)
+{
+    uint32_t headPosition = __atomic_load_n(&historyTopic->headPosition, __ATOMIC_ACQUIRE);
+    uint32_t startPosition = __atomic_load_n(&historyTopic->startPosition, __ATOMIC_RELAXED);
+
+    window->topic = historyTopic;
+    window->times = historyTopic->times[clock];
+    window->count = USER_UTIL_MIN(headPosition - startPosition, historyTopic->depth);
+    window->firstPosition = headPosition - window->count;
+    window->lowestOffset = window->count;
+}
+
+static bool FcSubscriptionHistory_IsWindowValid(const T_FcSubscriptionHistoryWindow *window)
+{
+    uint32_t writePosition;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    writePosition = __atomic_load_n(&window->topic->writePosition, __ATOMIC_RELAXED);
+
+    // The slot of a position is overwritten by the write of the position a ring size later.
+    return writePosition - (window->firstPosition + window->lowestOffset) <= window->topic->mask;
+}
+
+static uint64_t FcSubscriptionHistory_GetTime(T_FcSubscriptionHistoryWindow *window, uint32_t offset)
+{
+    window->lowestOffset = USER_UTIL_MIN(window->lowestOffset, offset);
+
+    return __atomic_load_n(&window->times[(window->firstPosition + offset) & window->topic->mask],
+                           __ATOMIC_RELAXED);
+}
+
+/* Number of values at or before a time, found from the result for the previous time of a batch. */
+static uint32_t FcSubscriptionHistory_Search(T_FcSubscriptionHistoryWindow *window, uint64_t timeUs, uint32_t hint)
+{
+    uint32_t low = 0;
+    uint32_t high = window->count;
+    uint32_t step = 1;
+    uint32_t probe;
+    uint32_t middle;
+
+    // Galloping from the hint, ascending times close to each other take a few probes instead of log2(depth).
+    if (hint > 0 && hint <= window->count && FcSubscriptionHistory_GetTime(window, hint - 1) <= timeUs) {
+        low = hint;
+        while (low < high) {
+            probe = low + step - 1;
+            if (probe >= high) {
+                break;
+            }
+            if (FcSubscriptionHistory_GetTime(window, probe) > timeUs) {
+                high = probe;
+                break;
+            }
+            low = probe + 1;
+            step *= 2;
+        }
+    }
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (FcSubscriptionHistory_GetTime(window, middle) <= timeUs) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+static bool FcSubscriptionHistory_Lookup(T_FcSubscriptionHistoryWindow *window, E_ZiyanFcSubscriptionTopic topic,
+                                         uint64_t timeUs, uint32_t *hint, uint8_t *data)
+{
+    const T_FcSubscriptionHistoryTopic *historyTopic = window->topic;
+    uint32_t before = FcSubscriptionHistory_Search(window, timeUs, *hint);
+    uint64_t beforeTimeUs;
+    uint64_t afterTimeUs;
+    const uint8_t *beforeValue;
+    const uint8_t *afterValue;
+
+    *hint = before;
+    if (before == 0) {
+        return false;
+    }
+    before--;
+
+    beforeTimeUs = FcSubscriptionHistory_GetTime(window, before);
+    beforeValue = historyTopic->values +
+                  (size_t) ((window->firstPosition + before) & historyTopic->mask) * historyTopic->dataSize;
+    if (beforeTimeUs == timeUs) {
+        memcpy(data, beforeValue, historyTopic->dataSize);
+        return true;
+    }
+
+    if (before + 1 >= window->count) {
+        return false;
+    }
+
+    afterTimeUs = FcSubscriptionHistory_GetTime(window, before + 1);
+    afterValue = historyTopic->values +
+                 (size_t) ((window->firstPosition + before + 1) & historyTopic->mask) * historyTopic->dataSize;
+    FcSubscriptionHistory_Interpolate(topic, beforeValue, afterValue,
+                                      (ziyan_f64_t) (timeUs - beforeTimeUs) / (ziyan_f64_t) (afterTimeUs - beforeTimeUs),
+                                      data, historyTopic->dataSize);
+
+    return true;
+}
+
+static void FcSubscriptionHistory_Interpolate(E_ZiyanFcSubscriptionTopic topic, const uint8_t *before,
+                                              const uint8_t *after, ziyan_f64_t ratio, uint8_t *data,
+                                              uint16_t dataSize)
+{
+    const T_FcSubscriptionHistoryInterpolation *interpolation = &s_historyInterpolations[topic];
+    const T_FcSubscriptionHistoryField *field;
+    T_ZiyanQuaternion4f fromQuaternion;
+    T_ZiyanQuaternion4f toQuaternion;
+    T_ZiyanQuaternion4f quaternion;
+    ziyan_f32_t from32;
+    ziyan_f32_t to32;
+    ziyan_f64_t from64;
+    ziyan_f64_t to64;
+
+    // Topic structures are packed, fields are copied out rather than accessed in place.
+    memcpy(data, before, dataSize);
+    for (uint8_t i = 0; i < interpolation->fieldCount; i++) {
+        field = &interpolation->fields[i];
+        switch (field->type) {
+            case FC_SUBSCRIPTION_HISTORY_FIELD_F32:
+                memcpy(&from32, before + field->offset, sizeof(ziyan_f32_t));
+                memcpy(&to32, after + field->offset, sizeof(ziyan_f32_t));
+                from32 += (ziyan_f32_t) ((to32 - from32) * ratio);
+                memcpy(data + field->offset, &from32, sizeof(ziyan_f32_t));
+                break;
+            case FC_SUBSCRIPTION_HISTORY_FIELD_F64:
+                memcpy(&from64, before + field->offset, sizeof(ziyan_f64_t));
+                memcpy(&to64, after + field->offset, sizeof(ziyan_f64_t));
+                from64 += (to64 - from64) * ratio;
+                memcpy(data + field->offset, &from64, sizeof(ziyan_f64_t));
+                break;
+            case FC_SUBSCRIPTION_HISTORY_FIELD_ANGLE:
+                memcpy(&from32, before + field->offset, sizeof(ziyan_f32_t));
+                memcpy(&to32, after + field->offset, sizeof(ziyan_f32_t));
+                from32 = remainderf(from32 + (ziyan_f32_t) (remainderf(to32 - from32, 360.0f) * ratio), 360.0f);
+                memcpy(data + field->offset, &from32, sizeof(ziyan_f32_t));
+                break;
+            case FC_SUBSCRIPTION_HISTORY_FIELD_QUATERNION:
+                memcpy(&fromQuaternion, before + field->offset, sizeof(T_ZiyanQuaternion4f));
+                memcpy(&toQuaternion, after + field->offset, sizeof(T_ZiyanQuaternion4f));
+                UtilAttitude_Slerp(&fromQuaternion, &toQuaternion, (ziyan_f32_t) ratio, &quaternion);
+                memcpy(data + field->offset, &quaternion, sizeof(T_ZiyanQuaternion4f));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,111 @@
+/**
+ ********************************************************************
+ * @file    fc_subscription_history.h
+ * @brief   This is the header file for "fc_subscription_history.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef FC_SUBSCRIPTION_HISTORY_H
+#define FC_SUBSCRIPTION_HISTORY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "ziyan_fc_subscription.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define FC_SUBSCRIPTION_HISTORY_DEPTH_MAX           16384
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    /*! Timestamp given by the subscription, see FcSubscriptionHistory_GetTimestampUs(). */
+    FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP = 0,
+    /*!
+     * Local time the value was received, from the OSAL GetTimeUs, the time passed to
+     * ZiyanTimeSync_TransferToAircraftTime() to get the aircraft time.
+     */
+    FC_SUBSCRIPTION_HISTORY_CLOCK_LOCAL = 1,
+} E_FcSubscriptionHistoryClock;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start storing the values of the topics enabled by FcSubscriptionHistory_Enable(), taken from the
+ * subscription cache, without any other subscription.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionHistory_Init(void);
+
+/**
+ * @brief Keep the latest values of a topic for queries by time. The topic still has to be subscribed through the
+ * subscription cache or the dispatcher.
+ * @param topic: topic stored in the subscription cache.
+ * @param depth: values kept, a power of 2 up to FC_SUBSCRIPTION_HISTORY_DEPTH_MAX, e.g. 1024 for 5 s at 200 Hz.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode FcSubscriptionHistory_Enable(E_ZiyanFcSubscriptionTopic topic, uint16_t depth);
+
+/**
+ * @brief Convert a subscription timestamp to microseconds, the millisecond extended by the sub-millisecond part of
+ * the microsecond.
+ */
+uint64_t FcSubscriptionHistory_GetTimestampUs(const T_ZiyanDataTimestamp *timestamp);
+
+/**
+ * @brief Get the value of a topic at a time, interpolated between the values around it: spherical linear
+ * interpolation for the quaternion, linear interpolation for vectors, positions, altitudes and angles, the previous
+ * value for other topics. Lock-free, callable from any thread, O(log depth).
+ * @param topic: topic enabled by FcSubscriptionHistory_Enable().
+ * @param clock: clock of the time.
+ * @param timeUs: time of the value.
+ * @param data: value, must be the structure of the topic.
+ * @param dataSize: size of the structure of the topic.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE when the time is before the oldest value
+ * kept or after the latest one, which may come later.
+ */
+T_ZiyanReturnCode FcSubscriptionHistory_Query(E_ZiyanFcSubscriptionTopic topic, E_FcSubscriptionHistoryClock clock,
+                                              uint64_t timeUs, void *data, uint16_t dataSize);
+
+/**
+ * @brief Get the values of a topic at several times, as FcSubscriptionHistory_Query() for each time. Times in
+ * ascending order are found from one another, in O(1) for times closer than a few values.
+ * @param topic: topic enabled by FcSubscriptionHistory_Enable().
+ * @param clock: clock of the times.
+ * @param timesUs: times of the values.
+ * @param count: number of times.
+ * @param data: count values, must be structures of the topic.
+ * @param dataSize: size of the structure of the topic.
+ * @param isFound: whether the value of each time was found, can be NULL. Values not found are zeroed.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE when a value was not found.
+ */
+T_ZiyanReturnCode FcSubscriptionHistory_QueryBatch(E_ZiyanFcSubscriptionTopic topic,
+                                                   E_FcSubscriptionHistoryClock clock, const uint64_t *timesUs,
+                                                   uint32_t count, void *data, uint16_t dataSize, bool *isFound);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FC_SUBSCRIPTION_HISTORY_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
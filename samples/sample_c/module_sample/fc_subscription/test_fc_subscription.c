@@ -24,8 +24,12 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <utils/util_misc.h>
+#include <utils/util_log.h>
+#include <utils/util_metrics.h>
 #include <math.h>
 #include "test_fc_subscription.h"
+#include "fc_subscription_cache.h"
+#include "fc_subscription_dispatcher.h"
 #include "ziyan_logger.h"
 #include "ziyan_platform.h"
 // #include "widget_interaction_test/test_widget_interaction.h"
@@ -33,6 +37,7 @@
 /* Private constants ---------------------------------------------------------*/
 #define FC_SUBSCRIPTION_TASK_FREQ         (1)
 #define FC_SUBSCRIPTION_TASK_STACK_SIZE   (1024)
+#define FC_SUBSCRIPTION_LOG_PERIOD_MS     (1000)
 
 /* Private types -------------------------------------------------------------*/
 
@@ -46,15 +51,24 @@ static T_ZiyanReturnCode ZiyanTest_FcSubscriptionReceivePositionFusedCallback(co
 
 /* Private variables ---------------------------------------------------------*/
 static T_ZiyanTaskHandle s_userFcSubscriptionThread;
+static T_FcSubscriptionDispatcherConsumerHandle s_quaternionConsumer;
+static T_FcSubscriptionDispatcherConsumerHandle s_positionFusedConsumer;
 static bool s_userFcSubscriptionDataShow = false;
 static uint8_t s_totalSatelliteNumberUsed = 0;
 static uint32_t s_userFcSubscriptionDataCnt = 0;
+static T_UtilMetric s_quaternionReceiveCount = UTIL_METRICS_COUNTER("ziyan_subscription_quaternion_total",
+                                                                    "Quaternion topic values received.");
+static T_UtilMetric s_positionFusedReceiveCount = UTIL_METRICS_COUNTER("ziyan_subscription_position_fused_total",
+                                                                       "Fused position topic values received.");
+static T_UtilMetric s_visibleSatelliteNumber = UTIL_METRICS_GAUGE("ziyan_subscription_visible_satellites",
+                                                                  "Visible satellites of the last fused position.");
 
 /* Exported functions definition ---------------------------------------------*/
 T_ZiyanReturnCode ZiyanTest_FcSubscriptionStartService(void)
 {
     T_ZiyanReturnCode ziyanStat;
     T_ZiyanOsalHandler *osalHandler = NULL;
+    T_FcSubscriptionDispatcherConsumerConfig consumerConfig = {0};
 
     osalHandler = ZiyanPlatform_GetOsalHandler();
     ziyanStat = ZiyanFcSubscription_Init();
@@ -63,8 +77,11 @@ T_ZiyanReturnCode ZiyanTest_FcSubscriptionStartService(void)
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
-    ziyanStat = ZiyanFcSubscription_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, ZIYAN_DATA_SUBSCRIPTION_TOPIC_50_HZ,
-                                               ZiyanTest_FcSubscriptionReceiveQuaternionCallback);
+    consumerConfig.name = "fc_subscription_quaternion";
+    consumerConfig.topic = ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION;
+    consumerConfig.frequency = ZIYAN_DATA_SUBSCRIPTION_TOPIC_50_HZ;
+    consumerConfig.callback = ZiyanTest_FcSubscriptionReceiveQuaternionCallback;
+    ziyanStat = FcSubscriptionDispatcher_AddConsumer(&consumerConfig, &s_quaternionConsumer);
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Subscribe topic quaternion error.");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -72,8 +89,8 @@ T_ZiyanReturnCode ZiyanTest_FcSubscriptionStartService(void)
         USER_LOG_DEBUG("Subscribe topic quaternion success.");
     }
 
-    ziyanStat = ZiyanFcSubscription_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY, ZIYAN_DATA_SUBSCRIPTION_TOPIC_1_HZ,
-                                               NULL);
+    ziyanStat = FcSubscriptionCache_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY,
+                                                   ZIYAN_DATA_SUBSCRIPTION_TOPIC_1_HZ);
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Subscribe topic velocity error.");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -81,8 +98,8 @@ T_ZiyanReturnCode ZiyanTest_FcSubscriptionStartService(void)
         USER_LOG_DEBUG("Subscribe topic velocity success.");
     }
 
-    ziyanStat = ZiyanFcSubscription_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_ACCELERATION_RAW, ZIYAN_DATA_SUBSCRIPTION_TOPIC_5_HZ,
-                                               NULL);
+    ziyanStat = FcSubscriptionCache_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_ACCELERATION_RAW,
+                                                   ZIYAN_DATA_SUBSCRIPTION_TOPIC_5_HZ);
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Subscribe topic acceleration raw error.");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -90,8 +107,8 @@ T_ZiyanReturnCode ZiyanTest_FcSubscriptionStartService(void)
         USER_LOG_DEBUG("Subscribe topic acceleration raw success.");
     }
 
-    ziyanStat = ZiyanFcSubscription_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_ANGULAR_RATE_RAW, ZIYAN_DATA_SUBSCRIPTION_TOPIC_10_HZ,
-                                               NULL);
+    ziyanStat = FcSubscriptionCache_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_ANGULAR_RATE_RAW,
+                                                   ZIYAN_DATA_SUBSCRIPTION_TOPIC_10_HZ);
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Subscribe topic angular rate raw error.");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -99,8 +116,8 @@ T_ZiyanReturnCode ZiyanTest_FcSubscriptionStartService(void)
         USER_LOG_DEBUG("Subscribe topic angular rate raw success.");
     }
 
-    ziyanStat = ZiyanFcSubscription_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_DETAILS, ZIYAN_DATA_SUBSCRIPTION_TOPIC_1_HZ,
-                                               NULL);
+    ziyanStat = FcSubscriptionCache_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_DETAILS,
+                                                   ZIYAN_DATA_SUBSCRIPTION_TOPIC_1_HZ);
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Subscribe topic gps details error.");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -108,8 +125,11 @@ T_ZiyanReturnCode ZiyanTest_FcSubscriptionStartService(void)
         USER_LOG_DEBUG("Subscribe topic gps details success.");
     }
 
-    ziyanStat = ZiyanFcSubscription_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED, ZIYAN_DATA_SUBSCRIPTION_TOPIC_1_HZ,
-                                               ZiyanTest_FcSubscriptionReceivePositionFusedCallback);
+    consumerConfig.name = "fc_subscription_position_fused";
+    consumerConfig.topic = ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED;
+    consumerConfig.frequency = ZIYAN_DATA_SUBSCRIPTION_TOPIC_1_HZ;
+    consumerConfig.callback = ZiyanTest_FcSubscriptionReceivePositionFusedCallback;
+    ziyanStat = FcSubscriptionDispatcher_AddConsumer(&consumerConfig, &s_positionFusedConsumer);
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Subscribe topic position fused error.");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -297,10 +317,8 @@ static void *UserFcSubscription_Task(void *arg)
     while (1) {
         osalHandler->TaskSleepMs(1000 / FC_SUBSCRIPTION_TASK_FREQ);
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY,
-                                                          (uint8_t *) &velocity,
-                                                          sizeof(T_ZiyanFcSubscriptionVelocity),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY, &velocity,
+                                             sizeof(T_ZiyanFcSubscriptionVelocity), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic velocity error.");
         }
@@ -310,10 +328,8 @@ static void *UserFcSubscription_Task(void *arg)
                           velocity.data.z, velocity.health);
         }
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_POSITION,
-                                                          (uint8_t *) &gpsPosition,
-                                                          sizeof(T_ZiyanFcSubscriptionGpsPosition),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_POSITION, &gpsPosition,
+                                             sizeof(T_ZiyanFcSubscriptionGpsPosition), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic gps position error.");
         }
@@ -322,10 +338,8 @@ static void *UserFcSubscription_Task(void *arg)
             USER_LOG_INFO("gps position: x %d y %d z %d.", gpsPosition.x, gpsPosition.y, gpsPosition.z);
         }
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_DETAILS,
-                                                          (uint8_t *) &gpsDetails,
-                                                          sizeof(T_ZiyanFcSubscriptionGpsDetails),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_DETAILS, &gpsDetails,
+                                             sizeof(T_ZiyanFcSubscriptionGpsDetails), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic gps details error.");
         }
@@ -339,18 +353,14 @@ static void *UserFcSubscription_Task(void *arg)
         }
 
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_TIME,
-                                                          &gpsTime,
-                                                          sizeof(T_ZiyanFcSubscriptionGpsTime),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_TIME, &gpsTime,
+                                             sizeof(T_ZiyanFcSubscriptionGpsTime), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic gps time error.");
         }
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_DATE,
-                                                          &gpsDate,
-                                                          sizeof(T_ZiyanFcSubscriptionGpsDate),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_GPS_DATE, &gpsDate,
+                                             sizeof(T_ZiyanFcSubscriptionGpsDate), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic gps time error.");
         }
@@ -360,18 +370,14 @@ static void *UserFcSubscription_Task(void *arg)
         }
 
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_ACCELERATION_RAW,
-                                                          &accele_raw,
-                                                          sizeof(T_ZiyanFcSubscriptionAccelerationRaw),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_ACCELERATION_RAW, &accele_raw,
+                                             sizeof(T_ZiyanFcSubscriptionAccelerationRaw), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic gps time error.");
         }
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_ANGULAR_RATE_RAW,
-                                                          &angular_rate_raw,
-                                                          sizeof(T_ZiyanFcSubscriptionAngularRateRaw),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_ANGULAR_RATE_RAW, &angular_rate_raw,
+                                             sizeof(T_ZiyanFcSubscriptionAngularRateRaw), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic gps time error.");
         }
@@ -381,10 +387,8 @@ static void *UserFcSubscription_Task(void *arg)
             USER_LOG_INFO("gyro: %f : %f : %f", angular_rate_raw.x, angular_rate_raw.y, angular_rate_raw.z);
         }
 
-        ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED,
-                                                          &position_fused,
-                                                          sizeof(T_ZiyanFcSubscriptionPositionFused),
-                                                          &timestamp);
+        ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED, &position_fused,
+                                             sizeof(T_ZiyanFcSubscriptionPositionFused), &timestamp, NULL);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get value of topic position fused error.");
         }
@@ -408,24 +412,30 @@ static T_ZiyanReturnCode ZiyanTest_FcSubscriptionReceiveQuaternionCallback(const
 
     USER_UTIL_UNUSED(dataSize);
 
+    UtilMetrics_CounterAdd(&s_quaternionReceiveCount, 1);
+
+    if (s_userFcSubscriptionDataShow != true) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    if (s_userFcSubscriptionDataCnt++ % ZIYAN_DATA_SUBSCRIPTION_TOPIC_50_HZ != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
     pitch = (ziyan_f64_t) asinf(-2 * quaternion->q1 * quaternion->q3 + 2 * quaternion->q0 * quaternion->q2) * 57.3;
     roll = (ziyan_f64_t) atan2f(2 * quaternion->q2 * quaternion->q3 + 2 * quaternion->q0 * quaternion->q1,
                              -2 * quaternion->q1 * quaternion->q1 - 2 * quaternion->q2 * quaternion->q2 + 1) * 57.3;
     yaw = (ziyan_f64_t) atan2f(2 * quaternion->q1 * quaternion->q2 + 2 * quaternion->q0 * quaternion->q3,
                              -2 * quaternion->q2 * quaternion->q2 - 2 * quaternion->q3 * quaternion->q3 + 1) * 57.3;
 
-    if (s_userFcSubscriptionDataShow == true) {
-        if (s_userFcSubscriptionDataCnt++ % ZIYAN_DATA_SUBSCRIPTION_TOPIC_50_HZ == 0) {
-            USER_LOG_INFO("receive quaternion data.");
-            USER_LOG_INFO("timestamp: millisecond %u microsecond %u.", timestamp->millisecond,
-                          timestamp->microsecond);
-            USER_LOG_INFO("quaternion: %f %f %f %f.", quaternion->q0, quaternion->q1, quaternion->q2,
-                          quaternion->q3);
-
-            USER_LOG_INFO("euler angles: pitch = %.2f roll = %.2f yaw = %.2f.\r\n", pitch, roll, yaw);
-            ZiyanTest_WidgetLogAppend("pitch = %.2f roll = %.2f yaw = %.2f.", pitch, roll, yaw);
-        }
-    }
+    USER_LOG_INFO("receive quaternion data.");
+    USER_LOG_INFO("timestamp: millisecond %u microsecond %u.", timestamp->millisecond,
+                  timestamp->microsecond);
+    USER_LOG_INFO("quaternion: %f %f %f %f.", quaternion->q0, quaternion->q1, quaternion->q2,
+                  quaternion->q3);
+
+    USER_LOG_INFO("euler angles: pitch = %.2f roll = %.2f yaw = %.2f.\r\n", pitch, roll, yaw);
+    ZiyanTest_WidgetLogAppend("pitch = %.2f roll = %.2f yaw = %.2f.", pitch, roll, yaw);
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
@@ -440,8 +450,12 @@ static T_ZiyanReturnCode ZiyanTest_FcSubscriptionReceivePositionFusedCallback(co
     position_fused.longitude = ((T_ZiyanFcSubscriptionPositionFused*)data)->longitude;
     position_fused.altitude = ((T_ZiyanFcSubscriptionPositionFused*)data)->altitude;
     position_fused.visibleSatelliteNumber = ((T_ZiyanFcSubscriptionPositionFused*)data)->visibleSatelliteNumber;
+    UtilMetrics_CounterAdd(&s_positionFusedReceiveCount, 1);
+    UtilMetrics_GaugeSet(&s_visibleSatelliteNumber, position_fused.visibleSatelliteNumber);
     if (s_userFcSubscriptionDataShow == true) {
-        USER_LOG_INFO("position fused: %f %f %f : %d\n", position_fused.latitude, position_fused.longitude, position_fused.altitude, position_fused.visibleSatelliteNumber);
+        USER_LOG_EVERY_MS(INFO, FC_SUBSCRIPTION_LOG_PERIOD_MS, "position fused: %f %f %f : %d",
+                          position_fused.latitude, position_fused.longitude, position_fused.altitude,
+                          position_fused.visibleSatelliteNumber);
     }
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
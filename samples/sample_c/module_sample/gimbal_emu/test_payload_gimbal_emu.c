@@ -24,18 +24,36 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "math.h"
+#include <string.h>
 #include <ziyan_gimbal.h>
 #include "test_payload_gimbal_emu.h"
 #include "ziyan_fc_subscription.h"
+#include "fc_subscription/fc_subscription_cache.h"
+#include "fc_subscription/fc_subscription_dispatcher.h"
 #include "ziyan_logger.h"
 #include "ziyan_platform.h"
 #include "utils/util_misc.h"
+#include "utils/util_log.h"
+#include "utils/util_metrics.h"
+#include "utils/util_trace.h"
+#include "utils/util_seqlock.h"
+#include "utils/util_attitude.h"
 
 /* Private constants ---------------------------------------------------------*/
 #define PAYLOAD_GIMBAL_EMU_TASK_STACK_SIZE  (2048)
-#define PAYLOAD_GIMBAL_TASK_FREQ            1000
+#define PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS   1000
 #define PAYLOAD_GIMBAL_CALIBRATION_TIME_MS  2000
 #define PAYLOAD_GIMBAL_MIN_ACTION_TIME      5
+#define PAYLOAD_GIMBAL_TASK_IDLE_PERIOD_MS  1000
+#define PAYLOAD_GIMBAL_LIMIT_CHECK_PERIOD_MS    20 // speed rotations run until a limit, checked at this period
+#define PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_FREQ   ZIYAN_DATA_SUBSCRIPTION_TOPIC_100_HZ // 50 to 200 Hz
+#define PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_QUEUE_LENGTH  2
+#define PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_POLL_PERIOD_MS 20 // when the quaternion consumer can not be added
+#define PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_DEADBAND   0.5f // unit: 0.1 degree, smaller changes do not wake the task up
+#define PAYLOAD_GIMBAL_ACCELERATION_MAX     7200 // unit: 0.1 degree/s^2, with smoothing factor 0
+#define PAYLOAD_GIMBAL_SMOOTH_FACTOR_SCALE  10 // smoothing factor 30 accelerates 4 times slower than 0
+#define PAYLOAD_GIMBAL_LIMIT_TOLERANCE      0.01f // unit: 0.1 degree
+#define PAYLOAD_GIMBAL_TRAJECTORY_PHASE_COUNT   3
 
 /* Private types -------------------------------------------------------------*/
 typedef enum {
@@ -44,6 +62,45 @@ typedef enum {
     TEST_GIMBAL_CONTROL_TYPE_ANGLE = 2,
 } E_TestGimbalControlType;
 
+/* Constant acceleration phases, accelerating, cruising and decelerating, followed by a constant speed. */
+typedef struct {
+    float angle; // unit: 0.1 degree
+    float speed; // unit: 0.1 degree/s
+    float acceleration[PAYLOAD_GIMBAL_TRAJECTORY_PHASE_COUNT]; // unit: 0.1 degree/s^2
+    float duration[PAYLOAD_GIMBAL_TRAJECTORY_PHASE_COUNT]; // unit: s
+    float endAngle; // unit: 0.1 degree, at the end of the phases, kept exact so that rotations end on their target
+    float finalSpeed; // unit: 0.1 degree/s, after the phases
+} T_TestGimbalAxisTrajectory;
+
+typedef struct {
+    uint64_t startTimeUs;
+    T_TestGimbalAxisTrajectory pitch; // ground coordination
+    T_TestGimbalAxisTrajectory roll;
+    T_TestGimbalAxisTrajectory yaw;
+} T_TestGimbalTrajectory;
+
+typedef struct {
+    T_ZiyanQuaternion4f quaternion;
+    T_ZiyanAttitude3f attitude; // unit: 0.1 degree, ground coordination
+    uint64_t timeUs; // local time of reception
+} T_TestGimbalAircraftAttitudeSample;
+
+/* The aircraft attitude is interpolated between the two latest samples, one sample period late. */
+typedef struct {
+    T_TestGimbalAircraftAttitudeSample previous;
+    T_TestGimbalAircraftAttitudeSample latest;
+} T_TestGimbalAircraftAttitudeSamples;
+
+typedef struct {
+    T_TestGimbalTrajectory trajectory;
+    T_ZiyanAttitude3f aircraftAttitude; // the follow modes compensated the trajectory up to this attitude
+} T_TestGimbalAttitudeSnapshot;
+
+typedef struct {
+    T_ZiyanGimbalCalibrationState state; // progress is evaluated from the start time when the state is read
+    uint32_t startTime; // unit: ms
+} T_TestGimbalCalibrationSnapshot;
+
 /* Private functions declaration ---------------------------------------------*/
 static void *UserGimbal_Task(void *arg);
 static T_ZiyanReturnCode GetSystemState(T_ZiyanGimbalSystemState *systemState);
@@ -60,13 +117,33 @@ static T_ZiyanReturnCode SetMode(E_ZiyanGimbalMode mode);
 static T_ZiyanReturnCode Reset(E_ZiyanGimbalResetMode mode);
 static T_ZiyanReturnCode FineTuneAngle(T_ZiyanAttitude3d fineTuneAngle);
 static T_ZiyanReturnCode ZiyanTest_GimbalAngleLegalization(T_ZiyanAttitude3f *attitude, T_ZiyanAttitude3d aircraftAttitude,
+                                                       bool pitchRangeExtensionEnabledFlag,
                                                        T_ZiyanGimbalReachLimitFlag *reachLimitFlag);
-static T_ZiyanReturnCode
-ZiyanTest_GimbalCalculateSpeed(T_ZiyanAttitude3d originalAttitude, T_ZiyanAttitude3d targetAttitude, uint16_t actionTime,
-                             T_ZiyanAttitude3d *speed);
-static void ZiyanTest_GimbalSpeedLegalization(T_ZiyanAttitude3d *speed);
-static T_ZiyanReturnCode ZiyanTest_GimbalCalculateGroundAttitudeBaseQuaternion(T_ZiyanFcSubscriptionQuaternion quaternion,
-                                                                           T_ZiyanAttitude3d *attitude);
+static void ZiyanTest_GimbalPlanAngleRotation(T_ZiyanAttitude3d targetAttitude, uint16_t actionTime);
+static void ZiyanTest_GimbalPlanSpeedRotation(T_ZiyanAttitude3d speed);
+static void ZiyanTest_GimbalGetAxisLimit(E_ZiyanGimbalAxis axis, float *speedMax, float *acceleration);
+static void ZiyanTest_GimbalPlanAngle(T_TestGimbalAxisTrajectory *axisTrajectory, float targetAngle, float actionTime,
+                                      float speedMax, float acceleration);
+static void ZiyanTest_GimbalPlanSpeed(T_TestGimbalAxisTrajectory *axisTrajectory, float targetSpeed, float acceleration);
+static void ZiyanTest_GimbalHoldAngle(T_TestGimbalAxisTrajectory *axisTrajectory, float angle);
+static void ZiyanTest_GimbalShiftAngle(T_TestGimbalAxisTrajectory *axisTrajectory, float offset);
+static void ZiyanTest_GimbalAdvanceAxis(T_TestGimbalAxisTrajectory *axisTrajectory, float time);
+static void ZiyanTest_GimbalAdvanceTrajectory(T_TestGimbalTrajectory *trajectory, uint64_t timeUs);
+static float ZiyanTest_GimbalGetTrajectoryRemainingTime(const T_TestGimbalTrajectory *trajectory);
+static bool ZiyanTest_GimbalIsTrajectoryMoving(const T_TestGimbalTrajectory *trajectory);
+static void ZiyanTest_GimbalUpdateAttitude(uint64_t timeUs);
+static T_ZiyanReturnCode ZiyanTest_GimbalEvaluateAttitude(T_ZiyanGimbalAttitudeInformation *attitudeInformation,
+                                                          T_ZiyanAttitude3d *speed,
+                                                          T_ZiyanAttitude3d *aircraftAttitude);
+static void ZiyanTest_GimbalFollowAircraft(T_TestGimbalTrajectory *trajectory, E_ZiyanGimbalMode gimbalMode,
+                                           T_ZiyanAttitude3f aircraftAttitude, T_ZiyanAttitude3f lastAircraftAttitude);
+static T_ZiyanReturnCode ZiyanTest_GimbalReceiveQuaternionCallback(const uint8_t *data, uint16_t dataSize,
+                                                                   const T_ZiyanDataTimestamp *timestamp);
+static void ZiyanTest_GimbalReceiveAircraftAttitude(T_ZiyanFcSubscriptionQuaternion quaternion);
+static T_ZiyanAttitude3f ZiyanTest_GimbalGetAircraftAttitude(uint64_t timeUs);
+static void ZiyanTest_GimbalPublishAttitude(void);
+static void ZiyanTest_GimbalPublishSystemState(void);
+static void ZiyanTest_GimbalPublishCalibrationState(void);
 
 /* Private variables ---------------------------------------------------------*/
 static T_ZiyanTaskHandle s_userGimbalThread;
@@ -76,12 +153,10 @@ static bool s_rotatingFlag = false;
 static T_ZiyanMutexHandle s_commonMutex = {0};
 
 static T_ZiyanGimbalAttitudeInformation s_attitudeInformation = {0}; // unit: 0.1 degree, ground coordination
-static T_ZiyanAttitude3f s_attitudeHighPrecision = {0}; // unit: 0.1 degree, ground coordination
 static T_ZiyanGimbalCalibrationState s_calibrationState = {0};
-static T_ZiyanAttitude3d s_targetAttitude = {0}; // unit: 0.1 degree, ground coordination
-static T_ZiyanAttitude3d s_speed = {0}; // unit: 0.1 degree/s, ground coordination
+static T_TestGimbalTrajectory s_trajectory = {0}; // attitude as a function of time
 static T_ZiyanAttitude3d s_aircraftAttitude = {0}; // unit: 0.1 degree, ground coordination
-static T_ZiyanAttitude3d s_lastAircraftAttitude = {0}; // unit: 0.1 degree, ground coordination
+static T_ZiyanAttitude3f s_lastAircraftAttitude = {0}; // unit: 0.1 degree, ground coordination
 static E_TestGimbalControlType s_controlType = TEST_GIMBAL_CONTROL_TYPE_UNKNOWN;
 static const T_ZiyanAttitude3d s_jointAngleLimitMin = {-1200, -100, -1800}; // unit: 0.1 degree
 static const T_ZiyanAttitude3d s_jointAngleLimitMax = {300, 100, 1800}; // unit: 0.1 degree
@@ -93,6 +168,26 @@ static const T_ZiyanAttitude3d s_speedLimit = {1800, 1800, 1800}; // unit: 0.1 d
 static uint32_t s_calibrationStartTime = 0; // unit: ms
 static T_ZiyanMutexHandle s_attitudeMutex = NULL;
 static T_ZiyanMutexHandle s_calibrationMutex = NULL;
+static T_ZiyanSemaHandle s_gimbalEventSema = NULL;
+/* Getters read snapshots published after every change, the working state above stays owned by the mutex holders. */
+static T_UtilSeqlock s_attitudeSeqlock = {0};
+static T_TestGimbalAttitudeSnapshot s_attitudeSnapshot[UTIL_SEQLOCK_COPY_COUNT] = {0};
+static T_UtilSeqlock s_systemStateSeqlock = {0};
+static T_ZiyanGimbalSystemState s_systemStateSnapshot[UTIL_SEQLOCK_COPY_COUNT] = {0};
+static T_UtilSeqlock s_calibrationStateSeqlock = {0};
+static T_TestGimbalCalibrationSnapshot s_calibrationStateSnapshot[UTIL_SEQLOCK_COPY_COUNT] = {0};
+/* Mailbox from the quaternion callback, or the task when the quaternion is polled, which is the single writer. */
+static T_UtilSeqlock s_aircraftAttitudeSeqlock = {0};
+static T_TestGimbalAircraftAttitudeSamples s_aircraftAttitudeMailbox[UTIL_SEQLOCK_COPY_COUNT] = {0};
+static T_TestGimbalAircraftAttitudeSamples s_aircraftAttitudeSamples = {0}; // owned by the writer
+static bool s_aircraftAttitudePolledFlag = false;
+static T_FcSubscriptionDispatcherConsumerHandle s_aircraftAttitudeConsumer = NULL;
+static T_UtilMetric s_gimbalTaskPeriod = UTIL_METRICS_HISTOGRAM("ziyan_gimbal_task_period_microseconds",
+                                                                "Time between two iterations of the gimbal task.");
+static T_UtilMetric s_gimbalAircraftAttitudeErrorCount = UTIL_METRICS_COUNTER(
+    "ziyan_gimbal_aircraft_attitude_errors_total", "Failed updates of the aircraft attitude.");
+static T_UtilMetric s_gimbalRotatingState = UTIL_METRICS_GAUGE("ziyan_gimbal_rotating",
+                                                               "1 while the gimbal is rotating.");
 
 /* Exported functions definition ---------------------------------------------*/
 /**
@@ -113,6 +208,10 @@ T_ZiyanReturnCode ZiyanTest_GimbalStartService(void)
     s_calibrationState.calibratingFlag = false;
     s_calibrationState.lastCalibrationResult = true;
 
+    ZiyanTest_GimbalPublishAttitude();
+    ZiyanTest_GimbalPublishSystemState();
+    ZiyanTest_GimbalPublishCalibrationState();
+
     s_commonHandler.GetSystemState = GetSystemState;
     s_commonHandler.GetAttitudeInformation = GetAttitudeInformation;
     s_commonHandler.GetCalibrationState = GetCalibrationState;
@@ -149,6 +248,11 @@ T_ZiyanReturnCode ZiyanTest_GimbalStartService(void)
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
+    if (osalHandler->SemaphoreCreate(0, &s_gimbalEventSema) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("semaphore create error");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
     ziyanStat = ZiyanGimbal_Init();
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("init gimbal module error: 0x%08llX", ziyanStat);
@@ -190,6 +294,11 @@ T_ZiyanReturnCode ZiyanTest_GimbalDeInit(void)
         return ziyanStat;
     }
 
+    if (osalHandler->SemaphoreDestroy(s_gimbalEventSema) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("semaphore destroy error");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
     if (osalHandler->MutexDestroy(s_calibrationMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex destroy error");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -212,11 +321,10 @@ T_ZiyanReturnCode ZiyanTest_GimbalRotate(E_ZiyanGimbalRotationMode rotationMode,
                                      T_ZiyanGimbalRotationProperty rotationProperty,
                                      T_ZiyanAttitude3d rotationValue)
 {
-    T_ZiyanReturnCode ziyanStat;
     T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
     T_ZiyanAttitude3d targetAttitudeDTemp = {0};
     T_ZiyanAttitude3f targetAttitudeFTemp = {0};
-    T_ZiyanAttitude3d speedTemp = {0};
+    uint64_t currentTimeUs = 0;
     T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
 
     USER_LOG_DEBUG("gimbal rotation value invalid flag: pitch %d, roll %d, yaw %d.",
@@ -235,6 +343,15 @@ T_ZiyanReturnCode ZiyanTest_GimbalRotate(E_ZiyanGimbalRotationMode rotationMode,
         goto out2;
     }
 
+    if (osalHandler->GetTimeUs(&currentTimeUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("get current time error.");
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto out1;
+    }
+
+    // rotations start from the attitude at the time of the command
+    ZiyanTest_GimbalUpdateAttitude(currentTimeUs);
+
     switch (rotationMode) {
         case ZIYAN_GIMBAL_ROTATION_MODE_RELATIVE_ANGLE:
             USER_LOG_INFO("gimbal relative rotate angle: pitch %d, roll %d, yaw %d.", rotationValue.pitch,
@@ -260,23 +377,14 @@ T_ZiyanReturnCode ZiyanTest_GimbalRotate(E_ZiyanGimbalRotationMode rotationMode,
             targetAttitudeFTemp.pitch = targetAttitudeDTemp.pitch;
             targetAttitudeFTemp.roll = targetAttitudeDTemp.roll;
             targetAttitudeFTemp.yaw = targetAttitudeDTemp.yaw;
-            ZiyanTest_GimbalAngleLegalization(&targetAttitudeFTemp, s_aircraftAttitude, NULL);
+            ZiyanTest_GimbalAngleLegalization(&targetAttitudeFTemp, s_aircraftAttitude,
+                                              s_systemState.pitchRangeExtensionEnabledFlag, NULL);
             targetAttitudeDTemp.pitch = targetAttitudeFTemp.pitch;
             targetAttitudeDTemp.roll = targetAttitudeFTemp.roll;
             targetAttitudeDTemp.yaw = targetAttitudeFTemp.yaw;
 
-            s_targetAttitude = targetAttitudeDTemp;
-            s_rotatingFlag = true;
             s_controlType = TEST_GIMBAL_CONTROL_TYPE_ANGLE;
-
-            ziyanStat = ZiyanTest_GimbalCalculateSpeed(s_attitudeInformation.attitude, s_targetAttitude,
-                                                   rotationProperty.relativeAngleRotation.actionTime, &s_speed);
-            if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-                USER_LOG_ERROR("calculate gimbal rotation speed error: 0x%08llX.", ziyanStat);
-                returnCode = ziyanStat;
-                goto out1;
-            }
-
+            ZiyanTest_GimbalPlanAngleRotation(targetAttitudeDTemp, rotationProperty.relativeAngleRotation.actionTime);
             break;
         case ZIYAN_GIMBAL_ROTATION_MODE_ABSOLUTE_ANGLE:
             USER_LOG_INFO("gimbal absolute rotate angle: pitch %d, roll %d, yaw %d.", rotationValue.pitch,
@@ -308,23 +416,14 @@ T_ZiyanReturnCode ZiyanTest_GimbalRotate(E_ZiyanGimbalRotationMode rotationMode,
             targetAttitudeFTemp.pitch = targetAttitudeDTemp.pitch;
             targetAttitudeFTemp.roll = targetAttitudeDTemp.roll;
             targetAttitudeFTemp.yaw = targetAttitudeDTemp.yaw;
-            ZiyanTest_GimbalAngleLegalization(&targetAttitudeFTemp, s_aircraftAttitude, NULL);
+            ZiyanTest_GimbalAngleLegalization(&targetAttitudeFTemp, s_aircraftAttitude,
+                                              s_systemState.pitchRangeExtensionEnabledFlag, NULL);
             targetAttitudeDTemp.pitch = targetAttitudeFTemp.pitch;
             targetAttitudeDTemp.roll = targetAttitudeFTemp.roll;
             targetAttitudeDTemp.yaw = targetAttitudeFTemp.yaw;
 
-            s_targetAttitude = targetAttitudeDTemp;
-            s_rotatingFlag = true;
             s_controlType = TEST_GIMBAL_CONTROL_TYPE_ANGLE;
-
-            ziyanStat = ZiyanTest_GimbalCalculateSpeed(s_attitudeInformation.attitude, s_targetAttitude,
-                                                   rotationProperty.absoluteAngleRotation.actionTime, &s_speed);
-            if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-                USER_LOG_ERROR("calculate gimbal rotation speed error: 0x%08llX.", ziyanStat);
-                returnCode = ziyanStat;
-                goto out1;
-            }
-
+            ZiyanTest_GimbalPlanAngleRotation(targetAttitudeDTemp, rotationProperty.absoluteAngleRotation.actionTime);
             break;
         case ZIYAN_GIMBAL_ROTATION_MODE_SPEED:
             USER_LOG_INFO("gimbal rotate speed: pitch %d, roll %d, yaw %d.", rotationValue.pitch,
@@ -335,17 +434,8 @@ T_ZiyanReturnCode ZiyanTest_GimbalRotate(E_ZiyanGimbalRotationMode rotationMode,
                 goto out1;
             }
 
-            memcpy(&speedTemp, &rotationValue, sizeof(T_ZiyanAttitude3d));
-            ZiyanTest_GimbalSpeedLegalization(&speedTemp);
-            s_speed = speedTemp;
-
-            if (rotationValue.pitch != 0 || rotationValue.roll != 0 || rotationValue.yaw != 0) {
-                s_rotatingFlag = true;
-                s_controlType = TEST_GIMBAL_CONTROL_TYPE_SPEED;
-            } else {
-                s_rotatingFlag = false;
-            }
-
+            s_controlType = TEST_GIMBAL_CONTROL_TYPE_SPEED;
+            ZiyanTest_GimbalPlanSpeedRotation(rotationValue);
             break;
         default:
             USER_LOG_ERROR("gimbal rotation mode invalid: %d.", rotationMode);
@@ -353,16 +443,23 @@ T_ZiyanReturnCode ZiyanTest_GimbalRotate(E_ZiyanGimbalRotationMode rotationMode,
             goto out1;
     }
 
+    s_rotatingFlag = ZiyanTest_GimbalIsTrajectoryMoving(&s_trajectory);
+
+    // wake the task up to schedule the end of the rotation
+    osalHandler->SemaphorePost(s_gimbalEventSema);
+
 out1:
+    ZiyanTest_GimbalPublishAttitude();
+
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex unlock error");
+        USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex unlock error");
         returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
         goto out2;
     }
 
 out2:
     if (osalHandler->MutexUnlock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex unlock error");
+        USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex unlock error");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
@@ -379,176 +476,127 @@ out2:
 static void *UserGimbal_Task(void *arg)
 {
     T_ZiyanReturnCode ziyanStat;
-    static uint32_t step = 0;
     T_ZiyanFcSubscriptionQuaternion quaternion = {0};
     T_ZiyanDataTimestamp timestamp = {0};
-    T_ZiyanAttitude3f nextAttitude = {0};
-    T_ZiyanAttitude3f attitudeFTemp = {0};
     uint32_t currentTime = 0;
-    uint32_t progressTemp = 0;
+    uint32_t waitTimeMs = 0;
+    float remainingTime = 0;
+    uint64_t loopStartUs = 0;
+    uint64_t lastLoopStartUs = 0;
+    uint64_t aircraftAttitudePollUs = 0;
     T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_FcSubscriptionDispatcherConsumerConfig aircraftAttitudeConsumerConfig = {0};
 
     USER_UTIL_UNUSED(arg);
 
-    ziyanStat = ZiyanFcSubscription_SubscribeTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, ZIYAN_DATA_SUBSCRIPTION_TOPIC_10_HZ,
-                                               NULL);
+    // Only the latest attitude matters, older ones are dropped when the callbacks fall behind.
+    aircraftAttitudeConsumerConfig.name = "gimbal_aircraft_attitude";
+    aircraftAttitudeConsumerConfig.topic = ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION;
+    aircraftAttitudeConsumerConfig.frequency = PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_FREQ;
+    aircraftAttitudeConsumerConfig.callback = ZiyanTest_GimbalReceiveQuaternionCallback;
+    aircraftAttitudeConsumerConfig.queueLength = PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_QUEUE_LENGTH;
+    aircraftAttitudeConsumerConfig.dropPolicy = FC_SUBSCRIPTION_DISPATCHER_DROP_OLDEST;
+    ziyanStat = FcSubscriptionDispatcher_AddConsumer(&aircraftAttitudeConsumerConfig, &s_aircraftAttitudeConsumer);
     if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        if (ziyanStat == ZIYAN_ERROR_SUBSCRIPTION_MODULE_CODE_TOPIC_DUPLICATE) {
-            USER_LOG_WARN("Subscribe topic quaternion duplicate.");
-        } else {
-            USER_LOG_ERROR("Subscribe topic quaternion error.");
-        }
+        USER_LOG_WARN("Subscribe topic quaternion error, aircraft attitude is polled.");
+        s_aircraftAttitudePolledFlag = true;
     } else {
         USER_LOG_DEBUG("Subscribe topic quaternion success.");
     }
 
     while (1) {
-        osalHandler->TaskSleepMs(1000 / PAYLOAD_GIMBAL_TASK_FREQ);
-        step++;
-
-        if (osalHandler->MutexLock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("mutex lock error");
+        // Attitude is evaluated from the trajectory when it is read, the task only wakes up for commands, the end of
+        // rotations, aircraft attitude changes and calibration.
+        osalHandler->SemaphoreTimedWait(s_gimbalEventSema, waitTimeMs);
+        UTIL_TRACE_SPAN("gimbal step");
+        waitTimeMs = PAYLOAD_GIMBAL_TASK_IDLE_PERIOD_MS;
+
+        if (osalHandler->GetTimeUs(&loopStartUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "get current time error.");
             continue;
         }
 
-        if (osalHandler->MutexLock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("mutex lock error");
-            goto out2;
+        if (lastLoopStartUs != 0) {
+            UtilMetrics_HistogramRecord(&s_gimbalTaskPeriod, loopStartUs - lastLoopStartUs);
         }
-
-        if (USER_UTIL_IS_WORK_TURN(step, 1, PAYLOAD_GIMBAL_TASK_FREQ)) {
-            USER_LOG_DEBUG("gimbal attitude: pitch %d, roll %d, yaw %d.", s_attitudeInformation.attitude.pitch,
-                           s_attitudeInformation.attitude.roll, s_attitudeInformation.attitude.yaw);
-
-            USER_LOG_DEBUG("gimbal fine tune: pitch %d, roll %d, yaw %d.", s_systemState.fineTuneAngle.pitch,
-                           s_systemState.fineTuneAngle.roll, s_systemState.fineTuneAngle.yaw);
-        }
-
-        // update aircraft attitude
-        if (USER_UTIL_IS_WORK_TURN(step, 50, PAYLOAD_GIMBAL_TASK_FREQ)) {
-            ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION,
-                                                              (uint8_t *) &quaternion,
-                                                              sizeof(T_ZiyanFcSubscriptionQuaternion),
-                                                              &timestamp);
-            if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-                USER_LOG_ERROR("get topic quaternion value error.");
-            }
-
-            ziyanStat = ZiyanTest_GimbalCalculateGroundAttitudeBaseQuaternion(quaternion, &s_aircraftAttitude);
-            if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-                USER_LOG_ERROR("calculate and update aircraft attitude error.");
+        lastLoopStartUs = loopStartUs;
+
+        if (s_aircraftAttitudePolledFlag == true) {
+            if (loopStartUs - aircraftAttitudePollUs >= PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_POLL_PERIOD_MS * 1000) {
+                aircraftAttitudePollUs = loopStartUs;
+
+                // The owner of the subscription normally feeds the cache, the SDK is only asked when it does not.
+                ziyanStat = FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, &quaternion,
+                                                     sizeof(T_ZiyanFcSubscriptionQuaternion), &timestamp, NULL);
+                if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+                    ziyanStat = ZiyanFcSubscription_GetLatestValueOfTopic(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION,
+                                                                          (uint8_t *) &quaternion,
+                                                                          sizeof(T_ZiyanFcSubscriptionQuaternion),
+                                                                          &timestamp);
+                }
+                if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+                    USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "get topic quaternion value error.");
+                    UtilMetrics_CounterAdd(&s_gimbalAircraftAttitudeErrorCount, 1);
+                } else {
+                    ZiyanTest_GimbalReceiveAircraftAttitude(quaternion);
+                }
             }
+            waitTimeMs = PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_POLL_PERIOD_MS -
+                         USER_UTIL_MIN((loopStartUs - aircraftAttitudePollUs) / 1000,
+                                       PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_POLL_PERIOD_MS - 1);
         }
 
-        // stable control
-        switch (s_systemState.gimbalMode) {
-            case ZIYAN_GIMBAL_MODE_FREE:
-                break;
-            case ZIYAN_GIMBAL_MODE_FPV:
-                s_attitudeInformation.attitude.roll += (s_aircraftAttitude.roll - s_lastAircraftAttitude.roll);
-                s_attitudeInformation.attitude.yaw += (s_aircraftAttitude.yaw - s_lastAircraftAttitude.yaw);
-
-                s_attitudeHighPrecision.roll += (float) (s_aircraftAttitude.roll - s_lastAircraftAttitude.roll);
-                s_attitudeHighPrecision.yaw += (float) (s_aircraftAttitude.yaw - s_lastAircraftAttitude.yaw);
-
-                if (s_rotatingFlag == true && s_controlType == TEST_GIMBAL_CONTROL_TYPE_ANGLE) {
-                    s_targetAttitude.roll += (s_aircraftAttitude.roll - s_lastAircraftAttitude.roll);
-                    s_targetAttitude.yaw += (s_aircraftAttitude.yaw - s_lastAircraftAttitude.yaw);
-                }
-                break;
-            case ZIYAN_GIMBAL_MODE_YAW_FOLLOW:
-                s_attitudeInformation.attitude.yaw += (s_aircraftAttitude.yaw - s_lastAircraftAttitude.yaw);
-
-                s_attitudeHighPrecision.yaw += (float) (s_aircraftAttitude.yaw - s_lastAircraftAttitude.yaw);
-
-                if (s_rotatingFlag == true && s_controlType == TEST_GIMBAL_CONTROL_TYPE_ANGLE) {
-                    s_targetAttitude.yaw += (s_aircraftAttitude.yaw - s_lastAircraftAttitude.yaw);
-                }
-                break;
-            default:
-                USER_LOG_ERROR("gimbal mode invalid: %d.", s_systemState.gimbalMode);
+        if (osalHandler->MutexLock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex lock error");
+            continue;
         }
-        s_lastAircraftAttitude = s_aircraftAttitude;
-
-        attitudeFTemp.pitch = s_attitudeInformation.attitude.pitch;
-        attitudeFTemp.roll = s_attitudeInformation.attitude.roll;
-        attitudeFTemp.yaw = s_attitudeInformation.attitude.yaw;
-        ZiyanTest_GimbalAngleLegalization(&attitudeFTemp, s_aircraftAttitude, &s_attitudeInformation.reachLimitFlag);
-        s_attitudeInformation.attitude.pitch = attitudeFTemp.pitch;
-        s_attitudeInformation.attitude.roll = attitudeFTemp.roll;
-        s_attitudeInformation.attitude.yaw = attitudeFTemp.yaw;
-
-        ZiyanTest_GimbalAngleLegalization(&s_attitudeHighPrecision, s_aircraftAttitude, NULL);
-
-        attitudeFTemp.pitch = s_targetAttitude.pitch;
-        attitudeFTemp.roll = s_targetAttitude.roll;
-        attitudeFTemp.yaw = s_targetAttitude.yaw;
-        ZiyanTest_GimbalAngleLegalization(&attitudeFTemp, s_aircraftAttitude, NULL);
-        s_targetAttitude.pitch = attitudeFTemp.pitch;
-        s_targetAttitude.roll = attitudeFTemp.roll;
-        s_targetAttitude.yaw = attitudeFTemp.yaw;
-
-        // rotation
-        if (s_rotatingFlag != true)
-            goto out1;
 
-        nextAttitude.pitch =
-            (float) s_attitudeHighPrecision.pitch + (float) s_speed.pitch / (float) PAYLOAD_GIMBAL_TASK_FREQ;
-        nextAttitude.roll =
-            (float) s_attitudeHighPrecision.roll + (float) s_speed.roll / (float) PAYLOAD_GIMBAL_TASK_FREQ;
-        nextAttitude.yaw = (float) s_attitudeHighPrecision.yaw + (float) s_speed.yaw / (float) PAYLOAD_GIMBAL_TASK_FREQ;
-
-        if (s_controlType == TEST_GIMBAL_CONTROL_TYPE_ANGLE) {
-            nextAttitude.pitch =
-                (nextAttitude.pitch - s_targetAttitude.pitch) * s_speed.pitch >= 0 ? s_targetAttitude.pitch
-                                                                                   : nextAttitude.pitch;
-            nextAttitude.roll = (nextAttitude.roll - s_targetAttitude.roll) * s_speed.roll >= 0 ? s_targetAttitude.roll
-                                                                                                : nextAttitude.roll;
-            nextAttitude.yaw =
-                (nextAttitude.yaw - s_targetAttitude.yaw) * s_speed.yaw >= 0 ? s_targetAttitude.yaw : nextAttitude.yaw;
+        if (osalHandler->MutexLock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex lock error");
+            goto out2;
         }
 
-        ZiyanTest_GimbalAngleLegalization(&nextAttitude, s_aircraftAttitude, &s_attitudeInformation.reachLimitFlag);
-        s_attitudeInformation.attitude.pitch = nextAttitude.pitch;
-        s_attitudeInformation.attitude.roll = nextAttitude.roll;
-        s_attitudeInformation.attitude.yaw = nextAttitude.yaw;
+        USER_LOG_EVERY_MS(DEBUG, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "gimbal attitude: pitch %d, roll %d, yaw %d.",
+                          s_attitudeInformation.attitude.pitch, s_attitudeInformation.attitude.roll,
+                          s_attitudeInformation.attitude.yaw);
+        USER_LOG_EVERY_MS(DEBUG, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "gimbal fine tune: pitch %d, roll %d, yaw %d.",
+                          s_systemState.fineTuneAngle.pitch, s_systemState.fineTuneAngle.roll,
+                          s_systemState.fineTuneAngle.yaw);
 
-        s_attitudeHighPrecision.pitch = nextAttitude.pitch;
-        s_attitudeHighPrecision.roll = nextAttitude.roll;
-        s_attitudeHighPrecision.yaw = nextAttitude.yaw;
+        ZiyanTest_GimbalUpdateAttitude(loopStartUs);
+        ZiyanTest_GimbalPublishAttitude();
 
-        if (s_controlType == TEST_GIMBAL_CONTROL_TYPE_ANGLE) {
-            if (memcmp(&s_attitudeInformation.attitude, &s_targetAttitude, sizeof(T_ZiyanAttitude3d)) == 0) {
-                s_rotatingFlag = false;
-            }
-        } else if (s_controlType == TEST_GIMBAL_CONTROL_TYPE_SPEED) {
-            if ((s_attitudeInformation.reachLimitFlag.pitch == true || s_speed.pitch == 0) &&
-                (s_attitudeInformation.reachLimitFlag.roll == true || s_speed.roll == 0) &&
-                (s_attitudeInformation.reachLimitFlag.yaw == true || s_speed.yaw == 0)) {
-                s_rotatingFlag = false;
-            }
+        // wake up at the end of the rotation to report it
+        remainingTime = ZiyanTest_GimbalGetTrajectoryRemainingTime(&s_trajectory);
+        if (remainingTime > 0) {
+            waitTimeMs = USER_UTIL_MIN(waitTimeMs, (uint32_t) (remainingTime * 1000) + 1);
+        }
+        if (s_trajectory.pitch.finalSpeed != 0 || s_trajectory.roll.finalSpeed != 0 ||
+            s_trajectory.yaw.finalSpeed != 0) {
+            waitTimeMs = USER_UTIL_MIN(waitTimeMs, PAYLOAD_GIMBAL_LIMIT_CHECK_PERIOD_MS);
         }
 
-out1:
+        UtilMetrics_GaugeSet(&s_gimbalRotatingState, s_rotatingFlag == true ? 1 : 0);
+
         if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("mutex unlock error");
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex unlock error");
             goto out2;
         }
 
 out2:
         if (osalHandler->MutexUnlock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("mutex unlock error");
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex unlock error");
             continue;
         }
 
         ziyanStat = osalHandler->GetTimeMs(&currentTime);
         if (ziyanStat != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("get current time error: 0x%08llX.", ziyanStat);
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "get current time error: 0x%08llX.", ziyanStat);
             continue;
         }
 
         if (osalHandler->MutexLock(s_calibrationMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("mutex lock error");
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex lock error");
             continue;
         }
 
@@ -556,16 +604,19 @@ out2:
         if (s_calibrationState.calibratingFlag != true)
             goto unlockCalibrationMutex;
 
-        progressTemp = (currentTime - s_calibrationStartTime) * 100 / PAYLOAD_GIMBAL_CALIBRATION_TIME_MS;
-        if (progressTemp >= 100) {
+        if (currentTime - s_calibrationStartTime >= PAYLOAD_GIMBAL_CALIBRATION_TIME_MS) {
             s_calibrationState.calibratingFlag = false;
             s_calibrationState.currentCalibrationProgress = 100;
             s_calibrationState.currentCalibrationStage = ZIYAN_GIMBAL_CALIBRATION_STAGE_COMPLETE;
+            ZiyanTest_GimbalPublishCalibrationState();
+        } else {
+            waitTimeMs = USER_UTIL_MIN(waitTimeMs,
+                                       PAYLOAD_GIMBAL_CALIBRATION_TIME_MS - (currentTime - s_calibrationStartTime));
         }
 
 unlockCalibrationMutex:
         if (osalHandler->MutexUnlock(s_calibrationMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("mutex unlock error");
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "mutex unlock error");
             continue;
         }
     }
@@ -577,97 +628,55 @@ unlockCalibrationMutex:
 
 static T_ZiyanReturnCode GetSystemState(T_ZiyanGimbalSystemState *systemState)
 {
-    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
-
-    if (osalHandler->MutexLock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex lock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    *systemState = s_systemState;
-
-    if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex unlock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
+    UtilSeqlock_Read(&s_systemStateSeqlock, s_systemStateSnapshot, systemState, sizeof(T_ZiyanGimbalSystemState));
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 static T_ZiyanReturnCode GetAttitudeInformation(T_ZiyanGimbalAttitudeInformation *attitudeInformation)
 {
-    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
-
-    if (osalHandler->MutexLock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex lock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    *attitudeInformation = s_attitudeInformation;
-
-    if (osalHandler->MutexUnlock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex unlock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return ZiyanTest_GimbalEvaluateAttitude(attitudeInformation, NULL, NULL);
 }
 
 static T_ZiyanReturnCode GetCalibrationState(T_ZiyanGimbalCalibrationState *calibrationState)
 {
     T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_TestGimbalCalibrationSnapshot snapshot;
+    uint32_t currentTime;
 
-    if (osalHandler->MutexLock(s_calibrationMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex lock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    *calibrationState = s_calibrationState;
+    UtilSeqlock_Read(&s_calibrationStateSeqlock, s_calibrationStateSnapshot, &snapshot,
+                     sizeof(T_TestGimbalCalibrationSnapshot));
 
-    if (osalHandler->MutexUnlock(s_calibrationMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex unlock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    // the task only publishes the end of the calibration, progress in between follows the elapsed time
+    if (snapshot.state.calibratingFlag == true &&
+        osalHandler->GetTimeMs(&currentTime) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        snapshot.state.currentCalibrationProgress = (uint8_t) USER_UTIL_MIN(
+            (currentTime - snapshot.startTime) * 100 / PAYLOAD_GIMBAL_CALIBRATION_TIME_MS, 99);
     }
+    *calibrationState = snapshot.state;
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 static T_ZiyanReturnCode GetRotationSpeed(T_ZiyanAttitude3d *rotationSpeed)
 {
-    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
-
-    if (osalHandler->MutexLock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex lock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    *rotationSpeed = s_speed;
-
-    if (osalHandler->MutexUnlock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex unlock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return ZiyanTest_GimbalEvaluateAttitude(NULL, rotationSpeed, NULL);
 }
 
 static T_ZiyanReturnCode GetJointAngle(T_ZiyanAttitude3d *jointAngle)
 {
-    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_ZiyanReturnCode returnCode;
+    T_ZiyanGimbalAttitudeInformation attitudeInformation;
+    T_ZiyanAttitude3d aircraftAttitude;
 
-    if (osalHandler->MutexLock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex lock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    returnCode = ZiyanTest_GimbalEvaluateAttitude(&attitudeInformation, NULL, &aircraftAttitude);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
     }
 
-    jointAngle->pitch = s_attitudeInformation.attitude.pitch - s_aircraftAttitude.pitch;
-    jointAngle->roll = s_attitudeInformation.attitude.roll - s_aircraftAttitude.roll;
-    jointAngle->yaw = s_attitudeInformation.attitude.yaw - s_aircraftAttitude.yaw;
-
-    if (osalHandler->MutexUnlock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("mutex unlock error");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
+    jointAngle->pitch = attitudeInformation.attitude.pitch - aircraftAttitude.pitch;
+    jointAngle->roll = attitudeInformation.attitude.roll - aircraftAttitude.roll;
+    jointAngle->yaw = attitudeInformation.attitude.yaw - aircraftAttitude.yaw;
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
@@ -692,6 +701,10 @@ static T_ZiyanReturnCode StartCalibrate(void)
     s_calibrationState.calibratingFlag = true;
     s_calibrationState.currentCalibrationProgress = 0;
     s_calibrationState.currentCalibrationStage = ZIYAN_GIMBAL_CALIBRATION_STAGE_PROCRESSING;
+    ZiyanTest_GimbalPublishCalibrationState();
+
+    // wake the task up to start the calibration progress
+    osalHandler->SemaphorePost(s_gimbalEventSema);
 
     if (osalHandler->MutexUnlock(s_calibrationMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex unlock error");
@@ -717,6 +730,7 @@ static T_ZiyanReturnCode SetControllerSmoothFactor(uint8_t smoothingFactor, E_Zi
         s_systemState.smoothFactor.yaw = smoothingFactor;
     else
         USER_LOG_ERROR("axis is not supported.");
+    ZiyanTest_GimbalPublishSystemState();
 
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex unlock error");
@@ -737,6 +751,7 @@ static T_ZiyanReturnCode SetPitchRangeExtensionEnabled(bool enabledFlag)
     }
 
     s_systemState.pitchRangeExtensionEnabledFlag = enabledFlag;
+    ZiyanTest_GimbalPublishSystemState();
 
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex unlock error");
@@ -763,6 +778,7 @@ static T_ZiyanReturnCode SetControllerMaxSpeedPercentage(uint8_t maxSpeedPercent
         s_systemState.maxSpeedPercentage.yaw = maxSpeedPercentage;
     else
         USER_LOG_ERROR("axis is not supported.");
+    ZiyanTest_GimbalPublishSystemState();
 
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex unlock error");
@@ -789,6 +805,7 @@ static T_ZiyanReturnCode RestoreFactorySettings(void)
     memset(&s_systemState.smoothFactor, 0, sizeof(s_systemState.smoothFactor));
     s_systemState.maxSpeedPercentage.pitch = 1;
     s_systemState.maxSpeedPercentage.yaw = 1;
+    ZiyanTest_GimbalPublishSystemState();
 
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex unlock error");
@@ -800,29 +817,56 @@ static T_ZiyanReturnCode RestoreFactorySettings(void)
 
 static T_ZiyanReturnCode SetMode(E_ZiyanGimbalMode mode)
 {
+    T_ZiyanReturnCode ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    uint64_t currentTimeUs = 0;
     T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
 
     USER_LOG_INFO("set gimbal mode: %d.", mode);
 
-    if (osalHandler->MutexLock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+    if (osalHandler->MutexLock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex lock error");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
+    if (osalHandler->MutexLock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex lock error");
+        ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto unlock;
+    }
+
+    if (osalHandler->GetTimeUs(&currentTimeUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("get current time error.");
+        ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto unlockCommonMutex;
+    }
+
+    // follow the aircraft up to now in the previous mode
+    ZiyanTest_GimbalUpdateAttitude(currentTimeUs);
     s_systemState.gimbalMode = mode;
+    ZiyanTest_GimbalPublishSystemState();
+    ZiyanTest_GimbalPublishAttitude();
 
+unlockCommonMutex:
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex unlock error");
+        ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto unlock;
+    }
+
+unlock:
+    if (osalHandler->MutexUnlock(s_attitudeMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex unlock error");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
-    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return ziyanReturnCode;
 }
 
 static T_ZiyanReturnCode Reset(E_ZiyanGimbalResetMode mode)
 {
     T_ZiyanReturnCode ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    T_ZiyanAttitude3f attitudeFTemp = {0};
+    T_ZiyanAttitude3f resetAttitude = {0};
+    uint64_t currentTimeUs = 0;
     T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
 
     USER_LOG_INFO("reset gimbal: %d.", mode);
@@ -838,34 +882,31 @@ static T_ZiyanReturnCode Reset(E_ZiyanGimbalResetMode mode)
         goto unlock2;
     }
 
+    if (osalHandler->GetTimeUs(&currentTimeUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("get current time error.");
+        ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto unlock1;
+    }
+
+    ZiyanTest_GimbalUpdateAttitude(currentTimeUs);
+    resetAttitude.pitch = s_trajectory.pitch.angle;
+    resetAttitude.roll = s_trajectory.roll.angle;
+    resetAttitude.yaw = s_trajectory.yaw.angle;
+
     switch (mode) {
         case ZIYAN_GIMBAL_RESET_MODE_YAW:
-            s_attitudeInformation.attitude.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
-
-            s_attitudeHighPrecision.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
+            resetAttitude.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
             break;
         case ZIYAN_GIMBAL_RESET_MODE_PITCH_AND_YAW:
-            s_attitudeInformation.attitude.pitch = s_systemState.fineTuneAngle.pitch;
-            s_attitudeInformation.attitude.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
-
-            s_attitudeHighPrecision.pitch = s_systemState.fineTuneAngle.pitch;
-            s_attitudeHighPrecision.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
+            resetAttitude.pitch = s_systemState.fineTuneAngle.pitch;
+            resetAttitude.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
             break;
         case ZIYAN_GIMBAL_RESET_MODE_PITCH_DOWNWARD_UPWARD_AND_YAW:
-            s_attitudeInformation.attitude.pitch =
-                s_systemState.fineTuneAngle.pitch + (s_systemState.mountedUpward ? 900 : -900);
-            s_attitudeInformation.attitude.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
-
-            s_attitudeHighPrecision.pitch =
-                s_systemState.fineTuneAngle.pitch + (s_systemState.mountedUpward ? 900 : -900);
-            s_attitudeHighPrecision.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
+            resetAttitude.pitch = s_systemState.fineTuneAngle.pitch + (s_systemState.mountedUpward ? 900 : -900);
+            resetAttitude.yaw = s_aircraftAttitude.yaw + s_systemState.fineTuneAngle.yaw;
             break;
         case ZIYAN_GIMBAL_RESET_MODE_PITCH_DOWNWARD_UPWARD:
-            s_attitudeInformation.attitude.pitch =
-                s_systemState.fineTuneAngle.pitch + (s_systemState.mountedUpward ? 900 : -900);
-
-            s_attitudeHighPrecision.pitch =
-                s_systemState.fineTuneAngle.pitch + (s_systemState.mountedUpward ? 900 : -900);
+            resetAttitude.pitch = s_systemState.fineTuneAngle.pitch + (s_systemState.mountedUpward ? 900 : -900);
             break;
         default:
             USER_LOG_ERROR("reset mode is invalid: %d.", mode);
@@ -873,16 +914,12 @@ static T_ZiyanReturnCode Reset(E_ZiyanGimbalResetMode mode)
             goto unlock1;
     }
 
-    attitudeFTemp.pitch = s_attitudeInformation.attitude.pitch;
-    attitudeFTemp.roll = s_attitudeInformation.attitude.roll;
-    attitudeFTemp.yaw = s_attitudeInformation.attitude.yaw;
-    ZiyanTest_GimbalAngleLegalization(&attitudeFTemp, s_aircraftAttitude, &s_attitudeInformation.reachLimitFlag);
-    s_attitudeInformation.attitude.pitch = attitudeFTemp.pitch;
-    s_attitudeInformation.attitude.roll = attitudeFTemp.roll;
-    s_attitudeInformation.attitude.yaw = attitudeFTemp.yaw;
-    ZiyanTest_GimbalAngleLegalization(&s_attitudeHighPrecision, s_aircraftAttitude, NULL);
-
-    s_rotatingFlag = false;
+    // reset stops the rotation
+    ZiyanTest_GimbalHoldAngle(&s_trajectory.pitch, resetAttitude.pitch);
+    ZiyanTest_GimbalHoldAngle(&s_trajectory.roll, resetAttitude.roll);
+    ZiyanTest_GimbalHoldAngle(&s_trajectory.yaw, resetAttitude.yaw);
+    ZiyanTest_GimbalUpdateAttitude(currentTimeUs);
+    ZiyanTest_GimbalPublishAttitude();
 
 unlock1:
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
@@ -907,6 +944,7 @@ static T_ZiyanReturnCode FineTuneAngle(T_ZiyanAttitude3d fineTuneAngle)
     T_ZiyanGimbalReachLimitFlag fineTuneAngleReachLimitFlag = {0};
     T_ZiyanAttitude3d aircraftAttitudeResetted = {0};
     T_ZiyanAttitude3f attitudeFTemp = {0};
+    uint64_t currentTimeUs = 0;
     T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
 
     USER_LOG_INFO("gimbal fine tune angle: pitch %d, roll %d, yaw %d.", fineTuneAngle.pitch,
@@ -917,39 +955,40 @@ static T_ZiyanReturnCode FineTuneAngle(T_ZiyanAttitude3d fineTuneAngle)
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
-    s_attitudeInformation.attitude.pitch += fineTuneAngle.pitch;
-    s_attitudeInformation.attitude.roll += fineTuneAngle.roll;
-    s_attitudeInformation.attitude.yaw += fineTuneAngle.yaw;
-    attitudeFTemp.pitch = s_attitudeInformation.attitude.pitch;
-    attitudeFTemp.roll = s_attitudeInformation.attitude.roll;
-    attitudeFTemp.yaw = s_attitudeInformation.attitude.yaw;
-    ZiyanTest_GimbalAngleLegalization(&attitudeFTemp, s_aircraftAttitude, &attitudeReachLimitFlag);
-    s_attitudeInformation.attitude.pitch = attitudeFTemp.pitch;
-    s_attitudeInformation.attitude.roll = attitudeFTemp.roll;
-    s_attitudeInformation.attitude.yaw = attitudeFTemp.yaw;
-
-    s_attitudeHighPrecision.pitch += fineTuneAngle.pitch;
-    s_attitudeHighPrecision.roll += fineTuneAngle.roll;
-    s_attitudeHighPrecision.yaw += fineTuneAngle.yaw;
-    ZiyanTest_GimbalAngleLegalization(&s_attitudeHighPrecision, s_aircraftAttitude, NULL);
-
     if (osalHandler->MutexLock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex lock error");
         ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
         goto unlock;
     }
 
+    if (osalHandler->GetTimeUs(&currentTimeUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("get current time error.");
+        ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto unlockCommonMutex;
+    }
+
+    ZiyanTest_GimbalUpdateAttitude(currentTimeUs);
+    ZiyanTest_GimbalShiftAngle(&s_trajectory.pitch, fineTuneAngle.pitch);
+    ZiyanTest_GimbalShiftAngle(&s_trajectory.roll, fineTuneAngle.roll);
+    ZiyanTest_GimbalShiftAngle(&s_trajectory.yaw, fineTuneAngle.yaw);
+    ZiyanTest_GimbalUpdateAttitude(currentTimeUs);
+    attitudeReachLimitFlag = s_attitudeInformation.reachLimitFlag;
+
     s_systemState.fineTuneAngle.pitch += fineTuneAngle.pitch;
     s_systemState.fineTuneAngle.roll += fineTuneAngle.roll;
     s_systemState.fineTuneAngle.yaw += fineTuneAngle.yaw;
     attitudeFTemp.pitch = s_systemState.fineTuneAngle.pitch;
     attitudeFTemp.roll = s_systemState.fineTuneAngle.roll;
     attitudeFTemp.yaw = s_systemState.fineTuneAngle.yaw;
-    ZiyanTest_GimbalAngleLegalization(&attitudeFTemp, aircraftAttitudeResetted, &fineTuneAngleReachLimitFlag);
+    ZiyanTest_GimbalAngleLegalization(&attitudeFTemp, aircraftAttitudeResetted,
+                                      s_systemState.pitchRangeExtensionEnabledFlag, &fineTuneAngleReachLimitFlag);
     s_systemState.fineTuneAngle.pitch = attitudeFTemp.pitch;
     s_systemState.fineTuneAngle.roll = attitudeFTemp.roll;
     s_systemState.fineTuneAngle.yaw = attitudeFTemp.yaw;
+    ZiyanTest_GimbalPublishSystemState();
+    ZiyanTest_GimbalPublishAttitude();
 
+unlockCommonMutex:
     if (osalHandler->MutexUnlock(s_commonMutex) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("mutex unlock error");
         ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
@@ -977,18 +1016,18 @@ unlock:
  * @brief
  * @param attitude: in ground coordinate
  * @param aircraftAttitude: in ground coordinate
+ * @param pitchRangeExtensionEnabledFlag
  * @param reachLimitFlag
  * @return
  */
 static T_ZiyanReturnCode ZiyanTest_GimbalAngleLegalization(T_ZiyanAttitude3f *attitude, T_ZiyanAttitude3d aircraftAttitude,
+                                                       bool pitchRangeExtensionEnabledFlag,
                                                        T_ZiyanGimbalReachLimitFlag *reachLimitFlag)
 {
     T_ZiyanAttitude3d eulerAngleLimitMin;
     T_ZiyanAttitude3d eulerAngleLimitMax;
-    T_ZiyanAttitude3d angleLimitInBodyCoordinateFromEulerLimitMin = {0};
-    T_ZiyanAttitude3d angleLimitInBodyCoordinateFromEulerLimitMax = {0};
-    T_ZiyanAttitude3d finalAngleLimitInBodyCoordinateMin = {0};
-    T_ZiyanAttitude3d finalAngleLimitInBodyCoordinateMax = {0};
+    T_ZiyanAttitude3f finalAngleLimitInBodyCoordinateMin = {0};
+    T_ZiyanAttitude3f finalAngleLimitInBodyCoordinateMax = {0};
     T_ZiyanAttitude3f attitudeInBodyCoordinate = {0};
 
     if (attitude == NULL) {
@@ -999,31 +1038,23 @@ static T_ZiyanReturnCode ZiyanTest_GimbalAngleLegalization(T_ZiyanAttitude3f *at
     // calculate euler angle limit
     eulerAngleLimitMin = s_eulerAngleLimitMin;
     eulerAngleLimitMax = s_eulerAngleLimitMax;
-    if (s_systemState.pitchRangeExtensionEnabledFlag == true) {
+    if (pitchRangeExtensionEnabledFlag == true) {
         eulerAngleLimitMin.pitch = s_pitchEulerAngleExtensionMin;
         eulerAngleLimitMax.pitch = s_pitchEulerAngleExtensionMax;
     }
 
-    // transfer euler angle limit to angle limit in body coordinate
-    angleLimitInBodyCoordinateFromEulerLimitMin.pitch = eulerAngleLimitMin.pitch - aircraftAttitude.pitch;
-    angleLimitInBodyCoordinateFromEulerLimitMin.roll = eulerAngleLimitMin.roll - aircraftAttitude.roll;
-    angleLimitInBodyCoordinateFromEulerLimitMin.yaw = eulerAngleLimitMin.yaw - aircraftAttitude.yaw;
-    angleLimitInBodyCoordinateFromEulerLimitMax.pitch = eulerAngleLimitMax.pitch - aircraftAttitude.pitch;
-    angleLimitInBodyCoordinateFromEulerLimitMax.roll = eulerAngleLimitMax.roll - aircraftAttitude.roll;
-    angleLimitInBodyCoordinateFromEulerLimitMax.yaw = eulerAngleLimitMax.yaw - aircraftAttitude.yaw;
-
     // calculate final angle limit in body coordinate based on euler angle limit and joint angle limit
-    finalAngleLimitInBodyCoordinateMin.pitch = USER_UTIL_MAX(angleLimitInBodyCoordinateFromEulerLimitMin.pitch,
+    finalAngleLimitInBodyCoordinateMin.pitch = USER_UTIL_MAX(eulerAngleLimitMin.pitch - aircraftAttitude.pitch,
                                                              s_jointAngleLimitMin.pitch);
-    finalAngleLimitInBodyCoordinateMin.roll = USER_UTIL_MAX(angleLimitInBodyCoordinateFromEulerLimitMin.roll,
+    finalAngleLimitInBodyCoordinateMin.roll = USER_UTIL_MAX(eulerAngleLimitMin.roll - aircraftAttitude.roll,
                                                             s_jointAngleLimitMin.roll);
-    finalAngleLimitInBodyCoordinateMin.yaw = USER_UTIL_MAX(angleLimitInBodyCoordinateFromEulerLimitMin.yaw,
+    finalAngleLimitInBodyCoordinateMin.yaw = USER_UTIL_MAX(eulerAngleLimitMin.yaw - aircraftAttitude.yaw,
                                                            s_jointAngleLimitMin.yaw);
-    finalAngleLimitInBodyCoordinateMax.pitch = USER_UTIL_MIN(angleLimitInBodyCoordinateFromEulerLimitMax.pitch,
+    finalAngleLimitInBodyCoordinateMax.pitch = USER_UTIL_MIN(eulerAngleLimitMax.pitch - aircraftAttitude.pitch,
                                                              s_jointAngleLimitMax.pitch);
-    finalAngleLimitInBodyCoordinateMax.roll = USER_UTIL_MIN(angleLimitInBodyCoordinateFromEulerLimitMax.roll,
+    finalAngleLimitInBodyCoordinateMax.roll = USER_UTIL_MIN(eulerAngleLimitMax.roll - aircraftAttitude.roll,
                                                             s_jointAngleLimitMax.roll);
-    finalAngleLimitInBodyCoordinateMax.yaw = USER_UTIL_MIN(angleLimitInBodyCoordinateFromEulerLimitMax.yaw,
+    finalAngleLimitInBodyCoordinateMax.yaw = USER_UTIL_MIN(eulerAngleLimitMax.yaw - aircraftAttitude.yaw,
                                                            s_jointAngleLimitMax.yaw);
 
     // calculate gimbal attitude in body coordinate
@@ -1032,18 +1063,8 @@ static T_ZiyanReturnCode ZiyanTest_GimbalAngleLegalization(T_ZiyanAttitude3f *at
     attitudeInBodyCoordinate.yaw = attitude->yaw - (float) aircraftAttitude.yaw;
 
     // modify attitude based on final angle limit
-    attitudeInBodyCoordinate.pitch = USER_UTIL_MIN(attitudeInBodyCoordinate.pitch,
-                                                   (float) finalAngleLimitInBodyCoordinateMax.pitch);
-    attitudeInBodyCoordinate.pitch = USER_UTIL_MAX(attitudeInBodyCoordinate.pitch,
-                                                   (float) finalAngleLimitInBodyCoordinateMin.pitch);
-    attitudeInBodyCoordinate.roll = USER_UTIL_MIN(attitudeInBodyCoordinate.roll,
-                                                  (float) finalAngleLimitInBodyCoordinateMax.roll);
-    attitudeInBodyCoordinate.roll = USER_UTIL_MAX(attitudeInBodyCoordinate.roll,
-                                                  (float) finalAngleLimitInBodyCoordinateMin.roll);
-    attitudeInBodyCoordinate.yaw = USER_UTIL_MIN(attitudeInBodyCoordinate.yaw,
-                                                 (float) finalAngleLimitInBodyCoordinateMax.yaw);
-    attitudeInBodyCoordinate.yaw = USER_UTIL_MAX(attitudeInBodyCoordinate.yaw,
-                                                 (float) finalAngleLimitInBodyCoordinateMin.yaw);
+    UtilAttitude_Clamp(&attitudeInBodyCoordinate, &finalAngleLimitInBodyCoordinateMin,
+                       &finalAngleLimitInBodyCoordinateMax);
 
     // calculate gimbal attitude in ground coordinate
     attitude->pitch = attitudeInBodyCoordinate.pitch + (float) aircraftAttitude.pitch;
@@ -1064,87 +1085,489 @@ static T_ZiyanReturnCode ZiyanTest_GimbalAngleLegalization(T_ZiyanAttitude3f *at
 }
 
 /**
- * @brief
- * @param originalAttitude: unit: 0.1degree.
+ * @brief Plan a rotation to the target attitude, ending after the action time or as soon as the speed and
+ * acceleration limits allow.
  * @param targetAttitude: unit: 0.1degree.
  * @param actionTime: unit: 0.01s.
- * @param speed: unit: 0.1degree/s.
- * @return
+ * @note Called with s_attitudeMutex and s_commonMutex held, after ZiyanTest_GimbalUpdateAttitude().
  */
-static T_ZiyanReturnCode
-ZiyanTest_GimbalCalculateSpeed(T_ZiyanAttitude3d originalAttitude, T_ZiyanAttitude3d targetAttitude, uint16_t actionTime,
-                             T_ZiyanAttitude3d *speed)
+static void ZiyanTest_GimbalPlanAngleRotation(T_ZiyanAttitude3d targetAttitude, uint16_t actionTime)
 {
-    float pitchSpeedTemp = 0;
-    float rollSpeedTemp = 0;
-    float yawSpeedTemp = 0;
-
-    if (speed == NULL) {
-        USER_LOG_ERROR("input pointer is null.");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
-    }
+    float speedMax;
+    float acceleration;
 
     if (actionTime == 0) {
         USER_LOG_WARN("Input action time is zero, now used max speed to rotate.");
         actionTime = PAYLOAD_GIMBAL_MIN_ACTION_TIME;
     }
 
-    pitchSpeedTemp = (float) (targetAttitude.pitch - originalAttitude.pitch) / (float) actionTime * 100;
-    rollSpeedTemp = (float) (targetAttitude.roll - originalAttitude.roll) / (float) actionTime * 100;
-    yawSpeedTemp = (float) (targetAttitude.yaw - originalAttitude.yaw) / (float) actionTime * 100;
+    ZiyanTest_GimbalGetAxisLimit(ZIYAN_GIMBAL_AXIS_PITCH, &speedMax, &acceleration);
+    ZiyanTest_GimbalPlanAngle(&s_trajectory.pitch, targetAttitude.pitch, (float) actionTime / 100, speedMax,
+                              acceleration);
+    ZiyanTest_GimbalGetAxisLimit(ZIYAN_GIMBAL_AXIS_ROLL, &speedMax, &acceleration);
+    ZiyanTest_GimbalPlanAngle(&s_trajectory.roll, targetAttitude.roll, (float) actionTime / 100, speedMax,
+                              acceleration);
+    ZiyanTest_GimbalGetAxisLimit(ZIYAN_GIMBAL_AXIS_YAW, &speedMax, &acceleration);
+    ZiyanTest_GimbalPlanAngle(&s_trajectory.yaw, targetAttitude.yaw, (float) actionTime / 100, speedMax,
+                              acceleration);
+}
+
+/**
+ * @brief Plan a rotation accelerating from the current speed to the given one, kept until the attitude limits.
+ * @param speed: unit: 0.1degree/s.
+ * @note Called with s_attitudeMutex and s_commonMutex held, after ZiyanTest_GimbalUpdateAttitude().
+ */
+static void ZiyanTest_GimbalPlanSpeedRotation(T_ZiyanAttitude3d speed)
+{
+    float speedMax;
+    float acceleration;
+
+    ZiyanTest_GimbalGetAxisLimit(ZIYAN_GIMBAL_AXIS_PITCH, &speedMax, &acceleration);
+    ZiyanTest_GimbalPlanSpeed(&s_trajectory.pitch, USER_UTIL_MAX(USER_UTIL_MIN((float) speed.pitch, speedMax), -speedMax),
+                              acceleration);
+    ZiyanTest_GimbalGetAxisLimit(ZIYAN_GIMBAL_AXIS_ROLL, &speedMax, &acceleration);
+    ZiyanTest_GimbalPlanSpeed(&s_trajectory.roll, USER_UTIL_MAX(USER_UTIL_MIN((float) speed.roll, speedMax), -speedMax),
+                              acceleration);
+    ZiyanTest_GimbalGetAxisLimit(ZIYAN_GIMBAL_AXIS_YAW, &speedMax, &acceleration);
+    ZiyanTest_GimbalPlanSpeed(&s_trajectory.yaw, USER_UTIL_MAX(USER_UTIL_MIN((float) speed.yaw, speedMax), -speedMax),
+                              acceleration);
+}
 
-    speed->pitch = pitchSpeedTemp >= 0.0f ? (int32_t) (pitchSpeedTemp + 1) : (int32_t) (pitchSpeedTemp - 1);
-    speed->roll = rollSpeedTemp >= 0.0f ? (int32_t) (rollSpeedTemp + 1) : (int32_t) (rollSpeedTemp - 1);
-    speed->yaw = yawSpeedTemp >= 0.0f ? (int32_t) (yawSpeedTemp + 1) : (int32_t) (yawSpeedTemp - 1);
+/**
+ * @brief Get the speed and acceleration limits of an axis from s_speedLimit, the max speed percentage and the
+ * smoothing factor set by the SDK.
+ * @param speedMax: unit: 0.1degree/s.
+ * @param acceleration: unit: 0.1degree/s^2.
+ * @note Called with s_commonMutex held.
+ */
+static void ZiyanTest_GimbalGetAxisLimit(E_ZiyanGimbalAxis axis, float *speedMax, float *acceleration)
+{
+    uint8_t maxSpeedPercentage = 100;
+    uint8_t smoothFactor = 0;
+
+    if (axis == ZIYAN_GIMBAL_AXIS_PITCH) {
+        *speedMax = s_speedLimit.pitch;
+        maxSpeedPercentage = s_systemState.maxSpeedPercentage.pitch;
+        smoothFactor = s_systemState.smoothFactor.pitch;
+    } else if (axis == ZIYAN_GIMBAL_AXIS_YAW) {
+        *speedMax = s_speedLimit.yaw;
+        maxSpeedPercentage = s_systemState.maxSpeedPercentage.yaw;
+        smoothFactor = s_systemState.smoothFactor.yaw;
+    } else {
+        *speedMax = s_speedLimit.roll;
+    }
 
-    ZiyanTest_GimbalSpeedLegalization(speed);
+    // percentage 0 is not set yet
+    if (maxSpeedPercentage == 0 || maxSpeedPercentage > 100) {
+        maxSpeedPercentage = 100;
+    }
 
-    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    *speedMax = *speedMax * (float) maxSpeedPercentage / 100;
+    *acceleration = (float) PAYLOAD_GIMBAL_ACCELERATION_MAX * PAYLOAD_GIMBAL_SMOOTH_FACTOR_SCALE /
+                    (float) (PAYLOAD_GIMBAL_SMOOTH_FACTOR_SCALE + smoothFactor);
 }
 
-static void ZiyanTest_GimbalSpeedLegalization(T_ZiyanAttitude3d *speed)
+/**
+ * @brief Plan a trapezoidal speed profile from rest at the current angle to rest at the target angle.
+ * @param actionTime: unit: s, lengthened when the distance cannot be covered within the limits.
+ */
+static void ZiyanTest_GimbalPlanAngle(T_TestGimbalAxisTrajectory *axisTrajectory, float targetAngle, float actionTime,
+                                      float speedMax, float acceleration)
 {
-    speed->pitch = speed->pitch > s_speedLimit.pitch ? s_speedLimit.pitch : speed->pitch;
-    speed->roll = speed->roll > s_speedLimit.roll ? s_speedLimit.roll : speed->roll;
-    speed->yaw = speed->yaw > s_speedLimit.yaw ? s_speedLimit.yaw : speed->yaw;
+    float distance = fabsf(targetAngle - axisTrajectory->angle);
+    float direction = targetAngle >= axisTrajectory->angle ? 1.0f : -1.0f;
+    float minActionTime;
+    float discriminant;
+    float cruiseSpeed;
+    float accelerationTime;
+
+    ZiyanTest_GimbalHoldAngle(axisTrajectory, axisTrajectory->angle);
+    if (distance < PAYLOAD_GIMBAL_LIMIT_TOLERANCE || speedMax <= 0) {
+        return;
+    }
 
-    speed->pitch = speed->pitch < (0 - s_speedLimit.pitch) ? (0 - s_speedLimit.pitch) : speed->pitch;
-    speed->roll = speed->roll < (0 - s_speedLimit.roll) ? (0 - s_speedLimit.roll) : speed->roll;
-    speed->yaw = speed->yaw < (0 - s_speedLimit.yaw) ? (0 - s_speedLimit.yaw) : speed->yaw;
+    // the shortest profile is a triangle when the distance is too short to reach the max speed
+    if (distance >= speedMax * speedMax / acceleration) {
+        minActionTime = distance / speedMax + speedMax / acceleration;
+    } else {
+        minActionTime = 2 * sqrtf(distance / acceleration);
+    }
+    actionTime = USER_UTIL_MAX(actionTime, minActionTime);
+
+    // cruise speed covering the distance in the action time, the smaller root leaves time to accelerate and brake
+    discriminant = acceleration * actionTime * acceleration * actionTime - 4 * acceleration * distance;
+    cruiseSpeed = (acceleration * actionTime - sqrtf(USER_UTIL_MAX(discriminant, 0.0f))) / 2;
+    accelerationTime = cruiseSpeed / acceleration;
+
+    axisTrajectory->acceleration[0] = direction * acceleration;
+    axisTrajectory->duration[0] = accelerationTime;
+    axisTrajectory->acceleration[1] = 0;
+    axisTrajectory->duration[1] = USER_UTIL_MAX(distance / cruiseSpeed - accelerationTime, 0.0f);
+    axisTrajectory->acceleration[2] = -direction * acceleration;
+    axisTrajectory->duration[2] = accelerationTime;
+    axisTrajectory->endAngle = targetAngle;
 }
 
 /**
- * @brief
- * @param quaternion
- * @param attitude Unit: 0.1 degree.
- * @return
+ * @brief Plan a ramp from the current speed to the target speed, kept afterwards.
  */
-static T_ZiyanReturnCode ZiyanTest_GimbalCalculateGroundAttitudeBaseQuaternion(T_ZiyanFcSubscriptionQuaternion quaternion,
-                                                                           T_ZiyanAttitude3d *attitude)
+static void ZiyanTest_GimbalPlanSpeed(T_TestGimbalAxisTrajectory *axisTrajectory, float targetSpeed, float acceleration)
 {
-    double aircraftPitchInRad;
-    double aircraftRollInRad;
-    double aircraftYawInRad;
+    float startSpeed = axisTrajectory->speed;
+    float rampTime = fabsf(targetSpeed - startSpeed) / acceleration;
 
-    if (attitude == NULL) {
-        USER_LOG_ERROR("Input argument is null.");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    ZiyanTest_GimbalHoldAngle(axisTrajectory, axisTrajectory->angle);
+
+    axisTrajectory->speed = startSpeed;
+    axisTrajectory->acceleration[0] = targetSpeed >= startSpeed ? acceleration : -acceleration;
+    axisTrajectory->duration[0] = rampTime;
+    axisTrajectory->endAngle = axisTrajectory->angle + (startSpeed + targetSpeed) / 2 * rampTime;
+    axisTrajectory->finalSpeed = targetSpeed;
+}
+
+static void ZiyanTest_GimbalHoldAngle(T_TestGimbalAxisTrajectory *axisTrajectory, float angle)
+{
+    memset(axisTrajectory, 0, sizeof(T_TestGimbalAxisTrajectory));
+    axisTrajectory->angle = angle;
+    axisTrajectory->endAngle = angle;
+}
+
+static void ZiyanTest_GimbalShiftAngle(T_TestGimbalAxisTrajectory *axisTrajectory, float offset)
+{
+    axisTrajectory->angle += offset;
+    axisTrajectory->endAngle += offset;
+}
+
+/**
+ * @brief Move the start of an axis trajectory forward, dropping the elapsed part of its phases.
+ * @param time: unit: s.
+ */
+static void ZiyanTest_GimbalAdvanceAxis(T_TestGimbalAxisTrajectory *axisTrajectory, float time)
+{
+    float phaseTime;
+    bool isPhaseLeft = false;
+    uint8_t i;
+
+    for (i = 0; i < PAYLOAD_GIMBAL_TRAJECTORY_PHASE_COUNT; i++) {
+        phaseTime = USER_UTIL_MIN(time, axisTrajectory->duration[i]);
+        axisTrajectory->angle += axisTrajectory->speed * phaseTime +
+                                 axisTrajectory->acceleration[i] * phaseTime * phaseTime / 2;
+        axisTrajectory->speed += axisTrajectory->acceleration[i] * phaseTime;
+        axisTrajectory->duration[i] -= phaseTime;
+        time -= phaseTime;
+
+        if (axisTrajectory->duration[i] > 0) {
+            isPhaseLeft = true;
+        }
+    }
+
+    // past the phases the angle is derived from the exact end angle, rounding errors do not build up
+    if (isPhaseLeft != true) {
+        axisTrajectory->endAngle += axisTrajectory->finalSpeed * time;
+        axisTrajectory->angle = axisTrajectory->endAngle;
+        axisTrajectory->speed = axisTrajectory->finalSpeed;
+    }
+}
+
+static void ZiyanTest_GimbalAdvanceTrajectory(T_TestGimbalTrajectory *trajectory, uint64_t timeUs)
+{
+    float time;
+
+    // a clock stepping back restarts the trajectory from where it is
+    if (timeUs <= trajectory->startTimeUs) {
+        trajectory->startTimeUs = timeUs;
+        return;
+    }
+
+    time = (float) (timeUs - trajectory->startTimeUs) / 1000000;
+    ZiyanTest_GimbalAdvanceAxis(&trajectory->pitch, time);
+    ZiyanTest_GimbalAdvanceAxis(&trajectory->roll, time);
+    ZiyanTest_GimbalAdvanceAxis(&trajectory->yaw, time);
+    trajectory->startTimeUs = timeUs;
+}
+
+/**
+ * @brief Get the time left until the phases of all axes are complete.
+ * @return Unit: s.
+ */
+static float ZiyanTest_GimbalGetTrajectoryRemainingTime(const T_TestGimbalTrajectory *trajectory)
+{
+    float pitchTime = 0;
+    float rollTime = 0;
+    float yawTime = 0;
+    uint8_t i;
+
+    for (i = 0; i < PAYLOAD_GIMBAL_TRAJECTORY_PHASE_COUNT; i++) {
+        pitchTime += trajectory->pitch.duration[i];
+        rollTime += trajectory->roll.duration[i];
+        yawTime += trajectory->yaw.duration[i];
+    }
+
+    return USER_UTIL_MAX(USER_UTIL_MAX(pitchTime, rollTime), yawTime);
+}
+
+static bool ZiyanTest_GimbalIsTrajectoryMoving(const T_TestGimbalTrajectory *trajectory)
+{
+    return ZiyanTest_GimbalGetTrajectoryRemainingTime(trajectory) > 0 || trajectory->pitch.finalSpeed != 0 ||
+           trajectory->roll.finalSpeed != 0 || trajectory->yaw.finalSpeed != 0;
+}
+
+/**
+ * @brief Move the trajectory start to the given time, follow the aircraft and apply the attitude limits. An axis pushed
+ * against a limit stops there, so that the next rotation starts from the limit.
+ * @note Called with s_attitudeMutex and s_commonMutex held.
+ */
+static void ZiyanTest_GimbalUpdateAttitude(uint64_t timeUs)
+{
+    T_ZiyanAttitude3f attitude;
+    T_ZiyanAttitude3f aircraftAttitude;
+
+    aircraftAttitude = ZiyanTest_GimbalGetAircraftAttitude(timeUs);
+
+    ZiyanTest_GimbalAdvanceTrajectory(&s_trajectory, timeUs);
+    ZiyanTest_GimbalFollowAircraft(&s_trajectory, s_systemState.gimbalMode, aircraftAttitude, s_lastAircraftAttitude);
+    s_lastAircraftAttitude = aircraftAttitude;
+    s_aircraftAttitude.pitch = (int32_t) roundf(aircraftAttitude.pitch);
+    s_aircraftAttitude.roll = (int32_t) roundf(aircraftAttitude.roll);
+    s_aircraftAttitude.yaw = (int32_t) roundf(aircraftAttitude.yaw);
+
+    attitude.pitch = s_trajectory.pitch.angle;
+    attitude.roll = s_trajectory.roll.angle;
+    attitude.yaw = s_trajectory.yaw.angle;
+    ZiyanTest_GimbalAngleLegalization(&attitude, s_aircraftAttitude, s_systemState.pitchRangeExtensionEnabledFlag,
+                                      &s_attitudeInformation.reachLimitFlag);
+
+    if (fabsf(attitude.pitch - s_trajectory.pitch.angle) > PAYLOAD_GIMBAL_LIMIT_TOLERANCE) {
+        ZiyanTest_GimbalHoldAngle(&s_trajectory.pitch, attitude.pitch);
+    }
+    if (fabsf(attitude.roll - s_trajectory.roll.angle) > PAYLOAD_GIMBAL_LIMIT_TOLERANCE) {
+        ZiyanTest_GimbalHoldAngle(&s_trajectory.roll, attitude.roll);
     }
+    if (fabsf(attitude.yaw - s_trajectory.yaw.angle) > PAYLOAD_GIMBAL_LIMIT_TOLERANCE) {
+        ZiyanTest_GimbalHoldAngle(&s_trajectory.yaw, attitude.yaw);
+    }
+
+    s_attitudeInformation.attitude.pitch = attitude.pitch;
+    s_attitudeInformation.attitude.roll = attitude.roll;
+    s_attitudeInformation.attitude.yaw = attitude.yaw;
+    s_rotatingFlag = ZiyanTest_GimbalIsTrajectoryMoving(&s_trajectory);
+}
+
+/**
+ * @brief Evaluate the published trajectory at the current time, without locking.
+ * @param attitudeInformation: may be NULL.
+ * @param speed: unit: 0.1 degree/s, 0 on axes held by a limit, may be NULL.
+ * @param aircraftAttitude: aircraft attitude the limits were applied with, may be NULL.
+ * @note The trajectory follows the aircraft attitude interpolated at the current time as well.
+ * @return Execution result.
+ */
+static T_ZiyanReturnCode ZiyanTest_GimbalEvaluateAttitude(T_ZiyanGimbalAttitudeInformation *attitudeInformation,
+                                                          T_ZiyanAttitude3d *speed,
+                                                          T_ZiyanAttitude3d *aircraftAttitude)
+{
+    T_TestGimbalAttitudeSnapshot snapshot;
+    T_ZiyanGimbalSystemState systemState;
+    T_ZiyanGimbalReachLimitFlag reachLimitFlag;
+    T_ZiyanAttitude3f attitude;
+    T_ZiyanAttitude3f currentAircraftAttitude;
+    T_ZiyanAttitude3d roundedAircraftAttitude;
+    uint64_t currentTimeUs = 0;
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+
+    UtilSeqlock_Read(&s_attitudeSeqlock, s_attitudeSnapshot, &snapshot, sizeof(T_TestGimbalAttitudeSnapshot));
+    UtilSeqlock_Read(&s_systemStateSeqlock, s_systemStateSnapshot, &systemState, sizeof(T_ZiyanGimbalSystemState));
+
+    if (osalHandler->GetTimeUs(&currentTimeUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("get current time error.");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    currentAircraftAttitude = ZiyanTest_GimbalGetAircraftAttitude(currentTimeUs);
+    roundedAircraftAttitude.pitch = (int32_t) roundf(currentAircraftAttitude.pitch);
+    roundedAircraftAttitude.roll = (int32_t) roundf(currentAircraftAttitude.roll);
+    roundedAircraftAttitude.yaw = (int32_t) roundf(currentAircraftAttitude.yaw);
+
+    ZiyanTest_GimbalAdvanceTrajectory(&snapshot.trajectory, currentTimeUs);
+    ZiyanTest_GimbalFollowAircraft(&snapshot.trajectory, systemState.gimbalMode, currentAircraftAttitude,
+                                   snapshot.aircraftAttitude);
+    attitude.pitch = snapshot.trajectory.pitch.angle;
+    attitude.roll = snapshot.trajectory.roll.angle;
+    attitude.yaw = snapshot.trajectory.yaw.angle;
+    ZiyanTest_GimbalAngleLegalization(&attitude, roundedAircraftAttitude, systemState.pitchRangeExtensionEnabledFlag,
+                                      &reachLimitFlag);
+
+    if (attitudeInformation != NULL) {
+        attitudeInformation->attitude.pitch = attitude.pitch;
+        attitudeInformation->attitude.roll = attitude.roll;
+        attitudeInformation->attitude.yaw = attitude.yaw;
+        attitudeInformation->reachLimitFlag = reachLimitFlag;
+    }
+
+    if (speed != NULL) {
+        speed->pitch = fabsf(attitude.pitch - snapshot.trajectory.pitch.angle) > PAYLOAD_GIMBAL_LIMIT_TOLERANCE ? 0 :
+                       (int32_t) snapshot.trajectory.pitch.speed;
+        speed->roll = fabsf(attitude.roll - snapshot.trajectory.roll.angle) > PAYLOAD_GIMBAL_LIMIT_TOLERANCE ? 0 :
+                      (int32_t) snapshot.trajectory.roll.speed;
+        speed->yaw = fabsf(attitude.yaw - snapshot.trajectory.yaw.angle) > PAYLOAD_GIMBAL_LIMIT_TOLERANCE ? 0 :
+                     (int32_t) snapshot.trajectory.yaw.speed;
+    }
+
+    if (aircraftAttitude != NULL) {
+        *aircraftAttitude = roundedAircraftAttitude;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
 
-    aircraftPitchInRad = asin(2 * ((double) quaternion.q0 * quaternion.q2 - (double) quaternion.q3 * quaternion.q1));
-    attitude->pitch = aircraftPitchInRad * 180 / ZIYAN_PI * 10;
+/**
+ * @brief Stable control, shift the follow axes of the whole trajectory by the aircraft rotation so that targets move
+ * with the aircraft.
+ * @param aircraftAttitude: current aircraft attitude.
+ * @param lastAircraftAttitude: aircraft attitude the trajectory was compensated up to.
+ */
+static void ZiyanTest_GimbalFollowAircraft(T_TestGimbalTrajectory *trajectory, E_ZiyanGimbalMode gimbalMode,
+                                           T_ZiyanAttitude3f aircraftAttitude, T_ZiyanAttitude3f lastAircraftAttitude)
+{
+    // The offsets accumulate as plain differences, the angle legalization clamps the result to the limits.
+    switch (gimbalMode) {
+        case ZIYAN_GIMBAL_MODE_FREE:
+            break;
+        case ZIYAN_GIMBAL_MODE_FPV:
+            ZiyanTest_GimbalShiftAngle(&trajectory->roll, aircraftAttitude.roll - lastAircraftAttitude.roll);
+            ZiyanTest_GimbalShiftAngle(&trajectory->yaw, aircraftAttitude.yaw - lastAircraftAttitude.yaw);
+            break;
+        case ZIYAN_GIMBAL_MODE_YAW_FOLLOW:
+            ZiyanTest_GimbalShiftAngle(&trajectory->yaw, aircraftAttitude.yaw - lastAircraftAttitude.yaw);
+            break;
+        default:
+            USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "gimbal mode invalid: %d.", gimbalMode);
+    }
+}
+
+static T_ZiyanReturnCode ZiyanTest_GimbalReceiveQuaternionCallback(const uint8_t *data, uint16_t dataSize,
+                                                                   const T_ZiyanDataTimestamp *timestamp)
+{
+    T_ZiyanFcSubscriptionQuaternion quaternion;
 
-    aircraftRollInRad = atan2(2 * ((double) quaternion.q0 * quaternion.q1 + (double) quaternion.q2 * quaternion.q3),
-                              (double) 1 -
-                              2 * ((double) quaternion.q1 * quaternion.q1 + (double) quaternion.q2 * quaternion.q2));
-    attitude->roll = aircraftRollInRad * 180 / ZIYAN_PI * 10;
+    USER_UTIL_UNUSED(timestamp);
 
-    aircraftYawInRad = atan2(2 * ((double) quaternion.q0 * quaternion.q3 + (double) quaternion.q1 * quaternion.q2),
-                             (double) 1 -
-                             2 * ((double) quaternion.q2 * quaternion.q2 + (double) quaternion.q3 * quaternion.q3));
-    attitude->yaw = aircraftYawInRad * 180 / ZIYAN_PI * 10;
+    if (data == NULL || dataSize < sizeof(T_ZiyanFcSubscriptionQuaternion)) {
+        USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "quaternion data invalid, size %d.", dataSize);
+        UtilMetrics_CounterAdd(&s_gimbalAircraftAttitudeErrorCount, 1);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    memcpy(&quaternion, data, sizeof(T_ZiyanFcSubscriptionQuaternion));
+    ZiyanTest_GimbalReceiveAircraftAttitude(quaternion);
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
+/**
+ * @brief Publish a new aircraft attitude sample to the mailbox and wake the task up. Samples within the deadband of
+ * the latest published one are dropped, so that a still aircraft costs nothing.
+ * @note Called from the quaternion callback, or from the task when the quaternion is polled.
+ */
+static void ZiyanTest_GimbalReceiveAircraftAttitude(T_ZiyanFcSubscriptionQuaternion quaternion)
+{
+    T_TestGimbalAircraftAttitudeSample sample = {0};
+    T_TestGimbalAircraftAttitudeSample *latest = &s_aircraftAttitudeSamples.latest;
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+
+    if (osalHandler->GetTimeUs(&sample.timeUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_EVERY_MS(ERROR, PAYLOAD_GIMBAL_TASK_LOG_PERIOD_MS, "get current time error.");
+        UtilMetrics_CounterAdd(&s_gimbalAircraftAttitudeErrorCount, 1);
+        return;
+    }
+
+    sample.quaternion.q0 = quaternion.q0;
+    sample.quaternion.q1 = quaternion.q1;
+    sample.quaternion.q2 = quaternion.q2;
+    sample.quaternion.q3 = quaternion.q3;
+    UtilAttitude_QuaternionNormalize(&sample.quaternion);
+    UtilAttitude_QuaternionToEuler(&sample.quaternion, &sample.attitude);
+
+    if (latest->timeUs != 0 &&
+        fabsf(sample.attitude.pitch - latest->attitude.pitch) < PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_DEADBAND &&
+        fabsf(UtilAttitude_WrapAngle(sample.attitude.roll - latest->attitude.roll)) <
+        PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_DEADBAND &&
+        fabsf(UtilAttitude_WrapAngle(sample.attitude.yaw - latest->attitude.yaw)) <
+        PAYLOAD_GIMBAL_AIRCRAFT_ATTITUDE_DEADBAND) {
+        // keep the reception time private, so that the next move is interpolated over one sample period
+        latest->timeUs = sample.timeUs;
+        return;
+    }
+
+    s_aircraftAttitudeSamples.previous = *latest;
+    *latest = sample;
+    UtilSeqlock_Write(&s_aircraftAttitudeSeqlock, s_aircraftAttitudeMailbox, &s_aircraftAttitudeSamples,
+                      sizeof(T_TestGimbalAircraftAttitudeSamples));
+
+    osalHandler->SemaphorePost(s_gimbalEventSema);
+}
+
+/**
+ * @brief Get the aircraft attitude at the given time, interpolated along the rotation between the two latest samples
+ * delayed by one sample period, so that the compensation is smooth whatever the subscription frequency.
+ * @return Unit: 0.1 degree, ground coordination.
+ */
+static T_ZiyanAttitude3f ZiyanTest_GimbalGetAircraftAttitude(uint64_t timeUs)
+{
+    T_TestGimbalAircraftAttitudeSamples samples;
+    T_ZiyanQuaternion4f quaternion;
+    T_ZiyanAttitude3f attitude;
+    float ratio;
+
+    UtilSeqlock_Read(&s_aircraftAttitudeSeqlock, s_aircraftAttitudeMailbox, &samples,
+                     sizeof(T_TestGimbalAircraftAttitudeSamples));
+
+    if (samples.previous.timeUs == 0 || samples.latest.timeUs <= samples.previous.timeUs ||
+        timeUs >= samples.latest.timeUs + (samples.latest.timeUs - samples.previous.timeUs)) {
+        return samples.latest.attitude;
+    }
+
+    ratio = timeUs > samples.latest.timeUs ?
+            (float) (timeUs - samples.latest.timeUs) / (float) (samples.latest.timeUs - samples.previous.timeUs) : 0;
+    UtilAttitude_Slerp(&samples.previous.quaternion, &samples.latest.quaternion, ratio, &quaternion);
+    UtilAttitude_QuaternionToEuler(&quaternion, &attitude);
+
+    return attitude;
+}
+
+/**
+ * @brief Publish the trajectory and aircraft attitude the getters evaluate the attitude from.
+ * @note Called with s_attitudeMutex held, which serializes the writers of the snapshot.
+ */
+static void ZiyanTest_GimbalPublishAttitude(void)
+{
+    T_TestGimbalAttitudeSnapshot snapshot;
+
+    snapshot.trajectory = s_trajectory;
+    snapshot.aircraftAttitude = s_lastAircraftAttitude;
+
+    UtilSeqlock_Write(&s_attitudeSeqlock, s_attitudeSnapshot, &snapshot, sizeof(T_TestGimbalAttitudeSnapshot));
+}
+
+/**
+ * @note Called with s_commonMutex held.
+ */
+static void ZiyanTest_GimbalPublishSystemState(void)
+{
+    UtilSeqlock_Write(&s_systemStateSeqlock, s_systemStateSnapshot, &s_systemState, sizeof(T_ZiyanGimbalSystemState));
+}
+
+/**
+ * @note Called with s_calibrationMutex held.
+ */
+static void ZiyanTest_GimbalPublishCalibrationState(void)
+{
+    T_TestGimbalCalibrationSnapshot snapshot = {
+        .state = s_calibrationState,
+        .startTime = s_calibrationStartTime,
+    };
+
+    UtilSeqlock_Write(&s_calibrationStateSeqlock, s_calibrationStateSnapshot, &snapshot,
+                      sizeof(T_TestGimbalCalibrationSnapshot));
+}
+
 /****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
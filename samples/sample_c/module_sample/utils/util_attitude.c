@@ -0,0 +1,472 @@
+/**
+ ********************************************************************
+ * @file    util_attitude.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include "util_attitude.h"
+#include "util_misc.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UTIL_ATTITUDE_VECTOR_ENABLED
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UTIL_ATTITUDE_VECTOR_ENABLED
+#endif
+
+/* Private constants ---------------------------------------------------------*/
+#define UTIL_ATTITUDE_SLERP_LINEAR_THRESHOLD        0.9995f /* Closer quaternions are interpolated linearly. */
+
+/* Private types -------------------------------------------------------------*/
+/* Kernels are written once on 4 lanes of floats, the operations below map them to SSE2 or NEON. */
+#if defined(__SSE2__)
+typedef __m128 T_UtilAttitudeVector;
+typedef __m128 T_UtilAttitudeMask;
+
+#define VECTOR_SET(value)           _mm_set1_ps(value)
+#define VECTOR_ADD(a, b)            _mm_add_ps(a, b)
+#define VECTOR_SUB(a, b)            _mm_sub_ps(a, b)
+#define VECTOR_MUL(a, b)            _mm_mul_ps(a, b)
+#define VECTOR_DIV(a, b)            _mm_div_ps(a, b)
+#define VECTOR_SQRT(a)              _mm_sqrt_ps(a)
+#define VECTOR_MIN(a, b)            _mm_min_ps(a, b)
+#define VECTOR_MAX(a, b)            _mm_max_ps(a, b)
+#define VECTOR_ABS(a)               _mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+#define VECTOR_SIGN(a)              _mm_and_ps(_mm_set1_ps(-0.0f), a)
+#define VECTOR_XOR(a, b)            _mm_xor_ps(a, b)
+#define VECTOR_GT(a, b)             _mm_cmpgt_ps(a, b)
+#define VECTOR_SELECT(mask, a, b)   _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+#elif defined(__ARM_NEON)
+typedef float32x4_t T_UtilAttitudeVector;
+typedef uint32x4_t T_UtilAttitudeMask;
+
+#define VECTOR_SET(value)           vdupq_n_f32(value)
+#define VECTOR_ADD(a, b)            vaddq_f32(a, b)
+#define VECTOR_SUB(a, b)            vsubq_f32(a, b)
+#define VECTOR_MUL(a, b)            vmulq_f32(a, b)
+#if defined(__aarch64__)
+#define VECTOR_DIV(a, b)            vdivq_f32(a, b)
+#define VECTOR_SQRT(a)              vsqrtq_f32(a)
+#else
+#define VECTOR_DIV(a, b)            UtilAttitude_VectorDiv(a, b)
+#define VECTOR_SQRT(a)              UtilAttitude_VectorSqrt(a)
+#endif
+#define VECTOR_MIN(a, b)            vminq_f32(a, b)
+#define VECTOR_MAX(a, b)            vmaxq_f32(a, b)
+#define VECTOR_ABS(a)               vabsq_f32(a)
+#define VECTOR_SIGN(a)              vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vdupq_n_u32(0x80000000)))
+#define VECTOR_XOR(a, b)            vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)))
+#define VECTOR_GT(a, b)             vcgtq_f32(a, b)
+#define VECTOR_SELECT(mask, a, b)   vbslq_f32(mask, a, b)
+#endif
+
+/* Private values ------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+#ifdef UTIL_ATTITUDE_VECTOR_ENABLED
+static inline void UtilAttitude_LoadQuaternions(const T_ZiyanQuaternion4f *quaternions, T_UtilAttitudeVector *q0,
+                                                T_UtilAttitudeVector *q1, T_UtilAttitudeVector *q2,
+                                                T_UtilAttitudeVector *q3);
+static inline void UtilAttitude_Store3(ziyan_f32_t *out, T_UtilAttitudeVector a, T_UtilAttitudeVector b,
+                                       T_UtilAttitudeVector c);
+static inline T_UtilAttitudeVector UtilAttitude_VectorAtan2(T_UtilAttitudeVector y, T_UtilAttitudeVector x);
+#if defined(__ARM_NEON) && !defined(__aarch64__)
+static inline float32x4_t UtilAttitude_VectorDiv(float32x4_t a, float32x4_t b);
+static inline float32x4_t UtilAttitude_VectorSqrt(float32x4_t a);
+#endif
+#endif
+
+/* Exported functions definition ---------------------------------------------*/
+ziyan_f32_t UtilAttitude_WrapAngle(ziyan_f32_t angle)
+{
+    return angle - 2 * UTIL_ATTITUDE_HALF_TURN * floorf((angle + UTIL_ATTITUDE_HALF_TURN) /
+                                                        (2 * UTIL_ATTITUDE_HALF_TURN));
+}
+
+bool UtilAttitude_Clamp(T_ZiyanAttitude3f *attitude, const T_ZiyanAttitude3f *min, const T_ZiyanAttitude3f *max)
+{
+    T_ZiyanAttitude3f clamped;
+
+    clamped.pitch = USER_UTIL_MAX(USER_UTIL_MIN(attitude->pitch, max->pitch), min->pitch);
+    clamped.roll = USER_UTIL_MAX(USER_UTIL_MIN(attitude->roll, max->roll), min->roll);
+    clamped.yaw = USER_UTIL_MAX(USER_UTIL_MIN(attitude->yaw, max->yaw), min->yaw);
+
+    if (clamped.pitch == attitude->pitch && clamped.roll == attitude->roll && clamped.yaw == attitude->yaw) {
+        return false;
+    }
+
+    *attitude = clamped;
+
+    return true;
+}
+
+void UtilAttitude_QuaternionToEuler(const T_ZiyanQuaternion4f *quaternion, T_ZiyanAttitude3f *attitude)
+{
+    ziyan_f32_t q0 = quaternion->q0;
+    ziyan_f32_t q1 = quaternion->q1;
+    ziyan_f32_t q2 = quaternion->q2;
+    ziyan_f32_t q3 = quaternion->q3;
+    ziyan_f32_t sinRollCosPitch = 2 * (q0 * q1 + q2 * q3);
+    ziyan_f32_t cosRollCosPitch = 1 - 2 * (q1 * q1 + q2 * q2);
+
+    // atan2 rather than asin, which loses precision near +-90 degree pitch
+    attitude->pitch = atan2f(2 * (q0 * q2 - q3 * q1),
+                             sqrtf(sinRollCosPitch * sinRollCosPitch + cosRollCosPitch * cosRollCosPitch)) *
+                      UTIL_ATTITUDE_RAD_TO_ANGLE;
+    attitude->roll = atan2f(sinRollCosPitch, cosRollCosPitch) * UTIL_ATTITUDE_RAD_TO_ANGLE;
+    attitude->yaw = atan2f(2 * (q0 * q3 + q1 * q2), 1 - 2 * (q2 * q2 + q3 * q3)) * UTIL_ATTITUDE_RAD_TO_ANGLE;
+}
+
+void UtilAttitude_EulerToQuaternion(const T_ZiyanAttitude3f *attitude, T_ZiyanQuaternion4f *quaternion)
+{
+    ziyan_f32_t sinPitch = sinf(attitude->pitch * UTIL_ATTITUDE_ANGLE_TO_RAD / 2);
+    ziyan_f32_t cosPitch = cosf(attitude->pitch * UTIL_ATTITUDE_ANGLE_TO_RAD / 2);
+    ziyan_f32_t sinRoll = sinf(attitude->roll * UTIL_ATTITUDE_ANGLE_TO_RAD / 2);
+    ziyan_f32_t cosRoll = cosf(attitude->roll * UTIL_ATTITUDE_ANGLE_TO_RAD / 2);
+    ziyan_f32_t sinYaw = sinf(attitude->yaw * UTIL_ATTITUDE_ANGLE_TO_RAD / 2);
+    ziyan_f32_t cosYaw = cosf(attitude->yaw * UTIL_ATTITUDE_ANGLE_TO_RAD / 2);
+
+    quaternion->q0 = cosRoll * cosPitch * cosYaw + sinRoll * sinPitch * sinYaw;
+    quaternion->q1 = sinRoll * cosPitch * cosYaw - cosRoll * sinPitch * sinYaw;
+    quaternion->q2 = cosRoll * sinPitch * cosYaw + sinRoll * cosPitch * sinYaw;
+    quaternion->q3 = cosRoll * cosPitch * sinYaw - sinRoll * sinPitch * cosYaw;
+}
+
+void UtilAttitude_QuaternionToMatrix(const T_ZiyanQuaternion4f *quaternion, T_UtilAttitudeMatrix *matrix)
+{
+    ziyan_f32_t q0 = quaternion->q0;
+    ziyan_f32_t q1 = quaternion->q1;
+    ziyan_f32_t q2 = quaternion->q2;
+    ziyan_f32_t q3 = quaternion->q3;
+
+    matrix->m[0][0] = 1 - 2 * (q2 * q2 + q3 * q3);
+    matrix->m[0][1] = 2 * (q1 * q2 - q0 * q3);
+    matrix->m[0][2] = 2 * (q1 * q3 + q0 * q2);
+    matrix->m[1][0] = 2 * (q1 * q2 + q0 * q3);
+    matrix->m[1][1] = 1 - 2 * (q1 * q1 + q3 * q3);
+    matrix->m[1][2] = 2 * (q2 * q3 - q0 * q1);
+    matrix->m[2][0] = 2 * (q1 * q3 - q0 * q2);
+    matrix->m[2][1] = 2 * (q2 * q3 + q0 * q1);
+    matrix->m[2][2] = 1 - 2 * (q1 * q1 + q2 * q2);
+}
+
+void UtilAttitude_MatrixToEuler(const T_UtilAttitudeMatrix *matrix, T_ZiyanAttitude3f *attitude)
+{
+    attitude->pitch = atan2f(-matrix->m[2][0], sqrtf(matrix->m[2][1] * matrix->m[2][1] +
+                                                     matrix->m[2][2] * matrix->m[2][2])) * UTIL_ATTITUDE_RAD_TO_ANGLE;
+    attitude->roll = atan2f(matrix->m[2][1], matrix->m[2][2]) * UTIL_ATTITUDE_RAD_TO_ANGLE;
+    attitude->yaw = atan2f(matrix->m[1][0], matrix->m[0][0]) * UTIL_ATTITUDE_RAD_TO_ANGLE;
+}
+
+void UtilAttitude_QuaternionMultiply(const T_ZiyanQuaternion4f *first, const T_ZiyanQuaternion4f *second,
+                                     T_ZiyanQuaternion4f *product)
+{
+    T_ZiyanQuaternion4f result;
+
+    result.q0 = first->q0 * second->q0 - first->q1 * second->q1 - first->q2 * second->q2 - first->q3 * second->q3;
+    result.q1 = first->q0 * second->q1 + first->q1 * second->q0 + first->q2 * second->q3 - first->q3 * second->q2;
+    result.q2 = first->q0 * second->q2 - first->q1 * second->q3 + first->q2 * second->q0 + first->q3 * second->q1;
+    result.q3 = first->q0 * second->q3 + first->q1 * second->q2 - first->q2 * second->q1 + first->q3 * second->q0;
+
+    *product = result;
+}
+
+void UtilAttitude_QuaternionNormalize(T_ZiyanQuaternion4f *quaternion)
+{
+    ziyan_f32_t norm = sqrtf(quaternion->q0 * quaternion->q0 + quaternion->q1 * quaternion->q1 +
+                             quaternion->q2 * quaternion->q2 + quaternion->q3 * quaternion->q3);
+
+    if (norm == 0) {
+        quaternion->q0 = 1;
+        return;
+    }
+
+    quaternion->q0 /= norm;
+    quaternion->q1 /= norm;
+    quaternion->q2 /= norm;
+    quaternion->q3 /= norm;
+}
+
+void UtilAttitude_Slerp(const T_ZiyanQuaternion4f *from, const T_ZiyanQuaternion4f *to, ziyan_f32_t ratio,
+                        T_ZiyanQuaternion4f *result)
+{
+    T_ZiyanQuaternion4f target = *to;
+    ziyan_f32_t cosAngle = from->q0 * to->q0 + from->q1 * to->q1 + from->q2 * to->q2 + from->q3 * to->q3;
+    ziyan_f32_t angle;
+    ziyan_f32_t fromWeight;
+    ziyan_f32_t toWeight;
+
+    // q and -q are the same rotation, take the one on the shortest arc
+    if (cosAngle < 0) {
+        cosAngle = -cosAngle;
+        target.q0 = -target.q0;
+        target.q1 = -target.q1;
+        target.q2 = -target.q2;
+        target.q3 = -target.q3;
+    }
+
+    if (cosAngle > UTIL_ATTITUDE_SLERP_LINEAR_THRESHOLD) {
+        fromWeight = 1 - ratio;
+        toWeight = ratio;
+    } else {
+        angle = acosf(cosAngle);
+        fromWeight = sinf((1 - ratio) * angle) / sinf(angle);
+        toWeight = sinf(ratio * angle) / sinf(angle);
+    }
+
+    result->q0 = from->q0 * fromWeight + target.q0 * toWeight;
+    result->q1 = from->q1 * fromWeight + target.q1 * toWeight;
+    result->q2 = from->q2 * fromWeight + target.q2 * toWeight;
+    result->q3 = from->q3 * fromWeight + target.q3 * toWeight;
+
+    if (cosAngle > UTIL_ATTITUDE_SLERP_LINEAR_THRESHOLD) {
+        UtilAttitude_QuaternionNormalize(result);
+    }
+}
+
+void UtilAttitude_RotateVector(const T_ZiyanQuaternion4f *quaternion, const T_ZiyanVector3f *vector,
+                               T_ZiyanVector3f *rotatedVector)
+{
+    ziyan_f32_t tx;
+    ziyan_f32_t ty;
+    ziyan_f32_t tz;
+    T_ZiyanVector3f result;
+
+    // v' = v + q0 t + u x t, with u the vector part of the quaternion and t = 2 u x v
+    tx = 2 * (quaternion->q2 * vector->z - quaternion->q3 * vector->y);
+    ty = 2 * (quaternion->q3 * vector->x - quaternion->q1 * vector->z);
+    tz = 2 * (quaternion->q1 * vector->y - quaternion->q2 * vector->x);
+
+    result.x = vector->x + quaternion->q0 * tx + quaternion->q2 * tz - quaternion->q3 * ty;
+    result.y = vector->y + quaternion->q0 * ty + quaternion->q3 * tx - quaternion->q1 * tz;
+    result.z = vector->z + quaternion->q0 * tz + quaternion->q1 * ty - quaternion->q2 * tx;
+
+    *rotatedVector = result;
+}
+
+void UtilAttitude_QuaternionToEulerBatch(const T_ZiyanQuaternion4f *quaternions, T_ZiyanAttitude3f *attitudes,
+                                         uint32_t count)
+{
+    uint32_t i = 0;
+
+#ifdef UTIL_ATTITUDE_VECTOR_ENABLED
+    T_UtilAttitudeVector q0, q1, q2, q3;
+    T_UtilAttitudeVector one = VECTOR_SET(1.0f);
+    T_UtilAttitudeVector two = VECTOR_SET(2.0f);
+    T_UtilAttitudeVector radToAngle = VECTOR_SET(UTIL_ATTITUDE_RAD_TO_ANGLE);
+    T_UtilAttitudeVector sinRollCosPitch, cosRollCosPitch, pitch, roll, yaw;
+
+    for (; i + 4 <= count; i += 4) {
+        UtilAttitude_LoadQuaternions(&quaternions[i], &q0, &q1, &q2, &q3);
+
+        sinRollCosPitch = VECTOR_MUL(two, VECTOR_ADD(VECTOR_MUL(q0, q1), VECTOR_MUL(q2, q3)));
+        cosRollCosPitch = VECTOR_SUB(one, VECTOR_MUL(two, VECTOR_ADD(VECTOR_MUL(q1, q1), VECTOR_MUL(q2, q2))));
+        pitch = UtilAttitude_VectorAtan2(VECTOR_MUL(two, VECTOR_SUB(VECTOR_MUL(q0, q2), VECTOR_MUL(q3, q1))),
+                                         VECTOR_SQRT(VECTOR_ADD(VECTOR_MUL(sinRollCosPitch, sinRollCosPitch),
+                                                                VECTOR_MUL(cosRollCosPitch, cosRollCosPitch))));
+        roll = UtilAttitude_VectorAtan2(sinRollCosPitch, cosRollCosPitch);
+        yaw = UtilAttitude_VectorAtan2(
+            VECTOR_MUL(two, VECTOR_ADD(VECTOR_MUL(q0, q3), VECTOR_MUL(q1, q2))),
+            VECTOR_SUB(one, VECTOR_MUL(two, VECTOR_ADD(VECTOR_MUL(q2, q2), VECTOR_MUL(q3, q3)))));
+
+        UtilAttitude_Store3(&attitudes[i].pitch, VECTOR_MUL(pitch, radToAngle), VECTOR_MUL(roll, radToAngle),
+                            VECTOR_MUL(yaw, radToAngle));
+    }
+#endif
+
+    for (; i < count; i++) {
+        UtilAttitude_QuaternionToEuler(&quaternions[i], &attitudes[i]);
+    }
+}
+
+void UtilAttitude_RotateVectorBatch(const T_ZiyanQuaternion4f *quaternions, const T_ZiyanVector3f *vectors,
+                                    T_ZiyanVector3f *rotatedVectors, uint32_t count)
+{
+    uint32_t i = 0;
+
+#ifdef UTIL_ATTITUDE_VECTOR_ENABLED
+    T_UtilAttitudeVector q0, q1, q2, q3;
+    T_UtilAttitudeVector x, y, z, tx, ty, tz;
+    T_UtilAttitudeVector two = VECTOR_SET(2.0f);
+
+    for (; i + 4 <= count; i += 4) {
+        UtilAttitude_LoadQuaternions(&quaternions[i], &q0, &q1, &q2, &q3);
+        // vectors have 3 components, the 4th lane loaded by the transpose is ignored
+#if defined(__SSE2__)
+        {
+            __m128 v0 = _mm_loadu_ps(&vectors[i].x);
+            __m128 v1 = _mm_loadu_ps(&vectors[i + 1].x);
+            __m128 v2 = _mm_loadu_ps(&vectors[i + 2].x);
+            __m128 v3 = _mm_set_ps(0, vectors[i + 3].z, vectors[i + 3].y, vectors[i + 3].x);
+
+            _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+            x = v0;
+            y = v1;
+            z = v2;
+            USER_UTIL_UNUSED(v3);
+        }
+#else
+        {
+            float32x4x3_t v = vld3q_f32(&vectors[i].x);
+
+            x = v.val[0];
+            y = v.val[1];
+            z = v.val[2];
+        }
+#endif
+        tx = VECTOR_MUL(two, VECTOR_SUB(VECTOR_MUL(q2, z), VECTOR_MUL(q3, y)));
+        ty = VECTOR_MUL(two, VECTOR_SUB(VECTOR_MUL(q3, x), VECTOR_MUL(q1, z)));
+        tz = VECTOR_MUL(two, VECTOR_SUB(VECTOR_MUL(q1, y), VECTOR_MUL(q2, x)));
+
+        x = VECTOR_ADD(x, VECTOR_ADD(VECTOR_MUL(q0, tx), VECTOR_SUB(VECTOR_MUL(q2, tz), VECTOR_MUL(q3, ty))));
+        y = VECTOR_ADD(y, VECTOR_ADD(VECTOR_MUL(q0, ty), VECTOR_SUB(VECTOR_MUL(q3, tx), VECTOR_MUL(q1, tz))));
+        z = VECTOR_ADD(z, VECTOR_ADD(VECTOR_MUL(q0, tz), VECTOR_SUB(VECTOR_MUL(q1, ty), VECTOR_MUL(q2, tx))));
+
+        UtilAttitude_Store3(&rotatedVectors[i].x, x, y, z);
+    }
+#endif
+
+    for (; i < count; i++) {
+        UtilAttitude_RotateVector(&quaternions[i], &vectors[i], &rotatedVectors[i]);
+    }
+}
+
+/* Private functions definition-----------------------------------------------*/
+#ifdef UTIL_ATTITUDE_VECTOR_ENABLED
+static inline void UtilAttitude_LoadQuaternions(const T_ZiyanQuaternion4f *quaternions, T_UtilAttitudeVector *q0,
+                                                T_UtilAttitudeVector *q1, T_UtilAttitudeVector *q2,
+                                                T_UtilAttitudeVector *q3)
+{
+#if defined(__SSE2__)
+    __m128 v0 = _mm_loadu_ps(&quaternions[0].q0);
+    __m128 v1 = _mm_loadu_ps(&quaternions[1].q0);
+    __m128 v2 = _mm_loadu_ps(&quaternions[2].q0);
+    __m128 v3 = _mm_loadu_ps(&quaternions[3].q0);
+
+    _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+    *q0 = v0;
+    *q1 = v1;
+    *q2 = v2;
+    *q3 = v3;
+#else
+    float32x4x4_t v = vld4q_f32(&quaternions[0].q0);
+
+    *q0 = v.val[0];
+    *q1 = v.val[1];
+    *q2 = v.val[2];
+    *q3 = v.val[3];
+#endif
+}
+
+/**
+ * @brief Store 4 triplets of floats, interleaving the lanes of a, b and c.
+ */
+static inline void UtilAttitude_Store3(ziyan_f32_t *out, T_UtilAttitudeVector a, T_UtilAttitudeVector b,
+                                       T_UtilAttitudeVector c)
+{
+#if defined(__SSE2__)
+    __m128 ab0 = _mm_unpacklo_ps(a, b); // a0 b0 a1 b1
+    __m128 ab1 = _mm_unpackhi_ps(a, b); // a2 b2 a3 b3
+    __m128 ca0 = _mm_unpacklo_ps(c, a); // c0 a0 c1 a1
+    __m128 b1c1 = _mm_shuffle_ps(ab0, ca0, _MM_SHUFFLE(2, 2, 3, 3)); // b1 b1 c1 c1
+    __m128 c2a3 = _mm_shuffle_ps(c, ab1, _MM_SHUFFLE(2, 2, 2, 2)); // c2 c2 a3 a3
+    __m128 b3c3 = _mm_shuffle_ps(ab1, c, _MM_SHUFFLE(3, 3, 3, 3)); // b3 b3 c3 c3
+
+    _mm_storeu_ps(out, _mm_shuffle_ps(ab0, ca0, _MM_SHUFFLE(3, 0, 1, 0))); // a0 b0 c0 a1
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(b1c1, ab1, _MM_SHUFFLE(1, 0, 2, 0))); // b1 c1 a2 b2
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(c2a3, b3c3, _MM_SHUFFLE(2, 0, 2, 0))); // c2 a3 b3 c3
+#else
+    float32x4x3_t v;
+
+    v.val[0] = a;
+    v.val[1] = b;
+    v.val[2] = c;
+    vst3q_f32(out, v);
+#endif
+}
+
+/**
+ * @brief Four quadrant arc tangent, in rad. The polynomial of the Cephes library on [-tan(pi/8), tan(pi/8)] keeps the
+ * error within 2e-7 rad.
+ */
+static inline T_UtilAttitudeVector UtilAttitude_VectorAtan2(T_UtilAttitudeVector y, T_UtilAttitudeVector x)
+{
+    T_UtilAttitudeVector absX = VECTOR_ABS(x);
+    T_UtilAttitudeVector absY = VECTOR_ABS(y);
+    T_UtilAttitudeVector one = VECTOR_SET(1.0f);
+    T_UtilAttitudeVector ratio;
+    T_UtilAttitudeVector z;
+    T_UtilAttitudeVector z2;
+    T_UtilAttitudeVector angle;
+    T_UtilAttitudeMask mask;
+
+    // atan of min/max in [0, 1], 0 when both are 0
+    ratio = VECTOR_DIV(VECTOR_MIN(absX, absY), VECTOR_MAX(VECTOR_MAX(absX, absY), VECTOR_SET(1e-30f)));
+
+    // atan(r) = pi/4 + atan((r - 1) / (r + 1)) above tan(pi/8)
+    mask = VECTOR_GT(ratio, VECTOR_SET(0.414213562f));
+    z = VECTOR_SELECT(mask, VECTOR_DIV(VECTOR_SUB(ratio, one), VECTOR_ADD(ratio, one)), ratio);
+    z2 = VECTOR_MUL(z, z);
+    angle = VECTOR_SUB(VECTOR_MUL(VECTOR_SET(8.05374449538e-2f), z2), VECTOR_SET(1.38776856032e-1f));
+    angle = VECTOR_ADD(VECTOR_MUL(angle, z2), VECTOR_SET(1.99777106478e-1f));
+    angle = VECTOR_SUB(VECTOR_MUL(angle, z2), VECTOR_SET(3.33329491539e-1f));
+    angle = VECTOR_ADD(VECTOR_MUL(VECTOR_MUL(angle, z2), z), z);
+    angle = VECTOR_ADD(angle, VECTOR_SELECT(mask, VECTOR_SET(ZIYAN_PI / 4), VECTOR_SET(0.0f)));
+
+    // back to the octant and quadrant of (x, y)
+    angle = VECTOR_SELECT(VECTOR_GT(absY, absX), VECTOR_SUB(VECTOR_SET(ZIYAN_PI / 2), angle), angle);
+    angle = VECTOR_SELECT(VECTOR_GT(VECTOR_SET(0.0f), x), VECTOR_SUB(VECTOR_SET(ZIYAN_PI), angle), angle);
+
+    return VECTOR_XOR(angle, VECTOR_SIGN(y));
+}
+
+#if defined(__ARM_NEON) && !defined(__aarch64__)
+/**
+ * @note Reciprocal estimates refined by 2 Newton steps, ARMv7 NEON has no division nor square root.
+ */
+static inline float32x4_t UtilAttitude_VectorDiv(float32x4_t a, float32x4_t b)
+{
+    float32x4_t reciprocal = vrecpeq_f32(b);
+
+    reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+    reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+
+    return vmulq_f32(a, reciprocal);
+}
+
+static inline float32x4_t UtilAttitude_VectorSqrt(float32x4_t a)
+{
+    float32x4_t reciprocalSqrt = vrsqrteq_f32(a);
+
+    reciprocalSqrt = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, reciprocalSqrt), reciprocalSqrt), reciprocalSqrt);
+    reciprocalSqrt = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, reciprocalSqrt), reciprocalSqrt), reciprocalSqrt);
+
+    // 1 / sqrt(0) is infinite, 0 * inf would give NaN
+    return vbslq_f32(vceqq_f32(a, vdupq_n_f32(0)), a, vmulq_f32(a, reciprocalSqrt));
+}
+#endif
+#endif
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,107 @@
+/**
+ ********************************************************************
+ * @file    util_attitude.h
+ * @brief   This is the header file for "util_attitude.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef UTIL_ATTITUDE_H
+#define UTIL_ATTITUDE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+/**
+ * Angles are in 0.1 degree like the gimbal and camera interfaces, Euler angles are applied in the yaw, pitch, roll
+ * order and quaternions rotate from body to ground coordinates, as in the flight controller subscription topics.
+ */
+#define UTIL_ATTITUDE_HALF_TURN                     1800.0f
+#define UTIL_ATTITUDE_RAD_TO_ANGLE                  (UTIL_ATTITUDE_HALF_TURN / ZIYAN_PI)
+#define UTIL_ATTITUDE_ANGLE_TO_RAD                  (ZIYAN_PI / UTIL_ATTITUDE_HALF_TURN)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    ziyan_f32_t m[3][3]; /*!< Row major rotation matrix from body to ground coordinates. */
+} T_UtilAttitudeMatrix;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Wrap an angle to [-1800, 1800).
+ */
+ziyan_f32_t UtilAttitude_WrapAngle(ziyan_f32_t angle);
+
+/**
+ * @brief Clamp each axis of an attitude to its limits.
+ * @return True when an axis was out of its limits.
+ */
+bool UtilAttitude_Clamp(T_ZiyanAttitude3f *attitude, const T_ZiyanAttitude3f *min, const T_ZiyanAttitude3f *max);
+
+void UtilAttitude_QuaternionToEuler(const T_ZiyanQuaternion4f *quaternion, T_ZiyanAttitude3f *attitude);
+void UtilAttitude_EulerToQuaternion(const T_ZiyanAttitude3f *attitude, T_ZiyanQuaternion4f *quaternion);
+void UtilAttitude_QuaternionToMatrix(const T_ZiyanQuaternion4f *quaternion, T_UtilAttitudeMatrix *matrix);
+void UtilAttitude_MatrixToEuler(const T_UtilAttitudeMatrix *matrix, T_ZiyanAttitude3f *attitude);
+
+/**
+ * @brief Compose two rotations, applying second then first.
+ */
+void UtilAttitude_QuaternionMultiply(const T_ZiyanQuaternion4f *first, const T_ZiyanQuaternion4f *second,
+                                     T_ZiyanQuaternion4f *product);
+void UtilAttitude_QuaternionNormalize(T_ZiyanQuaternion4f *quaternion);
+
+/**
+ * @brief Interpolate along the shortest arc between two unit quaternions.
+ * @param ratio: 0 gives from, 1 gives to.
+ */
+void UtilAttitude_Slerp(const T_ZiyanQuaternion4f *from, const T_ZiyanQuaternion4f *to, ziyan_f32_t ratio,
+                        T_ZiyanQuaternion4f *result);
+
+/**
+ * @brief Rotate a vector from body to ground coordinates.
+ */
+void UtilAttitude_RotateVector(const T_ZiyanQuaternion4f *quaternion, const T_ZiyanVector3f *vector,
+                               T_ZiyanVector3f *rotatedVector);
+
+/**
+ * @brief Convert unit quaternions to Euler angles, 4 at a time with SSE2 or NEON when available. Results match
+ * UtilAttitude_QuaternionToEuler() within 0.001 degree.
+ */
+void UtilAttitude_QuaternionToEulerBatch(const T_ZiyanQuaternion4f *quaternions, T_ZiyanAttitude3f *attitudes,
+                                         uint32_t count);
+
+/**
+ * @brief Rotate each vector by its quaternion, 4 at a time with SSE2 or NEON when available.
+ * @param rotatedVectors: may be vectors.
+ */
+void UtilAttitude_RotateVectorBatch(const T_ZiyanQuaternion4f *quaternions, const T_ZiyanVector3f *vectors,
+                                    T_ZiyanVector3f *rotatedVectors, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTIL_ATTITUDE_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,63 @@
+/**
+ ********************************************************************
+ * @file    util_log.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "util_log.h"
+#include "ziyan_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values ------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+bool UtilLog_IsPeriodElapsed(T_UtilLogRateState *state, uint32_t periodMs, uint32_t *suppressedCount)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    uint32_t currentTimeMs = 0;
+
+    if (osalHandler == NULL || osalHandler->GetTimeMs(&currentTimeMs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return false;
+    }
+
+    if (state->isStarted == true && currentTimeMs - state->lastTimeMs < periodMs) {
+        state->suppressedCount++;
+        return false;
+    }
+
+    *suppressedCount = state->suppressedCount;
+    state->suppressedCount = 0;
+    state->lastTimeMs = currentTimeMs;
+    state->isStarted = true;
+
+    return true;
+}
+
+/* Private functions definition-----------------------------------------------*/
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
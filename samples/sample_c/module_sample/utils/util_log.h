@@ -0,0 +1,129 @@
+/**
+ ********************************************************************
+ * @file    util_log.h
+ * @brief   This is the header file for "util_log.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef UTIL_LOG_H
+#define UTIL_LOG_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "ziyan_logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+/**
+ * Most verbose level compiled in, calls above it are removed with their arguments: 0 error, 1 warn, 2 info, 3 debug.
+ * The level only applies where this header is seen: util_misc.h includes it, files without util_misc.h include it
+ * directly after ziyan_logger.h.
+ */
+#ifndef USER_LOG_COMPILE_LEVEL
+#define USER_LOG_COMPILE_LEVEL                              ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG
+#endif
+
+#define USER_LOG_IS_COMPILED(level)                         ((int) (level) <= (int) (USER_LOG_COMPILE_LEVEL))
+
+#define USER_LOG_OUTPUT(level, fmt, ...) \
+    do { \
+        if (USER_LOG_IS_COMPILED(level)) { \
+            ZiyanLogger_UserLogOutput(level, "[%s:%d) " fmt, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+/* Route the logger macros through the compile-time level. */
+#undef USER_LOG_DEBUG
+#undef USER_LOG_INFO
+#undef USER_LOG_WARN
+#undef USER_LOG_ERROR
+#define USER_LOG_DEBUG(fmt, ...)    USER_LOG_OUTPUT(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define USER_LOG_INFO(fmt, ...)     USER_LOG_OUTPUT(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define USER_LOG_WARN(fmt, ...)     USER_LOG_OUTPUT(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define USER_LOG_ERROR(fmt, ...)    USER_LOG_OUTPUT(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+/**
+ * Rate-limited variants for hot paths, level is DEBUG, INFO, WARN or ERROR. Each call site keeps its own state, which
+ * is updated without locking: a site hit by several threads at once may print one line more or less than asked.
+ */
+/* Print the 1st, (n + 1)th, (2n + 1)th... occurrence. */
+#define USER_LOG_EVERY_N(level, n, fmt, ...) \
+    do { \
+        if (USER_LOG_IS_COMPILED(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_##level)) { \
+            static uint32_t s_logOccurrenceCount = 0; \
+            if (s_logOccurrenceCount++ % (uint32_t) (n) == 0) { \
+                USER_LOG_OUTPUT(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_##level, fmt, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+/* Print at most one occurrence per period, with the number of occurrences suppressed since the last one. */
+#define USER_LOG_EVERY_MS(level, periodMs, fmt, ...) \
+    do { \
+        if (USER_LOG_IS_COMPILED(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_##level)) { \
+            static T_UtilLogRateState s_logRateState = {0}; \
+            uint32_t logSuppressedCount; \
+            if (UtilLog_IsPeriodElapsed(&s_logRateState, (periodMs), &logSuppressedCount)) { \
+                USER_LOG_OUTPUT(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_##level, fmt " (suppressed %u)", ##__VA_ARGS__, \
+                                logSuppressedCount); \
+            } \
+        } \
+    } while (0)
+
+/* Print the first n occurrences only. */
+#define USER_LOG_FIRST_N(level, n, fmt, ...) \
+    do { \
+        if (USER_LOG_IS_COMPILED(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_##level)) { \
+            static uint32_t s_logOccurrenceCount = 0; \
+            if (s_logOccurrenceCount < (uint32_t) (n)) { \
+                s_logOccurrenceCount++; \
+                USER_LOG_OUTPUT(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_##level, fmt, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t lastTimeMs;
+    uint32_t suppressedCount;
+    bool isStarted;
+} T_UtilLogRateState;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Check whether a rate-limited call site may print, used by USER_LOG_EVERY_MS.
+ * @param state: state of the call site.
+ * @param periodMs: minimum time between two prints.
+ * @param suppressedCount: occurrences dropped since the previous print, valid when true is returned.
+ * @return True when the period has elapsed since the previous print or nothing was printed yet.
+ */
+bool UtilLog_IsPeriodElapsed(T_UtilLogRateState *state, uint32_t periodMs, uint32_t *suppressedCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTIL_LOG_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,382 @@
+/**
+ ********************************************************************
+ * @file    util_metrics.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "util_metrics.h"
+#include "util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define UTIL_METRICS_LINE_BUFFER_SIZE               256
+#define UTIL_METRICS_HISTOGRAM_SLOT_COUNT           (UTIL_METRICS_HISTOGRAM_BUCKET_COUNT + 1) /* Buckets and sum. */
+#define UTIL_METRICS_SUB_BUCKET_COUNT               (1 << UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values ------------------------------------------------------------*/
+/* Each shard row starts on its own cache line, a thread only writes the row of its shard. */
+static uint64_t s_metricsShards[UTIL_METRICS_SHARD_COUNT][UTIL_METRICS_SLOT_COUNT] __attribute__((aligned(64)));
+static T_UtilMetric *s_metrics[UTIL_METRICS_METRIC_MAX];
+static uint16_t s_metricCount = 0;
+static uint16_t s_nextSlot = 1;
+static UtilMetricsCollectFunc s_collectors[UTIL_METRICS_COLLECTOR_MAX];
+static uint8_t s_collectorCount = 0;
+static uint8_t s_registerLock = 0;
+static uint32_t s_nextShard = 0;
+static __thread uint32_t s_threadShard = 0; /* Shard of the thread plus 1, 0 until assigned. */
+
+static const float s_exportQuantiles[] = {0.5f, 0.9f, 0.99f, 0.999f};
+
+/* Private functions declaration ---------------------------------------------*/
+static bool UtilMetrics_IsNameValid(const char *name);
+static uint16_t UtilMetrics_GetSlotCount(E_UtilMetricsType type);
+static uint16_t UtilMetrics_GetSlot(T_UtilMetric *metric);
+static uint64_t *UtilMetrics_GetThreadShard(void);
+static uint32_t UtilMetrics_GetBucketIndex(uint64_t value);
+static uint64_t UtilMetrics_GetBucketMiddle(uint32_t index);
+static uint64_t UtilMetrics_SumShards(uint16_t slot);
+static uint64_t UtilMetrics_GetQuantileOfBuckets(const uint64_t *buckets, uint64_t count, float quantile);
+static void UtilMetrics_ExportMetric(T_UtilMetric *metric, UtilMetricsWriteFunc write, void *arg);
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode UtilMetrics_Register(T_UtilMetric *metric)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    uint16_t slotCount;
+    uint16_t i;
+
+    if (metric == NULL || UtilMetrics_IsNameValid(metric->name) != true) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    while (__atomic_test_and_set(&s_registerLock, __ATOMIC_ACQUIRE)) {
+    }
+
+    if (__atomic_load_n(&metric->slot, __ATOMIC_RELAXED) != 0) {
+        goto out;
+    }
+
+    for (i = 0; i < s_metricCount; i++) {
+        if (s_metrics[i]->type == metric->type && strcmp(s_metrics[i]->name, metric->name) == 0) {
+            __atomic_store_n(&metric->slot, s_metrics[i]->slot, __ATOMIC_RELEASE);
+            goto out;
+        }
+    }
+
+    slotCount = UtilMetrics_GetSlotCount(metric->type);
+    if (s_metricCount >= UTIL_METRICS_METRIC_MAX || s_nextSlot + slotCount > UTIL_METRICS_SLOT_COUNT) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+        goto out;
+    }
+
+    __atomic_store_n(&metric->slot, s_nextSlot, __ATOMIC_RELEASE);
+    s_metrics[s_metricCount] = metric;
+    __atomic_store_n(&s_metricCount, s_metricCount + 1, __ATOMIC_RELEASE);
+    s_nextSlot += slotCount;
+
+out:
+    __atomic_clear(&s_registerLock, __ATOMIC_RELEASE);
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode UtilMetrics_RegisterCollector(UtilMetricsCollectFunc collect)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+    if (collect == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    while (__atomic_test_and_set(&s_registerLock, __ATOMIC_ACQUIRE)) {
+    }
+
+    if (s_collectorCount >= UTIL_METRICS_COLLECTOR_MAX) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+    } else {
+        s_collectors[s_collectorCount] = collect;
+        __atomic_store_n(&s_collectorCount, s_collectorCount + 1, __ATOMIC_RELEASE);
+    }
+
+    __atomic_clear(&s_registerLock, __ATOMIC_RELEASE);
+
+    return returnCode;
+}
+
+void UtilMetrics_CounterAdd(T_UtilMetric *metric, uint64_t value)
+{
+    uint16_t slot = UtilMetrics_GetSlot(metric);
+
+    if (slot == 0) {
+        return;
+    }
+
+    __atomic_fetch_add(&UtilMetrics_GetThreadShard()[slot], value, __ATOMIC_RELAXED);
+}
+
+void UtilMetrics_CounterSet(T_UtilMetric *metric, uint64_t value)
+{
+    uint16_t slot = UtilMetrics_GetSlot(metric);
+
+    if (slot == 0) {
+        return;
+    }
+
+    __atomic_store_n(&s_metricsShards[0][slot], value, __ATOMIC_RELAXED);
+}
+
+void UtilMetrics_GaugeSet(T_UtilMetric *metric, double value)
+{
+    uint16_t slot = UtilMetrics_GetSlot(metric);
+    uint64_t bits;
+
+    if (slot == 0) {
+        return;
+    }
+
+    memcpy(&bits, &value, sizeof(bits));
+    __atomic_store_n(&s_metricsShards[0][slot], bits, __ATOMIC_RELAXED);
+}
+
+void UtilMetrics_HistogramRecord(T_UtilMetric *metric, uint64_t value)
+{
+    uint16_t slot = UtilMetrics_GetSlot(metric);
+    uint64_t *shard;
+
+    if (slot == 0) {
+        return;
+    }
+
+    shard = UtilMetrics_GetThreadShard();
+    __atomic_fetch_add(&shard[slot + UtilMetrics_GetBucketIndex(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&shard[slot + UTIL_METRICS_HISTOGRAM_BUCKET_COUNT], value, __ATOMIC_RELAXED);
+}
+
+uint64_t UtilMetrics_HistogramGetQuantile(T_UtilMetric *metric, float quantile)
+{
+    uint64_t buckets[UTIL_METRICS_HISTOGRAM_BUCKET_COUNT];
+    uint64_t count = 0;
+    uint16_t slot = UtilMetrics_GetSlot(metric);
+    uint32_t i;
+
+    if (slot == 0 || metric->type != UTIL_METRICS_TYPE_HISTOGRAM) {
+        return 0;
+    }
+
+    for (i = 0; i < UTIL_METRICS_HISTOGRAM_BUCKET_COUNT; i++) {
+        buckets[i] = UtilMetrics_SumShards(slot + i);
+        count += buckets[i];
+    }
+
+    return UtilMetrics_GetQuantileOfBuckets(buckets, count, quantile);
+}
+
+void UtilMetrics_Export(UtilMetricsWriteFunc write, void *arg)
+{
+    uint16_t metricCount;
+    uint8_t collectorCount;
+    uint16_t i;
+
+    if (write == NULL) {
+        return;
+    }
+
+    collectorCount = __atomic_load_n(&s_collectorCount, __ATOMIC_ACQUIRE);
+    for (i = 0; i < collectorCount; i++) {
+        s_collectors[i]();
+    }
+
+    metricCount = __atomic_load_n(&s_metricCount, __ATOMIC_ACQUIRE);
+    for (i = 0; i < metricCount; i++) {
+        UtilMetrics_ExportMetric(s_metrics[i], write, arg);
+    }
+}
+
+/* Private functions definition-----------------------------------------------*/
+static bool UtilMetrics_IsNameValid(const char *name)
+{
+    const char *p;
+
+    if (name == NULL || name[0] == '\0' || (name[0] >= '0' && name[0] <= '9')) {
+        return false;
+    }
+
+    for (p = name; *p != '\0'; p++) {
+        if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '_' ||
+              *p == ':')) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static uint16_t UtilMetrics_GetSlotCount(E_UtilMetricsType type)
+{
+    return type == UTIL_METRICS_TYPE_HISTOGRAM ? UTIL_METRICS_HISTOGRAM_SLOT_COUNT : 1;
+}
+
+static uint16_t UtilMetrics_GetSlot(T_UtilMetric *metric)
+{
+    uint16_t slot = __atomic_load_n(&metric->slot, __ATOMIC_ACQUIRE);
+
+    if (slot == 0 && UtilMetrics_Register(metric) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        slot = __atomic_load_n(&metric->slot, __ATOMIC_ACQUIRE);
+    }
+
+    return slot;
+}
+
+static uint64_t *UtilMetrics_GetThreadShard(void)
+{
+    if (s_threadShard == 0) {
+        s_threadShard = __atomic_fetch_add(&s_nextShard, 1, __ATOMIC_RELAXED) % UTIL_METRICS_SHARD_COUNT + 1;
+    }
+
+    return s_metricsShards[s_threadShard - 1];
+}
+
+static uint32_t UtilMetrics_GetBucketIndex(uint64_t value)
+{
+    uint32_t exponent;
+
+    if (value < UTIL_METRICS_SUB_BUCKET_COUNT) {
+        return (uint32_t) value;
+    }
+
+    /* Buckets of a power of 2 split it in UTIL_METRICS_SUB_BUCKET_COUNT equal parts. */
+    exponent = 63 - (uint32_t) __builtin_clzll(value);
+    if (exponent > UTIL_METRICS_HISTOGRAM_EXPONENT_MAX) {
+        return UTIL_METRICS_HISTOGRAM_BUCKET_COUNT - 1;
+    }
+
+    return ((exponent - UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS + 1) << UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS) +
+           (uint32_t) (value >> (exponent - UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS)) - UTIL_METRICS_SUB_BUCKET_COUNT;
+}
+
+static uint64_t UtilMetrics_GetBucketMiddle(uint32_t index)
+{
+    uint32_t shift;
+    uint64_t lower;
+
+    if (index < UTIL_METRICS_SUB_BUCKET_COUNT) {
+        return index;
+    }
+
+    shift = (index >> UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    lower = (uint64_t) (UTIL_METRICS_SUB_BUCKET_COUNT + (index & (UTIL_METRICS_SUB_BUCKET_COUNT - 1))) << shift;
+
+    return lower + (((uint64_t) 1 << shift) >> 1);
+}
+
+static uint64_t UtilMetrics_SumShards(uint16_t slot)
+{
+    uint64_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < UTIL_METRICS_SHARD_COUNT; i++) {
+        sum += __atomic_load_n(&s_metricsShards[i][slot], __ATOMIC_RELAXED);
+    }
+
+    return sum;
+}
+
+static uint64_t UtilMetrics_GetQuantileOfBuckets(const uint64_t *buckets, uint64_t count, float quantile)
+{
+    uint64_t rank;
+    uint64_t seen = 0;
+    uint32_t i;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    rank = (uint64_t) ((double) quantile * (double) count);
+    if (rank >= count) {
+        rank = count - 1;
+    }
+
+    for (i = 0; i < UTIL_METRICS_HISTOGRAM_BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return UtilMetrics_GetBucketMiddle(i);
+        }
+    }
+
+    return UtilMetrics_GetBucketMiddle(UTIL_METRICS_HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+static void UtilMetrics_ExportMetric(T_UtilMetric *metric, UtilMetricsWriteFunc write, void *arg)
+{
+    static const char *typeNames[] = {"counter", "gauge", "summary"};
+    char line[UTIL_METRICS_LINE_BUFFER_SIZE];
+    uint64_t buckets[UTIL_METRICS_HISTOGRAM_BUCKET_COUNT];
+    uint64_t count = 0;
+    uint64_t bits;
+    double gauge;
+    uint32_t i;
+    int len;
+
+    len = snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", metric->name,
+                   metric->help != NULL ? metric->help : "", metric->name, typeNames[metric->type]);
+    write(line, (uint32_t) USER_UTIL_MIN(len, (int) sizeof(line) - 1), arg);
+
+    switch (metric->type) {
+        case UTIL_METRICS_TYPE_COUNTER:
+            len = snprintf(line, sizeof(line), "%s %llu\n", metric->name,
+                           (unsigned long long) UtilMetrics_SumShards(metric->slot));
+            break;
+        case UTIL_METRICS_TYPE_GAUGE:
+            bits = __atomic_load_n(&s_metricsShards[0][metric->slot], __ATOMIC_RELAXED);
+            memcpy(&gauge, &bits, sizeof(gauge));
+            len = snprintf(line, sizeof(line), "%s %.10g\n", metric->name, gauge);
+            break;
+        case UTIL_METRICS_TYPE_HISTOGRAM:
+            for (i = 0; i < UTIL_METRICS_HISTOGRAM_BUCKET_COUNT; i++) {
+                buckets[i] = UtilMetrics_SumShards(metric->slot + i);
+                count += buckets[i];
+            }
+
+            for (i = 0; i < sizeof(s_exportQuantiles) / sizeof(s_exportQuantiles[0]); i++) {
+                len = snprintf(line, sizeof(line), "%s{quantile=\"%g\"} %llu\n", metric->name,
+                               s_exportQuantiles[i],
+                               (unsigned long long) UtilMetrics_GetQuantileOfBuckets(buckets, count,
+                                                                                     s_exportQuantiles[i]));
+                write(line, (uint32_t) USER_UTIL_MIN(len, (int) sizeof(line) - 1), arg);
+            }
+
+            len = snprintf(line, sizeof(line), "%s_sum %llu\n%s_count %llu\n", metric->name,
+                           (unsigned long long) UtilMetrics_SumShards(metric->slot + UTIL_METRICS_HISTOGRAM_BUCKET_COUNT),
+                           metric->name, (unsigned long long) count);
+            break;
+        default:
+            return;
+    }
+
+    write(line, (uint32_t) USER_UTIL_MIN(len, (int) sizeof(line) - 1), arg);
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,123 @@
+/**
+ ********************************************************************
+ * @file    util_metrics.h
+ * @brief   This is the header file for "util_metrics.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef UTIL_METRICS_H
+#define UTIL_METRICS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define UTIL_METRICS_SHARD_COUNT                    8 /* Updating threads are spread over the shards round-robin. */
+#define UTIL_METRICS_SLOT_COUNT                     4096
+#define UTIL_METRICS_METRIC_MAX                     128
+#define UTIL_METRICS_COLLECTOR_MAX                  16
+#define UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS      3 /* 8 buckets per power of 2, 12.5 % worst relative error. */
+#define UTIL_METRICS_HISTOGRAM_EXPONENT_MAX         36 /* Values up to 2^37 are resolved, larger ones are clamped. */
+#define UTIL_METRICS_HISTOGRAM_BUCKET_COUNT \
+    ((UTIL_METRICS_HISTOGRAM_EXPONENT_MAX - UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS + 2) << \
+     UTIL_METRICS_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * Metrics are static objects registered on first use or by UtilMetrics_Register(), e.g.
+ * static T_UtilMetric s_frameCount = UTIL_METRICS_COUNTER("ziyan_camera_video_frames_total", "Frames sent.");
+ * Objects with the same name share their value.
+ */
+#define UTIL_METRICS_COUNTER(name, help)            {(name), (help), UTIL_METRICS_TYPE_COUNTER, 0}
+#define UTIL_METRICS_GAUGE(name, help)              {(name), (help), UTIL_METRICS_TYPE_GAUGE, 0}
+#define UTIL_METRICS_HISTOGRAM(name, help)          {(name), (help), UTIL_METRICS_TYPE_HISTOGRAM, 0}
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    UTIL_METRICS_TYPE_COUNTER = 0,
+    UTIL_METRICS_TYPE_GAUGE = 1,
+    UTIL_METRICS_TYPE_HISTOGRAM = 2, /*!< HDR histogram of unsigned integers, exported as a summary. */
+} E_UtilMetricsType;
+
+typedef struct {
+    const char *name; /*!< Prometheus metric name, [a-zA-Z_:][a-zA-Z0-9_:]*. */
+    const char *help;
+    E_UtilMetricsType type;
+    uint16_t slot; /*!< First slot of the value in the shards, 0 until registered. */
+} T_UtilMetric;
+
+typedef void (*UtilMetricsWriteFunc)(const char *data, uint32_t len, void *arg);
+typedef void (*UtilMetricsCollectFunc)(void);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Register a metric, done implicitly by the first update.
+ * @param metric: static metric object.
+ * @return Execution result, the metric is ignored when the registry is full or its name invalid.
+ */
+T_ZiyanReturnCode UtilMetrics_Register(T_UtilMetric *metric);
+
+/**
+ * @brief Register a function run before every export, used to mirror statistics kept by other modules.
+ */
+T_ZiyanReturnCode UtilMetrics_RegisterCollector(UtilMetricsCollectFunc collect);
+
+/**
+ * @brief Increase a counter. Lock-free, threads update separate shards.
+ */
+void UtilMetrics_CounterAdd(T_UtilMetric *metric, uint64_t value);
+
+/**
+ * @brief Set the total of a counter mirrored from statistics kept elsewhere, not to be mixed with
+ * UtilMetrics_CounterAdd() on the same counter.
+ */
+void UtilMetrics_CounterSet(T_UtilMetric *metric, uint64_t value);
+void UtilMetrics_GaugeSet(T_UtilMetric *metric, double value);
+
+/**
+ * @brief Record a value in a histogram. Lock-free, threads update separate shards.
+ */
+void UtilMetrics_HistogramRecord(T_UtilMetric *metric, uint64_t value);
+
+/**
+ * @brief Get a quantile of a histogram over all values recorded so far.
+ * @param quantile: between 0 and 1.
+ * @return Middle of the bucket the quantile falls in, 0 when the histogram is empty.
+ */
+uint64_t UtilMetrics_HistogramGetQuantile(T_UtilMetric *metric, float quantile);
+
+/**
+ * @brief Format all metrics in the Prometheus text exposition format, version 0.0.4.
+ * @param write: called with consecutive pieces of the text.
+ * @param arg: passed to write.
+ */
+void UtilMetrics_Export(UtilMetricsWriteFunc write, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTIL_METRICS_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -29,6 +29,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "ziyan_typedef.h"
+#include "util_log.h"
 
 #ifdef __cplusplus
 extern "C" {
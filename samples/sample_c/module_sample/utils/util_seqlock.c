@@ -0,0 +1,90 @@
+/**
+ ********************************************************************
+ * @file    util_seqlock.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "util_seqlock.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values ------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+void UtilSeqlock_Write(T_UtilSeqlock *seqlock, void *copies, const void *value, uint32_t size)
+{
+    uint32_t sequence = __atomic_load_n(&seqlock->sequence, __ATOMIC_RELAXED);
+
+    /* Readers move to the second copy while the first one is updated, then back once it is complete. The release
+     * store also completes the update of the second copy by the previous write. */
+    __atomic_store_n(&seqlock->sequence, sequence + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(copies, value, size);
+
+    /* Same for the second copy: the release store alone does not keep the stores after it from being seen first,
+     * e.g. on aarch64, which would let a reader still on the second copy accept it half written. */
+    __atomic_store_n(&seqlock->sequence, sequence + 2, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((uint8_t *) copies + size, value, size);
+}
+
+uint32_t UtilSeqlock_Read(const T_UtilSeqlock *seqlock, const void *copies, void *value, uint32_t size)
+{
+    uint32_t retryCount = 0;
+    uint32_t sequence;
+
+    for (;;) {
+        sequence = __atomic_load_n(&seqlock->sequence, __ATOMIC_ACQUIRE);
+        memcpy(value, (const uint8_t *) copies + (sequence & 1) * size, size);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&seqlock->sequence, __ATOMIC_RELAXED) == sequence) {
+            return retryCount;
+        }
+        retryCount++;
+    }
+}
+
+const void *UtilSeqlock_ReadBegin(const T_UtilSeqlock *seqlock, const void *copies, uint32_t size,
+                                  uint32_t *sequence)
+{
+    *sequence = __atomic_load_n(&seqlock->sequence, __ATOMIC_ACQUIRE);
+
+    return (const uint8_t *) copies + (*sequence & 1) * size;
+}
+
+bool UtilSeqlock_ReadRetry(const T_UtilSeqlock *seqlock, uint32_t sequence)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&seqlock->sequence, __ATOMIC_RELAXED) != sequence;
+}
+
+/* Private functions definition-----------------------------------------------*/
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
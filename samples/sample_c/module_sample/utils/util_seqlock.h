@@ -0,0 +1,103 @@
+/**
+ ********************************************************************
+ * @file    util_seqlock.h
+ * @brief   This is the header file for "util_seqlock.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef UTIL_SEQLOCK_H
+#define UTIL_SEQLOCK_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+/**
+ * A value published with a seqlock is stored twice, e.g. static T_Foo s_fooCopies[UTIL_SEQLOCK_COPY_COUNT].
+ * The writer updates one copy while readers use the other, so readers never block: they only retry a copy that
+ * overlapped a publish.
+ */
+#define UTIL_SEQLOCK_COPY_COUNT                     2
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t sequence; /*!< Incremented before each copy is updated, its lowest bit selects the copy to read. */
+} T_UtilSeqlock;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Publish a value. Writers of the same seqlock must be serialized by the caller, e.g. by the mutex
+ * protecting the working copy of the value.
+ * @param seqlock: seqlock of the value.
+ * @param copies: UTIL_SEQLOCK_COPY_COUNT consecutive copies of the value.
+ * @param value: value to publish.
+ * @param size: size of one copy.
+ */
+void UtilSeqlock_Write(T_UtilSeqlock *seqlock, void *copies, const void *value, uint32_t size);
+
+/**
+ * @brief Read the latest published value. Lock-free: the copy is retried whenever the writer publishes during it,
+ * so a writer publishing back to back can delay a reader without bound. Callable from any number of threads.
+ * @param seqlock: seqlock of the value.
+ * @param copies: UTIL_SEQLOCK_COPY_COUNT consecutive copies of the value.
+ * @param value: read value.
+ * @param size: size of one copy.
+ * @return Number of retries.
+ */
+uint32_t UtilSeqlock_Read(const T_UtilSeqlock *seqlock, const void *copies, void *value, uint32_t size);
+
+/**
+ * @brief Start reading the latest published value in place, e.g.
+ * do {
+ *     value = UtilSeqlock_ReadBegin(&s_fooSeqlock, s_fooCopies, sizeof(T_Foo), &sequence);
+ *     speed = value->speed;
+ * } while (UtilSeqlock_ReadRetry(&s_fooSeqlock, sequence));
+ * The copy may be overwritten while it is read, so only the results of a read that is not retried may be used and
+ * no pointer into the copy may be kept.
+ * @param seqlock: seqlock of the value.
+ * @param copies: UTIL_SEQLOCK_COPY_COUNT consecutive copies of the value.
+ * @param size: size of one copy.
+ * @param sequence: sequence to pass to UtilSeqlock_ReadRetry(), halved it counts the values published up to the
+ * one read.
+ * @return Copy to read.
+ */
+const void *UtilSeqlock_ReadBegin(const T_UtilSeqlock *seqlock, const void *copies, uint32_t size,
+                                  uint32_t *sequence);
+
+/**
+ * @brief Finish reading a value in place.
+ * @param seqlock: seqlock of the value.
+ * @param sequence: sequence returned by UtilSeqlock_ReadBegin().
+ * @return Whether the copy was overwritten during the read, which then has to be started again.
+ */
+bool UtilSeqlock_ReadRetry(const T_UtilSeqlock *seqlock, uint32_t sequence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTIL_SEQLOCK_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
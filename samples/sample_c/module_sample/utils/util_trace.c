@@ -0,0 +1,374 @@
+/**
+ ********************************************************************
+ * @file    util_trace.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "util_trace.h"
+#include "ziyan_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define UTIL_TRACE_LINE_BUFFER_SIZE                 384
+#define UTIL_TRACE_PHASE_COMPLETE                   'X'
+#define UTIL_TRACE_PHASE_INSTANT                    'i'
+#define UTIL_TRACE_PHASE_COUNTER                    'C'
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t timestampUs;
+    uint32_t durationUs;
+    uint8_t phase;
+    uint8_t category;
+    const char *name;
+    const char *argName; /*!< NULL for no argument. */
+    uint64_t arg;
+} T_UtilTraceEvent;
+
+typedef struct {
+    uint32_t head; /*!< Events written so far, the owning thread writes the event at head before publishing head + 1. */
+    char name[UTIL_TRACE_THREAD_NAME_SIZE];
+    T_UtilTraceEvent event[UTIL_TRACE_THREAD_EVENT_COUNT];
+} T_UtilTraceThread;
+
+typedef struct {
+    UtilTraceWriteFunc write;
+    void *arg;
+    bool isFirst;
+} T_UtilTraceWriter;
+
+/* Export values -------------------------------------------------------------*/
+bool g_utilTraceIsEnabled = false;
+
+/* Private values ------------------------------------------------------------*/
+static uint64_t s_captureStartUs = 0;
+static T_UtilTraceThread *s_threads[UTIL_TRACE_THREAD_MAX];
+static uint32_t s_threadCount = 0;
+static uint64_t s_droppedEventCount = 0;
+static __thread T_UtilTraceThread *s_thread = NULL;
+static __thread bool s_isThreadFull = false;
+static __thread char s_threadName[UTIL_TRACE_THREAD_NAME_SIZE];
+
+static const char *s_categoryNames[UTIL_TRACE_CATEGORY_COUNT] = {
+    "user", "task", "mutex", "semaphore", "file", "socket",
+};
+
+/* Private functions declaration ---------------------------------------------*/
+static T_UtilTraceThread *UtilTrace_GetThread(void);
+static void UtilTrace_Record(uint8_t phase, E_UtilTraceCategory category, const char *name, uint64_t timestampUs,
+                             uint32_t durationUs, const char *argName, uint64_t arg);
+static void UtilTrace_CopyName(char *dest, const char *src);
+static void UtilTrace_ExportThread(T_UtilTraceWriter *writer, uint32_t tid, const T_UtilTraceThread *thread,
+                                   T_UtilTraceEvent *events);
+static void UtilTrace_WriteEvent(T_UtilTraceWriter *writer, uint32_t tid, const T_UtilTraceEvent *event);
+static void UtilTrace_WriteEntry(T_UtilTraceWriter *writer, const char *entry, int len);
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode UtilTrace_Start(void)
+{
+    // Rings are not cleared as their threads may be writing, the export skips events older than the capture.
+    s_captureStartUs = UtilTrace_GetTimeUs();
+    __atomic_store_n(&g_utilTraceIsEnabled, true, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode UtilTrace_Stop(void)
+{
+    __atomic_store_n(&g_utilTraceIsEnabled, false, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+void UtilTrace_SetThreadName(const char *name)
+{
+    if (name == NULL) {
+        return;
+    }
+
+    UtilTrace_CopyName(s_threadName, name);
+    if (s_thread != NULL) {
+        UtilTrace_CopyName(s_thread->name, name);
+    }
+}
+
+uint64_t UtilTrace_GetTimeUs(void)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    uint64_t timeUs = 0;
+
+    if (osalHandler == NULL || osalHandler->GetTimeUs(&timeUs) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return 0;
+    }
+
+    return timeUs;
+}
+
+void UtilTrace_Complete(E_UtilTraceCategory category, const char *name, uint64_t startUs, const char *argName,
+                        uint64_t arg)
+{
+    uint64_t endUs = UtilTrace_GetTimeUs();
+
+    // The OSAL clock follows the wall clock, a step back must not give a huge duration.
+    UtilTrace_Record(UTIL_TRACE_PHASE_COMPLETE, category, name, startUs,
+                     endUs > startUs ? (uint32_t) (endUs - startUs) : 0, argName, arg);
+}
+
+void UtilTrace_Instant(E_UtilTraceCategory category, const char *name, const char *argName, uint64_t arg)
+{
+    UtilTrace_Record(UTIL_TRACE_PHASE_INSTANT, category, name, UtilTrace_GetTimeUs(), 0, argName, arg);
+}
+
+void UtilTrace_Counter(const char *name, uint64_t value)
+{
+    UtilTrace_Record(UTIL_TRACE_PHASE_COUNTER, UTIL_TRACE_CATEGORY_USER, name, UtilTrace_GetTimeUs(), 0, "value",
+                     value);
+}
+
+void UtilTrace_SpanEnd(T_UtilTraceSpan *span)
+{
+    if (span->startUs == 0) {
+        return;
+    }
+
+    UtilTrace_Complete(UTIL_TRACE_CATEGORY_USER, span->name, span->startUs, NULL, 0);
+}
+
+T_ZiyanReturnCode UtilTrace_Export(UtilTraceWriteFunc write, void *arg)
+{
+    T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
+    T_UtilTraceWriter writer = {write, arg, true};
+    T_UtilTraceEvent *events;
+    T_UtilTraceThread *thread;
+    uint32_t threadCount;
+    uint32_t i;
+
+    if (write == NULL || osalHandler == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    events = osalHandler->Malloc(sizeof(T_UtilTraceEvent) * UTIL_TRACE_THREAD_EVENT_COUNT);
+    if (events == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    write("{\"traceEvents\":[\n", 17, arg);
+    threadCount = __atomic_load_n(&s_threadCount, __ATOMIC_ACQUIRE);
+    for (i = 0; i < threadCount && i < UTIL_TRACE_THREAD_MAX; i++) {
+        thread = __atomic_load_n(&s_threads[i], __ATOMIC_ACQUIRE);
+        if (thread != NULL) {
+            UtilTrace_ExportThread(&writer, i + 1, thread, events);
+        }
+    }
+    write("\n],\"displayTimeUnit\":\"ms\"}\n", 27, arg);
+
+    osalHandler->Free(events);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode UtilTrace_GetStatistics(T_UtilTraceStatistics *statistics)
+{
+    T_UtilTraceThread *thread;
+    uint32_t i;
+
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    statistics->isEnabled = __atomic_load_n(&g_utilTraceIsEnabled, __ATOMIC_RELAXED);
+    statistics->threadCount = __atomic_load_n(&s_threadCount, __ATOMIC_ACQUIRE);
+    if (statistics->threadCount > UTIL_TRACE_THREAD_MAX) {
+        statistics->threadCount = UTIL_TRACE_THREAD_MAX;
+    }
+    statistics->eventCount = 0;
+    for (i = 0; i < statistics->threadCount; i++) {
+        thread = __atomic_load_n(&s_threads[i], __ATOMIC_ACQUIRE);
+        if (thread != NULL) {
+            statistics->eventCount += __atomic_load_n(&thread->head, __ATOMIC_RELAXED);
+        }
+    }
+    statistics->droppedEventCount = __atomic_load_n(&s_droppedEventCount, __ATOMIC_RELAXED);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_UtilTraceThread *UtilTrace_GetThread(void)
+{
+    T_ZiyanOsalHandler *osalHandler;
+    T_UtilTraceThread *thread;
+    uint32_t index;
+
+    if (s_thread != NULL || s_isThreadFull) {
+        return s_thread;
+    }
+
+    osalHandler = ZiyanPlatform_GetOsalHandler();
+    if (osalHandler == NULL) {
+        return NULL;
+    }
+
+    index = __atomic_fetch_add(&s_threadCount, 1, __ATOMIC_ACQ_REL);
+    if (index >= UTIL_TRACE_THREAD_MAX) {
+        s_isThreadFull = true;
+        return NULL;
+    }
+
+    thread = osalHandler->Malloc(sizeof(T_UtilTraceThread));
+    if (thread == NULL) {
+        s_isThreadFull = true;
+        return NULL;
+    }
+
+    thread->head = 0;
+    if (s_threadName[0] != '\0') {
+        UtilTrace_CopyName(thread->name, s_threadName);
+    } else {
+        snprintf(thread->name, sizeof(thread->name), "thread %u", index + 1);
+    }
+
+    // Buffers stay allocated after their thread exits, its events remain part of the trace.
+    __atomic_store_n(&s_threads[index], thread, __ATOMIC_RELEASE);
+    s_thread = thread;
+
+    return thread;
+}
+
+static void UtilTrace_Record(uint8_t phase, E_UtilTraceCategory category, const char *name, uint64_t timestampUs,
+                             uint32_t durationUs, const char *argName, uint64_t arg)
+{
+    T_UtilTraceThread *thread = UtilTrace_GetThread();
+    T_UtilTraceEvent *event;
+    uint32_t head;
+
+    if (thread == NULL) {
+        __atomic_fetch_add(&s_droppedEventCount, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    head = __atomic_load_n(&thread->head, __ATOMIC_RELAXED);
+    event = &thread->event[head & (UTIL_TRACE_THREAD_EVENT_COUNT - 1)];
+    event->timestampUs = timestampUs;
+    event->durationUs = durationUs;
+    event->phase = phase;
+    event->category = (uint8_t) category;
+    event->name = name;
+    event->argName = argName;
+    event->arg = arg;
+    __atomic_store_n(&thread->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void UtilTrace_CopyName(char *dest, const char *src)
+{
+    uint32_t i;
+
+    // Thread names end up in JSON strings unescaped.
+    for (i = 0; i < UTIL_TRACE_THREAD_NAME_SIZE - 1 && src[i] != '\0'; i++) {
+        dest[i] = (src[i] == '"' || src[i] == '\\' || (uint8_t) src[i] < ' ') ? '_' : src[i];
+    }
+    dest[i] = '\0';
+}
+
+static void UtilTrace_ExportThread(T_UtilTraceWriter *writer, uint32_t tid, const T_UtilTraceThread *thread,
+                                   T_UtilTraceEvent *events)
+{
+    char entry[UTIL_TRACE_LINE_BUFFER_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t first;
+    uint32_t i;
+    int len;
+
+    len = snprintf(entry, sizeof(entry),
+                   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", tid,
+                   thread->name);
+    UtilTrace_WriteEntry(writer, entry, len);
+
+    head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+    first = head > UTIL_TRACE_THREAD_EVENT_COUNT ? head - UTIL_TRACE_THREAD_EVENT_COUNT : 0;
+    for (i = first; i != head; i++) {
+        events[i & (UTIL_TRACE_THREAD_EVENT_COUNT - 1)] = thread->event[i & (UTIL_TRACE_THREAD_EVENT_COUNT - 1)];
+    }
+
+    // The thread may have overwritten the oldest copied events meanwhile, it writes event tail while head is tail.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    tail = __atomic_load_n(&thread->head, __ATOMIC_RELAXED);
+    if (tail - first >= UTIL_TRACE_THREAD_EVENT_COUNT) {
+        first = tail - UTIL_TRACE_THREAD_EVENT_COUNT + 1;
+    }
+
+    for (i = first; i != head && (int32_t) (head - i) > 0; i++) {
+        UtilTrace_WriteEvent(writer, tid, &events[i & (UTIL_TRACE_THREAD_EVENT_COUNT - 1)]);
+    }
+}
+
+static void UtilTrace_WriteEvent(T_UtilTraceWriter *writer, uint32_t tid, const T_UtilTraceEvent *event)
+{
+    char entry[UTIL_TRACE_LINE_BUFFER_SIZE];
+    uint64_t timestampUs;
+    int len;
+
+    if (event->timestampUs < s_captureStartUs || event->name == NULL) {
+        return;
+    }
+    timestampUs = event->timestampUs - s_captureStartUs;
+
+    len = snprintf(entry, sizeof(entry), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u",
+                   event->name, s_categoryNames[event->category % UTIL_TRACE_CATEGORY_COUNT], event->phase,
+                   (unsigned long long) timestampUs, tid);
+    if (len < 0 || len >= (int) sizeof(entry)) {
+        return;
+    }
+
+    if (event->phase == UTIL_TRACE_PHASE_COMPLETE) {
+        len += snprintf(entry + len, sizeof(entry) - len, ",\"dur\":%u", event->durationUs);
+    } else if (event->phase == UTIL_TRACE_PHASE_INSTANT) {
+        len += snprintf(entry + len, sizeof(entry) - len, ",\"s\":\"t\"");
+    }
+    if (len < (int) sizeof(entry) && event->argName != NULL) {
+        len += snprintf(entry + len, sizeof(entry) - len, ",\"args\":{\"%s\":%llu}", event->argName,
+                        (unsigned long long) event->arg);
+    }
+    if (len < (int) sizeof(entry)) {
+        len += snprintf(entry + len, sizeof(entry) - len, "}");
+    }
+
+    UtilTrace_WriteEntry(writer, entry, len);
+}
+
+static void UtilTrace_WriteEntry(T_UtilTraceWriter *writer, const char *entry, int len)
+{
+    if (len <= 0 || len >= UTIL_TRACE_LINE_BUFFER_SIZE) {
+        return;
+    }
+
+    if (!writer->isFirst) {
+        writer->write(",\n", 2, writer->arg);
+    }
+    writer->isFirst = false;
+    writer->write(entry, (uint32_t) len, writer->arg);
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
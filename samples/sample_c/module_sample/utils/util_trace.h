@@ -0,0 +1,135 @@
+/**
+ ********************************************************************
+ * @file    util_trace.h
+ * @brief   This is the header file for "util_trace.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef UTIL_TRACE_H
+#define UTIL_TRACE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef UTIL_TRACE_ENABLE
+#define UTIL_TRACE_ENABLE                           1 /* 0 compiles all trace points out. */
+#endif
+#define UTIL_TRACE_THREAD_MAX                       64
+#define UTIL_TRACE_THREAD_EVENT_COUNT               4096 /* Power of 2, the oldest events of a thread are overwritten. */
+#define UTIL_TRACE_THREAD_NAME_SIZE                 16
+
+#define UTIL_TRACE_CONCAT_INNER(a, b)               a##b
+#define UTIL_TRACE_CONCAT(a, b)                     UTIL_TRACE_CONCAT_INNER(a, b)
+
+/**
+ * Trace points cost a load and a not taken branch while no capture runs. Names and argument names are stored as
+ * pointers and must be string literals, e.g.
+ * UTIL_TRACE_SPAN("encode frame");
+ * records the time from this line to the end of the enclosing block.
+ */
+#if UTIL_TRACE_ENABLE
+#define UTIL_TRACE_IS_ENABLED()                     \
+    __builtin_expect(__atomic_load_n(&g_utilTraceIsEnabled, __ATOMIC_RELAXED), 0)
+#define UTIL_TRACE_SPAN(name)                       \
+    T_UtilTraceSpan UTIL_TRACE_CONCAT(utilTraceSpan, __LINE__) __attribute__((cleanup(UtilTrace_SpanEnd))) = \
+        {(name), UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0}
+#define UTIL_TRACE_INSTANT(name)                    \
+    do { if (UTIL_TRACE_IS_ENABLED()) UtilTrace_Instant(UTIL_TRACE_CATEGORY_USER, (name), NULL, 0); } while (0)
+#define UTIL_TRACE_COUNTER(name, value)             \
+    do { if (UTIL_TRACE_IS_ENABLED()) UtilTrace_Counter((name), (value)); } while (0)
+#else
+#define UTIL_TRACE_IS_ENABLED()                     0
+#define UTIL_TRACE_SPAN(name)                       do {} while (0)
+#define UTIL_TRACE_INSTANT(name)                    do {} while (0)
+#define UTIL_TRACE_COUNTER(name, value)             do {} while (0)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    UTIL_TRACE_CATEGORY_USER = 0,
+    UTIL_TRACE_CATEGORY_TASK = 1,
+    UTIL_TRACE_CATEGORY_MUTEX = 2,
+    UTIL_TRACE_CATEGORY_SEMAPHORE = 3,
+    UTIL_TRACE_CATEGORY_FILE = 4,
+    UTIL_TRACE_CATEGORY_SOCKET = 5,
+    UTIL_TRACE_CATEGORY_COUNT,
+} E_UtilTraceCategory;
+
+typedef struct {
+    const char *name;
+    uint64_t startUs; /*!< 0 when the span began with no capture running. */
+} T_UtilTraceSpan;
+
+typedef struct {
+    bool isEnabled;
+    uint32_t threadCount; /*!< Threads that recorded events, including exited ones. */
+    uint64_t eventCount;
+    uint64_t droppedEventCount; /*!< Events of threads beyond UTIL_TRACE_THREAD_MAX. */
+} T_UtilTraceStatistics;
+
+typedef void (*UtilTraceWriteFunc)(const char *data, uint32_t len, void *arg);
+
+/* Exported values -----------------------------------------------------------*/
+extern bool g_utilTraceIsEnabled;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start a capture. Each thread records into its own ring, allocated on its first event, without locks.
+ */
+T_ZiyanReturnCode UtilTrace_Start(void);
+T_ZiyanReturnCode UtilTrace_Stop(void);
+
+/**
+ * @brief Name the calling thread in the exported trace, done for tasks created by the OSAL.
+ */
+void UtilTrace_SetThreadName(const char *name);
+uint64_t UtilTrace_GetTimeUs(void);
+
+/**
+ * @brief Record an operation that started at startUs and ends now, with an optional numeric argument.
+ */
+void UtilTrace_Complete(E_UtilTraceCategory category, const char *name, uint64_t startUs, const char *argName,
+                        uint64_t arg);
+void UtilTrace_Instant(E_UtilTraceCategory category, const char *name, const char *argName, uint64_t arg);
+void UtilTrace_Counter(const char *name, uint64_t value);
+void UtilTrace_SpanEnd(T_UtilTraceSpan *span);
+
+/**
+ * @brief Format the events of the last capture in the Chrome trace event JSON format, loaded by chrome://tracing and
+ * ui.perfetto.dev. Safe to call during a capture, events overwritten while being read are left out.
+ * @param write: called with consecutive pieces of the text.
+ * @param arg: passed to write.
+ */
+T_ZiyanReturnCode UtilTrace_Export(UtilTraceWriteFunc write, void *arg);
+T_ZiyanReturnCode UtilTrace_GetStatistics(T_UtilTraceStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTIL_TRACE_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
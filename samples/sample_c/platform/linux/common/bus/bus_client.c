@@ -0,0 +1,354 @@
+/**
+ ********************************************************************
+ * @file    bus_client.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "bus_client.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static T_BusTelemetryTopic *BusClient_GetTopic(const T_BusClient *client, uint16_t topic);
+static bool BusClient_IsClosed(const T_BusClient *client);
+static bool BusClient_WaitChange(uint32_t *changeCount, uint32_t *waiterCount, uint32_t lastChangeCount,
+                                 uint64_t deadlineUs);
+static uint64_t BusClient_GetTimeUs(void);
+
+/* Private values ------------------------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode BusClient_Open(T_BusClient *client, const char *name)
+{
+    T_ZiyanReturnCode returnCode;
+    T_BusTelemetryHeader *header;
+    struct stat status;
+    int fd;
+
+    if (client == NULL || name == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    memset(client, 0, sizeof(T_BusClient));
+
+    // Opened for writing only for the waiter counts, the futexes are shared between processes.
+    fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return errno == ENOENT ? ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND : ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    // Created by the publisher but not sized yet.
+    if (status.st_size < BUS_TELEMETRY_HEADER_SIZE) {
+        close(fd);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    header = mmap(NULL, (size_t) status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != BUS_TELEMETRY_MAGIC) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+        goto out;
+    }
+    if (header->version != BUS_TELEMETRY_VERSION || header->segmentSize != (uint64_t) status.st_size) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT;
+        goto out;
+    }
+
+    client->header = header;
+    client->segmentSize = header->segmentSize;
+    client->changeCount = __atomic_load_n(&header->changeCount, __ATOMIC_ACQUIRE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    munmap(header, (size_t) status.st_size);
+
+    return returnCode;
+}
+
+void BusClient_Close(T_BusClient *client)
+{
+    if (client == NULL || client->header == NULL) {
+        return;
+    }
+
+    munmap(client->header, client->segmentSize);
+    client->header = NULL;
+}
+
+bool BusClient_IsOpen(const T_BusClient *client)
+{
+    if (client == NULL || client->header == NULL || BusClient_IsClosed(client)) {
+        return false;
+    }
+
+    // A publisher that crashed never closed its bus.
+    return kill(client->header->publisherPid, 0) == 0 || errno == EPERM;
+}
+
+T_ZiyanReturnCode BusClient_ReadBegin(const T_BusClient *client, uint16_t topic, T_BusClientView *view)
+{
+    const T_BusTelemetryTopic *area;
+
+    if (client == NULL || client->header == NULL || topic >= BUS_TELEMETRY_TOPIC_MAX || view == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    area = BusClient_GetTopic(client, topic);
+    if (area == NULL || __atomic_load_n(&area->writeCount, __ATOMIC_ACQUIRE) == 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    view->record = UtilSeqlock_ReadBegin(&area->seqlock, BUS_TELEMETRY_TOPIC_COPIES(area), area->recordSize,
+                                         &view->lockSequence);
+    view->data = view->record + 1;
+    view->seqlock = &area->seqlock;
+    view->dataSize = area->dataSize;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+bool BusClient_ReadRetry(const T_BusClientView *view)
+{
+    return UtilSeqlock_ReadRetry(view->seqlock, view->lockSequence);
+}
+
+T_ZiyanReturnCode BusClient_Read(const T_BusClient *client, uint16_t topic, void *data, uint16_t dataSize,
+                                 T_BusTelemetryRecord *record)
+{
+    T_ZiyanReturnCode returnCode;
+    T_BusClientView view;
+
+    if (data == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    do {
+        returnCode = BusClient_ReadBegin(client, topic, &view);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            return returnCode;
+        }
+        if (view.dataSize != dataSize) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+        }
+
+        memcpy(data, view.data, dataSize);
+        if (record != NULL) {
+            memcpy(record, view.record, sizeof(T_BusTelemetryRecord));
+        }
+    } while (BusClient_ReadRetry(&view));
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode BusClient_ReadNext(const T_BusClient *client, uint16_t topic, uint64_t *sequence, void *data,
+                                     uint16_t dataSize, T_BusTelemetryRecord *record)
+{
+    const T_BusTelemetryTopic *area;
+    const T_BusTelemetryRecord *slot;
+    uint64_t writeCount;
+    uint64_t nextSequence;
+    uint64_t slotSequence;
+
+    if (client == NULL || client->header == NULL || topic >= BUS_TELEMETRY_TOPIC_MAX || sequence == NULL ||
+        data == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    area = BusClient_GetTopic(client, topic);
+    if (area == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+    if (area->dataSize != dataSize) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    // A record is invalidated before it is overwritten, so one still holding its sequence after the copy is whole.
+    // The record after the latest may be being written, so the oldest one read is the one after it in the ring.
+    for (;;) {
+        writeCount = __atomic_load_n(&area->writeCount, __ATOMIC_ACQUIRE);
+        if (writeCount <= *sequence) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+        }
+
+        nextSequence = *sequence + 1;
+        if (writeCount - nextSequence >= area->historyDepth - 1) {
+            nextSequence = writeCount - area->historyDepth + 2;
+        }
+
+        slot = (const T_BusTelemetryRecord *) (BUS_TELEMETRY_TOPIC_HISTORY(area) +
+                                               (size_t) ((nextSequence - 1) & (area->historyDepth - 1)) *
+                                               area->recordSize);
+        slotSequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (slotSequence != nextSequence) {
+            continue;
+        }
+
+        memcpy(data, slot + 1, dataSize);
+        if (record != NULL) {
+            memcpy(record, slot, sizeof(T_BusTelemetryRecord));
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == nextSequence) {
+            break;
+        }
+    }
+
+    if (record != NULL) {
+        record->sequence = nextSequence;
+    }
+    *sequence = nextSequence;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode BusClient_Wait(const T_BusClient *client, uint16_t topic, uint64_t sequence, uint32_t timeoutMs)
+{
+    T_BusTelemetryTopic *area;
+    uint64_t deadlineUs = BusClient_GetTimeUs() + (uint64_t) timeoutMs * 1000;
+    uint32_t changeCount;
+
+    if (client == NULL || client->header == NULL || topic >= BUS_TELEMETRY_TOPIC_MAX) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    // Until its first value the topic has no area, the change count of the bus tells when it may have one.
+    for (;;) {
+        area = BusClient_GetTopic(client, topic);
+        changeCount = __atomic_load_n(area != NULL ? &area->changeCount : &client->header->changeCount,
+                                      __ATOMIC_SEQ_CST);
+        if (BusClient_IsClosed(client)) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE;
+        }
+        if (area != NULL && __atomic_load_n(&area->writeCount, __ATOMIC_ACQUIRE) > sequence) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
+
+        if (area != NULL) {
+            if (!BusClient_WaitChange(&area->changeCount, &area->waiterCount, changeCount, deadlineUs)) {
+                return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+            }
+        } else {
+            if (!BusClient_WaitChange(&client->header->changeCount, &client->header->waiterCount, changeCount,
+                                      deadlineUs)) {
+                return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+            }
+        }
+    }
+}
+
+T_ZiyanReturnCode BusClient_WaitAny(T_BusClient *client, uint32_t timeoutMs)
+{
+    uint64_t deadlineUs = BusClient_GetTimeUs() + (uint64_t) timeoutMs * 1000;
+    uint32_t changeCount;
+
+    if (client == NULL || client->header == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    for (;;) {
+        changeCount = __atomic_load_n(&client->header->changeCount, __ATOMIC_SEQ_CST);
+        if (BusClient_IsClosed(client)) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE;
+        }
+        if (changeCount != client->changeCount) {
+            client->changeCount = changeCount;
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
+
+        if (!BusClient_WaitChange(&client->header->changeCount, &client->header->waiterCount, changeCount,
+                                  deadlineUs)) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+        }
+    }
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_BusTelemetryTopic *BusClient_GetTopic(const T_BusClient *client, uint16_t topic)
+{
+    uint32_t offset = __atomic_load_n(&client->header->topicOffsets[topic], __ATOMIC_ACQUIRE);
+
+    if (offset < BUS_TELEMETRY_HEADER_SIZE || offset + sizeof(T_BusTelemetryTopic) > client->segmentSize) {
+        return NULL;
+    }
+
+    return (T_BusTelemetryTopic *) ((uint8_t *) client->header + offset);
+}
+
+static bool BusClient_IsClosed(const T_BusClient *client)
+{
+    return __atomic_load_n(&client->header->state, __ATOMIC_SEQ_CST) != BUS_TELEMETRY_STATE_OPEN;
+}
+
+// The kernel only sleeps while the change count still holds the value read before the condition was checked, so a
+// value published in between is never missed. Returns false once the deadline passed.
+static bool BusClient_WaitChange(uint32_t *changeCount, uint32_t *waiterCount, uint32_t lastChangeCount,
+                                 uint64_t deadlineUs)
+{
+    struct timespec timeout;
+    uint64_t timeUs = BusClient_GetTimeUs();
+
+    if (timeUs >= deadlineUs) {
+        return false;
+    }
+    timeout.tv_sec = (time_t) ((deadlineUs - timeUs) / 1000000);
+    timeout.tv_nsec = (long) ((deadlineUs - timeUs) % 1000000) * 1000;
+
+    __atomic_add_fetch(waiterCount, 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, changeCount, FUTEX_WAIT, lastChangeCount, &timeout, NULL, 0);
+    __atomic_sub_fetch(waiterCount, 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static uint64_t BusClient_GetTimeUs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000 + (uint64_t) time.tv_nsec / 1000;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,151 @@
+/**
+ ********************************************************************
+ * @file    bus_client.h
+ * @brief   This is the header file for "bus_client.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BUS_CLIENT_H
+#define BUS_CLIENT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "bus_telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    T_BusTelemetryHeader *header; /*!< Mapped bus, only the waiter counts are written by clients. */
+    uint64_t segmentSize;
+    uint32_t changeCount; /*!< Change count of the bus seen by the last BusClient_WaitAny(). */
+} T_BusClient;
+
+/**
+ * Latest value of a topic read in place from the bus, e.g.
+ * do {
+ *     if (BusClient_ReadBegin(&client, ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY, &view) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+ *         break;
+ *     }
+ *     velocityZ = ((const T_ZiyanFcSubscriptionVelocity *) view.data)->data.z;
+ * } while (BusClient_ReadRetry(&view));
+ */
+typedef struct {
+    const void *data; /*!< Topic value of view.dataSize bytes, aligned to 8 bytes. */
+    const T_BusTelemetryRecord *record; /*!< Sequence, receive time and timestamp of the value. */
+    const T_UtilSeqlock *seqlock;
+    uint32_t lockSequence; /*!< Checked by BusClient_ReadRetry(). */
+    uint16_t dataSize;
+} T_BusClientView;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Map the bus of a publisher. The reads of a client are callable from any thread, BusClient_WaitAny() from
+ * one thread at a time.
+ * @param client: client to initialize.
+ * @param name: name of the shared memory object of the bus, see T_BusTelemetryConfig.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND while no publisher created the bus.
+ */
+T_ZiyanReturnCode BusClient_Open(T_BusClient *client, const char *name);
+
+/**
+ * @brief Release the mapping of a bus.
+ */
+void BusClient_Close(T_BusClient *client);
+
+/**
+ * @brief Whether the publisher of the bus is still running. A closed bus is opened again to follow a new publisher.
+ */
+bool BusClient_IsOpen(const T_BusClient *client);
+
+/**
+ * @brief Start reading the latest value of a topic in place. Lock-free, the publisher never waits for clients.
+ * @param client: opened client.
+ * @param topic: topic to read.
+ * @param view: view of the value, only valid when BusClient_ReadRetry() returns false.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND until a value of the topic is published.
+ */
+T_ZiyanReturnCode BusClient_ReadBegin(const T_BusClient *client, uint16_t topic, T_BusClientView *view);
+
+/**
+ * @brief Finish reading a value in place.
+ * @param view: view given by BusClient_ReadBegin().
+ * @return Whether the value was overwritten during the read, which then has to be started again.
+ */
+bool BusClient_ReadRetry(const T_BusClientView *view);
+
+/**
+ * @brief Copy the latest value of a topic.
+ * @param client: opened client.
+ * @param topic: topic to read.
+ * @param data: value.
+ * @param dataSize: size of the values of the topic.
+ * @param record: sequence, receive time and timestamp of the value, can be NULL.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND until a value of the topic is published.
+ */
+T_ZiyanReturnCode BusClient_Read(const T_BusClient *client, uint16_t topic, void *data, uint16_t dataSize,
+                                 T_BusTelemetryRecord *record);
+
+/**
+ * @brief Copy the value following a sequence from the history of a topic, to process every value rather than the
+ * latest. When the publisher went the history depth ahead, the oldest value kept is given and the gap in the
+ * sequences counts the values missed.
+ * @param client: opened client.
+ * @param topic: topic to read.
+ * @param sequence: sequence of the last value read, 0 at first, updated to the sequence of the value given.
+ * @param data: value.
+ * @param dataSize: size of the values of the topic.
+ * @param record: sequence, receive time and timestamp of the value, can be NULL.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND when no value follows the sequence yet.
+ */
+T_ZiyanReturnCode BusClient_ReadNext(const T_BusClient *client, uint16_t topic, uint64_t *sequence, void *data,
+                                     uint16_t dataSize, T_BusTelemetryRecord *record);
+
+/**
+ * @brief Sleep until a topic has a value following a sequence, on a futex woken by the publisher.
+ * @param client: opened client.
+ * @param topic: topic to wait for, which may not be published yet.
+ * @param sequence: sequence of the last value read of the topic.
+ * @param timeoutMs: longest wait.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT when no value came in time,
+ * ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE once the bus is closed.
+ */
+T_ZiyanReturnCode BusClient_Wait(const T_BusClient *client, uint16_t topic, uint64_t sequence, uint32_t timeoutMs);
+
+/**
+ * @brief Sleep until a value of any topic is published after the previous call, or after the bus was opened.
+ * @param client: opened client.
+ * @param timeoutMs: longest wait.
+ * @return Execution result, see BusClient_Wait().
+ */
+T_ZiyanReturnCode BusClient_WaitAny(T_BusClient *client, uint32_t timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUS_CLIENT_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
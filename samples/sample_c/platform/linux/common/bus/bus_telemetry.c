@@ -0,0 +1,277 @@
+/**
+ ********************************************************************
+ * @file    bus_telemetry.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "bus_telemetry.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Private constants ---------------------------------------------------------*/
+#define BUS_TELEMETRY_NAME_MAX_SIZE             NAME_MAX
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static T_BusTelemetryTopic *BusTelemetry_AddTopic(uint16_t topic, uint16_t dataSize);
+static bool BusTelemetry_Notify(uint32_t *changeCount, const uint32_t *waiterCount);
+static uint64_t BusTelemetry_GetTimeUs(void);
+
+/* Private values ------------------------------------------------------------*/
+static bool s_isBusInit = false;
+static uint32_t s_activeWriterCount = 0;
+static char s_busName[BUS_TELEMETRY_NAME_MAX_SIZE];
+static T_BusTelemetryHeader *s_busHeader = NULL;
+static T_BusTelemetryTopic *s_busTopics[BUS_TELEMETRY_TOPIC_MAX];
+static pthread_mutex_t s_busTopicMutex = PTHREAD_MUTEX_INITIALIZER;
+static T_BusTelemetryStatistics s_busStatistics;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode BusTelemetry_Init(const T_BusTelemetryConfig *config)
+{
+    T_BusTelemetryHeader *header;
+    int fd;
+
+    if (config == NULL || config->name == NULL || config->name[0] != '/' ||
+        strlen(config->name) >= sizeof(s_busName) || config->historyDepth < 2 ||
+        config->historyDepth > BUS_TELEMETRY_HISTORY_DEPTH_MAX ||
+        (config->historyDepth & (config->historyDepth - 1)) != 0 ||
+        config->segmentSize < BUS_TELEMETRY_HEADER_SIZE + sizeof(T_BusTelemetryTopic) +
+                              (UTIL_SEQLOCK_COPY_COUNT + config->historyDepth) *
+                              BUS_TELEMETRY_RECORD_SIZE(BUS_TELEMETRY_DATA_MAX_SIZE)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isBusInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    // Clients of a previous publisher keep the removed object mapped until they see it closed or its publisher gone.
+    shm_unlink(config->name);
+    fd = shm_open(config->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+    if (fd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (ftruncate(fd, config->segmentSize) != 0) {
+        close(fd);
+        shm_unlink(config->name);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // Populated up front, so values are published without page faults.
+    header = mmap(NULL, config->segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        shm_unlink(config->name);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    strcpy(s_busName, config->name);
+    memset(s_busTopics, 0, sizeof(s_busTopics));
+    memset(&s_busStatistics, 0, sizeof(s_busStatistics));
+
+    header->version = BUS_TELEMETRY_VERSION;
+    header->headerSize = BUS_TELEMETRY_HEADER_SIZE;
+    header->state = BUS_TELEMETRY_STATE_OPEN;
+    header->publisherPid = (int32_t) getpid();
+    header->segmentSize = config->segmentSize;
+    header->usedBytes = BUS_TELEMETRY_HEADER_SIZE;
+    header->historyDepth = config->historyDepth;
+    // Clients check the magic first, so they never see a header being filled.
+    __atomic_store_n(&header->magic, BUS_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+
+    s_busHeader = header;
+    __atomic_store_n(&s_isBusInit, true, __ATOMIC_SEQ_CST);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode BusTelemetry_DeInit(void)
+{
+    if (!s_isBusInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    __atomic_store_n(&s_isBusInit, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&s_activeWriterCount, __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+
+    // Waiting clients wake up, see the bus closed and stop waiting.
+    __atomic_store_n(&s_busHeader->state, BUS_TELEMETRY_STATE_CLOSED, __ATOMIC_SEQ_CST);
+    for (uint32_t i = 0; i < BUS_TELEMETRY_TOPIC_MAX; i++) {
+        if (s_busTopics[i] != NULL) {
+            BusTelemetry_Notify(&s_busTopics[i]->changeCount, &s_busTopics[i]->waiterCount);
+        }
+    }
+    BusTelemetry_Notify(&s_busHeader->changeCount, &s_busHeader->waiterCount);
+
+    munmap(s_busHeader, s_busHeader->segmentSize);
+    s_busHeader = NULL;
+    shm_unlink(s_busName);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode BusTelemetry_Write(uint16_t topic, const uint8_t *data, uint16_t dataSize,
+                                     const T_ZiyanDataTimestamp *timestamp)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    T_BusTelemetryTopic *area;
+    T_BusTelemetryRecord *record;
+    uint64_t sequence;
+    bool isWoken;
+
+    if (topic >= BUS_TELEMETRY_TOPIC_MAX || data == NULL || dataSize == 0 ||
+        dataSize > BUS_TELEMETRY_DATA_MAX_SIZE || timestamp == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    __atomic_add_fetch(&s_activeWriterCount, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&s_isBusInit, __ATOMIC_SEQ_CST)) {
+        __atomic_sub_fetch(&s_activeWriterCount, 1, __ATOMIC_RELEASE);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    area = __atomic_load_n(&s_busTopics[topic], __ATOMIC_ACQUIRE);
+    if (area == NULL) {
+        area = BusTelemetry_AddTopic(topic, dataSize);
+    }
+    if (area == NULL || area->dataSize != dataSize) {
+        __atomic_add_fetch(&s_busStatistics.droppedCount, 1, __ATOMIC_RELAXED);
+        returnCode = area == NULL ? ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED :
+                     ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+        goto out;
+    }
+
+    // The record in the ring is invalidated while it is written, then copied as the latest record.
+    sequence = area->writeCount + 1;
+    record = (T_BusTelemetryRecord *) (BUS_TELEMETRY_TOPIC_HISTORY(area) +
+                                       (size_t) ((sequence - 1) & (area->historyDepth - 1)) * area->recordSize);
+    __atomic_store_n(&record->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->receiveTimeUs = BusTelemetry_GetTimeUs();
+    record->timestamp = *timestamp;
+    memcpy(record + 1, data, dataSize);
+    __atomic_store_n(&record->sequence, sequence, __ATOMIC_RELEASE);
+
+    UtilSeqlock_Write(&area->seqlock, BUS_TELEMETRY_TOPIC_COPIES(area), record, area->recordSize);
+    __atomic_store_n(&area->writeCount, sequence, __ATOMIC_RELEASE);
+
+    isWoken = BusTelemetry_Notify(&area->changeCount, &area->waiterCount);
+    isWoken |= BusTelemetry_Notify(&s_busHeader->changeCount, &s_busHeader->waiterCount);
+    __atomic_add_fetch(&s_busStatistics.publishedCount, 1, __ATOMIC_RELAXED);
+    if (isWoken) {
+        __atomic_add_fetch(&s_busStatistics.wakeCount, 1, __ATOMIC_RELAXED);
+    }
+
+out:
+    __atomic_sub_fetch(&s_activeWriterCount, 1, __ATOMIC_RELEASE);
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode BusTelemetry_GetStatistics(T_BusTelemetryStatistics *statistics)
+{
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    statistics->publishedCount = __atomic_load_n(&s_busStatistics.publishedCount, __ATOMIC_RELAXED);
+    statistics->droppedCount = __atomic_load_n(&s_busStatistics.droppedCount, __ATOMIC_RELAXED);
+    statistics->wakeCount = __atomic_load_n(&s_busStatistics.wakeCount, __ATOMIC_RELAXED);
+    statistics->topicCount = __atomic_load_n(&s_busStatistics.topicCount, __ATOMIC_RELAXED);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_BusTelemetryTopic *BusTelemetry_AddTopic(uint16_t topic, uint16_t dataSize)
+{
+    T_BusTelemetryTopic *area = NULL;
+    uint32_t recordSize = BUS_TELEMETRY_RECORD_SIZE(dataSize);
+    uint64_t areaSize = sizeof(T_BusTelemetryTopic) +
+                        (uint64_t) (UTIL_SEQLOCK_COPY_COUNT + s_busHeader->historyDepth) * recordSize;
+
+    areaSize = (areaSize + BUS_TELEMETRY_ALIGN - 1) & ~((uint64_t) BUS_TELEMETRY_ALIGN - 1);
+
+    // Areas are only ever added, other topics keep publishing while one is placed.
+    pthread_mutex_lock(&s_busTopicMutex);
+    if (s_busTopics[topic] != NULL) {
+        area = s_busTopics[topic];
+        goto out;
+    }
+    if (s_busHeader->segmentSize - s_busHeader->usedBytes < areaSize) {
+        goto out;
+    }
+
+    area = (T_BusTelemetryTopic *) ((uint8_t *) s_busHeader + s_busHeader->usedBytes);
+    area->topic = topic;
+    area->dataSize = dataSize;
+    area->recordSize = recordSize;
+    area->historyDepth = s_busHeader->historyDepth;
+    __atomic_store_n(&s_busHeader->topicOffsets[topic], (uint32_t) s_busHeader->usedBytes, __ATOMIC_RELEASE);
+    s_busHeader->usedBytes += areaSize;
+    __atomic_store_n(&s_busTopics[topic], area, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&s_busStatistics.topicCount, 1, __ATOMIC_RELAXED);
+
+out:
+    pthread_mutex_unlock(&s_busTopicMutex);
+
+    return area;
+}
+
+// The increment is ordered before the read of the waiter count, and waiters increment it before reading the change
+// count, so either the wake is made or the waiter sees the change.
+static bool BusTelemetry_Notify(uint32_t *changeCount, const uint32_t *waiterCount)
+{
+    __atomic_add_fetch(changeCount, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiterCount, __ATOMIC_SEQ_CST) == 0) {
+        return false;
+    }
+
+    syscall(SYS_futex, changeCount, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+    return true;
+}
+
+static uint64_t BusTelemetry_GetTimeUs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000 + (uint64_t) time.tv_nsec / 1000;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,148 @@
+/**
+ ********************************************************************
+ * @file    bus_telemetry.h
+ * @brief   This is the header file for "bus_telemetry.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef BUS_TELEMETRY_H
+#define BUS_TELEMETRY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "utils/util_seqlock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define BUS_TELEMETRY_MAGIC                     0x5342545A // "ZTBS"
+#define BUS_TELEMETRY_VERSION                   1
+#define BUS_TELEMETRY_HEADER_SIZE               4096
+#define BUS_TELEMETRY_TOPIC_MAX                 64
+#define BUS_TELEMETRY_DATA_MAX_SIZE             1024
+#define BUS_TELEMETRY_HISTORY_DEPTH_MAX         4096
+#define BUS_TELEMETRY_ALIGN                     64
+#define BUS_TELEMETRY_STATE_OPEN                1
+#define BUS_TELEMETRY_STATE_CLOSED              2
+
+/* Size of a record holding dataSize bytes of value. */
+#define BUS_TELEMETRY_RECORD_SIZE(dataSize) \
+    ((sizeof(T_BusTelemetryRecord) + (dataSize) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1))
+
+/* Copies of the latest record and ring of records following the T_BusTelemetryTopic of a topic area. */
+#define BUS_TELEMETRY_TOPIC_COPIES(area)        ((uint8_t *) (area) + sizeof(T_BusTelemetryTopic))
+#define BUS_TELEMETRY_TOPIC_HISTORY(area) \
+    (BUS_TELEMETRY_TOPIC_COPIES(area) + (size_t) UTIL_SEQLOCK_COPY_COUNT * (area)->recordSize)
+
+/* Exported types ------------------------------------------------------------*/
+/*
+ * A bus is a POSIX shared memory object, /dev/shm/<name> on Linux, written by one publisher process and mapped by
+ * any number of clients on the same machine, so the layout is native. It holds a T_BusTelemetryHeader padded to
+ * BUS_TELEMETRY_HEADER_SIZE, then an area per topic placed on its first value: a T_BusTelemetryTopic, the latest
+ * record twice for its seqlock, then a ring of historyDepth records. Records are a T_BusTelemetryRecord followed by
+ * the value, recordSize bytes apart.
+ *
+ * The 32 bit counters named changeCount are futex words, incremented after each value and woken when their
+ * waiterCount is not zero.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t state; /*!< Closed by the publisher on exit, clients then open the bus again. */
+    int32_t publisherPid;
+    uint64_t segmentSize;
+    uint64_t usedBytes; /*!< Bytes of the header and of the topic areas placed so far. */
+    uint32_t historyDepth; /*!< Records kept per topic, a power of 2. */
+    uint32_t reserved;
+    uint32_t changeCount __attribute__((aligned(BUS_TELEMETRY_ALIGN))); /*!< Values of any topic, wrapping. */
+    uint32_t waiterCount; /*!< Clients waiting on changeCount. */
+    uint32_t topicOffsets[BUS_TELEMETRY_TOPIC_MAX]; /*!< Offset of the area of each topic, 0 before its first value. */
+} T_BusTelemetryHeader;
+
+typedef struct {
+    uint16_t topic;
+    uint16_t dataSize; /*!< Bytes of every value of the topic. */
+    uint32_t recordSize;
+    uint32_t historyDepth;
+    T_UtilSeqlock seqlock; /*!< Seqlock of the latest record. */
+    uint64_t writeCount; /*!< Values of the topic published, the sequence of the latest record. */
+    uint32_t changeCount __attribute__((aligned(BUS_TELEMETRY_ALIGN)));
+    uint32_t waiterCount;
+} __attribute__((aligned(BUS_TELEMETRY_ALIGN))) T_BusTelemetryTopic;
+
+typedef struct {
+    uint64_t sequence; /*!< Values of the topic published up to this one, starting at 1. In the history ring it is 0
+                            while the record is written. */
+    uint64_t receiveTimeUs; /*!< CLOCK_MONOTONIC when the value was given to the publisher. */
+    T_ZiyanDataTimestamp timestamp; /*!< Timestamp of the value given by the subscription. */
+} T_BusTelemetryRecord;
+
+typedef struct {
+    const char *name; /*!< Name of the shared memory object, starting with '/'. */
+    uint32_t segmentSize; /*!< Bytes of the shared memory object, holding the header and all topic areas. */
+    uint32_t historyDepth; /*!< Records kept per topic for clients catching up, a power of 2, all but the one being
+                                written readable. */
+} T_BusTelemetryConfig;
+
+typedef struct {
+    uint64_t publishedCount;
+    uint64_t droppedCount; /*!< Values of a topic with no room left for its area, or of a changed size. */
+    uint64_t wakeCount; /*!< Values that woke waiting clients. */
+    uint32_t topicCount;
+} T_BusTelemetryStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Create the shared memory object of the bus, replacing the one of a previous publisher.
+ * @param config: bus configuration.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode BusTelemetry_Init(const T_BusTelemetryConfig *config);
+
+/**
+ * @brief Close the bus, waking all waiting clients, and remove its shared memory object. Clients keep their mapping
+ * until they close it.
+ */
+T_ZiyanReturnCode BusTelemetry_DeInit(void);
+
+/**
+ * @brief Publish a value. Lock-free and never blocks, except for placing the area of a topic on its first value.
+ * Values of one topic must be given by one thread at a time.
+ * @param topic: topic of the value, less than BUS_TELEMETRY_TOPIC_MAX.
+ * @param data: value.
+ * @param dataSize: size of the value, 1 to BUS_TELEMETRY_DATA_MAX_SIZE, the same for all values of a topic.
+ * @param timestamp: timestamp of the value.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode BusTelemetry_Write(uint16_t topic, const uint8_t *data, uint16_t dataSize,
+                                     const T_ZiyanDataTimestamp *timestamp);
+T_ZiyanReturnCode BusTelemetry_GetStatistics(T_BusTelemetryStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUS_TELEMETRY_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
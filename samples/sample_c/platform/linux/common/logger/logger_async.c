@@ -0,0 +1,778 @@
+/**
+ ********************************************************************
+ * @file    logger_async.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "logger_async.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <utils/util_misc.h>
+
+/* Private constants ---------------------------------------------------------*/
+#define LOGGER_ASYNC_DEFAULT_RING_SIZE          (64 * 1024)
+#define LOGGER_ASYNC_DEFAULT_FLUSH_SIZE         (16 * 1024)
+#define LOGGER_ASYNC_DEFAULT_FLUSH_PERIOD_MS    100
+#define LOGGER_ASYNC_THREAD_MAX_NUM             256
+#define LOGGER_ASYNC_IOV_BATCH_NUM              64
+#define LOGGER_ASYNC_RECORD_ALIGN               8
+#define LOGGER_ASYNC_RECORD_WRAP                0xFFFF
+#define LOGGER_ASYNC_LATENCY_BUCKET_NUM         128
+#define LOGGER_ASYNC_CACHE_LINE_SIZE            64
+#define LOGGER_ASYNC_LEVEL_SEARCH_LEN           48
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t sequence;
+    uint16_t len;
+    uint8_t sinkIndex;
+    uint8_t level;
+} T_LoggerAsyncRecordHeader;
+
+typedef struct _LoggerAsyncRing {
+    // Written by the owner thread only.
+    uint32_t head __attribute__((aligned(LOGGER_ASYNC_CACHE_LINE_SIZE)));
+    uint64_t recordCount;
+    uint64_t droppedRecordCount;
+    uint64_t droppedBytes;
+    uint32_t maxCallLatencyNs;
+    bool isOrphaned;
+    uint32_t latencyHistogram[LOGGER_ASYNC_LATENCY_BUCKET_NUM];
+    // Written by the writer thread only.
+    uint32_t tail __attribute__((aligned(LOGGER_ASYNC_CACHE_LINE_SIZE)));
+    uint64_t reportedDroppedRecordCount;
+    pid_t tid;
+    uint32_t size;
+    uint8_t *buffer;
+    struct _LoggerAsyncRing *next;
+} T_LoggerAsyncRing;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *LoggerAsync_WriterTask(void *arg);
+static T_LoggerAsyncRing *LoggerAsync_GetThreadRing(void);
+static void LoggerAsync_CreateRingKey(void);
+static void LoggerAsync_ThreadExit(void *arg);
+static void LoggerAsync_Wake(void);
+static void LoggerAsync_Drain(void);
+static void LoggerAsync_WriteSink(uint8_t sinkIndex, struct iovec *iov, int iovCount);
+static void LoggerAsync_ReportDrop(uint64_t droppedRecordCount);
+static void LoggerAsync_RetireRing(T_LoggerAsyncRing *ring);
+static uint64_t LoggerAsync_GetTimeNs(void);
+static uint32_t LoggerAsync_GetLatencyBucket(uint32_t latencyNs);
+static uint32_t LoggerAsync_GetBucketUpperNs(uint32_t bucket);
+
+/* Private values ------------------------------------------------------------*/
+static T_LoggerAsyncConfig s_loggerConfig;
+static bool s_isLoggerInit = false;
+static uint32_t s_loggerGeneration = 0;
+static int s_sinkFd[LOGGER_ASYNC_SINK_MAX_NUM];
+static E_LoggerAsyncSinkType s_sinkType[LOGGER_ASYNC_SINK_MAX_NUM];
+static uint8_t s_sinkCount = 0;
+static uint64_t s_sinkSize[LOGGER_ASYNC_SINK_MAX_NUM];
+static uint64_t s_sinkSizeMax[LOGGER_ASYNC_SINK_MAX_NUM];
+static LoggerAsyncRotateFunc s_sinkRotate[LOGGER_ASYNC_SINK_MAX_NUM];
+static int s_wakeFd = -1;
+static bool s_isWakePending = false;
+static bool s_isWriterExit = false;
+static pthread_t s_writerThread;
+static uint32_t s_sequence = 0;
+static uint32_t s_pendingBytes = 0;
+
+static pthread_key_t s_ringKey;
+static pthread_once_t s_ringKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t s_ringMutex = PTHREAD_MUTEX_INITIALIZER;
+static T_LoggerAsyncRing *s_ringList = NULL;
+static uint32_t s_ringCount = 0;
+static __thread T_LoggerAsyncRing *s_threadRing = NULL;
+static __thread uint32_t s_threadRingGeneration = 0;
+
+static pthread_mutex_t s_flushMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_flushCond;
+static uint32_t s_flushRequestEpoch = 0;
+static uint32_t s_flushDoneEpoch = 0;
+
+static T_LoggerAsyncStatistics s_retiredStatistics;
+static uint32_t s_retiredLatencyHistogram[LOGGER_ASYNC_LATENCY_BUCKET_NUM];
+static uint64_t s_writtenBytes = 0;
+static uint64_t s_writeCallCount = 0;
+static uint64_t s_writeErrorCount = 0;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode LoggerAsync_Init(const T_LoggerAsyncConfig *config)
+{
+    pthread_condattr_t condAttr;
+
+    if (s_isLoggerInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    if (config != NULL) {
+        if (config->threadRingSize < 4096 || (config->threadRingSize & (config->threadRingSize - 1)) != 0) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+        }
+        s_loggerConfig = *config;
+    } else {
+        s_loggerConfig.threadRingSize = LOGGER_ASYNC_DEFAULT_RING_SIZE;
+        s_loggerConfig.flushSize = LOGGER_ASYNC_DEFAULT_FLUSH_SIZE;
+        s_loggerConfig.flushPeriodMs = LOGGER_ASYNC_DEFAULT_FLUSH_PERIOD_MS;
+        s_loggerConfig.flushLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_ERROR;
+    }
+
+    if (pthread_once(&s_ringKeyOnce, LoggerAsync_CreateRingKey) != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    s_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s_wakeFd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_flushCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    s_sinkCount = 0;
+    s_isWakePending = false;
+    s_isWriterExit = false;
+    s_pendingBytes = 0;
+    s_loggerGeneration++;
+
+    if (pthread_create(&s_writerThread, NULL, LoggerAsync_WriterTask, NULL) != 0) {
+        pthread_cond_destroy(&s_flushCond);
+        close(s_wakeFd);
+        s_wakeFd = -1;
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    pthread_setname_np(s_writerThread, "logger_async");
+
+    __atomic_store_n(&s_isLoggerInit, true, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode LoggerAsync_DeInit(void)
+{
+    T_LoggerAsyncRing *ring;
+    uint8_t i;
+
+    if (!s_isLoggerInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    __atomic_store_n(&s_isLoggerInit, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&s_isWriterExit, true, __ATOMIC_RELEASE);
+    LoggerAsync_Wake();
+    pthread_join(s_writerThread, NULL);
+
+    pthread_mutex_lock(&s_ringMutex);
+    while (s_ringList != NULL) {
+        ring = s_ringList;
+        s_ringList = ring->next;
+        LoggerAsync_RetireRing(ring);
+    }
+    s_ringCount = 0;
+    pthread_mutex_unlock(&s_ringMutex);
+
+    for (i = 0; i < s_sinkCount; i++) {
+        if (s_sinkFd[i] > STDERR_FILENO) {
+            close(s_sinkFd[i]);
+        }
+    }
+    s_sinkCount = 0;
+
+    pthread_cond_destroy(&s_flushCond);
+    close(s_wakeFd);
+    s_wakeFd = -1;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode LoggerAsync_AddSink(int fd, E_LoggerAsyncSinkType type, uint8_t *sinkIndex)
+{
+    if (fd < 0 || sinkIndex == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (!s_isLoggerInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    if (s_sinkCount >= LOGGER_ASYNC_SINK_MAX_NUM) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+    }
+
+    s_sinkFd[s_sinkCount] = fd;
+    s_sinkType[s_sinkCount] = type;
+    s_sinkSizeMax[s_sinkCount] = 0;
+    s_sinkRotate[s_sinkCount] = NULL;
+    *sinkIndex = s_sinkCount;
+    __atomic_store_n(&s_sinkCount, s_sinkCount + 1, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode LoggerAsync_SetSinkRotation(uint8_t sinkIndex, uint64_t sizeMax, LoggerAsyncRotateFunc rotate)
+{
+    off_t offset;
+
+    if (sinkIndex >= __atomic_load_n(&s_sinkCount, __ATOMIC_ACQUIRE) || (sizeMax != 0 && rotate == NULL)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    // The file may already hold a header or the previous lines, they count towards the first rotation.
+    offset = lseek(s_sinkFd[sinkIndex], 0, SEEK_CUR);
+    s_sinkSize[sinkIndex] = offset > 0 ? (uint64_t) offset : 0;
+    s_sinkRotate[sinkIndex] = rotate;
+    __atomic_store_n(&s_sinkSizeMax[sinkIndex], sizeMax, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode LoggerAsync_Write(uint8_t sinkIndex, E_ZiyanLoggerConsoleLogLevel level, const uint8_t *data,
+                                    uint16_t dataLen)
+{
+    T_LoggerAsyncRing *ring;
+    T_LoggerAsyncRecordHeader *header;
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    uint64_t startTimeNs = LoggerAsync_GetTimeNs();
+    uint32_t recordSize;
+    uint32_t contiguous;
+    uint32_t offset;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t pendingBytes;
+    uint32_t latencyNs;
+    uint32_t bucket;
+
+    if (data == NULL || dataLen == 0 || dataLen == LOGGER_ASYNC_RECORD_WRAP) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (!__atomic_load_n(&s_isLoggerInit, __ATOMIC_ACQUIRE) ||
+        sinkIndex >= __atomic_load_n(&s_sinkCount, __ATOMIC_ACQUIRE)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    ring = LoggerAsync_GetThreadRing();
+    if (ring == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    recordSize = (sizeof(T_LoggerAsyncRecordHeader) + dataLen + LOGGER_ASYNC_RECORD_ALIGN - 1) &
+                 ~(uint32_t) (LOGGER_ASYNC_RECORD_ALIGN - 1);
+    head = ring->head;
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    offset = head & (ring->size - 1);
+    contiguous = ring->size - offset;
+
+    // A record never wraps, so that the writer can hand it to writev() in place.
+    if (ring->size - (head - tail) < recordSize + (contiguous < recordSize ? contiguous : 0)) {
+        __atomic_store_n(&ring->droppedRecordCount, ring->droppedRecordCount + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&ring->droppedBytes, ring->droppedBytes + dataLen, __ATOMIC_RELAXED);
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+        goto out;
+    }
+
+    if (contiguous < recordSize) {
+        header = (T_LoggerAsyncRecordHeader *) (ring->buffer + offset);
+        header->len = LOGGER_ASYNC_RECORD_WRAP;
+        head += contiguous;
+        offset = 0;
+    }
+
+    header = (T_LoggerAsyncRecordHeader *) (ring->buffer + offset);
+    header->sequence = __atomic_fetch_add(&s_sequence, 1, __ATOMIC_RELAXED);
+    header->len = dataLen;
+    header->sinkIndex = sinkIndex;
+    header->level = (uint8_t) level;
+    memcpy(header + 1, data, dataLen);
+
+    __atomic_store_n(&ring->head, head + recordSize, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->recordCount, ring->recordCount + 1, __ATOMIC_RELAXED);
+
+    pendingBytes = __atomic_add_fetch(&s_pendingBytes, recordSize, __ATOMIC_RELAXED);
+    if (level <= s_loggerConfig.flushLevel || pendingBytes >= s_loggerConfig.flushSize) {
+        LoggerAsync_Wake();
+    }
+
+out:
+    latencyNs = (uint32_t) USER_UTIL_MIN(LoggerAsync_GetTimeNs() - startTimeNs, UINT32_MAX);
+    bucket = LoggerAsync_GetLatencyBucket(latencyNs);
+    __atomic_store_n(&ring->latencyHistogram[bucket], ring->latencyHistogram[bucket] + 1, __ATOMIC_RELAXED);
+    if (latencyNs > ring->maxCallLatencyNs) {
+        __atomic_store_n(&ring->maxCallLatencyNs, latencyNs, __ATOMIC_RELAXED);
+    }
+
+    return returnCode;
+}
+
+E_ZiyanLoggerConsoleLogLevel LoggerAsync_GetLineLevel(const uint8_t *data, uint16_t dataLen)
+{
+    uint16_t searchLen = dataLen < LOGGER_ASYNC_LEVEL_SEARCH_LEN ? dataLen : LOGGER_ASYNC_LEVEL_SEARCH_LEN;
+    uint16_t i;
+
+    for (i = 0; i + 3 < searchLen; i++) {
+        if (data[i] != ']' || data[i + 1] != '-' || data[i + 2] != '[') {
+            continue;
+        }
+
+        switch (data[i + 3]) {
+            case 'E':
+                return ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_ERROR;
+            case 'W':
+                return ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_WARN;
+            case 'D':
+                return ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG;
+            default:
+                return ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_INFO;
+        }
+    }
+
+    return ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_INFO;
+}
+
+T_ZiyanReturnCode LoggerAsync_Flush(uint32_t timeoutMs)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    struct timespec deadline;
+    uint32_t epoch;
+
+    if (!s_isLoggerInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long) (timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&s_flushMutex);
+    epoch = __atomic_add_fetch(&s_flushRequestEpoch, 1, __ATOMIC_SEQ_CST);
+    LoggerAsync_Wake();
+    while ((int32_t) (s_flushDoneEpoch - epoch) < 0) {
+        if (pthread_cond_timedwait(&s_flushCond, &s_flushMutex, &deadline) == ETIMEDOUT) {
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_flushMutex);
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode LoggerAsync_GetStatistics(T_LoggerAsyncStatistics *statistics)
+{
+    uint32_t histogram[LOGGER_ASYNC_LATENCY_BUCKET_NUM];
+    const T_LoggerAsyncRing *ring;
+    uint64_t callCount = 0;
+    uint64_t count = 0;
+    uint32_t i;
+
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&s_ringMutex);
+    *statistics = s_retiredStatistics;
+    memcpy(histogram, s_retiredLatencyHistogram, sizeof(histogram));
+    for (ring = s_ringList; ring != NULL; ring = ring->next) {
+        statistics->threadCount++;
+        statistics->recordCount += __atomic_load_n(&ring->recordCount, __ATOMIC_RELAXED);
+        statistics->droppedRecordCount += __atomic_load_n(&ring->droppedRecordCount, __ATOMIC_RELAXED);
+        statistics->droppedBytes += __atomic_load_n(&ring->droppedBytes, __ATOMIC_RELAXED);
+        statistics->maxCallLatencyNs = USER_UTIL_MAX(statistics->maxCallLatencyNs,
+                                                     __atomic_load_n(&ring->maxCallLatencyNs, __ATOMIC_RELAXED));
+        for (i = 0; i < LOGGER_ASYNC_LATENCY_BUCKET_NUM; i++) {
+            histogram[i] += __atomic_load_n(&ring->latencyHistogram[i], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&s_ringMutex);
+
+    statistics->writtenBytes = __atomic_load_n(&s_writtenBytes, __ATOMIC_RELAXED);
+    statistics->writeCallCount = __atomic_load_n(&s_writeCallCount, __ATOMIC_RELAXED);
+    statistics->writeErrorCount = __atomic_load_n(&s_writeErrorCount, __ATOMIC_RELAXED);
+
+    for (i = 0; i < LOGGER_ASYNC_LATENCY_BUCKET_NUM; i++) {
+        callCount += histogram[i];
+    }
+
+    statistics->p99CallLatencyNs = 0;
+    for (i = 0; i < LOGGER_ASYNC_LATENCY_BUCKET_NUM && callCount != 0; i++) {
+        count += histogram[i];
+        if (count * 100 >= callCount * 99) {
+            statistics->p99CallLatencyNs = USER_UTIL_MIN(LoggerAsync_GetBucketUpperNs(i),
+                                                         statistics->maxCallLatencyNs);
+            break;
+        }
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void *LoggerAsync_WriterTask(void *arg)
+{
+    struct pollfd pfd = {.fd = s_wakeFd, .events = POLLIN};
+    uint64_t value;
+    bool isExit;
+
+    (void) arg;
+
+    do {
+        isExit = __atomic_load_n(&s_isWriterExit, __ATOMIC_ACQUIRE);
+        if (!isExit && poll(&pfd, 1, (int) s_loggerConfig.flushPeriodMs) > 0) {
+            if (read(s_wakeFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                __atomic_add_fetch(&s_writeErrorCount, 1, __ATOMIC_RELAXED);
+            }
+        }
+
+        // Clear before draining, so that a record queued while draining wakes the writer again.
+        __atomic_store_n(&s_isWakePending, false, __ATOMIC_SEQ_CST);
+        LoggerAsync_Drain();
+    } while (!isExit);
+
+    return NULL;
+}
+
+static T_LoggerAsyncRing *LoggerAsync_GetThreadRing(void)
+{
+    T_LoggerAsyncRing *ring = s_threadRing;
+    void *memory = NULL;
+
+    if (ring != NULL && s_threadRingGeneration == s_loggerGeneration) {
+        return ring;
+    }
+
+    if (posix_memalign(&memory, LOGGER_ASYNC_CACHE_LINE_SIZE, sizeof(T_LoggerAsyncRing)) != 0) {
+        return NULL;
+    }
+
+    ring = memory;
+    memset(ring, 0, sizeof(T_LoggerAsyncRing));
+    ring->size = s_loggerConfig.threadRingSize;
+    ring->tid = (pid_t) syscall(SYS_gettid);
+    ring->buffer = malloc(ring->size);
+    if (ring->buffer == NULL) {
+        free(ring);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&s_ringMutex);
+    if (s_ringCount >= LOGGER_ASYNC_THREAD_MAX_NUM) {
+        pthread_mutex_unlock(&s_ringMutex);
+        free(ring->buffer);
+        free(ring);
+        return NULL;
+    }
+    ring->next = s_ringList;
+    s_ringList = ring;
+    s_ringCount++;
+    pthread_mutex_unlock(&s_ringMutex);
+
+    s_threadRing = ring;
+    s_threadRingGeneration = s_loggerGeneration;
+    pthread_setspecific(s_ringKey, &s_threadRing);
+
+    return ring;
+}
+
+static void LoggerAsync_CreateRingKey(void)
+{
+    pthread_key_create(&s_ringKey, LoggerAsync_ThreadExit);
+}
+
+static void LoggerAsync_ThreadExit(void *arg)
+{
+    (void) arg;
+
+    // The ring may still hold records, the writer releases it once drained. A ring of a previous logger
+    // instance was already released by LoggerAsync_DeInit().
+    if (s_threadRing != NULL && s_threadRingGeneration == s_loggerGeneration) {
+        __atomic_store_n(&s_threadRing->isOrphaned, true, __ATOMIC_RELEASE);
+    }
+    s_threadRing = NULL;
+}
+
+static void LoggerAsync_Wake(void)
+{
+    uint64_t value = 1;
+
+    if (!__atomic_exchange_n(&s_isWakePending, true, __ATOMIC_SEQ_CST)) {
+        if (write(s_wakeFd, &value, sizeof(value)) < 0) {
+            __atomic_store_n(&s_isWakePending, false, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void LoggerAsync_Drain(void)
+{
+    T_LoggerAsyncRing *rings[LOGGER_ASYNC_THREAD_MAX_NUM];
+    uint32_t cursors[LOGGER_ASYNC_THREAD_MAX_NUM];
+    uint32_t heads[LOGGER_ASYNC_THREAD_MAX_NUM];
+    struct iovec iov[LOGGER_ASYNC_SINK_MAX_NUM][LOGGER_ASYNC_IOV_BATCH_NUM];
+    int iovCount[LOGGER_ASYNC_SINK_MAX_NUM] = {0};
+    const T_LoggerAsyncRecordHeader *header;
+    const T_LoggerAsyncRecordHeader *minHeader;
+    T_LoggerAsyncRing *ring;
+    T_LoggerAsyncRing **node;
+    uint64_t droppedRecordCount = 0;
+    uint32_t drainedBytes = 0;
+    uint32_t ringCount = 0;
+    uint32_t flushEpoch;
+    uint32_t minIndex;
+    uint32_t recordSize;
+    uint32_t offset;
+    uint32_t i;
+    uint8_t sink;
+    bool isBatchFull;
+
+    flushEpoch = __atomic_load_n(&s_flushRequestEpoch, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&s_ringMutex);
+    for (ring = s_ringList; ring != NULL && ringCount < LOGGER_ASYNC_THREAD_MAX_NUM; ring = ring->next) {
+        rings[ringCount] = ring;
+        cursors[ringCount] = ring->tail;
+        heads[ringCount] = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        ringCount++;
+    }
+    pthread_mutex_unlock(&s_ringMutex);
+
+    // Merge the rings by sequence number, so that lines keep the order they were logged in.
+    while (true) {
+        minHeader = NULL;
+        minIndex = 0;
+        for (i = 0; i < ringCount; i++) {
+            while (cursors[i] != heads[i]) {
+                offset = cursors[i] & (rings[i]->size - 1);
+                header = (const T_LoggerAsyncRecordHeader *) (rings[i]->buffer + offset);
+                if (header->len != LOGGER_ASYNC_RECORD_WRAP) {
+                    if (minHeader == NULL || (int32_t) (header->sequence - minHeader->sequence) < 0) {
+                        minHeader = header;
+                        minIndex = i;
+                    }
+                    break;
+                }
+                cursors[i] += rings[i]->size - offset;
+            }
+        }
+
+        if (minHeader == NULL) {
+            break;
+        }
+
+        sink = minHeader->sinkIndex;
+        recordSize = (sizeof(T_LoggerAsyncRecordHeader) + minHeader->len + LOGGER_ASYNC_RECORD_ALIGN - 1) &
+                     ~(uint32_t) (LOGGER_ASYNC_RECORD_ALIGN - 1);
+        iov[sink][iovCount[sink]].iov_base = (void *) (minHeader + 1);
+        iov[sink][iovCount[sink]].iov_len = minHeader->len;
+        iovCount[sink]++;
+        cursors[minIndex] += recordSize;
+        drainedBytes += recordSize;
+
+        isBatchFull = iovCount[sink] == LOGGER_ASYNC_IOV_BATCH_NUM;
+        if (!isBatchFull) {
+            continue;
+        }
+
+        // Records stay in the rings until written, release them for all sinks at once.
+        for (sink = 0; sink < s_sinkCount; sink++) {
+            LoggerAsync_WriteSink(sink, iov[sink], iovCount[sink]);
+            iovCount[sink] = 0;
+        }
+        for (i = 0; i < ringCount; i++) {
+            __atomic_store_n(&rings[i]->tail, cursors[i], __ATOMIC_RELEASE);
+        }
+    }
+
+    for (sink = 0; sink < s_sinkCount; sink++) {
+        LoggerAsync_WriteSink(sink, iov[sink], iovCount[sink]);
+    }
+    for (i = 0; i < ringCount; i++) {
+        __atomic_store_n(&rings[i]->tail, cursors[i], __ATOMIC_RELEASE);
+    }
+    __atomic_sub_fetch(&s_pendingBytes, drainedBytes, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&s_ringMutex);
+    node = &s_ringList;
+    while (*node != NULL) {
+        ring = *node;
+        droppedRecordCount += __atomic_load_n(&ring->droppedRecordCount, __ATOMIC_RELAXED) -
+                              ring->reportedDroppedRecordCount;
+        ring->reportedDroppedRecordCount = __atomic_load_n(&ring->droppedRecordCount, __ATOMIC_RELAXED);
+
+        if (__atomic_load_n(&ring->isOrphaned, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail) {
+            *node = ring->next;
+            s_ringCount--;
+            LoggerAsync_RetireRing(ring);
+            continue;
+        }
+        node = &ring->next;
+    }
+    pthread_mutex_unlock(&s_ringMutex);
+
+    if (droppedRecordCount != 0) {
+        LoggerAsync_ReportDrop(droppedRecordCount);
+    }
+
+    pthread_mutex_lock(&s_flushMutex);
+    s_flushDoneEpoch = flushEpoch;
+    pthread_cond_broadcast(&s_flushCond);
+    pthread_mutex_unlock(&s_flushMutex);
+}
+
+static void LoggerAsync_WriteSink(uint8_t sinkIndex, struct iovec *iov, int iovCount)
+{
+    uint64_t sizeMax;
+    ssize_t realLen;
+    off_t offset;
+    int fd;
+
+    while (iovCount > 0) {
+        realLen = writev(s_sinkFd[sinkIndex], iov, iovCount);
+        if (realLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            __atomic_add_fetch(&s_writeErrorCount, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        __atomic_add_fetch(&s_writeCallCount, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s_writtenBytes, (uint64_t) realLen, __ATOMIC_RELAXED);
+        s_sinkSize[sinkIndex] += (uint64_t) realLen;
+
+        while (iovCount > 0 && (size_t) realLen >= iov->iov_len) {
+            realLen -= (ssize_t) iov->iov_len;
+            iov++;
+            iovCount--;
+        }
+        if (iovCount > 0) {
+            iov->iov_base = (uint8_t *) iov->iov_base + realLen;
+            iov->iov_len -= (size_t) realLen;
+        }
+    }
+
+    // Batches only hold whole records, so a file never ends in the middle of one.
+    sizeMax = __atomic_load_n(&s_sinkSizeMax[sinkIndex], __ATOMIC_ACQUIRE);
+    if (sizeMax == 0 || s_sinkSize[sinkIndex] < sizeMax) {
+        return;
+    }
+
+    fd = s_sinkRotate[sinkIndex](s_sinkFd[sinkIndex]);
+    if (fd < 0) {
+        // Keep the current file and retry a little later rather than at every batch.
+        s_sinkSize[sinkIndex] = sizeMax - sizeMax / 16;
+        return;
+    }
+
+    offset = lseek(fd, 0, SEEK_CUR);
+    s_sinkFd[sinkIndex] = fd;
+    s_sinkSize[sinkIndex] = offset > 0 ? (uint64_t) offset : 0;
+}
+
+static void LoggerAsync_ReportDrop(uint64_t droppedRecordCount)
+{
+    char line[64];
+    struct iovec iov;
+    uint8_t sink;
+    int len;
+
+    len = snprintf(line, sizeof(line), "[LoggerAsync] %llu records dropped, ring full.\r\n",
+                   (unsigned long long) droppedRecordCount);
+    for (sink = 0; sink < s_sinkCount; sink++) {
+        if (s_sinkType[sink] != LOGGER_ASYNC_SINK_TYPE_TEXT) {
+            continue;
+        }
+        iov.iov_base = line;
+        iov.iov_len = (size_t) len;
+        LoggerAsync_WriteSink(sink, &iov, 1);
+    }
+}
+
+static void LoggerAsync_RetireRing(T_LoggerAsyncRing *ring)
+{
+    uint32_t i;
+
+    s_retiredStatistics.recordCount += ring->recordCount;
+    s_retiredStatistics.droppedRecordCount += ring->droppedRecordCount;
+    s_retiredStatistics.droppedBytes += ring->droppedBytes;
+    s_retiredStatistics.maxCallLatencyNs = USER_UTIL_MAX(s_retiredStatistics.maxCallLatencyNs,
+                                                         ring->maxCallLatencyNs);
+    for (i = 0; i < LOGGER_ASYNC_LATENCY_BUCKET_NUM; i++) {
+        s_retiredLatencyHistogram[i] += ring->latencyHistogram[i];
+    }
+
+    free(ring->buffer);
+    free(ring);
+}
+
+static uint64_t LoggerAsync_GetTimeNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+static uint32_t LoggerAsync_GetLatencyBucket(uint32_t latencyNs)
+{
+    uint32_t msb;
+
+    // 16 linear buckets, then 4 buckets per power of 2.
+    if (latencyNs < 16) {
+        return latencyNs;
+    }
+
+    msb = 31 - (uint32_t) __builtin_clz(latencyNs);
+
+    return 16 + (msb - 4) * 4 + ((latencyNs >> (msb - 2)) & 3);
+}
+
+static uint32_t LoggerAsync_GetBucketUpperNs(uint32_t bucket)
+{
+    uint32_t msb;
+
+    if (bucket < 16) {
+        return bucket;
+    }
+
+    msb = (bucket - 16) / 4 + 4;
+
+    return (uint32_t) USER_UTIL_MIN(((uint64_t) (4 + (bucket - 16) % 4 + 1) << (msb - 2)) - 1, UINT32_MAX);
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,128 @@
+/**
+ ********************************************************************
+ * @file    logger_async.h
+ * @brief   This is the header file for "logger_async.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOGGER_ASYNC_H
+#define LOGGER_ASYNC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "ziyan_logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define LOGGER_ASYNC_SINK_MAX_NUM               4
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    LOGGER_ASYNC_SINK_TYPE_TEXT = 0,
+    LOGGER_ASYNC_SINK_TYPE_BINARY = 1, /*!< Records are opaque, the logger adds no text of its own to the sink. */
+} E_LoggerAsyncSinkType;
+
+/**
+ * @brief Switch a sink to a new file, called from the logger thread between two records.
+ * @param fd: current file of the sink, closed by the function when it succeeds.
+ * @return New file descriptor, or a negative value to keep writing to the current one.
+ */
+typedef int (*LoggerAsyncRotateFunc)(int fd);
+
+typedef struct {
+    uint32_t threadRingSize; /*!< Bytes of the ring owned by each logging thread, power of 2. */
+    uint32_t flushSize; /*!< Pending bytes that wake up the writer before the flush period. */
+    uint32_t flushPeriodMs;
+    E_ZiyanLoggerConsoleLogLevel flushLevel; /*!< Records at this level or more severe are flushed at once. */
+} T_LoggerAsyncConfig;
+
+typedef struct {
+    uint32_t threadCount;
+    uint64_t recordCount;
+    uint64_t droppedRecordCount;
+    uint64_t droppedBytes;
+    uint64_t writtenBytes;
+    uint64_t writeCallCount;
+    uint64_t writeErrorCount;
+    uint32_t p99CallLatencyNs;
+    uint32_t maxCallLatencyNs;
+} T_LoggerAsyncStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start the asynchronous logger. Each logging thread appends records to a ring of its own without locking,
+ * and a background thread merges the rings in call order and hands them to the sinks with writev().
+ * @param config: logger configuration, NULL for default.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode LoggerAsync_Init(const T_LoggerAsyncConfig *config);
+
+/**
+ * @brief Flush everything, stop the background thread and close the sinks.
+ */
+T_ZiyanReturnCode LoggerAsync_DeInit(void);
+
+/**
+ * @brief Add an output of the logger.
+ * @param fd: file descriptor the records are written to, the logger owns it unless it is a standard stream.
+ * @param type: type of the records written to the sink.
+ * @param sinkIndex: index of the sink, used by LoggerAsync_Write().
+ * @return Execution result.
+ */
+T_ZiyanReturnCode LoggerAsync_AddSink(int fd, E_LoggerAsyncSinkType type, uint8_t *sinkIndex);
+
+/**
+ * @brief Rotate the file of a sink once it reaches a size.
+ * @param sinkIndex: index of the sink.
+ * @param sizeMax: size in bytes the file is rotated at, 0 to disable rotation.
+ * @param rotate: function opening the next file.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode LoggerAsync_SetSinkRotation(uint8_t sinkIndex, uint64_t sizeMax, LoggerAsyncRotateFunc rotate);
+
+/**
+ * @brief Queue a record for a sink. Never blocks: when the ring of the calling thread is full the record is
+ * dropped and accounted in the statistics.
+ */
+T_ZiyanReturnCode LoggerAsync_Write(uint8_t sinkIndex, E_ZiyanLoggerConsoleLogLevel level, const uint8_t *data,
+                                    uint16_t dataLen);
+
+/**
+ * @brief Get the level of a line formatted by the Payload SDK logger, e.g. "[12.345]-[Error]-...".
+ */
+E_ZiyanLoggerConsoleLogLevel LoggerAsync_GetLineLevel(const uint8_t *data, uint16_t dataLen);
+
+/**
+ * @brief Write all queued records and wait for completion.
+ */
+T_ZiyanReturnCode LoggerAsync_Flush(uint32_t timeoutMs);
+T_ZiyanReturnCode LoggerAsync_GetStatistics(T_LoggerAsyncStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_ASYNC_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,435 @@
+/**
+ ********************************************************************
+ * @file    logger_binary.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "logger_binary.h"
+#include "logger_async.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <utils/util_misc.h>
+
+/* Private constants ---------------------------------------------------------*/
+#define LOGGER_BINARY_CONVERSION_ARG_MAX_NUM    3
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static uint8_t LoggerBinary_ParseSite(T_LoggerBinarySite *site);
+static uint16_t LoggerBinary_FillHeader(uint8_t *record, uint16_t formatId, uint8_t level);
+static void LoggerBinary_Submit(uint8_t *record, uint16_t len, uint8_t level);
+static T_ZiyanReturnCode LoggerBinary_WriteAll(int fd, const void *data, size_t len);
+static uint8_t LoggerBinary_GetIntegerType(char lengthModifier, bool isDoubleModifier);
+
+/* Private values ------------------------------------------------------------*/
+// Boundaries of the site section, provided by the linker when at least one site is compiled in.
+extern T_LoggerBinarySite __start_ziyan_blog_site[] __attribute__((weak));
+extern T_LoggerBinarySite __stop_ziyan_blog_site[] __attribute__((weak));
+
+static bool s_isBinaryLoggerInit = false;
+static uint8_t s_binaryLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG;
+static uint8_t s_binarySinkIndex;
+static T_LoggerBinaryStatistics s_binaryStatistics;
+static uint64_t s_monotonicBaseUs = 0;
+static uint64_t s_realtimeBaseUs = 0;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode LoggerBinary_Init(uint8_t sinkIndex, E_ZiyanLoggerConsoleLogLevel level)
+{
+    if (s_isBinaryLoggerInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    s_binarySinkIndex = sinkIndex;
+    s_binaryLevel = (uint8_t) level;
+    __atomic_store_n(&s_isBinaryLoggerInit, true, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode LoggerBinary_WriteFileHeader(int fd)
+{
+    T_LoggerBinaryFileHeader fileHeader = {0};
+    T_LoggerBinarySiteHeader siteHeader = {0};
+    const T_LoggerBinarySite *site;
+    T_ZiyanReturnCode returnCode;
+    struct timespec monotonicTime;
+    struct timespec realTime;
+    size_t siteCount = 0;
+
+    if (fd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (__start_ziyan_blog_site != NULL && __stop_ziyan_blog_site != NULL) {
+        siteCount = (size_t) (__stop_ziyan_blog_site - __start_ziyan_blog_site);
+    }
+    if (siteCount >= LOGGER_BINARY_FORMAT_ID_TEXT) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+    }
+
+    // All files of a session share the same time base, so that rotated segments decode to continuous times.
+    if (s_monotonicBaseUs == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &monotonicTime);
+        clock_gettime(CLOCK_REALTIME, &realTime);
+        s_monotonicBaseUs = (uint64_t) monotonicTime.tv_sec * 1000000 + (uint64_t) monotonicTime.tv_nsec / 1000;
+        s_realtimeBaseUs = (uint64_t) realTime.tv_sec * 1000000 + (uint64_t) realTime.tv_nsec / 1000;
+    }
+
+    fileHeader.magic = LOGGER_BINARY_FILE_MAGIC;
+    fileHeader.version = LOGGER_BINARY_FILE_VERSION;
+    fileHeader.siteCount = (uint16_t) siteCount;
+    fileHeader.monotonicBaseUs = s_monotonicBaseUs;
+    fileHeader.realtimeBaseUs = s_realtimeBaseUs;
+
+    // The format strings are written once per file, records only refer to them by index.
+    returnCode = LoggerBinary_WriteAll(fd, &fileHeader, sizeof(fileHeader));
+    for (site = __start_ziyan_blog_site; returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS &&
+                                         site < __start_ziyan_blog_site + siteCount; site++) {
+        siteHeader.line = site->line;
+        siteHeader.level = site->level;
+        siteHeader.fileLen = (uint16_t) strlen(site->file);
+        siteHeader.formatLen = (uint16_t) strlen(site->format);
+
+        returnCode = LoggerBinary_WriteAll(fd, &siteHeader, sizeof(siteHeader));
+        if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            returnCode = LoggerBinary_WriteAll(fd, site->file, siteHeader.fileLen);
+        }
+        if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            returnCode = LoggerBinary_WriteAll(fd, site->format, siteHeader.formatLen);
+        }
+    }
+
+    return returnCode;
+}
+
+void LoggerBinary_Write(T_LoggerBinarySite *site, ...)
+{
+    uint8_t record[LOGGER_BINARY_RECORD_SIZE_MAX];
+    const char *stringArg;
+    const void *argData;
+    uint64_t value64 = 0;
+    int32_t value32;
+    double valueDouble;
+    uint16_t argSize;
+    uint16_t len;
+    uint8_t argCount;
+    uint8_t stringLen;
+    bool isTruncated = false;
+    uint8_t i;
+    va_list args;
+
+    if (!__atomic_load_n(&s_isBinaryLoggerInit, __ATOMIC_ACQUIRE) || site->level > s_binaryLevel) {
+        return;
+    }
+
+    argCount = __atomic_load_n(&site->argCount, __ATOMIC_ACQUIRE);
+    if (argCount == LOGGER_BINARY_ARG_COUNT_UNKNOWN) {
+        argCount = LoggerBinary_ParseSite(site);
+    }
+
+    len = LoggerBinary_FillHeader(record, (uint16_t) (site - __start_ziyan_blog_site), site->level);
+
+    va_start(args, site);
+    for (i = 0; i < argCount; i++) {
+        argData = &value64;
+        argSize = sizeof(value64);
+
+        switch (site->argTypes[i]) {
+            case LOGGER_BINARY_ARG_TYPE_INT32:
+                value32 = va_arg(args, int32_t);
+                argData = &value32;
+                argSize = sizeof(value32);
+                break;
+            case LOGGER_BINARY_ARG_TYPE_INT64:
+                value64 = va_arg(args, uint64_t);
+                break;
+            case LOGGER_BINARY_ARG_TYPE_POINTER:
+                value64 = (uint64_t) (uintptr_t) va_arg(args, void *);
+                break;
+            case LOGGER_BINARY_ARG_TYPE_DOUBLE:
+                valueDouble = va_arg(args, double);
+                memcpy(&value64, &valueDouble, sizeof(value64));
+                break;
+            case LOGGER_BINARY_ARG_TYPE_LONG_DOUBLE:
+                valueDouble = (double) va_arg(args, long double);
+                memcpy(&value64, &valueDouble, sizeof(value64));
+                break;
+            case LOGGER_BINARY_ARG_TYPE_STRING:
+                stringArg = va_arg(args, const char *);
+                if (stringArg == NULL) {
+                    stringArg = "(null)";
+                }
+                if (len >= sizeof(record)) {
+                    isTruncated = true;
+                    break;
+                }
+                stringLen = (uint8_t) strnlen(stringArg, USER_UTIL_MIN(LOGGER_BINARY_STRING_ARG_LEN_MAX,
+                                                                       sizeof(record) - len - 1));
+                record[len++] = stringLen;
+                argData = stringArg;
+                argSize = stringLen;
+                break;
+            default:
+                isTruncated = true;
+                break;
+        }
+
+        if (isTruncated || len + argSize > sizeof(record)) {
+            isTruncated = true;
+            break;
+        }
+
+        memcpy(record + len, argData, argSize);
+        len += argSize;
+    }
+    va_end(args);
+
+    if (isTruncated) {
+        __atomic_add_fetch(&s_binaryStatistics.truncatedRecordCount, 1, __ATOMIC_RELAXED);
+    }
+
+    LoggerBinary_Submit(record, len, site->level);
+}
+
+T_ZiyanReturnCode LoggerBinary_ConsoleWrite(const uint8_t *data, uint16_t dataLen)
+{
+    uint8_t record[LOGGER_BINARY_RECORD_SIZE_MAX];
+    E_ZiyanLoggerConsoleLogLevel level;
+    uint16_t len;
+
+    if (!__atomic_load_n(&s_isBinaryLoggerInit, __ATOMIC_ACQUIRE)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    level = LoggerAsync_GetLineLevel(data, dataLen);
+    len = LoggerBinary_FillHeader(record, LOGGER_BINARY_FORMAT_ID_TEXT, (uint8_t) level);
+    if (dataLen > sizeof(record) - len) {
+        dataLen = (uint16_t) (sizeof(record) - len);
+        __atomic_add_fetch(&s_binaryStatistics.truncatedRecordCount, 1, __ATOMIC_RELAXED);
+    }
+
+    memcpy(record + len, data, dataLen);
+    len += dataLen;
+    __atomic_add_fetch(&s_binaryStatistics.textRecordCount, 1, __ATOMIC_RELAXED);
+    LoggerBinary_Submit(record, len, (uint8_t) level);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+const char *LoggerBinary_NextConversion(const char *format, const char **conversion, uint8_t *argTypes,
+                                        uint8_t *argCount)
+{
+    const char *p = strchr(format, '%');
+    char lengthModifier = '\0';
+    bool isDoubleModifier = false;
+
+    *argCount = 0;
+    if (p == NULL) {
+        return NULL;
+    }
+
+    *conversion = p++;
+    if (*p == '%') {
+        return p + 1;
+    }
+
+    while (*p != '\0' && strchr("-+ #0'", *p) != NULL) {
+        p++;
+    }
+
+    if (*p == '*') {
+        argTypes[(*argCount)++] = LOGGER_BINARY_ARG_TYPE_INT32;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            argTypes[(*argCount)++] = LOGGER_BINARY_ARG_TYPE_INT32;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    if (*p != '\0' && strchr("hlLqjzt", *p) != NULL) {
+        lengthModifier = *p++;
+        if ((lengthModifier == 'h' || lengthModifier == 'l') && *p == lengthModifier) {
+            isDoubleModifier = true;
+            p++;
+        }
+    }
+
+    switch (*p) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+        case 'c':
+            argTypes[(*argCount)++] = LoggerBinary_GetIntegerType(lengthModifier, isDoubleModifier);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            argTypes[(*argCount)++] = lengthModifier == 'L' ? LOGGER_BINARY_ARG_TYPE_LONG_DOUBLE
+                                                            : LOGGER_BINARY_ARG_TYPE_DOUBLE;
+            break;
+        case 's':
+            argTypes[(*argCount)++] = LOGGER_BINARY_ARG_TYPE_STRING;
+            break;
+        case 'p':
+        case 'n':
+            argTypes[(*argCount)++] = LOGGER_BINARY_ARG_TYPE_POINTER;
+            break;
+        case '\0':
+            return p;
+        default:
+            break;
+    }
+
+    return p + 1;
+}
+
+T_ZiyanReturnCode LoggerBinary_GetStatistics(T_LoggerBinaryStatistics *statistics)
+{
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    statistics->recordCount = __atomic_load_n(&s_binaryStatistics.recordCount, __ATOMIC_RELAXED);
+    statistics->textRecordCount = __atomic_load_n(&s_binaryStatistics.textRecordCount, __ATOMIC_RELAXED);
+    statistics->recordBytes = __atomic_load_n(&s_binaryStatistics.recordBytes, __ATOMIC_RELAXED);
+    statistics->truncatedRecordCount = __atomic_load_n(&s_binaryStatistics.truncatedRecordCount, __ATOMIC_RELAXED);
+    statistics->droppedRecordCount = __atomic_load_n(&s_binaryStatistics.droppedRecordCount, __ATOMIC_RELAXED);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static uint8_t LoggerBinary_ParseSite(T_LoggerBinarySite *site)
+{
+    uint8_t argTypes[LOGGER_BINARY_CONVERSION_ARG_MAX_NUM];
+    const char *format = site->format;
+    const char *conversion;
+    uint8_t argCount = 0;
+    uint8_t count;
+    uint8_t i;
+
+    // Several threads may parse the same site at the same time, they all come to the same result.
+    while ((format = LoggerBinary_NextConversion(format, &conversion, argTypes, &count)) != NULL) {
+        for (i = 0; i < count && argCount < LOGGER_BINARY_ARG_MAX_NUM; i++) {
+            site->argTypes[argCount++] = argTypes[i];
+        }
+    }
+
+    __atomic_store_n(&site->argCount, argCount, __ATOMIC_RELEASE);
+
+    return argCount;
+}
+
+static uint16_t LoggerBinary_FillHeader(uint8_t *record, uint16_t formatId, uint8_t level)
+{
+    T_LoggerBinaryRecordHeader header = {0};
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    header.formatId = formatId;
+    header.level = level;
+    header.timestampUs = (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+    memcpy(record, &header, sizeof(header));
+
+    return sizeof(header);
+}
+
+static void LoggerBinary_Submit(uint8_t *record, uint16_t len, uint8_t level)
+{
+    memcpy(record + offsetof(T_LoggerBinaryRecordHeader, len), &len, sizeof(len));
+
+    if (LoggerAsync_Write(s_binarySinkIndex, (E_ZiyanLoggerConsoleLogLevel) level, record, len) !=
+        ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        __atomic_add_fetch(&s_binaryStatistics.droppedRecordCount, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    __atomic_add_fetch(&s_binaryStatistics.recordCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_binaryStatistics.recordBytes, len, __ATOMIC_RELAXED);
+}
+
+static T_ZiyanReturnCode LoggerBinary_WriteAll(int fd, const void *data, size_t len)
+{
+    const uint8_t *buffer = data;
+    ssize_t realLen;
+
+    while (len > 0) {
+        realLen = write(fd, buffer, len);
+        if (realLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        buffer += realLen;
+        len -= (size_t) realLen;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static uint8_t LoggerBinary_GetIntegerType(char lengthModifier, bool isDoubleModifier)
+{
+    switch (lengthModifier) {
+        case 'l':
+            if (isDoubleModifier) {
+                return LOGGER_BINARY_ARG_TYPE_INT64;
+            }
+            return sizeof(long) == sizeof(int64_t) ? LOGGER_BINARY_ARG_TYPE_INT64 : LOGGER_BINARY_ARG_TYPE_INT32;
+        case 'q':
+        case 'j':
+            return LOGGER_BINARY_ARG_TYPE_INT64;
+        case 'z':
+        case 't':
+            return sizeof(size_t) == sizeof(int64_t) ? LOGGER_BINARY_ARG_TYPE_INT64 : LOGGER_BINARY_ARG_TYPE_INT32;
+        default:
+            return LOGGER_BINARY_ARG_TYPE_INT32;
+    }
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
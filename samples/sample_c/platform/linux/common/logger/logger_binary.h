@@ -0,0 +1,165 @@
+/**
+ ********************************************************************
+ * @file    logger_binary.h
+ * @brief   This is the header file for "logger_binary.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOGGER_BINARY_H
+#define LOGGER_BINARY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "ziyan_typedef.h"
+#include "ziyan_logger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define LOGGER_BINARY_FILE_MAGIC                0x474C425A // "ZBLG"
+#define LOGGER_BINARY_FILE_VERSION              1
+#define LOGGER_BINARY_FORMAT_ID_TEXT            0xFFFF
+#define LOGGER_BINARY_RECORD_SIZE_MAX           512
+#define LOGGER_BINARY_ARG_MAX_NUM               16
+#define LOGGER_BINARY_ARG_COUNT_UNKNOWN         0xFF
+#define LOGGER_BINARY_STRING_ARG_LEN_MAX        255
+#define LOGGER_BINARY_SITE_SECTION              "ziyan_blog_site"
+
+/**
+ * @brief Log a record in binary form. The format string is registered at compile time in a dedicated section and
+ * the record only carries its ID, a timestamp and the raw arguments; formatting is left to the decoder tool.
+ * Arguments are read according to the conversions of the format string, like printf(), and checked by the compiler
+ * the same way.
+ */
+#define LOGGER_BINARY_LOG(level, fmt, ...) \
+    do { \
+        static T_LoggerBinarySite s_loggerBinarySite \
+            __attribute__((section(LOGGER_BINARY_SITE_SECTION), aligned(8), used)) = \
+            {__FILE__, fmt, __LINE__, level, LOGGER_BINARY_ARG_COUNT_UNKNOWN, {0}}; \
+        if (0) { \
+            printf(fmt, ##__VA_ARGS__); \
+        } \
+        LoggerBinary_Write(&s_loggerBinarySite, ##__VA_ARGS__); \
+    } while (0)
+
+#define USER_BLOG_DEBUG(fmt, ...)   LOGGER_BINARY_LOG(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define USER_BLOG_INFO(fmt, ...)    LOGGER_BINARY_LOG(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define USER_BLOG_WARN(fmt, ...)    LOGGER_BINARY_LOG(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define USER_BLOG_ERROR(fmt, ...)   LOGGER_BINARY_LOG(ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    LOGGER_BINARY_ARG_TYPE_INT32 = 0,
+    LOGGER_BINARY_ARG_TYPE_INT64 = 1,
+    LOGGER_BINARY_ARG_TYPE_DOUBLE = 2,
+    LOGGER_BINARY_ARG_TYPE_LONG_DOUBLE = 3, /*!< Stored as a double. */
+    LOGGER_BINARY_ARG_TYPE_STRING = 4, /*!< Stored as a one byte length followed by the characters. */
+    LOGGER_BINARY_ARG_TYPE_POINTER = 5, /*!< Stored as 64 bits. */
+} E_LoggerBinaryArgType;
+
+typedef struct {
+    const char *file;
+    const char *format;
+    uint16_t line;
+    uint8_t level;
+    uint8_t argCount; /*!< Filled from the format string on first use. */
+    uint8_t argTypes[LOGGER_BINARY_ARG_MAX_NUM];
+} __attribute__((aligned(8))) T_LoggerBinarySite; /*!< Declarations must repeat the alignment so that the compiler
+ * does not raise it for large objects, which would leave holes between the sites of the section. */
+
+/* File layout: T_LoggerBinaryFileHeader, siteCount site descriptors, then records. Little endian. */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t siteCount;
+    uint64_t monotonicBaseUs; /*!< Record timestamp of the moment the file was created. */
+    uint64_t realtimeBaseUs; /*!< Wall clock of the same moment. */
+} __attribute__((packed)) T_LoggerBinaryFileHeader;
+
+typedef struct {
+    uint16_t line;
+    uint8_t level;
+    uint8_t reserved;
+    uint16_t fileLen;
+    uint16_t formatLen;
+    /* Followed by the file name and the format string, not null terminated. */
+} __attribute__((packed)) T_LoggerBinarySiteHeader;
+
+typedef struct {
+    uint16_t len; /*!< Length of the whole record. */
+    uint16_t formatId; /*!< Index of the site descriptor, or LOGGER_BINARY_FORMAT_ID_TEXT for a preformatted line. */
+    uint8_t level;
+    uint8_t reserved[3];
+    uint64_t timestampUs;
+    /* Followed by the arguments, or the text of a preformatted line. */
+} __attribute__((packed)) T_LoggerBinaryRecordHeader;
+
+typedef struct {
+    uint64_t recordCount;
+    uint64_t textRecordCount;
+    uint64_t recordBytes;
+    uint64_t truncatedRecordCount;
+    uint64_t droppedRecordCount;
+} T_LoggerBinaryStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start binary logging. Records are queued through the asynchronous logger.
+ * @param sinkIndex: sink added with LoggerAsync_AddSink() as LOGGER_ASYNC_SINK_TYPE_BINARY, its file must start
+ * with LoggerBinary_WriteFileHeader().
+ * @param level: records less severe than this level are discarded.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode LoggerBinary_Init(uint8_t sinkIndex, E_ZiyanLoggerConsoleLogLevel level);
+
+/**
+ * @brief Write the file header with all compiled-in format strings, needed at the start of every file a binary
+ * sink writes to, e.g. each file of a rotated log.
+ */
+T_ZiyanReturnCode LoggerBinary_WriteFileHeader(int fd);
+void LoggerBinary_Write(T_LoggerBinarySite *site, ...);
+
+/**
+ * @brief Console function for ZiyanLogger_AddConsole(), keeping lines formatted by the Payload SDK in the binary log.
+ */
+T_ZiyanReturnCode LoggerBinary_ConsoleWrite(const uint8_t *data, uint16_t dataLen);
+
+/**
+ * @brief Find the next conversion of a printf format string.
+ * @param format: format string.
+ * @param conversion: start of the conversion, pointing to '%'.
+ * @param argTypes: types of the arguments consumed by the conversion, at most 3 (width, precision and value).
+ * @param argCount: number of arguments consumed by the conversion.
+ * @return Pointer after the conversion, NULL when there is no more conversion.
+ */
+const char *LoggerBinary_NextConversion(const char *format, const char **conversion, uint8_t *argTypes,
+                                        uint8_t *argCount);
+T_ZiyanReturnCode LoggerBinary_GetStatistics(T_LoggerBinaryStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_BINARY_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,479 @@
+/**
+ ********************************************************************
+ * @file    logger_flight.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "logger_flight.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <utils/util_misc.h>
+
+/* Private constants ---------------------------------------------------------*/
+#define LOGGER_FLIGHT_MAGIC                     0x52464C5A // "ZLFR"
+#define LOGGER_FLIGHT_VERSION                   1
+#define LOGGER_FLIGHT_HEADER_SIZE               4096
+#define LOGGER_FLIGHT_SLOT_MIN_NUM              16
+#define LOGGER_FLIGHT_SLOT_DATA_SIZE            (LOGGER_FLIGHT_SLOT_SIZE - 24)
+#define LOGGER_FLIGHT_STATE_RUNNING             1
+#define LOGGER_FLIGHT_STATE_CLEAN               2
+#define LOGGER_FLIGHT_FNV_OFFSET_BASIS          2166136261u
+#define LOGGER_FLIGHT_FNV_PRIME                 16777619u
+#define LOGGER_FLIGHT_RECOVER_PATH_MAX_SIZE     128
+#define LOGGER_FLIGHT_RECOVER_LINE_MAX_SIZE     160
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slotSize;
+    uint32_t slotCount;
+    uint32_t state;
+    uint32_t pid;
+    uint32_t reserved;
+    uint64_t startRealtimeUs;
+} T_LoggerFlightHeader;
+
+typedef struct {
+    uint64_t sequence; /*!< Starts from 1, 0 marks a slot never written. */
+    uint64_t timestampUs;
+    uint32_t checksum; /*!< Covers the other fields and the data, a mismatch means a torn write. */
+    uint16_t len;
+    uint16_t reserved;
+    uint8_t data[LOGGER_FLIGHT_SLOT_DATA_SIZE];
+} T_LoggerFlightSlot;
+
+/* Private functions declaration ---------------------------------------------*/
+static T_ZiyanReturnCode LoggerFlight_Recover(int fd, const char *recoverDirectory, char *recoverPath,
+                                              uint16_t recoverPathSize);
+static T_ZiyanReturnCode LoggerFlight_WriteRecovered(const T_LoggerFlightHeader *header,
+                                                     const T_LoggerFlightSlot *slots, const char *path);
+static bool LoggerFlight_IsSlotValid(const T_LoggerFlightSlot *slot);
+static uint32_t LoggerFlight_GetChecksum(const T_LoggerFlightSlot *slot);
+static int LoggerFlight_CompareSlot(const void *a, const void *b);
+static void *LoggerFlight_SyncTask(void *arg);
+static T_ZiyanReturnCode LoggerFlight_WriteAll(int fd, const void *data, size_t len);
+
+/* Private values ------------------------------------------------------------*/
+static bool s_isFlightInit = false;
+static int s_flightFd = -1;
+static uint8_t *s_flightRegion = NULL;
+static size_t s_flightRegionSize = 0;
+static T_LoggerFlightHeader *s_flightHeader = NULL;
+static T_LoggerFlightSlot *s_flightSlots = NULL;
+static uint32_t s_flightSlotMask = 0;
+static uint64_t s_nextSequence = 1;
+static uint32_t s_activeWriterCount = 0;
+static T_LoggerFlightStatistics s_flightStatistics;
+
+static pthread_t s_syncThread;
+static bool s_isSyncThreadRunning = false;
+static bool s_isSyncExit = false;
+static uint32_t s_syncPeriodMs = 0;
+
+// Slots of the crashed session being sorted, qsort() has no context argument.
+static const T_LoggerFlightSlot *s_recoverSlots = NULL;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode LoggerFlight_Init(const T_LoggerFlightConfig *config, char *recoverPath, uint16_t recoverPathSize)
+{
+    T_ZiyanReturnCode returnCode;
+    struct timespec realTime;
+    uint32_t slotCount;
+
+    if (config == NULL || config->path == NULL || config->recoverDirectory == NULL ||
+        config->size < LOGGER_FLIGHT_HEADER_SIZE + LOGGER_FLIGHT_SLOT_MIN_NUM * LOGGER_FLIGHT_SLOT_SIZE) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isFlightInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    if (recoverPath != NULL && recoverPathSize > 0) {
+        recoverPath[0] = '\0';
+    }
+
+    slotCount = (config->size - LOGGER_FLIGHT_HEADER_SIZE) / LOGGER_FLIGHT_SLOT_SIZE;
+    while ((slotCount & (slotCount - 1)) != 0) {
+        slotCount &= slotCount - 1;
+    }
+
+    s_flightFd = open(config->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (s_flightFd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    memset(&s_flightStatistics, 0, sizeof(s_flightStatistics));
+    returnCode = LoggerFlight_Recover(s_flightFd, config->recoverDirectory, recoverPath, recoverPathSize);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    // Truncating first gives a zeroed region without writing it, slots of the previous session are gone.
+    s_flightRegionSize = LOGGER_FLIGHT_HEADER_SIZE + (size_t) slotCount * LOGGER_FLIGHT_SLOT_SIZE;
+    if (ftruncate(s_flightFd, 0) != 0 || ftruncate(s_flightFd, (off_t) s_flightRegionSize) != 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+
+    s_flightRegion = mmap(NULL, s_flightRegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, s_flightFd, 0);
+    if (s_flightRegion == MAP_FAILED) {
+        s_flightRegion = NULL;
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &realTime);
+    s_flightHeader = (T_LoggerFlightHeader *) s_flightRegion;
+    s_flightSlots = (T_LoggerFlightSlot *) (s_flightRegion + LOGGER_FLIGHT_HEADER_SIZE);
+    s_flightSlotMask = slotCount - 1;
+    s_flightHeader->version = LOGGER_FLIGHT_VERSION;
+    s_flightHeader->slotSize = LOGGER_FLIGHT_SLOT_SIZE;
+    s_flightHeader->slotCount = slotCount;
+    s_flightHeader->state = LOGGER_FLIGHT_STATE_RUNNING;
+    s_flightHeader->pid = (uint32_t) getpid();
+    s_flightHeader->startRealtimeUs = (uint64_t) realTime.tv_sec * 1000000 + (uint64_t) realTime.tv_nsec / 1000;
+    __atomic_store_n(&s_flightHeader->magic, LOGGER_FLIGHT_MAGIC, __ATOMIC_RELEASE);
+    s_flightStatistics.slotCount = slotCount;
+    s_nextSequence = 1;
+
+    s_syncPeriodMs = config->syncPeriodMs;
+    s_isSyncExit = false;
+    if (s_syncPeriodMs != 0) {
+        if (pthread_create(&s_syncThread, NULL, LoggerFlight_SyncTask, NULL) != 0) {
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            goto out;
+        }
+        pthread_setname_np(s_syncThread, "logger_flight");
+        s_isSyncThreadRunning = true;
+    }
+
+    __atomic_store_n(&s_isFlightInit, true, __ATOMIC_RELEASE);
+
+out:
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        if (s_flightRegion != NULL) {
+            munmap(s_flightRegion, s_flightRegionSize);
+            s_flightRegion = NULL;
+        }
+        close(s_flightFd);
+        s_flightFd = -1;
+    }
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode LoggerFlight_DeInit(void)
+{
+    if (!s_isFlightInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    // Writers already past the check finish their slots before the region goes away.
+    __atomic_store_n(&s_isFlightInit, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&s_activeWriterCount, __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+
+    if (s_isSyncThreadRunning) {
+        __atomic_store_n(&s_isSyncExit, true, __ATOMIC_RELEASE);
+        pthread_join(s_syncThread, NULL);
+        s_isSyncThreadRunning = false;
+    }
+
+    s_flightHeader->state = LOGGER_FLIGHT_STATE_CLEAN;
+    msync(s_flightRegion, s_flightRegionSize, MS_SYNC);
+    munmap(s_flightRegion, s_flightRegionSize);
+    close(s_flightFd);
+    s_flightRegion = NULL;
+    s_flightHeader = NULL;
+    s_flightSlots = NULL;
+    s_flightFd = -1;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode LoggerFlight_Write(const uint8_t *data, uint16_t dataLen)
+{
+    T_LoggerFlightSlot *slot;
+    struct timespec realTime;
+    uint64_t sequence;
+    uint64_t timestampUs;
+    uint32_t slotCount;
+    uint16_t partLen;
+    uint32_t i;
+
+    if (data == NULL || dataLen == 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    __atomic_add_fetch(&s_activeWriterCount, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&s_isFlightInit, __ATOMIC_SEQ_CST)) {
+        __atomic_sub_fetch(&s_activeWriterCount, 1, __ATOMIC_RELEASE);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &realTime);
+    timestampUs = (uint64_t) realTime.tv_sec * 1000000 + (uint64_t) realTime.tv_nsec / 1000;
+
+    // Reserving the sequence numbers is the only synchronization, each writer then owns its slots. A writer lapped by
+    // the ring leaves a slot whose checksum no longer matches, which the recovery drops.
+    slotCount = (dataLen + LOGGER_FLIGHT_SLOT_DATA_SIZE - 1) / LOGGER_FLIGHT_SLOT_DATA_SIZE;
+    sequence = __atomic_fetch_add(&s_nextSequence, slotCount, __ATOMIC_RELAXED);
+    for (i = 0; i < slotCount; i++) {
+        slot = &s_flightSlots[(sequence + i) & s_flightSlotMask];
+        partLen = (uint16_t) USER_UTIL_MIN(dataLen - i * LOGGER_FLIGHT_SLOT_DATA_SIZE, LOGGER_FLIGHT_SLOT_DATA_SIZE);
+
+        memcpy(slot->data, data + i * LOGGER_FLIGHT_SLOT_DATA_SIZE, partLen);
+        slot->sequence = sequence + i;
+        slot->timestampUs = timestampUs;
+        slot->len = partLen;
+        slot->checksum = LoggerFlight_GetChecksum(slot);
+    }
+
+    __atomic_sub_fetch(&s_activeWriterCount, 1, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode LoggerFlight_GetStatistics(T_LoggerFlightStatistics *statistics)
+{
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    *statistics = s_flightStatistics;
+    statistics->writtenSlotCount = __atomic_load_n(&s_nextSequence, __ATOMIC_RELAXED) - 1;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_ZiyanReturnCode LoggerFlight_Recover(int fd, const char *recoverDirectory, char *recoverPath,
+                                              uint16_t recoverPathSize)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    const T_LoggerFlightHeader *header;
+    char path[LOGGER_FLIGHT_RECOVER_PATH_MAX_SIZE];
+    struct stat fileStat;
+    struct tm startTime;
+    time_t startTimeSec;
+    uint8_t *region;
+
+    if (fstat(fd, &fileStat) != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    if ((size_t) fileStat.st_size < LOGGER_FLIGHT_HEADER_SIZE) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    region = mmap(NULL, (size_t) fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (region == MAP_FAILED) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // The recorder of a session that ended cleanly, or of another layout, holds nothing worth recovering.
+    header = (const T_LoggerFlightHeader *) region;
+    if (header->magic != LOGGER_FLIGHT_MAGIC || header->version != LOGGER_FLIGHT_VERSION ||
+        header->slotSize != LOGGER_FLIGHT_SLOT_SIZE || header->state != LOGGER_FLIGHT_STATE_RUNNING ||
+        header->slotCount == 0 ||
+        (uint64_t) fileStat.st_size != LOGGER_FLIGHT_HEADER_SIZE + (uint64_t) header->slotCount * LOGGER_FLIGHT_SLOT_SIZE) {
+        goto out;
+    }
+
+    startTimeSec = (time_t) (header->startRealtimeUs / 1000000);
+    if (localtime_r(&startTimeSec, &startTime) == NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+    snprintf(path, sizeof(path), "%s/flight_%04d%02d%02d_%02d-%02d-%02d.log", recoverDirectory,
+             startTime.tm_year + 1900, startTime.tm_mon + 1, startTime.tm_mday,
+             startTime.tm_hour, startTime.tm_min, startTime.tm_sec);
+
+    returnCode = LoggerFlight_WriteRecovered(header, (const T_LoggerFlightSlot *) (region + LOGGER_FLIGHT_HEADER_SIZE),
+                                             path);
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS && recoverPath != NULL && recoverPathSize > 0) {
+        strncpy(recoverPath, path, recoverPathSize - 1);
+        recoverPath[recoverPathSize - 1] = '\0';
+    }
+
+out:
+    munmap(region, (size_t) fileStat.st_size);
+
+    return returnCode;
+}
+
+static T_ZiyanReturnCode LoggerFlight_WriteRecovered(const T_LoggerFlightHeader *header,
+                                                     const T_LoggerFlightSlot *slots, const char *path)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    char line[LOGGER_FLIGHT_RECOVER_LINE_MAX_SIZE];
+    uint32_t *slotIndexes;
+    uint32_t validCount = 0;
+    uint32_t tornCount = 0;
+    uint32_t i;
+    int lineLen;
+    int fd;
+
+    slotIndexes = malloc(header->slotCount * sizeof(uint32_t));
+    if (slotIndexes == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    for (i = 0; i < header->slotCount; i++) {
+        if (slots[i].sequence == 0) {
+            continue;
+        }
+        if (!LoggerFlight_IsSlotValid(&slots[i])) {
+            tornCount++;
+            continue;
+        }
+        slotIndexes[validCount++] = i;
+    }
+
+    s_recoverSlots = slots;
+    qsort(slotIndexes, validCount, sizeof(uint32_t), LoggerFlight_CompareSlot);
+    s_recoverSlots = NULL;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+
+    lineLen = snprintf(line, sizeof(line),
+                       "[FlightRecorder] Session of pid %u ended abnormally, %u slots recovered, %u torn slots "
+                       "discarded.\r\n", header->pid, validCount, tornCount);
+    returnCode = LoggerFlight_WriteAll(fd, line, (size_t) lineLen);
+
+    // Lines longer than a slot span consecutive sequence numbers, so writing the slots in order joins them again.
+    for (i = 0; i < validCount && returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS; i++) {
+        returnCode = LoggerFlight_WriteAll(fd, slots[slotIndexes[i]].data, slots[slotIndexes[i]].len);
+    }
+
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS && fsync(fd) != 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    close(fd);
+
+    s_flightStatistics.recoveredSlotCount = validCount;
+    s_flightStatistics.tornSlotCount = tornCount;
+
+out:
+    free(slotIndexes);
+
+    return returnCode;
+}
+
+static bool LoggerFlight_IsSlotValid(const T_LoggerFlightSlot *slot)
+{
+    return slot->len <= LOGGER_FLIGHT_SLOT_DATA_SIZE && slot->checksum == LoggerFlight_GetChecksum(slot);
+}
+
+static uint32_t LoggerFlight_GetChecksum(const T_LoggerFlightSlot *slot)
+{
+    uint32_t hash = LOGGER_FLIGHT_FNV_OFFSET_BASIS;
+    const uint8_t *bytes;
+    uint16_t len = USER_UTIL_MIN(slot->len, LOGGER_FLIGHT_SLOT_DATA_SIZE);
+    uint16_t i;
+
+    bytes = (const uint8_t *) slot;
+    for (i = 0; i < offsetof(T_LoggerFlightSlot, checksum); i++) {
+        hash = (hash ^ bytes[i]) * LOGGER_FLIGHT_FNV_PRIME;
+    }
+    hash = (hash ^ (uint8_t) len) * LOGGER_FLIGHT_FNV_PRIME;
+    hash = (hash ^ (uint8_t) (len >> 8)) * LOGGER_FLIGHT_FNV_PRIME;
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ slot->data[i]) * LOGGER_FLIGHT_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static int LoggerFlight_CompareSlot(const void *a, const void *b)
+{
+    uint64_t sequenceA = s_recoverSlots[*(const uint32_t *) a].sequence;
+    uint64_t sequenceB = s_recoverSlots[*(const uint32_t *) b].sequence;
+
+    if (sequenceA == sequenceB) {
+        return 0;
+    }
+
+    return sequenceA < sequenceB ? -1 : 1;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+
+static void *LoggerFlight_SyncTask(void *arg)
+{
+    struct timespec period = {
+        .tv_sec = s_syncPeriodMs / 1000,
+        .tv_nsec = (long) (s_syncPeriodMs % 1000) * 1000000,
+    };
+
+    USER_UTIL_UNUSED(arg);
+
+    // The page cache survives a crash of the process but not a power loss, push the dirty slots to the file.
+    while (!__atomic_load_n(&s_isSyncExit, __ATOMIC_ACQUIRE)) {
+        nanosleep(&period, NULL);
+        msync(s_flightRegion, s_flightRegionSize, MS_SYNC);
+    }
+
+    return NULL;
+}
+
+#pragma GCC diagnostic pop
+
+static T_ZiyanReturnCode LoggerFlight_WriteAll(int fd, const void *data, size_t len)
+{
+    const uint8_t *cursor = data;
+    ssize_t realLen;
+
+    while (len > 0) {
+        realLen = write(fd, cursor, len);
+        if (realLen < 0 && errno == EINTR) {
+            continue;
+        }
+        if (realLen <= 0) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        cursor += realLen;
+        len -= (size_t) realLen;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,83 @@
+/**
+ ********************************************************************
+ * @file    logger_flight.h
+ * @brief   This is the header file for "logger_flight.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOGGER_FLIGHT_H
+#define LOGGER_FLIGHT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define LOGGER_FLIGHT_SLOT_SIZE                 256
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    const char *path; /*!< File backing the recorder, on tmpfs to survive crashes or on the card to survive power loss. */
+    uint32_t size; /*!< Bytes of the recorder, rounded down to a power of 2 number of slots. */
+    const char *recoverDirectory; /*!< Directory the tail of a crashed session is written to. */
+    uint32_t syncPeriodMs; /*!< Period the recorder is synced to its file at, 0 to leave it to the kernel. */
+} T_LoggerFlightConfig;
+
+typedef struct {
+    uint64_t writtenSlotCount;
+    uint32_t slotCount;
+    uint32_t recoveredSlotCount; /*!< Slots recovered from the previous session. */
+    uint32_t tornSlotCount; /*!< Slots of the previous session discarded on a checksum mismatch. */
+} T_LoggerFlightStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Map the flight recorder. When the previous session did not end with LoggerFlight_DeInit(), its last
+ * records are recovered to a log file named after the start time of that session first.
+ * @param config: recorder configuration.
+ * @param recoverPath: path of the recovered log, empty string when nothing was recovered, may be NULL.
+ * @param recoverPathSize: size of recoverPath.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode LoggerFlight_Init(const T_LoggerFlightConfig *config, char *recoverPath, uint16_t recoverPathSize);
+
+/**
+ * @brief Mark the session as ended cleanly and unmap the recorder.
+ */
+T_ZiyanReturnCode LoggerFlight_DeInit(void);
+
+/**
+ * @brief Append a line to the recorder. Lock-free and never blocks, callable from any thread. Long lines take
+ * consecutive slots.
+ */
+T_ZiyanReturnCode LoggerFlight_Write(const uint8_t *data, uint16_t dataLen);
+T_ZiyanReturnCode LoggerFlight_GetStatistics(T_LoggerFlightStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_FLIGHT_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
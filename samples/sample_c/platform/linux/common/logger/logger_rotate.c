@@ -0,0 +1,755 @@
+/**
+ ********************************************************************
+ * @file    logger_rotate.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "logger_rotate.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <utils/util_misc.h>
+#include "ziyan_logger.h"
+
+#ifdef ZLIB_INSTALLED
+#include <zlib.h>
+#endif
+
+/* Private constants ---------------------------------------------------------*/
+#define LOGGER_ROTATE_DIRECTORY_MAX_SIZE        64
+#define LOGGER_ROTATE_BASE_NAME_MAX_SIZE        32
+#define LOGGER_ROTATE_EXTENSION_MAX_SIZE        8
+#define LOGGER_ROTATE_FILE_NAME_MAX_SIZE        96
+#define LOGGER_ROTATE_PATH_MAX_SIZE             (LOGGER_ROTATE_DIRECTORY_MAX_SIZE + LOGGER_ROTATE_FILE_NAME_MAX_SIZE + 8)
+#define LOGGER_ROTATE_SUFFIX_MAX_SIZE           8
+#define LOGGER_ROTATE_TEMP_EXTENSION            ".tmp"
+#define LOGGER_ROTATE_COPY_BUFFER_SIZE          (64 * 1024)
+#define LOGGER_ROTATE_TASK_NICE                 19
+// Idle I/O class of ioprio_set(), not exported by the C library.
+#define LOGGER_ROTATE_IOPRIO_WHO_PROCESS        1
+#define LOGGER_ROTATE_IOPRIO_CLASS_IDLE         3
+#define LOGGER_ROTATE_IOPRIO_CLASS_SHIFT        13
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t index;
+    uint64_t size; /*!< Size on disk, only known once the file is closed. */
+    bool isClosed;
+    bool isSettled; /*!< Compressed or synced to disk by the background thread. */
+    bool isCompressed;
+    char name[LOGGER_ROTATE_FILE_NAME_MAX_SIZE];
+} T_LoggerRotateFile;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *LoggerRotate_Task(void *arg);
+static T_ZiyanReturnCode LoggerRotate_ScanDirectory(void);
+static T_ZiyanReturnCode LoggerRotate_AddFile(uint32_t index, const char *name, uint64_t size, bool isClosed,
+                                              bool isCompressed);
+static T_ZiyanReturnCode LoggerRotate_OpenFile(int *fd);
+static T_ZiyanReturnCode LoggerRotate_SaveIndex(uint32_t nextIndex);
+static uint32_t LoggerRotate_LoadIndex(void);
+static T_ZiyanReturnCode LoggerRotate_SettleFile(const char *name, bool isCompress, uint64_t *size);
+static void LoggerRotate_RemoveOldFiles(void);
+static T_LoggerRotateFile *LoggerRotate_FindFile(uint32_t index);
+static bool LoggerRotate_HasSuffix(const char *name, const char *suffix);
+static int LoggerRotate_CompareFile(const void *a, const void *b);
+#ifdef ZLIB_INSTALLED
+static T_ZiyanReturnCode LoggerRotate_CompressFile(const char *path, uint64_t *outputSize);
+#endif
+
+/* Private values ------------------------------------------------------------*/
+static bool s_isRotateInit = false;
+static char s_rotateDirectory[LOGGER_ROTATE_DIRECTORY_MAX_SIZE];
+static char s_rotateBaseName[LOGGER_ROTATE_BASE_NAME_MAX_SIZE];
+static char s_rotateExtension[LOGGER_ROTATE_EXTENSION_MAX_SIZE];
+static T_LoggerRotateConfig s_rotateConfig;
+
+static pthread_mutex_t s_rotateMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_rotateCond = PTHREAD_COND_INITIALIZER;
+static pthread_t s_rotateThread;
+static bool s_isRotateExit = false;
+static bool s_isRotatePending = false;
+
+// Files sorted by index, the last one is the file being written.
+static T_LoggerRotateFile *s_fileList = NULL;
+static uint32_t s_fileCount = 0;
+static uint32_t s_fileCapacity = 0;
+static uint32_t s_nextIndex = 0;
+static int s_currentFd = -1;
+static T_LoggerRotateStatistics s_rotateStatistics;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode LoggerRotate_Init(const T_LoggerRotateConfig *config, int *fd)
+{
+    T_ZiyanReturnCode returnCode;
+
+    if (config == NULL || fd == NULL || config->directory == NULL || config->baseName == NULL ||
+        config->extension == NULL || config->fileSizeMax == 0 ||
+        strlen(config->directory) >= sizeof(s_rotateDirectory) ||
+        strlen(config->baseName) >= sizeof(s_rotateBaseName) ||
+        strlen(config->extension) >= sizeof(s_rotateExtension)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isRotateInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    strcpy(s_rotateDirectory, config->directory);
+    strcpy(s_rotateBaseName, config->baseName);
+    strcpy(s_rotateExtension, config->extension);
+    s_rotateConfig = *config;
+#ifndef ZLIB_INSTALLED
+    if (s_rotateConfig.isCompressEnabled) {
+        USER_LOG_WARN("Log compression needs zlib, closed log files are kept uncompressed.");
+        s_rotateConfig.isCompressEnabled = false;
+    }
+#endif
+    s_rotateConfig.directory = s_rotateDirectory;
+    s_rotateConfig.baseName = s_rotateBaseName;
+    s_rotateConfig.extension = s_rotateExtension;
+    memset(&s_rotateStatistics, 0, sizeof(s_rotateStatistics));
+
+    if (mkdir(s_rotateDirectory, 0755) != 0 && errno != EEXIST) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    returnCode = LoggerRotate_ScanDirectory();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    returnCode = LoggerRotate_OpenFile(fd);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    s_isRotateExit = false;
+    s_isRotatePending = true;
+    if (pthread_create(&s_rotateThread, NULL, LoggerRotate_Task, NULL) != 0) {
+        close(*fd);
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+    pthread_setname_np(s_rotateThread, "logger_rotate");
+
+    s_isRotateInit = true;
+
+out:
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        free(s_fileList);
+        s_fileList = NULL;
+        s_fileCount = 0;
+        s_fileCapacity = 0;
+        s_currentFd = -1;
+    }
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode LoggerRotate_DeInit(void)
+{
+    if (!s_isRotateInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    pthread_mutex_lock(&s_rotateMutex);
+    s_isRotateExit = true;
+    pthread_cond_signal(&s_rotateCond);
+    pthread_mutex_unlock(&s_rotateMutex);
+    pthread_join(s_rotateThread, NULL);
+
+    free(s_fileList);
+    s_fileList = NULL;
+    s_fileCount = 0;
+    s_fileCapacity = 0;
+    s_currentFd = -1;
+    s_isRotateInit = false;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+int LoggerRotate_NextFile(int fd)
+{
+    T_LoggerRotateFile *file;
+    struct stat fileStat;
+    int nextFd;
+
+    if (!s_isRotateInit) {
+        return -1;
+    }
+
+    // Open the next file first, so that logging goes on in the current one when it fails.
+    pthread_mutex_lock(&s_rotateMutex);
+    if (LoggerRotate_OpenFile(&nextFd) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        pthread_mutex_unlock(&s_rotateMutex);
+        return -1;
+    }
+
+    file = &s_fileList[s_fileCount - 2];
+    file->isClosed = true;
+    file->size = fstat(fd, &fileStat) == 0 ? (uint64_t) fileStat.st_size : s_rotateConfig.fileSizeMax;
+    s_rotateStatistics.rotateCount++;
+    s_isRotatePending = true;
+    pthread_cond_signal(&s_rotateCond);
+    pthread_mutex_unlock(&s_rotateMutex);
+
+    close(fd);
+
+    return nextFd;
+}
+
+T_ZiyanReturnCode LoggerRotate_GetStatistics(T_LoggerRotateStatistics *statistics)
+{
+    struct stat fileStat;
+    uint32_t i;
+
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (!s_isRotateInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    pthread_mutex_lock(&s_rotateMutex);
+    *statistics = s_rotateStatistics;
+    statistics->fileCount = s_fileCount;
+    statistics->diskUsageBytes = 0;
+    for (i = 0; i < s_fileCount; i++) {
+        statistics->diskUsageBytes += s_fileList[i].size;
+    }
+    if (s_currentFd >= 0 && fstat(s_currentFd, &fileStat) == 0) {
+        statistics->diskUsageBytes += (uint64_t) fileStat.st_size;
+    }
+    pthread_mutex_unlock(&s_rotateMutex);
+
+    statistics->compressionRatio = statistics->compressOutputBytes != 0 ?
+                                   (float) statistics->compressInputBytes / (float) statistics->compressOutputBytes :
+                                   0.0f;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+
+static void *LoggerRotate_Task(void *arg)
+{
+    T_LoggerRotateFile *file;
+    T_ZiyanReturnCode returnCode;
+    T_LoggerRotateStatistics statistics;
+    char name[LOGGER_ROTATE_FILE_NAME_MAX_SIZE];
+    uint64_t inputSize;
+    uint64_t outputSize = 0;
+    uint32_t index;
+    uint32_t i;
+    bool isCompress;
+
+    USER_UTIL_UNUSED(arg);
+
+    // Compression must never compete with the threads talking to the aircraft, neither for CPU nor for the card.
+    setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), LOGGER_ROTATE_TASK_NICE);
+    syscall(SYS_ioprio_set, LOGGER_ROTATE_IOPRIO_WHO_PROCESS, 0,
+            LOGGER_ROTATE_IOPRIO_CLASS_IDLE << LOGGER_ROTATE_IOPRIO_CLASS_SHIFT);
+
+    pthread_mutex_lock(&s_rotateMutex);
+    while (true) {
+        while (!s_isRotateExit && !s_isRotatePending) {
+            pthread_cond_wait(&s_rotateCond, &s_rotateMutex);
+        }
+        if (s_isRotateExit) {
+            break;
+        }
+        s_isRotatePending = false;
+
+        for (i = 0; i < s_fileCount && !s_isRotateExit; i++) {
+            file = &s_fileList[i];
+            if (!file->isClosed || file->isSettled) {
+                continue;
+            }
+
+            index = file->index;
+            inputSize = file->size;
+            isCompress = s_rotateConfig.isCompressEnabled && !file->isCompressed;
+            strcpy(name, file->name);
+
+            // The list may grow and move while the file is processed, find the entry again afterwards.
+            pthread_mutex_unlock(&s_rotateMutex);
+            returnCode = LoggerRotate_SettleFile(name, isCompress, &outputSize);
+            pthread_mutex_lock(&s_rotateMutex);
+
+            file = LoggerRotate_FindFile(index);
+            if (file == NULL) {
+                continue;
+            }
+            file->isSettled = true;
+            if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+                if (isCompress) {
+                    s_rotateStatistics.compressErrorCount++;
+                }
+                continue;
+            }
+            if (isCompress) {
+                strncat(file->name, LOGGER_ROTATE_COMPRESS_EXTENSION, sizeof(file->name) - strlen(file->name) - 1);
+                file->size = outputSize;
+                file->isCompressed = true;
+                s_rotateStatistics.compressedFileCount++;
+                s_rotateStatistics.compressInputBytes += inputSize;
+                s_rotateStatistics.compressOutputBytes += outputSize;
+            }
+        }
+
+        LoggerRotate_RemoveOldFiles();
+        pthread_mutex_unlock(&s_rotateMutex);
+
+        if (LoggerRotate_GetStatistics(&statistics) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_INFO("Log files: %u, disk usage: %llu bytes, compression ratio: %.2f.", statistics.fileCount,
+                          (unsigned long long) statistics.diskUsageBytes, statistics.compressionRatio);
+        }
+
+        pthread_mutex_lock(&s_rotateMutex);
+    }
+    pthread_mutex_unlock(&s_rotateMutex);
+
+    return NULL;
+}
+
+#pragma GCC diagnostic pop
+
+static T_ZiyanReturnCode LoggerRotate_ScanDirectory(void)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    struct dirent *entry;
+    struct stat fileStat;
+    size_t baseNameLen = strlen(s_rotateBaseName);
+    unsigned long index;
+    uint32_t maxIndex = 0;
+    uint32_t loadedIndex;
+    uint32_t i;
+    char *end;
+    DIR *dir;
+
+    dir = opendir(s_rotateDirectory);
+    if (dir == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, s_rotateBaseName, baseNameLen) != 0 || entry->d_name[baseNameLen] != '_' ||
+            strlen(entry->d_name) >= LOGGER_ROTATE_FILE_NAME_MAX_SIZE) {
+            continue;
+        }
+
+        // Leftover of a compression interrupted by a crash, the original file is still there.
+        if (LoggerRotate_HasSuffix(entry->d_name, LOGGER_ROTATE_TEMP_EXTENSION)) {
+            unlinkat(dirfd(dir), entry->d_name, 0);
+            continue;
+        }
+
+        errno = 0;
+        index = strtoul(entry->d_name + baseNameLen + 1, &end, 10);
+        if (errno != 0 || end == entry->d_name + baseNameLen + 1 || *end != '_' || index > UINT32_MAX) {
+            continue;
+        }
+        if (fstatat(dirfd(dir), entry->d_name, &fileStat, 0) != 0 || !S_ISREG(fileStat.st_mode)) {
+            continue;
+        }
+
+        returnCode = LoggerRotate_AddFile((uint32_t) index, entry->d_name, (uint64_t) fileStat.st_size, true,
+                                          LoggerRotate_HasSuffix(entry->d_name, LOGGER_ROTATE_COMPRESS_EXTENSION));
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            break;
+        }
+        maxIndex = USER_UTIL_MAX(maxIndex, (uint32_t) index + 1);
+    }
+
+    qsort(s_fileList, s_fileCount, sizeof(T_LoggerRotateFile), LoggerRotate_CompareFile);
+
+    // A crash between the rename of the compressed file and the removal of the original leaves both.
+    for (i = 1; i < s_fileCount; i++) {
+        if (s_fileList[i].index == s_fileList[i - 1].index && s_fileList[i].isCompressed &&
+            !s_fileList[i - 1].isCompressed) {
+            unlinkat(dirfd(dir), s_fileList[i - 1].name, 0);
+            memmove(&s_fileList[i - 1], &s_fileList[i], (s_fileCount - i) * sizeof(T_LoggerRotateFile));
+            s_fileCount--;
+            i--;
+        }
+    }
+    closedir(dir);
+
+    // The index file survives the removal of all logs, the directory only survives a lost index file.
+    loadedIndex = LoggerRotate_LoadIndex();
+    s_nextIndex = USER_UTIL_MAX(maxIndex, loadedIndex);
+
+    return returnCode;
+}
+
+static T_ZiyanReturnCode LoggerRotate_AddFile(uint32_t index, const char *name, uint64_t size, bool isClosed,
+                                              bool isCompressed)
+{
+    T_LoggerRotateFile *fileList;
+    T_LoggerRotateFile *file;
+    uint32_t capacity;
+
+    if (s_fileCount == s_fileCapacity) {
+        capacity = s_fileCapacity != 0 ? s_fileCapacity * 2 : 16;
+        fileList = realloc(s_fileList, capacity * sizeof(T_LoggerRotateFile));
+        if (fileList == NULL) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+        s_fileList = fileList;
+        s_fileCapacity = capacity;
+    }
+
+    file = &s_fileList[s_fileCount++];
+    memset(file, 0, sizeof(T_LoggerRotateFile));
+    file->index = index;
+    file->size = size;
+    file->isClosed = isClosed;
+    file->isCompressed = isCompressed;
+    file->isSettled = isCompressed;
+    strncpy(file->name, name, sizeof(file->name) - 1);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode LoggerRotate_OpenFile(int *fd)
+{
+    T_ZiyanReturnCode returnCode;
+    char name[LOGGER_ROTATE_FILE_NAME_MAX_SIZE];
+    char path[LOGGER_ROTATE_PATH_MAX_SIZE];
+    time_t currentTime = time(NULL);
+    struct tm localTime;
+
+    if (localtime_r(&currentTime, &localTime) == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // Save the index first, so that a crash right after never hands the same index out twice.
+    returnCode = LoggerRotate_SaveIndex(s_nextIndex + 1);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    snprintf(name, sizeof(name), "%s_%04u_%04d%02d%02d_%02d-%02d-%02d.%s", s_rotateBaseName, s_nextIndex,
+             localTime.tm_year + 1900, localTime.tm_mon + 1, localTime.tm_mday,
+             localTime.tm_hour, localTime.tm_min, localTime.tm_sec, s_rotateExtension);
+    snprintf(path, sizeof(path), "%s/%s", s_rotateDirectory, name);
+
+    *fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (*fd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (s_rotateConfig.FileOpen != NULL) {
+        returnCode = s_rotateConfig.FileOpen(*fd);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            goto out;
+        }
+    }
+
+    returnCode = LoggerRotate_AddFile(s_nextIndex, name, 0, false, false);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    s_nextIndex++;
+    s_currentFd = *fd;
+
+out:
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        close(*fd);
+        unlink(path);
+        *fd = -1;
+    }
+
+    return returnCode;
+}
+
+static T_ZiyanReturnCode LoggerRotate_SaveIndex(uint32_t nextIndex)
+{
+    char path[LOGGER_ROTATE_PATH_MAX_SIZE];
+    char tempPath[LOGGER_ROTATE_PATH_MAX_SIZE + 2 * LOGGER_ROTATE_SUFFIX_MAX_SIZE];
+    ssize_t realLen;
+    bool isWriteFailed;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", s_rotateDirectory, LOGGER_ROTATE_INDEX_FILE_NAME);
+    snprintf(tempPath, sizeof(tempPath), "%s%s", path, LOGGER_ROTATE_TEMP_EXTENSION);
+
+    fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    realLen = write(fd, &nextIndex, sizeof(nextIndex));
+    isWriteFailed = realLen != sizeof(nextIndex) || fsync(fd) != 0;
+    close(fd);
+
+    // The rename replaces the index atomically, a crash leaves either the old or the new value.
+    if (isWriteFailed || rename(tempPath, path) != 0) {
+        unlink(tempPath);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static uint32_t LoggerRotate_LoadIndex(void)
+{
+    char path[LOGGER_ROTATE_PATH_MAX_SIZE];
+    uint16_t legacyIndex;
+    uint32_t nextIndex = 0;
+    ssize_t realLen;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", s_rotateDirectory, LOGGER_ROTATE_INDEX_FILE_NAME);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    realLen = read(fd, &nextIndex, sizeof(nextIndex));
+    close(fd);
+
+    // Index files of earlier versions hold a 16 bits index.
+    if (realLen == sizeof(legacyIndex)) {
+        memcpy(&legacyIndex, &nextIndex, sizeof(legacyIndex));
+        return legacyIndex;
+    }
+
+    return realLen == sizeof(nextIndex) ? nextIndex : 0;
+}
+
+static T_ZiyanReturnCode LoggerRotate_SettleFile(const char *name, bool isCompress, uint64_t *size)
+{
+    char path[LOGGER_ROTATE_PATH_MAX_SIZE];
+    bool isSyncFailed;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", s_rotateDirectory, name);
+
+#ifdef ZLIB_INSTALLED
+    if (isCompress) {
+        return LoggerRotate_CompressFile(path, size);
+    }
+#else
+    USER_UTIL_UNUSED(isCompress);
+    USER_UTIL_UNUSED(size);
+#endif
+
+    // Without compression the file is only made durable, the logger thread never waits on the card.
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    isSyncFailed = fsync(fd) != 0;
+    close(fd);
+
+    return isSyncFailed ? ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR : ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+#ifdef ZLIB_INSTALLED
+static T_ZiyanReturnCode LoggerRotate_CompressFile(const char *path, uint64_t *outputSize)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    char compressPath[LOGGER_ROTATE_PATH_MAX_SIZE + LOGGER_ROTATE_SUFFIX_MAX_SIZE];
+    char tempPath[LOGGER_ROTATE_PATH_MAX_SIZE + 2 * LOGGER_ROTATE_SUFFIX_MAX_SIZE];
+    uint8_t *inputBuffer = NULL;
+    uint8_t *outputBuffer = NULL;
+    z_stream stream = {0};
+    ssize_t readLen;
+    ssize_t writeLen;
+    size_t outputLen;
+    size_t writtenLen;
+    off_t readOffset = 0;
+    int srcFd;
+    int dstFd = -1;
+    int flush = Z_NO_FLUSH;
+
+    snprintf(compressPath, sizeof(compressPath), "%s%s", path, LOGGER_ROTATE_COMPRESS_EXTENSION);
+    snprintf(tempPath, sizeof(tempPath), "%s%s", compressPath, LOGGER_ROTATE_TEMP_EXTENSION);
+
+    srcFd = open(path, O_RDONLY | O_CLOEXEC);
+    if (srcFd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    inputBuffer = malloc(LOGGER_ROTATE_COPY_BUFFER_SIZE);
+    outputBuffer = malloc(LOGGER_ROTATE_COPY_BUFFER_SIZE);
+    if (inputBuffer == NULL || outputBuffer == NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    dstFd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (dstFd < 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+
+    // A window of 15 bits plus 16 selects the gzip wrapper, readable with zcat.
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    *outputSize = 0;
+    do {
+        readLen = read(srcFd, inputBuffer, LOGGER_ROTATE_COPY_BUFFER_SIZE);
+        if (readLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            break;
+        }
+        // The log is not read again, leave the page cache to the rest of the system.
+        posix_fadvise(srcFd, readOffset, readLen, POSIX_FADV_DONTNEED);
+        readOffset += readLen;
+
+        flush = readLen == 0 ? Z_FINISH : Z_NO_FLUSH;
+        stream.next_in = inputBuffer;
+        stream.avail_in = (uInt) readLen;
+        do {
+            stream.next_out = outputBuffer;
+            stream.avail_out = LOGGER_ROTATE_COPY_BUFFER_SIZE;
+            if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+                returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+                break;
+            }
+
+            outputLen = LOGGER_ROTATE_COPY_BUFFER_SIZE - stream.avail_out;
+            for (writtenLen = 0; writtenLen < outputLen; writtenLen += (size_t) writeLen) {
+                writeLen = write(dstFd, outputBuffer + writtenLen, outputLen - writtenLen);
+                if (writeLen < 0 && errno == EINTR) {
+                    writeLen = 0;
+                    continue;
+                }
+                if (writeLen <= 0) {
+                    returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+                    break;
+                }
+            }
+            *outputSize += writtenLen;
+        } while (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS && stream.avail_out == 0);
+    } while (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS && flush != Z_FINISH);
+
+    deflateEnd(&stream);
+
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS && fsync(dstFd) != 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+out:
+    if (dstFd >= 0) {
+        close(dstFd);
+        // Only drop the original once the compressed copy is durable under its final name.
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS || rename(tempPath, compressPath) != 0) {
+            unlink(tempPath);
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        } else {
+            unlink(path);
+        }
+    }
+    close(srcFd);
+    free(inputBuffer);
+    free(outputBuffer);
+
+    return returnCode;
+}
+#endif
+
+static void LoggerRotate_RemoveOldFiles(void)
+{
+    char path[LOGGER_ROTATE_PATH_MAX_SIZE];
+    uint64_t totalSize;
+    uint32_t i;
+
+    // The current file is accounted at its full size, so that the limit holds until the next rotation.
+    totalSize = s_rotateConfig.fileSizeMax;
+    for (i = 0; i + 1 < s_fileCount; i++) {
+        totalSize += s_fileList[i].size;
+    }
+
+    while (s_fileCount > 1 && s_fileList[0].isClosed &&
+           ((s_rotateConfig.fileCountMax != 0 && s_fileCount > s_rotateConfig.fileCountMax) ||
+            (s_rotateConfig.totalSizeMax != 0 && totalSize > s_rotateConfig.totalSizeMax))) {
+        snprintf(path, sizeof(path), "%s/%s", s_rotateDirectory, s_fileList[0].name);
+        if (unlink(path) != 0 && errno != ENOENT) {
+            break;
+        }
+
+        totalSize -= s_fileList[0].size;
+        memmove(&s_fileList[0], &s_fileList[1], (s_fileCount - 1) * sizeof(T_LoggerRotateFile));
+        s_fileCount--;
+        s_rotateStatistics.removedFileCount++;
+    }
+}
+
+static T_LoggerRotateFile *LoggerRotate_FindFile(uint32_t index)
+{
+    uint32_t i;
+
+    for (i = 0; i < s_fileCount; i++) {
+        if (s_fileList[i].index == index) {
+            return &s_fileList[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool LoggerRotate_HasSuffix(const char *name, const char *suffix)
+{
+    size_t nameLen = strlen(name);
+    size_t suffixLen = strlen(suffix);
+
+    return nameLen >= suffixLen && strcmp(name + nameLen - suffixLen, suffix) == 0;
+}
+
+static int LoggerRotate_CompareFile(const void *a, const void *b)
+{
+    const T_LoggerRotateFile *fileA = a;
+    const T_LoggerRotateFile *fileB = b;
+
+    if (fileA->index != fileB->index) {
+        return fileA->index < fileB->index ? -1 : 1;
+    }
+
+    return (int) fileA->isCompressed - (int) fileB->isCompressed;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,93 @@
+/**
+ ********************************************************************
+ * @file    logger_rotate.h
+ * @brief   This is the header file for "logger_rotate.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOGGER_ROTATE_H
+#define LOGGER_ROTATE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define LOGGER_ROTATE_INDEX_FILE_NAME           "latest"
+#define LOGGER_ROTATE_COMPRESS_EXTENSION        ".gz"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    const char *directory;
+    const char *baseName; /*!< Files are named <baseName>_<index>_<date>_<time>.<extension>. */
+    const char *extension;
+    uint64_t fileSizeMax; /*!< Size a file is rotated at. */
+    uint64_t totalSizeMax; /*!< Disk usage of all files, including a full current file, 0 for no limit. */
+    uint32_t fileCountMax; /*!< Number of files kept, including the current one, 0 for no limit. */
+    bool isCompressEnabled; /*!< Compress closed files with gzip, needs zlib. */
+    T_ZiyanReturnCode (*FileOpen)(int fd); /*!< Optional, writes the header every new file starts with. */
+} T_LoggerRotateConfig;
+
+typedef struct {
+    uint32_t fileCount;
+    uint64_t diskUsageBytes;
+    uint64_t rotateCount;
+    uint64_t removedFileCount;
+    uint64_t compressedFileCount;
+    uint64_t compressInputBytes;
+    uint64_t compressOutputBytes;
+    uint64_t compressErrorCount;
+    float compressionRatio; /*!< Input over output bytes of the files compressed so far. */
+} T_LoggerRotateStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Open the first log file of the session and start the background thread that compresses closed files and
+ * removes the oldest ones. Files left uncompressed or half compressed by a previous session are recovered.
+ * @param config: rotation configuration, the strings are copied.
+ * @param fd: file descriptor of the first log file.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode LoggerRotate_Init(const T_LoggerRotateConfig *config, int *fd);
+
+/**
+ * @brief Stop the background thread. The current file stays open.
+ */
+T_ZiyanReturnCode LoggerRotate_DeInit(void);
+
+/**
+ * @brief Close a log file and open the next one, matching LoggerAsyncRotateFunc.
+ * @param fd: current log file.
+ * @return File descriptor of the next log file, negative value on failure with the current file left open.
+ */
+int LoggerRotate_NextFile(int fd);
+T_ZiyanReturnCode LoggerRotate_GetStatistics(T_LoggerRotateStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOGGER_ROTATE_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,399 @@
+/**
+ ********************************************************************
+ * @file    metrics_exporter.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "metrics_exporter.h"
+#include "ziyan_logger.h"
+#include "utils/util_metrics.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define METRICS_EXPORTER_PATH_MAX_SIZE          108
+#define METRICS_EXPORTER_BUFFER_SIZE            4096
+#define METRICS_EXPORTER_REQUEST_SIZE           1024
+#define METRICS_EXPORTER_REQUEST_TIMEOUT_MS     100
+#define METRICS_EXPORTER_POLL_PERIOD_MS         500
+#define METRICS_EXPORTER_LISTEN_BACKLOG         4
+#define METRICS_EXPORTER_HTTP_HEADER \
+    "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n"
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    int fd;
+    FILE *file;
+    uint32_t len;
+    bool isError;
+    char buffer[METRICS_EXPORTER_BUFFER_SIZE];
+} T_MetricsExporterWriter;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *MetricsExporter_Task(void *arg);
+static int MetricsExporter_ListenUnix(const char *path);
+static int MetricsExporter_ListenTcp(uint16_t port);
+static void MetricsExporter_Serve(int listenFd);
+static void MetricsExporter_Write(const char *data, uint32_t len, void *arg);
+static void MetricsExporter_FlushWriter(T_MetricsExporterWriter *writer);
+static uint64_t MetricsExporter_GetTimeMs(void);
+
+/* Private variables ---------------------------------------------------------*/
+static bool s_isExporterRunning = false;
+static volatile bool s_isExporterExit = false;
+static pthread_t s_exporterThread;
+static int s_unixListenFd = -1;
+static int s_tcpListenFd = -1;
+static char s_unixSocketPath[METRICS_EXPORTER_PATH_MAX_SIZE];
+static char s_dumpPath[METRICS_EXPORTER_PATH_MAX_SIZE];
+static uint32_t s_dumpPeriodMs = 0;
+static T_MetricsExporterWriter s_writer;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode MetricsExporter_Start(const T_MetricsExporterConfig *config)
+{
+    if (config == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isExporterRunning == true) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    s_unixSocketPath[0] = '\0';
+    if (config->unixSocketPath != NULL) {
+        if (strlen(config->unixSocketPath) >= sizeof(s_unixSocketPath)) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+        }
+        strcpy(s_unixSocketPath, config->unixSocketPath);
+
+        s_unixListenFd = MetricsExporter_ListenUnix(s_unixSocketPath);
+        if (s_unixListenFd < 0) {
+            USER_LOG_ERROR("listen on %s fail, errno:%d.", s_unixSocketPath, errno);
+        }
+    }
+
+    if (config->tcpPort != 0) {
+        s_tcpListenFd = MetricsExporter_ListenTcp(config->tcpPort);
+        if (s_tcpListenFd < 0) {
+            USER_LOG_ERROR("listen on port %d fail, errno:%d.", config->tcpPort, errno);
+        }
+    }
+
+    s_dumpPath[0] = '\0';
+    if (config->dumpPath != NULL && config->dumpPeriodMs != 0) {
+        strncat(s_dumpPath, config->dumpPath, sizeof(s_dumpPath) - 1);
+        s_dumpPeriodMs = config->dumpPeriodMs;
+    }
+
+    if (s_unixListenFd < 0 && s_tcpListenFd < 0 && s_dumpPath[0] == '\0') {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    s_isExporterExit = false;
+    if (pthread_create(&s_exporterThread, NULL, MetricsExporter_Task, NULL) != 0) {
+        MetricsExporter_Stop();
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    pthread_setname_np(s_exporterThread, "metrics_export");
+
+    s_isExporterRunning = true;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode MetricsExporter_Stop(void)
+{
+    if (s_isExporterRunning == true) {
+        s_isExporterExit = true;
+        pthread_join(s_exporterThread, NULL);
+        s_isExporterRunning = false;
+    }
+
+    if (s_unixListenFd >= 0) {
+        close(s_unixListenFd);
+        unlink(s_unixSocketPath);
+        s_unixListenFd = -1;
+    }
+
+    if (s_tcpListenFd >= 0) {
+        close(s_tcpListenFd);
+        s_tcpListenFd = -1;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode MetricsExporter_DumpToFile(const char *path)
+{
+    T_MetricsExporterWriter *writer;
+    char tempPath[METRICS_EXPORTER_PATH_MAX_SIZE + 8];
+    bool isError;
+
+    if (path == NULL || strlen(path) >= METRICS_EXPORTER_PATH_MAX_SIZE) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    writer = calloc(1, sizeof(T_MetricsExporterWriter));
+    if (writer == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    writer->fd = -1;
+    writer->file = fopen(tempPath, "w");
+    if (writer->file == NULL) {
+        free(writer);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    UtilMetrics_Export(MetricsExporter_Write, writer);
+    MetricsExporter_FlushWriter(writer);
+
+    isError = writer->isError;
+    if (fclose(writer->file) != 0) {
+        isError = true;
+    }
+    free(writer);
+
+    if (isError == true || rename(tempPath, path) != 0) {
+        unlink(tempPath);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+#ifndef __CC_ARM
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#endif
+
+static void *MetricsExporter_Task(void *arg)
+{
+    struct pollfd pollFds[2];
+    nfds_t pollFdCount = 0;
+    uint64_t nextDumpTimeMs = MetricsExporter_GetTimeMs() + s_dumpPeriodMs;
+    uint64_t currentTimeMs;
+    nfds_t i;
+
+    USER_UTIL_UNUSED(arg);
+
+    if (s_unixListenFd >= 0) {
+        pollFds[pollFdCount].fd = s_unixListenFd;
+        pollFds[pollFdCount++].events = POLLIN;
+    }
+    if (s_tcpListenFd >= 0) {
+        pollFds[pollFdCount].fd = s_tcpListenFd;
+        pollFds[pollFdCount++].events = POLLIN;
+    }
+
+    while (s_isExporterExit != true) {
+        if (poll(pollFds, pollFdCount, METRICS_EXPORTER_POLL_PERIOD_MS) > 0) {
+            for (i = 0; i < pollFdCount; i++) {
+                if (pollFds[i].revents & POLLIN) {
+                    MetricsExporter_Serve(pollFds[i].fd);
+                }
+            }
+        }
+
+        if (s_dumpPath[0] == '\0') {
+            continue;
+        }
+
+        currentTimeMs = MetricsExporter_GetTimeMs();
+        if (currentTimeMs >= nextDumpTimeMs) {
+            if (MetricsExporter_DumpToFile(s_dumpPath) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+                USER_LOG_ERROR("dump metrics to %s fail.", s_dumpPath);
+            }
+            nextDumpTimeMs = currentTimeMs + s_dumpPeriodMs;
+        }
+    }
+
+    return NULL;
+}
+
+#ifndef __CC_ARM
+#pragma GCC diagnostic pop
+#endif
+
+static int MetricsExporter_ListenUnix(const char *path)
+{
+    struct sockaddr_un addr = {0};
+    size_t pathLen = strlen(path);
+    int fd;
+
+    if (pathLen >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, pathLen + 1);
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, METRICS_EXPORTER_LISTEN_BACKLOG) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int MetricsExporter_ListenTcp(uint16_t port)
+{
+    struct sockaddr_in addr = {0};
+    int option = 1;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+
+    /* Loopback only, the metrics are not meant to leave the payload. */
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, METRICS_EXPORTER_LISTEN_BACKLOG) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void MetricsExporter_Serve(int listenFd)
+{
+    char request[METRICS_EXPORTER_REQUEST_SIZE];
+    struct pollfd pollFd;
+    ssize_t len = 0;
+    int fd;
+
+    fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    /* Give the client a moment to send its request, none means it wants the bare text. */
+    pollFd.fd = fd;
+    pollFd.events = POLLIN;
+    if (poll(&pollFd, 1, METRICS_EXPORTER_REQUEST_TIMEOUT_MS) > 0) {
+        len = recv(fd, request, sizeof(request) - 1, MSG_DONTWAIT);
+    }
+
+    memset(&s_writer, 0, sizeof(s_writer));
+    s_writer.fd = fd;
+
+    if (len >= 4 && memcmp(request, "GET ", 4) == 0) {
+        MetricsExporter_Write(METRICS_EXPORTER_HTTP_HEADER, sizeof(METRICS_EXPORTER_HTTP_HEADER) - 1, &s_writer);
+    }
+
+    UtilMetrics_Export(MetricsExporter_Write, &s_writer);
+    MetricsExporter_FlushWriter(&s_writer);
+
+    shutdown(fd, SHUT_WR);
+    close(fd);
+}
+
+static void MetricsExporter_Write(const char *data, uint32_t len, void *arg)
+{
+    T_MetricsExporterWriter *writer = (T_MetricsExporterWriter *) arg;
+    uint32_t copyLen;
+
+    while (len > 0 && writer->isError != true) {
+        copyLen = USER_UTIL_MIN(len, METRICS_EXPORTER_BUFFER_SIZE - writer->len);
+        memcpy(writer->buffer + writer->len, data, copyLen);
+        writer->len += copyLen;
+        data += copyLen;
+        len -= copyLen;
+
+        if (writer->len == METRICS_EXPORTER_BUFFER_SIZE) {
+            MetricsExporter_FlushWriter(writer);
+        }
+    }
+}
+
+static void MetricsExporter_FlushWriter(T_MetricsExporterWriter *writer)
+{
+    uint32_t offset = 0;
+    ssize_t ret;
+
+    if (writer->isError == true || writer->len == 0) {
+        return;
+    }
+
+    if (writer->file != NULL) {
+        if (fwrite(writer->buffer, 1, writer->len, writer->file) != writer->len) {
+            writer->isError = true;
+        }
+        writer->len = 0;
+        return;
+    }
+
+    while (offset < writer->len) {
+        ret = send(writer->fd, writer->buffer + offset, writer->len - offset, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            writer->isError = true;
+            break;
+        }
+        offset += (uint32_t) ret;
+    }
+    writer->len = 0;
+}
+
+static uint64_t MetricsExporter_GetTimeMs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000 + (uint64_t) time.tv_nsec / 1000000;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
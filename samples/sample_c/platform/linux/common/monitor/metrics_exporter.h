@@ -0,0 +1,67 @@
+/**
+ ********************************************************************
+ * @file    metrics_exporter.h
+ * @brief   This is the header file for "metrics_exporter.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    const char *unixSocketPath; /*!< Unix stream socket serving the metrics, NULL to disable. */
+    uint16_t tcpPort; /*!< Port on 127.0.0.1 serving the metrics over HTTP, 0 to disable. */
+    const char *dumpPath; /*!< File the metrics are written to periodically, NULL to disable. */
+    uint32_t dumpPeriodMs;
+} T_MetricsExporterConfig;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start the thread exporting the metrics registry in the Prometheus text format. A client sending an HTTP
+ * request gets an HTTP response, a client sending nothing gets the bare text, e.g. socat - UNIX-CONNECT:<path>.
+ * @param config: exporter configuration, the strings are copied.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode MetricsExporter_Start(const T_MetricsExporterConfig *config);
+T_ZiyanReturnCode MetricsExporter_Stop(void);
+
+/**
+ * @brief Write the metrics to a file, replaced atomically.
+ */
+T_ZiyanReturnCode MetricsExporter_DumpToFile(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_EXPORTER_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
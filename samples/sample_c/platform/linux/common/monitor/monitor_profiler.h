@@ -0,0 +1,93 @@
+/**
+ ********************************************************************
+ * @file    monitor_profiler.h
+ * @brief   This is the header file for "monitor_profiler.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef MONITOR_PROFILER_H
+#define MONITOR_PROFILER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define MONITOR_PROFILER_STACK_DEPTH_MAX        32
+#define MONITOR_PROFILER_FREQUENCY_DEFAULT      99 /* Off the round rates of periodic tasks to avoid lockstep. */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t frequencyHz; /*!< Samples per second of CPU time of each thread. */
+    const char *outputDirectory; /*!< Folded stacks are written to <directory>/profile_<date>_<time>.folded. */
+} T_MonitorProfilerConfig;
+
+typedef struct {
+    bool isRunning;
+    uint32_t threadCount; /*!< Threads with a sampling timer. */
+    uint64_t sampleCount;
+    uint64_t droppedSampleCount; /*!< Samples lost on a full ring or a full stack table. */
+    uint64_t handlerNsTotal; /*!< Time spent in the signal handler, the cost to the profiled threads. */
+    uint64_t stackCount; /*!< Distinct stacks aggregated so far. */
+} T_MonitorProfilerStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start the control thread of the sampling profiler, profiling itself starts with MonitorProfiler_Start() or
+ * MonitorProfiler_ToggleFromSignal(). Each thread of the process gets a timer on its own CPU time clock delivering
+ * SIGPROF to it, the handler walks the frame pointer chain.
+ * @param config: profiler configuration, the strings are copied.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode MonitorProfiler_Init(const T_MonitorProfilerConfig *config);
+T_ZiyanReturnCode MonitorProfiler_DeInit(void);
+
+/**
+ * @brief Start sampling all threads, threads created later are picked up within a second.
+ */
+T_ZiyanReturnCode MonitorProfiler_Start(void);
+
+/**
+ * @brief Stop sampling and write the folded stacks, one "thread;outer;...;inner count" line per stack, the input of
+ * flamegraph.pl. Functions of a stripped executable are written as <module>+0x<offset> for addr2line.
+ * @param outputPath: path of the written file, may be NULL.
+ * @param outputPathSize: size of outputPath.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode MonitorProfiler_Stop(char *outputPath, uint16_t outputPathSize);
+
+/**
+ * @brief Request the control thread to start or stop profiling. Async-signal-safe, meant to be called from a signal
+ * handler, e.g. kill -USR2 <pid>.
+ */
+void MonitorProfiler_ToggleFromSignal(void);
+T_ZiyanReturnCode MonitorProfiler_GetStatistics(T_MonitorProfilerStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_PROFILER_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,543 @@
+/**
+ ********************************************************************
+ * @file    monitor_sampler.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include "monitor_sampler.h"
+#include "ziyan_logger.h"
+#include "utils/util_log.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define MONITOR_SAMPLER_PATH_SIZE               64
+#define MONITOR_SAMPLER_READ_BUFFER_SIZE        4096
+#define MONITOR_SAMPLER_STAT_UTIME_FIELD        14 /* Field of utime in /proc/<pid>/stat, stime follows. */
+#define MONITOR_SAMPLER_STAT_STATE_FIELD        3
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    pid_t tid;
+    int fd;
+    uint64_t cpuTicks;
+} T_MonitorSamplerThreadEntry;
+
+typedef struct {
+    uint64_t busyTicks;
+    uint64_t totalTicks;
+} T_MonitorSamplerSystemTicks;
+
+/* Private functions declaration ---------------------------------------------*/
+static uint64_t MonitorSampler_GetTimeNs(clockid_t clockId);
+static int MonitorSampler_Read(int fd, char *buffer, uint32_t bufferSize);
+static const char *MonitorSampler_ParseUint(const char *p, const char *end, uint64_t *value);
+static const char *MonitorSampler_SkipFields(const char *p, const char *end, uint32_t count);
+static T_ZiyanReturnCode MonitorSampler_ParseTaskStat(const char *buffer, int len, char *name, uint32_t nameSize,
+                                                      char *state, uint64_t *cpuTicks);
+static T_ZiyanReturnCode MonitorSampler_SampleSystem(T_MonitorSamplerSnapshot *snapshot);
+static T_ZiyanReturnCode MonitorSampler_SampleProcess(T_MonitorSamplerSnapshot *snapshot);
+static uint32_t MonitorSampler_ListThreads(pid_t *tidList, uint32_t size);
+static void MonitorSampler_SampleThreads(T_MonitorSamplerSnapshot *snapshot);
+
+/* Private variables ---------------------------------------------------------*/
+static bool s_isSamplerInit = false;
+static pid_t s_pid;
+static int s_systemStatFd = -1;
+static int s_memInfoFd = -1;
+static int s_processStatFd = -1;
+static int s_processStatmFd = -1;
+static DIR *s_taskDir = NULL;
+static uint64_t s_ticksPerSecond;
+static uint64_t s_pageSize;
+
+static T_MonitorSamplerThreadEntry s_threadTable[MONITOR_SAMPLER_THREAD_MAX];
+static T_MonitorSamplerThreadEntry s_threadTableNext[MONITOR_SAMPLER_THREAD_MAX];
+static uint32_t s_threadTableCount = 0;
+static pid_t s_tidList[MONITOR_SAMPLER_THREAD_MAX];
+
+static T_MonitorSamplerSystemTicks s_lastSystemTicks;
+static uint64_t s_lastTimestampUs;
+static uint64_t s_lastProcessCpuTicks;
+static uint64_t s_lastRssBytes;
+static uint64_t s_sampleCpuNsTotal;
+static char s_readBuffer[MONITOR_SAMPLER_READ_BUFFER_SIZE];
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode MonitorSampler_Init(void)
+{
+    char path[MONITOR_SAMPLER_PATH_SIZE];
+
+    if (s_isSamplerInit == true) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    s_pid = getpid();
+    s_ticksPerSecond = (uint64_t) sysconf(_SC_CLK_TCK);
+    s_pageSize = (uint64_t) sysconf(_SC_PAGESIZE);
+
+    s_systemStatFd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    s_memInfoFd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int) s_pid);
+    s_processStatFd = open(path, O_RDONLY | O_CLOEXEC);
+
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int) s_pid);
+    s_processStatmFd = open(path, O_RDONLY | O_CLOEXEC);
+
+    snprintf(path, sizeof(path), "/proc/%d/task", (int) s_pid);
+    s_taskDir = opendir(path);
+
+    if (s_systemStatFd < 0 || s_memInfoFd < 0 || s_processStatFd < 0 || s_processStatmFd < 0 || s_taskDir == NULL ||
+        s_ticksPerSecond == 0) {
+        USER_LOG_ERROR("open proc files fail.");
+        s_isSamplerInit = true;
+        MonitorSampler_DeInit();
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    s_threadTableCount = 0;
+    s_lastTimestampUs = 0;
+    s_sampleCpuNsTotal = 0;
+    s_isSamplerInit = true;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode MonitorSampler_DeInit(void)
+{
+    uint32_t i;
+
+    if (s_isSamplerInit != true) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    for (i = 0; i < s_threadTableCount; i++) {
+        close(s_threadTable[i].fd);
+    }
+    s_threadTableCount = 0;
+
+    if (s_taskDir != NULL) {
+        closedir(s_taskDir);
+        s_taskDir = NULL;
+    }
+    if (s_systemStatFd >= 0) {
+        close(s_systemStatFd);
+        s_systemStatFd = -1;
+    }
+    if (s_memInfoFd >= 0) {
+        close(s_memInfoFd);
+        s_memInfoFd = -1;
+    }
+    if (s_processStatFd >= 0) {
+        close(s_processStatFd);
+        s_processStatFd = -1;
+    }
+    if (s_processStatmFd >= 0) {
+        close(s_processStatmFd);
+        s_processStatmFd = -1;
+    }
+
+    s_isSamplerInit = false;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode MonitorSampler_Sample(T_MonitorSamplerSnapshot *snapshot)
+{
+    T_ZiyanReturnCode returnCode;
+    uint64_t sampleStartCpuNs;
+
+    if (s_isSamplerInit != true || snapshot == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    sampleStartCpuNs = MonitorSampler_GetTimeNs(CLOCK_THREAD_CPUTIME_ID);
+
+    snapshot->timestampUs = MonitorSampler_GetTimeNs(CLOCK_MONOTONIC) / 1000;
+    snapshot->intervalUs = s_lastTimestampUs != 0 ? snapshot->timestampUs - s_lastTimestampUs : 0;
+
+    returnCode = MonitorSampler_SampleSystem(snapshot);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("sample system fail.");
+        return returnCode;
+    }
+
+    returnCode = MonitorSampler_SampleProcess(snapshot);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("sample process fail.");
+        return returnCode;
+    }
+
+    MonitorSampler_SampleThreads(snapshot);
+
+    s_lastTimestampUs = snapshot->timestampUs;
+
+    snapshot->sampleCpuNs = MonitorSampler_GetTimeNs(CLOCK_THREAD_CPUTIME_ID) - sampleStartCpuNs;
+    s_sampleCpuNsTotal += snapshot->sampleCpuNs;
+    snapshot->sampleCpuNsTotal = s_sampleCpuNsTotal;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static uint64_t MonitorSampler_GetTimeNs(clockid_t clockId)
+{
+    struct timespec time;
+
+    clock_gettime(clockId, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+static int MonitorSampler_Read(int fd, char *buffer, uint32_t bufferSize)
+{
+    ssize_t len;
+
+    /* Reading a /proc file from offset 0 regenerates its content, no need to reopen or seek. */
+    len = pread(fd, buffer, bufferSize - 1, 0);
+    if (len <= 0) {
+        return -1;
+    }
+    buffer[len] = '\0';
+
+    return (int) len;
+}
+
+static const char *MonitorSampler_ParseUint(const char *p, const char *end, uint64_t *value)
+{
+    uint64_t result = 0;
+    const char *start;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+
+    start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (uint64_t) (*p - '0');
+        p++;
+    }
+
+    if (p == start) {
+        return NULL;
+    }
+
+    *value = result;
+
+    return p;
+}
+
+static const char *MonitorSampler_SkipFields(const char *p, const char *end, uint32_t count)
+{
+    while (count > 0) {
+        while (p < end && *p == ' ') {
+            p++;
+        }
+        while (p < end && *p != ' ') {
+            p++;
+        }
+        if (p >= end) {
+            return NULL;
+        }
+        count--;
+    }
+
+    return p;
+}
+
+static T_ZiyanReturnCode MonitorSampler_ParseTaskStat(const char *buffer, int len, char *name, uint32_t nameSize,
+                                                      char *state, uint64_t *cpuTicks)
+{
+    const char *end = buffer + len;
+    const char *nameStart;
+    const char *nameEnd;
+    const char *p;
+    uint64_t utime = 0;
+    uint64_t stime = 0;
+    uint32_t nameLen;
+
+    /* "<tid> (<comm>) <state> ...": comm may hold spaces and parentheses, it ends at the last ')'. */
+    nameStart = memchr(buffer, '(', (size_t) len);
+    nameEnd = memrchr(buffer, ')', (size_t) len);
+    if (nameStart == NULL || nameEnd == NULL || nameEnd < nameStart || nameEnd + 2 >= end) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (name != NULL) {
+        nameLen = (uint32_t) (nameEnd - nameStart - 1);
+        if (nameLen >= nameSize) {
+            nameLen = nameSize - 1;
+        }
+        memcpy(name, nameStart + 1, nameLen);
+        name[nameLen] = '\0';
+    }
+
+    p = nameEnd + 2;
+    if (state != NULL) {
+        *state = *p;
+    }
+
+    p = MonitorSampler_SkipFields(p, end, MONITOR_SAMPLER_STAT_UTIME_FIELD - MONITOR_SAMPLER_STAT_STATE_FIELD);
+    if (p == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    p = MonitorSampler_ParseUint(p, end, &utime);
+    if (p == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    p = MonitorSampler_ParseUint(p, end, &stime);
+    if (p == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    *cpuTicks = utime + stime;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode MonitorSampler_SampleSystem(T_MonitorSamplerSnapshot *snapshot)
+{
+    T_MonitorSamplerSystemTicks ticks = {0};
+    const char *p;
+    const char *end;
+    const char *lineEnd;
+    uint64_t value;
+    uint32_t i;
+    int len;
+    uint8_t foundCount = 0;
+
+    len = MonitorSampler_Read(s_systemStatFd, s_readBuffer, sizeof(s_readBuffer));
+    if (len < 0 || strncmp(s_readBuffer, "cpu ", 4) != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    /* "cpu user nice system idle iowait irq softirq steal ...", idle and iowait are not busy. */
+    end = s_readBuffer + len;
+    p = s_readBuffer + 3;
+    for (i = 0; i < 8; i++) {
+        p = MonitorSampler_ParseUint(p, end, &value);
+        if (p == NULL) {
+            break;
+        }
+        ticks.totalTicks += value;
+        if (i != 3 && i != 4) {
+            ticks.busyTicks += value;
+        }
+    }
+
+    if (s_lastSystemTicks.totalTicks != 0 && ticks.totalTicks > s_lastSystemTicks.totalTicks) {
+        snapshot->systemPcpu = (float) (ticks.busyTicks - s_lastSystemTicks.busyTicks) * 100.0f /
+                               (float) (ticks.totalTicks - s_lastSystemTicks.totalTicks);
+    } else {
+        snapshot->systemPcpu = 0;
+    }
+    s_lastSystemTicks = ticks;
+
+    len = MonitorSampler_Read(s_memInfoFd, s_readBuffer, sizeof(s_readBuffer));
+    if (len < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    snapshot->memTotalBytes = 0;
+    snapshot->memAvailableBytes = 0;
+    end = s_readBuffer + len;
+    p = s_readBuffer;
+    while (p < end && foundCount < 2) {
+        lineEnd = memchr(p, '\n', (size_t) (end - p));
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+
+        if (strncmp(p, "MemTotal:", 9) == 0 && MonitorSampler_ParseUint(p + 9, lineEnd, &value) != NULL) {
+            snapshot->memTotalBytes = value * 1024;
+            foundCount++;
+        } else if (strncmp(p, "MemAvailable:", 13) == 0 &&
+                   MonitorSampler_ParseUint(p + 13, lineEnd, &value) != NULL) {
+            snapshot->memAvailableBytes = value * 1024;
+            foundCount++;
+        }
+
+        p = lineEnd + 1;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode MonitorSampler_SampleProcess(T_MonitorSamplerSnapshot *snapshot)
+{
+    T_ZiyanReturnCode returnCode;
+    const char *p;
+    const char *end;
+    uint64_t vmSizePages = 0;
+    uint64_t rssPages = 0;
+    int len;
+
+    len = MonitorSampler_Read(s_processStatFd, s_readBuffer, sizeof(s_readBuffer));
+    if (len < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    returnCode = MonitorSampler_ParseTaskStat(s_readBuffer, len, NULL, 0, NULL, &snapshot->processCpuTicks);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    snapshot->processCpuTicksDelta = s_lastTimestampUs != 0 ? snapshot->processCpuTicks - s_lastProcessCpuTicks : 0;
+    snapshot->processPcpu = snapshot->intervalUs != 0 ?
+                            (float) snapshot->processCpuTicksDelta * 100.0f * 1000000.0f /
+                            ((float) s_ticksPerSecond * (float) snapshot->intervalUs) : 0;
+    s_lastProcessCpuTicks = snapshot->processCpuTicks;
+
+    /* "size resident shared text lib data dt" in pages. */
+    len = MonitorSampler_Read(s_processStatmFd, s_readBuffer, sizeof(s_readBuffer));
+    if (len < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    end = s_readBuffer + len;
+    p = MonitorSampler_ParseUint(s_readBuffer, end, &vmSizePages);
+    if (p == NULL || MonitorSampler_ParseUint(p, end, &rssPages) == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    snapshot->vmSizeBytes = vmSizePages * s_pageSize;
+    snapshot->rssBytes = rssPages * s_pageSize;
+    snapshot->rssBytesDelta = s_lastTimestampUs != 0 ? (int64_t) snapshot->rssBytes - (int64_t) s_lastRssBytes : 0;
+    s_lastRssBytes = snapshot->rssBytes;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static uint32_t MonitorSampler_ListThreads(pid_t *tidList, uint32_t size)
+{
+    struct dirent *entry;
+    uint64_t tid;
+    uint32_t count = 0;
+    uint32_t i;
+    pid_t temp;
+
+    rewinddir(s_taskDir);
+    while ((entry = readdir(s_taskDir)) != NULL && count < size) {
+        if (MonitorSampler_ParseUint(entry->d_name, entry->d_name + strlen(entry->d_name), &tid) == NULL) {
+            continue;
+        }
+
+        /* Keep the list sorted, the kernel already lists tasks in ascending order. */
+        i = count++;
+        tidList[i] = (pid_t) tid;
+        while (i > 0 && tidList[i - 1] > tidList[i]) {
+            temp = tidList[i - 1];
+            tidList[i - 1] = tidList[i];
+            tidList[i] = temp;
+            i--;
+        }
+    }
+
+    return count;
+}
+
+static void MonitorSampler_SampleThreads(T_MonitorSamplerSnapshot *snapshot)
+{
+    T_MonitorSamplerThreadEntry *entry;
+    T_MonitorSamplerThread *thread;
+    char path[MONITOR_SAMPLER_PATH_SIZE];
+    uint32_t tidCount;
+    uint32_t nextCount = 0;
+    uint32_t oldIndex = 0;
+    uint32_t i;
+    bool isNew;
+    int len;
+
+    snapshot->threadStartedCount = 0;
+    snapshot->threadExitedCount = 0;
+
+    tidCount = MonitorSampler_ListThreads(s_tidList, MONITOR_SAMPLER_THREAD_MAX);
+
+    /* Both lists are sorted by tid, merge them to reuse the open files of known threads. */
+    for (i = 0; i < tidCount; i++) {
+        while (oldIndex < s_threadTableCount && s_threadTable[oldIndex].tid < s_tidList[i]) {
+            close(s_threadTable[oldIndex].fd);
+            snapshot->threadExitedCount++;
+            oldIndex++;
+        }
+
+        entry = &s_threadTableNext[nextCount];
+        thread = &snapshot->threads[nextCount];
+
+        if (oldIndex < s_threadTableCount && s_threadTable[oldIndex].tid == s_tidList[i]) {
+            *entry = s_threadTable[oldIndex++];
+            isNew = false;
+        } else {
+            snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", (int) s_pid, (int) s_tidList[i]);
+            entry->tid = s_tidList[i];
+            entry->fd = open(path, O_RDONLY | O_CLOEXEC);
+            entry->cpuTicks = 0;
+            if (entry->fd < 0) {
+                continue;
+            }
+            isNew = true;
+        }
+
+        len = MonitorSampler_Read(entry->fd, s_readBuffer, sizeof(s_readBuffer));
+        if (len < 0 || MonitorSampler_ParseTaskStat(s_readBuffer, len, thread->name, sizeof(thread->name),
+                                                    &thread->state, &thread->cpuTicks) !=
+                       ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            /* The thread exited after it was listed. */
+            close(entry->fd);
+            if (isNew != true) {
+                snapshot->threadExitedCount++;
+            }
+            continue;
+        }
+
+        thread->tid = entry->tid;
+        thread->cpuTicksDelta = isNew != true ? thread->cpuTicks - entry->cpuTicks : 0;
+        thread->pcpu = snapshot->intervalUs != 0 ?
+                       (float) thread->cpuTicksDelta * 100.0f * 1000000.0f /
+                       ((float) s_ticksPerSecond * (float) snapshot->intervalUs) : 0;
+        entry->cpuTicks = thread->cpuTicks;
+
+        if (isNew == true) {
+            snapshot->threadStartedCount++;
+        }
+        nextCount++;
+    }
+
+    while (oldIndex < s_threadTableCount) {
+        close(s_threadTable[oldIndex++].fd);
+        snapshot->threadExitedCount++;
+    }
+
+    memcpy(s_threadTable, s_threadTableNext, nextCount * sizeof(T_MonitorSamplerThreadEntry));
+    s_threadTableCount = nextCount;
+    snapshot->threadCount = nextCount;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
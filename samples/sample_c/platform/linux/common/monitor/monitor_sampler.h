@@ -0,0 +1,102 @@
+/**
+ ********************************************************************
+ * @file    monitor_sampler.h
+ * @brief   This is the header file for "monitor_sampler.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef MONITOR_SAMPLER_H
+#define MONITOR_SAMPLER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <sys/types.h>
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define MONITOR_SAMPLER_THREAD_MAX              128
+#define MONITOR_SAMPLER_THREAD_NAME_SIZE        16
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    pid_t tid;
+    char name[MONITOR_SAMPLER_THREAD_NAME_SIZE];
+    char state; /*!< State letter of /proc/<pid>/task/<tid>/stat, R, S, D... */
+    uint64_t cpuTicks; /*!< User and system time since the thread started, in clock ticks. */
+    uint64_t cpuTicksDelta; /*!< Ticks since the previous sample, 0 for a thread first seen in this one. */
+    float pcpu; /*!< Percentage of one core over the last interval. */
+} T_MonitorSamplerThread;
+
+typedef struct {
+    uint64_t timestampUs; /*!< Monotonic time of the sample. */
+    uint64_t intervalUs; /*!< Time since the previous sample, 0 for the first one. */
+
+    float systemPcpu; /*!< Busy percentage of all cores over the last interval. */
+    float processPcpu; /*!< Percentage of one core used by the process over the last interval. */
+    uint64_t processCpuTicks;
+    uint64_t processCpuTicksDelta;
+
+    uint64_t memTotalBytes;
+    uint64_t memAvailableBytes;
+    uint64_t vmSizeBytes;
+    uint64_t rssBytes;
+    int64_t rssBytesDelta;
+
+    uint32_t threadCount; /*!< Threads listed in threads, capped to MONITOR_SAMPLER_THREAD_MAX. */
+    uint32_t threadStartedCount; /*!< Threads seen for the first time in this sample. */
+    uint32_t threadExitedCount; /*!< Threads of the previous sample gone in this one. */
+    T_MonitorSamplerThread threads[MONITOR_SAMPLER_THREAD_MAX];
+
+    uint64_t sampleCpuNs; /*!< CPU time this sample cost the calling thread. */
+    uint64_t sampleCpuNsTotal; /*!< CPU time of all samples so far. */
+} T_MonitorSamplerSnapshot;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Open the /proc files of the system and of the calling process. They stay open and are re-read with pread
+ * on every sample, the stat file of each thread is opened the first time the thread is seen.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode MonitorSampler_Init(void);
+
+/**
+ * @brief Close all /proc files.
+ */
+T_ZiyanReturnCode MonitorSampler_DeInit(void);
+
+/**
+ * @brief Sample the system, the process and all its threads in one pass. Deltas are against the previous call.
+ * Not thread safe, call from a single monitor task.
+ * @param snapshot: filled with the sample.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode MonitorSampler_Sample(T_MonitorSamplerSnapshot *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_SAMPLER_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
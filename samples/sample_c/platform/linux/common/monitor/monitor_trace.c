@@ -0,0 +1,205 @@
+/**
+ ********************************************************************
+ * @file    monitor_trace.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "monitor_trace.h"
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "utils/util_log.h"
+#include "utils/util_trace.h"
+#include "ziyan_logger.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define MONITOR_TRACE_DIRECTORY_MAX_SIZE        64
+#define MONITOR_TRACE_PATH_MAX_SIZE             (MONITOR_TRACE_DIRECTORY_MAX_SIZE + 48)
+#define MONITOR_TRACE_FILE_BUFFER_SIZE          (64 * 1024)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static void *MonitorTrace_Task(void *arg);
+static void MonitorTrace_WriteFile(const char *data, uint32_t len, void *arg);
+
+/* Private values ------------------------------------------------------------*/
+static bool s_isTraceInit = false;
+static char s_outputDirectory[MONITOR_TRACE_DIRECTORY_MAX_SIZE];
+static pthread_mutex_t s_traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t s_traceThread;
+static sem_t s_traceSem;
+static bool s_isTraceExit = false;
+static bool s_isTogglePending = false;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode MonitorTrace_Init(const char *outputDirectory)
+{
+    if (outputDirectory == NULL || strlen(outputDirectory) >= sizeof(s_outputDirectory)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isTraceInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    strcpy(s_outputDirectory, outputDirectory);
+    if (sem_init(&s_traceSem, 0, 0) != 0) {
+        USER_LOG_ERROR("create trace semaphore fail, errno:%d.", errno);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    s_isTraceExit = false;
+    s_isTogglePending = false;
+    if (pthread_create(&s_traceThread, NULL, MonitorTrace_Task, NULL) != 0) {
+        USER_LOG_ERROR("create trace thread fail.");
+        sem_destroy(&s_traceSem);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    s_isTraceInit = true;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode MonitorTrace_DeInit(void)
+{
+    if (!s_isTraceInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    __atomic_store_n(&s_isTraceExit, true, __ATOMIC_RELEASE);
+    sem_post(&s_traceSem);
+    pthread_join(s_traceThread, NULL);
+    sem_destroy(&s_traceSem);
+    s_isTraceInit = false;
+
+    return MonitorTrace_Stop(NULL, 0);
+}
+
+T_ZiyanReturnCode MonitorTrace_Stop(char *outputPath, uint16_t outputPathSize)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    char path[MONITOR_TRACE_PATH_MAX_SIZE];
+    time_t currentTime = time(NULL);
+    struct tm localTime;
+    FILE *file;
+
+    if (outputPath != NULL && outputPathSize > 0) {
+        outputPath[0] = '\0';
+    }
+
+    pthread_mutex_lock(&s_traceMutex);
+    if (!__atomic_load_n(&g_utilTraceIsEnabled, __ATOMIC_ACQUIRE)) {
+        goto out;
+    }
+    UtilTrace_Stop();
+
+    localtime_r(&currentTime, &localTime);
+    snprintf(path, sizeof(path), "%s/trace_%04d%02d%02d_%02d-%02d-%02d.json", s_outputDirectory,
+             localTime.tm_year + 1900, localTime.tm_mon + 1, localTime.tm_mday, localTime.tm_hour,
+             localTime.tm_min, localTime.tm_sec);
+
+    file = fopen(path, "we");
+    if (file == NULL) {
+        USER_LOG_ERROR("open trace %s fail, errno:%d.", path, errno);
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+    setvbuf(file, NULL, _IOFBF, MONITOR_TRACE_FILE_BUFFER_SIZE);
+
+    returnCode = UtilTrace_Export(MonitorTrace_WriteFile, file);
+    if (fclose(file) != 0 && returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("write trace %s fail, errno:%d.", path, errno);
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS && outputPath != NULL && outputPathSize > 0) {
+        snprintf(outputPath, outputPathSize, "%s", path);
+    }
+
+out:
+    pthread_mutex_unlock(&s_traceMutex);
+
+    return returnCode;
+}
+
+void MonitorTrace_ToggleFromSignal(void)
+{
+    int savedErrno = errno;
+
+    if (!s_isTraceInit) {
+        return;
+    }
+
+    __atomic_store_n(&s_isTogglePending, true, __ATOMIC_RELEASE);
+    sem_post(&s_traceSem);
+    errno = savedErrno;
+}
+
+/* Private functions definition-----------------------------------------------*/
+#ifndef __CC_ARM
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#endif
+
+static void *MonitorTrace_Task(void *arg)
+{
+    char outputPath[MONITOR_TRACE_PATH_MAX_SIZE];
+
+    (void) arg;
+    pthread_setname_np(pthread_self(), "trace");
+
+    while (!__atomic_load_n(&s_isTraceExit, __ATOMIC_ACQUIRE)) {
+        if (sem_wait(&s_traceSem) != 0 ||
+            !__atomic_exchange_n(&s_isTogglePending, false, __ATOMIC_ACQ_REL)) {
+            continue;
+        }
+
+        if (__atomic_load_n(&g_utilTraceIsEnabled, __ATOMIC_ACQUIRE)) {
+            if (MonitorTrace_Stop(outputPath, sizeof(outputPath)) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+                USER_LOG_INFO("Trace written to %s.", outputPath);
+            }
+        } else {
+            UtilTrace_Start();
+            USER_LOG_INFO("Trace capture started.");
+        }
+    }
+
+    return NULL;
+}
+
+#ifndef __CC_ARM
+#pragma GCC diagnostic pop
+#endif
+
+static void MonitorTrace_WriteFile(const char *data, uint32_t len, void *arg)
+{
+    fwrite(data, 1, len, (FILE *) arg);
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,70 @@
+/**
+ ********************************************************************
+ * @file    monitor_trace.h
+ * @brief   This is the header file for "monitor_trace.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef MONITOR_TRACE_H
+#define MONITOR_TRACE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported types ------------------------------------------------------------*/
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Start the thread writing the traces of the OSAL and UTIL_TRACE_SPAN() trace points, a capture starts and
+ * stops with MonitorTrace_ToggleFromSignal().
+ * @param outputDirectory: traces are written to <directory>/trace_<date>_<time>.json, the string is copied.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode MonitorTrace_Init(const char *outputDirectory);
+T_ZiyanReturnCode MonitorTrace_DeInit(void);
+
+/**
+ * @brief Stop the running capture and write it in the Chrome trace event format, for chrome://tracing or
+ * ui.perfetto.dev.
+ * @param outputPath: path of the written file, empty string when no capture was running, may be NULL.
+ * @param outputPathSize: size of outputPath.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode MonitorTrace_Stop(char *outputPath, uint16_t outputPathSize);
+
+/**
+ * @brief Request a capture to start, or to stop and be written. Async-signal-safe, e.g. kill -USR1 <pid>.
+ */
+void MonitorTrace_ToggleFromSignal(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MONITOR_TRACE_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -25,16 +25,44 @@
 /* Includes ------------------------------------------------------------------*/
 #include "osal.h"
 #include "ziyan_typedef.h"
+#include <errno.h>
+#include "utils/util_metrics.h"
+#include "utils/util_trace.h"
 
 /* Private constants ---------------------------------------------------------*/
+#define OSAL_TASK_NAME_MAX_SIZE             16
+#define OSAL_TRACE_MUTEX_HOLD_DEPTH         8
+#define OSAL_TRACE_MUTEX_HOLD_MIN_US        10 /* Shorter holds would fill the trace of a 1 kHz loop. */
 
 /* Private types -------------------------------------------------------------*/
+typedef struct {
+    void *(*taskFunc)(void *);
+    void *arg;
+    char name[OSAL_TASK_NAME_MAX_SIZE];
+} T_OsalTaskStart;
+
+typedef struct {
+    T_ZiyanMutexHandle mutex;
+    uint64_t startUs;
+} T_OsalMutexHold;
 
 /* Private values -------------------------------------------------------------*/
 static uint32_t s_localTimeMsOffset = 0;
 static uint64_t s_localTimeUsOffset = 0;
+static T_UtilMetric s_mallocCount = UTIL_METRICS_COUNTER("ziyan_osal_malloc_total", "Calls to Osal_Malloc.");
+static T_UtilMetric s_mallocBytes = UTIL_METRICS_COUNTER("ziyan_osal_malloc_bytes_total",
+                                                         "Bytes requested from Osal_Malloc.");
+static T_UtilMetric s_mallocFailCount = UTIL_METRICS_COUNTER("ziyan_osal_malloc_failures_total",
+                                                             "Calls to Osal_Malloc returning NULL.");
+static T_UtilMetric s_freeCount = UTIL_METRICS_COUNTER("ziyan_osal_free_total", "Calls to Osal_Free.");
+// Mutexes held by the thread, the hold time is traced at unlock.
+static __thread T_OsalMutexHold s_mutexHold[OSAL_TRACE_MUTEX_HOLD_DEPTH];
+static __thread uint8_t s_mutexHoldCount = 0;
 
 /* Private functions declaration ---------------------------------------------*/
+static void *Osal_TaskStart(void *arg);
+static void Osal_TraceMutexHoldBegin(T_ZiyanMutexHandle mutex);
+static void Osal_TraceMutexHoldEnd(T_ZiyanMutexHandle mutex);
 
 /* Exported functions definition ---------------------------------------------*/
 
@@ -48,20 +76,33 @@ T_ZiyanReturnCode Osal_TaskCreate(const char *name, void *(*taskFunc)(void *), u
                                 T_ZiyanTaskHandle *task)
 {
     int result;
-    char nameDealed[16] = {0};
+    char nameDealed[OSAL_TASK_NAME_MAX_SIZE] = {0};
+    T_OsalTaskStart *taskStart;
 
     *task = malloc(sizeof(pthread_t));
     if (*task == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
     }
 
-    result = pthread_create(*task, NULL, taskFunc, arg);
+    if (name != NULL)
+        strncpy(nameDealed, name, sizeof(nameDealed) - 1);
+
+    // The task names itself in the trace before running the task function.
+    taskStart = malloc(sizeof(T_OsalTaskStart));
+    if (taskStart == NULL) {
+        free(*task);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+    taskStart->taskFunc = taskFunc;
+    taskStart->arg = arg;
+    memcpy(taskStart->name, nameDealed, sizeof(taskStart->name));
+
+    result = pthread_create(*task, NULL, Osal_TaskStart, taskStart);
     if (result != 0) {
+        free(taskStart);
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    if (name != NULL)
-        strncpy(nameDealed, name, sizeof(nameDealed) - 1);
     result = pthread_setname_np(*(pthread_t *) *task, nameDealed);
     if (result != 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
@@ -86,8 +127,14 @@ T_ZiyanReturnCode Osal_TaskDestroy(T_ZiyanTaskHandle task)
 
 T_ZiyanReturnCode Osal_TaskSleepMs(uint32_t timeMs)
 {
+    uint64_t startUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
+
     usleep(1000 * timeMs);
 
+    if (startUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_TASK, "sleep", startUs, "ms", timeMs);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -148,12 +195,26 @@ T_ZiyanReturnCode Osal_MutexDestroy(T_ZiyanMutexHandle mutex)
 T_ZiyanReturnCode Osal_MutexLock(T_ZiyanMutexHandle mutex)
 {
     int result = 0;
+    uint64_t startUs;
 
     if (!mutex) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
-    result = pthread_mutex_lock(mutex);
+    if (UTIL_TRACE_IS_ENABLED()) {
+        // Only contended locks are traced as waits.
+        result = pthread_mutex_trylock(mutex);
+        if (result == EBUSY) {
+            startUs = UtilTrace_GetTimeUs();
+            result = pthread_mutex_lock(mutex);
+            UtilTrace_Complete(UTIL_TRACE_CATEGORY_MUTEX, "mutex wait", startUs, "mutex", (uintptr_t) mutex);
+        }
+        if (result == 0) {
+            Osal_TraceMutexHoldBegin(mutex);
+        }
+    } else {
+        result = pthread_mutex_lock(mutex);
+    }
     if (result != 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
@@ -174,6 +235,10 @@ T_ZiyanReturnCode Osal_MutexUnlock(T_ZiyanMutexHandle mutex)
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
+    if (s_mutexHoldCount != 0) {
+        Osal_TraceMutexHoldEnd(mutex);
+    }
+
     result = pthread_mutex_unlock(mutex);
     if (result != 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
@@ -236,8 +301,19 @@ T_ZiyanReturnCode Osal_SemaphoreDestroy(T_ZiyanSemaHandle semaphore)
 T_ZiyanReturnCode Osal_SemaphoreWait(T_ZiyanSemaHandle semaphore)
 {
     int result;
-
-    result = sem_wait(semaphore);
+    uint64_t startUs;
+
+    if (UTIL_TRACE_IS_ENABLED()) {
+        result = sem_trywait(semaphore);
+        if (result != 0) {
+            startUs = UtilTrace_GetTimeUs();
+            result = sem_wait(semaphore);
+            UtilTrace_Complete(UTIL_TRACE_CATEGORY_SEMAPHORE, "semaphore wait", startUs, "semaphore",
+                               (uintptr_t) semaphore);
+        }
+    } else {
+        result = sem_wait(semaphore);
+    }
     if (result != 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
@@ -256,6 +332,7 @@ T_ZiyanReturnCode Osal_SemaphoreTimedWait(T_ZiyanSemaHandle semaphore, uint32_t
     int result;
     struct timespec semaphoreWaitTime;
     struct timeval systemTime;
+    uint64_t startUs;
 
     gettimeofday(&systemTime, NULL);
 
@@ -268,7 +345,17 @@ T_ZiyanReturnCode Osal_SemaphoreTimedWait(T_ZiyanSemaHandle semaphore, uint32_t
     semaphoreWaitTime.tv_sec = systemTime.tv_sec;
     semaphoreWaitTime.tv_nsec = systemTime.tv_usec * 1000;
 
-    result = sem_timedwait(semaphore, &semaphoreWaitTime);
+    if (UTIL_TRACE_IS_ENABLED()) {
+        result = sem_trywait(semaphore);
+        if (result != 0) {
+            startUs = UtilTrace_GetTimeUs();
+            result = sem_timedwait(semaphore, &semaphoreWaitTime);
+            UtilTrace_Complete(UTIL_TRACE_CATEGORY_SEMAPHORE, "semaphore wait", startUs, "semaphore",
+                               (uintptr_t) semaphore);
+        }
+    } else {
+        result = sem_timedwait(semaphore, &semaphoreWaitTime);
+    }
     if (result != 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
@@ -285,6 +372,10 @@ T_ZiyanReturnCode Osal_SemaphorePost(T_ZiyanSemaHandle semaphore)
 {
     int result;
 
+    if (UTIL_TRACE_IS_ENABLED()) {
+        UtilTrace_Instant(UTIL_TRACE_CATEGORY_SEMAPHORE, "semaphore post", "semaphore", (uintptr_t) semaphore);
+    }
+
     result = sem_post(semaphore);
     if (result != 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
@@ -323,9 +414,9 @@ T_ZiyanReturnCode Osal_GetTimeUs(uint64_t *us)
 
     if (s_localTimeUsOffset == 0) {
         s_localTimeUsOffset = *us;
-        *us = *us - s_localTimeMsOffset;
+        *us = *us - s_localTimeUsOffset;
     } else {
-        *us = *us - s_localTimeMsOffset;
+        *us = *us - s_localTimeUsOffset;
     }
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
@@ -341,12 +432,72 @@ T_ZiyanReturnCode Osal_GetRandomNum(uint16_t *randomNum)
 
 void *Osal_Malloc(uint32_t size)
 {
-    return malloc(size);
+    void *ptr = malloc(size);
+
+    UtilMetrics_CounterAdd(&s_mallocCount, 1);
+    UtilMetrics_CounterAdd(&s_mallocBytes, size);
+    if (ptr == NULL) {
+        UtilMetrics_CounterAdd(&s_mallocFailCount, 1);
+    }
+
+    return ptr;
 }
 
 void Osal_Free(void *ptr)
 {
+    if (ptr != NULL) {
+        UtilMetrics_CounterAdd(&s_freeCount, 1);
+    }
     free(ptr);
 }
 
+/* Private functions definition-----------------------------------------------*/
+static void *Osal_TaskStart(void *arg)
+{
+    T_OsalTaskStart taskStart = *(T_OsalTaskStart *) arg;
+
+    free(arg);
+
+    UtilTrace_SetThreadName(taskStart.name);
+    if (UTIL_TRACE_IS_ENABLED()) {
+        UtilTrace_Instant(UTIL_TRACE_CATEGORY_TASK, "task start", NULL, 0);
+    }
+
+    return taskStart.taskFunc(taskStart.arg);
+}
+
+static void Osal_TraceMutexHoldBegin(T_ZiyanMutexHandle mutex)
+{
+    if (s_mutexHoldCount >= OSAL_TRACE_MUTEX_HOLD_DEPTH) {
+        return;
+    }
+
+    s_mutexHold[s_mutexHoldCount].mutex = mutex;
+    s_mutexHold[s_mutexHoldCount].startUs = UtilTrace_GetTimeUs();
+    s_mutexHoldCount++;
+}
+
+static void Osal_TraceMutexHoldEnd(T_ZiyanMutexHandle mutex)
+{
+    uint64_t holdUs;
+    int i;
+
+    // Mutexes are mostly released in the reverse order, searched from the last one locked.
+    for (i = s_mutexHoldCount - 1; i >= 0; i--) {
+        if (s_mutexHold[i].mutex != mutex) {
+            continue;
+        }
+
+        holdUs = UtilTrace_GetTimeUs() - s_mutexHold[i].startUs;
+        if (UTIL_TRACE_IS_ENABLED() && holdUs >= OSAL_TRACE_MUTEX_HOLD_MIN_US) {
+            UtilTrace_Complete(UTIL_TRACE_CATEGORY_MUTEX, "mutex hold", s_mutexHold[i].startUs, "mutex",
+                               (uintptr_t) mutex);
+        }
+
+        s_mutexHoldCount--;
+        memmove(&s_mutexHold[i], &s_mutexHold[i + 1], (s_mutexHoldCount - i) * sizeof(T_OsalMutexHold));
+        break;
+    }
+}
+
 /****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,883 @@
+/**
+ ********************************************************************
+ * @file    osal_aio.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#define _FILE_OFFSET_BITS 64
+
+#include "osal_aio.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+/* Private constants ---------------------------------------------------------*/
+// IORING_FEAT_FAST_POLL marks headers new enough (5.7) to know every opcode used below.
+#if defined(IORING_FEAT_FAST_POLL) && defined(__NR_io_uring_setup)
+#define OSAL_AIO_IO_URING_ENABLE            1
+#else
+#define OSAL_AIO_IO_URING_ENABLE            0
+#endif
+
+#define OSAL_AIO_WORKER_NUM_MAX             4
+#define OSAL_AIO_PROBE_OP_NUM               256
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    void *userData;
+    uint64_t submitTimeUs;
+} T_OsalAioSlot;
+
+typedef struct {
+    uint16_t slotIndex;
+    int32_t result;
+} T_OsalAioDone;
+
+#if OSAL_AIO_IO_URING_ENABLE
+typedef struct {
+    int ringFd;
+    void *sqRingPtr;
+    size_t sqRingSize;
+    void *cqRingPtr;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    uint32_t *sqHead;
+    uint32_t *sqTail;
+    uint32_t *sqMask;
+    uint32_t *sqArray;
+    uint32_t *cqHead;
+    uint32_t *cqTail;
+    uint32_t *cqMask;
+    struct io_uring_cqe *cqes;
+    uint32_t sqLocalTail;
+} T_OsalAioUring;
+#endif
+
+typedef struct {
+    pthread_t workers[OSAL_AIO_WORKER_NUM_MAX];
+    uint8_t workerCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t submitCond;
+    pthread_cond_t completeCond;
+    bool isExit;
+    T_OsalAioRequest *requests;
+    uint16_t *submitQueue;
+    uint32_t submitHead;
+    uint32_t submitCount;
+    T_OsalAioDone *doneQueue;
+    uint32_t doneHead;
+    uint32_t doneCount;
+} T_OsalAioThreadPool;
+
+typedef struct {
+    E_OsalAioBackend backend;
+    uint32_t queueDepth;
+    T_OsalAioSlot *slots;
+    uint16_t *freeSlots;
+    uint32_t freeSlotCount;
+    uint16_t *preparedSlots;
+    uint32_t preparedCount;
+    T_OsalAioBuffer registeredBuffers[OSAL_AIO_REGISTERED_BUFFER_MAX];
+    uint16_t registeredBufferCount;
+    T_OsalAioStatistics statistics;
+#if OSAL_AIO_IO_URING_ENABLE
+    T_OsalAioUring uring;
+#endif
+    T_OsalAioThreadPool pool;
+} T_OsalAio;
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static T_ZiyanReturnCode Osal_AioCreateEngine(uint32_t queueDepth, bool isUringAllowed, bool isPoolAllowed,
+                                              T_OsalAioHandle *handle);
+static uint64_t Osal_AioGetMonotonicUs(void);
+static bool Osal_AioIsRequestValid(const T_OsalAio *aio, const T_OsalAioRequest *request);
+static void Osal_AioCompleteSlot(T_OsalAio *aio, uint16_t slotIndex, int32_t result, T_OsalAioCompletion *completion,
+                                 uint64_t nowUs);
+
+#if OSAL_AIO_IO_URING_ENABLE
+static T_ZiyanReturnCode Osal_AioUringInit(T_OsalAio *aio);
+static void Osal_AioUringDeInit(T_OsalAio *aio);
+static void Osal_AioUringPrepare(T_OsalAio *aio, const T_OsalAioRequest *request, uint16_t slotIndex);
+static T_ZiyanReturnCode Osal_AioUringSubmit(T_OsalAio *aio);
+static T_ZiyanReturnCode Osal_AioUringReap(T_OsalAio *aio, T_OsalAioCompletion *completions, uint32_t maxCount,
+                                           uint32_t minCount, uint32_t timeoutMs, uint32_t *count);
+#endif
+
+static T_ZiyanReturnCode Osal_AioPoolInit(T_OsalAio *aio);
+static void Osal_AioPoolDeInit(T_OsalAio *aio);
+static T_ZiyanReturnCode Osal_AioPoolSubmit(T_OsalAio *aio);
+static T_ZiyanReturnCode Osal_AioPoolReap(T_OsalAio *aio, T_OsalAioCompletion *completions, uint32_t maxCount,
+                                          uint32_t minCount, uint32_t timeoutMs, uint32_t *count);
+static void *Osal_AioPoolWorkerTask(void *arg);
+static int32_t Osal_AioExecute(const T_OsalAioRequest *request);
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode Osal_AioCreate(uint32_t queueDepth, T_OsalAioHandle *handle)
+{
+    return Osal_AioCreateEngine(queueDepth, true, true, handle);
+}
+
+T_ZiyanReturnCode Osal_AioCreateOnBackend(E_OsalAioBackend backend, uint32_t queueDepth, T_OsalAioHandle *handle)
+{
+    if (backend != OSAL_AIO_BACKEND_IO_URING && backend != OSAL_AIO_BACKEND_THREAD_POOL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    return Osal_AioCreateEngine(queueDepth, backend == OSAL_AIO_BACKEND_IO_URING,
+                                backend == OSAL_AIO_BACKEND_THREAD_POOL, handle);
+}
+
+T_ZiyanReturnCode Osal_AioDestroy(T_OsalAioHandle handle)
+{
+    T_OsalAio *aio = (T_OsalAio *) handle;
+
+    if (aio == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+#if OSAL_AIO_IO_URING_ENABLE
+    if (aio->backend == OSAL_AIO_BACKEND_IO_URING) {
+        Osal_AioUringDeInit(aio);
+    }
+#endif
+    if (aio->backend == OSAL_AIO_BACKEND_THREAD_POOL) {
+        Osal_AioPoolDeInit(aio);
+    }
+
+    free(aio->slots);
+    free(aio->freeSlots);
+    free(aio->preparedSlots);
+    free(aio);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode Osal_AioRegisterBuffers(T_OsalAioHandle handle, const T_OsalAioBuffer *buffers, uint16_t count)
+{
+    T_OsalAio *aio = (T_OsalAio *) handle;
+    uint16_t i;
+
+    if (aio == NULL || buffers == NULL || count == 0 || count > OSAL_AIO_REGISTERED_BUFFER_MAX) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (aio->registeredBufferCount != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+#if OSAL_AIO_IO_URING_ENABLE
+    if (aio->backend == OSAL_AIO_BACKEND_IO_URING) {
+        struct iovec iov[OSAL_AIO_REGISTERED_BUFFER_MAX];
+
+        for (i = 0; i < count; i++) {
+            iov[i].iov_base = buffers[i].buf;
+            iov[i].iov_len = buffers[i].len;
+        }
+
+        if (syscall(__NR_io_uring_register, aio->uring.ringFd, IORING_REGISTER_BUFFERS, iov, count) < 0) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+    }
+#endif
+
+    for (i = 0; i < count; i++) {
+        aio->registeredBuffers[i] = buffers[i];
+    }
+    aio->registeredBufferCount = count;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode Osal_AioPrepare(T_OsalAioHandle handle, const T_OsalAioRequest *request)
+{
+    T_OsalAio *aio = (T_OsalAio *) handle;
+    uint16_t slotIndex;
+
+    if (aio == NULL || request == NULL || !Osal_AioIsRequestValid(aio, request)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (aio->freeSlotCount == 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    slotIndex = aio->freeSlots[--aio->freeSlotCount];
+    aio->slots[slotIndex].userData = request->userData;
+    aio->preparedSlots[aio->preparedCount++] = slotIndex;
+
+#if OSAL_AIO_IO_URING_ENABLE
+    if (aio->backend == OSAL_AIO_BACKEND_IO_URING) {
+        Osal_AioUringPrepare(aio, request, slotIndex);
+    }
+#endif
+    if (aio->backend == OSAL_AIO_BACKEND_THREAD_POOL) {
+        aio->pool.requests[slotIndex] = *request;
+    }
+
+    aio->statistics.inFlight++;
+    if (aio->statistics.inFlight > aio->statistics.maxInFlight) {
+        aio->statistics.maxInFlight = aio->statistics.inFlight;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode Osal_AioSubmit(T_OsalAioHandle handle, uint32_t *submitCount)
+{
+    T_OsalAio *aio = (T_OsalAio *) handle;
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    uint64_t nowUs;
+    uint32_t count;
+    uint32_t i;
+
+    if (aio == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    count = aio->preparedCount;
+    if (count == 0) {
+#if OSAL_AIO_IO_URING_ENABLE
+        // Entries the kernel did not take on the previous call are still in the ring, hand them over again.
+        if (aio->backend == OSAL_AIO_BACKEND_IO_URING) {
+            returnCode = Osal_AioUringSubmit(aio);
+        }
+#endif
+        goto out;
+    }
+
+    nowUs = Osal_AioGetMonotonicUs();
+    for (i = 0; i < count; i++) {
+        aio->slots[aio->preparedSlots[i]].submitTimeUs = nowUs;
+    }
+
+#if OSAL_AIO_IO_URING_ENABLE
+    if (aio->backend == OSAL_AIO_BACKEND_IO_URING) {
+        returnCode = Osal_AioUringSubmit(aio);
+    }
+#endif
+    if (aio->backend == OSAL_AIO_BACKEND_THREAD_POOL) {
+        returnCode = Osal_AioPoolSubmit(aio);
+    }
+
+    aio->preparedCount = 0;
+    aio->statistics.submitCount += count;
+    aio->statistics.submitCallCount++;
+
+out:
+    if (submitCount != NULL) {
+        *submitCount = count;
+    }
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode Osal_AioReap(T_OsalAioHandle handle, T_OsalAioCompletion *completions, uint32_t maxCount,
+                               uint32_t minCount, uint32_t timeoutMs, uint32_t *count)
+{
+    T_OsalAio *aio = (T_OsalAio *) handle;
+
+    if (aio == NULL || completions == NULL || count == NULL || maxCount == 0 || minCount > maxCount) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    *count = 0;
+
+#if OSAL_AIO_IO_URING_ENABLE
+    if (aio->backend == OSAL_AIO_BACKEND_IO_URING) {
+        return Osal_AioUringReap(aio, completions, maxCount, minCount, timeoutMs, count);
+    }
+#endif
+
+    return Osal_AioPoolReap(aio, completions, maxCount, minCount, timeoutMs, count);
+}
+
+T_ZiyanReturnCode Osal_AioGetStatistics(T_OsalAioHandle handle, T_OsalAioStatistics *statistics)
+{
+    T_OsalAio *aio = (T_OsalAio *) handle;
+
+    if (aio == NULL || statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    *statistics = aio->statistics;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_ZiyanReturnCode Osal_AioCreateEngine(uint32_t queueDepth, bool isUringAllowed, bool isPoolAllowed,
+                                              T_OsalAioHandle *handle)
+{
+    T_OsalAio *aio;
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT;
+    uint32_t i;
+
+    if (handle == NULL || queueDepth == 0 || queueDepth > OSAL_AIO_QUEUE_DEPTH_MAX) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    aio = calloc(1, sizeof(T_OsalAio));
+    if (aio == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    aio->queueDepth = queueDepth;
+    aio->slots = calloc(queueDepth, sizeof(T_OsalAioSlot));
+    aio->freeSlots = calloc(queueDepth, sizeof(uint16_t));
+    aio->preparedSlots = calloc(queueDepth, sizeof(uint16_t));
+    if (aio->slots == NULL || aio->freeSlots == NULL || aio->preparedSlots == NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    for (i = 0; i < queueDepth; i++) {
+        aio->freeSlots[i] = (uint16_t) (queueDepth - 1 - i);
+    }
+    aio->freeSlotCount = queueDepth;
+
+#if OSAL_AIO_IO_URING_ENABLE
+    if (isUringAllowed) {
+        returnCode = Osal_AioUringInit(aio);
+        if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            aio->backend = OSAL_AIO_BACKEND_IO_URING;
+        }
+    }
+#else
+    (void) isUringAllowed;
+#endif
+
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS && isPoolAllowed) {
+        returnCode = Osal_AioPoolInit(aio);
+        if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            aio->backend = OSAL_AIO_BACKEND_THREAD_POOL;
+        }
+    }
+
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    aio->statistics.backend = aio->backend;
+    aio->statistics.queueDepth = queueDepth;
+    *handle = aio;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    free(aio->slots);
+    free(aio->freeSlots);
+    free(aio->preparedSlots);
+    free(aio);
+
+    return returnCode;
+}
+
+static uint64_t Osal_AioGetMonotonicUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+static bool Osal_AioIsRequestValid(const T_OsalAio *aio, const T_OsalAioRequest *request)
+{
+    const T_OsalAioBuffer *buffer;
+
+    switch (request->type) {
+        case OSAL_AIO_OP_READ:
+        case OSAL_AIO_OP_WRITE:
+            if (request->buf == NULL || request->len == 0) {
+                return false;
+            }
+            if (request->bufIndex == OSAL_AIO_BUFFER_INDEX_NONE) {
+                return true;
+            }
+            if (request->bufIndex < 0 || request->bufIndex >= aio->registeredBufferCount) {
+                return false;
+            }
+            buffer = &aio->registeredBuffers[request->bufIndex];
+            return request->buf >= buffer->buf && request->buf + request->len <= buffer->buf + buffer->len;
+        case OSAL_AIO_OP_FSYNC:
+        case OSAL_AIO_OP_FDATASYNC:
+            return request->fd >= 0;
+        case OSAL_AIO_OP_OPENAT:
+            return request->path != NULL;
+        default:
+            return false;
+    }
+}
+
+static void Osal_AioCompleteSlot(T_OsalAio *aio, uint16_t slotIndex, int32_t result, T_OsalAioCompletion *completion,
+                                 uint64_t nowUs)
+{
+    T_OsalAioSlot *slot = &aio->slots[slotIndex];
+    uint64_t latencyUs = nowUs - slot->submitTimeUs;
+
+    completion->userData = slot->userData;
+    completion->result = result;
+
+    aio->freeSlots[aio->freeSlotCount++] = slotIndex;
+    aio->statistics.inFlight--;
+    aio->statistics.completeCount++;
+    aio->statistics.totalLatencyUs += latencyUs;
+    if (latencyUs > aio->statistics.maxLatencyUs) {
+        aio->statistics.maxLatencyUs = latencyUs;
+    }
+}
+
+#if OSAL_AIO_IO_URING_ENABLE
+static T_ZiyanReturnCode Osal_AioUringInit(T_OsalAio *aio)
+{
+    T_OsalAioUring *uring = &aio->uring;
+    struct io_uring_params params;
+    struct io_uring_probe *probe;
+    const uint8_t requiredOps[] = {
+        IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC,
+        IORING_OP_OPENAT,
+    };
+    uint8_t *sqPtr;
+    uint8_t *cqPtr;
+    uint32_t i;
+
+    memset(&params, 0, sizeof(params));
+    memset(uring, 0, sizeof(T_OsalAioUring));
+
+    uring->ringFd = (int) syscall(__NR_io_uring_setup, aio->queueDepth, &params);
+    if (uring->ringFd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT;
+    }
+
+    probe = calloc(1, sizeof(struct io_uring_probe) + OSAL_AIO_PROBE_OP_NUM * sizeof(struct io_uring_probe_op));
+    if (probe == NULL) {
+        close(uring->ringFd);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    if (syscall(__NR_io_uring_register, uring->ringFd, IORING_REGISTER_PROBE, probe, OSAL_AIO_PROBE_OP_NUM) < 0) {
+        goto unsupported;
+    }
+
+    for (i = 0; i < sizeof(requiredOps); i++) {
+        if (requiredOps[i] > probe->last_op || !(probe->ops[requiredOps[i]].flags & IO_URING_OP_SUPPORTED)) {
+            goto unsupported;
+        }
+    }
+    free(probe);
+    probe = NULL;
+
+    uring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    uring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        uring->sqRingSize = uring->sqRingSize > uring->cqRingSize ? uring->sqRingSize : uring->cqRingSize;
+        uring->cqRingSize = uring->sqRingSize;
+    }
+
+    uring->sqRingPtr = mmap(NULL, uring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            uring->ringFd, IORING_OFF_SQ_RING);
+    if (uring->sqRingPtr == MAP_FAILED) {
+        goto unsupported;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        uring->cqRingPtr = uring->sqRingPtr;
+    } else {
+        uring->cqRingPtr = mmap(NULL, uring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                uring->ringFd, IORING_OFF_CQ_RING);
+        if (uring->cqRingPtr == MAP_FAILED) {
+            munmap(uring->sqRingPtr, uring->sqRingSize);
+            goto unsupported;
+        }
+    }
+
+    uring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       uring->ringFd, IORING_OFF_SQES);
+    if (uring->sqes == MAP_FAILED) {
+        if (uring->cqRingPtr != uring->sqRingPtr) {
+            munmap(uring->cqRingPtr, uring->cqRingSize);
+        }
+        munmap(uring->sqRingPtr, uring->sqRingSize);
+        goto unsupported;
+    }
+
+    sqPtr = uring->sqRingPtr;
+    cqPtr = uring->cqRingPtr;
+    uring->sqHead = (uint32_t *) (sqPtr + params.sq_off.head);
+    uring->sqTail = (uint32_t *) (sqPtr + params.sq_off.tail);
+    uring->sqMask = (uint32_t *) (sqPtr + params.sq_off.ring_mask);
+    uring->sqArray = (uint32_t *) (sqPtr + params.sq_off.array);
+    uring->cqHead = (uint32_t *) (cqPtr + params.cq_off.head);
+    uring->cqTail = (uint32_t *) (cqPtr + params.cq_off.tail);
+    uring->cqMask = (uint32_t *) (cqPtr + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *) (cqPtr + params.cq_off.cqes);
+    uring->sqLocalTail = *uring->sqTail;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+unsupported:
+    free(probe);
+    close(uring->ringFd);
+    uring->ringFd = -1;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT;
+}
+
+static void Osal_AioUringDeInit(T_OsalAio *aio)
+{
+    T_OsalAioUring *uring = &aio->uring;
+
+    munmap(uring->sqes, uring->sqesSize);
+    if (uring->cqRingPtr != uring->sqRingPtr) {
+        munmap(uring->cqRingPtr, uring->cqRingSize);
+    }
+    munmap(uring->sqRingPtr, uring->sqRingSize);
+    close(uring->ringFd);
+}
+
+static void Osal_AioUringPrepare(T_OsalAio *aio, const T_OsalAioRequest *request, uint16_t slotIndex)
+{
+    T_OsalAioUring *uring = &aio->uring;
+    uint32_t index = uring->sqLocalTail & *uring->sqMask;
+    struct io_uring_sqe *sqe = &uring->sqes[index];
+    bool isFixed = request->bufIndex != OSAL_AIO_BUFFER_INDEX_NONE;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->fd = request->fd;
+    sqe->user_data = slotIndex;
+
+    switch (request->type) {
+        case OSAL_AIO_OP_READ:
+            sqe->opcode = isFixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            sqe->off = request->offset;
+            sqe->addr = (uint64_t) (uintptr_t) request->buf;
+            sqe->len = request->len;
+            sqe->buf_index = isFixed ? (uint16_t) request->bufIndex : 0;
+            break;
+        case OSAL_AIO_OP_WRITE:
+            sqe->opcode = isFixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe->off = request->offset;
+            sqe->addr = (uint64_t) (uintptr_t) request->buf;
+            sqe->len = request->len;
+            sqe->buf_index = isFixed ? (uint16_t) request->bufIndex : 0;
+            break;
+        case OSAL_AIO_OP_FSYNC:
+            sqe->opcode = IORING_OP_FSYNC;
+            break;
+        case OSAL_AIO_OP_FDATASYNC:
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            break;
+        case OSAL_AIO_OP_OPENAT:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->addr = (uint64_t) (uintptr_t) request->path;
+            sqe->len = request->mode;
+            sqe->open_flags = (uint32_t) request->flags;
+            break;
+    }
+
+    uring->sqArray[index] = index;
+    uring->sqLocalTail++;
+}
+
+static T_ZiyanReturnCode Osal_AioUringSubmit(T_OsalAio *aio)
+{
+    T_OsalAioUring *uring = &aio->uring;
+    uint32_t pending;
+    long ret;
+
+    // Publish the whole batch with one store, then hand it to the kernel with one syscall.
+    __atomic_store_n(uring->sqTail, uring->sqLocalTail, __ATOMIC_RELEASE);
+    pending = uring->sqLocalTail - __atomic_load_n(uring->sqHead, __ATOMIC_ACQUIRE);
+
+    while (pending > 0) {
+        ret = syscall(__NR_io_uring_enter, uring->ringFd, pending, 0, 0, NULL, 0);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            return errno == EAGAIN || errno == EBUSY ? ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY
+                                                     : ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        pending -= (uint32_t) ret;
+        if (ret == 0) {
+            break;
+        }
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode Osal_AioUringReap(T_OsalAio *aio, T_OsalAioCompletion *completions, uint32_t maxCount,
+                                           uint32_t minCount, uint32_t timeoutMs, uint32_t *count)
+{
+    T_OsalAioUring *uring = &aio->uring;
+    uint64_t deadlineUs = Osal_AioGetMonotonicUs() + (uint64_t) timeoutMs * 1000;
+    struct pollfd pfd = {.fd = uring->ringFd, .events = POLLIN};
+    struct io_uring_cqe *cqe;
+    uint32_t head;
+    uint32_t tail;
+    uint64_t nowUs;
+    int ret;
+
+    for (;;) {
+        head = *uring->cqHead;
+        tail = __atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE);
+        nowUs = Osal_AioGetMonotonicUs();
+
+        while (head != tail && *count < maxCount) {
+            cqe = &uring->cqes[head & *uring->cqMask];
+            Osal_AioCompleteSlot(aio, (uint16_t) cqe->user_data, cqe->res, &completions[*count], nowUs);
+            (*count)++;
+            head++;
+        }
+        __atomic_store_n(uring->cqHead, head, __ATOMIC_RELEASE);
+
+        if (*count >= minCount) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
+
+        if (nowUs >= deadlineUs) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+        }
+
+        ret = poll(&pfd, 1, (int) ((deadlineUs - nowUs + 999) / 1000));
+        if (ret < 0 && errno != EINTR) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+    }
+}
+#endif
+
+static T_ZiyanReturnCode Osal_AioPoolInit(T_OsalAio *aio)
+{
+    T_OsalAioThreadPool *pool = &aio->pool;
+    pthread_condattr_t condAttr;
+    char name[16];
+    uint8_t i;
+
+    memset(pool, 0, sizeof(T_OsalAioThreadPool));
+    pool->requests = calloc(aio->queueDepth, sizeof(T_OsalAioRequest));
+    pool->submitQueue = calloc(aio->queueDepth, sizeof(uint16_t));
+    pool->doneQueue = calloc(aio->queueDepth, sizeof(T_OsalAioDone));
+    if (pool->requests == NULL || pool->submitQueue == NULL || pool->doneQueue == NULL) {
+        goto out;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pool->submitCond, &condAttr);
+    pthread_cond_init(&pool->completeCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    for (i = 0; i < OSAL_AIO_WORKER_NUM_MAX && i < aio->queueDepth; i++) {
+        if (pthread_create(&pool->workers[i], NULL, Osal_AioPoolWorkerTask, aio) != 0) {
+            break;
+        }
+        snprintf(name, sizeof(name), "osal_aio_%d", i);
+        pthread_setname_np(pool->workers[i], name);
+        pool->workerCount++;
+    }
+
+    if (pool->workerCount == 0) {
+        pthread_cond_destroy(&pool->submitCond);
+        pthread_cond_destroy(&pool->completeCond);
+        pthread_mutex_destroy(&pool->mutex);
+        goto out;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    free(pool->requests);
+    free(pool->submitQueue);
+    free(pool->doneQueue);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+}
+
+static void Osal_AioPoolDeInit(T_OsalAio *aio)
+{
+    T_OsalAioThreadPool *pool = &aio->pool;
+    uint8_t i;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->isExit = true;
+    pthread_cond_broadcast(&pool->submitCond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->workerCount; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->submitCond);
+    pthread_cond_destroy(&pool->completeCond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->requests);
+    free(pool->submitQueue);
+    free(pool->doneQueue);
+}
+
+static T_ZiyanReturnCode Osal_AioPoolSubmit(T_OsalAio *aio)
+{
+    T_OsalAioThreadPool *pool = &aio->pool;
+    uint32_t i;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (i = 0; i < aio->preparedCount; i++) {
+        pool->submitQueue[(pool->submitHead + pool->submitCount) % aio->queueDepth] = aio->preparedSlots[i];
+        pool->submitCount++;
+    }
+    pthread_cond_broadcast(&pool->submitCond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode Osal_AioPoolReap(T_OsalAio *aio, T_OsalAioCompletion *completions, uint32_t maxCount,
+                                          uint32_t minCount, uint32_t timeoutMs, uint32_t *count)
+{
+    T_OsalAioThreadPool *pool = &aio->pool;
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    T_OsalAioDone *done;
+    struct timespec deadline;
+    uint64_t nowUs;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long) (timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        nowUs = Osal_AioGetMonotonicUs();
+        while (pool->doneCount > 0 && *count < maxCount) {
+            done = &pool->doneQueue[pool->doneHead];
+            Osal_AioCompleteSlot(aio, done->slotIndex, done->result, &completions[*count], nowUs);
+            pool->doneHead = (pool->doneHead + 1) % aio->queueDepth;
+            pool->doneCount--;
+            (*count)++;
+        }
+
+        if (*count >= minCount) {
+            break;
+        }
+
+        if (pthread_cond_timedwait(&pool->completeCond, &pool->mutex, &deadline) == ETIMEDOUT &&
+            pool->doneCount == 0) {
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return returnCode;
+}
+
+static void *Osal_AioPoolWorkerTask(void *arg)
+{
+    T_OsalAio *aio = (T_OsalAio *) arg;
+    T_OsalAioThreadPool *pool = &aio->pool;
+    T_OsalAioRequest request;
+    uint16_t slotIndex;
+    int32_t result;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->isExit) {
+        if (pool->submitCount == 0) {
+            pthread_cond_wait(&pool->submitCond, &pool->mutex);
+            continue;
+        }
+
+        slotIndex = pool->submitQueue[pool->submitHead];
+        pool->submitHead = (pool->submitHead + 1) % aio->queueDepth;
+        pool->submitCount--;
+        request = pool->requests[slotIndex];
+        pthread_mutex_unlock(&pool->mutex);
+
+        result = Osal_AioExecute(&request);
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->doneQueue[(pool->doneHead + pool->doneCount) % aio->queueDepth].slotIndex = slotIndex;
+        pool->doneQueue[(pool->doneHead + pool->doneCount) % aio->queueDepth].result = result;
+        pool->doneCount++;
+        pthread_cond_signal(&pool->completeCond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static int32_t Osal_AioExecute(const T_OsalAioRequest *request)
+{
+    ssize_t ret;
+
+    do {
+        switch (request->type) {
+            case OSAL_AIO_OP_READ:
+                ret = pread(request->fd, request->buf, request->len, (off_t) request->offset);
+                break;
+            case OSAL_AIO_OP_WRITE:
+                ret = pwrite(request->fd, request->buf, request->len, (off_t) request->offset);
+                break;
+            case OSAL_AIO_OP_FSYNC:
+                ret = fsync(request->fd);
+                break;
+            case OSAL_AIO_OP_FDATASYNC:
+                ret = fdatasync(request->fd);
+                break;
+            case OSAL_AIO_OP_OPENAT:
+                ret = openat(request->fd, request->path, request->flags, request->mode);
+                break;
+            default:
+                errno = EINVAL;
+                ret = -1;
+                break;
+        }
+    } while (ret < 0 && errno == EINTR);
+
+    return ret < 0 ? -errno : (int32_t) ret;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
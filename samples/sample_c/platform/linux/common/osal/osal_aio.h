@@ -0,0 +1,153 @@
+/**
+ ********************************************************************
+ * @file    osal_aio.h
+ * @brief   This is the header file for "osal_aio.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef OSAL_AIO_H
+#define OSAL_AIO_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <sys/types.h>
+#include "ziyan_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define OSAL_AIO_QUEUE_DEPTH_MAX            256
+#define OSAL_AIO_REGISTERED_BUFFER_MAX      16
+#define OSAL_AIO_BUFFER_INDEX_NONE          (-1)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    OSAL_AIO_BACKEND_IO_URING = 0,
+    OSAL_AIO_BACKEND_THREAD_POOL = 1,
+} E_OsalAioBackend;
+
+typedef enum {
+    OSAL_AIO_OP_READ = 0,
+    OSAL_AIO_OP_WRITE = 1,
+    OSAL_AIO_OP_FSYNC = 2,
+    OSAL_AIO_OP_FDATASYNC = 3,
+    OSAL_AIO_OP_OPENAT = 4,
+} E_OsalAioOpType;
+
+typedef struct {
+    E_OsalAioOpType type;
+    int fd; /*!< File descriptor, or the directory descriptor (e.g. AT_FDCWD) for OSAL_AIO_OP_OPENAT. */
+    uint64_t offset;
+    uint8_t *buf; /*!< Must lie inside the registered buffer when bufIndex is not OSAL_AIO_BUFFER_INDEX_NONE. */
+    uint32_t len;
+    int16_t bufIndex;
+    const char *path; /*!< Must stay valid until the request completes. */
+    int flags;
+    mode_t mode;
+    void *userData;
+} T_OsalAioRequest;
+
+typedef struct {
+    void *userData;
+    int32_t result; /*!< Transferred bytes, opened fd, 0, or -errno on failure. */
+} T_OsalAioCompletion;
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t len;
+} T_OsalAioBuffer;
+
+typedef struct {
+    E_OsalAioBackend backend;
+    uint32_t queueDepth;
+    uint32_t inFlight;
+    uint32_t maxInFlight;
+    uint64_t submitCount;
+    uint64_t submitCallCount;
+    uint64_t completeCount;
+    uint64_t totalLatencyUs;
+    uint64_t maxLatencyUs;
+} T_OsalAioStatistics;
+
+typedef void *T_OsalAioHandle;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Create an asynchronous file I/O engine. io_uring is used when both the build headers and the running kernel
+ * support it, otherwise the requests are served by a pool of worker threads with the same semantics. An engine is
+ * owned by one thread; create one engine per thread that issues I/O.
+ * @param queueDepth: max number of requests prepared or in flight at the same time.
+ * @param handle: pointer to the created engine.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode Osal_AioCreate(uint32_t queueDepth, T_OsalAioHandle *handle);
+
+/**
+ * @brief Create an asynchronous file I/O engine on the given backend instead of the best available one, e.g. to
+ * compare the backends against each other.
+ * @param backend: backend to use.
+ * @param queueDepth: max number of requests prepared or in flight at the same time.
+ * @param handle: pointer to the created engine.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT when the backend is not available.
+ */
+T_ZiyanReturnCode Osal_AioCreateOnBackend(E_OsalAioBackend backend, uint32_t queueDepth, T_OsalAioHandle *handle);
+T_ZiyanReturnCode Osal_AioDestroy(T_OsalAioHandle handle);
+
+/**
+ * @brief Register long-lived buffers, e.g. the media download or recording buffers, so that the kernel does not
+ * have to map them for every request. Can be called once per engine.
+ */
+T_ZiyanReturnCode Osal_AioRegisterBuffers(T_OsalAioHandle handle, const T_OsalAioBuffer *buffers, uint16_t count);
+
+/**
+ * @brief Queue a request without entering the kernel. Requests are handed over in one batch by Osal_AioSubmit().
+ * @return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY when the queue depth is exhausted.
+ */
+T_ZiyanReturnCode Osal_AioPrepare(T_OsalAioHandle handle, const T_OsalAioRequest *request);
+
+/**
+ * @brief Hand the prepared requests over to the backend. Requests the kernel did not accept, e.g. on
+ * ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY, stay queued and are handed over again by the next call.
+ */
+T_ZiyanReturnCode Osal_AioSubmit(T_OsalAioHandle handle, uint32_t *submitCount);
+
+/**
+ * @brief Reap completed requests.
+ * @param completions: buffer for completions.
+ * @param maxCount: capacity of the completion buffer.
+ * @param minCount: number of completions to wait for, 0 to only poll.
+ * @param timeoutMs: max time to wait for minCount completions.
+ * @param count: number of completions returned.
+ * @return ZIYAN_ERROR_SYSTEM_MODULE_CODE_TIMEOUT when less than minCount completions arrived in time.
+ */
+T_ZiyanReturnCode Osal_AioReap(T_OsalAioHandle handle, T_OsalAioCompletion *completions, uint32_t maxCount,
+                               uint32_t minCount, uint32_t timeoutMs, uint32_t *count);
+
+T_ZiyanReturnCode Osal_AioGetStatistics(T_OsalAioHandle handle, T_OsalAioStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OSAL_AIO_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
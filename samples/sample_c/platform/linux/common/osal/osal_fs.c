@@ -23,25 +23,60 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+// Files over 4 GB, usual for 4K recordings, also open and stat on 32-bit targets.
+#define _FILE_OFFSET_BITS 64
+
 #include "osal_fs.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "unistd.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <dirent.h>
 #include "time.h"
+#include "utils/util_trace.h"
 
 /* Private constants ---------------------------------------------------------*/
+#define OSAL_FS_DIR_READ_BUFFER_SIZE            (64 * 1024)
+
+// statx() is exported by glibc 2.28 and later, older C libraries fall back to fstatat().
+#if defined(STATX_TYPE) && defined(AT_STATX_DONT_SYNC)
+#define OSAL_FS_STATX_ENABLE                    1
+#else
+#define OSAL_FS_STATX_ENABLE                    0
+#endif
 
 /* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} T_OsalLinuxDirent64;
+
+typedef struct {
+    T_OsalDirList *dirList;
+    uint32_t readIndex;
+} T_OsalDir;
 
 /* Private values -------------------------------------------------------------*/
+static OsalDirListProviderFunc s_dirListProvider = NULL;
 
 /* Private functions declaration ---------------------------------------------*/
+static bool Osal_IsDirEntryAccepted(const char *name, uint16_t nameLen, const T_OsalDirFilter *filter);
+static int Osal_StatDirEntry(int dirFd, const char *name, T_OsalDirEntry *entry);
+static T_ZiyanReturnCode Osal_FillZiyanTime(time_t timeSec, T_ZiyanTime *ziyanTime);
 
 /* Exported functions definition ---------------------------------------------*/
 T_ZiyanReturnCode Osal_FileOpen(const char *fileName, const char *fileMode, T_ZiyanFileHandle *fileObj)
 {
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
+
     if (fileName == NULL || fileMode == NULL || fileObj == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
@@ -51,6 +86,10 @@ T_ZiyanReturnCode Osal_FileOpen(const char *fileName, const char *fileMode, T_Zi
         goto out;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_FILE, "file open", traceStartUs, NULL, 0);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 
 out:
@@ -78,6 +117,7 @@ T_ZiyanReturnCode Osal_FileClose(T_ZiyanFileHandle fileObj)
 T_ZiyanReturnCode Osal_FileWrite(T_ZiyanFileHandle fileObj, const uint8_t *buf, uint32_t len, uint32_t *realLen)
 {
     int32_t ret;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (fileObj == NULL || buf == NULL || len == 0 || realLen == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -90,12 +130,17 @@ T_ZiyanReturnCode Osal_FileWrite(T_ZiyanFileHandle fileObj, const uint8_t *buf,
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_FILE, "file write", traceStartUs, "bytes", *realLen);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 T_ZiyanReturnCode Osal_FileRead(T_ZiyanFileHandle fileObj, uint8_t *buf, uint32_t len, uint32_t *realLen)
 {
     int32_t ret;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (fileObj == NULL || buf == NULL || len == 0 || realLen == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -108,6 +153,10 @@ T_ZiyanReturnCode Osal_FileRead(T_ZiyanFileHandle fileObj, uint8_t *buf, uint32_
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_FILE, "file read", traceStartUs, "bytes", *realLen);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -145,53 +194,73 @@ T_ZiyanReturnCode Osal_FileSync(T_ZiyanFileHandle fileObj)
 
 T_ZiyanReturnCode Osal_DirOpen(const char *filePath, T_ZiyanDirHandle *dirObj)
 {
-    if (filePath == NULL) {
+    const T_OsalDirFilter filter = {.isIncludeDir = true, .isNeedStat = false};
+    OsalDirListProviderFunc provider = __atomic_load_n(&s_dirListProvider, __ATOMIC_ACQUIRE);
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    T_OsalDir *dir;
+
+    if (filePath == NULL || dirObj == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
-    *dirObj = opendir(filePath);
-    if (*dirObj == NULL) {
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    dir = calloc(1, sizeof(T_OsalDir));
+    if (dir == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    if (provider != NULL) {
+        returnCode = provider(filePath, &dir->dirList);
+    }
+
+    // The SDK stats the entries it keeps through Osal_Stat(), so only names and types are batched here.
+    if (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND) {
+        returnCode = Osal_DirListBulk(filePath, &filter, &dir->dirList);
+    }
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        free(dir);
+        return returnCode;
     }
 
+    *dirObj = dir;
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 T_ZiyanReturnCode Osal_DirClose(T_ZiyanDirHandle dirObj)
 {
-    int32_t ret;
+    T_OsalDir *dir = (T_OsalDir *) dirObj;
 
-    if (dirObj == NULL) {
+    if (dir == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
-    ret = closedir((DIR *) dirObj);
-    if (ret < 0) {
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-    }
+    Osal_DirListFree(dir->dirList);
+    free(dir);
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 T_ZiyanReturnCode Osal_DirRead(T_ZiyanDirHandle dirObj, T_ZiyanFileInfo *fileInfo)
 {
-    struct dirent *dirent;
+    T_OsalDir *dir = (T_OsalDir *) dirObj;
+    const T_OsalDirEntry *entry;
 
-    if (dirObj == NULL || fileInfo == NULL) {
+    if (dir == NULL || fileInfo == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
-    dirent = readdir((DIR *) dirObj);
-    if (!dirent) {
+    if (dir->readIndex >= dir->dirList->count) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    if (dirent->d_type == DT_DIR) {
-        fileInfo->isDir = true;
-    } else {
-        fileInfo->isDir = false;
+    entry = &dir->dirList->entries[dir->readIndex++];
+    fileInfo->isDir = entry->isDir;
+    memcpy(fileInfo->path, &dir->dirList->names[entry->nameOffset], entry->nameLen + 1);
+    if (entry->isStatValid) {
+        fileInfo->size = (uint32_t) entry->size;
+        Osal_FillZiyanTime((time_t) entry->modifyTimeSec, &fileInfo->createTime);
+        fileInfo->modifyTime = fileInfo->createTime;
     }
-    strcpy(fileInfo->path, dirent->d_name);
 
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
@@ -283,6 +352,239 @@ T_ZiyanReturnCode Osal_Stat(const char *filePath, T_ZiyanFileInfo *fileInfo)
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
+T_ZiyanReturnCode Osal_DirListBulk(const char *dirPath, const T_OsalDirFilter *filter, T_OsalDirList **dirList)
+{
+    const T_OsalDirFilter defaultFilter = {.isIncludeDir = true, .isNeedStat = true};
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    T_OsalLinuxDirent64 *dirent;
+    T_OsalDirEntry *entries = NULL;
+    T_OsalDirEntry *entry;
+    T_OsalDirList *list;
+    char *names = NULL;
+    char *buffer = NULL;
+    void *newMemory;
+    uint32_t entryCapacity = 0;
+    uint32_t nameCapacity = 0;
+    uint32_t entryCount = 0;
+    uint32_t nameSize = 0;
+    uint16_t nameLen;
+    long readLen;
+    long pos;
+    int dirFd;
+
+    if (dirPath == NULL || dirList == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (filter == NULL) {
+        filter = &defaultFilter;
+    }
+
+    dirFd = open(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    buffer = malloc(OSAL_FS_DIR_READ_BUFFER_SIZE);
+    if (buffer == NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    for (;;) {
+        readLen = syscall(SYS_getdents64, dirFd, buffer, OSAL_FS_DIR_READ_BUFFER_SIZE);
+        if (readLen < 0) {
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            goto out;
+        }
+        if (readLen == 0) {
+            break;
+        }
+
+        for (pos = 0; pos < readLen; pos += dirent->d_reclen) {
+            dirent = (T_OsalLinuxDirent64 *) (buffer + pos);
+            nameLen = (uint16_t) strlen(dirent->d_name);
+
+            if (dirent->d_type == DT_DIR && !filter->isIncludeDir) {
+                continue;
+            }
+            if (dirent->d_type != DT_DIR && dirent->d_type != DT_UNKNOWN &&
+                !Osal_IsDirEntryAccepted(dirent->d_name, nameLen, filter)) {
+                continue;
+            }
+
+            if (entryCount == entryCapacity) {
+                entryCapacity = entryCapacity == 0 ? 64 : entryCapacity * 2;
+                newMemory = realloc(entries, entryCapacity * sizeof(T_OsalDirEntry));
+                if (newMemory == NULL) {
+                    returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+                    goto out;
+                }
+                entries = newMemory;
+            }
+
+            if (nameSize + nameLen + 1 > nameCapacity) {
+                nameCapacity = nameCapacity == 0 ? 4096 : nameCapacity * 2;
+                while (nameSize + nameLen + 1 > nameCapacity) {
+                    nameCapacity *= 2;
+                }
+                newMemory = realloc(names, nameCapacity);
+                if (newMemory == NULL) {
+                    returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+                    goto out;
+                }
+                names = newMemory;
+            }
+
+            entry = &entries[entryCount];
+            memset(entry, 0, sizeof(T_OsalDirEntry));
+            entry->nameOffset = nameSize;
+            entry->nameLen = nameLen;
+            entry->isDir = dirent->d_type == DT_DIR;
+
+            // Entries without d_type (some FAT/NFS setups) need the stat to be classified at all.
+            if (filter->isNeedStat || dirent->d_type == DT_UNKNOWN) {
+                if (Osal_StatDirEntry(dirFd, dirent->d_name, entry) != 0) {
+                    continue;
+                }
+                if (dirent->d_type == DT_UNKNOWN &&
+                    ((entry->isDir && !filter->isIncludeDir) ||
+                     (!entry->isDir && !Osal_IsDirEntryAccepted(dirent->d_name, nameLen, filter)))) {
+                    continue;
+                }
+            }
+
+            memcpy(&names[nameSize], dirent->d_name, nameLen + 1);
+            nameSize += nameLen + 1;
+            entryCount++;
+        }
+    }
+
+    returnCode = Osal_DirListAlloc(entryCount, nameSize, &list);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    if (entryCount != 0) {
+        memcpy(list->entries, entries, entryCount * sizeof(T_OsalDirEntry));
+        memcpy(list->names, names, nameSize);
+    }
+
+    *dirList = list;
+
+out:
+    free(buffer);
+    free(entries);
+    free(names);
+    close(dirFd);
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode Osal_DirListFree(T_OsalDirList *dirList)
+{
+    if (dirList == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    free(dirList);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode Osal_DirListAlloc(uint32_t count, uint32_t nameSize, T_OsalDirList **dirList)
+{
+    T_OsalDirList *list;
+
+    if (dirList == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    list = malloc(sizeof(T_OsalDirList) + (size_t) count * sizeof(T_OsalDirEntry) + nameSize);
+    if (list == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    list->count = count;
+    list->entries = (T_OsalDirEntry *) (list + 1);
+    list->names = (char *) (list->entries + count);
+    *dirList = list;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode Osal_DirSetListProvider(OsalDirListProviderFunc provider)
+{
+    __atomic_store_n(&s_dirListProvider, provider, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
 /* Private functions definition-----------------------------------------------*/
+static bool Osal_IsDirEntryAccepted(const char *name, uint16_t nameLen, const T_OsalDirFilter *filter)
+{
+    size_t extensionLen;
+    uint8_t i;
+
+    if (filter->extensions == NULL || filter->extensionCount == 0) {
+        return true;
+    }
+
+    for (i = 0; i < filter->extensionCount; i++) {
+        extensionLen = strlen(filter->extensions[i]);
+        if (nameLen >= extensionLen && strcasecmp(&name[nameLen - extensionLen], filter->extensions[i]) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int Osal_StatDirEntry(int dirFd, const char *name, T_OsalDirEntry *entry)
+{
+#if OSAL_FS_STATX_ENABLE
+    struct statx stx;
+
+    if (statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_MTIME,
+              &stx) != 0) {
+        return -1;
+    }
+
+    entry->isDir = S_ISDIR(stx.stx_mode);
+    entry->size = stx.stx_size;
+    entry->modifyTimeSec = stx.stx_mtime.tv_sec;
+#else
+    struct stat st;
+
+    if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return -1;
+    }
+
+    entry->isDir = S_ISDIR(st.st_mode);
+    entry->size = (uint64_t) st.st_size;
+    entry->modifyTimeSec = st.st_mtim.tv_sec;
+#endif
+    entry->isStatValid = true;
+
+    return 0;
+}
+
+static T_ZiyanReturnCode Osal_FillZiyanTime(time_t timeSec, T_ZiyanTime *ziyanTime)
+{
+    struct tm fileTm;
+
+    if (localtime_r(&timeSec, &fileTm) == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    ziyanTime->year = fileTm.tm_year + 1900 - 1980;
+    ziyanTime->month = fileTm.tm_mon + 1;
+    ziyanTime->day = fileTm.tm_mday;
+    ziyanTime->hour = fileTm.tm_hour;
+    ziyanTime->minute = fileTm.tm_min;
+    ziyanTime->second = fileTm.tm_sec;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
 
 /****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -37,6 +37,36 @@ extern "C" {
 /* Exported constants --------------------------------------------------------*/
 
 /* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint64_t size;
+    int64_t modifyTimeSec;
+    uint32_t nameOffset; /*!< Offset of the NUL terminated name in T_OsalDirList.names. */
+    uint16_t nameLen;
+    bool isDir;
+    bool isStatValid; /*!< size and modifyTimeSec are only valid when the entry was stat-ed. */
+} T_OsalDirEntry;
+
+/* Packed result of Osal_DirListBulk(), entries in directory order, freed with a single Osal_DirListFree(). Lists of
+ * a directory list provider are allocated with Osal_DirListAlloc(). */
+typedef struct {
+    uint32_t count;
+    T_OsalDirEntry *entries;
+    char *names;
+} T_OsalDirList;
+
+typedef struct {
+    bool isIncludeDir;
+    bool isNeedStat;
+    const char *const *extensions; /*!< Case-insensitive suffixes such as ".jpg", NULL to accept every file. */
+    uint8_t extensionCount;
+} T_OsalDirFilter;
+
+/**
+ * @brief Serve the listing of a directory without reading it from the disk, such as from a catalog kept in memory.
+ * @return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND when the provider does not keep the directory, which is then read
+ * from the disk.
+ */
+typedef T_ZiyanReturnCode (*OsalDirListProviderFunc)(const char *dirPath, T_OsalDirList **dirList);
 
 /* Exported functions --------------------------------------------------------*/
 T_ZiyanReturnCode Osal_FileOpen(const char *fileName, const char *fileMode, T_ZiyanFileHandle *fileObj);
@@ -65,6 +95,31 @@ T_ZiyanReturnCode Osal_Rename(const char *oldFilePath, const char *newFilePath);
 
 T_ZiyanReturnCode Osal_Stat(const char *filePath, T_ZiyanFileInfo *fileInfo);
 
+/**
+ * @brief Enumerate a directory in one pass: entries are read in large getdents64 batches, filtered by d_type and
+ * extension before any metadata is fetched, and stat-ed with statx (AT_STATX_DONT_SYNC, only type/size/mtime)
+ * relative to the directory fd.
+ * @param dirPath: directory path.
+ * @param filter: entry filter, NULL to list every entry with metadata.
+ * @param dirList: pointer to the packed list, to be released by Osal_DirListFree().
+ * @return Execution result.
+ */
+T_ZiyanReturnCode Osal_DirListBulk(const char *dirPath, const T_OsalDirFilter *filter, T_OsalDirList **dirList);
+
+T_ZiyanReturnCode Osal_DirListFree(T_OsalDirList *dirList);
+
+/**
+ * @brief Allocate a list of count entries with nameSize bytes of names, for a directory list provider to fill.
+ */
+T_ZiyanReturnCode Osal_DirListAlloc(uint32_t count, uint32_t nameSize, T_OsalDirList **dirList);
+
+/**
+ * @brief Set the provider consulted by Osal_DirOpen() before reading a directory from the disk.
+ * @param provider: directory list provider, NULL to always read from the disk.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode Osal_DirSetListProvider(OsalDirListProviderFunc provider);
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,6 +29,8 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include "stdlib.h"
+#include "utils/util_metrics.h"
+#include "utils/util_trace.h"
 
 /* Private constants ---------------------------------------------------------*/
 #define SOCKET_RECV_BUF_MAX_SIZE    (1000 * 1000 * 10)
@@ -39,6 +41,14 @@ typedef struct {
 } T_SocketHandleStruct;
 
 /* Private values -------------------------------------------------------------*/
+static T_UtilMetric s_udpSendBytes = UTIL_METRICS_COUNTER("ziyan_transport_udp_send_bytes_total", "Bytes sent over UDP.");
+static T_UtilMetric s_udpRecvBytes = UTIL_METRICS_COUNTER("ziyan_transport_udp_recv_bytes_total",
+                                                          "Bytes received over UDP.");
+static T_UtilMetric s_tcpSendBytes = UTIL_METRICS_COUNTER("ziyan_transport_tcp_send_bytes_total", "Bytes sent over TCP.");
+static T_UtilMetric s_tcpRecvBytes = UTIL_METRICS_COUNTER("ziyan_transport_tcp_recv_bytes_total",
+                                                          "Bytes received over TCP.");
+static T_UtilMetric s_socketErrorCount = UTIL_METRICS_COUNTER("ziyan_transport_socket_errors_total",
+                                                              "Failed socket sends and receives.");
 
 /* Private functions declaration ---------------------------------------------*/
 
@@ -141,6 +151,7 @@ T_ZiyanReturnCode Osal_UdpSendData(T_ZiyanSocketHandle socketHandle, const char
     struct sockaddr_in addr;
     T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
     int32_t ret;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (socketHandle == NULL || ipAddr == NULL || port == 0 || buf == NULL || len == 0 || realLen == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -154,10 +165,16 @@ T_ZiyanReturnCode Osal_UdpSendData(T_ZiyanSocketHandle socketHandle, const char
     ret = sendto(socketHandleStruct->socketFd, buf, len, 0, (struct sockaddr *) &addr, sizeof(struct sockaddr_in));
     if (ret >= 0) {
         *realLen = ret;
+        UtilMetrics_CounterAdd(&s_udpSendBytes, (uint64_t) ret);
     } else {
+        UtilMetrics_CounterAdd(&s_socketErrorCount, 1);
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_SOCKET, "udp send", traceStartUs, "bytes", *realLen);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -168,6 +185,7 @@ T_ZiyanReturnCode Osal_UdpRecvData(T_ZiyanSocketHandle socketHandle, char *ipAdd
     T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
     uint32_t addrLen = 0;
     int32_t ret;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (socketHandle == NULL || ipAddr == NULL || port == 0 || buf == NULL || len == 0 || realLen == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -178,10 +196,16 @@ T_ZiyanReturnCode Osal_UdpRecvData(T_ZiyanSocketHandle socketHandle, char *ipAdd
         *realLen = ret;
         strcpy(ipAddr, inet_ntoa(addr.sin_addr));
         *port = ntohs(addr.sin_port);
+        UtilMetrics_CounterAdd(&s_udpRecvBytes, (uint64_t) ret);
     } else {
+        UtilMetrics_CounterAdd(&s_socketErrorCount, 1);
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_SOCKET, "udp recv", traceStartUs, "bytes", *realLen);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -209,6 +233,7 @@ T_ZiyanReturnCode Osal_TcpAccept(T_ZiyanSocketHandle socketHandle, char *ipAddr,
     T_SocketHandleStruct *outSocketHandleStruct;
     struct sockaddr_in addr;
     uint32_t addrLen = 0;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (socketHandle == NULL || ipAddr == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -228,6 +253,10 @@ T_ZiyanReturnCode Osal_TcpAccept(T_ZiyanSocketHandle socketHandle, char *ipAddr,
     *port = ntohs(addr.sin_port);
     *outSocketHandle = outSocketHandleStruct;
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_SOCKET, "tcp accept", traceStartUs, NULL, 0);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -236,6 +265,7 @@ T_ZiyanReturnCode Osal_TcpConnect(T_ZiyanSocketHandle socketHandle, const char *
     struct sockaddr_in addr;
     T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
     int32_t ret;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (socketHandle == NULL || ipAddr == NULL || port == 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -251,6 +281,10 @@ T_ZiyanReturnCode Osal_TcpConnect(T_ZiyanSocketHandle socketHandle, const char *
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_SOCKET, "tcp connect", traceStartUs, NULL, 0);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -259,6 +293,7 @@ T_ZiyanReturnCode Osal_TcpSendData(T_ZiyanSocketHandle socketHandle,
 {
     T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
     int32_t ret;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (socketHandle == NULL || buf == NULL || len == 0 || realLen == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -267,10 +302,16 @@ T_ZiyanReturnCode Osal_TcpSendData(T_ZiyanSocketHandle socketHandle,
     ret = send(socketHandleStruct->socketFd, buf, len, 0);
     if (ret >= 0) {
         *realLen = ret;
+        UtilMetrics_CounterAdd(&s_tcpSendBytes, (uint64_t) ret);
     } else {
+        UtilMetrics_CounterAdd(&s_socketErrorCount, 1);
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_SOCKET, "tcp send", traceStartUs, "bytes", *realLen);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -279,6 +320,7 @@ T_ZiyanReturnCode Osal_TcpRecvData(T_ZiyanSocketHandle socketHandle,
 {
     T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
     int32_t ret;
+    uint64_t traceStartUs = UTIL_TRACE_IS_ENABLED() ? UtilTrace_GetTimeUs() : 0;
 
     if (socketHandle == NULL || buf == NULL || len == 0 || realLen == NULL) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -287,10 +329,16 @@ T_ZiyanReturnCode Osal_TcpRecvData(T_ZiyanSocketHandle socketHandle,
     ret = recv(socketHandleStruct->socketFd, buf, len, 0);
     if (ret >= 0) {
         *realLen = ret;
+        UtilMetrics_CounterAdd(&s_tcpRecvBytes, (uint64_t) ret);
     } else {
+        UtilMetrics_CounterAdd(&s_socketErrorCount, 1);
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (traceStartUs != 0) {
+        UtilTrace_Complete(UTIL_TRACE_CATEGORY_SOCKET, "tcp recv", traceStartUs, "bytes", *realLen);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
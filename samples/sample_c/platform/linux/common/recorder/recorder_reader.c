@@ -0,0 +1,273 @@
+/**
+ ********************************************************************
+ * @file    recorder_reader.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "recorder_reader.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static T_ZiyanReturnCode RecorderReader_MapSegment(T_RecorderReader *reader);
+static void RecorderReader_UnmapSegment(T_RecorderReader *reader);
+static const T_RecorderTelemetryRecordHeader *RecorderReader_GetRecord(const T_RecorderReader *reader);
+
+/* Private values ------------------------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode RecorderReader_Open(T_RecorderReader *reader, const char *indexPath)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    struct stat fileStat;
+    size_t pathLen;
+    int fd;
+
+    if (reader == NULL || indexPath == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    memset(reader, 0, sizeof(T_RecorderReader));
+    reader->segmentFd = -1;
+
+    pathLen = strlen(indexPath);
+    if (pathLen <= strlen(RECORDER_TELEMETRY_INDEX_EXTENSION) || pathLen >= sizeof(reader->basePath) ||
+        strcmp(indexPath + pathLen - strlen(RECORDER_TELEMETRY_INDEX_EXTENSION),
+               RECORDER_TELEMETRY_INDEX_EXTENSION) != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+    memcpy(reader->basePath, indexPath, pathLen - strlen(RECORDER_TELEMETRY_INDEX_EXTENSION));
+
+    fd = open(indexPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (fstat(fd, &fileStat) != 0 ||
+        read(fd, &reader->indexHeader, sizeof(reader->indexHeader)) != (ssize_t) sizeof(reader->indexHeader)) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+
+    if (reader->indexHeader.magic != RECORDER_TELEMETRY_INDEX_MAGIC ||
+        reader->indexHeader.version != RECORDER_TELEMETRY_VERSION ||
+        reader->indexHeader.entrySize != sizeof(T_RecorderTelemetryIndexEntry)) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+        goto out;
+    }
+
+    // A trailing partial entry is an index cut while the recorder wrote it, the segment is left out.
+    reader->entryCount = (uint32_t) (((uint64_t) fileStat.st_size - sizeof(T_RecorderTelemetryIndexHeader)) /
+                                     sizeof(T_RecorderTelemetryIndexEntry));
+    if (reader->entryCount > 0) {
+        reader->entries = malloc((size_t) reader->entryCount * sizeof(T_RecorderTelemetryIndexEntry));
+        if (reader->entries == NULL) {
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+            goto out;
+        }
+        if (read(fd, reader->entries, (size_t) reader->entryCount * sizeof(T_RecorderTelemetryIndexEntry)) !=
+            (ssize_t) ((size_t) reader->entryCount * sizeof(T_RecorderTelemetryIndexEntry))) {
+            free(reader->entries);
+            reader->entries = NULL;
+            returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            goto out;
+        }
+    }
+
+out:
+    close(fd);
+    return returnCode;
+}
+
+void RecorderReader_Close(T_RecorderReader *reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+
+    RecorderReader_UnmapSegment(reader);
+    free(reader->entries);
+    reader->entries = NULL;
+    reader->entryCount = 0;
+}
+
+T_ZiyanReturnCode RecorderReader_Next(T_RecorderReader *reader, T_RecorderReaderRecord *record)
+{
+    const T_RecorderTelemetryRecordHeader *header;
+
+    if (reader == NULL || record == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    while (reader->entryPosition < reader->entryCount) {
+        if (reader->segmentRegion == NULL && RecorderReader_MapSegment(reader) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            reader->entryPosition++;
+            continue;
+        }
+
+        header = RecorderReader_GetRecord(reader);
+        if (header == NULL) {
+            RecorderReader_UnmapSegment(reader);
+            reader->entryPosition++;
+            continue;
+        }
+
+        record->header = header;
+        record->data = (const uint8_t *) (header + 1);
+        record->segmentIndex = reader->entries[reader->entryPosition].segmentIndex;
+        reader->segmentOffset += RECORDER_TELEMETRY_RECORD_SIZE(header->dataSize);
+
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+}
+
+T_ZiyanReturnCode RecorderReader_Seek(T_RecorderReader *reader, uint64_t receiveTimeUs)
+{
+    const T_RecorderTelemetryRecordHeader *header;
+    uint32_t position;
+
+    if (reader == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    RecorderReader_UnmapSegment(reader);
+
+    // Segments hold increasing times, the first one ending at or after the time holds the record.
+    for (position = 0; position < reader->entryCount; position++) {
+        if (reader->entries[position].state != RECORDER_TELEMETRY_SEGMENT_STATE_DELETED &&
+            reader->entries[position].lastReceiveTimeUs >= receiveTimeUs) {
+            break;
+        }
+    }
+
+    // The entry of a crashed session's last segment may predate its last records, which are then scanned for.
+    if (position == reader->entryCount && reader->entryCount > 0) {
+        position = reader->entryCount - 1;
+    }
+
+    for (reader->entryPosition = position; reader->entryPosition < reader->entryCount; reader->entryPosition++) {
+        if (RecorderReader_MapSegment(reader) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            continue;
+        }
+
+        while ((header = RecorderReader_GetRecord(reader)) != NULL) {
+            if (header->receiveTimeUs >= receiveTimeUs) {
+                return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+            }
+            reader->segmentOffset += RECORDER_TELEMETRY_RECORD_SIZE(header->dataSize);
+        }
+        RecorderReader_UnmapSegment(reader);
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_ZiyanReturnCode RecorderReader_MapSegment(T_RecorderReader *reader)
+{
+    const T_RecorderTelemetryIndexEntry *entry = &reader->entries[reader->entryPosition];
+    const T_RecorderTelemetrySegmentHeader *header;
+    char path[RECORDER_READER_PATH_MAX_SIZE + 16];
+    struct stat fileStat;
+
+    if (entry->state == RECORDER_TELEMETRY_SEGMENT_STATE_DELETED) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    snprintf(path, sizeof(path), "%s_%05u%s", reader->basePath, entry->segmentIndex,
+             RECORDER_TELEMETRY_SEGMENT_EXTENSION);
+    reader->segmentFd = open(path, O_RDONLY | O_CLOEXEC);
+    if (reader->segmentFd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (fstat(reader->segmentFd, &fileStat) != 0 || (uint64_t) fileStat.st_size < RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE) {
+        goto out;
+    }
+
+    reader->segmentSize = (uint64_t) fileStat.st_size;
+    reader->segmentRegion = mmap(NULL, reader->segmentSize, PROT_READ, MAP_SHARED, reader->segmentFd, 0);
+    if (reader->segmentRegion == MAP_FAILED) {
+        reader->segmentRegion = NULL;
+        goto out;
+    }
+    madvise(reader->segmentRegion, reader->segmentSize, MADV_SEQUENTIAL);
+
+    header = (const T_RecorderTelemetrySegmentHeader *) reader->segmentRegion;
+    if (header->magic != RECORDER_TELEMETRY_SEGMENT_MAGIC || header->version != RECORDER_TELEMETRY_VERSION ||
+        header->headerSize != RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE) {
+        RecorderReader_UnmapSegment(reader);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+    reader->segmentOffset = RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    close(reader->segmentFd);
+    reader->segmentFd = -1;
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+}
+
+static void RecorderReader_UnmapSegment(T_RecorderReader *reader)
+{
+    if (reader->segmentRegion != NULL) {
+        munmap(reader->segmentRegion, reader->segmentSize);
+        reader->segmentRegion = NULL;
+    }
+    if (reader->segmentFd >= 0) {
+        close(reader->segmentFd);
+        reader->segmentFd = -1;
+    }
+}
+
+static const T_RecorderTelemetryRecordHeader *RecorderReader_GetRecord(const T_RecorderReader *reader)
+{
+    const T_RecorderTelemetryRecordHeader *header;
+
+    if (reader->segmentOffset + sizeof(T_RecorderTelemetryRecordHeader) > reader->segmentSize) {
+        return NULL;
+    }
+
+    // The zeroed space after the last record ends the segment, so does a record running past it.
+    header = (const T_RecorderTelemetryRecordHeader *) (reader->segmentRegion + reader->segmentOffset);
+    if (header->dataSize == 0 || header->dataSize > RECORDER_TELEMETRY_DATA_MAX_SIZE ||
+        reader->segmentOffset + RECORDER_TELEMETRY_RECORD_SIZE(header->dataSize) > reader->segmentSize) {
+        return NULL;
+    }
+
+    return header;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,96 @@
+/**
+ ********************************************************************
+ * @file    recorder_reader.h
+ * @brief   This is the header file for "recorder_reader.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef RECORDER_READER_H
+#define RECORDER_READER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "recorder_telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define RECORDER_READER_PATH_MAX_SIZE           256
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    T_RecorderTelemetryIndexHeader indexHeader;
+    T_RecorderTelemetryIndexEntry *entries; /*!< One per segment, in segment order. */
+    uint32_t entryCount;
+    uint32_t entryPosition; /*!< Entry of the segment being read. */
+    char basePath[RECORDER_READER_PATH_MAX_SIZE]; /*!< Index path without its extension. */
+    int segmentFd;
+    uint8_t *segmentRegion; /*!< Segment being read, NULL between segments. */
+    uint64_t segmentSize;
+    uint64_t segmentOffset; /*!< Offset of the next record in the segment. */
+} T_RecorderReader;
+
+typedef struct {
+    const T_RecorderTelemetryRecordHeader *header;
+    const uint8_t *data; /*!< Value of header->dataSize bytes, unaligned. */
+    uint32_t segmentIndex;
+} T_RecorderReaderRecord;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Open a session written by the telemetry recorder, including one still being written or cut short by a
+ * crash, which is read up to its last flush.
+ * @param reader: reader to initialize.
+ * @param indexPath: path of the index file of the session.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode RecorderReader_Open(T_RecorderReader *reader, const char *indexPath);
+
+/**
+ * @brief Release the index and the segment mapped by a reader.
+ */
+void RecorderReader_Close(T_RecorderReader *reader);
+
+/**
+ * @brief Read the next record of the session. Deleted and missing segments are skipped.
+ * @param reader: opened reader.
+ * @param record: next record, pointing into the mapped segment until the next call.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND at the end of the session.
+ */
+T_ZiyanReturnCode RecorderReader_Next(T_RecorderReader *reader, T_RecorderReaderRecord *record);
+
+/**
+ * @brief Move to the first record received at or after a time, finding its segment in the index.
+ * @param reader: opened reader.
+ * @param receiveTimeUs: receive time, see T_RecorderTelemetryRecordHeader.
+ * @return Execution result, ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND when the session ends before.
+ */
+T_ZiyanReturnCode RecorderReader_Seek(T_RecorderReader *reader, uint64_t receiveTimeUs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECORDER_READER_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,618 @@
+/**
+ ********************************************************************
+ * @file    recorder_replay.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "recorder_replay.h"
+#include "recorder_reader.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <utils/util_misc.h>
+
+/* Private constants ---------------------------------------------------------*/
+#define RECORDER_REPLAY_CLIENT_INDEX_NONE       (-1)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    ZiyanReceiveDataOfTopicCallback callback;
+    uint64_t periodUs;
+    uint64_t lastDeliveredUs;
+    bool isDelivered;
+} T_RecorderReplayTopic;
+
+typedef enum {
+    RECORDER_REPLAY_CLIENT_STATE_FREE = 0,
+    RECORDER_REPLAY_CLIENT_STATE_RUNNING = 1,
+    RECORDER_REPLAY_CLIENT_STATE_SLEEPING = 2,
+    RECORDER_REPLAY_CLIENT_STATE_STALLED = 3, /*!< Ran past the timeout, no longer waited for until it sleeps. */
+} E_RecorderReplayClientState;
+
+typedef struct {
+    E_RecorderReplayClientState state;
+    uint64_t deadlineUs;
+} T_RecorderReplayClient;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *RecorderReplay_Task(void *arg);
+static bool RecorderReplay_WaitWallClock(uint64_t receiveTimeUs);
+static bool RecorderReplay_AdvanceVirtualClock(uint64_t receiveTimeUs);
+static void RecorderReplay_WaitClients(void);
+static void RecorderReplay_WaitClientsAttached(void);
+static void RecorderReplay_Deliver(const T_RecorderReaderRecord *record);
+static int RecorderReplay_GetClient(void);
+static T_ZiyanReturnCode RecorderReplay_SleepWallClock(uint32_t timeMs, double speed);
+static uint64_t RecorderReplay_GetMonotonicUs(void);
+static struct timespec RecorderReplay_GetTimespec(uint64_t timeUs);
+
+/* Private values ------------------------------------------------------------*/
+static bool s_isReplayInit = false;
+static T_RecorderReplayConfig s_replayConfig;
+static T_RecorderReader s_replayReader;
+static T_RecorderReplayTopic s_replayTopics[RECORDER_TELEMETRY_TOPIC_MAX];
+static T_RecorderReplayClient s_replayClients[RECORDER_REPLAY_CLIENT_MAX];
+static T_RecorderReplayStatistics s_replayStatistics;
+
+// One lock for the topics, the clock and the clients, none of it is held while a callback runs.
+static pthread_mutex_t s_replayMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_clockCond; /*!< Wakes sleeping clients and threads waiting for the end. */
+static pthread_cond_t s_replayCond; /*!< Wakes the replay thread. */
+static pthread_t s_replayThread;
+static bool s_isReplayThreadRunning = false;
+static bool s_isReplayExit = false;
+static bool s_isReplayFinished = false;
+static uint64_t s_replayTimeUs = 0;
+static uint64_t s_firstTimeUs = 0;
+static uint64_t s_wallStartUs = 0;
+static uint32_t s_replayGeneration = 0;
+
+static __thread int s_clientIndex = RECORDER_REPLAY_CLIENT_INDEX_NONE;
+static __thread uint32_t s_clientGeneration = 0;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode RecorderReplay_Init(const T_RecorderReplayConfig *config)
+{
+    T_ZiyanReturnCode returnCode;
+    T_RecorderReaderRecord record;
+    pthread_condattr_t condAttr;
+
+    if (config == NULL || config->indexPath == NULL || config->speed < 0 ||
+        (config->clock == RECORDER_REPLAY_CLOCK_VIRTUAL && config->clientTimeoutMs == 0)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isReplayInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    returnCode = RecorderReader_Open(&s_replayReader, config->indexPath);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    // The replay clock starts at the first value, found by reading it and going back to it.
+    returnCode = RecorderReader_Next(&s_replayReader, &record);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        RecorderReader_Close(&s_replayReader);
+        return returnCode;
+    }
+    s_firstTimeUs = record.header->receiveTimeUs;
+    returnCode = RecorderReader_Seek(&s_replayReader, 0);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        RecorderReader_Close(&s_replayReader);
+        return returnCode;
+    }
+
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_clockCond, &condAttr);
+    pthread_cond_init(&s_replayCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    pthread_mutex_lock(&s_replayMutex);
+    s_replayConfig = *config;
+    memset(s_replayTopics, 0, sizeof(s_replayTopics));
+    memset(s_replayClients, 0, sizeof(s_replayClients));
+    memset(&s_replayStatistics, 0, sizeof(s_replayStatistics));
+    s_replayTimeUs = s_firstTimeUs;
+    s_wallStartUs = 0;
+    s_isReplayExit = false;
+    s_isReplayFinished = false;
+    s_replayGeneration++;
+    s_isReplayInit = true;
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode RecorderReplay_DeInit(void)
+{
+    if (!s_isReplayInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    s_isReplayExit = true;
+    pthread_cond_broadcast(&s_replayCond);
+    pthread_cond_broadcast(&s_clockCond);
+    pthread_mutex_unlock(&s_replayMutex);
+
+    if (s_isReplayThreadRunning) {
+        pthread_join(s_replayThread, NULL);
+        s_isReplayThreadRunning = false;
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    s_isReplayInit = false;
+    pthread_mutex_unlock(&s_replayMutex);
+
+    RecorderReader_Close(&s_replayReader);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode RecorderReplay_SubscribeTopic(E_ZiyanFcSubscriptionTopic topic,
+                                                E_ZiyanDataSubscriptionTopicFreq frequency,
+                                                ZiyanReceiveDataOfTopicCallback callback)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+    if (topic >= RECORDER_TELEMETRY_TOPIC_MAX || frequency == 0 || callback == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    if (!s_isReplayInit) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE;
+    } else if (s_replayTopics[topic].callback != NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    } else {
+        s_replayTopics[topic].callback = callback;
+        s_replayTopics[topic].periodUs = 1000000 / (uint64_t) frequency;
+        s_replayTopics[topic].isDelivered = false;
+    }
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode RecorderReplay_UnSubscribeTopic(E_ZiyanFcSubscriptionTopic topic)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+    if (topic >= RECORDER_TELEMETRY_TOPIC_MAX) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    if (s_replayTopics[topic].callback == NULL) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+    s_replayTopics[topic].callback = NULL;
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode RecorderReplay_Start(void)
+{
+    if (!s_isReplayInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE;
+    }
+
+    if (s_isReplayThreadRunning) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    s_wallStartUs = RecorderReplay_GetMonotonicUs();
+    if (pthread_create(&s_replayThread, NULL, RecorderReplay_Task, NULL) != 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    pthread_setname_np(s_replayThread, "recorder_replay");
+    s_isReplayThreadRunning = true;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode RecorderReplay_WaitFinished(void)
+{
+    if (!s_isReplayThreadRunning) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE;
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    while (!s_isReplayFinished && !s_isReplayExit) {
+        pthread_cond_wait(&s_clockCond, &s_replayMutex);
+    }
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode RecorderReplay_GetStatistics(T_RecorderReplayStatistics *statistics)
+{
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    *statistics = s_replayStatistics;
+    if (!s_replayStatistics.isFinished && s_wallStartUs != 0) {
+        statistics->wallTimeUs = RecorderReplay_GetMonotonicUs() - s_wallStartUs;
+    }
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode RecorderReplay_TaskSleepMs(uint32_t timeMs)
+{
+    T_RecorderReplayClient *client;
+    double speed;
+    int index;
+
+    pthread_mutex_lock(&s_replayMutex);
+    if (!s_isReplayInit || s_isReplayFinished || s_isReplayExit) {
+        pthread_mutex_unlock(&s_replayMutex);
+        return RecorderReplay_SleepWallClock(timeMs, 1);
+    }
+
+    if (s_replayConfig.clock == RECORDER_REPLAY_CLOCK_WALL) {
+        speed = s_replayConfig.speed;
+        pthread_mutex_unlock(&s_replayMutex);
+        return RecorderReplay_SleepWallClock(timeMs, speed);
+    }
+
+    index = RecorderReplay_GetClient();
+    if (index == RECORDER_REPLAY_CLIENT_INDEX_NONE) {
+        pthread_mutex_unlock(&s_replayMutex);
+        return RecorderReplay_SleepWallClock(timeMs, 1);
+    }
+
+    client = &s_replayClients[index];
+    client->deadlineUs = s_replayTimeUs + (uint64_t) timeMs * 1000;
+    client->state = RECORDER_REPLAY_CLIENT_STATE_SLEEPING;
+    pthread_cond_signal(&s_replayCond);
+
+    // The replay thread sets the client running again when the replay time reaches its deadline.
+    while (client->state == RECORDER_REPLAY_CLIENT_STATE_SLEEPING && !s_isReplayFinished && !s_isReplayExit) {
+        pthread_cond_wait(&s_clockCond, &s_replayMutex);
+    }
+    client->state = RECORDER_REPLAY_CLIENT_STATE_RUNNING;
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+void RecorderReplay_DetachClock(void)
+{
+    pthread_mutex_lock(&s_replayMutex);
+    if (s_clientIndex != RECORDER_REPLAY_CLIENT_INDEX_NONE && s_clientGeneration == s_replayGeneration) {
+        s_replayClients[s_clientIndex].state = RECORDER_REPLAY_CLIENT_STATE_FREE;
+        pthread_cond_signal(&s_replayCond);
+    }
+    s_clientIndex = RECORDER_REPLAY_CLIENT_INDEX_NONE;
+    pthread_mutex_unlock(&s_replayMutex);
+}
+
+T_ZiyanReturnCode RecorderReplay_GetTimeMs(uint32_t *ms)
+{
+    uint64_t us;
+
+    if (ms == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    RecorderReplay_GetTimeUs(&us);
+    *ms = (uint32_t) (us / 1000);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode RecorderReplay_GetTimeUs(uint64_t *us)
+{
+    if (us == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    if (!s_isReplayInit) {
+        *us = RecorderReplay_GetMonotonicUs();
+    } else if (s_replayConfig.clock == RECORDER_REPLAY_CLOCK_WALL && s_replayConfig.speed > 0 &&
+               s_wallStartUs != 0 && !s_isReplayFinished) {
+        // Between values the wall clock replay time runs on, scaled like the deliveries.
+        *us = s_firstTimeUs +
+              (uint64_t) ((double) (RecorderReplay_GetMonotonicUs() - s_wallStartUs) * s_replayConfig.speed);
+        *us = USER_UTIL_MAX(*us, s_replayTimeUs);
+    } else {
+        *us = s_replayTimeUs;
+    }
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void *RecorderReplay_Task(void *arg)
+{
+    T_RecorderReaderRecord record;
+    bool isRunning = true;
+
+    USER_UTIL_UNUSED(arg);
+
+    if (s_replayConfig.clock == RECORDER_REPLAY_CLOCK_VIRTUAL) {
+        RecorderReplay_WaitClientsAttached();
+    }
+
+    while (isRunning && RecorderReader_Next(&s_replayReader, &record) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        if (s_replayConfig.clock == RECORDER_REPLAY_CLOCK_VIRTUAL) {
+            isRunning = RecorderReplay_AdvanceVirtualClock(record.header->receiveTimeUs);
+        } else {
+            isRunning = RecorderReplay_WaitWallClock(record.header->receiveTimeUs);
+        }
+
+        if (isRunning) {
+            RecorderReplay_Deliver(&record);
+        }
+    }
+
+    pthread_mutex_lock(&s_replayMutex);
+    // Iterations running on the last value end before the end of the session is seen, the same on every run.
+    if (s_replayConfig.clock == RECORDER_REPLAY_CLOCK_VIRTUAL) {
+        RecorderReplay_WaitClients();
+    }
+    s_isReplayFinished = true;
+    s_replayStatistics.isFinished = true;
+    s_replayStatistics.wallTimeUs = RecorderReplay_GetMonotonicUs() - s_wallStartUs;
+    pthread_cond_broadcast(&s_clockCond);
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return NULL;
+}
+
+static bool RecorderReplay_WaitWallClock(uint64_t receiveTimeUs)
+{
+    struct timespec deadline;
+    uint64_t targetUs;
+    uint64_t nowUs;
+    bool isRunning;
+
+    pthread_mutex_lock(&s_replayMutex);
+    if (s_replayConfig.speed > 0) {
+        targetUs = s_wallStartUs + (uint64_t) ((double) (receiveTimeUs - s_firstTimeUs) / s_replayConfig.speed);
+        deadline = RecorderReplay_GetTimespec(targetUs);
+        while (!s_isReplayExit && RecorderReplay_GetMonotonicUs() < targetUs) {
+            pthread_cond_timedwait(&s_replayCond, &s_replayMutex, &deadline);
+        }
+
+        nowUs = RecorderReplay_GetMonotonicUs();
+        if (nowUs > targetUs && nowUs - targetUs > s_replayStatistics.latenessMaxUs) {
+            s_replayStatistics.latenessMaxUs = nowUs - targetUs;
+        }
+    }
+
+    isRunning = !s_isReplayExit;
+    s_replayTimeUs = USER_UTIL_MAX(s_replayTimeUs, receiveTimeUs);
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return isRunning;
+}
+
+static bool RecorderReplay_AdvanceVirtualClock(uint64_t receiveTimeUs)
+{
+    T_RecorderReplayClient *client;
+    uint64_t wakeUpTimeUs;
+    bool isRunning;
+    int i;
+
+    pthread_mutex_lock(&s_replayMutex);
+    while (!s_isReplayExit) {
+        RecorderReplay_WaitClients();
+
+        // Clients due before the value run first, a value and a wake-up at the same time give the value first.
+        wakeUpTimeUs = UINT64_MAX;
+        for (i = 0; i < RECORDER_REPLAY_CLIENT_MAX; i++) {
+            if (s_replayClients[i].state == RECORDER_REPLAY_CLIENT_STATE_SLEEPING) {
+                wakeUpTimeUs = USER_UTIL_MIN(wakeUpTimeUs, s_replayClients[i].deadlineUs);
+            }
+        }
+        if (wakeUpTimeUs >= receiveTimeUs) {
+            break;
+        }
+
+        s_replayTimeUs = USER_UTIL_MAX(s_replayTimeUs, wakeUpTimeUs);
+        for (i = 0; i < RECORDER_REPLAY_CLIENT_MAX; i++) {
+            client = &s_replayClients[i];
+            if (client->state == RECORDER_REPLAY_CLIENT_STATE_SLEEPING && client->deadlineUs <= s_replayTimeUs) {
+                client->state = RECORDER_REPLAY_CLIENT_STATE_RUNNING;
+            }
+        }
+        pthread_cond_broadcast(&s_clockCond);
+    }
+
+    isRunning = !s_isReplayExit;
+    s_replayTimeUs = USER_UTIL_MAX(s_replayTimeUs, receiveTimeUs);
+    pthread_mutex_unlock(&s_replayMutex);
+
+    return isRunning;
+}
+
+// Called with the replay mutex held.
+static void RecorderReplay_WaitClients(void)
+{
+    struct timespec deadline = RecorderReplay_GetTimespec(RecorderReplay_GetMonotonicUs() +
+                                                          (uint64_t) s_replayConfig.clientTimeoutMs * 1000);
+    bool isClientRunning;
+    int i;
+
+    while (!s_isReplayExit) {
+        isClientRunning = false;
+        for (i = 0; i < RECORDER_REPLAY_CLIENT_MAX; i++) {
+            if (s_replayClients[i].state == RECORDER_REPLAY_CLIENT_STATE_RUNNING) {
+                isClientRunning = true;
+                break;
+            }
+        }
+        if (!isClientRunning) {
+            return;
+        }
+
+        if (pthread_cond_timedwait(&s_replayCond, &s_replayMutex, &deadline) == ETIMEDOUT) {
+            for (i = 0; i < RECORDER_REPLAY_CLIENT_MAX; i++) {
+                if (s_replayClients[i].state == RECORDER_REPLAY_CLIENT_STATE_RUNNING) {
+                    s_replayClients[i].state = RECORDER_REPLAY_CLIENT_STATE_STALLED;
+                    s_replayStatistics.stalledClientCount++;
+                }
+            }
+        }
+    }
+}
+
+static void RecorderReplay_WaitClientsAttached(void)
+{
+    struct timespec deadline = RecorderReplay_GetTimespec(RecorderReplay_GetMonotonicUs() +
+                                                          (uint64_t) s_replayConfig.clientTimeoutMs * 1000);
+    uint32_t clientCount;
+    int i;
+
+    pthread_mutex_lock(&s_replayMutex);
+    while (!s_isReplayExit) {
+        clientCount = 0;
+        for (i = 0; i < RECORDER_REPLAY_CLIENT_MAX; i++) {
+            if (s_replayClients[i].state != RECORDER_REPLAY_CLIENT_STATE_FREE) {
+                clientCount++;
+            }
+        }
+        if (clientCount >= s_replayConfig.clientCount) {
+            break;
+        }
+
+        if (pthread_cond_timedwait(&s_replayCond, &s_replayMutex, &deadline) == ETIMEDOUT) {
+            s_replayStatistics.stalledClientCount += s_replayConfig.clientCount - clientCount;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_replayMutex);
+}
+
+static void RecorderReplay_Deliver(const T_RecorderReaderRecord *record)
+{
+    uint8_t data[RECORDER_TELEMETRY_DATA_MAX_SIZE];
+    ZiyanReceiveDataOfTopicCallback callback = NULL;
+    T_RecorderReplayTopic *topic;
+    T_ZiyanDataTimestamp timestamp;
+    uint64_t receiveTimeUs = record->header->receiveTimeUs;
+
+    pthread_mutex_lock(&s_replayMutex);
+    if (record->header->topic < RECORDER_TELEMETRY_TOPIC_MAX) {
+        topic = &s_replayTopics[record->header->topic];
+        // A quarter period of slack keeps the jitter of the recording from skipping values at the recorded rate.
+        if (topic->callback != NULL &&
+            (!topic->isDelivered || receiveTimeUs - topic->lastDeliveredUs >= topic->periodUs - topic->periodUs / 4)) {
+            callback = topic->callback;
+            topic->lastDeliveredUs = receiveTimeUs;
+            topic->isDelivered = true;
+        }
+    }
+
+    if (callback != NULL) {
+        s_replayStatistics.deliveredCount++;
+    } else {
+        s_replayStatistics.skippedCount++;
+    }
+    s_replayStatistics.replayedTimeUs = receiveTimeUs - s_firstTimeUs;
+    pthread_mutex_unlock(&s_replayMutex);
+
+    if (callback == NULL) {
+        return;
+    }
+
+    // Values are mapped read-only and unaligned, callbacks get a copy as from the SDK.
+    memcpy(data, record->data, record->header->dataSize);
+    timestamp = record->header->timestamp;
+    callback(data, record->header->dataSize, &timestamp);
+}
+
+// Called with the replay mutex held.
+static int RecorderReplay_GetClient(void)
+{
+    int i;
+
+    if (s_clientIndex != RECORDER_REPLAY_CLIENT_INDEX_NONE && s_clientGeneration == s_replayGeneration &&
+        s_replayClients[s_clientIndex].state != RECORDER_REPLAY_CLIENT_STATE_FREE) {
+        return s_clientIndex;
+    }
+
+    for (i = 0; i < RECORDER_REPLAY_CLIENT_MAX; i++) {
+        if (s_replayClients[i].state == RECORDER_REPLAY_CLIENT_STATE_FREE) {
+            s_replayClients[i].state = RECORDER_REPLAY_CLIENT_STATE_RUNNING;
+            s_clientIndex = i;
+            s_clientGeneration = s_replayGeneration;
+            return i;
+        }
+    }
+
+    return RECORDER_REPLAY_CLIENT_INDEX_NONE;
+}
+
+static T_ZiyanReturnCode RecorderReplay_SleepWallClock(uint32_t timeMs, double speed)
+{
+    struct timespec duration;
+    uint64_t durationUs;
+
+    if (speed <= 0) {
+        sched_yield();
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    durationUs = (uint64_t) ((double) timeMs * 1000 / speed);
+    duration.tv_sec = (time_t) (durationUs / 1000000);
+    duration.tv_nsec = (long) (durationUs % 1000000) * 1000;
+    nanosleep(&duration, NULL);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static uint64_t RecorderReplay_GetMonotonicUs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000 + (uint64_t) time.tv_nsec / 1000;
+}
+
+static struct timespec RecorderReplay_GetTimespec(uint64_t timeUs)
+{
+    struct timespec time;
+
+    time.tv_sec = (time_t) (timeUs / 1000000);
+    time.tv_nsec = (long) (timeUs % 1000000) * 1000;
+
+    return time;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
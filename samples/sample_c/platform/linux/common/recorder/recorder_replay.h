@@ -0,0 +1,134 @@
+/**
+ ********************************************************************
+ * @file    recorder_replay.h
+ * @brief   This is the header file for "recorder_replay.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef RECORDER_REPLAY_H
+#define RECORDER_REPLAY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+#include "ziyan_fc_subscription.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define RECORDER_REPLAY_CLIENT_MAX              32
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    /*! Values are delivered at their recorded receive times, scaled by the speed. */
+    RECORDER_REPLAY_CLOCK_WALL = 0,
+    /*!
+     * Replay time only moves on once every thread sleeping through RecorderReplay_TaskSleepMs() is asleep again, and
+     * then jumps to the next value or wake-up, so loops run as fast as the host allows with the same interleaving of
+     * values and iterations on every run.
+     */
+    RECORDER_REPLAY_CLOCK_VIRTUAL = 1,
+} E_RecorderReplayClock;
+
+typedef struct {
+    const char *indexPath; /*!< Index file of the recorded session. */
+    E_RecorderReplayClock clock;
+    double speed; /*!< Wall clock: 1 for real time, N for N times faster, 0 for as fast as possible. */
+    uint32_t clientTimeoutMs; /*!< Virtual clock: wall time a sleeping thread may run before the replay goes on
+                               * without it, until it sleeps again. */
+    uint32_t clientCount; /*!< Virtual clock: threads the first value waits for, so that threads started with the
+                           * replay see the same values on every run. */
+} T_RecorderReplayConfig;
+
+typedef struct {
+    uint64_t deliveredCount;
+    uint64_t skippedCount; /*!< Values of topics not subscribed, or above the subscribed frequency. */
+    uint64_t replayedTimeUs; /*!< Recorded time covered so far. */
+    uint64_t wallTimeUs; /*!< Wall time since the start, up to the end of the session. */
+    uint64_t latenessMaxUs; /*!< Wall clock: longest delay of a delivery past its scheduled time. */
+    uint32_t stalledClientCount; /*!< Virtual clock: times a thread ran past clientTimeoutMs. */
+    bool isFinished;
+} T_RecorderReplayStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Open a session recorded by the telemetry recorder for replay.
+ * @param config: replay configuration.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode RecorderReplay_Init(const T_RecorderReplayConfig *config);
+
+/**
+ * @brief Stop the replay, wake the sleeping threads and close the session.
+ */
+T_ZiyanReturnCode RecorderReplay_DeInit(void);
+
+/**
+ * @brief Deliver the recorded values of a topic to a callback, like ZiyanFcSubscription_SubscribeTopic(). Values
+ * come with their recorded timestamps, from the replay thread, one at a time.
+ * @param topic: topic to replay.
+ * @param frequency: values closer than the period of the frequency to the last delivered one are skipped.
+ * @param callback: callback receiving the values.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode RecorderReplay_SubscribeTopic(E_ZiyanFcSubscriptionTopic topic,
+                                                E_ZiyanDataSubscriptionTopicFreq frequency,
+                                                ZiyanReceiveDataOfTopicCallback callback);
+T_ZiyanReturnCode RecorderReplay_UnSubscribeTopic(E_ZiyanFcSubscriptionTopic topic);
+
+/**
+ * @brief Start delivering the values from the beginning of the session.
+ */
+T_ZiyanReturnCode RecorderReplay_Start(void);
+
+/**
+ * @brief Wait for the last value of the session to be delivered.
+ */
+T_ZiyanReturnCode RecorderReplay_WaitFinished(void);
+T_ZiyanReturnCode RecorderReplay_GetStatistics(T_RecorderReplayStatistics *statistics);
+
+/**
+ * @brief Sleep on the replay clock, a replacement of the OSAL TaskSleepMs for the threads of the replayed application.
+ * With the virtual clock the calling thread joins the threads the replay waits for, until
+ * RecorderReplay_DetachClock(). Once the session is over, sleeps last their time on the wall clock.
+ */
+T_ZiyanReturnCode RecorderReplay_TaskSleepMs(uint32_t timeMs);
+
+/**
+ * @brief Leave the threads the virtual clock waits for, before blocking on anything else than the replay clock.
+ */
+void RecorderReplay_DetachClock(void);
+
+/**
+ * @brief Time of the replay clock, the recorded receive time of the values being replayed, replacements of the OSAL
+ * GetTimeMs and GetTimeUs.
+ */
+T_ZiyanReturnCode RecorderReplay_GetTimeMs(uint32_t *ms);
+T_ZiyanReturnCode RecorderReplay_GetTimeUs(uint64_t *us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECORDER_REPLAY_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
@@ -0,0 +1,571 @@
+/**
+ ********************************************************************
+ * @file    recorder_telemetry.c
+ * @brief
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "recorder_telemetry.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <utils/util_misc.h>
+
+/* Private constants ---------------------------------------------------------*/
+#define RECORDER_TELEMETRY_STAGING_MIN_SIZE     4096
+#define RECORDER_TELEMETRY_DATA_SIZE_PADDING    0xFFFF
+#define RECORDER_TELEMETRY_PATH_MAX_SIZE        192
+#define RECORDER_TELEMETRY_CACHE_LINE_SIZE      64
+#define RECORDER_TELEMETRY_RETRY_DELAY_MIN_MS   1000 // after a segment failed to open, doubled by every failure
+#define RECORDER_TELEMETRY_RETRY_DELAY_MAX_MS   60000
+
+/* Private types -------------------------------------------------------------*/
+// Single producer single consumer ring of records. Records do not wrap: the producer skips the end of the buffer,
+// marking it with a padding record when there is room for a header.
+typedef struct {
+    uint32_t head __attribute__((aligned(RECORDER_TELEMETRY_CACHE_LINE_SIZE))); /*!< Written by the producer. */
+    uint32_t sequence; /*!< Owned by the producer. */
+    uint32_t tail __attribute__((aligned(RECORDER_TELEMETRY_CACHE_LINE_SIZE))); /*!< Written by the flush thread. */
+} T_RecorderTelemetryStaging;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *RecorderTelemetry_FlushTask(void *arg);
+static void RecorderTelemetry_Flush(void);
+static const T_RecorderTelemetryRecordHeader *RecorderTelemetry_PeekStaging(uint16_t topic, uint32_t head);
+static T_ZiyanReturnCode RecorderTelemetry_Append(const T_RecorderTelemetryRecordHeader *record);
+static T_ZiyanReturnCode RecorderTelemetry_OpenSegment(uint32_t segmentIndex);
+static void RecorderTelemetry_CloseSegment(void);
+static void RecorderTelemetry_UpdateSegment(void);
+static T_ZiyanReturnCode RecorderTelemetry_WriteIndexEntry(const T_RecorderTelemetryIndexEntry *entry);
+static uint64_t RecorderTelemetry_GetTimeUs(clockid_t clockId);
+
+/* Private values ------------------------------------------------------------*/
+static bool s_isRecorderInit = false;
+static uint32_t s_activeWriterCount = 0;
+static T_RecorderTelemetryConfig s_recorderConfig;
+static char s_recorderBasePath[RECORDER_TELEMETRY_PATH_MAX_SIZE];
+static uint64_t s_monotonicBaseUs = 0;
+static uint64_t s_realtimeBaseUs = 0;
+
+static T_RecorderTelemetryStaging s_stagings[RECORDER_TELEMETRY_TOPIC_MAX];
+static uint8_t *s_stagingBuffers = NULL;
+static uint32_t s_stagingMask = 0;
+
+static int s_indexFd = -1;
+static int s_segmentFd = -1;
+static uint8_t *s_segmentRegion = NULL;
+static T_RecorderTelemetryIndexEntry s_segmentEntry;
+static uint64_t s_segmentRetryTimeUs = 0; // monotonic, no segment is opened before
+static uint32_t s_segmentRetryDelayMs = 0;
+static T_RecorderTelemetryStatistics s_recorderStatistics;
+
+static pthread_t s_flushThread;
+static bool s_isFlushThreadRunning = false;
+static bool s_isFlushExit = false;
+
+/* Exported functions definition ---------------------------------------------*/
+T_ZiyanReturnCode RecorderTelemetry_Init(const T_RecorderTelemetryConfig *config, char *indexPath,
+                                         uint16_t indexPathSize)
+{
+    T_ZiyanReturnCode returnCode;
+    T_RecorderTelemetryIndexHeader indexHeader;
+    char path[RECORDER_TELEMETRY_PATH_MAX_SIZE + sizeof(RECORDER_TELEMETRY_INDEX_EXTENSION)];
+    struct tm startTime;
+    time_t startTimeSec;
+
+    if (config == NULL || config->directory == NULL || config->name == NULL || config->flushPeriodMs == 0 ||
+        config->stagingSize < RECORDER_TELEMETRY_STAGING_MIN_SIZE ||
+        (config->stagingSize & (config->stagingSize - 1)) != 0 ||
+        config->segmentSize < RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE +
+                              RECORDER_TELEMETRY_RECORD_SIZE(RECORDER_TELEMETRY_DATA_MAX_SIZE)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isRecorderInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    s_recorderConfig = *config;
+    s_monotonicBaseUs = RecorderTelemetry_GetTimeUs(CLOCK_MONOTONIC);
+    s_realtimeBaseUs = RecorderTelemetry_GetTimeUs(CLOCK_REALTIME);
+    startTimeSec = (time_t) (s_realtimeBaseUs / 1000000);
+    if (localtime_r(&startTimeSec, &startTime) == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    snprintf(s_recorderBasePath, sizeof(s_recorderBasePath), "%s/%s_%04d%02d%02d_%02d-%02d-%02d",
+             config->directory, config->name, startTime.tm_year + 1900, startTime.tm_mon + 1, startTime.tm_mday,
+             startTime.tm_hour, startTime.tm_min, startTime.tm_sec);
+
+    // The only allocation of the recorder, values are then staged and written in place.
+    s_stagingBuffers = malloc((size_t) RECORDER_TELEMETRY_TOPIC_MAX * config->stagingSize);
+    if (s_stagingBuffers == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+    s_stagingMask = config->stagingSize - 1;
+    memset(s_stagings, 0, sizeof(s_stagings));
+    memset(&s_recorderStatistics, 0, sizeof(s_recorderStatistics));
+    s_segmentRetryTimeUs = 0;
+    s_segmentRetryDelayMs = 0;
+
+    snprintf(path, sizeof(path), "%s%s", s_recorderBasePath, RECORDER_TELEMETRY_INDEX_EXTENSION);
+    s_indexFd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (s_indexFd < 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out1;
+    }
+
+    memset(&indexHeader, 0, sizeof(indexHeader));
+    indexHeader.magic = RECORDER_TELEMETRY_INDEX_MAGIC;
+    indexHeader.version = RECORDER_TELEMETRY_VERSION;
+    indexHeader.entrySize = sizeof(T_RecorderTelemetryIndexEntry);
+    indexHeader.segmentSize = config->segmentSize;
+    indexHeader.monotonicBaseUs = s_monotonicBaseUs;
+    indexHeader.realtimeBaseUs = s_realtimeBaseUs;
+    if (pwrite(s_indexFd, &indexHeader, sizeof(indexHeader), 0) != (ssize_t) sizeof(indexHeader)) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out2;
+    }
+
+    returnCode = RecorderTelemetry_OpenSegment(0);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out2;
+    }
+
+    s_isFlushExit = false;
+    if (pthread_create(&s_flushThread, NULL, RecorderTelemetry_FlushTask, NULL) != 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out3;
+    }
+    pthread_setname_np(s_flushThread, "recorder_telem");
+    s_isFlushThreadRunning = true;
+
+    if (indexPath != NULL && indexPathSize > 0) {
+        strncpy(indexPath, path, indexPathSize - 1);
+        indexPath[indexPathSize - 1] = '\0';
+    }
+
+    __atomic_store_n(&s_isRecorderInit, true, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out3:
+    RecorderTelemetry_CloseSegment();
+out2:
+    close(s_indexFd);
+    s_indexFd = -1;
+out1:
+    free(s_stagingBuffers);
+    s_stagingBuffers = NULL;
+    return returnCode;
+}
+
+T_ZiyanReturnCode RecorderTelemetry_DeInit(void)
+{
+    if (!s_isRecorderInit) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    // Writers already past the check finish staging their values, which the last flush then writes.
+    __atomic_store_n(&s_isRecorderInit, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&s_activeWriterCount, __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+
+    if (s_isFlushThreadRunning) {
+        __atomic_store_n(&s_isFlushExit, true, __ATOMIC_RELEASE);
+        pthread_join(s_flushThread, NULL);
+        s_isFlushThreadRunning = false;
+    }
+
+    RecorderTelemetry_Flush();
+    RecorderTelemetry_CloseSegment();
+    fsync(s_indexFd);
+    close(s_indexFd);
+    s_indexFd = -1;
+    free(s_stagingBuffers);
+    s_stagingBuffers = NULL;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode RecorderTelemetry_Write(uint16_t topic, const uint8_t *data, uint16_t dataSize,
+                                          const T_ZiyanDataTimestamp *timestamp)
+{
+    T_ZiyanReturnCode returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    T_RecorderTelemetryStaging *staging;
+    T_RecorderTelemetryRecordHeader *record;
+    uint8_t *buffer;
+    uint32_t recordSize;
+    uint32_t contiguousSize;
+    uint32_t requiredSize;
+    uint32_t head;
+    uint32_t tail;
+
+    if (topic >= RECORDER_TELEMETRY_TOPIC_MAX || data == NULL || dataSize == 0 ||
+        dataSize > RECORDER_TELEMETRY_DATA_MAX_SIZE || timestamp == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    __atomic_add_fetch(&s_activeWriterCount, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&s_isRecorderInit, __ATOMIC_SEQ_CST)) {
+        __atomic_sub_fetch(&s_activeWriterCount, 1, __ATOMIC_RELEASE);
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    staging = &s_stagings[topic];
+    buffer = s_stagingBuffers + (size_t) topic * s_recorderConfig.stagingSize;
+    recordSize = RECORDER_TELEMETRY_RECORD_SIZE(dataSize);
+    head = staging->head;
+    tail = __atomic_load_n(&staging->tail, __ATOMIC_ACQUIRE);
+    contiguousSize = s_recorderConfig.stagingSize - (head & s_stagingMask);
+    requiredSize = contiguousSize < recordSize ? contiguousSize + recordSize : recordSize;
+    staging->sequence++;
+
+    if (s_recorderConfig.stagingSize - (head - tail) < requiredSize) {
+        __atomic_add_fetch(&s_recorderStatistics.droppedCount, 1, __ATOMIC_RELAXED);
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+        goto out;
+    }
+
+    if (contiguousSize < recordSize) {
+        if (contiguousSize >= sizeof(T_RecorderTelemetryRecordHeader)) {
+            record = (T_RecorderTelemetryRecordHeader *) (buffer + (head & s_stagingMask));
+            record->dataSize = RECORDER_TELEMETRY_DATA_SIZE_PADDING;
+        }
+        head += contiguousSize;
+    }
+
+    record = (T_RecorderTelemetryRecordHeader *) (buffer + (head & s_stagingMask));
+    record->topic = topic;
+    record->dataSize = dataSize;
+    record->sequence = staging->sequence;
+    record->receiveTimeUs = RecorderTelemetry_GetTimeUs(CLOCK_MONOTONIC);
+    record->timestamp = *timestamp;
+    memcpy(record + 1, data, dataSize);
+    __atomic_store_n(&staging->head, head + recordSize, __ATOMIC_RELEASE);
+
+out:
+    __atomic_sub_fetch(&s_activeWriterCount, 1, __ATOMIC_RELEASE);
+
+    return returnCode;
+}
+
+T_ZiyanReturnCode RecorderTelemetry_GetStatistics(T_RecorderTelemetryStatistics *statistics)
+{
+    if (statistics == NULL) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    statistics->recordCount = __atomic_load_n(&s_recorderStatistics.recordCount, __ATOMIC_RELAXED);
+    statistics->recordBytes = __atomic_load_n(&s_recorderStatistics.recordBytes, __ATOMIC_RELAXED);
+    statistics->droppedCount = __atomic_load_n(&s_recorderStatistics.droppedCount, __ATOMIC_RELAXED);
+    statistics->segmentCount = __atomic_load_n(&s_recorderStatistics.segmentCount, __ATOMIC_RELAXED);
+    statistics->stagingDepthMax = __atomic_load_n(&s_recorderStatistics.stagingDepthMax, __ATOMIC_RELAXED);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+
+static void *RecorderTelemetry_FlushTask(void *arg)
+{
+    struct timespec period = {
+        .tv_sec = s_recorderConfig.flushPeriodMs / 1000,
+        .tv_nsec = (long) (s_recorderConfig.flushPeriodMs % 1000) * 1000000,
+    };
+
+    USER_UTIL_UNUSED(arg);
+
+    while (!__atomic_load_n(&s_isFlushExit, __ATOMIC_ACQUIRE)) {
+        nanosleep(&period, NULL);
+        RecorderTelemetry_Flush();
+    }
+
+    return NULL;
+}
+
+#pragma GCC diagnostic pop
+
+static void RecorderTelemetry_Flush(void)
+{
+    const T_RecorderTelemetryRecordHeader *records[RECORDER_TELEMETRY_TOPIC_MAX];
+    const T_RecorderTelemetryRecordHeader *record;
+    uint32_t heads[RECORDER_TELEMETRY_TOPIC_MAX];
+    uint16_t topics[RECORDER_TELEMETRY_TOPIC_MAX];
+    uint16_t topicCount = 0;
+    uint16_t earliest;
+    uint32_t depth;
+    uint16_t i;
+
+    // Only values staged when the flush starts are written, so that a busy topic cannot hold the flush forever.
+    for (i = 0; i < RECORDER_TELEMETRY_TOPIC_MAX; i++) {
+        heads[i] = __atomic_load_n(&s_stagings[i].head, __ATOMIC_ACQUIRE);
+        depth = heads[i] - s_stagings[i].tail;
+        if (depth > s_recorderStatistics.stagingDepthMax) {
+            __atomic_store_n(&s_recorderStatistics.stagingDepthMax, depth, __ATOMIC_RELAXED);
+        }
+        records[i] = RecorderTelemetry_PeekStaging(i, heads[i]);
+        if (records[i] != NULL) {
+            topics[topicCount++] = i;
+        }
+    }
+
+    if (topicCount == 0) {
+        return;
+    }
+
+    // Merge the staged values of all topics by receive time, the few pending topics are scanned for each record.
+    while (topicCount > 0) {
+        earliest = 0;
+        for (i = 1; i < topicCount; i++) {
+            if (records[topics[i]]->receiveTimeUs < records[topics[earliest]]->receiveTimeUs) {
+                earliest = i;
+            }
+        }
+
+        record = records[topics[earliest]];
+        if (RecorderTelemetry_Append(record) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            __atomic_add_fetch(&s_recorderStatistics.droppedCount, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&s_stagings[record->topic].tail,
+                         s_stagings[record->topic].tail + RECORDER_TELEMETRY_RECORD_SIZE(record->dataSize),
+                         __ATOMIC_RELEASE);
+
+        records[topics[earliest]] = RecorderTelemetry_PeekStaging(topics[earliest], heads[topics[earliest]]);
+        if (records[topics[earliest]] == NULL) {
+            topics[earliest] = topics[--topicCount];
+        }
+    }
+
+    RecorderTelemetry_UpdateSegment();
+}
+
+static const T_RecorderTelemetryRecordHeader *RecorderTelemetry_PeekStaging(uint16_t topic, uint32_t head)
+{
+    T_RecorderTelemetryStaging *staging = &s_stagings[topic];
+    const T_RecorderTelemetryRecordHeader *record;
+    uint32_t contiguousSize;
+
+    while (staging->tail != head) {
+        contiguousSize = s_recorderConfig.stagingSize - (staging->tail & s_stagingMask);
+        record = (const T_RecorderTelemetryRecordHeader *) (s_stagingBuffers +
+                                                            (size_t) topic * s_recorderConfig.stagingSize +
+                                                            (staging->tail & s_stagingMask));
+        if (contiguousSize >= sizeof(T_RecorderTelemetryRecordHeader) &&
+            record->dataSize != RECORDER_TELEMETRY_DATA_SIZE_PADDING) {
+            return record;
+        }
+        __atomic_store_n(&staging->tail, staging->tail + contiguousSize, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static T_ZiyanReturnCode RecorderTelemetry_Append(const T_RecorderTelemetryRecordHeader *record)
+{
+    T_ZiyanReturnCode returnCode;
+    uint32_t recordSize = RECORDER_TELEMETRY_RECORD_SIZE(record->dataSize);
+    uint8_t *destination;
+    uint64_t currentTimeUs;
+
+    if (s_segmentRegion == NULL ||
+        RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE + s_segmentEntry.usedBytes + recordSize > s_recorderConfig.segmentSize) {
+        if (s_segmentRegion != NULL) {
+            RecorderTelemetry_CloseSegment();
+        }
+
+        // A full or failing disk drops the records until the retry time, instead of an open per record.
+        currentTimeUs = RecorderTelemetry_GetTimeUs(CLOCK_MONOTONIC);
+        if (currentTimeUs < s_segmentRetryTimeUs) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_BUSY;
+        }
+        returnCode = RecorderTelemetry_OpenSegment(s_segmentEntry.segmentIndex + 1);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            s_segmentRetryDelayMs = USER_UTIL_MIN(USER_UTIL_MAX(s_segmentRetryDelayMs * 2,
+                                                                RECORDER_TELEMETRY_RETRY_DELAY_MIN_MS),
+                                                  RECORDER_TELEMETRY_RETRY_DELAY_MAX_MS);
+            s_segmentRetryTimeUs = currentTimeUs + (uint64_t) s_segmentRetryDelayMs * 1000;
+            return returnCode;
+        }
+        s_segmentRetryDelayMs = 0;
+    }
+
+    // The value goes in before the header, a crash in between leaves a zero dataSize ending the segment.
+    destination = s_segmentRegion + RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE + s_segmentEntry.usedBytes;
+    memcpy(destination + sizeof(T_RecorderTelemetryRecordHeader), record + 1, record->dataSize);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(destination, record, sizeof(T_RecorderTelemetryRecordHeader));
+
+    if (s_segmentEntry.recordCount == 0 || record->receiveTimeUs < s_segmentEntry.firstReceiveTimeUs) {
+        s_segmentEntry.firstReceiveTimeUs = record->receiveTimeUs;
+    }
+    if (record->receiveTimeUs > s_segmentEntry.lastReceiveTimeUs) {
+        s_segmentEntry.lastReceiveTimeUs = record->receiveTimeUs;
+    }
+    s_segmentEntry.topicMask |= (uint64_t) 1 << record->topic;
+    s_segmentEntry.recordCount++;
+    s_segmentEntry.usedBytes += recordSize;
+    __atomic_add_fetch(&s_recorderStatistics.recordCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_recorderStatistics.recordBytes, recordSize, __ATOMIC_RELAXED);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode RecorderTelemetry_OpenSegment(uint32_t segmentIndex)
+{
+    T_ZiyanReturnCode returnCode;
+    T_RecorderTelemetrySegmentHeader *header;
+    T_RecorderTelemetryIndexEntry deletedEntry;
+    char path[RECORDER_TELEMETRY_PATH_MAX_SIZE + 16];
+    int result;
+
+    snprintf(path, sizeof(path), "%s_%05u%s", s_recorderBasePath, segmentIndex, RECORDER_TELEMETRY_SEGMENT_EXTENSION);
+    s_segmentFd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (s_segmentFd < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // Stores to a mapping of a sparse file raise SIGBUS once the disk is full, so the blocks are reserved upfront.
+    // Only file systems without block allocation, like tmpfs on old kernels, fall back to a sparse file.
+    result = posix_fallocate(s_segmentFd, 0, (off_t) s_recorderConfig.segmentSize);
+    if (result == EOPNOTSUPP || result == EINVAL) {
+        result = ftruncate(s_segmentFd, (off_t) s_recorderConfig.segmentSize) == 0 ? 0 : errno;
+    }
+    if (result != 0) {
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+
+    s_segmentRegion = mmap(NULL, s_recorderConfig.segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, s_segmentFd, 0);
+    if (s_segmentRegion == MAP_FAILED) {
+        s_segmentRegion = NULL;
+        returnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        goto out;
+    }
+    madvise(s_segmentRegion, s_recorderConfig.segmentSize, MADV_SEQUENTIAL);
+
+    header = (T_RecorderTelemetrySegmentHeader *) s_segmentRegion;
+    header->version = RECORDER_TELEMETRY_VERSION;
+    header->headerSize = RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE;
+    header->segmentIndex = segmentIndex;
+    header->state = RECORDER_TELEMETRY_SEGMENT_STATE_OPEN;
+    header->segmentSize = s_recorderConfig.segmentSize;
+    header->monotonicBaseUs = s_monotonicBaseUs;
+    header->realtimeBaseUs = s_realtimeBaseUs;
+    __atomic_store_n(&header->magic, RECORDER_TELEMETRY_SEGMENT_MAGIC, __ATOMIC_RELEASE);
+
+    memset(&s_segmentEntry, 0, sizeof(s_segmentEntry));
+    s_segmentEntry.segmentIndex = segmentIndex;
+    s_segmentEntry.state = RECORDER_TELEMETRY_SEGMENT_STATE_OPEN;
+    returnCode = RecorderTelemetry_WriteIndexEntry(&s_segmentEntry);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        munmap(s_segmentRegion, s_recorderConfig.segmentSize);
+        s_segmentRegion = NULL;
+        goto out;
+    }
+    __atomic_add_fetch(&s_recorderStatistics.segmentCount, 1, __ATOMIC_RELAXED);
+
+    if (s_recorderConfig.segmentCountMax != 0 && segmentIndex >= s_recorderConfig.segmentCountMax) {
+        snprintf(path, sizeof(path), "%s_%05u%s", s_recorderBasePath, segmentIndex - s_recorderConfig.segmentCountMax,
+                 RECORDER_TELEMETRY_SEGMENT_EXTENSION);
+        unlink(path);
+        if (pread(s_indexFd, &deletedEntry, sizeof(deletedEntry),
+                  (off_t) (sizeof(T_RecorderTelemetryIndexHeader) +
+                           (segmentIndex - s_recorderConfig.segmentCountMax) * sizeof(deletedEntry))) ==
+            (ssize_t) sizeof(deletedEntry)) {
+            deletedEntry.state = RECORDER_TELEMETRY_SEGMENT_STATE_DELETED;
+            RecorderTelemetry_WriteIndexEntry(&deletedEntry);
+        }
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    close(s_segmentFd);
+    s_segmentFd = -1;
+    return returnCode;
+}
+
+static void RecorderTelemetry_CloseSegment(void)
+{
+    if (s_segmentRegion == NULL) {
+        return;
+    }
+
+    s_segmentEntry.state = RECORDER_TELEMETRY_SEGMENT_STATE_CLOSED;
+    ((T_RecorderTelemetrySegmentHeader *) s_segmentRegion)->state = RECORDER_TELEMETRY_SEGMENT_STATE_CLOSED;
+    RecorderTelemetry_UpdateSegment();
+
+    // Writeback starts now, so that closing the segment does not wait for the disk.
+    msync(s_segmentRegion, s_recorderConfig.segmentSize, MS_ASYNC);
+    munmap(s_segmentRegion, s_recorderConfig.segmentSize);
+    close(s_segmentFd);
+    s_segmentRegion = NULL;
+    s_segmentFd = -1;
+}
+
+static void RecorderTelemetry_UpdateSegment(void)
+{
+    T_RecorderTelemetrySegmentHeader *header;
+
+    if (s_segmentRegion == NULL) {
+        return;
+    }
+
+    header = (T_RecorderTelemetrySegmentHeader *) s_segmentRegion;
+    header->usedBytes = s_segmentEntry.usedBytes;
+    header->recordCount = s_segmentEntry.recordCount;
+    RecorderTelemetry_WriteIndexEntry(&s_segmentEntry);
+}
+
+static T_ZiyanReturnCode RecorderTelemetry_WriteIndexEntry(const T_RecorderTelemetryIndexEntry *entry)
+{
+    off_t offset = (off_t) (sizeof(T_RecorderTelemetryIndexHeader) +
+                            (uint64_t) entry->segmentIndex * sizeof(T_RecorderTelemetryIndexEntry));
+
+    if (pwrite(s_indexFd, entry, sizeof(*entry), offset) != (ssize_t) sizeof(*entry)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static uint64_t RecorderTelemetry_GetTimeUs(clockid_t clockId)
+{
+    struct timespec time;
+
+    clock_gettime(clockId, &time);
+
+    return (uint64_t) time.tv_sec * 1000000 + (uint64_t) time.tv_nsec / 1000;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
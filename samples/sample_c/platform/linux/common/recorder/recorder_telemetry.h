@@ -0,0 +1,156 @@
+/**
+ ********************************************************************
+ * @file    recorder_telemetry.h
+ * @brief   This is the header file for "recorder_telemetry.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef RECORDER_TELEMETRY_H
+#define RECORDER_TELEMETRY_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ziyan_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define RECORDER_TELEMETRY_SEGMENT_MAGIC        0x4D4C545A // "ZTLM"
+#define RECORDER_TELEMETRY_INDEX_MAGIC          0x5849545A // "ZTIX"
+#define RECORDER_TELEMETRY_VERSION              1
+#define RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE  4096
+#define RECORDER_TELEMETRY_SEGMENT_EXTENSION    ".ztr"
+#define RECORDER_TELEMETRY_INDEX_EXTENSION      ".zti"
+#define RECORDER_TELEMETRY_TOPIC_MAX            64
+#define RECORDER_TELEMETRY_DATA_MAX_SIZE        1024
+#define RECORDER_TELEMETRY_RECORD_ALIGN         8
+#define RECORDER_TELEMETRY_SEGMENT_STATE_OPEN    1
+#define RECORDER_TELEMETRY_SEGMENT_STATE_CLOSED  2
+#define RECORDER_TELEMETRY_SEGMENT_STATE_DELETED 3
+
+/* Size of a record holding dataSize bytes of value. */
+#define RECORDER_TELEMETRY_RECORD_SIZE(dataSize) \
+    ((sizeof(T_RecorderTelemetryRecordHeader) + (dataSize) + RECORDER_TELEMETRY_RECORD_ALIGN - 1) & \
+     ~((size_t) RECORDER_TELEMETRY_RECORD_ALIGN - 1))
+
+/* Exported types ------------------------------------------------------------*/
+/*
+ * A session is an index file <name>.zti and segment files <name>_00000.ztr, <name>_00001.ztr, ... Little endian.
+ * Segments are preallocated to their full size and hold a T_RecorderTelemetrySegmentHeader padded to
+ * RECORDER_TELEMETRY_SEGMENT_HEADER_SIZE, then records aligned to RECORDER_TELEMETRY_RECORD_ALIGN, in receive time
+ * order within each flush. A record with a zero dataSize ends the segment, so the records of a crashed session are
+ * readable up to the last flush even when the headers were not updated.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t segmentIndex;
+    uint32_t state;
+    uint64_t segmentSize;
+    uint64_t usedBytes; /*!< Bytes of records, updated at each flush. */
+    uint64_t recordCount;
+    uint64_t monotonicBaseUs; /*!< Receive time of the moment the session started. */
+    uint64_t realtimeBaseUs; /*!< Wall clock of the same moment. */
+} __attribute__((packed)) T_RecorderTelemetrySegmentHeader;
+
+typedef struct {
+    uint16_t topic;
+    uint16_t dataSize; /*!< Bytes of value following the header. */
+    uint32_t sequence; /*!< Values of the topic given to the recorder up to this one, gaps are dropped values. */
+    uint64_t receiveTimeUs; /*!< CLOCK_MONOTONIC when the value was given to the recorder. */
+    T_ZiyanDataTimestamp timestamp; /*!< Timestamp of the value given by the subscription. */
+} __attribute__((packed)) T_RecorderTelemetryRecordHeader;
+
+/* Index layout: T_RecorderTelemetryIndexHeader, then one entry per segment at the position of its index. */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+    uint64_t segmentSize;
+    uint64_t monotonicBaseUs;
+    uint64_t realtimeBaseUs;
+} __attribute__((packed)) T_RecorderTelemetryIndexHeader;
+
+typedef struct {
+    uint32_t segmentIndex;
+    uint32_t state; /*!< Segments beyond segmentCountMax are deleted, their entries remain. */
+    uint64_t recordCount;
+    uint64_t usedBytes;
+    uint64_t firstReceiveTimeUs;
+    uint64_t lastReceiveTimeUs;
+    uint64_t topicMask; /*!< Bit n set when the segment holds records of topic n. */
+} __attribute__((packed)) T_RecorderTelemetryIndexEntry;
+
+typedef struct {
+    const char *directory; /*!< Directory of the session files. */
+    const char *name; /*!< Prefix of the session files, followed by the start time. */
+    uint32_t segmentSize; /*!< Bytes of a segment file, allocated when the segment is opened. */
+    uint32_t segmentCountMax; /*!< Oldest segments are deleted past this count, 0 to keep all. */
+    uint32_t stagingSize; /*!< Bytes staged per topic between flushes, a power of 2. */
+    uint32_t flushPeriodMs; /*!< Period staged values are written to the segment at. */
+} T_RecorderTelemetryConfig;
+
+typedef struct {
+    uint64_t recordCount;
+    uint64_t recordBytes;
+    uint64_t droppedCount; /*!< Values dropped on a full staging buffer or while no segment can be opened. */
+    uint32_t segmentCount;
+    uint32_t stagingDepthMax; /*!< Most bytes staged for a topic seen by a flush. */
+} T_RecorderTelemetryStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Create the index and first segment of a session and start the flush thread.
+ * @param config: recorder configuration.
+ * @param indexPath: path of the index of the session, may be NULL.
+ * @param indexPathSize: size of indexPath.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode RecorderTelemetry_Init(const T_RecorderTelemetryConfig *config, char *indexPath,
+                                         uint16_t indexPathSize);
+
+/**
+ * @brief Flush the staged values, close the current segment and stop the recorder.
+ */
+T_ZiyanReturnCode RecorderTelemetry_DeInit(void);
+
+/**
+ * @brief Stage a value for recording. Lock-free, never blocks and never allocates; values are dropped when the
+ * staging buffer of the topic is full. Values of one topic must be given by one thread at a time.
+ * @param topic: topic of the value, less than RECORDER_TELEMETRY_TOPIC_MAX.
+ * @param data: value.
+ * @param dataSize: size of the value, 1 to RECORDER_TELEMETRY_DATA_MAX_SIZE.
+ * @param timestamp: timestamp of the value.
+ * @return Execution result.
+ */
+T_ZiyanReturnCode RecorderTelemetry_Write(uint16_t topic, const uint8_t *data, uint16_t dataSize,
+                                          const T_ZiyanDataTimestamp *timestamp);
+T_ZiyanReturnCode RecorderTelemetry_GetStatistics(T_RecorderTelemetryStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECORDER_TELEMETRY_H
+/************************ (C) COPYRIGHT ZIYAN Innovations *******END OF FILE******/
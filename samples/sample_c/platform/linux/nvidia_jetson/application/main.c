@@ -27,9 +27,22 @@
 #include <ziyan_logger.h>
 #include <ziyan_core.h>
 #include <utils/util_misc.h>
+#include <utils/util_metrics.h>
+#include <utils/util_trace.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include "monitor/sys_monitor.h"
+#include "monitor/monitor_sampler.h"
+#include "monitor/metrics_exporter.h"
+#include "monitor/monitor_profiler.h"
+#include "monitor/monitor_trace.h"
+#include "logger/logger_async.h"
+#include "logger/logger_binary.h"
+#include "logger/logger_rotate.h"
+#include "logger/logger_flight.h"
+#include "recorder/recorder_telemetry.h"
+#include "bus/bus_telemetry.h"
 #include "osal/osal.h"
 #include "osal/osal_fs.h"
 #include "osal/osal_socket.h"
@@ -39,44 +52,171 @@
 #include "ziyan_sdk_app_info.h"
 #include "ziyan_aircraft_info.h"
 #include "widget/test_widget.h"
+#include "fc_subscription/fc_subscription_cache.h"
+#include "fc_subscription/fc_subscription_dispatcher.h"
+#include "fc_subscription/fc_subscription_history.h"
 #include "ziyan_sdk_config.h"
 
 
 
 /* Private constants ---------------------------------------------------------*/
-#define ZIYAN_LOG_PATH                    "Logs/ZIYAN"
-#define ZIYAN_LOG_INDEX_FILE_NAME         "Logs/latest"
+#define ZIYAN_LOG_FILE_BASE_NAME          "ZIYAN"
 #define ZIYAN_LOG_FOLDER_NAME             "Logs"
+#define ZIYAN_LOG_MAX_COUNT               (64)
+#define ZIYAN_LOG_FILE_SIZE_MAX           (8 * 1024 * 1024)
+#define ZIYAN_LOG_TOTAL_SIZE_MAX          (256 * 1024 * 1024)
+#define ZIYAN_LOG_COMPRESS_ENABLE         1
+#define ZIYAN_LOG_FLIGHT_RECORDER_PATH    "Logs/flight.rec"
+#define ZIYAN_LOG_FLIGHT_RECORDER_SIZE    (1024 * 1024)
+#define ZIYAN_LOG_FLIGHT_SYNC_PERIOD_MS   (1000)
 #define ZIYAN_LOG_PATH_MAX_SIZE           (128)
-#define ZIYAN_LOG_FOLDER_NAME_MAX_SIZE    (32)
-#define ZIYAN_LOG_MAX_COUNT               (10)
-#define ZIYAN_SYSTEM_CMD_STR_MAX_SIZE     (64)
 #define ZIYAN_SYSTEM_RESULT_STR_MAX_SIZE  (128)
+#define ZIYAN_LOG_EXIT_FLUSH_TIMEOUT_MS   (500)
+#define ZIYAN_MONITOR_PERIOD_MS           (10000)
+#define ZIYAN_METRICS_UNIX_SOCKET_PATH    "/tmp/ziyan_metrics.sock"
+#define ZIYAN_METRICS_TCP_PORT            (9464)
+#define ZIYAN_METRICS_DUMP_PATH           "Logs/metrics.prom"
+#define ZIYAN_METRICS_DUMP_PERIOD_MS      (10000)
+#define ZIYAN_TELEMETRY_NAME              "telemetry"
+#define ZIYAN_TELEMETRY_SEGMENT_SIZE      (16 * 1024 * 1024)
+#define ZIYAN_TELEMETRY_SEGMENT_COUNT_MAX (16)
+#define ZIYAN_TELEMETRY_STAGING_SIZE      (16 * 1024)
+#define ZIYAN_TELEMETRY_FLUSH_PERIOD_MS   (100)
+#define ZIYAN_HISTORY_DEPTH               (1024)
+#define ZIYAN_TELEMETRY_BUS_NAME          "/ziyan_telemetry"
+#define ZIYAN_TELEMETRY_BUS_SIZE          (1024 * 1024)
+#define ZIYAN_TELEMETRY_BUS_HISTORY_DEPTH (64)
 
 #define ZIYAN_USE_WIDGET_INTERACTION       0
+/* Record the local log in binary form, decoded on the host with ziyan_log_decoder. */
+#define ZIYAN_USE_BINARY_LOG               0
+/* Log the CPU usage of every thread and the memory of the process periodically. */
+#define ZIYAN_USE_SYSTEM_MONITOR           0
+/* Serve the metrics registry in the Prometheus text format on loopback and dump it to a file. */
+#define ZIYAN_USE_METRICS_EXPORTER         1
+/* Sample the stacks of all threads between two "kill -USR2 <pid>", written to Logs/profile_*.folded. */
+#define ZIYAN_USE_PROFILER                 0
+/* Trace the OSAL tasks, locks and I/O between two "kill -USR1 <pid>", written to Logs/trace_*.json. */
+#define ZIYAN_USE_TRACE                    0
+/* Record every value of the cached subscription topics to Logs/telemetry_*, exported with ziyan_telemetry_export.
+ * Up to ZIYAN_TELEMETRY_SEGMENT_COUNT_MAX segments of ZIYAN_TELEMETRY_SEGMENT_SIZE bytes, reserved when opened. */
+#define ZIYAN_USE_TELEMETRY_RECORDER       0
+/* Keep the last seconds of attitude, velocity and position for queries by time, e.g. to georeference photos. */
+#define ZIYAN_USE_SUBSCRIPTION_HISTORY     1
+/* Publish the cached subscription topics to /dev/shm for other processes, read with bus/bus_client.h. */
+#define ZIYAN_USE_TELEMETRY_BUS            1
+
+#if ZIYAN_USE_BINARY_LOG
+#define ZIYAN_LOG_FILE_EXTENSION          "blog"
+#else
+#define ZIYAN_LOG_FILE_EXTENSION          "log"
+#endif
+
+#if ZIYAN_USE_TELEMETRY_RECORDER && \
+    (defined(CONFIG_MODULE_SAMPLE_FC_SUBSCRIPTION_ON) || defined(CONFIG_MODULE_SAMPLE_GIMBAL_EMU_ON))
+#define ZIYAN_TELEMETRY_RECORDER_ON        1
+#else
+#define ZIYAN_TELEMETRY_RECORDER_ON        0
+#endif
+
+#if ZIYAN_USE_SUBSCRIPTION_HISTORY && \
+    (defined(CONFIG_MODULE_SAMPLE_FC_SUBSCRIPTION_ON) || defined(CONFIG_MODULE_SAMPLE_GIMBAL_EMU_ON))
+#define ZIYAN_SUBSCRIPTION_HISTORY_ON      1
+#else
+#define ZIYAN_SUBSCRIPTION_HISTORY_ON      0
+#endif
+
+#if ZIYAN_USE_TELEMETRY_BUS && \
+    (defined(CONFIG_MODULE_SAMPLE_FC_SUBSCRIPTION_ON) || defined(CONFIG_MODULE_SAMPLE_GIMBAL_EMU_ON))
+#define ZIYAN_TELEMETRY_BUS_ON             1
+#else
+#define ZIYAN_TELEMETRY_BUS_ON             0
+#endif
 
 /* Private types -------------------------------------------------------------*/
-typedef struct {
-    pid_t tid;
-    char name[16];
-    float pcpu;
-} T_ThreadAttribute;
 
 /* Private values -------------------------------------------------------------*/
-static FILE *s_ziyanLogFile;
-static FILE *s_ziyanLogFileCnt;
+static int s_ziyanLogFileFd = -1;
+static uint8_t s_ziyanLogFileSinkIndex;
+static uint8_t s_ziyanConsoleSinkIndex;
+static volatile sig_atomic_t s_ziyanExitRequested = 0;
+#if ZIYAN_USE_SYSTEM_MONITOR
 static pthread_t s_monitorThread = 0;
+static T_MonitorSamplerSnapshot s_monitorSnapshot;
+static T_UtilMetric s_systemPcpu = UTIL_METRICS_GAUGE("ziyan_system_cpu_percent", "Busy percentage of all cores.");
+static T_UtilMetric s_processPcpu = UTIL_METRICS_GAUGE("ziyan_process_cpu_percent",
+                                                       "Percentage of one core used by the process.");
+static T_UtilMetric s_processRss = UTIL_METRICS_GAUGE("ziyan_process_rss_bytes", "Resident memory of the process.");
+static T_UtilMetric s_processThreadCount = UTIL_METRICS_GAUGE("ziyan_process_threads", "Threads of the process.");
+static T_UtilMetric s_memAvailable = UTIL_METRICS_GAUGE("ziyan_system_memory_available_bytes",
+                                                        "Memory available for new allocations.");
+#endif
+static T_UtilMetric s_loggerRecordCount = UTIL_METRICS_COUNTER("ziyan_logger_records_total",
+                                                               "Records queued to the asynchronous logger.");
+static T_UtilMetric s_loggerDroppedRecordCount = UTIL_METRICS_COUNTER("ziyan_logger_dropped_records_total",
+                                                                      "Records dropped on a full logger ring.");
+static T_UtilMetric s_loggerWrittenBytes = UTIL_METRICS_COUNTER("ziyan_logger_written_bytes_total",
+                                                                "Bytes written by the logger to its sinks.");
+static T_UtilMetric s_loggerWriteErrorCount = UTIL_METRICS_COUNTER("ziyan_logger_write_errors_total",
+                                                                   "Failed writes of the logger to its sinks.");
+static T_UtilMetric s_loggerP99CallLatency = UTIL_METRICS_GAUGE("ziyan_logger_call_p99_nanoseconds",
+                                                                "99th percentile of the logging call latency.");
+static T_UtilMetric s_loggerRotateCount = UTIL_METRICS_COUNTER("ziyan_logger_rotations_total",
+                                                               "Log files rotated.");
+static T_UtilMetric s_loggerDiskUsage = UTIL_METRICS_GAUGE("ziyan_logger_disk_usage_bytes",
+                                                           "Disk usage of the log files.");
+static T_UtilMetric s_loggerFlightSlotCount = UTIL_METRICS_COUNTER("ziyan_logger_flight_slots_total",
+                                                                   "Slots written to the flight recorder.");
+#if ZIYAN_TELEMETRY_RECORDER_ON
+static T_UtilMetric s_telemetryRecordCount = UTIL_METRICS_COUNTER("ziyan_telemetry_records_total",
+                                                                  "Topic values written by the telemetry recorder.");
+static T_UtilMetric s_telemetryDroppedCount = UTIL_METRICS_COUNTER("ziyan_telemetry_dropped_records_total",
+                                                                   "Topic values dropped on a full staging buffer.");
+static T_UtilMetric s_telemetrySegmentCount = UTIL_METRICS_COUNTER("ziyan_telemetry_segments_total",
+                                                                   "Segment files opened by the telemetry recorder.");
+#endif
+#if ZIYAN_TELEMETRY_BUS_ON
+static T_UtilMetric s_telemetryBusPublishedCount = UTIL_METRICS_COUNTER("ziyan_telemetry_bus_values_total",
+                                                                        "Topic values published on the telemetry bus.");
+static T_UtilMetric s_telemetryBusDroppedCount = UTIL_METRICS_COUNTER("ziyan_telemetry_bus_dropped_total",
+                                                                      "Topic values dropped by the telemetry bus.");
+static T_UtilMetric s_telemetryBusWakeCount = UTIL_METRICS_COUNTER("ziyan_telemetry_bus_wakes_total",
+                                                                   "Topic values that woke waiting bus clients.");
+#endif
 
 /* Private functions declaration ---------------------------------------------*/
 static T_ZiyanReturnCode ZiyanUser_PrepareSystemEnvironment(void);
 static T_ZiyanReturnCode ZiyanUser_FillInUserInfo(T_ZiyanUserInfo *userInfo);
 static T_ZiyanReturnCode ZiyanUser_PrintConsole(const uint8_t *data, uint16_t dataLen);
 static T_ZiyanReturnCode ZiyanUser_LocalWrite(const uint8_t *data, uint16_t dataLen);
-static T_ZiyanReturnCode ZiyanUser_LocalWriteFsInit(const char *path);
-// static void *ZiyanUser_MonitorTask(void *argument);
+static T_ZiyanReturnCode ZiyanUser_LocalWriteFsInit(const char *folder);
+#if ZIYAN_USE_SYSTEM_MONITOR
+static void *ZiyanUser_MonitorTask(void *argument);
+#endif
 // static T_ZiyanReturnCode ZiyanTest_HighPowerApplyPinInit();
 // static T_ZiyanReturnCode ZiyanTest_WriteHighPowerApplyPin(E_ZiyanPowerManagementPinState pinState);
+static void ZiyanUser_CollectLoggerMetrics(void);
+#if ZIYAN_TELEMETRY_RECORDER_ON
+static T_ZiyanReturnCode ZiyanUser_StartTelemetryRecorder(void);
+static void ZiyanUser_RecordTelemetry(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                      const T_ZiyanDataTimestamp *timestamp);
+#endif
+#if ZIYAN_SUBSCRIPTION_HISTORY_ON
+static T_ZiyanReturnCode ZiyanUser_StartSubscriptionHistory(void);
+#endif
+#if ZIYAN_TELEMETRY_BUS_ON
+static T_ZiyanReturnCode ZiyanUser_StartTelemetryBus(void);
+static void ZiyanUser_PublishTelemetry(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                       const T_ZiyanDataTimestamp *timestamp);
+#endif
+static void ZiyanUser_NormalExit(void);
 static void ZiyanUser_NormalExitHandler(int signalNum);
+#if ZIYAN_USE_PROFILER
+static void ZiyanUser_ProfilerToggleHandler(int signalNum);
+#endif
+#if ZIYAN_USE_TRACE
+static void ZiyanUser_TraceToggleHandler(int signalNum);
+#endif
 
 /* Exported functions definition ---------------------------------------------*/
 int main(int argc, char **argv)
@@ -205,6 +345,34 @@ int main(int argc, char **argv)
         }
 #endif
 
+#if defined(CONFIG_MODULE_SAMPLE_FC_SUBSCRIPTION_ON) || defined(CONFIG_MODULE_SAMPLE_GIMBAL_EMU_ON)
+        returnCode = FcSubscriptionDispatcher_Init();
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("fc subscription dispatcher init error");
+        }
+#endif
+
+#if ZIYAN_TELEMETRY_RECORDER_ON
+        returnCode = ZiyanUser_StartTelemetryRecorder();
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("telemetry recorder init error");
+        }
+#endif
+
+#if ZIYAN_SUBSCRIPTION_HISTORY_ON
+        returnCode = ZiyanUser_StartSubscriptionHistory();
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("subscription history init error");
+        }
+#endif
+
+#if ZIYAN_TELEMETRY_BUS_ON
+        returnCode = ZiyanUser_StartTelemetryBus();
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("telemetry bus init error");
+        }
+#endif
+
 #ifdef CONFIG_MODULE_SAMPLE_FC_SUBSCRIPTION_ON
         returnCode = ZiyanTest_FcSubscriptionStartService();
         if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
@@ -306,17 +474,24 @@ int main(int argc, char **argv)
         USER_LOG_ERROR("start sdk application error");
     }
 
-    // if (pthread_create(&s_monitorThread, NULL, ZiyanUser_MonitorTask, NULL) != 0) {
-    //     USER_LOG_ERROR("create monitor task fail.");
-    // }
+#if ZIYAN_USE_SYSTEM_MONITOR
+    if (pthread_create(&s_monitorThread, NULL, ZiyanUser_MonitorTask, NULL) != 0) {
+        USER_LOG_ERROR("create monitor task fail.");
+    }
 
-    // if (pthread_setname_np(s_monitorThread, "monitor task") != 0) {
-    //     USER_LOG_ERROR("set name for monitor task fail.");
-    // }
+    if (pthread_setname_np(s_monitorThread, "monitor task") != 0) {
+        USER_LOG_ERROR("set name for monitor task fail.");
+    }
+#endif
 
-    while (1) {
+    // Modules are stopped here rather than in the signal handler, which may interrupt any of their threads.
+    while (!s_ziyanExitRequested) {
         sleep(1);
     }
+
+    ZiyanUser_NormalExit();
+
+    return 0;
 }
 
 /* Private functions definition-----------------------------------------------*/
@@ -349,6 +524,28 @@ static T_ZiyanReturnCode ZiyanUser_PrepareSystemEnvironment(void)
         .isSupportColor = true,
     };
 
+    T_LoggerFlightConfig flightConfig = {
+        .path = ZIYAN_LOG_FLIGHT_RECORDER_PATH,
+        .size = ZIYAN_LOG_FLIGHT_RECORDER_SIZE,
+        .recoverDirectory = ZIYAN_LOG_FOLDER_NAME,
+        .syncPeriodMs = ZIYAN_LOG_FLIGHT_SYNC_PERIOD_MS,
+    };
+    char flightRecoverPath[ZIYAN_LOG_PATH_MAX_SIZE] = {0};
+#if ZIYAN_USE_METRICS_EXPORTER
+    T_MetricsExporterConfig metricsExporterConfig = {
+        .unixSocketPath = ZIYAN_METRICS_UNIX_SOCKET_PATH,
+        .tcpPort = ZIYAN_METRICS_TCP_PORT,
+        .dumpPath = ZIYAN_METRICS_DUMP_PATH,
+        .dumpPeriodMs = ZIYAN_METRICS_DUMP_PERIOD_MS,
+    };
+#endif
+#if ZIYAN_USE_PROFILER
+    T_MonitorProfilerConfig profilerConfig = {
+        .frequencyHz = MONITOR_PROFILER_FREQUENCY_DEFAULT,
+        .outputDirectory = ZIYAN_LOG_FOLDER_NAME,
+    };
+#endif
+
     T_ZiyanLoggerConsole localRecordConsole = {
         .consoleLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG,
         .func = ZiyanUser_LocalWrite,
@@ -418,11 +615,29 @@ static T_ZiyanReturnCode ZiyanUser_PrepareSystemEnvironment(void)
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    if (ZiyanUser_LocalWriteFsInit(ZIYAN_LOG_PATH) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+    returnCode = LoggerAsync_Init(NULL);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        printf("async logger init error");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    returnCode = LoggerAsync_AddSink(STDOUT_FILENO, LOGGER_ASYNC_SINK_TYPE_TEXT, &s_ziyanConsoleSinkIndex);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        printf("add async logger console sink error");
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (ZiyanUser_LocalWriteFsInit(ZIYAN_LOG_FOLDER_NAME) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         printf("file system init error");
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
+    // Lines still queued in the asynchronous logger are lost on a crash, the flight recorder keeps the last ones.
+    returnCode = LoggerFlight_Init(&flightConfig, flightRecoverPath, sizeof(flightRecoverPath));
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        printf("flight recorder init error");
+    }
+
     returnCode = ZiyanLogger_AddConsole(&printConsole);
     if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         printf("add printf console error");
@@ -435,6 +650,35 @@ static T_ZiyanReturnCode ZiyanUser_PrepareSystemEnvironment(void)
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (strlen(flightRecoverPath) != 0) {
+        USER_LOG_WARN("Previous session ended abnormally, its last logs are recovered to %s.", flightRecoverPath);
+    }
+
+    UtilMetrics_RegisterCollector(ZiyanUser_CollectLoggerMetrics);
+#if ZIYAN_USE_METRICS_EXPORTER
+    returnCode = MetricsExporter_Start(&metricsExporterConfig);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("start metrics exporter error, stat:0x%08llX", returnCode);
+    }
+#endif
+#if ZIYAN_USE_PROFILER
+    returnCode = MonitorProfiler_Init(&profilerConfig);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("init profiler error, stat:0x%08llX", returnCode);
+    } else {
+        signal(SIGUSR2, ZiyanUser_ProfilerToggleHandler);
+    }
+#endif
+#if ZIYAN_USE_TRACE
+    UtilTrace_SetThreadName("main");
+    returnCode = MonitorTrace_Init(ZIYAN_LOG_FOLDER_NAME);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("init trace error, stat:0x%08llX", returnCode);
+    } else {
+        signal(SIGUSR1, ZiyanUser_TraceToggleHandler);
+    }
+#endif
+
 
 #if (CONFIG_HARDWARE_CONNECTION == ZIYAN_USE_UART_AND_USB_BULK_DEVICE)
     returnCode = ZiyanPlatform_RegHalUsbBulkHandler(&usbBulkHandler);
@@ -518,183 +762,326 @@ static T_ZiyanReturnCode ZiyanUser_FillInUserInfo(T_ZiyanUserInfo *userInfo)
 
 static T_ZiyanReturnCode ZiyanUser_PrintConsole(const uint8_t *data, uint16_t dataLen)
 {
-    USER_UTIL_UNUSED(dataLen);
-
-    printf("%s", data);
-
-    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return LoggerAsync_Write(s_ziyanConsoleSinkIndex, LoggerAsync_GetLineLevel(data, dataLen), data, dataLen);
 }
 
 static T_ZiyanReturnCode ZiyanUser_LocalWrite(const uint8_t *data, uint16_t dataLen)
 {
-    uint32_t realLen;
+    LoggerFlight_Write(data, dataLen);
 
-    if (s_ziyanLogFile == NULL) {
+    if (s_ziyanLogFileFd < 0) {
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
-    realLen = fwrite(data, 1, dataLen, s_ziyanLogFile);
-    fflush(s_ziyanLogFile);
-    if (realLen == dataLen) {
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    } else {
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
+#if ZIYAN_USE_BINARY_LOG
+    return LoggerBinary_ConsoleWrite(data, dataLen);
+#else
+    return LoggerAsync_Write(s_ziyanLogFileSinkIndex, LoggerAsync_GetLineLevel(data, dataLen), data, dataLen);
+#endif
 }
 
-static T_ZiyanReturnCode ZiyanUser_LocalWriteFsInit(const char *path)
+static T_ZiyanReturnCode ZiyanUser_LocalWriteFsInit(const char *folder)
 {
-    T_ZiyanReturnCode ziyanReturnCode = ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    char filePath[ZIYAN_LOG_PATH_MAX_SIZE];
-    char systemCmd[ZIYAN_SYSTEM_CMD_STR_MAX_SIZE];
-    char folderName[ZIYAN_LOG_FOLDER_NAME_MAX_SIZE];
-    time_t currentTime = time(NULL);
-    struct tm *localTime = localtime(&currentTime);
-    uint16_t logFileIndex = 0;
-    uint16_t currentLogFileIndex;
-    uint8_t ret;
-
-    if (localTime == NULL) {
-        printf("Get local time error.\r\n");
+    T_ZiyanReturnCode ziyanReturnCode;
+    T_LoggerRotateConfig rotateConfig = {
+        .directory = folder,
+        .baseName = ZIYAN_LOG_FILE_BASE_NAME,
+        .extension = ZIYAN_LOG_FILE_EXTENSION,
+        .fileSizeMax = ZIYAN_LOG_FILE_SIZE_MAX,
+        .totalSizeMax = ZIYAN_LOG_TOTAL_SIZE_MAX,
+        .fileCountMax = ZIYAN_LOG_MAX_COUNT,
+        .isCompressEnabled = ZIYAN_LOG_COMPRESS_ENABLE,
+#if ZIYAN_USE_BINARY_LOG
+        // Each file of a binary log starts with its own format table, so that it decodes on its own.
+        .FileOpen = LoggerBinary_WriteFileHeader,
+#endif
+    };
+
+    ziyanReturnCode = LoggerRotate_Init(&rotateConfig, &s_ziyanLogFileFd);
+    if (ziyanReturnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Open log file error, stat:0x%08llX.", ziyanReturnCode);
+        return ziyanReturnCode;
+    }
+
+#if ZIYAN_USE_BINARY_LOG
+    ziyanReturnCode = LoggerAsync_AddSink(s_ziyanLogFileFd, LOGGER_ASYNC_SINK_TYPE_BINARY, &s_ziyanLogFileSinkIndex);
+    if (ziyanReturnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        ziyanReturnCode = LoggerBinary_Init(s_ziyanLogFileSinkIndex, ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG);
+    }
+#else
+    ziyanReturnCode = LoggerAsync_AddSink(s_ziyanLogFileFd, LOGGER_ASYNC_SINK_TYPE_TEXT, &s_ziyanLogFileSinkIndex);
+#endif
+    if (ziyanReturnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        close(s_ziyanLogFileFd);
+        s_ziyanLogFileFd = -1;
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    if (access(ZIYAN_LOG_FOLDER_NAME, F_OK) != 0) {
-        sprintf(folderName, "mkdir %s", ZIYAN_LOG_FOLDER_NAME);
-        ret = system(folderName);
-        if (ret != 0) {
-            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
+    return LoggerAsync_SetSinkRotation(s_ziyanLogFileSinkIndex, ZIYAN_LOG_FILE_SIZE_MAX, LoggerRotate_NextFile);
+}
+
+#if ZIYAN_USE_SYSTEM_MONITOR
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-noreturn"
+#pragma GCC diagnostic ignored "-Wreturn-type"
+
+static void *ZiyanUser_MonitorTask(void *argument)
+{
+    uint32_t i = 0;
+    T_MonitorSamplerThread *thread;
+
+    USER_UTIL_UNUSED(argument);
+
+    if (MonitorSampler_Init() != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("monitor sampler init fail.");
+        return NULL;
     }
 
-    s_ziyanLogFileCnt = fopen(ZIYAN_LOG_INDEX_FILE_NAME, "rb+");
-    if (s_ziyanLogFileCnt == NULL) {
-        s_ziyanLogFileCnt = fopen(ZIYAN_LOG_INDEX_FILE_NAME, "wb+");
-        if (s_ziyanLogFileCnt == NULL) {
-            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    while (1) {
+        if (MonitorSampler_Sample(&s_monitorSnapshot) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("monitor sample fail.");
+            goto delay;
         }
-    } else {
-        ret = fseek(s_ziyanLogFileCnt, 0, SEEK_SET);
-        if (ret != 0) {
-            printf("Seek log count file error, ret: %d, errno: %d.\r\n", ret, errno);
-            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+
+        if (s_monitorSnapshot.intervalUs == 0) {
+            goto delay;
         }
 
-        ret = fread((uint16_t *) &logFileIndex, 1, sizeof(uint16_t), s_ziyanLogFileCnt);
-        if (ret != sizeof(uint16_t)) {
-            printf("Read log file index error.\r\n");
+        USER_LOG_DEBUG("system cpu: %.1f %%, process cpu: %.1f %%, rss: %llu kB (%+lld kB), available memory: %llu kB.",
+                       s_monitorSnapshot.systemPcpu, s_monitorSnapshot.processPcpu,
+                       (unsigned long long) (s_monitorSnapshot.rssBytes / 1024),
+                       (long long) (s_monitorSnapshot.rssBytesDelta / 1024),
+                       (unsigned long long) (s_monitorSnapshot.memAvailableBytes / 1024));
+        USER_LOG_DEBUG("threads: %u, started: %u, exited: %u.", s_monitorSnapshot.threadCount,
+                       s_monitorSnapshot.threadStartedCount, s_monitorSnapshot.threadExitedCount);
+        USER_LOG_DEBUG("tid\tname\tpcpu");
+        for (i = 0; i < s_monitorSnapshot.threadCount; ++i) {
+            thread = &s_monitorSnapshot.threads[i];
+            USER_LOG_DEBUG("%d\t%15s\t%.1f %%.", thread->tid, thread->name, thread->pcpu);
         }
+
+        UtilMetrics_GaugeSet(&s_systemPcpu, s_monitorSnapshot.systemPcpu);
+        UtilMetrics_GaugeSet(&s_processPcpu, s_monitorSnapshot.processPcpu);
+        UtilMetrics_GaugeSet(&s_processRss, (double) s_monitorSnapshot.rssBytes);
+        UtilMetrics_GaugeSet(&s_processThreadCount, s_monitorSnapshot.threadCount);
+        UtilMetrics_GaugeSet(&s_memAvailable, (double) s_monitorSnapshot.memAvailableBytes);
+        USER_LOG_DEBUG("monitor sample cost: %llu us.", (unsigned long long) (s_monitorSnapshot.sampleCpuNs / 1000));
+
+delay:
+        usleep(ZIYAN_MONITOR_PERIOD_MS * 1000);
     }
+}
 
-    currentLogFileIndex = logFileIndex;
-    logFileIndex++;
+#pragma GCC diagnostic pop
+#endif
 
-    ret = fseek(s_ziyanLogFileCnt, 0, SEEK_SET);
-    if (ret != 0) {
-        printf("Seek log file error, ret: %d, errno: %d.\r\n", ret, errno);
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+// // static T_ZiyanReturnCode ZiyanTest_HighPowerApplyPinInit()
+// // {
+// //     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+// // }
+
+// // static T_ZiyanReturnCode ZiyanTest_WriteHighPowerApplyPin(E_ZiyanPowerManagementPinState pinState)
+// // {
+// //     //attention: please pull up the HWPR pin state by hardware.
+// //     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+// // }
+
+static void ZiyanUser_CollectLoggerMetrics(void)
+{
+    T_LoggerAsyncStatistics asyncStatistics;
+    T_LoggerRotateStatistics rotateStatistics;
+    T_LoggerFlightStatistics flightStatistics;
+#if ZIYAN_TELEMETRY_RECORDER_ON
+    T_RecorderTelemetryStatistics telemetryStatistics;
+#endif
+#if ZIYAN_TELEMETRY_BUS_ON
+    T_BusTelemetryStatistics busStatistics;
+#endif
+
+    if (LoggerAsync_GetStatistics(&asyncStatistics) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        UtilMetrics_CounterSet(&s_loggerRecordCount, asyncStatistics.recordCount);
+        UtilMetrics_CounterSet(&s_loggerDroppedRecordCount, asyncStatistics.droppedRecordCount);
+        UtilMetrics_CounterSet(&s_loggerWrittenBytes, asyncStatistics.writtenBytes);
+        UtilMetrics_CounterSet(&s_loggerWriteErrorCount, asyncStatistics.writeErrorCount);
+        UtilMetrics_GaugeSet(&s_loggerP99CallLatency, asyncStatistics.p99CallLatencyNs);
     }
 
-    ret = fwrite((uint16_t *) &logFileIndex, 1, sizeof(uint16_t), s_ziyanLogFileCnt);
-    if (ret != sizeof(uint16_t)) {
-        printf("Write log file index error.\r\n");
-        fclose(s_ziyanLogFileCnt);
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    if (LoggerRotate_GetStatistics(&rotateStatistics) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        UtilMetrics_CounterSet(&s_loggerRotateCount, rotateStatistics.rotateCount);
+        UtilMetrics_GaugeSet(&s_loggerDiskUsage, (double) rotateStatistics.diskUsageBytes);
+    }
+
+    if (LoggerFlight_GetStatistics(&flightStatistics) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        UtilMetrics_CounterSet(&s_loggerFlightSlotCount, flightStatistics.writtenSlotCount);
+    }
+
+#if ZIYAN_TELEMETRY_RECORDER_ON
+    if (RecorderTelemetry_GetStatistics(&telemetryStatistics) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        UtilMetrics_CounterSet(&s_telemetryRecordCount, telemetryStatistics.recordCount);
+        UtilMetrics_CounterSet(&s_telemetryDroppedCount, telemetryStatistics.droppedCount);
+        UtilMetrics_CounterSet(&s_telemetrySegmentCount, telemetryStatistics.segmentCount);
     }
+#endif
 
-    fclose(s_ziyanLogFileCnt);
+#if ZIYAN_TELEMETRY_BUS_ON
+    if (BusTelemetry_GetStatistics(&busStatistics) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        UtilMetrics_CounterSet(&s_telemetryBusPublishedCount, busStatistics.publishedCount);
+        UtilMetrics_CounterSet(&s_telemetryBusDroppedCount, busStatistics.droppedCount);
+        UtilMetrics_CounterSet(&s_telemetryBusWakeCount, busStatistics.wakeCount);
+    }
+#endif
+}
 
-    sprintf(filePath, "%s_%04d_%04d%02d%02d_%02d-%02d-%02d.log", path, currentLogFileIndex,
-            localTime->tm_year + 1900, localTime->tm_mon + 1, localTime->tm_mday,
-            localTime->tm_hour, localTime->tm_min, localTime->tm_sec);
+#if ZIYAN_TELEMETRY_RECORDER_ON
+static T_ZiyanReturnCode ZiyanUser_StartTelemetryRecorder(void)
+{
+    T_ZiyanReturnCode returnCode;
+    T_RecorderTelemetryConfig telemetryConfig = {
+        .directory = ZIYAN_LOG_FOLDER_NAME,
+        .name = ZIYAN_TELEMETRY_NAME,
+        .segmentSize = ZIYAN_TELEMETRY_SEGMENT_SIZE,
+        .segmentCountMax = ZIYAN_TELEMETRY_SEGMENT_COUNT_MAX,
+        .stagingSize = ZIYAN_TELEMETRY_STAGING_SIZE,
+        .flushPeriodMs = ZIYAN_TELEMETRY_FLUSH_PERIOD_MS,
+    };
+    char indexPath[ZIYAN_LOG_PATH_MAX_SIZE];
 
-    s_ziyanLogFile = fopen(filePath, "wb+");
-    if (s_ziyanLogFile == NULL) {
-        USER_LOG_ERROR("Open filepath time error.");
-        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    returnCode = RecorderTelemetry_Init(&telemetryConfig, indexPath, sizeof(indexPath));
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Init telemetry recorder error: 0x%08llX.", returnCode);
+        return returnCode;
     }
 
-    if (logFileIndex >= ZIYAN_LOG_MAX_COUNT) {
-        sprintf(systemCmd, "rm -rf %s_%04d*.log", path, currentLogFileIndex - ZIYAN_LOG_MAX_COUNT);
-        ret = system(systemCmd);
-        if (ret != 0) {
-            printf("Remove file error, ret:%d.\r\n", ret);
-            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
+    returnCode = FcSubscriptionCache_AddObserver(ZiyanUser_RecordTelemetry);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Add telemetry recorder cache observer error: 0x%08llX.", returnCode);
+        RecorderTelemetry_DeInit();
+        return returnCode;
     }
 
-    return ziyanReturnCode;
+    USER_LOG_INFO("Recording telemetry to %s.", indexPath);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
-// #pragma GCC diagnostic push
-// #pragma GCC diagnostic ignored "-Wmissing-noreturn"
-// #pragma GCC diagnostic ignored "-Wreturn-type"
-
-// static void *ZiyanUser_MonitorTask(void *argument)
-// {
-//     unsigned int i = 0;
-//     unsigned int threadCount = 0;
-//     pid_t *tidList = NULL;
-//     T_ThreadAttribute *threadAttribute = NULL;
-//     T_ZiyanOsalHandler *osalHandler = ZiyanPlatform_GetOsalHandler();
-
-//     USER_UTIL_UNUSED(argument);
-
-//     while (1) {
-//         threadCount = Monitor_GetThreadCountOfProcess(getpid());
-//         tidList = osalHandler->Malloc(threadCount * sizeof(pid_t));
-//         if (tidList == NULL) {
-//             USER_LOG_ERROR("malloc fail.");
-//             goto delay;
-//         }
-//         Monitor_GetTidListOfProcess(getpid(), tidList, threadCount);
+// Runs in the subscription callbacks, values are only staged there.
+static void ZiyanUser_RecordTelemetry(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                      const T_ZiyanDataTimestamp *timestamp)
+{
+    RecorderTelemetry_Write((uint16_t) topic, data, dataSize, timestamp);
+}
+#endif
 
-//         threadAttribute = osalHandler->Malloc(threadCount * sizeof(T_ThreadAttribute));
-//         if (threadAttribute == NULL) {
-//             USER_LOG_ERROR("malloc fail.");
-//             goto freeTidList;
-//         }
-//         for (i = 0; i < threadCount; ++i) {
-//             threadAttribute[i].tid = tidList[i];
-//         }
+#if ZIYAN_SUBSCRIPTION_HISTORY_ON
+// Histories fill up once their topics are subscribed, by the samples or the dispatcher consumers.
+static T_ZiyanReturnCode ZiyanUser_StartSubscriptionHistory(void)
+{
+    const E_ZiyanFcSubscriptionTopic topics[] = {
+        ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION,
+        ZIYAN_FC_SUBSCRIPTION_TOPIC_VELOCITY,
+        ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED,
+    };
+    T_ZiyanReturnCode returnCode;
 
-//         USER_LOG_DEBUG("thread pcpu:");
-//         USER_LOG_DEBUG("tid\tname\tpcpu");
-//         for (i = 0; i < threadCount; ++i) {
-//             threadAttribute[i].pcpu = Monitor_GetPcpuOfThread(getpid(), tidList[i]);
-//             Monitor_GetNameOfThread(getpid(), tidList[i], threadAttribute[i].name, sizeof(threadAttribute[i].name));
-//             USER_LOG_DEBUG("%d\t%15s\t%f %%.", threadAttribute[i].tid, threadAttribute[i].name,
-//                            threadAttribute[i].pcpu);
-//         }
+    returnCode = FcSubscriptionHistory_Init();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Init subscription history error: 0x%08llX.", returnCode);
+        return returnCode;
+    }
 
-//         USER_LOG_DEBUG("heap used: %d B.", Monitor_GetHeapUsed(getpid()));
-//         USER_LOG_DEBUG("stack used: %d B.", Monitor_GetStackUsed(getpid()));
+    for (uint32_t i = 0; i < sizeof(topics) / sizeof(topics[0]); i++) {
+        returnCode = FcSubscriptionHistory_Enable(topics[i], ZIYAN_HISTORY_DEPTH);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("Enable history of topic 0x%08X error: 0x%08llX.", topics[i], returnCode);
+            return returnCode;
+        }
+    }
 
-//         osalHandler->Free(threadAttribute);
-// freeTidList:
-//         osalHandler->Free(tidList);
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+#endif
 
-// delay:
-//         sleep(10);
-//     }
-// }
+#if ZIYAN_TELEMETRY_BUS_ON
+static T_ZiyanReturnCode ZiyanUser_StartTelemetryBus(void)
+{
+    T_ZiyanReturnCode returnCode;
+    T_BusTelemetryConfig busConfig = {
+        .name = ZIYAN_TELEMETRY_BUS_NAME,
+        .segmentSize = ZIYAN_TELEMETRY_BUS_SIZE,
+        .historyDepth = ZIYAN_TELEMETRY_BUS_HISTORY_DEPTH,
+    };
 
-// // static T_ZiyanReturnCode ZiyanTest_HighPowerApplyPinInit()
-// // {
-// //     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-// // }
+    returnCode = BusTelemetry_Init(&busConfig);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Init telemetry bus error: 0x%08llX.", returnCode);
+        return returnCode;
+    }
 
-// // static T_ZiyanReturnCode ZiyanTest_WriteHighPowerApplyPin(E_ZiyanPowerManagementPinState pinState)
-// // {
-// //     //attention: please pull up the HWPR pin state by hardware.
-// //     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-// // }
+    returnCode = FcSubscriptionCache_AddObserver(ZiyanUser_PublishTelemetry);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Add telemetry bus cache observer error: 0x%08llX.", returnCode);
+        BusTelemetry_DeInit();
+        return returnCode;
+    }
+
+    USER_LOG_INFO("Publishing telemetry to /dev/shm%s.", ZIYAN_TELEMETRY_BUS_NAME);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+// Runs in the subscription callbacks, clients are woken there only when some are waiting.
+static void ZiyanUser_PublishTelemetry(E_ZiyanFcSubscriptionTopic topic, const uint8_t *data, uint16_t dataSize,
+                                       const T_ZiyanDataTimestamp *timestamp)
+{
+    BusTelemetry_Write((uint16_t) topic, data, dataSize, timestamp);
+}
+#endif
+
+static void ZiyanUser_NormalExit(void)
+{
+#if ZIYAN_USE_PROFILER
+    MonitorProfiler_Stop(NULL, 0);
+#endif
+#if ZIYAN_USE_TRACE
+    MonitorTrace_Stop(NULL, 0);
+#endif
+#if ZIYAN_USE_METRICS_EXPORTER
+    MetricsExporter_Stop();
+    MetricsExporter_DumpToFile(ZIYAN_METRICS_DUMP_PATH);
+#endif
+#if ZIYAN_TELEMETRY_RECORDER_ON
+    FcSubscriptionCache_RemoveObserver(ZiyanUser_RecordTelemetry);
+    RecorderTelemetry_DeInit();
+#endif
+#if ZIYAN_TELEMETRY_BUS_ON
+    FcSubscriptionCache_RemoveObserver(ZiyanUser_PublishTelemetry);
+    BusTelemetry_DeInit();
+#endif
+    LoggerAsync_Flush(ZIYAN_LOG_EXIT_FLUSH_TIMEOUT_MS);
+    LoggerFlight_DeInit();
+}
 
 static void ZiyanUser_NormalExitHandler(int signalNum)
 {
     USER_UTIL_UNUSED(signalNum);
-    exit(0);
+    s_ziyanExitRequested = 1;
+}
+
+#if ZIYAN_USE_PROFILER
+static void ZiyanUser_ProfilerToggleHandler(int signalNum)
+{
+    USER_UTIL_UNUSED(signalNum);
+    MonitorProfiler_ToggleFromSignal();
 }
+#endif
+
+#if ZIYAN_USE_TRACE
+static void ZiyanUser_TraceToggleHandler(int signalNum)
+{
+    USER_UTIL_UNUSED(signalNum);
+    MonitorTrace_ToggleFromSignal();
+}
+#endif
 
 #pragma GCC diagnostic pop
 
@@ -28,6 +28,7 @@
 #include "stdio.h"
 #include "hal_network.h"
 #include "ziyan_logger.h"
+#include "utils/util_log.h"
 
 /* Private constants ---------------------------------------------------------*/
 
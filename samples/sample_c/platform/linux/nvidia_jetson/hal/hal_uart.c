@@ -24,6 +24,8 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <ziyan_logger.h>
+#include <utils/util_log.h>
+#include <utils/util_metrics.h>
 #include "hal_uart.h"
 
 /* Private constants ---------------------------------------------------------*/
@@ -37,6 +39,12 @@ typedef struct {
 } T_UartHandleStruct;
 
 /* Private values -------------------------------------------------------------*/
+static T_UtilMetric s_uartWriteBytes = UTIL_METRICS_COUNTER("ziyan_transport_uart_write_bytes_total",
+                                                            "Bytes written to the UART.");
+static T_UtilMetric s_uartReadBytes = UTIL_METRICS_COUNTER("ziyan_transport_uart_read_bytes_total",
+                                                           "Bytes read from the UART.");
+static T_UtilMetric s_uartErrorCount = UTIL_METRICS_COUNTER("ziyan_transport_uart_errors_total",
+                                                            "Failed UART reads and writes.");
 
 /* Private functions declaration ---------------------------------------------*/
 
@@ -216,7 +224,9 @@ T_ZiyanReturnCode HalUart_WriteData(T_ZiyanUartHandle uartHandle, const uint8_t
     ret = write(uartHandleStruct->uartFd, buf, len);
     if (ret >= 0) {
         *realLen = ret;
+        UtilMetrics_CounterAdd(&s_uartWriteBytes, (uint64_t) ret);
     } else {
+        UtilMetrics_CounterAdd(&s_uartErrorCount, 1);
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
@@ -235,7 +245,9 @@ T_ZiyanReturnCode HalUart_ReadData(T_ZiyanUartHandle uartHandle, uint8_t *buf, u
     ret = read(uartHandleStruct->uartFd, buf, len);
     if (ret >= 0) {
         *realLen = ret;
+        UtilMetrics_CounterAdd(&s_uartReadBytes, (uint64_t) ret);
     } else {
+        UtilMetrics_CounterAdd(&s_uartErrorCount, 1);
         return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
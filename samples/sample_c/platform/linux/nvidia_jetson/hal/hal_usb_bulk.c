@@ -25,6 +25,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include "hal_usb_bulk.h"
 #include "ziyan_logger.h"
+#include "utils/util_log.h"
+#include "utils/util_metrics.h"
 
 /* Private constants ---------------------------------------------------------*/
 #define LINUX_USB_BULK_TRANSFER_TIMEOUT_MS    (50)
@@ -44,6 +46,12 @@ typedef struct {
 } T_HalUsbBulkObj;
 
 /* Private values -------------------------------------------------------------*/
+static T_UtilMetric s_usbBulkWriteBytes = UTIL_METRICS_COUNTER("ziyan_transport_usb_bulk_write_bytes_total",
+                                                               "Bytes written to the USB bulk channel.");
+static T_UtilMetric s_usbBulkReadBytes = UTIL_METRICS_COUNTER("ziyan_transport_usb_bulk_read_bytes_total",
+                                                              "Bytes read from the USB bulk channel.");
+static T_UtilMetric s_usbBulkErrorCount = UTIL_METRICS_COUNTER("ziyan_transport_usb_bulk_errors_total",
+                                                               "Failed USB bulk transfers.");
 
 /* Private functions declaration ---------------------------------------------*/
 
@@ -157,6 +165,7 @@ T_ZiyanReturnCode HalUsbBulk_WriteData(T_ZiyanUsbBulkHandle usbBulkHandle, const
                                    (uint8_t *) buf, len, &actualLen, LINUX_USB_BULK_TRANSFER_TIMEOUT_MS);
         if (ret < 0) {
             USER_LOG_ERROR("Write usb bulk data failed, errno = %d", ret);
+            UtilMetrics_CounterAdd(&s_usbBulkErrorCount, 1);
             return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
         }
 
@@ -166,6 +175,12 @@ T_ZiyanReturnCode HalUsbBulk_WriteData(T_ZiyanUsbBulkHandle usbBulkHandle, const
         *realLen = write(((T_HalUsbBulkObj *) usbBulkHandle)->ep1, buf, len);
     }
 
+    if ((int32_t) *realLen >= 0) {
+        UtilMetrics_CounterAdd(&s_usbBulkWriteBytes, *realLen);
+    } else {
+        UtilMetrics_CounterAdd(&s_usbBulkErrorCount, 1);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -188,6 +203,7 @@ T_ZiyanReturnCode HalUsbBulk_ReadData(T_ZiyanUsbBulkHandle usbBulkHandle, uint8_
                                    buf, len, &actualLen, LINUX_USB_BULK_TRANSFER_WAIT_FOREVER);
         if (ret < 0) {
             USER_LOG_ERROR("Read usb bulk data failed, errno = %d", ret);
+            UtilMetrics_CounterAdd(&s_usbBulkErrorCount, 1);
             return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
         }
 
@@ -197,6 +213,12 @@ T_ZiyanReturnCode HalUsbBulk_ReadData(T_ZiyanUsbBulkHandle usbBulkHandle, uint8_
         *realLen = read(((T_HalUsbBulkObj *) usbBulkHandle)->ep2, buf, len);
     }
 
+    if ((int32_t) *realLen >= 0) {
+        UtilMetrics_CounterAdd(&s_usbBulkReadBytes, *realLen);
+    } else {
+        UtilMetrics_CounterAdd(&s_usbBulkErrorCount, 1);
+    }
+
     return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
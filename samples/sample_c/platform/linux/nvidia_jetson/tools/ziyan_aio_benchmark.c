@@ -0,0 +1,459 @@
+/**
+ ********************************************************************
+ * @file    ziyan_aio_benchmark.c
+ * @brief   Host tool comparing the io_uring and thread pool backends of the aio engine with synchronous reads.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "osal/osal_aio.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define AIO_BENCHMARK_FILE_PATH                 "ziyan_aio_benchmark.bin"
+#define AIO_BENCHMARK_FILE_SIZE                 (256 * 1024 * 1024)
+#define AIO_BENCHMARK_BLOCK_SIZE                (64 * 1024) // about a media download packet train
+#define AIO_BENCHMARK_READ_COUNT                2048
+#define AIO_BENCHMARK_ALIGNMENT                 4096 // O_DIRECT needs block aligned buffers, offsets and sizes
+#define AIO_BENCHMARK_FILL_CHUNK_SIZE           (1024 * 1024)
+#define AIO_BENCHMARK_REAP_TIMEOUT_MS           10000
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    AIO_BENCHMARK_METHOD_SYNC = 0,
+    AIO_BENCHMARK_METHOD_IO_URING,
+    AIO_BENCHMARK_METHOD_THREAD_POOL,
+    AIO_BENCHMARK_METHOD_NUM,
+} E_AioBenchmarkMethod;
+
+typedef struct {
+    int fd;
+    uint64_t fileSize;
+    uint32_t blockSize;
+    uint32_t readCount;
+} T_AioBenchmarkConfig;
+
+typedef struct {
+    uint64_t readCount;
+    uint64_t byteCount;
+    uint64_t totalLatencyUs;
+    uint64_t maxLatencyUs;
+    uint64_t cpuNs;
+    uint64_t wallNs;
+} T_AioBenchmarkResult;
+
+typedef struct {
+    const T_AioBenchmarkConfig *config;
+    uint8_t *buffer;
+    uint32_t readCount;
+    uint64_t randomState;
+    T_AioBenchmarkResult result;
+    bool isFailed;
+} T_AioBenchmarkSyncWorker;
+
+/* Private functions declaration ---------------------------------------------*/
+static bool AioBenchmark_PrepareFile(const char *path, uint64_t fileSize);
+static bool AioBenchmark_Run(const T_AioBenchmarkConfig *config, E_AioBenchmarkMethod method, uint32_t queueDepth,
+                             T_AioBenchmarkResult *result);
+static bool AioBenchmark_RunSync(const T_AioBenchmarkConfig *config, uint32_t queueDepth, uint8_t *buffer,
+                                 T_AioBenchmarkResult *result);
+static void *AioBenchmark_SyncWorkerTask(void *arg);
+static bool AioBenchmark_RunAio(const T_AioBenchmarkConfig *config, E_OsalAioBackend backend, uint32_t queueDepth,
+                                uint8_t *buffer, T_AioBenchmarkResult *result);
+static uint64_t AioBenchmark_GetRandomOffset(const T_AioBenchmarkConfig *config, uint64_t *randomState);
+static uint64_t AioBenchmark_GetTimeNs(clockid_t clockId);
+
+/* Private values ------------------------------------------------------------*/
+static const uint32_t s_queueDepths[] = {1, 4, 16, 64};
+static const char *const s_methodNames[AIO_BENCHMARK_METHOD_NUM] = {"sync", "io_uring", "thread pool"};
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_AioBenchmarkConfig config = {
+        .fd = -1,
+        .fileSize = AIO_BENCHMARK_FILE_SIZE,
+        .blockSize = AIO_BENCHMARK_BLOCK_SIZE,
+        .readCount = AIO_BENCHMARK_READ_COUNT,
+    };
+    T_AioBenchmarkResult result;
+    const char *path = AIO_BENCHMARK_FILE_PATH;
+    double seconds;
+    bool isDirect = true;
+    bool isPassed = true;
+    uint32_t i;
+    uint32_t method;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:s:b:n:")) != -1) {
+        switch (opt) {
+            case 'f':
+                path = optarg;
+                break;
+            case 's':
+                config.fileSize = (uint64_t) strtoull(optarg, NULL, 0) * 1024 * 1024;
+                break;
+            case 'b':
+                config.blockSize = (uint32_t) strtoul(optarg, NULL, 0) * 1024;
+                break;
+            case 'n':
+                config.readCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-f file] [-s file size MB] [-b block size KB] [-n reads]\n"
+                                "  Put the file on the storage to test, e.g. the media card, and throttle it to the\n"
+                                "  bandwidth of the card under test with the cgroup io controller, e.g.\n"
+                                "    systemd-run --scope -p \"IOReadBandwidthMax=/dev/mmcblk1 20M\" \\\n"
+                                "      %s -f /media/aio.bin\n"
+                                "  or -p \"IOReadIOPSMax=/dev/mmcblk1 500\" for a seek bound card.\n",
+                        argv[0], argv[0]);
+                return 2;
+        }
+    }
+    if (config.blockSize == 0 || config.blockSize % AIO_BENCHMARK_ALIGNMENT != 0 || config.readCount == 0 ||
+        config.fileSize < config.blockSize) {
+        fprintf(stderr, "invalid options, the block size must be a multiple of %d KB and fit in the file\n",
+                AIO_BENCHMARK_ALIGNMENT / 1024);
+        return 2;
+    }
+
+    if (!AioBenchmark_PrepareFile(path, config.fileSize)) {
+        return 1;
+    }
+
+    // Bypass the page cache where the file system allows it, the storage is what is measured.
+    config.fd = open(path, O_RDONLY | O_DIRECT);
+    if (config.fd < 0) {
+        isDirect = false;
+        config.fd = open(path, O_RDONLY);
+    }
+    if (config.fd < 0) {
+        fprintf(stderr, "open %s error: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    printf("%u random reads of %u KB from %s (%llu MB, %s)\n\n", config.readCount, config.blockSize / 1024, path,
+           (unsigned long long) (config.fileSize / 1024 / 1024),
+           isDirect ? "O_DIRECT" : "page cache dropped before each run");
+    printf("%-12s %6s %10s %10s %12s %12s %8s\n", "method", "depth", "MB/s", "IOPS", "mean us", "max us", "CPU");
+
+    for (i = 0; i < sizeof(s_queueDepths) / sizeof(s_queueDepths[0]); i++) {
+        for (method = 0; method < AIO_BENCHMARK_METHOD_NUM; method++) {
+            if (!AioBenchmark_Run(&config, (E_AioBenchmarkMethod) method, s_queueDepths[i], &result)) {
+                printf("%-12s %6u %10s\n", s_methodNames[method], s_queueDepths[i], "n/a");
+                if (method != AIO_BENCHMARK_METHOD_IO_URING) {
+                    isPassed = false;
+                }
+                continue;
+            }
+
+            seconds = (double) result.wallNs / 1e9;
+            printf("%-12s %6u %10.1f %10.0f %12.1f %12llu %7.1f%%\n", s_methodNames[method], s_queueDepths[i],
+                   (double) result.byteCount / 1024 / 1024 / seconds, (double) result.readCount / seconds,
+                   (double) result.totalLatencyUs / (double) result.readCount,
+                   (unsigned long long) result.maxLatencyUs, (double) result.cpuNs * 100 / (double) result.wallNs);
+        }
+    }
+
+    close(config.fd);
+
+    return isPassed ? 0 : 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static bool AioBenchmark_PrepareFile(const char *path, uint64_t fileSize)
+{
+    struct stat fileStat;
+    uint8_t *chunk;
+    uint64_t written = 0;
+    uint64_t randomState = 0x9E3779B97F4A7C15ULL;
+    uint32_t i;
+    ssize_t ret;
+    int fd;
+
+    if (stat(path, &fileStat) == 0 && (uint64_t) fileStat.st_size >= fileSize) {
+        return true;
+    }
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "create %s error: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    chunk = malloc(AIO_BENCHMARK_FILL_CHUNK_SIZE);
+    if (chunk == NULL) {
+        close(fd);
+        return false;
+    }
+
+    printf("writing %llu MB test file %s\n", (unsigned long long) (fileSize / 1024 / 1024), path);
+    while (written < fileSize) {
+        for (i = 0; i < AIO_BENCHMARK_FILL_CHUNK_SIZE / sizeof(uint64_t); i++) {
+            randomState ^= randomState << 13;
+            randomState ^= randomState >> 7;
+            randomState ^= randomState << 17;
+            ((uint64_t *) chunk)[i] = randomState;
+        }
+
+        ret = write(fd, chunk, (size_t) USER_UTIL_MIN(fileSize - written, AIO_BENCHMARK_FILL_CHUNK_SIZE));
+        if (ret <= 0) {
+            fprintf(stderr, "write %s error: %s\n", path, strerror(errno));
+            break;
+        }
+        written += (uint64_t) ret;
+    }
+
+    free(chunk);
+    fsync(fd);
+    close(fd);
+
+    return written >= fileSize;
+}
+
+static bool AioBenchmark_Run(const T_AioBenchmarkConfig *config, E_AioBenchmarkMethod method, uint32_t queueDepth,
+                             T_AioBenchmarkResult *result)
+{
+    uint8_t *buffer = NULL;
+    uint64_t cpuStartNs;
+    uint64_t wallStartNs;
+    bool isSuccess = false;
+
+    if (posix_memalign((void **) &buffer, AIO_BENCHMARK_ALIGNMENT, (size_t) config->blockSize * queueDepth) != 0) {
+        return false;
+    }
+
+    memset(result, 0, sizeof(T_AioBenchmarkResult));
+    posix_fadvise(config->fd, 0, 0, POSIX_FADV_DONTNEED);
+
+    cpuStartNs = AioBenchmark_GetTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+    wallStartNs = AioBenchmark_GetTimeNs(CLOCK_MONOTONIC);
+
+    switch (method) {
+        case AIO_BENCHMARK_METHOD_SYNC:
+            isSuccess = AioBenchmark_RunSync(config, queueDepth, buffer, result);
+            break;
+        case AIO_BENCHMARK_METHOD_IO_URING:
+            isSuccess = AioBenchmark_RunAio(config, OSAL_AIO_BACKEND_IO_URING, queueDepth, buffer, result);
+            break;
+        case AIO_BENCHMARK_METHOD_THREAD_POOL:
+            isSuccess = AioBenchmark_RunAio(config, OSAL_AIO_BACKEND_THREAD_POOL, queueDepth, buffer, result);
+            break;
+        default:
+            break;
+    }
+
+    result->cpuNs = AioBenchmark_GetTimeNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStartNs;
+    result->wallNs = AioBenchmark_GetTimeNs(CLOCK_MONOTONIC) - wallStartNs;
+    free(buffer);
+
+    return isSuccess && result->readCount != 0;
+}
+
+// Synchronous reads at queue depth N are N threads each blocked in pread(), as the media task would do it.
+static bool AioBenchmark_RunSync(const T_AioBenchmarkConfig *config, uint32_t queueDepth, uint8_t *buffer,
+                                 T_AioBenchmarkResult *result)
+{
+    T_AioBenchmarkSyncWorker *workers;
+    pthread_t *threads;
+    bool isSuccess = true;
+    uint32_t startedCount = 0;
+    uint32_t i;
+
+    workers = calloc(queueDepth, sizeof(T_AioBenchmarkSyncWorker));
+    threads = calloc(queueDepth, sizeof(pthread_t));
+    if (workers == NULL || threads == NULL) {
+        free(workers);
+        free(threads);
+        return false;
+    }
+
+    for (i = 0; i < queueDepth; i++) {
+        workers[i].config = config;
+        workers[i].buffer = buffer + (size_t) i * config->blockSize;
+        workers[i].readCount = config->readCount / queueDepth + (i < config->readCount % queueDepth ? 1 : 0);
+        workers[i].randomState = 0x9E3779B97F4A7C15ULL + i;
+        if (pthread_create(&threads[i], NULL, AioBenchmark_SyncWorkerTask, &workers[i]) != 0) {
+            isSuccess = false;
+            break;
+        }
+        startedCount++;
+    }
+
+    for (i = 0; i < startedCount; i++) {
+        pthread_join(threads[i], NULL);
+        result->readCount += workers[i].result.readCount;
+        result->byteCount += workers[i].result.byteCount;
+        result->totalLatencyUs += workers[i].result.totalLatencyUs;
+        result->maxLatencyUs = USER_UTIL_MAX(result->maxLatencyUs, workers[i].result.maxLatencyUs);
+        isSuccess = isSuccess && !workers[i].isFailed;
+    }
+
+    free(workers);
+    free(threads);
+
+    return isSuccess;
+}
+
+static void *AioBenchmark_SyncWorkerTask(void *arg)
+{
+    T_AioBenchmarkSyncWorker *worker = arg;
+    uint64_t startNs;
+    uint64_t latencyUs;
+    uint32_t i;
+    ssize_t ret;
+
+    for (i = 0; i < worker->readCount; i++) {
+        startNs = AioBenchmark_GetTimeNs(CLOCK_MONOTONIC);
+        ret = pread(worker->config->fd, worker->buffer, worker->config->blockSize,
+                    (off_t) AioBenchmark_GetRandomOffset(worker->config, &worker->randomState));
+        if (ret < 0) {
+            worker->isFailed = true;
+            break;
+        }
+        latencyUs = (AioBenchmark_GetTimeNs(CLOCK_MONOTONIC) - startNs) / 1000;
+
+        worker->result.readCount++;
+        worker->result.byteCount += (uint64_t) ret;
+        worker->result.totalLatencyUs += latencyUs;
+        worker->result.maxLatencyUs = USER_UTIL_MAX(worker->result.maxLatencyUs, latencyUs);
+    }
+
+    return NULL;
+}
+
+static bool AioBenchmark_RunAio(const T_AioBenchmarkConfig *config, E_OsalAioBackend backend, uint32_t queueDepth,
+                                uint8_t *buffer, T_AioBenchmarkResult *result)
+{
+    T_OsalAioHandle aio = NULL;
+    T_OsalAioBuffer registeredBuffer = {.buf = buffer, .len = config->blockSize * queueDepth};
+    T_OsalAioRequest request = {0};
+    T_OsalAioCompletion *completions = NULL;
+    T_OsalAioStatistics statistics;
+    uint64_t randomState = 0x9E3779B97F4A7C15ULL;
+    uint32_t submittedCount = 0;
+    uint32_t completedCount = 0;
+    uint32_t count;
+    uint32_t i;
+    uintptr_t slot;
+    bool isSuccess = false;
+
+    if (Osal_AioCreateOnBackend(backend, queueDepth, &aio) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return false;
+    }
+
+    completions = calloc(queueDepth, sizeof(T_OsalAioCompletion));
+    if (completions == NULL ||
+        Osal_AioRegisterBuffers(aio, &registeredBuffer, 1) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    // Each slot of the registered buffer is owned by one request, a completion hands its slot to the next read.
+    request.type = OSAL_AIO_OP_READ;
+    request.fd = config->fd;
+    request.len = config->blockSize;
+    request.bufIndex = 0;
+    for (slot = 0; slot < queueDepth && submittedCount < config->readCount; slot++) {
+        request.offset = AioBenchmark_GetRandomOffset(config, &randomState);
+        request.buf = buffer + slot * config->blockSize;
+        request.userData = (void *) slot;
+        if (Osal_AioPrepare(aio, &request) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            goto out;
+        }
+        submittedCount++;
+    }
+
+    while (completedCount < submittedCount) {
+        if (Osal_AioSubmit(aio, &count) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+            Osal_AioReap(aio, completions, queueDepth, 1, AIO_BENCHMARK_REAP_TIMEOUT_MS, &count) !=
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            goto out;
+        }
+
+        for (i = 0; i < count; i++) {
+            if (completions[i].result < 0) {
+                goto out;
+            }
+            completedCount++;
+            result->byteCount += (uint64_t) completions[i].result;
+
+            if (submittedCount < config->readCount) {
+                slot = (uintptr_t) completions[i].userData;
+                request.offset = AioBenchmark_GetRandomOffset(config, &randomState);
+                request.buf = buffer + slot * config->blockSize;
+                request.userData = (void *) slot;
+                if (Osal_AioPrepare(aio, &request) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+                    goto out;
+                }
+                submittedCount++;
+            }
+        }
+    }
+
+    Osal_AioGetStatistics(aio, &statistics);
+    result->readCount = completedCount;
+    result->totalLatencyUs = statistics.totalLatencyUs;
+    result->maxLatencyUs = statistics.maxLatencyUs;
+    isSuccess = true;
+
+out:
+    // Requests still in flight own parts of the buffer, let them land before it is freed.
+    while (completedCount < submittedCount && completions != NULL &&
+           Osal_AioReap(aio, completions, queueDepth, 1, AIO_BENCHMARK_REAP_TIMEOUT_MS, &count) ==
+           ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        completedCount += count;
+    }
+    Osal_AioDestroy(aio);
+    free(completions);
+
+    return isSuccess;
+}
+
+static uint64_t AioBenchmark_GetRandomOffset(const T_AioBenchmarkConfig *config, uint64_t *randomState)
+{
+    uint64_t blockCount = config->fileSize / config->blockSize;
+
+    *randomState ^= *randomState << 13;
+    *randomState ^= *randomState >> 7;
+    *randomState ^= *randomState << 17;
+
+    return (*randomState % blockCount) * config->blockSize;
+}
+
+static uint64_t AioBenchmark_GetTimeNs(clockid_t clockId)
+{
+    struct timespec time;
+
+    clock_gettime(clockId, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,380 @@
+/**
+ ********************************************************************
+ * @file    ziyan_attitude_benchmark.c
+ * @brief   Host tool checking the accuracy and speed of util_attitude.c against the double precision conversion.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "utils/util_attitude.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define ATTITUDE_BENCHMARK_SAMPLE_COUNT         65536
+#define ATTITUDE_BENCHMARK_ROUND_COUNT          20
+#define ATTITUDE_BENCHMARK_GIMBAL_LOCK_PITCH    899.0f // unit: 0.1 degree, roll and yaw are undefined beyond it
+#define ATTITUDE_BENCHMARK_ANGLE_TOLERANCE      0.01f // unit: 0.1 degree
+#define ATTITUDE_BENCHMARK_VECTOR_TOLERANCE     1e-5f
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    const char *name;
+    double maxError;
+    double tolerance;
+} T_AttitudeBenchmarkCheck;
+
+/* Private functions declaration ---------------------------------------------*/
+static void AttitudeBenchmark_ReferenceQuaternionToEuler(const T_ZiyanQuaternion4f *quaternion,
+                                                         T_ZiyanAttitude3f *attitude);
+static void AttitudeBenchmark_FormerQuaternionToEuler(const T_ZiyanQuaternion4f *quaternion,
+                                                      T_ZiyanAttitude3f *attitude);
+static void AttitudeBenchmark_GenerateQuaternions(T_ZiyanQuaternion4f *quaternions, uint32_t count);
+static double AttitudeBenchmark_GetEulerError(const T_ZiyanAttitude3f *attitude, const T_ZiyanAttitude3f *reference);
+static bool AttitudeBenchmark_Report(const T_AttitudeBenchmarkCheck *check);
+static double AttitudeBenchmark_GetTimeNs(void);
+
+/* Private values ------------------------------------------------------------*/
+static uint64_t s_randomState = 0x9E3779B97F4A7C15ULL;
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_ZiyanQuaternion4f *quaternions;
+    T_ZiyanAttitude3f *references;
+    T_ZiyanAttitude3f *attitudes;
+    T_ZiyanVector3f *vectors;
+    T_ZiyanVector3f *rotatedVectors;
+    T_ZiyanQuaternion4f quaternion;
+    T_ZiyanQuaternion4f from;
+    T_ZiyanQuaternion4f to;
+    T_ZiyanAttitude3f attitude;
+    T_ZiyanVector3f vector;
+    T_UtilAttitudeMatrix matrix;
+    T_AttitudeBenchmarkCheck check;
+    uint32_t sampleCount = ATTITUDE_BENCHMARK_SAMPLE_COUNT;
+    uint32_t roundCount = ATTITUDE_BENCHMARK_ROUND_COUNT;
+    bool isPassed = true;
+    double startNs;
+    double referenceNs;
+    double scalarNs;
+    double batchNs;
+    uint32_t round;
+    uint32_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+            case 'n':
+                sampleCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                roundCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n samples] [-r rounds]\n"
+                                "  Build with optimizations, e.g. -DCMAKE_BUILD_TYPE=Release, for meaningful timings.\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    sampleCount = USER_UTIL_MAX(sampleCount, 16);
+    roundCount = USER_UTIL_MAX(roundCount, 1);
+
+    quaternions = malloc(sampleCount * sizeof(T_ZiyanQuaternion4f));
+    references = malloc(sampleCount * sizeof(T_ZiyanAttitude3f));
+    attitudes = malloc(sampleCount * sizeof(T_ZiyanAttitude3f));
+    vectors = malloc(sampleCount * sizeof(T_ZiyanVector3f));
+    rotatedVectors = malloc(sampleCount * sizeof(T_ZiyanVector3f));
+    if (quaternions == NULL || references == NULL || attitudes == NULL || vectors == NULL || rotatedVectors == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    AttitudeBenchmark_GenerateQuaternions(quaternions, sampleCount);
+    for (i = 0; i < sampleCount; i++) {
+        AttitudeBenchmark_ReferenceQuaternionToEuler(&quaternions[i], &references[i]);
+        vectors[i].x = (ziyan_f32_t) quaternions[(i + 1) % sampleCount].q1;
+        vectors[i].y = (ziyan_f32_t) quaternions[(i + 1) % sampleCount].q2;
+        vectors[i].z = (ziyan_f32_t) quaternions[(i + 1) % sampleCount].q3;
+    }
+
+    printf("%-40s %12s %12s\n", "accuracy check, unit: 0.1 degree", "max error", "tolerance");
+
+    // reported only, asin of not exactly unit quaternions is off by up to 0.02 degree near +-90 degree pitch
+    check.name = "quaternion to euler, former gimbal code";
+    check.maxError = 0;
+    check.tolerance = INFINITY;
+    for (i = 0; i < sampleCount; i++) {
+        AttitudeBenchmark_FormerQuaternionToEuler(&quaternions[i], &attitude);
+        check.maxError = USER_UTIL_MAX(check.maxError, AttitudeBenchmark_GetEulerError(&attitude, &references[i]));
+    }
+    AttitudeBenchmark_Report(&check);
+
+    check.name = "quaternion to euler, scalar";
+    check.maxError = 0;
+    check.tolerance = ATTITUDE_BENCHMARK_ANGLE_TOLERANCE;
+    for (i = 0; i < sampleCount; i++) {
+        UtilAttitude_QuaternionToEuler(&quaternions[i], &attitude);
+        check.maxError = USER_UTIL_MAX(check.maxError, AttitudeBenchmark_GetEulerError(&attitude, &references[i]));
+    }
+    isPassed &= AttitudeBenchmark_Report(&check);
+
+    check.name = "quaternion to euler, batch";
+    check.maxError = 0;
+    UtilAttitude_QuaternionToEulerBatch(quaternions, attitudes, sampleCount);
+    for (i = 0; i < sampleCount; i++) {
+        check.maxError = USER_UTIL_MAX(check.maxError, AttitudeBenchmark_GetEulerError(&attitudes[i], &references[i]));
+    }
+    isPassed &= AttitudeBenchmark_Report(&check);
+
+    check.name = "quaternion to matrix to euler";
+    check.maxError = 0;
+    for (i = 0; i < sampleCount; i++) {
+        UtilAttitude_QuaternionToMatrix(&quaternions[i], &matrix);
+        UtilAttitude_MatrixToEuler(&matrix, &attitude);
+        check.maxError = USER_UTIL_MAX(check.maxError, AttitudeBenchmark_GetEulerError(&attitude, &references[i]));
+    }
+    isPassed &= AttitudeBenchmark_Report(&check);
+
+    check.name = "euler to quaternion to euler";
+    check.maxError = 0;
+    check.tolerance = 2 * ATTITUDE_BENCHMARK_ANGLE_TOLERANCE;
+    for (i = 0; i < sampleCount; i++) {
+        if (fabsf(references[i].pitch) > ATTITUDE_BENCHMARK_GIMBAL_LOCK_PITCH) {
+            continue;
+        }
+        UtilAttitude_EulerToQuaternion(&references[i], &quaternion);
+        UtilAttitude_QuaternionToEuler(&quaternion, &attitude);
+        check.maxError = USER_UTIL_MAX(check.maxError, AttitudeBenchmark_GetEulerError(&attitude, &references[i]));
+    }
+    isPassed &= AttitudeBenchmark_Report(&check);
+
+    check.name = "rotate vector, batch against matrix";
+    check.maxError = 0;
+    check.tolerance = ATTITUDE_BENCHMARK_VECTOR_TOLERANCE;
+    UtilAttitude_RotateVectorBatch(quaternions, vectors, rotatedVectors, sampleCount);
+    for (i = 0; i < sampleCount; i++) {
+        UtilAttitude_QuaternionToMatrix(&quaternions[i], &matrix);
+        vector.x = matrix.m[0][0] * vectors[i].x + matrix.m[0][1] * vectors[i].y + matrix.m[0][2] * vectors[i].z;
+        vector.y = matrix.m[1][0] * vectors[i].x + matrix.m[1][1] * vectors[i].y + matrix.m[1][2] * vectors[i].z;
+        vector.z = matrix.m[2][0] * vectors[i].x + matrix.m[2][1] * vectors[i].y + matrix.m[2][2] * vectors[i].z;
+        check.maxError = USER_UTIL_MAX(check.maxError, fabs(vector.x - rotatedVectors[i].x));
+        check.maxError = USER_UTIL_MAX(check.maxError, fabs(vector.y - rotatedVectors[i].y));
+        check.maxError = USER_UTIL_MAX(check.maxError, fabs(vector.z - rotatedVectors[i].z));
+    }
+    isPassed &= AttitudeBenchmark_Report(&check);
+
+    // the middle of a rotation of 2a about an axis is the rotation of a, whatever the sign of the quaternions
+    check.name = "slerp, half of a yaw rotation";
+    check.maxError = 0;
+    check.tolerance = ATTITUDE_BENCHMARK_ANGLE_TOLERANCE;
+    for (i = 0; i < 3600; i++) {
+        attitude.pitch = 0;
+        attitude.roll = 0;
+        attitude.yaw = 0;
+        UtilAttitude_EulerToQuaternion(&attitude, &from);
+        attitude.yaw = UtilAttitude_WrapAngle((ziyan_f32_t) i * 0.1f);
+        UtilAttitude_EulerToQuaternion(&attitude, &to);
+        if (i % 2 == 1) {
+            to.q0 = -to.q0;
+            to.q1 = -to.q1;
+            to.q2 = -to.q2;
+            to.q3 = -to.q3;
+        }
+        UtilAttitude_Slerp(&from, &to, 0.5f, &quaternion);
+        UtilAttitude_QuaternionToEuler(&quaternion, &attitude);
+        check.maxError = USER_UTIL_MAX(check.maxError, fabs(UtilAttitude_WrapAngle(
+            attitude.yaw - UtilAttitude_WrapAngle((ziyan_f32_t) i * 0.1f) / 2)));
+        check.maxError = USER_UTIL_MAX(check.maxError, fabs(attitude.pitch) + fabs(attitude.roll));
+    }
+    isPassed &= AttitudeBenchmark_Report(&check);
+
+    printf("\n%-40s %12s\n", "speed", "ns/sample");
+
+    startNs = AttitudeBenchmark_GetTimeNs();
+    for (round = 0; round < roundCount; round++) {
+        for (i = 0; i < sampleCount; i++) {
+            AttitudeBenchmark_FormerQuaternionToEuler(&quaternions[i], &attitudes[i]);
+        }
+    }
+    referenceNs = (AttitudeBenchmark_GetTimeNs() - startNs) / roundCount / sampleCount;
+    printf("%-40s %12.2f\n", "quaternion to euler, former gimbal code", referenceNs);
+
+    startNs = AttitudeBenchmark_GetTimeNs();
+    for (round = 0; round < roundCount; round++) {
+        for (i = 0; i < sampleCount; i++) {
+            UtilAttitude_QuaternionToEuler(&quaternions[i], &attitudes[i]);
+        }
+    }
+    scalarNs = (AttitudeBenchmark_GetTimeNs() - startNs) / roundCount / sampleCount;
+    printf("%-40s %12.2f\n", "quaternion to euler, scalar", scalarNs);
+
+    startNs = AttitudeBenchmark_GetTimeNs();
+    for (round = 0; round < roundCount; round++) {
+        UtilAttitude_QuaternionToEulerBatch(quaternions, attitudes, sampleCount);
+    }
+    batchNs = (AttitudeBenchmark_GetTimeNs() - startNs) / roundCount / sampleCount;
+    printf("%-40s %12.2f (%.1fx former)\n", "quaternion to euler, batch", batchNs, referenceNs / batchNs);
+
+    startNs = AttitudeBenchmark_GetTimeNs();
+    for (round = 0; round < roundCount; round++) {
+        for (i = 0; i < sampleCount; i++) {
+            UtilAttitude_RotateVector(&quaternions[i], &vectors[i], &rotatedVectors[i]);
+        }
+    }
+    scalarNs = (AttitudeBenchmark_GetTimeNs() - startNs) / roundCount / sampleCount;
+    printf("%-40s %12.2f\n", "rotate vector, scalar", scalarNs);
+
+    startNs = AttitudeBenchmark_GetTimeNs();
+    for (round = 0; round < roundCount; round++) {
+        UtilAttitude_RotateVectorBatch(quaternions, vectors, rotatedVectors, sampleCount);
+    }
+    batchNs = (AttitudeBenchmark_GetTimeNs() - startNs) / roundCount / sampleCount;
+    printf("%-40s %12.2f (%.1fx scalar)\n", "rotate vector, batch", batchNs, scalarNs / batchNs);
+
+    free(quaternions);
+    free(references);
+    free(attitudes);
+    free(vectors);
+    free(rotatedVectors);
+
+    printf("\n%s\n", isPassed ? "PASSED" : "FAILED");
+
+    return isPassed ? 0 : 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+/**
+ * @brief Exact attitude of the quaternion, normalized in double precision as float quaternions are only unit within
+ * rounding errors, which matter near +-90 degree pitch.
+ */
+static void AttitudeBenchmark_ReferenceQuaternionToEuler(const T_ZiyanQuaternion4f *quaternion,
+                                                         T_ZiyanAttitude3f *attitude)
+{
+    double norm = sqrt((double) quaternion->q0 * quaternion->q0 + (double) quaternion->q1 * quaternion->q1 +
+                       (double) quaternion->q2 * quaternion->q2 + (double) quaternion->q3 * quaternion->q3);
+    double q0 = quaternion->q0 / norm;
+    double q1 = quaternion->q1 / norm;
+    double q2 = quaternion->q2 / norm;
+    double q3 = quaternion->q3 / norm;
+    double sinPitch = USER_UTIL_MAX(USER_UTIL_MIN(2 * (q0 * q2 - q3 * q1), 1.0), -1.0);
+
+    attitude->pitch = (ziyan_f32_t) (asin(sinPitch) * 1800 / M_PI);
+    attitude->roll = (ziyan_f32_t) (atan2(2 * (q0 * q1 + q2 * q3), 1 - 2 * (q1 * q1 + q2 * q2)) * 1800 / M_PI);
+    attitude->yaw = (ziyan_f32_t) (atan2(2 * (q0 * q3 + q1 * q2), 1 - 2 * (q2 * q2 + q3 * q3)) * 1800 / M_PI);
+}
+
+/**
+ * @brief Conversion formerly done by the gimbal emulator.
+ */
+static void AttitudeBenchmark_FormerQuaternionToEuler(const T_ZiyanQuaternion4f *quaternion,
+                                                      T_ZiyanAttitude3f *attitude)
+{
+    double aircraftPitchInRad;
+    double aircraftRollInRad;
+    double aircraftYawInRad;
+
+    aircraftPitchInRad = asin(2 * ((double) quaternion->q0 * quaternion->q2 -
+                                   (double) quaternion->q3 * quaternion->q1));
+    attitude->pitch = aircraftPitchInRad * 180 / ZIYAN_PI * 10;
+
+    aircraftRollInRad = atan2(2 * ((double) quaternion->q0 * quaternion->q1 + (double) quaternion->q2 * quaternion->q3),
+                              (double) 1 -
+                              2 * ((double) quaternion->q1 * quaternion->q1 + (double) quaternion->q2 * quaternion->q2));
+    attitude->roll = aircraftRollInRad * 180 / ZIYAN_PI * 10;
+
+    aircraftYawInRad = atan2(2 * ((double) quaternion->q0 * quaternion->q3 + (double) quaternion->q1 * quaternion->q2),
+                             (double) 1 -
+                             2 * ((double) quaternion->q2 * quaternion->q2 + (double) quaternion->q3 * quaternion->q3));
+    attitude->yaw = aircraftYawInRad * 180 / ZIYAN_PI * 10;
+}
+
+/**
+ * @brief Random unit quaternions, the first ones on the edges: identity, +-90 degree pitch, 180 degree yaw and roll.
+ */
+static void AttitudeBenchmark_GenerateQuaternions(T_ZiyanQuaternion4f *quaternions, uint32_t count)
+{
+    static const T_ZiyanQuaternion4f edges[] = {
+        {1, 0, 0, 0}, {0.70710678f, 0, 0.70710678f, 0}, {0.70710678f, 0, -0.70710678f, 0}, {0, 0, 0, 1},
+        {0, 1, 0, 0}, {-1, 0, 0, 0}, {0.5f, 0.5f, 0.5f, 0.5f}, {0.5f, -0.5f, 0.5f, -0.5f},
+    };
+    T_ZiyanQuaternion4f *quaternion;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        quaternion = &quaternions[i];
+        if (i < sizeof(edges) / sizeof(edges[0])) {
+            *quaternion = edges[i];
+            continue;
+        }
+
+        s_randomState = s_randomState * 6364136223846793005ULL + 1442695040888963407ULL;
+        quaternion->q0 = (ziyan_f32_t) ((s_randomState >> 40) & 0xFFFF) / 32768.0f - 1;
+        quaternion->q1 = (ziyan_f32_t) ((s_randomState >> 24) & 0xFFFF) / 32768.0f - 1;
+        s_randomState = s_randomState * 6364136223846793005ULL + 1442695040888963407ULL;
+        quaternion->q2 = (ziyan_f32_t) ((s_randomState >> 40) & 0xFFFF) / 32768.0f - 1;
+        quaternion->q3 = (ziyan_f32_t) ((s_randomState >> 24) & 0xFFFF) / 32768.0f - 1;
+        UtilAttitude_QuaternionNormalize(quaternion);
+    }
+}
+
+/**
+ * @return Largest wrapped axis difference, roll and yaw are skipped near +-90 degree pitch where they are undefined.
+ */
+static double AttitudeBenchmark_GetEulerError(const T_ZiyanAttitude3f *attitude, const T_ZiyanAttitude3f *reference)
+{
+    double error = fabs(attitude->pitch - reference->pitch);
+
+    if (fabsf(reference->pitch) > ATTITUDE_BENCHMARK_GIMBAL_LOCK_PITCH) {
+        return error;
+    }
+
+    error = USER_UTIL_MAX(error, fabs(UtilAttitude_WrapAngle(attitude->roll - reference->roll)));
+    error = USER_UTIL_MAX(error, fabs(UtilAttitude_WrapAngle(attitude->yaw - reference->yaw)));
+
+    return error;
+}
+
+static bool AttitudeBenchmark_Report(const T_AttitudeBenchmarkCheck *check)
+{
+    bool isPassed = check->maxError <= check->tolerance;
+
+    printf("%-40s %12.3g %12.3g %s\n", check->name, check->maxError, check->tolerance,
+           isinf(check->tolerance) ? "" : isPassed ? "ok" : "FAILED");
+
+    return isPassed;
+}
+
+static double AttitudeBenchmark_GetTimeNs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,467 @@
+/**
+ ********************************************************************
+ * @file    ziyan_bus_benchmark.c
+ * @brief   Host tool comparing the latency and CPU of the telemetry bus with a UDP relay between processes.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "bus/bus_client.h"
+#include "bus/bus_telemetry.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define BUS_BENCHMARK_VALUE_COUNT               5000
+#define BUS_BENCHMARK_RATE                      1000 // unit: Hz
+#define BUS_BENCHMARK_CLIENT_COUNT              3 // e.g. mapping, detection and logging
+#define BUS_BENCHMARK_CLIENT_MAX                16
+#define BUS_BENCHMARK_DATA_SIZE                 64 // unit: byte, about the size of a fused position
+#define BUS_BENCHMARK_HISTORY_DEPTH             64
+#define BUS_BENCHMARK_SEGMENT_SIZE              (1024 * 1024)
+#define BUS_BENCHMARK_TOPIC                     0
+#define BUS_BENCHMARK_TIMEOUT_MS                1000
+#define BUS_BENCHMARK_NAME_MAX_SIZE             64
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    BUS_BENCHMARK_TRANSPORT_BUS = 0,
+    BUS_BENCHMARK_TRANSPORT_UDP,
+} E_BusBenchmarkTransport;
+
+// What the relay serializes per value, the record and the value following it.
+typedef struct {
+    uint16_t topic;
+    uint16_t dataSize; /*!< 0 ends the relay. */
+    uint32_t reserved;
+    T_BusTelemetryRecord record;
+} __attribute__((packed)) T_BusBenchmarkPacket;
+
+typedef struct {
+    uint64_t receivedCount;
+    uint64_t lostCount;
+    uint64_t latencyP50Ns;
+    uint64_t latencyP99Ns;
+    uint64_t latencyMaxNs;
+    uint64_t cpuNs;
+    uint64_t wallNs;
+} T_BusBenchmarkResult;
+
+typedef struct {
+    E_BusBenchmarkTransport transport;
+    uint32_t valueCount;
+    uint32_t rate;
+    uint32_t clientCount;
+    uint16_t dataSize;
+    char busName[BUS_BENCHMARK_NAME_MAX_SIZE];
+} T_BusBenchmarkConfig;
+
+/* Private functions declaration ---------------------------------------------*/
+static bool BusBenchmark_Run(const T_BusBenchmarkConfig *config);
+static void BusBenchmark_RunClient(const T_BusBenchmarkConfig *config, int readyFd, int resultFd);
+static void BusBenchmark_ReceiveBus(const T_BusBenchmarkConfig *config, int readyFd, uint64_t *latenciesNs,
+                                    T_BusBenchmarkResult *result);
+static void BusBenchmark_ReceiveUdp(const T_BusBenchmarkConfig *config, int readyFd, uint64_t *latenciesNs,
+                                    T_BusBenchmarkResult *result);
+static void BusBenchmark_Publish(const T_BusBenchmarkConfig *config, int udpSocket, const uint16_t *ports,
+                                 uint64_t *cpuNs, uint64_t *wallNs);
+static int BusBenchmark_CompareLatency(const void *first, const void *second);
+static uint64_t BusBenchmark_GetTimeNs(clockid_t clockId);
+
+/* Private values ------------------------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_BusBenchmarkConfig config = {
+        .valueCount = BUS_BENCHMARK_VALUE_COUNT,
+        .rate = BUS_BENCHMARK_RATE,
+        .clientCount = BUS_BENCHMARK_CLIENT_COUNT,
+        .dataSize = BUS_BENCHMARK_DATA_SIZE,
+    };
+    bool isPassed = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:c:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                config.valueCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.rate = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                config.clientCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.dataSize = (uint16_t) strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n values] [-r rate] [-c clients] [-s value size]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (config.valueCount == 0 || config.rate == 0 || config.clientCount == 0 ||
+        config.clientCount > BUS_BENCHMARK_CLIENT_MAX || config.dataSize < sizeof(uint64_t) ||
+        config.dataSize > BUS_TELEMETRY_DATA_MAX_SIZE) {
+        fprintf(stderr, "invalid options, 1 to %d clients and values of %u to %d bytes\n", BUS_BENCHMARK_CLIENT_MAX,
+                (unsigned int) sizeof(uint64_t), BUS_TELEMETRY_DATA_MAX_SIZE);
+        return 2;
+    }
+    snprintf(config.busName, sizeof(config.busName), "/ziyan_bus_benchmark_%d", (int) getpid());
+
+    printf("%u values of %u bytes at %u Hz to %u clients\n\n", config.valueCount, config.dataSize, config.rate,
+           config.clientCount);
+    printf("%-10s %10s %8s %10s %10s %10s %14s %14s\n", "transport", "received", "lost", "p50 us", "p99 us", "max us",
+           "publisher cpu", "client cpu");
+
+    config.transport = BUS_BENCHMARK_TRANSPORT_BUS;
+    isPassed &= BusBenchmark_Run(&config);
+    config.transport = BUS_BENCHMARK_TRANSPORT_UDP;
+    isPassed &= BusBenchmark_Run(&config);
+
+    printf("\nCPU in percent of one core, for the client the mean of the clients.\n");
+
+    return isPassed ? 0 : 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+// Clients are forked, report their port or readiness, receive until the publisher ends and write back their result.
+static bool BusBenchmark_Run(const T_BusBenchmarkConfig *config)
+{
+    T_BusTelemetryConfig busConfig = {
+        .name = config->busName,
+        .segmentSize = BUS_BENCHMARK_SEGMENT_SIZE,
+        .historyDepth = BUS_BENCHMARK_HISTORY_DEPTH,
+    };
+    T_BusBenchmarkResult results[BUS_BENCHMARK_CLIENT_MAX];
+    T_BusBenchmarkResult total;
+    uint16_t ports[BUS_BENCHMARK_CLIENT_MAX];
+    int readyFds[BUS_BENCHMARK_CLIENT_MAX][2];
+    int resultFds[BUS_BENCHMARK_CLIENT_MAX][2];
+    pid_t pids[BUS_BENCHMARK_CLIENT_MAX];
+    uint64_t publisherCpuNs = 0;
+    uint64_t publisherWallNs = 1;
+    double clientCpu = 0;
+    int udpSocket = -1;
+    bool isPassed = true;
+
+    if (config->transport == BUS_BENCHMARK_TRANSPORT_BUS) {
+        if (BusTelemetry_Init(&busConfig) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            fprintf(stderr, "create bus %s error\n", config->busName);
+            return false;
+        }
+    } else {
+        udpSocket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (udpSocket < 0) {
+            fprintf(stderr, "create socket error: %s\n", strerror(errno));
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < config->clientCount; i++) {
+        if (pipe(readyFds[i]) != 0 || pipe(resultFds[i]) != 0) {
+            fprintf(stderr, "create pipe error: %s\n", strerror(errno));
+            exit(1);
+        }
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            fprintf(stderr, "fork error: %s\n", strerror(errno));
+            exit(1);
+        }
+        if (pids[i] == 0) {
+            BusBenchmark_RunClient(config, readyFds[i][1], resultFds[i][1]);
+            _exit(0);
+        }
+        close(readyFds[i][1]);
+        close(resultFds[i][1]);
+    }
+
+    for (uint32_t i = 0; i < config->clientCount; i++) {
+        if (read(readyFds[i][0], &ports[i], sizeof(ports[i])) != sizeof(ports[i])) {
+            fprintf(stderr, "client %u failed to start\n", i);
+            exit(1);
+        }
+        close(readyFds[i][0]);
+    }
+
+    BusBenchmark_Publish(config, udpSocket, ports, &publisherCpuNs, &publisherWallNs);
+    if (config->transport == BUS_BENCHMARK_TRANSPORT_BUS) {
+        BusTelemetry_DeInit();
+    } else {
+        close(udpSocket);
+    }
+
+    memset(&total, 0, sizeof(total));
+    for (uint32_t i = 0; i < config->clientCount; i++) {
+        if (read(resultFds[i][0], &results[i], sizeof(results[i])) != sizeof(results[i])) {
+            memset(&results[i], 0, sizeof(results[i]));
+            results[i].lostCount = config->valueCount;
+        }
+        close(resultFds[i][0]);
+        waitpid(pids[i], NULL, 0);
+
+        total.receivedCount += results[i].receivedCount;
+        total.lostCount += results[i].lostCount;
+        total.latencyP50Ns = USER_UTIL_MAX(total.latencyP50Ns, results[i].latencyP50Ns);
+        total.latencyP99Ns = USER_UTIL_MAX(total.latencyP99Ns, results[i].latencyP99Ns);
+        total.latencyMaxNs = USER_UTIL_MAX(total.latencyMaxNs, results[i].latencyMaxNs);
+        clientCpu += results[i].wallNs != 0 ? (double) results[i].cpuNs / (double) results[i].wallNs : 0;
+    }
+    isPassed = total.receivedCount == (uint64_t) config->valueCount * config->clientCount;
+
+    // The latencies are the worst of the clients.
+    printf("%-10s %10llu %8llu %10.1f %10.1f %10.1f %13.2f%% %13.2f%%\n",
+           config->transport == BUS_BENCHMARK_TRANSPORT_BUS ? "bus" : "udp",
+           (unsigned long long) total.receivedCount, (unsigned long long) total.lostCount,
+           (double) total.latencyP50Ns / 1000, (double) total.latencyP99Ns / 1000,
+           (double) total.latencyMaxNs / 1000, 100.0 * (double) publisherCpuNs / (double) publisherWallNs,
+           100.0 * clientCpu / config->clientCount);
+
+    return isPassed;
+}
+
+static void BusBenchmark_RunClient(const T_BusBenchmarkConfig *config, int readyFd, int resultFd)
+{
+    T_BusBenchmarkResult result;
+    uint64_t *latenciesNs;
+    uint64_t cpuStartNs;
+    uint64_t wallStartNs;
+
+    latenciesNs = malloc(config->valueCount * sizeof(uint64_t));
+    if (latenciesNs == NULL) {
+        return;
+    }
+    memset(&result, 0, sizeof(result));
+    cpuStartNs = BusBenchmark_GetTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+    wallStartNs = BusBenchmark_GetTimeNs(CLOCK_MONOTONIC);
+
+    if (config->transport == BUS_BENCHMARK_TRANSPORT_BUS) {
+        BusBenchmark_ReceiveBus(config, readyFd, latenciesNs, &result);
+    } else {
+        BusBenchmark_ReceiveUdp(config, readyFd, latenciesNs, &result);
+    }
+
+    result.cpuNs = BusBenchmark_GetTimeNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStartNs;
+    result.wallNs = BusBenchmark_GetTimeNs(CLOCK_MONOTONIC) - wallStartNs;
+    if (result.receivedCount != 0) {
+        qsort(latenciesNs, result.receivedCount, sizeof(uint64_t), BusBenchmark_CompareLatency);
+        result.latencyP50Ns = latenciesNs[result.receivedCount / 2];
+        result.latencyP99Ns = latenciesNs[result.receivedCount * 99 / 100];
+        result.latencyMaxNs = latenciesNs[result.receivedCount - 1];
+    }
+
+    if (write(resultFd, &result, sizeof(result)) != sizeof(result)) {
+        fprintf(stderr, "write result error: %s\n", strerror(errno));
+    }
+    free(latenciesNs);
+}
+
+// Values are taken from the history after each wake up, so none is missed while the client runs behind.
+static void BusBenchmark_ReceiveBus(const T_BusBenchmarkConfig *config, int readyFd, uint64_t *latenciesNs,
+                                    T_BusBenchmarkResult *result)
+{
+    T_BusClient client;
+    T_BusTelemetryRecord record;
+    T_ZiyanReturnCode returnCode;
+    uint8_t data[BUS_TELEMETRY_DATA_MAX_SIZE];
+    uint64_t sequence = 0;
+    uint64_t publishNs;
+    uint16_t port = 0;
+
+    if (BusClient_Open(&client, config->busName) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "open bus %s error\n", config->busName);
+        return;
+    }
+    if (write(readyFd, &port, sizeof(port)) != sizeof(port)) {
+        goto out;
+    }
+
+    do {
+        returnCode = BusClient_Wait(&client, BUS_BENCHMARK_TOPIC, sequence, BUS_BENCHMARK_TIMEOUT_MS);
+        while (BusClient_ReadNext(&client, BUS_BENCHMARK_TOPIC, &sequence, data, config->dataSize, &record) ==
+               ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            memcpy(&publishNs, data, sizeof(publishNs));
+            if (result->receivedCount < config->valueCount) {
+                latenciesNs[result->receivedCount++] = BusBenchmark_GetTimeNs(CLOCK_MONOTONIC) - publishNs;
+            }
+        }
+    } while (returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS);
+    result->lostCount = sequence - result->receivedCount;
+
+out:
+    BusClient_Close(&client);
+}
+
+static void BusBenchmark_ReceiveUdp(const T_BusBenchmarkConfig *config, int readyFd, uint64_t *latenciesNs,
+                                    T_BusBenchmarkResult *result)
+{
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    struct timeval timeout = {
+        .tv_sec = BUS_BENCHMARK_TIMEOUT_MS / 1000,
+        .tv_usec = (BUS_BENCHMARK_TIMEOUT_MS % 1000) * 1000,
+    };
+    T_BusBenchmarkPacket packet;
+    uint8_t buffer[sizeof(T_BusBenchmarkPacket) + BUS_TELEMETRY_DATA_MAX_SIZE];
+    uint8_t data[BUS_TELEMETRY_DATA_MAX_SIZE];
+    uint64_t lastSequence = 0;
+    uint64_t publishNs;
+    uint16_t port;
+    ssize_t length;
+    int udpSocket;
+
+    udpSocket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (udpSocket < 0) {
+        return;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(udpSocket, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        getsockname(udpSocket, (struct sockaddr *) &address, &addressLength) != 0 ||
+        setsockopt(udpSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        goto out;
+    }
+    port = ntohs(address.sin_port);
+    if (write(readyFd, &port, sizeof(port)) != sizeof(port)) {
+        goto out;
+    }
+
+    for (;;) {
+        length = recv(udpSocket, buffer, sizeof(buffer), 0);
+        if (length < (ssize_t) sizeof(packet)) {
+            break;
+        }
+        memcpy(&packet, buffer, sizeof(packet));
+        if (packet.dataSize == 0 || length != (ssize_t) (sizeof(packet) + packet.dataSize)) {
+            break;
+        }
+        memcpy(data, buffer + sizeof(packet), packet.dataSize);
+
+        memcpy(&publishNs, data, sizeof(publishNs));
+        if (result->receivedCount < config->valueCount) {
+            latenciesNs[result->receivedCount++] = BusBenchmark_GetTimeNs(CLOCK_MONOTONIC) - publishNs;
+        }
+        lastSequence = packet.record.sequence;
+    }
+    result->lostCount = lastSequence - result->receivedCount;
+
+out:
+    close(udpSocket);
+}
+
+// Both transports carry the time of publication in the first bytes of the value.
+static void BusBenchmark_Publish(const T_BusBenchmarkConfig *config, int udpSocket, const uint16_t *ports,
+                                 uint64_t *cpuNs, uint64_t *wallNs)
+{
+    struct sockaddr_in address;
+    struct timespec nextTime;
+    T_BusBenchmarkPacket packet;
+    T_ZiyanDataTimestamp timestamp;
+    uint8_t buffer[sizeof(T_BusBenchmarkPacket) + BUS_TELEMETRY_DATA_MAX_SIZE];
+    uint8_t data[BUS_TELEMETRY_DATA_MAX_SIZE];
+    uint64_t periodNs = 1000000000ULL / config->rate;
+    uint64_t cpuStartNs;
+    uint64_t wallStartNs;
+    uint64_t publishNs;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    memset(data, 0xA5, sizeof(data));
+    memset(&packet, 0, sizeof(packet));
+
+    clock_gettime(CLOCK_MONOTONIC, &nextTime);
+    cpuStartNs = BusBenchmark_GetTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+    wallStartNs = BusBenchmark_GetTimeNs(CLOCK_MONOTONIC);
+
+    for (uint32_t i = 0; i < config->valueCount; i++) {
+        nextTime.tv_nsec += (long) periodNs;
+        while (nextTime.tv_nsec >= 1000000000) {
+            nextTime.tv_nsec -= 1000000000;
+            nextTime.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextTime, NULL);
+
+        publishNs = BusBenchmark_GetTimeNs(CLOCK_MONOTONIC);
+        timestamp.millisecond = (uint32_t) (publishNs / 1000000);
+        timestamp.microsecond = (uint32_t) (publishNs / 1000);
+        memcpy(data, &publishNs, sizeof(publishNs));
+
+        if (config->transport == BUS_BENCHMARK_TRANSPORT_BUS) {
+            BusTelemetry_Write(BUS_BENCHMARK_TOPIC, data, config->dataSize, &timestamp);
+            continue;
+        }
+
+        packet.topic = BUS_BENCHMARK_TOPIC;
+        packet.dataSize = config->dataSize;
+        packet.record.sequence = i + 1;
+        packet.record.receiveTimeUs = publishNs / 1000;
+        packet.record.timestamp = timestamp;
+        memcpy(buffer, &packet, sizeof(packet));
+        memcpy(buffer + sizeof(packet), data, config->dataSize);
+        for (uint32_t j = 0; j < config->clientCount; j++) {
+            address.sin_port = htons(ports[j]);
+            sendto(udpSocket, buffer, sizeof(packet) + config->dataSize, 0, (struct sockaddr *) &address,
+                   sizeof(address));
+        }
+    }
+
+    *cpuNs = BusBenchmark_GetTimeNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStartNs;
+    *wallNs = BusBenchmark_GetTimeNs(CLOCK_MONOTONIC) - wallStartNs;
+
+    if (config->transport == BUS_BENCHMARK_TRANSPORT_UDP) {
+        packet.dataSize = 0;
+        for (uint32_t j = 0; j < config->clientCount; j++) {
+            address.sin_port = htons(ports[j]);
+            sendto(udpSocket, &packet, sizeof(packet), 0, (struct sockaddr *) &address, sizeof(address));
+        }
+    }
+}
+
+static int BusBenchmark_CompareLatency(const void *first, const void *second)
+{
+    uint64_t firstLatency = *(const uint64_t *) first;
+    uint64_t secondLatency = *(const uint64_t *) second;
+
+    return firstLatency < secondLatency ? -1 : firstLatency > secondLatency;
+}
+
+static uint64_t BusBenchmark_GetTimeNs(clockid_t clockId)
+{
+    struct timespec time;
+
+    clock_gettime(clockId, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
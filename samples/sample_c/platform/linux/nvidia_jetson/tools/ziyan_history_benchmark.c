@@ -0,0 +1,334 @@
+/**
+ ********************************************************************
+ * @file    ziyan_history_benchmark.c
+ * @brief   Host tool checking the interpolation and speed of the queries of fc_subscription_history.c.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ziyan_logger.h"
+#include "ziyan_platform.h"
+#include "osal/osal.h"
+#include "fc_subscription/fc_subscription_cache.h"
+#include "fc_subscription/fc_subscription_history.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define HISTORY_BENCHMARK_QUERY_COUNT           1000000
+#define HISTORY_BENCHMARK_DEPTH                 4096
+#define HISTORY_BENCHMARK_BATCH_SIZE            256
+#define HISTORY_BENCHMARK_PERIOD_US             5000 // 200 Hz, as the fastest quaternion subscription in use
+#define HISTORY_BENCHMARK_YAW_RATE              90.0 // unit: degree/s
+#define HISTORY_BENCHMARK_LONGITUDE_RATE        1e-6 // unit: rad/s, about 6 m/s
+#define HISTORY_BENCHMARK_QUATERNION_TOLERANCE  0.01 // unit: degree
+#define HISTORY_BENCHMARK_POSITION_TOLERANCE    1e-12 // unit: rad
+#define HISTORY_BENCHMARK_PI                    3.14159265358979323846
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    const char *name;
+    double maxError;
+    double tolerance;
+} T_HistoryBenchmarkCheck;
+
+/* Private functions declaration ---------------------------------------------*/
+static void HistoryBenchmark_GetQuaternion(uint64_t timeUs, T_ZiyanFcSubscriptionQuaternion *quaternion);
+static double HistoryBenchmark_GetLongitude(uint64_t timeUs);
+static double HistoryBenchmark_GetAngle(const T_ZiyanFcSubscriptionQuaternion *quaternion,
+                                        const T_ZiyanFcSubscriptionQuaternion *reference);
+static uint64_t HistoryBenchmark_GetRandomTime(uint64_t endUs);
+static bool HistoryBenchmark_Report(const T_HistoryBenchmarkCheck *check);
+static T_ZiyanReturnCode HistoryBenchmark_PrintConsole(const uint8_t *data, uint16_t dataLen);
+static double HistoryBenchmark_GetTimeNs(void);
+
+/* Private values ------------------------------------------------------------*/
+static uint64_t s_randomState = 0x9E3779B97F4A7C15ULL;
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_ZiyanOsalHandler osalHandler = {
+        .TaskCreate = Osal_TaskCreate,
+        .TaskDestroy = Osal_TaskDestroy,
+        .TaskSleepMs = Osal_TaskSleepMs,
+        .MutexCreate = Osal_MutexCreate,
+        .MutexDestroy = Osal_MutexDestroy,
+        .MutexLock = Osal_MutexLock,
+        .MutexUnlock = Osal_MutexUnlock,
+        .SemaphoreCreate = Osal_SemaphoreCreate,
+        .SemaphoreDestroy = Osal_SemaphoreDestroy,
+        .SemaphoreWait = Osal_SemaphoreWait,
+        .SemaphoreTimedWait = Osal_SemaphoreTimedWait,
+        .SemaphorePost = Osal_SemaphorePost,
+        .Malloc = Osal_Malloc,
+        .Free = Osal_Free,
+        .GetRandomNum = Osal_GetRandomNum,
+        .GetTimeMs = Osal_GetTimeMs,
+        .GetTimeUs = Osal_GetTimeUs,
+    };
+    T_ZiyanLoggerConsole printConsole = {
+        .func = HistoryBenchmark_PrintConsole,
+        .consoleLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_WARN,
+        .isSupportColor = false,
+    };
+    T_ZiyanFcSubscriptionQuaternion *quaternions;
+    T_ZiyanFcSubscriptionQuaternion quaternion;
+    T_ZiyanFcSubscriptionQuaternion expected;
+    T_ZiyanFcSubscriptionPositionFused position;
+    T_ZiyanDataTimestamp timestamp;
+    T_HistoryBenchmarkCheck check;
+    uint64_t *timesUs;
+    uint64_t endUs = 0;
+    uint32_t queryCount = HISTORY_BENCHMARK_QUERY_COUNT;
+    uint32_t depth = HISTORY_BENCHMARK_DEPTH;
+    uint32_t foundCount;
+    uint32_t i;
+    double startNs;
+    double singleNs;
+    double batchNs;
+    bool isPassed = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:")) != -1) {
+        switch (opt) {
+            case 'n':
+                queryCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                depth = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n queries] [-d depth]\n"
+                                "  Build with optimizations, e.g. -DCMAKE_BUILD_TYPE=Release, for meaningful timings.\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    queryCount = USER_UTIL_MAX(queryCount, HISTORY_BENCHMARK_BATCH_SIZE);
+
+    if (ZiyanPlatform_RegOsalHandler(&osalHandler) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        ZiyanLogger_AddConsole(&printConsole) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "platform init error\n");
+        return 1;
+    }
+
+    if (FcSubscriptionHistory_Init() != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        FcSubscriptionHistory_Enable(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, (uint16_t) depth) !=
+        ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        FcSubscriptionHistory_Enable(ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED, (uint16_t) depth) !=
+        ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "history init error, the depth must be a power of 2 up to %d\n",
+                FC_SUBSCRIPTION_HISTORY_DEPTH_MAX);
+        return 1;
+    }
+
+    // The values go through the subscription cache as from the SDK, filling the histories exactly.
+    memset(&position, 0, sizeof(position));
+    for (i = 0; i < depth; i++) {
+        endUs = (uint64_t) i * HISTORY_BENCHMARK_PERIOD_US;
+        timestamp.millisecond = (uint32_t) (endUs / 1000);
+        timestamp.microsecond = (uint32_t) endUs;
+        HistoryBenchmark_GetQuaternion(endUs, &quaternion);
+        position.longitude = HistoryBenchmark_GetLongitude(endUs);
+        FcSubscriptionCache_Update(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, (const uint8_t *) &quaternion,
+                                   sizeof(quaternion), &timestamp);
+        FcSubscriptionCache_Update(ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED, (const uint8_t *) &position,
+                                   sizeof(position), &timestamp);
+    }
+
+    timesUs = malloc(queryCount * sizeof(uint64_t));
+    quaternions = malloc(queryCount * sizeof(T_ZiyanFcSubscriptionQuaternion));
+    if (timesUs == NULL || quaternions == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < queryCount; i++) {
+        timesUs[i] = HistoryBenchmark_GetRandomTime(endUs);
+    }
+
+    printf("%-40s %12s %12s\n", "accuracy check", "max error", "tolerance");
+
+    // A rotation at a constant rate about one axis is exactly what the spherical interpolation gives.
+    check.name = "quaternion slerp, degree";
+    check.maxError = 0;
+    check.tolerance = HISTORY_BENCHMARK_QUATERNION_TOLERANCE;
+    for (i = 0; i < queryCount; i++) {
+        if (FcSubscriptionHistory_Query(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP,
+                                        timesUs[i], &quaternion, sizeof(quaternion)) !=
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            check.maxError = INFINITY;
+            break;
+        }
+        HistoryBenchmark_GetQuaternion(timesUs[i], &expected);
+        check.maxError = USER_UTIL_MAX(check.maxError, HistoryBenchmark_GetAngle(&quaternion, &expected));
+    }
+    isPassed &= HistoryBenchmark_Report(&check);
+
+    check.name = "position lerp, rad";
+    check.maxError = 0;
+    check.tolerance = HISTORY_BENCHMARK_POSITION_TOLERANCE;
+    for (i = 0; i < queryCount; i++) {
+        if (FcSubscriptionHistory_Query(ZIYAN_FC_SUBSCRIPTION_TOPIC_POSITION_FUSED,
+                                        FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP, timesUs[i], &position,
+                                        sizeof(position)) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            check.maxError = INFINITY;
+            break;
+        }
+        check.maxError = USER_UTIL_MAX(check.maxError,
+                                       fabs(position.longitude - HistoryBenchmark_GetLongitude(timesUs[i])));
+    }
+    isPassed &= HistoryBenchmark_Report(&check);
+
+    check.name = "times out of the history";
+    check.maxError = 0;
+    check.tolerance = 0;
+    if (FcSubscriptionHistory_Query(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP,
+                                    endUs + 1, &quaternion, sizeof(quaternion)) !=
+        ZIYAN_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE) {
+        check.maxError++;
+    }
+    if (depth > 1 && FcSubscriptionHistory_Query(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION,
+                                                 FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP, 0, &quaternion,
+                                                 sizeof(quaternion)) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        check.maxError++;
+    }
+    isPassed &= HistoryBenchmark_Report(&check);
+
+    printf("\n%-40s %12s %12s\n", "speed, quaternion", "ns/query", "queries/s");
+
+    startNs = HistoryBenchmark_GetTimeNs();
+    foundCount = 0;
+    for (i = 0; i < queryCount; i++) {
+        if (FcSubscriptionHistory_Query(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP,
+                                        timesUs[i], &quaternions[i], sizeof(T_ZiyanFcSubscriptionQuaternion)) ==
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            foundCount++;
+        }
+    }
+    singleNs = (HistoryBenchmark_GetTimeNs() - startNs) / queryCount;
+    printf("%-40s %12.2f %12.0f\n", "single, random times", singleNs, 1e9 / singleNs);
+
+    startNs = HistoryBenchmark_GetTimeNs();
+    for (i = 0; i + HISTORY_BENCHMARK_BATCH_SIZE <= queryCount; i += HISTORY_BENCHMARK_BATCH_SIZE) {
+        FcSubscriptionHistory_QueryBatch(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP,
+                                         &timesUs[i], HISTORY_BENCHMARK_BATCH_SIZE, &quaternions[i],
+                                         sizeof(T_ZiyanFcSubscriptionQuaternion), NULL);
+    }
+    batchNs = (HistoryBenchmark_GetTimeNs() - startNs) / i;
+    printf("%-40s %12.2f %12.0f\n", "batch, random times", batchNs, 1e9 / batchNs);
+
+    // Frames of a video, one query per frame at 30 Hz to 1 kHz, are close ascending times.
+    for (i = 0; i < queryCount; i++) {
+        timesUs[i] = (uint64_t) ((double) endUs * i / queryCount);
+    }
+    startNs = HistoryBenchmark_GetTimeNs();
+    for (i = 0; i + HISTORY_BENCHMARK_BATCH_SIZE <= queryCount; i += HISTORY_BENCHMARK_BATCH_SIZE) {
+        FcSubscriptionHistory_QueryBatch(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, FC_SUBSCRIPTION_HISTORY_CLOCK_TIMESTAMP,
+                                         &timesUs[i], HISTORY_BENCHMARK_BATCH_SIZE, &quaternions[i],
+                                         sizeof(T_ZiyanFcSubscriptionQuaternion), NULL);
+    }
+    batchNs = (HistoryBenchmark_GetTimeNs() - startNs) / i;
+    printf("%-40s %12.2f %12.0f (%.1fx single)\n", "batch, ascending times", batchNs, 1e9 / batchNs,
+           singleNs / batchNs);
+
+    free(timesUs);
+    free(quaternions);
+
+    if (foundCount != queryCount) {
+        isPassed = false;
+    }
+    printf("\n%s\n", isPassed ? "PASSED" : "FAILED");
+
+    return isPassed ? 0 : 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void HistoryBenchmark_GetQuaternion(uint64_t timeUs, T_ZiyanFcSubscriptionQuaternion *quaternion)
+{
+    double halfYaw = HISTORY_BENCHMARK_YAW_RATE * HISTORY_BENCHMARK_PI / 180 * (double) timeUs / 1e6 / 2;
+
+    quaternion->q0 = (ziyan_f32_t) cos(halfYaw);
+    quaternion->q1 = 0;
+    quaternion->q2 = 0;
+    quaternion->q3 = (ziyan_f32_t) sin(halfYaw);
+}
+
+static double HistoryBenchmark_GetLongitude(uint64_t timeUs)
+{
+    return 2.0 + HISTORY_BENCHMARK_LONGITUDE_RATE * (double) timeUs / 1e6;
+}
+
+/**
+ * @brief Rotation angle between two quaternions in degrees, from the chord between them, 2 sin(angle / 4) long,
+ * which unlike the acos of their dot product keeps its precision for small angles.
+ */
+static double HistoryBenchmark_GetAngle(const T_ZiyanFcSubscriptionQuaternion *quaternion,
+                                        const T_ZiyanFcSubscriptionQuaternion *reference)
+{
+    double sign = (double) quaternion->q0 * reference->q0 + (double) quaternion->q1 * reference->q1 +
+                  (double) quaternion->q2 * reference->q2 + (double) quaternion->q3 * reference->q3 < 0 ? -1 : 1;
+    double chord = sqrt(pow(quaternion->q0 - sign * reference->q0, 2) + pow(quaternion->q1 - sign * reference->q1, 2) +
+                        pow(quaternion->q2 - sign * reference->q2, 2) + pow(quaternion->q3 - sign * reference->q3, 2));
+
+    return 4 * asin(USER_UTIL_MIN(chord / 2, 1.0)) * 180 / HISTORY_BENCHMARK_PI;
+}
+
+static uint64_t HistoryBenchmark_GetRandomTime(uint64_t endUs)
+{
+    s_randomState ^= s_randomState << 13;
+    s_randomState ^= s_randomState >> 7;
+    s_randomState ^= s_randomState << 17;
+
+    return s_randomState % (endUs + 1);
+}
+
+static bool HistoryBenchmark_Report(const T_HistoryBenchmarkCheck *check)
+{
+    bool isPassed = check->maxError <= check->tolerance;
+
+    printf("%-40s %12.3g %12.3g %s\n", check->name, check->maxError, check->tolerance, isPassed ? "ok" : "FAILED");
+
+    return isPassed;
+}
+
+static T_ZiyanReturnCode HistoryBenchmark_PrintConsole(const uint8_t *data, uint16_t dataLen)
+{
+    fwrite(data, 1, dataLen, stderr);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static double HistoryBenchmark_GetTimeNs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
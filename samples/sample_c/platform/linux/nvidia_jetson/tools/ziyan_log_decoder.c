@@ -0,0 +1,410 @@
+/**
+ ********************************************************************
+ * @file    ziyan_log_decoder.c
+ * @brief   Host tool turning binary logs written by logger_binary.c back into text or JSON lines.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "logger/logger_binary.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define LOG_DECODER_LINE_SIZE_MAX               4096
+#define LOG_DECODER_SPEC_SIZE_MAX               32
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint16_t line;
+    uint8_t level;
+    char *file;
+    char *format;
+} T_LogDecoderSite;
+
+typedef struct {
+    const uint8_t *data;
+    uint16_t len;
+    uint16_t offset;
+    bool isTruncated;
+} T_LogDecoderArgs;
+
+/* Private functions declaration ---------------------------------------------*/
+static int LogDecoder_ReadSites(FILE *file, const T_LoggerBinaryFileHeader *fileHeader, T_LogDecoderSite *sites);
+static size_t LogDecoder_Render(const char *format, T_LogDecoderArgs *args, char *out, size_t outSize);
+static bool LogDecoder_Pop(T_LogDecoderArgs *args, void *value, uint16_t size);
+static size_t LogDecoder_PrintJsonString(FILE *out, const char *str, size_t len);
+static const char *LogDecoder_GetLevelName(uint8_t level);
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_LoggerBinaryFileHeader fileHeader;
+    T_LoggerBinaryRecordHeader recordHeader;
+    T_LogDecoderSite *sites = NULL;
+    T_LogDecoderArgs args;
+    uint8_t record[LOGGER_BINARY_RECORD_SIZE_MAX];
+    char line[LOG_DECODER_LINE_SIZE_MAX];
+    const T_LogDecoderSite *site;
+    bool isJson = false;
+    bool isPrintStatistics = false;
+    uint64_t recordCount = 0;
+    uint64_t binaryBytes;
+    uint64_t textBytes = 0;
+    size_t lineLen;
+    double timeSec;
+    FILE *file;
+    uint32_t i;
+    int opt;
+    int ret = 1;
+
+    while ((opt = getopt(argc, argv, "js")) != -1) {
+        switch (opt) {
+            case 'j':
+                isJson = true;
+                break;
+            case 's':
+                isPrintStatistics = true;
+                break;
+            default:
+                goto usage;
+        }
+    }
+
+    if (optind != argc - 1) {
+        goto usage;
+    }
+
+    // Compressed logs of the rotation can be piped in, e.g. zcat ZIYAN_0001_*.blog.gz | ziyan_log_decoder -
+    file = strcmp(argv[optind], "-") == 0 ? stdin : fopen(argv[optind], "rb");
+    if (file == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if (fread(&fileHeader, sizeof(fileHeader), 1, file) != 1 || fileHeader.magic != LOGGER_BINARY_FILE_MAGIC ||
+        fileHeader.version != LOGGER_BINARY_FILE_VERSION) {
+        fprintf(stderr, "%s: not a binary log of version %d\n", argv[optind], LOGGER_BINARY_FILE_VERSION);
+        goto out;
+    }
+
+    sites = calloc(fileHeader.siteCount + 1, sizeof(T_LogDecoderSite));
+    if (sites == NULL || LogDecoder_ReadSites(file, &fileHeader, sites) != 0) {
+        fprintf(stderr, "%s: truncated format table\n", argv[optind]);
+        goto out;
+    }
+    binaryBytes = sizeof(fileHeader);
+    for (i = 0; i < fileHeader.siteCount; i++) {
+        binaryBytes += sizeof(T_LoggerBinarySiteHeader) + strlen(sites[i].file) + strlen(sites[i].format);
+    }
+
+    while (fread(&recordHeader, sizeof(recordHeader), 1, file) == 1) {
+        // A record cut by a crash or a full disk ends the log.
+        if (recordHeader.len < sizeof(recordHeader) || recordHeader.len > sizeof(record) ||
+            (recordHeader.len > sizeof(recordHeader) &&
+             fread(record, recordHeader.len - sizeof(recordHeader), 1, file) != 1)) {
+            fprintf(stderr, "%s: truncated record at offset %llu\n", argv[optind], (unsigned long long) binaryBytes);
+            break;
+        }
+
+        args.data = record;
+        args.len = (uint16_t) (recordHeader.len - sizeof(recordHeader));
+        args.offset = 0;
+        args.isTruncated = false;
+        binaryBytes += recordHeader.len;
+        recordCount++;
+        timeSec = (double) (int64_t) (recordHeader.timestampUs - fileHeader.monotonicBaseUs) / 1000000.0;
+
+        if (recordHeader.formatId == LOGGER_BINARY_FORMAT_ID_TEXT) {
+            lineLen = args.len;
+            while (lineLen > 0 && (record[lineLen - 1] == '\n' || record[lineLen - 1] == '\r')) {
+                lineLen--;
+            }
+            memcpy(line, record, lineLen);
+            line[lineLen] = '\0';
+            site = NULL;
+        } else if (recordHeader.formatId < fileHeader.siteCount) {
+            site = &sites[recordHeader.formatId];
+            lineLen = LogDecoder_Render(site->format, &args, line, sizeof(line));
+            while (lineLen > 0 && (line[lineLen - 1] == '\n' || line[lineLen - 1] == '\r')) {
+                line[--lineLen] = '\0';
+            }
+        } else {
+            lineLen = (size_t) snprintf(line, sizeof(line), "<unknown format id %u>", recordHeader.formatId);
+            site = NULL;
+        }
+
+        if (isJson) {
+            textBytes += (uint64_t) printf("{\"time\":%.6f,\"level\":\"%s\",",
+                                           (double) fileHeader.realtimeBaseUs / 1000000.0 + timeSec,
+                                           LogDecoder_GetLevelName(recordHeader.level));
+            if (site != NULL) {
+                textBytes += (uint64_t) printf("\"file\":");
+                textBytes += LogDecoder_PrintJsonString(stdout, site->file, strlen(site->file));
+                textBytes += (uint64_t) printf(",\"line\":%u,", site->line);
+            }
+            textBytes += (uint64_t) printf("\"msg\":");
+            textBytes += LogDecoder_PrintJsonString(stdout, line, lineLen);
+            textBytes += (uint64_t) printf("%s}\n", args.isTruncated ? ",\"truncated\":true" : "");
+        } else if (site != NULL) {
+            textBytes += (uint64_t) printf("[%.3f]-[%s]-[%s:%u) %s%s\n", timeSec,
+                                           LogDecoder_GetLevelName(recordHeader.level), site->file, site->line,
+                                           line, args.isTruncated ? " <truncated>" : "");
+        } else {
+            textBytes += (uint64_t) printf("%s\n", line);
+        }
+    }
+
+    if (isPrintStatistics) {
+        fprintf(stderr, "records: %llu, binary: %llu bytes, text: %llu bytes, ratio: %.2f\n",
+                (unsigned long long) recordCount, (unsigned long long) binaryBytes,
+                (unsigned long long) textBytes, binaryBytes != 0 ? (double) textBytes / (double) binaryBytes : 0.0);
+    }
+    ret = 0;
+
+out:
+    if (sites != NULL) {
+        for (i = 0; i < fileHeader.siteCount; i++) {
+            free(sites[i].file);
+            free(sites[i].format);
+        }
+        free(sites);
+    }
+    if (file != stdin) {
+        fclose(file);
+    }
+    return ret;
+
+usage:
+    fprintf(stderr, "usage: %s [-j] [-s] <log.blog | ->\n"
+                    "  -j  print JSON lines instead of text\n"
+                    "  -s  print size statistics to stderr\n", argv[0]);
+    return 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static int LogDecoder_ReadSites(FILE *file, const T_LoggerBinaryFileHeader *fileHeader, T_LogDecoderSite *sites)
+{
+    T_LoggerBinarySiteHeader siteHeader;
+    uint32_t i;
+
+    for (i = 0; i < fileHeader->siteCount; i++) {
+        if (fread(&siteHeader, sizeof(siteHeader), 1, file) != 1) {
+            return -1;
+        }
+
+        sites[i].line = siteHeader.line;
+        sites[i].level = siteHeader.level;
+        sites[i].file = calloc(siteHeader.fileLen + 1, 1);
+        sites[i].format = calloc(siteHeader.formatLen + 1, 1);
+        if (sites[i].file == NULL || sites[i].format == NULL ||
+            fread(sites[i].file, 1, siteHeader.fileLen, file) != siteHeader.fileLen ||
+            fread(sites[i].format, 1, siteHeader.formatLen, file) != siteHeader.formatLen) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static size_t LogDecoder_Render(const char *format, T_LogDecoderArgs *args, char *out, size_t outSize)
+{
+    uint8_t argTypes[3];
+    char spec[LOG_DECODER_SPEC_SIZE_MAX];
+    const char *conversion;
+    const char *next;
+    const char *p;
+    size_t outLen = 0;
+    size_t specLen;
+    uint8_t argCount;
+    uint8_t type;
+    int32_t stars[2];
+    uint8_t starCount;
+    int32_t value32;
+    uint64_t value64;
+    double valueDouble;
+    uint8_t stringLen;
+    char string[LOGGER_BINARY_STRING_ARG_LEN_MAX + 1];
+    int len;
+    uint8_t i;
+
+#define LOG_DECODER_PRINT(value) \
+    (starCount == 0 ? snprintf(out + outLen, outSize - outLen, spec, value) : \
+     starCount == 1 ? snprintf(out + outLen, outSize - outLen, spec, stars[0], value) : \
+     snprintf(out + outLen, outSize - outLen, spec, stars[0], stars[1], value))
+
+    out[0] = '\0';
+    while (outLen + 1 < outSize) {
+        next = LoggerBinary_NextConversion(format, &conversion, argTypes, &argCount);
+        if (next == NULL) {
+            len = snprintf(out + outLen, outSize - outLen, "%s", format);
+            outLen += (size_t) len;
+            break;
+        }
+
+        len = snprintf(out + outLen, outSize - outLen, "%.*s", (int) (conversion - format), format);
+        outLen = USER_UTIL_MIN(outLen + (size_t) len, outSize - 1);
+
+        // Length modifiers are dropped and rebuilt from the recorded size of the value.
+        specLen = 0;
+        for (p = conversion; p < next && specLen + 3 < sizeof(spec); p++) {
+            if (p != next - 1 && strchr("hlLqjzt", *p) != NULL) {
+                continue;
+            }
+            if (p == next - 1 && argCount > 0 && argTypes[argCount - 1] == LOGGER_BINARY_ARG_TYPE_INT64) {
+                spec[specLen++] = 'l';
+                spec[specLen++] = 'l';
+            }
+            spec[specLen++] = *p;
+        }
+        spec[specLen] = '\0';
+        format = next;
+
+        starCount = 0;
+        len = 0;
+        for (i = 0; i < argCount; i++) {
+            type = argTypes[i];
+            if (i + 1 < argCount) {
+                if (!LogDecoder_Pop(args, &stars[starCount++], sizeof(int32_t))) {
+                    break;
+                }
+                continue;
+            }
+
+            switch (type) {
+                case LOGGER_BINARY_ARG_TYPE_INT32:
+                    if (LogDecoder_Pop(args, &value32, sizeof(value32))) {
+                        len = LOG_DECODER_PRINT(value32);
+                    }
+                    break;
+                case LOGGER_BINARY_ARG_TYPE_INT64:
+                    if (LogDecoder_Pop(args, &value64, sizeof(value64))) {
+                        len = LOG_DECODER_PRINT((long long) value64);
+                    }
+                    break;
+                case LOGGER_BINARY_ARG_TYPE_DOUBLE:
+                case LOGGER_BINARY_ARG_TYPE_LONG_DOUBLE:
+                    if (LogDecoder_Pop(args, &valueDouble, sizeof(valueDouble))) {
+                        len = LOG_DECODER_PRINT(valueDouble);
+                    }
+                    break;
+                case LOGGER_BINARY_ARG_TYPE_STRING:
+                    if (LogDecoder_Pop(args, &stringLen, sizeof(stringLen)) &&
+                        LogDecoder_Pop(args, string, stringLen)) {
+                        string[stringLen] = '\0';
+                        len = LOG_DECODER_PRINT(string);
+                    }
+                    break;
+                case LOGGER_BINARY_ARG_TYPE_POINTER:
+                    if (LogDecoder_Pop(args, &value64, sizeof(value64)) && *(next - 1) == 'p') {
+                        len = LOG_DECODER_PRINT((void *) (uintptr_t) value64);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (argCount == 0) {
+            len = snprintf(out + outLen, outSize - outLen, "%s", strcmp(spec, "%%") == 0 ? "%" : spec);
+        }
+
+        if (len > 0) {
+            outLen = USER_UTIL_MIN(outLen + (size_t) len, outSize - 1);
+        }
+    }
+
+#undef LOG_DECODER_PRINT
+
+    return USER_UTIL_MIN(outLen, outSize - 1);
+}
+
+static bool LogDecoder_Pop(T_LogDecoderArgs *args, void *value, uint16_t size)
+{
+    if (args->offset + size > args->len) {
+        args->isTruncated = true;
+        return false;
+    }
+
+    memcpy(value, args->data + args->offset, size);
+    args->offset += size;
+
+    return true;
+}
+
+static size_t LogDecoder_PrintJsonString(FILE *out, const char *str, size_t len)
+{
+    size_t outLen = 2;
+    size_t i;
+
+    fputc('"', out);
+    for (i = 0; i < len; i++) {
+        switch (str[i]) {
+            case '"':
+            case '\\':
+                fputc('\\', out);
+                fputc(str[i], out);
+                outLen += 2;
+                break;
+            case '\n':
+                fputs("\\n", out);
+                outLen += 2;
+                break;
+            case '\r':
+                fputs("\\r", out);
+                outLen += 2;
+                break;
+            case '\t':
+                fputs("\\t", out);
+                outLen += 2;
+                break;
+            default:
+                if ((unsigned char) str[i] < 0x20) {
+                    outLen += (size_t) fprintf(out, "\\u%04x", (unsigned char) str[i]);
+                } else {
+                    fputc(str[i], out);
+                    outLen++;
+                }
+                break;
+        }
+    }
+    fputc('"', out);
+
+    return outLen;
+}
+
+static const char *LogDecoder_GetLevelName(uint8_t level)
+{
+    switch (level) {
+        case ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_ERROR:
+            return "Error";
+        case ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_WARN:
+            return "Warn";
+        case ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_INFO:
+            return "Info";
+        default:
+            return "Debug";
+    }
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
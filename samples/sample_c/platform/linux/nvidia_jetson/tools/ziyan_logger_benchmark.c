@@ -0,0 +1,422 @@
+/**
+ ********************************************************************
+ * @file    ziyan_logger_benchmark.c
+ * @brief   Host tool comparing the log call latency of the asynchronous logger with the synchronous consoles.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ziyan_logger.h"
+#include "ziyan_platform.h"
+#include "osal/osal.h"
+#include "logger/logger_async.h"
+#include "utils/util_log.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define LOGGER_BENCHMARK_THREAD_COUNT           4 // e.g. gimbal, camera, subscription and monitor tasks
+#define LOGGER_BENCHMARK_THREAD_MAX             64
+#define LOGGER_BENCHMARK_CALL_COUNT             20000 // per thread
+#define LOGGER_BENCHMARK_DIR_PATH               "."
+#define LOGGER_BENCHMARK_PATH_MAX_SIZE          256
+#define LOGGER_BENCHMARK_FLUSH_TIMEOUT_MS       10000
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    LOGGER_BENCHMARK_MODE_SYNC = 0,
+    LOGGER_BENCHMARK_MODE_ASYNC,
+    LOGGER_BENCHMARK_MODE_NUM,
+} E_LoggerBenchmarkMode;
+
+typedef struct {
+    uint32_t threadCount;
+    uint32_t callCount;
+    uint32_t rate; /*!< Calls per second of each thread, 0 for back to back calls. */
+    const char *dirPath;
+} T_LoggerBenchmarkConfig;
+
+typedef struct {
+    uint64_t callCount;
+    uint64_t droppedCount;
+    uint64_t latencyP50Ns;
+    uint64_t latencyP99Ns;
+    uint64_t latencyMaxNs;
+    uint64_t wallNs;
+    uint64_t flushNs;
+    bool isFailed;
+} T_LoggerBenchmarkResult;
+
+typedef struct {
+    const T_LoggerBenchmarkConfig *config;
+    uint32_t threadIndex;
+    uint64_t *latenciesNs;
+} T_LoggerBenchmarkWorker;
+
+/* Private functions declaration ---------------------------------------------*/
+static bool LoggerBenchmark_Run(const T_LoggerBenchmarkConfig *config, E_LoggerBenchmarkMode mode,
+                                T_LoggerBenchmarkResult *result);
+static void LoggerBenchmark_RunChild(const T_LoggerBenchmarkConfig *config, E_LoggerBenchmarkMode mode,
+                                     T_LoggerBenchmarkResult *result);
+static T_ZiyanReturnCode LoggerBenchmark_InitLogger(const T_LoggerBenchmarkConfig *config, E_LoggerBenchmarkMode mode);
+static void *LoggerBenchmark_WorkerTask(void *arg);
+static T_ZiyanReturnCode LoggerBenchmark_SyncPrintConsole(const uint8_t *data, uint16_t dataLen);
+static T_ZiyanReturnCode LoggerBenchmark_SyncLocalWrite(const uint8_t *data, uint16_t dataLen);
+static T_ZiyanReturnCode LoggerBenchmark_AsyncPrintConsole(const uint8_t *data, uint16_t dataLen);
+static T_ZiyanReturnCode LoggerBenchmark_AsyncLocalWrite(const uint8_t *data, uint16_t dataLen);
+static int LoggerBenchmark_CompareLatency(const void *first, const void *second);
+static uint64_t LoggerBenchmark_GetTimeNs(void);
+
+/* Private values ------------------------------------------------------------*/
+static const char *const s_modeNames[LOGGER_BENCHMARK_MODE_NUM] = {"sync", "async"};
+static FILE *s_syncLogFile = NULL;
+static uint8_t s_asyncConsoleSinkIndex = 0;
+static uint8_t s_asyncLogFileSinkIndex = 0;
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_LoggerBenchmarkConfig config = {
+        .threadCount = LOGGER_BENCHMARK_THREAD_COUNT,
+        .callCount = LOGGER_BENCHMARK_CALL_COUNT,
+        .rate = 0,
+        .dirPath = LOGGER_BENCHMARK_DIR_PATH,
+    };
+    T_LoggerBenchmarkResult result;
+    bool isPassed = true;
+    uint32_t mode;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:r:d:")) != -1) {
+        switch (opt) {
+            case 't':
+                config.threadCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                config.callCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.rate = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                config.dirPath = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t threads] [-n calls per thread] [-r calls/s per thread] [-d log dir]\n"
+                                "  Put the log directory on the storage the logs go to on the board, e.g. the eMMC.\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    if (config.threadCount == 0 || config.threadCount > LOGGER_BENCHMARK_THREAD_MAX || config.callCount == 0) {
+        fprintf(stderr, "invalid options, 1 to %d threads and at least one call\n", LOGGER_BENCHMARK_THREAD_MAX);
+        return 2;
+    }
+
+    printf("%u threads x %u USER_LOG_INFO calls", config.threadCount, config.callCount);
+    if (config.rate == 0) {
+        printf(" back to back");
+    } else {
+        printf(" at %u calls/s per thread", config.rate);
+    }
+    printf(", logs in %s\n\n", config.dirPath);
+    printf("%-6s %10s %10s %10s %10s %10s %12s %10s\n", "mode", "calls", "dropped", "p50 us", "p99 us", "max us",
+           "calls/s", "flush ms");
+
+    for (mode = 0; mode < LOGGER_BENCHMARK_MODE_NUM; mode++) {
+        if (!LoggerBenchmark_Run(&config, (E_LoggerBenchmarkMode) mode, &result)) {
+            printf("%-6s %10s\n", s_modeNames[mode], "failed");
+            isPassed = false;
+            continue;
+        }
+
+        printf("%-6s %10llu %10llu %10.2f %10.2f %10.1f %12.0f %10.1f\n", s_modeNames[mode],
+               (unsigned long long) result.callCount, (unsigned long long) result.droppedCount,
+               (double) result.latencyP50Ns / 1000, (double) result.latencyP99Ns / 1000,
+               (double) result.latencyMaxNs / 1000, (double) result.callCount * 1e9 / (double) result.wallNs,
+               (double) result.flushNs / 1e6);
+    }
+
+    return isPassed ? 0 : 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+// The Payload SDK logger cannot remove a console, so each mode runs in a process of its own.
+static bool LoggerBenchmark_Run(const T_LoggerBenchmarkConfig *config, E_LoggerBenchmarkMode mode,
+                                T_LoggerBenchmarkResult *result)
+{
+    int resultPipe[2];
+    ssize_t ret;
+    pid_t pid;
+    int status;
+
+    if (pipe(resultPipe) != 0) {
+        return false;
+    }
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        close(resultPipe[0]);
+        close(resultPipe[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(resultPipe[0]);
+        memset(result, 0, sizeof(T_LoggerBenchmarkResult));
+        LoggerBenchmark_RunChild(config, mode, result);
+        ret = write(resultPipe[1], result, sizeof(T_LoggerBenchmarkResult));
+        _exit(ret == (ssize_t) sizeof(T_LoggerBenchmarkResult) ? 0 : 1);
+    }
+
+    close(resultPipe[1]);
+    do {
+        ret = read(resultPipe[0], result, sizeof(T_LoggerBenchmarkResult));
+    } while (ret < 0 && errno == EINTR);
+    close(resultPipe[0]);
+    waitpid(pid, &status, 0);
+
+    return ret == (ssize_t) sizeof(T_LoggerBenchmarkResult) && !result->isFailed;
+}
+
+static void LoggerBenchmark_RunChild(const T_LoggerBenchmarkConfig *config, E_LoggerBenchmarkMode mode,
+                                     T_LoggerBenchmarkResult *result)
+{
+    T_LoggerBenchmarkWorker workers[LOGGER_BENCHMARK_THREAD_MAX];
+    pthread_t threads[LOGGER_BENCHMARK_THREAD_MAX];
+    T_LoggerAsyncStatistics statistics;
+    uint64_t *latenciesNs;
+    uint64_t totalCount = (uint64_t) config->threadCount * config->callCount;
+    uint64_t startNs;
+    uint32_t startedCount = 0;
+    uint32_t i;
+
+    if (LoggerBenchmark_InitLogger(config, mode) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        result->isFailed = true;
+        return;
+    }
+
+    latenciesNs = calloc(totalCount, sizeof(uint64_t));
+    if (latenciesNs == NULL) {
+        result->isFailed = true;
+        return;
+    }
+
+    startNs = LoggerBenchmark_GetTimeNs();
+    for (i = 0; i < config->threadCount; i++) {
+        workers[i].config = config;
+        workers[i].threadIndex = i;
+        workers[i].latenciesNs = latenciesNs + (uint64_t) i * config->callCount;
+        if (pthread_create(&threads[i], NULL, LoggerBenchmark_WorkerTask, &workers[i]) != 0) {
+            result->isFailed = true;
+            break;
+        }
+        startedCount++;
+    }
+    for (i = 0; i < startedCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    result->wallNs = LoggerBenchmark_GetTimeNs() - startNs;
+
+    // What the calls did not wait for is still owed, so the time to drain the rings is reported next to them.
+    startNs = LoggerBenchmark_GetTimeNs();
+    if (mode == LOGGER_BENCHMARK_MODE_ASYNC) {
+        LoggerAsync_Flush(LOGGER_BENCHMARK_FLUSH_TIMEOUT_MS);
+        if (LoggerAsync_GetStatistics(&statistics) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            result->droppedCount = statistics.droppedRecordCount;
+        }
+        LoggerAsync_DeInit();
+    } else {
+        fflush(stdout);
+        fclose(s_syncLogFile);
+    }
+    result->flushNs = LoggerBenchmark_GetTimeNs() - startNs;
+
+    qsort(latenciesNs, totalCount, sizeof(uint64_t), LoggerBenchmark_CompareLatency);
+    result->callCount = totalCount;
+    result->latencyP50Ns = latenciesNs[totalCount / 2];
+    result->latencyP99Ns = latenciesNs[totalCount * 99 / 100];
+    result->latencyMaxNs = latenciesNs[totalCount - 1];
+    free(latenciesNs);
+}
+
+// Both modes register the consoles of the application: stdout at info level and the log file at debug level.
+static T_ZiyanReturnCode LoggerBenchmark_InitLogger(const T_LoggerBenchmarkConfig *config, E_LoggerBenchmarkMode mode)
+{
+    T_ZiyanOsalHandler osalHandler = {
+        .TaskCreate = Osal_TaskCreate,
+        .TaskDestroy = Osal_TaskDestroy,
+        .TaskSleepMs = Osal_TaskSleepMs,
+        .MutexCreate = Osal_MutexCreate,
+        .MutexDestroy = Osal_MutexDestroy,
+        .MutexLock = Osal_MutexLock,
+        .MutexUnlock = Osal_MutexUnlock,
+        .SemaphoreCreate = Osal_SemaphoreCreate,
+        .SemaphoreDestroy = Osal_SemaphoreDestroy,
+        .SemaphoreWait = Osal_SemaphoreWait,
+        .SemaphoreTimedWait = Osal_SemaphoreTimedWait,
+        .SemaphorePost = Osal_SemaphorePost,
+        .Malloc = Osal_Malloc,
+        .Free = Osal_Free,
+        .GetRandomNum = Osal_GetRandomNum,
+        .GetTimeMs = Osal_GetTimeMs,
+        .GetTimeUs = Osal_GetTimeUs,
+    };
+    T_ZiyanLoggerConsole printConsole = {
+        .consoleLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_INFO,
+        .isSupportColor = false,
+    };
+    T_ZiyanLoggerConsole localRecordConsole = {
+        .consoleLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_DEBUG,
+        .isSupportColor = false,
+    };
+    char path[LOGGER_BENCHMARK_PATH_MAX_SIZE];
+    uint8_t sinkIndex;
+    int consoleFd;
+    int logFileFd;
+
+    // The console of the application is a terminal or a pipe on the board, a file stands in for it here.
+    snprintf(path, sizeof(path), "%s/ziyan_logger_benchmark_%s_console.log", config->dirPath, s_modeNames[mode]);
+    consoleFd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (consoleFd < 0 || dup2(consoleFd, STDOUT_FILENO) < 0) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    close(consoleFd);
+
+    snprintf(path, sizeof(path), "%s/ziyan_logger_benchmark_%s.log", config->dirPath, s_modeNames[mode]);
+    if (mode == LOGGER_BENCHMARK_MODE_SYNC) {
+        s_syncLogFile = fopen(path, "w");
+        if (s_syncLogFile == NULL) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        printConsole.func = LoggerBenchmark_SyncPrintConsole;
+        localRecordConsole.func = LoggerBenchmark_SyncLocalWrite;
+    } else {
+        logFileFd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (logFileFd < 0 || LoggerAsync_Init(NULL) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+            LoggerAsync_AddSink(STDOUT_FILENO, LOGGER_ASYNC_SINK_TYPE_TEXT, &sinkIndex) !=
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        s_asyncConsoleSinkIndex = sinkIndex;
+
+        if (LoggerAsync_AddSink(logFileFd, LOGGER_ASYNC_SINK_TYPE_TEXT, &sinkIndex) !=
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        s_asyncLogFileSinkIndex = sinkIndex;
+        printConsole.func = LoggerBenchmark_AsyncPrintConsole;
+        localRecordConsole.func = LoggerBenchmark_AsyncLocalWrite;
+    }
+
+    if (ZiyanPlatform_RegOsalHandler(&osalHandler) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        ZiyanLogger_AddConsole(&printConsole) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        ZiyanLogger_AddConsole(&localRecordConsole) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void *LoggerBenchmark_WorkerTask(void *arg)
+{
+    T_LoggerBenchmarkWorker *worker = arg;
+    struct timespec nextTime;
+    uint64_t startNs;
+    uint32_t i;
+
+    clock_gettime(CLOCK_MONOTONIC, &nextTime);
+    for (i = 0; i < worker->config->callCount; i++) {
+        if (worker->config->rate != 0) {
+            nextTime.tv_nsec += 1000000000 / worker->config->rate;
+            while (nextTime.tv_nsec >= 1000000000) {
+                nextTime.tv_nsec -= 1000000000;
+                nextTime.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextTime, NULL);
+        }
+
+        startNs = LoggerBenchmark_GetTimeNs();
+        USER_LOG_INFO("Benchmark thread %u call %u, gimbal angle %.2f %.2f %.2f.", worker->threadIndex, i,
+                      (double) i * 0.01, (double) worker->threadIndex, -(double) i * 0.02);
+        worker->latenciesNs[i] = LoggerBenchmark_GetTimeNs() - startNs;
+    }
+
+    return NULL;
+}
+
+// The consoles of the application before the asynchronous logger, writing on the calling thread.
+static T_ZiyanReturnCode LoggerBenchmark_SyncPrintConsole(const uint8_t *data, uint16_t dataLen)
+{
+    USER_UTIL_UNUSED(dataLen);
+
+    printf("%s", data);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode LoggerBenchmark_SyncLocalWrite(const uint8_t *data, uint16_t dataLen)
+{
+    uint32_t realLen;
+
+    realLen = fwrite(data, 1, dataLen, s_syncLogFile);
+    fflush(s_syncLogFile);
+
+    return realLen == dataLen ? ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS : ZIYAN_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+}
+
+static T_ZiyanReturnCode LoggerBenchmark_AsyncPrintConsole(const uint8_t *data, uint16_t dataLen)
+{
+    return LoggerAsync_Write(s_asyncConsoleSinkIndex, LoggerAsync_GetLineLevel(data, dataLen), data, dataLen);
+}
+
+static T_ZiyanReturnCode LoggerBenchmark_AsyncLocalWrite(const uint8_t *data, uint16_t dataLen)
+{
+    return LoggerAsync_Write(s_asyncLogFileSinkIndex, LoggerAsync_GetLineLevel(data, dataLen), data, dataLen);
+}
+
+static int LoggerBenchmark_CompareLatency(const void *first, const void *second)
+{
+    uint64_t firstLatency = *(const uint64_t *) first;
+    uint64_t secondLatency = *(const uint64_t *) second;
+
+    return firstLatency < secondLatency ? -1 : firstLatency > secondLatency;
+}
+
+static uint64_t LoggerBenchmark_GetTimeNs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
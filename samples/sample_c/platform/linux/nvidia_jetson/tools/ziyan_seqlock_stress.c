@@ -0,0 +1,545 @@
+/**
+ ********************************************************************
+ * @file    ziyan_seqlock_stress.c
+ * @brief   Host tool checking that util_seqlock.c readers never see torn values or go back in time, and measuring
+ *          the gimbal emulator task while its getters are hammered.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ziyan_fc_subscription.h"
+#include "ziyan_gimbal.h"
+#include "ziyan_logger.h"
+#include "ziyan_platform.h"
+#include "osal/osal.h"
+#include "fc_subscription/fc_subscription_dispatcher.h"
+#include "gimbal_emu/test_payload_gimbal_emu.h"
+#include "utils/util_metrics.h"
+#include "utils/util_seqlock.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define SEQLOCK_STRESS_READER_COUNT             4
+#define SEQLOCK_STRESS_READER_MAX_COUNT         64
+#define SEQLOCK_STRESS_WRITE_COUNT              2000000
+#define SEQLOCK_STRESS_WORD_COUNT               32 // 256 bytes, larger than the gimbal emulator state
+#define SEQLOCK_STRESS_WORD_MAX_COUNT           1024
+#define SEQLOCK_STRESS_GIMBAL_FEED_PERIOD_US    10000 // aircraft quaternion at 100 Hz, as the emulator subscribes it
+#define SEQLOCK_STRESS_GIMBAL_YAW_RATE          30.0 // unit: degree/s, aircraft turn, well above the emulator deadband
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t index;
+    bool isInPlace; /*!< Read with UtilSeqlock_ReadBegin() and UtilSeqlock_ReadRetry() instead of a copy. */
+    uint64_t readCount;
+    uint64_t tornCount; /*!< Reads whose words are not all from the same write. */
+    uint64_t backwardCount; /*!< Reads older than the previous read of the same thread. */
+    uint64_t retryCount;
+    uint32_t maxRetryCount;
+} T_SeqlockStressReader;
+
+typedef struct {
+    uint32_t index;
+    uint64_t roundCount; /*!< Calls of GetAttitudeInformation(), GetSystemState() and GetJointAngle() in a row. */
+    uint64_t errorCount;
+} T_SeqlockStressGimbalReader;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *SeqlockStress_ReaderTask(void *arg);
+static bool SeqlockStress_ReadCopy(uint64_t *value, uint64_t *generation, uint32_t *retryCount);
+static bool SeqlockStress_ReadInPlace(uint64_t *generation, uint32_t *retryCount);
+static int SeqlockStress_RunGimbal(uint32_t readerCount, uint32_t durationS);
+static void *SeqlockStress_GimbalReaderTask(void *arg);
+static void *SeqlockStress_GimbalFeedTask(void *arg);
+static T_ZiyanReturnCode SeqlockStress_PrintConsole(const uint8_t *data, uint16_t dataLen);
+static double SeqlockStress_GetTimeNs(void);
+
+/* Private values ------------------------------------------------------------*/
+static T_UtilSeqlock s_seqlock;
+static uint64_t *s_copies;
+static uint32_t s_wordCount = SEQLOCK_STRESS_WORD_COUNT;
+static volatile bool s_isWriterDone = false;
+static volatile uint32_t s_readyReaderCount = 0;
+
+/* The SDK stand-ins below hand the gimbal handler and the quaternion callback to the gimbal run. */
+static const T_ZiyanGimbalCommonHandler *s_gimbalHandler = NULL;
+static ZiyanReceiveDataOfTopicCallback s_quaternionCallback = NULL;
+static volatile bool s_isGimbalRunDone = false;
+static T_ZiyanOsalHandler s_osalHandler = {
+    .TaskCreate = Osal_TaskCreate,
+    .TaskDestroy = Osal_TaskDestroy,
+    .TaskSleepMs = Osal_TaskSleepMs,
+    .MutexCreate = Osal_MutexCreate,
+    .MutexDestroy = Osal_MutexDestroy,
+    .MutexLock = Osal_MutexLock,
+    .MutexUnlock = Osal_MutexUnlock,
+    .SemaphoreCreate = Osal_SemaphoreCreate,
+    .SemaphoreDestroy = Osal_SemaphoreDestroy,
+    .SemaphoreWait = Osal_SemaphoreWait,
+    .SemaphoreTimedWait = Osal_SemaphoreTimedWait,
+    .SemaphorePost = Osal_SemaphorePost,
+    .Malloc = Osal_Malloc,
+    .Free = Osal_Free,
+    .GetRandomNum = Osal_GetRandomNum,
+    .GetTimeMs = Osal_GetTimeMs,
+    .GetTimeUs = Osal_GetTimeUs,
+};
+static T_ZiyanLoggerConsole s_printConsole = {
+    .func = SeqlockStress_PrintConsole,
+    .consoleLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_ERROR,
+    .isSupportColor = false,
+};
+
+/* Shares the values of the emulator histogram of the same name. */
+static T_UtilMetric s_gimbalTaskPeriod = UTIL_METRICS_HISTOGRAM("ziyan_gimbal_task_period_microseconds",
+                                                                "Time between two iterations of the gimbal task.");
+static T_UtilMetric s_gimbalReadTime = UTIL_METRICS_HISTOGRAM("ziyan_seqlock_stress_gimbal_round_ns",
+                                                              "Time of a round of the three gimbal getters.");
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_SeqlockStressReader readers[SEQLOCK_STRESS_READER_MAX_COUNT];
+    pthread_t threads[SEQLOCK_STRESS_READER_MAX_COUNT];
+    uint64_t *value;
+    uint32_t readerCount = SEQLOCK_STRESS_READER_COUNT;
+    uint32_t writeCount = SEQLOCK_STRESS_WRITE_COUNT;
+    uint32_t periodUs = 0;
+    uint32_t gimbalDurationS = 0;
+    uint32_t i;
+    uint32_t j;
+    uint64_t generation;
+    double startNs;
+    double writeNs;
+    bool isPassed = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:n:w:p:g:")) != -1) {
+        switch (opt) {
+            case 'r':
+                readerCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                writeCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                s_wordCount = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                periodUs = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'g':
+                gimbalDurationS = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r readers] [-n writes] [-w words per value] [-p write period us]\n"
+                                "       %s -g seconds [-r readers]\n"
+                                "  Half of the readers copy the value, the others read it in place. Without -p the\n"
+                                "  writer publishes back to back, the worst case for the readers.\n"
+                                "  With -g the readers call the gimbal emulator getters instead, while its task\n"
+                                "  follows an aircraft turning at 100 Hz. -r 0 gives the task period alone.\n",
+                        argv[0], argv[0]);
+                return 2;
+        }
+    }
+    if (gimbalDurationS > 0) {
+        return SeqlockStress_RunGimbal(USER_UTIL_MIN(readerCount, SEQLOCK_STRESS_READER_MAX_COUNT), gimbalDurationS);
+    }
+    readerCount = USER_UTIL_MIN(USER_UTIL_MAX(readerCount, 1), SEQLOCK_STRESS_READER_MAX_COUNT);
+    s_wordCount = USER_UTIL_MIN(USER_UTIL_MAX(s_wordCount, 1), SEQLOCK_STRESS_WORD_MAX_COUNT);
+
+    s_copies = calloc(UTIL_SEQLOCK_COPY_COUNT * s_wordCount, sizeof(uint64_t));
+    value = calloc(s_wordCount, sizeof(uint64_t));
+    if (s_copies == NULL || value == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < readerCount; i++) {
+        memset(&readers[i], 0, sizeof(readers[i]));
+        readers[i].index = i;
+        readers[i].isInPlace = (i % 2) == 1;
+        if (pthread_create(&threads[i], NULL, SeqlockStress_ReaderTask, &readers[i]) != 0) {
+            fprintf(stderr, "create reader error\n");
+            return 1;
+        }
+    }
+    while (__atomic_load_n(&s_readyReaderCount, __ATOMIC_ACQUIRE) < readerCount) {
+        sched_yield();
+    }
+
+    // Every word of a value holds its generation, a torn read mixes two of them.
+    startNs = SeqlockStress_GetTimeNs();
+    for (generation = 1; generation <= writeCount; generation++) {
+        for (j = 0; j < s_wordCount; j++) {
+            value[j] = generation;
+        }
+        UtilSeqlock_Write(&s_seqlock, s_copies, value, s_wordCount * sizeof(uint64_t));
+        if (periodUs > 0) {
+            usleep(periodUs);
+        }
+    }
+    writeNs = (SeqlockStress_GetTimeNs() - startNs) / writeCount;
+    __atomic_store_n(&s_isWriterDone, true, __ATOMIC_RELEASE);
+
+    printf("%u writes of %u bytes, %.1f ns/write including the period\n\n", writeCount,
+           (unsigned int) (s_wordCount * sizeof(uint64_t)), writeNs);
+    printf("%-8s %-8s %12s %10s %10s %12s %10s\n", "reader", "mode", "reads", "torn", "backward", "retries/read",
+           "max retry");
+    for (i = 0; i < readerCount; i++) {
+        pthread_join(threads[i], NULL);
+        printf("%-8u %-8s %12llu %10llu %10llu %12.4f %10u\n", readers[i].index,
+               readers[i].isInPlace ? "in place" : "copy", (unsigned long long) readers[i].readCount,
+               (unsigned long long) readers[i].tornCount, (unsigned long long) readers[i].backwardCount,
+               readers[i].readCount > 0 ? (double) readers[i].retryCount / (double) readers[i].readCount : 0.0,
+               readers[i].maxRetryCount);
+        if (readers[i].tornCount > 0 || readers[i].backwardCount > 0 || readers[i].readCount == 0) {
+            isPassed = false;
+        }
+    }
+
+    free(s_copies);
+    free(value);
+
+    printf("\n%s\n", isPassed ? "PASSED" : "FAILED");
+
+    return isPassed ? 0 : 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void *SeqlockStress_ReaderTask(void *arg)
+{
+    T_SeqlockStressReader *reader = arg;
+    uint64_t *value;
+    uint64_t lastGeneration = 0;
+    uint64_t generation;
+    uint32_t retryCount;
+    bool isTorn;
+    bool isWriterDone;
+
+    value = calloc(s_wordCount, sizeof(uint64_t));
+    if (value == NULL) {
+        return NULL;
+    }
+    __atomic_add_fetch(&s_readyReaderCount, 1, __ATOMIC_RELEASE);
+
+    do {
+        // Sampled before the read, so that the last read sees the last write.
+        isWriterDone = __atomic_load_n(&s_isWriterDone, __ATOMIC_ACQUIRE);
+        if (reader->isInPlace) {
+            isTorn = SeqlockStress_ReadInPlace(&generation, &retryCount);
+        } else {
+            isTorn = SeqlockStress_ReadCopy(value, &generation, &retryCount);
+        }
+
+        reader->readCount++;
+        reader->retryCount += retryCount;
+        reader->maxRetryCount = USER_UTIL_MAX(reader->maxRetryCount, retryCount);
+        if (isTorn) {
+            reader->tornCount++;
+        }
+        if (generation < lastGeneration) {
+            reader->backwardCount++;
+        }
+        lastGeneration = generation;
+    } while (!isWriterDone);
+
+    free(value);
+
+    return NULL;
+}
+
+static bool SeqlockStress_ReadCopy(uint64_t *value, uint64_t *generation, uint32_t *retryCount)
+{
+    uint32_t i;
+
+    *retryCount = UtilSeqlock_Read(&s_seqlock, s_copies, value, s_wordCount * sizeof(uint64_t));
+    *generation = value[0];
+    for (i = 1; i < s_wordCount; i++) {
+        if (value[i] != *generation) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool SeqlockStress_ReadInPlace(uint64_t *generation, uint32_t *retryCount)
+{
+    const volatile uint64_t *copy;
+    uint32_t sequence;
+    uint32_t i;
+    bool isTorn;
+
+    *retryCount = 0;
+    for (;;) {
+        copy = UtilSeqlock_ReadBegin(&s_seqlock, s_copies, s_wordCount * sizeof(uint64_t), &sequence);
+        *generation = copy[0];
+        isTorn = false;
+        for (i = 1; i < s_wordCount; i++) {
+            if (copy[i] != *generation) {
+                isTorn = true;
+                break;
+            }
+        }
+        if (!UtilSeqlock_ReadRetry(&s_seqlock, sequence)) {
+            return isTorn;
+        }
+        (*retryCount)++;
+    }
+}
+
+static int SeqlockStress_RunGimbal(uint32_t readerCount, uint32_t durationS)
+{
+    static const float quantiles[] = {0.5f, 0.9f, 0.99f, 0.999f, 1.0f};
+    static const char *quantileNames[] = {"p50", "p90", "p99", "p99.9", "max"};
+    T_SeqlockStressGimbalReader readers[SEQLOCK_STRESS_READER_MAX_COUNT];
+    pthread_t threads[SEQLOCK_STRESS_READER_MAX_COUNT];
+    pthread_t feedThread;
+    T_ZiyanReturnCode returnCode;
+    uint32_t i;
+    bool isPassed = true;
+
+    if (ZiyanPlatform_RegOsalHandler(&s_osalHandler) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        ZiyanLogger_AddConsole(&s_printConsole) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "platform init error\n");
+        return 1;
+    }
+
+    returnCode = FcSubscriptionDispatcher_Init();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "dispatcher init error 0x%08llX\n", (unsigned long long) returnCode);
+        return 1;
+    }
+
+    returnCode = ZiyanTest_GimbalStartService();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS || s_gimbalHandler == NULL) {
+        fprintf(stderr, "gimbal start error 0x%08llX\n", (unsigned long long) returnCode);
+        return 1;
+    }
+
+    // In yaw follow every aircraft attitude moves the trajectory, so the task runs at the quaternion rate.
+    returnCode = s_gimbalHandler->SetMode(ZIYAN_GIMBAL_MODE_YAW_FOLLOW);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "gimbal set mode error 0x%08llX\n", (unsigned long long) returnCode);
+        return 1;
+    }
+
+    if (pthread_create(&feedThread, NULL, SeqlockStress_GimbalFeedTask, NULL) != 0) {
+        fprintf(stderr, "create feed error\n");
+        return 1;
+    }
+    for (i = 0; i < readerCount; i++) {
+        memset(&readers[i], 0, sizeof(readers[i]));
+        readers[i].index = i;
+        if (pthread_create(&threads[i], NULL, SeqlockStress_GimbalReaderTask, &readers[i]) != 0) {
+            fprintf(stderr, "create reader error\n");
+            return 1;
+        }
+    }
+
+    sleep(durationS);
+    __atomic_store_n(&s_isGimbalRunDone, true, __ATOMIC_RELEASE);
+    pthread_join(feedThread, NULL);
+
+    printf("%u gimbal readers for %u s, aircraft attitude every %u us\n", readerCount, durationS,
+           SEQLOCK_STRESS_GIMBAL_FEED_PERIOD_US);
+    if (readerCount > 0) {
+        printf("\n%-8s %12s %10s\n", "reader", "rounds", "errors");
+    }
+    for (i = 0; i < readerCount; i++) {
+        pthread_join(threads[i], NULL);
+        printf("%-8u %12llu %10llu\n", readers[i].index, (unsigned long long) readers[i].roundCount,
+               (unsigned long long) readers[i].errorCount);
+        if (readers[i].errorCount > 0 || readers[i].roundCount == 0) {
+            isPassed = false;
+        }
+    }
+
+    printf("\n%-40s", "");
+    for (i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        printf(" %10s", quantileNames[i]);
+    }
+    printf("\n%-40s", s_gimbalTaskPeriod.name);
+    for (i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        printf(" %10llu", (unsigned long long) UtilMetrics_HistogramGetQuantile(&s_gimbalTaskPeriod, quantiles[i]));
+    }
+    if (readerCount > 0) {
+        printf("\n%-40s", s_gimbalReadTime.name);
+        for (i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+            printf(" %10llu", (unsigned long long) UtilMetrics_HistogramGetQuantile(&s_gimbalReadTime, quantiles[i]));
+        }
+    }
+    printf("\n");
+
+    // An empty histogram means the task never followed the aircraft.
+    if (UtilMetrics_HistogramGetQuantile(&s_gimbalTaskPeriod, 0.5f) == 0) {
+        isPassed = false;
+    }
+
+    ZiyanTest_GimbalDeInit();
+
+    printf("\n%s\n", isPassed ? "PASSED" : "FAILED");
+
+    return isPassed ? 0 : 1;
+}
+
+static void *SeqlockStress_GimbalReaderTask(void *arg)
+{
+    T_SeqlockStressGimbalReader *reader = arg;
+    T_ZiyanGimbalAttitudeInformation attitudeInformation;
+    T_ZiyanGimbalSystemState systemState;
+    T_ZiyanAttitude3d jointAngle;
+    double startNs;
+
+    while (!__atomic_load_n(&s_isGimbalRunDone, __ATOMIC_ACQUIRE)) {
+        startNs = SeqlockStress_GetTimeNs();
+        if (s_gimbalHandler->GetAttitudeInformation(&attitudeInformation) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+            s_gimbalHandler->GetSystemState(&systemState) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+            s_gimbalHandler->GetJointAngle(&jointAngle) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            reader->errorCount++;
+        }
+        UtilMetrics_HistogramRecord(&s_gimbalReadTime, (uint64_t) (SeqlockStress_GetTimeNs() - startNs));
+        reader->roundCount++;
+    }
+
+    return NULL;
+}
+
+static void *SeqlockStress_GimbalFeedTask(void *arg)
+{
+    T_ZiyanFcSubscriptionQuaternion quaternion = {0};
+    T_ZiyanDataTimestamp timestamp = {0};
+    ZiyanReceiveDataOfTopicCallback callback;
+    double startNs = SeqlockStress_GetTimeNs();
+    double timeNs;
+    double yaw;
+
+    USER_UTIL_UNUSED(arg);
+
+    while (!__atomic_load_n(&s_isGimbalRunDone, __ATOMIC_ACQUIRE)) {
+        // The emulator subscribes the quaternion from its task, a little after the start of the service.
+        callback = __atomic_load_n(&s_quaternionCallback, __ATOMIC_ACQUIRE);
+        if (callback != NULL) {
+            timeNs = SeqlockStress_GetTimeNs() - startNs;
+            yaw = SEQLOCK_STRESS_GIMBAL_YAW_RATE * M_PI / 180.0 * timeNs / 1e9;
+            quaternion.q0 = (ziyan_f32_t) cos(yaw / 2);
+            quaternion.q3 = (ziyan_f32_t) sin(yaw / 2);
+            timestamp.millisecond = (uint32_t) (timeNs / 1e6);
+            timestamp.microsecond = (uint32_t) (timeNs / 1e3);
+            callback((const uint8_t *) &quaternion, sizeof(T_ZiyanFcSubscriptionQuaternion), &timestamp);
+        }
+        usleep(SEQLOCK_STRESS_GIMBAL_FEED_PERIOD_US);
+    }
+
+    return NULL;
+}
+
+static T_ZiyanReturnCode SeqlockStress_PrintConsole(const uint8_t *data, uint16_t dataLen)
+{
+    fwrite(data, 1, dataLen, stderr);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static double SeqlockStress_GetTimeNs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double) time.tv_sec * 1e9 + (double) time.tv_nsec;
+}
+
+/* SDK stand-ins --------------------------------------------------------------*/
+/* Without an aircraft the SDK modules do not start, the gimbal run links these instead of their archive members. */
+T_ZiyanReturnCode ZiyanGimbal_Init(void)
+{
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanGimbal_DeInit(void)
+{
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanGimbal_RegCommonHandler(const T_ZiyanGimbalCommonHandler *commonHandler)
+{
+    s_gimbalHandler = commonHandler;
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanFcSubscription_Init(void)
+{
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanFcSubscription_DeInit(void)
+{
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanFcSubscription_SubscribeTopic(E_ZiyanFcSubscriptionTopic topic,
+                                                     E_ZiyanDataSubscriptionTopicFreq frequency,
+                                                     ZiyanReceiveDataOfTopicCallback callback)
+{
+    USER_UTIL_UNUSED(frequency);
+
+    if (topic != ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT;
+    }
+    __atomic_store_n(&s_quaternionCallback, callback, __ATOMIC_RELEASE);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanFcSubscription_UnSubscribeTopic(E_ZiyanFcSubscriptionTopic topic)
+{
+    if (topic == ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION) {
+        __atomic_store_n(&s_quaternionCallback, NULL, __ATOMIC_RELEASE);
+    }
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_ZiyanReturnCode ZiyanFcSubscription_GetLatestValueOfTopic(E_ZiyanFcSubscriptionTopic topic, uint8_t *data,
+                                                            uint16_t dataSizeOfTopic, T_ZiyanDataTimestamp *timestamp)
+{
+    USER_UTIL_UNUSED(topic);
+    USER_UTIL_UNUSED(data);
+    USER_UTIL_UNUSED(dataSizeOfTopic);
+    USER_UTIL_UNUSED(timestamp);
+
+    // Values only come through the subscription callback.
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,586 @@
+/**
+ ********************************************************************
+ * @file    ziyan_telemetry_export.c
+ * @brief   Host tool exporting telemetry sessions written by recorder_telemetry.c to CSV or column files.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ziyan_fc_subscription.h"
+#include "recorder/recorder_reader.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define TELEMETRY_EXPORT_PATH_SIZE_MAX          512
+#define TELEMETRY_EXPORT_FIELD_MAX_NUM          12
+// Receive time, subscription timestamp in ms and us, and sequence precede the fields of each row.
+#define TELEMETRY_EXPORT_META_COLUMN_NUM        4
+#define TELEMETRY_EXPORT_COLUMN_MAX_NUM         (TELEMETRY_EXPORT_META_COLUMN_NUM + TELEMETRY_EXPORT_FIELD_MAX_NUM)
+
+#define TELEMETRY_EXPORT_FIELD(structure, member, type) \
+    {#member, TELEMETRY_EXPORT_TYPE_##type, offsetof(structure, member)}
+#define TELEMETRY_EXPORT_TOPIC(name, fields) \
+    {name, fields, sizeof(fields) / sizeof(fields[0])}
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    TELEMETRY_EXPORT_TYPE_U8 = 0,
+    TELEMETRY_EXPORT_TYPE_U16,
+    TELEMETRY_EXPORT_TYPE_U32,
+    TELEMETRY_EXPORT_TYPE_U64,
+    TELEMETRY_EXPORT_TYPE_I16,
+    TELEMETRY_EXPORT_TYPE_I32,
+    TELEMETRY_EXPORT_TYPE_F32,
+    TELEMETRY_EXPORT_TYPE_F64,
+    TELEMETRY_EXPORT_TYPE_BYTES, /*!< The whole value, for topics without a field table. */
+} E_TelemetryExportType;
+
+typedef struct {
+    const char *name;
+    E_TelemetryExportType type;
+    uint16_t offset;
+} T_TelemetryExportField;
+
+typedef struct {
+    const char *name;
+    const T_TelemetryExportField *fields;
+    uint8_t fieldCount;
+} T_TelemetryExportTopic;
+
+typedef struct {
+    FILE *files[TELEMETRY_EXPORT_COLUMN_MAX_NUM]; /*!< One CSV file, or one file per column. */
+    uint64_t recordCount;
+    uint64_t gapCount; /*!< Values missing from the sequence, dropped by the recorder. */
+    uint32_t lastSequence;
+    uint16_t dataSize;
+    bool isFailed;
+} T_TelemetryExportOutput;
+
+/* Private functions declaration ---------------------------------------------*/
+static int TelemetryExport_FindTopic(const char *name);
+static int TelemetryExport_OpenOutput(T_TelemetryExportOutput *output, uint16_t topic, uint16_t dataSize,
+                                      const char *directory, bool isColumns);
+static void TelemetryExport_WriteCsv(T_TelemetryExportOutput *output, uint16_t topic,
+                                     const T_RecorderReaderRecord *record, double timeSec);
+static void TelemetryExport_WriteColumns(T_TelemetryExportOutput *output, uint16_t topic,
+                                         const T_RecorderReaderRecord *record);
+static void TelemetryExport_PrintField(FILE *file, const T_TelemetryExportField *field, const uint8_t *data,
+                                       uint16_t dataSize);
+static uint16_t TelemetryExport_GetFieldSize(E_TelemetryExportType type, uint16_t dataSize);
+static const char *TelemetryExport_GetTypeName(E_TelemetryExportType type);
+static const T_TelemetryExportField *TelemetryExport_GetFields(uint16_t topic, uint8_t *fieldCount);
+
+/* Private values ------------------------------------------------------------*/
+static const T_TelemetryExportField s_bytesFields[] = {
+    {"data", TELEMETRY_EXPORT_TYPE_BYTES, 0},
+};
+static const T_TelemetryExportField s_quaternionFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionQuaternion, q0, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionQuaternion, q1, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionQuaternion, q2, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionQuaternion, q3, F32),
+};
+static const T_TelemetryExportField s_vector3fFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanVector3f, x, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanVector3f, y, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanVector3f, z, F32),
+};
+static const T_TelemetryExportField s_vector3dFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanVector3d, x, I32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanVector3d, y, I32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanVector3d, z, I32),
+};
+// The health bit of the velocity shares its byte with reserved bits, the byte is exported as is.
+static const T_TelemetryExportField s_velocityFields[] = {
+    {"x", TELEMETRY_EXPORT_TYPE_F32, offsetof(T_ZiyanFcSubscriptionVelocity, data.x)},
+    {"y", TELEMETRY_EXPORT_TYPE_F32, offsetof(T_ZiyanFcSubscriptionVelocity, data.y)},
+    {"z", TELEMETRY_EXPORT_TYPE_F32, offsetof(T_ZiyanFcSubscriptionVelocity, data.z)},
+    {"health", TELEMETRY_EXPORT_TYPE_U8, sizeof(T_ZiyanVector3f)},
+};
+static const T_TelemetryExportField s_positionFusedFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionPositionFused, longitude, F64),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionPositionFused, latitude, F64),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionPositionFused, altitude, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionPositionFused, visibleSatelliteNumber, U16),
+};
+static const T_TelemetryExportField s_gpsDetailsFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, hdop, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, pdop, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, fixState, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, vacc, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, hacc, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, sacc, F32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, gpsSatelliteNumberUsed, U32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, glonassSatelliteNumberUsed, U32),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, totalSatelliteNumberUsed, U16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionGpsDetails, gpsCounter, U16),
+};
+static const T_TelemetryExportField s_rtkPositionFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRtkPosition, longitude, F64),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRtkPosition, latitude, F64),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRtkPosition, hfsl, F32),
+};
+static const T_TelemetryExportField s_compassFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionCompass, x, I16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionCompass, y, I16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionCompass, z, I16),
+};
+static const T_TelemetryExportField s_rcFields[] = {
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRC, roll, I16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRC, pitch, I16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRC, yaw, I16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRC, throttle, I16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRC, mode, I16),
+    TELEMETRY_EXPORT_FIELD(T_ZiyanFcSubscriptionRC, gear, I16),
+};
+static const T_TelemetryExportField s_f32Fields[] = {
+    {"value", TELEMETRY_EXPORT_TYPE_F32, 0},
+};
+static const T_TelemetryExportField s_u32Fields[] = {
+    {"value", TELEMETRY_EXPORT_TYPE_U32, 0},
+};
+static const T_TelemetryExportField s_u16Fields[] = {
+    {"value", TELEMETRY_EXPORT_TYPE_U16, 0},
+};
+static const T_TelemetryExportField s_i16Fields[] = {
+    {"value", TELEMETRY_EXPORT_TYPE_I16, 0},
+};
+static const T_TelemetryExportField s_u8Fields[] = {
+    {"value", TELEMETRY_EXPORT_TYPE_U8, 0},
+};
+
+// Indexed by the topic number, E_ZiyanFcSubscriptionTopic of the flight controller module.
+static const T_TelemetryExportTopic s_exportTopics[] = {
+    TELEMETRY_EXPORT_TOPIC("quaternion", s_quaternionFields),
+    TELEMETRY_EXPORT_TOPIC("acceleration_ground", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("acceleration_body", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("acceleration_raw", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("velocity", s_velocityFields),
+    TELEMETRY_EXPORT_TOPIC("angular_rate_fusioned", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("angular_rate_raw", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("altitude_fused", s_f32Fields),
+    TELEMETRY_EXPORT_TOPIC("altitude_barometer", s_f32Fields),
+    TELEMETRY_EXPORT_TOPIC("altitude_of_homepoint", s_f32Fields),
+    TELEMETRY_EXPORT_TOPIC("height_fusion", s_f32Fields),
+    TELEMETRY_EXPORT_TOPIC("height_relative", s_f32Fields),
+    TELEMETRY_EXPORT_TOPIC("position_fused", s_positionFusedFields),
+    TELEMETRY_EXPORT_TOPIC("gps_date", s_u32Fields),
+    TELEMETRY_EXPORT_TOPIC("gps_time", s_u32Fields),
+    TELEMETRY_EXPORT_TOPIC("gps_position", s_vector3dFields),
+    TELEMETRY_EXPORT_TOPIC("gps_velocity", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("gps_details", s_gpsDetailsFields),
+    TELEMETRY_EXPORT_TOPIC("gps_signal_level", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("rtk_position", s_rtkPositionFields),
+    TELEMETRY_EXPORT_TOPIC("rtk_velocity", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("rtk_yaw", s_i16Fields),
+    TELEMETRY_EXPORT_TOPIC("rtk_position_info", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("rtk_yaw_info", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("compass", s_compassFields),
+    TELEMETRY_EXPORT_TOPIC("rc", s_rcFields),
+    TELEMETRY_EXPORT_TOPIC("gimbal_angles", s_vector3fFields),
+    TELEMETRY_EXPORT_TOPIC("gimbal_status", s_u32Fields),
+    TELEMETRY_EXPORT_TOPIC("status_flight", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("status_displaymode", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("status_landinggear", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("status_motor_start_error", s_u16Fields),
+    TELEMETRY_EXPORT_TOPIC("battery_info", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("control_device", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("hard_sync", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("gps_control_level", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("rc_with_flag_data", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("esc_data", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("rtk_connect_status", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("gimbal_control_mode", s_u8Fields),
+    TELEMETRY_EXPORT_TOPIC("flight_anomaly", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("position_vo", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("avoid_data", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("home_point_set_status", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("home_point_info", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("three_gimbal_data", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("battery_single_info_index1", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("battery_single_info_index2", s_bytesFields),
+    TELEMETRY_EXPORT_TOPIC("imu_atti_navi_data_with_timestamp", s_bytesFields),
+};
+
+static const char *const s_metaColumnNames[TELEMETRY_EXPORT_META_COLUMN_NUM] = {
+    "receive_time_us", "timestamp_ms", "timestamp_us", "sequence"
+};
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_TelemetryExportOutput outputs[RECORDER_TELEMETRY_TOPIC_MAX];
+    T_RecorderReaderRecord record;
+    T_RecorderReader reader;
+    T_TelemetryExportOutput *output;
+    T_ZiyanReturnCode returnCode;
+    const char *directory = ".";
+    bool isColumns = false;
+    bool isPrintStatistics = false;
+    int topicFilter = -1;
+    uint64_t recordCount = 0;
+    double timeSec;
+    uint16_t topic;
+    uint16_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:t:o:s")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (strcmp(optarg, "columns") == 0) {
+                    isColumns = true;
+                } else if (strcmp(optarg, "csv") != 0) {
+                    goto usage;
+                }
+                break;
+            case 't':
+                topicFilter = TelemetryExport_FindTopic(optarg);
+                if (topicFilter < 0) {
+                    fprintf(stderr, "%s: unknown topic\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o':
+                directory = optarg;
+                break;
+            case 's':
+                isPrintStatistics = true;
+                break;
+            default:
+                goto usage;
+        }
+    }
+
+    if (optind != argc - 1) {
+        goto usage;
+    }
+
+    returnCode = RecorderReader_Open(&reader, argv[optind]);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "%s: not a telemetry index of version %d\n", argv[optind], RECORDER_TELEMETRY_VERSION);
+        return 1;
+    }
+
+    memset(outputs, 0, sizeof(outputs));
+    while (RecorderReader_Next(&reader, &record) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        topic = record.header->topic;
+        if (topic >= RECORDER_TELEMETRY_TOPIC_MAX || (topicFilter >= 0 && topic != topicFilter)) {
+            continue;
+        }
+
+        output = &outputs[topic];
+        if (output->recordCount == 0 && !output->isFailed &&
+            TelemetryExport_OpenOutput(output, topic, record.header->dataSize, directory, isColumns) != 0) {
+            output->isFailed = true;
+        }
+        if (output->isFailed) {
+            continue;
+        }
+
+        // Column files have fixed size rows, values of another size would misalign every following row.
+        if (record.header->dataSize != output->dataSize) {
+            fprintf(stderr, "topic %u: value size %u differs from %u, skipped\n", topic, record.header->dataSize,
+                    output->dataSize);
+            continue;
+        }
+
+        if (output->recordCount > 0 && record.header->sequence != output->lastSequence + 1) {
+            output->gapCount += record.header->sequence - output->lastSequence - 1;
+        }
+        output->lastSequence = record.header->sequence;
+        output->recordCount++;
+        recordCount++;
+
+        if (isColumns) {
+            TelemetryExport_WriteColumns(output, topic, &record);
+        } else {
+            timeSec = (double) (int64_t) (record.header->receiveTimeUs - reader.indexHeader.monotonicBaseUs) /
+                      1000000.0;
+            TelemetryExport_WriteCsv(output, topic, &record, timeSec);
+        }
+    }
+
+    for (topic = 0; topic < RECORDER_TELEMETRY_TOPIC_MAX; topic++) {
+        output = &outputs[topic];
+        if (isPrintStatistics && output->recordCount > 0) {
+            fprintf(stderr, "%s: %llu records, %llu dropped\n",
+                    topic < sizeof(s_exportTopics) / sizeof(s_exportTopics[0]) ? s_exportTopics[topic].name : "-",
+                    (unsigned long long) output->recordCount, (unsigned long long) output->gapCount);
+        }
+        for (i = 0; i < TELEMETRY_EXPORT_COLUMN_MAX_NUM; i++) {
+            if (output->files[i] != NULL) {
+                fclose(output->files[i]);
+            }
+        }
+    }
+
+    if (isPrintStatistics) {
+        fprintf(stderr, "records: %llu, segments: %u, start: %.6f\n", (unsigned long long) recordCount,
+                reader.entryCount, (double) reader.indexHeader.realtimeBaseUs / 1000000.0);
+    }
+    RecorderReader_Close(&reader);
+
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-f csv|columns] [-t topic] [-o directory] [-s] <session.zti>\n"
+                    "  -f  csv writes <topic>.csv, columns writes raw little endian <topic>.<column>.<type> files\n"
+                    "  -t  export one topic, by name or number\n"
+                    "  -o  output directory, the current one by default\n"
+                    "  -s  print record and drop counts to stderr\n", argv[0]);
+    return 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static int TelemetryExport_FindTopic(const char *name)
+{
+    char *end;
+    long number;
+    uint16_t i;
+
+    for (i = 0; i < sizeof(s_exportTopics) / sizeof(s_exportTopics[0]); i++) {
+        if (strcmp(name, s_exportTopics[i].name) == 0) {
+            return i;
+        }
+    }
+
+    number = strtol(name, &end, 0);
+    if (*name == '\0' || *end != '\0' || number < 0 || number >= RECORDER_TELEMETRY_TOPIC_MAX) {
+        return -1;
+    }
+
+    return (int) number;
+}
+
+static int TelemetryExport_OpenOutput(T_TelemetryExportOutput *output, uint16_t topic, uint16_t dataSize,
+                                      const char *directory, bool isColumns)
+{
+    char path[TELEMETRY_EXPORT_PATH_SIZE_MAX];
+    char topicName[16];
+    const T_TelemetryExportField *fields;
+    const char *name;
+    uint8_t fieldCount;
+    uint8_t i;
+
+    if (topic < sizeof(s_exportTopics) / sizeof(s_exportTopics[0])) {
+        name = s_exportTopics[topic].name;
+    } else {
+        snprintf(topicName, sizeof(topicName), "topic_%u", topic);
+        name = topicName;
+    }
+    fields = TelemetryExport_GetFields(topic, &fieldCount);
+    output->dataSize = dataSize;
+
+    if (!isColumns) {
+        snprintf(path, sizeof(path), "%s/%s.csv", directory, name);
+        output->files[0] = fopen(path, "w");
+        if (output->files[0] == NULL) {
+            perror(path);
+            return -1;
+        }
+
+        fprintf(output->files[0], "time,%s,%s,%s", s_metaColumnNames[1], s_metaColumnNames[2], s_metaColumnNames[3]);
+        for (i = 0; i < fieldCount; i++) {
+            fprintf(output->files[0], ",%s", fields[i].name);
+        }
+        fprintf(output->files[0], "\n");
+        return 0;
+    }
+
+    for (i = 0; i < TELEMETRY_EXPORT_META_COLUMN_NUM + fieldCount; i++) {
+        if (i < TELEMETRY_EXPORT_META_COLUMN_NUM) {
+            snprintf(path, sizeof(path), "%s/%s.%s.%s", directory, name, s_metaColumnNames[i],
+                     i == 0 ? "u64" : "u32");
+        } else {
+            snprintf(path, sizeof(path), "%s/%s.%s.%s", directory, name,
+                     fields[i - TELEMETRY_EXPORT_META_COLUMN_NUM].name,
+                     TelemetryExport_GetTypeName(fields[i - TELEMETRY_EXPORT_META_COLUMN_NUM].type));
+        }
+        output->files[i] = fopen(path, "wb");
+        if (output->files[i] == NULL) {
+            perror(path);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void TelemetryExport_WriteCsv(T_TelemetryExportOutput *output, uint16_t topic,
+                                     const T_RecorderReaderRecord *record, double timeSec)
+{
+    const T_TelemetryExportField *fields;
+    uint8_t fieldCount;
+    uint8_t i;
+
+    fields = TelemetryExport_GetFields(topic, &fieldCount);
+    fprintf(output->files[0], "%.6f,%u,%u,%u", timeSec, record->header->timestamp.millisecond,
+            record->header->timestamp.microsecond, record->header->sequence);
+    for (i = 0; i < fieldCount; i++) {
+        fputc(',', output->files[0]);
+        TelemetryExport_PrintField(output->files[0], &fields[i], record->data, record->header->dataSize);
+    }
+    fputc('\n', output->files[0]);
+}
+
+static void TelemetryExport_WriteColumns(T_TelemetryExportOutput *output, uint16_t topic,
+                                         const T_RecorderReaderRecord *record)
+{
+    const T_TelemetryExportField *fields;
+    uint32_t millisecond = record->header->timestamp.millisecond;
+    uint32_t microsecond = record->header->timestamp.microsecond;
+    uint64_t receiveTimeUs = record->header->receiveTimeUs;
+    uint32_t sequence = record->header->sequence;
+    uint16_t fieldSize;
+    uint8_t fieldCount;
+    uint8_t i;
+
+    fwrite(&receiveTimeUs, sizeof(receiveTimeUs), 1, output->files[0]);
+    fwrite(&millisecond, sizeof(millisecond), 1, output->files[1]);
+    fwrite(&microsecond, sizeof(microsecond), 1, output->files[2]);
+    fwrite(&sequence, sizeof(sequence), 1, output->files[3]);
+
+    fields = TelemetryExport_GetFields(topic, &fieldCount);
+    for (i = 0; i < fieldCount; i++) {
+        fieldSize = TelemetryExport_GetFieldSize(fields[i].type, record->header->dataSize);
+        if (fields[i].offset + fieldSize <= record->header->dataSize) {
+            fwrite(record->data + fields[i].offset, fieldSize, 1, output->files[TELEMETRY_EXPORT_META_COLUMN_NUM + i]);
+        }
+    }
+}
+
+static void TelemetryExport_PrintField(FILE *file, const T_TelemetryExportField *field, const uint8_t *data,
+                                       uint16_t dataSize)
+{
+    union {
+        uint8_t u8;
+        uint16_t u16;
+        uint32_t u32;
+        uint64_t u64;
+        int16_t i16;
+        int32_t i32;
+        float f32;
+        double f64;
+    } value;
+    uint16_t fieldSize = TelemetryExport_GetFieldSize(field->type, dataSize);
+    uint16_t i;
+
+    if (field->offset + fieldSize > dataSize) {
+        return;
+    }
+
+    // Values are packed, fields are copied out before being read.
+    memcpy(&value, data + field->offset, field->type == TELEMETRY_EXPORT_TYPE_BYTES ? 0 : fieldSize);
+    switch (field->type) {
+        case TELEMETRY_EXPORT_TYPE_U8:
+            fprintf(file, "%u", value.u8);
+            break;
+        case TELEMETRY_EXPORT_TYPE_U16:
+            fprintf(file, "%u", value.u16);
+            break;
+        case TELEMETRY_EXPORT_TYPE_U32:
+            fprintf(file, "%u", value.u32);
+            break;
+        case TELEMETRY_EXPORT_TYPE_U64:
+            fprintf(file, "%llu", (unsigned long long) value.u64);
+            break;
+        case TELEMETRY_EXPORT_TYPE_I16:
+            fprintf(file, "%d", value.i16);
+            break;
+        case TELEMETRY_EXPORT_TYPE_I32:
+            fprintf(file, "%d", value.i32);
+            break;
+        case TELEMETRY_EXPORT_TYPE_F32:
+            fprintf(file, "%.9g", value.f32);
+            break;
+        case TELEMETRY_EXPORT_TYPE_F64:
+            fprintf(file, "%.17g", value.f64);
+            break;
+        case TELEMETRY_EXPORT_TYPE_BYTES:
+            for (i = 0; i < fieldSize; i++) {
+                fprintf(file, "%02x", data[field->offset + i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static uint16_t TelemetryExport_GetFieldSize(E_TelemetryExportType type, uint16_t dataSize)
+{
+    switch (type) {
+        case TELEMETRY_EXPORT_TYPE_U8:
+            return 1;
+        case TELEMETRY_EXPORT_TYPE_U16:
+        case TELEMETRY_EXPORT_TYPE_I16:
+            return 2;
+        case TELEMETRY_EXPORT_TYPE_U32:
+        case TELEMETRY_EXPORT_TYPE_I32:
+        case TELEMETRY_EXPORT_TYPE_F32:
+            return 4;
+        case TELEMETRY_EXPORT_TYPE_U64:
+        case TELEMETRY_EXPORT_TYPE_F64:
+            return 8;
+        default:
+            return dataSize;
+    }
+}
+
+static const char *TelemetryExport_GetTypeName(E_TelemetryExportType type)
+{
+    switch (type) {
+        case TELEMETRY_EXPORT_TYPE_U8:
+            return "u8";
+        case TELEMETRY_EXPORT_TYPE_U16:
+            return "u16";
+        case TELEMETRY_EXPORT_TYPE_U32:
+            return "u32";
+        case TELEMETRY_EXPORT_TYPE_U64:
+            return "u64";
+        case TELEMETRY_EXPORT_TYPE_I16:
+            return "i16";
+        case TELEMETRY_EXPORT_TYPE_I32:
+            return "i32";
+        case TELEMETRY_EXPORT_TYPE_F32:
+            return "f32";
+        case TELEMETRY_EXPORT_TYPE_F64:
+            return "f64";
+        default:
+            return "bin";
+    }
+}
+
+static const T_TelemetryExportField *TelemetryExport_GetFields(uint16_t topic, uint8_t *fieldCount)
+{
+    if (topic >= sizeof(s_exportTopics) / sizeof(s_exportTopics[0])) {
+        *fieldCount = sizeof(s_bytesFields) / sizeof(s_bytesFields[0]);
+        return s_bytesFields;
+    }
+
+    *fieldCount = s_exportTopics[topic].fieldCount;
+    return s_exportTopics[topic].fields;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/
@@ -0,0 +1,366 @@
+/**
+ ********************************************************************
+ * @file    ziyan_telemetry_replay.c
+ * @brief   Host tool replaying telemetry sessions through the subscription cache and dispatcher, for benchmarks without
+ *          hardware.
+ *
+ * @copyright (c) 2021 ZIYAN. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of ZIYAN.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to ZIYAN and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of ZIYAN.
+ *
+ * If you receive this source code without ZIYAN’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify ZIYAN of its removal. ZIYAN reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ziyan_logger.h"
+#include "ziyan_platform.h"
+#include "osal/osal.h"
+#include "recorder/recorder_reader.h"
+#include "recorder/recorder_replay.h"
+#include "fc_subscription/fc_subscription_cache.h"
+#include "fc_subscription/fc_subscription_dispatcher.h"
+#include "utils/util_attitude.h"
+#include "utils/util_metrics.h"
+#include "utils/util_misc.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define TELEMETRY_REPLAY_SUBSCRIBE_FREQ         ZIYAN_DATA_SUBSCRIPTION_TOPIC_400_HZ
+#define TELEMETRY_REPLAY_FOLLOW_FREQ            ZIYAN_DATA_SUBSCRIPTION_TOPIC_100_HZ // as the gimbal follow modes
+#define TELEMETRY_REPLAY_LOOP_RATE_DEFAULT      1000 // unit: Hz
+#define TELEMETRY_REPLAY_CLIENT_TIMEOUT_MS      1000
+#define TELEMETRY_REPLAY_LOOP_TASK_STACK_SIZE   2048
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t iterationCount;
+    uint64_t missCount; /*!< Iterations without a quaternion in the cache. */
+    double yawSum; /*!< Sum of the yaw seen by every iteration, equal between runs of the virtual clock. */
+} T_TelemetryReplayLoopStatistics;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *TelemetryReplay_LoopTask(void *arg);
+static T_ZiyanReturnCode TelemetryReplay_FollowCallback(const uint8_t *data, uint16_t dataSize,
+                                                        const T_ZiyanDataTimestamp *timestamp);
+static T_ZiyanReturnCode TelemetryReplay_PrintConsole(const uint8_t *data, uint16_t dataLen);
+static void TelemetryReplay_WriteMetrics(const char *data, uint32_t len, void *arg);
+static uint64_t TelemetryReplay_GetTimeNs(void);
+
+/* Private values ------------------------------------------------------------*/
+static T_TelemetryReplayLoopStatistics s_loopStatistics;
+static uint32_t s_loopPeriodMs = 1000 / TELEMETRY_REPLAY_LOOP_RATE_DEFAULT;
+static T_ZiyanSemaHandle s_loopExitSema;
+
+static T_UtilMetric s_loopReadTime = UTIL_METRICS_HISTOGRAM("ziyan_replay_loop_read_ns",
+                                                            "Time of a control loop cache read and conversion.");
+static T_UtilMetric s_followTime = UTIL_METRICS_HISTOGRAM("ziyan_replay_follow_callback_ns",
+                                                          "Time of a follow consumer callback.");
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_RecorderReplayConfig replayConfig = {0};
+    T_RecorderReplayStatistics replayStatistics;
+    T_FcSubscriptionDispatcherConsumerConfig consumerConfig = {0};
+    T_FcSubscriptionDispatcherConsumerStatistics consumerStatistics;
+    T_FcSubscriptionDispatcherConsumerHandle consumer = NULL;
+    T_FcSubscriptionCacheSource replaySource = {RecorderReplay_SubscribeTopic, RecorderReplay_UnSubscribeTopic};
+    T_ZiyanOsalHandler osalHandler = {
+        .TaskCreate = Osal_TaskCreate,
+        .TaskDestroy = Osal_TaskDestroy,
+        .TaskSleepMs = RecorderReplay_TaskSleepMs,
+        .MutexCreate = Osal_MutexCreate,
+        .MutexDestroy = Osal_MutexDestroy,
+        .MutexLock = Osal_MutexLock,
+        .MutexUnlock = Osal_MutexUnlock,
+        .SemaphoreCreate = Osal_SemaphoreCreate,
+        .SemaphoreDestroy = Osal_SemaphoreDestroy,
+        .SemaphoreWait = Osal_SemaphoreWait,
+        .SemaphoreTimedWait = Osal_SemaphoreTimedWait,
+        .SemaphorePost = Osal_SemaphorePost,
+        .Malloc = Osal_Malloc,
+        .Free = Osal_Free,
+        .GetRandomNum = Osal_GetRandomNum,
+        .GetTimeMs = RecorderReplay_GetTimeMs,
+        .GetTimeUs = RecorderReplay_GetTimeUs,
+    };
+    T_ZiyanLoggerConsole printConsole = {
+        .func = TelemetryReplay_PrintConsole,
+        // Queues dropping values faster than real time are expected, the drops are in the statistics.
+        .consoleLevel = ZIYAN_LOGGER_CONSOLE_LOG_LEVEL_ERROR,
+        .isSupportColor = false,
+    };
+    T_RecorderReader reader;
+    T_ZiyanTaskHandle loopTask;
+    T_ZiyanReturnCode returnCode;
+    const char *metricsPath = NULL;
+    FILE *metricsFile;
+    uint64_t topicMask = 0;
+    uint32_t loopRate = TELEMETRY_REPLAY_LOOP_RATE_DEFAULT;
+    uint32_t topicCount = 0;
+    uint32_t i;
+    int opt;
+
+    replayConfig.clock = RECORDER_REPLAY_CLOCK_WALL;
+    replayConfig.speed = 1;
+    replayConfig.clientTimeoutMs = TELEMETRY_REPLAY_CLIENT_TIMEOUT_MS;
+    replayConfig.clientCount = 1; // the control loop
+
+    while ((opt = getopt(argc, argv, "x:vr:m:")) != -1) {
+        switch (opt) {
+            case 'x':
+                replayConfig.speed = strtod(optarg, NULL);
+                if (replayConfig.speed < 0) {
+                    goto usage;
+                }
+                break;
+            case 'v':
+                replayConfig.clock = RECORDER_REPLAY_CLOCK_VIRTUAL;
+                break;
+            case 'r':
+                loopRate = (uint32_t) strtoul(optarg, NULL, 0);
+                if (loopRate == 0 || loopRate > 1000) {
+                    goto usage;
+                }
+                break;
+            case 'm':
+                metricsPath = optarg;
+                break;
+            default:
+                goto usage;
+        }
+    }
+
+    if (optind != argc - 1) {
+        goto usage;
+    }
+    replayConfig.indexPath = argv[optind];
+    s_loopPeriodMs = 1000 / loopRate;
+
+    // The topics to subscribe are the ones the recorder has seen in any segment.
+    if (RecorderReader_Open(&reader, replayConfig.indexPath) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "%s: not a telemetry index of version %d\n", replayConfig.indexPath,
+                RECORDER_TELEMETRY_VERSION);
+        return 1;
+    }
+    for (i = 0; i < reader.entryCount; i++) {
+        topicMask |= reader.entries[i].topicMask;
+    }
+    RecorderReader_Close(&reader);
+
+    if (ZiyanPlatform_RegOsalHandler(&osalHandler) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        ZiyanLogger_AddConsole(&printConsole) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "platform init error\n");
+        return 1;
+    }
+
+    returnCode = RecorderReplay_Init(&replayConfig);
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "%s: replay init error 0x%08llX\n", replayConfig.indexPath, (unsigned long long) returnCode);
+        return 1;
+    }
+
+    FcSubscriptionCache_SetSource(&replaySource);
+    returnCode = FcSubscriptionDispatcher_Init();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "dispatcher init error 0x%08llX\n", (unsigned long long) returnCode);
+        goto out;
+    }
+
+    // The quaternion is left to the dispatcher, which subscribes it for its consumer.
+    for (i = 0; i < ZIYAN_FC_SUBSCRIPTION_TOPIC_TOTAL_NUMBER && i < RECORDER_TELEMETRY_TOPIC_MAX; i++) {
+        if ((topicMask & (1ULL << i)) == 0 || i == ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION ||
+            FcSubscriptionCache_GetTopicSize((E_ZiyanFcSubscriptionTopic) i) == 0) {
+            continue;
+        }
+        if (FcSubscriptionCache_SubscribeTopic((E_ZiyanFcSubscriptionTopic) i, TELEMETRY_REPLAY_SUBSCRIBE_FREQ) ==
+            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            topicCount++;
+        }
+    }
+
+    // Same work as the gimbal follow modes, on a dispatcher worker.
+    if ((topicMask & (1ULL << ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION)) != 0) {
+        topicCount++;
+        consumerConfig.name = "follow";
+        consumerConfig.topic = ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION;
+        consumerConfig.frequency = TELEMETRY_REPLAY_FOLLOW_FREQ;
+        consumerConfig.callback = TelemetryReplay_FollowCallback;
+        consumerConfig.dropPolicy = FC_SUBSCRIPTION_DISPATCHER_DROP_OLDEST;
+        returnCode = FcSubscriptionDispatcher_AddConsumer(&consumerConfig, &consumer);
+        if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            fprintf(stderr, "add follow consumer error 0x%08llX\n", (unsigned long long) returnCode);
+            goto out;
+        }
+    }
+
+    if (Osal_SemaphoreCreate(0, &s_loopExitSema) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    returnCode = RecorderReplay_Start();
+    if (returnCode != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "replay start error 0x%08llX\n", (unsigned long long) returnCode);
+        goto out;
+    }
+
+    if (Osal_TaskCreate("replay_loop", TelemetryReplay_LoopTask, TELEMETRY_REPLAY_LOOP_TASK_STACK_SIZE, NULL,
+                        &loopTask) != ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        fprintf(stderr, "create loop task error\n");
+        goto out;
+    }
+
+    RecorderReplay_WaitFinished();
+    Osal_SemaphoreWait(s_loopExitSema);
+    RecorderReplay_GetStatistics(&replayStatistics);
+
+    printf("%-40s %s\n", "clock", replayConfig.clock == RECORDER_REPLAY_CLOCK_VIRTUAL ? "virtual" : "wall");
+    printf("%-40s %12u\n", "topics", topicCount);
+    printf("%-40s %12llu\n", "values delivered", (unsigned long long) replayStatistics.deliveredCount);
+    printf("%-40s %12llu\n", "values skipped", (unsigned long long) replayStatistics.skippedCount);
+    printf("%-40s %12.3f\n", "replayed time, s", (double) replayStatistics.replayedTimeUs / 1000000.0);
+    printf("%-40s %12.3f\n", "wall time, s", (double) replayStatistics.wallTimeUs / 1000000.0);
+    printf("%-40s %12.1f\n", "speedup",
+           (double) replayStatistics.replayedTimeUs / (double) USER_UTIL_MAX(replayStatistics.wallTimeUs, 1));
+    printf("%-40s %12llu\n", "lateness max, us", (unsigned long long) replayStatistics.latenessMaxUs);
+    printf("%-40s %12u\n", "stalled clients", replayStatistics.stalledClientCount);
+    printf("%-40s %12llu\n", "loop iterations", (unsigned long long) s_loopStatistics.iterationCount);
+    printf("%-40s %12llu\n", "loop misses", (unsigned long long) s_loopStatistics.missCount);
+    printf("%-40s %12.3f\n", "loop yaw sum, 0.1 degree", s_loopStatistics.yawSum);
+    printf("%-40s %12llu\n", "loop read p50, ns",
+           (unsigned long long) UtilMetrics_HistogramGetQuantile(&s_loopReadTime, 0.5f));
+    printf("%-40s %12llu\n", "loop read p99, ns",
+           (unsigned long long) UtilMetrics_HistogramGetQuantile(&s_loopReadTime, 0.99f));
+    if (consumer != NULL && FcSubscriptionDispatcher_GetConsumerStatistics(consumer, &consumerStatistics) ==
+                            ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        printf("%-40s %12llu\n", "follow delivered", (unsigned long long) consumerStatistics.deliveredCount);
+        printf("%-40s %12llu\n", "follow dropped", (unsigned long long) consumerStatistics.droppedCount);
+        printf("%-40s %12llu\n", "follow callback p99, ns",
+               (unsigned long long) UtilMetrics_HistogramGetQuantile(&s_followTime, 0.99f));
+    }
+
+    if (metricsPath != NULL) {
+        metricsFile = fopen(metricsPath, "w");
+        if (metricsFile == NULL) {
+            fprintf(stderr, "%s: cannot open\n", metricsPath);
+        } else {
+            UtilMetrics_Export(TelemetryReplay_WriteMetrics, metricsFile);
+            fclose(metricsFile);
+        }
+    }
+
+out:
+    RecorderReplay_DeInit();
+    return returnCode == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS ? 0 : 1;
+
+usage:
+    fprintf(stderr, "usage: %s [-x speed] [-v] [-r rate] [-m metrics] <session.zti>\n"
+                    "  -x  replay speed, 1 for real time, 0 for as fast as possible, default 1\n"
+                    "  -v  virtual clock, the control loop sleeps on the replay time and runs the same on every run\n"
+                    "  -r  control loop rate in Hz, at most 1000, default %d\n"
+                    "  -m  write the metrics in the Prometheus text format to a file\n",
+            argv[0], TELEMETRY_REPLAY_LOOP_RATE_DEFAULT);
+    return 1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void *TelemetryReplay_LoopTask(void *arg)
+{
+    T_ZiyanFcSubscriptionQuaternion quaternion;
+    T_ZiyanQuaternion4f rotation;
+    T_ZiyanAttitude3f attitude;
+    T_RecorderReplayStatistics replayStatistics;
+    uint64_t startNs;
+
+    USER_UTIL_UNUSED(arg);
+
+    // The loop ends with the session, seen after a sleep so that the last iteration is the same on every run.
+    do {
+        startNs = TelemetryReplay_GetTimeNs();
+        if (FcSubscriptionCache_Read(ZIYAN_FC_SUBSCRIPTION_TOPIC_QUATERNION, &quaternion, sizeof(quaternion), NULL,
+                                     NULL) == ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            rotation.q0 = quaternion.q0;
+            rotation.q1 = quaternion.q1;
+            rotation.q2 = quaternion.q2;
+            rotation.q3 = quaternion.q3;
+            UtilAttitude_QuaternionToEuler(&rotation, &attitude);
+            UtilMetrics_HistogramRecord(&s_loopReadTime, TelemetryReplay_GetTimeNs() - startNs);
+            s_loopStatistics.yawSum += attitude.yaw;
+        } else {
+            s_loopStatistics.missCount++;
+        }
+        s_loopStatistics.iterationCount++;
+
+        RecorderReplay_TaskSleepMs(s_loopPeriodMs);
+        RecorderReplay_GetStatistics(&replayStatistics);
+    } while (!replayStatistics.isFinished);
+
+    RecorderReplay_DetachClock();
+    Osal_SemaphorePost(s_loopExitSema);
+
+    return NULL;
+}
+
+static T_ZiyanReturnCode TelemetryReplay_FollowCallback(const uint8_t *data, uint16_t dataSize,
+                                                        const T_ZiyanDataTimestamp *timestamp)
+{
+    const T_ZiyanFcSubscriptionQuaternion *quaternion = (const T_ZiyanFcSubscriptionQuaternion *) data;
+    T_ZiyanQuaternion4f rotation;
+    T_ZiyanAttitude3f attitude;
+    uint64_t startNs = TelemetryReplay_GetTimeNs();
+
+    USER_UTIL_UNUSED(timestamp);
+
+    if (dataSize != sizeof(T_ZiyanFcSubscriptionQuaternion)) {
+        return ZIYAN_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    rotation.q0 = quaternion->q0;
+    rotation.q1 = quaternion->q1;
+    rotation.q2 = quaternion->q2;
+    rotation.q3 = quaternion->q3;
+    UtilAttitude_QuaternionToEuler(&rotation, &attitude);
+    UtilMetrics_HistogramRecord(&s_followTime, TelemetryReplay_GetTimeNs() - startNs);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_ZiyanReturnCode TelemetryReplay_PrintConsole(const uint8_t *data, uint16_t dataLen)
+{
+    fwrite(data, 1, dataLen, stderr);
+
+    return ZIYAN_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void TelemetryReplay_WriteMetrics(const char *data, uint32_t len, void *arg)
+{
+    fwrite(data, 1, len, (FILE *) arg);
+}
+
+static uint64_t TelemetryReplay_GetTimeNs(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+/****************** (C) COPYRIGHT ZIYAN Innovations *****END OF FILE****/